@@ -578,7 +578,7 @@ cl_log (int argc, VALUE *argv, VALUE self)
   end = parse_revision (aEnd);
 
   err = svn_client_log (auth_baton,
-                        paths, &start, &end,
+                        paths, &start, &end, 0,
                         RTEST (discover_changed_paths),
                         svn_ruby_log_receiver,
                         (void *)&baton,
@@ -680,7 +680,7 @@ ra_get_log (int argc, VALUE *argv, VALUE self)
   end = NUM2LONG (aEnd);
 
   err = ra->plugin->get_log (ra->session_baton,
-			     paths, start, end,
+			     paths, start, end, 0,
 			     RTEST (discover_changed_paths),
 			     svn_ruby_log_receiver,
 			     (void *)&baton);
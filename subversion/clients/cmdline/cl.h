@@ -52,6 +52,7 @@ typedef enum {
   svn_cl__auth_username_opt,
   svn_cl__auth_password_opt,
   svn_cl__targets_opt,
+  svn_cl__limit_opt,
 } svn_cl__longopt_t;
 
 
@@ -99,6 +100,8 @@ typedef struct svn_cl__opt_state_t
   svn_stringbuf_t *extensions;
   /* Targets supplied from a file with --targets */
   apr_array_header_t *targets;
+  /* The most log messages to show, or 0 for all of them */
+  int limit;
 } svn_cl__opt_state_t;
 
 
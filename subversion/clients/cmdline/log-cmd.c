@@ -221,6 +221,7 @@ svn_cl__log (apr_getopt_t *os,
                            targets,
                            &(opt_state->start_revision),
                            &(opt_state->end_revision),
+                           opt_state->limit,
                            opt_state->verbose,
                            log_message_receiver,
                            &lb,
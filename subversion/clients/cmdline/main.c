@@ -22,6 +22,7 @@
 
 /*** Includes. ***/
 
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <locale.h>
@@ -69,6 +70,7 @@ const apr_getopt_option_t svn_cl__options[] =
     {"password",      svn_cl__auth_password_opt, 1, "specify a password ARG"},
     {"extensions",    'x', 1, "pass \"ARG\" as bundled options to GNU diff"},
     {"targets",       svn_cl__targets_opt, 1, "pass contents of file \"ARG\" as additional args"},
+    {"limit",         svn_cl__limit_opt, 1, "show at most ARG log messages"},
     {0,               0, 0}
   };
 
@@ -203,9 +205,11 @@ const svn_cl__cmd_desc_t svn_cl__cmd_table[] =
     "\n"
     "    svn log http://www.example.com/repo/project/foo.c\n"
     "\n"
-    "    svn log http://www.example.com/repo/project foo.c bar.c\n",
+    "    svn log http://www.example.com/repo/project foo.c bar.c\n"
+    "\n"
+    "    svn log --limit 10 http://www.example.com/repo/project\n",
     {'r', 'D', 'v', svn_cl__targets_opt, svn_cl__auth_username_opt,
-     svn_cl__auth_password_opt} },
+     svn_cl__auth_password_opt, svn_cl__limit_opt} },
   
   { "merge", svn_cl__merge, {0},
     "merge:  apply the differences between two paths to a working copy path.\n"
@@ -910,6 +914,24 @@ main (int argc, const char * const *argv)
 	  opt_state.targets = svn_cl__newlinelist_to_array(buffer, pool);
 	}
         break;
+      case svn_cl__limit_opt:
+        {
+          char *end;
+          long limit = strtol (opt_arg, &end, 10);
+          if (*end != '\0' || end == opt_arg || limit <= 0)
+            {
+              svn_handle_error (svn_error_createf
+                                (SVN_ERR_CL_ARG_PARSING_ERROR,
+                                 0, NULL, pool,
+                                 "Limit must be a positive number, "
+                                 "not \"%s\"", opt_arg),
+                                stderr, FALSE);
+              svn_pool_destroy (pool);
+              return EXIT_FAILURE;
+            }
+          opt_state.limit = (int) limit;
+        }
+        break;
       case svn_cl__force_opt:
         opt_state.force = TRUE;
         break;
@@ -571,6 +571,9 @@ svn_client_status (apr_hash_t **statushash,
   
    ### todo: the above paragraph is not fully implemented yet.
   
+   If LIMIT is non-zero, only invoke RECEIVER on the first LIMIT
+   messages.
+
    If DISCOVER_CHANGED_PATHS is set, then the `changed_paths' argument
    to RECEIVER will be passed on each invocation.
   
@@ -584,6 +587,7 @@ svn_client_log (svn_client_auth_baton_t *auth_baton,
                 const apr_array_header_t *targets,
                 const svn_client_revision_t *start,
                 const svn_client_revision_t *end,
+                int limit,
                 svn_boolean_t discover_changed_paths,
                 svn_log_message_receiver_t receiver,
                 void *receiver_baton,
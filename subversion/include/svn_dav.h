@@ -40,6 +40,19 @@ extern "C" {
 #define SVN_DAV_DELTA_BASE_HEADER "X-SVN-VR-Base"
 
 
+/* This is the MIME type of a POST body which makes a whole commit in
+   one request.  The body is the length of the log message in decimal,
+   a newline, the log message itself, and then an editor drive in the
+   binary editor format (see svn_delta_get_binary_editor), with paths
+   relative to the URL the body is posted to. */
+#define SVN_DAV_COMMIT_MIME_TYPE "application/vnd.svn-commit"
+
+/* A server which accepts SVN_DAV_COMMIT_MIME_TYPE bodies lists this
+   token in the DAV: header of its OPTIONS responses. */
+#define SVN_DAV_OPTION_SINGLE_COMMIT \
+        "http://subversion.tigris.org/xmlns/dav/svn/single-commit"
+
+
 /* ### should add strings for the various XML elements in the reports
    ### and things. also the custom prop names. etc.
 */
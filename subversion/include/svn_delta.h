@@ -156,6 +156,34 @@ typedef svn_error_t * (*svn_txdelta_window_handler_t)
 typedef struct svn_txdelta_stream_t svn_txdelta_stream_t;
 
 
+/* A typedef for a function that will set *WINDOW to the next window
+   from a svn_txdelta_stream_t object.  If there are no more delta
+   windows, NULL will be used.  The returned window, if any, will be
+   allocated in POOL.  BATON is the baton specified when the stream was
+   created.  */
+typedef svn_error_t * (*svn_txdelta_next_window_fn_t)
+                      (svn_txdelta_window_t **window,
+                       void *baton,
+                       apr_pool_t *pool);
+
+/* A typedef for a function that will return the MD5 digest of the
+   fulltext deltified by a svn_txdelta_stream_t object, or NULL if the
+   stream has not yet returned its final NULL window.  BATON is the
+   baton specified when the stream was created.  */
+typedef const unsigned char * (*svn_txdelta_md5_digest_fn_t) (void *baton);
+
+
+/* Create and return a generic text delta stream with BATON,
+   NEXT_WINDOW and MD5_DIGEST.  Allocate the new stream in POOL.  This
+   lets code outside libsvn_delta produce windows through the
+   `svn_txdelta_next_window' interface.  */
+svn_txdelta_stream_t *
+svn_txdelta_stream_create (void *baton,
+                           svn_txdelta_next_window_fn_t next_window,
+                           svn_txdelta_md5_digest_fn_t md5_digest,
+                           apr_pool_t *pool);
+
+
 /* Set *WINDOW to a pointer to the next window from the delta stream
    STREAM.  When we have completely reconstructed the target string,
    set *WINDOW to zero.
@@ -185,6 +213,67 @@ void svn_txdelta (svn_txdelta_stream_t **stream,
                   apr_pool_t *pool);
 
 
+/* Like svn_txdelta, but compute the delta windows on NUM_THREADS
+   worker threads.  *STREAM reads ahead up to two windows per thread
+   from SOURCE and TARGET, and returns them through
+   `svn_txdelta_next_window' in order; the windows are the same ones
+   svn_txdelta would produce.  This pays off for large files, where
+   the cost of computing a window dominates.
+
+   The read-ahead buffers and worker threads live in POOL until it is
+   destroyed, or until *STREAM has returned its final NULL window.  If
+   NUM_THREADS is less than one or APR has no thread support, this is
+   the same as svn_txdelta.  */
+void svn_txdelta_parallel (svn_txdelta_stream_t **stream,
+                           svn_stream_t *source,
+                           svn_stream_t *target,
+                           int num_threads,
+                           apr_pool_t *pool);
+
+
+/* Return a deep copy of WINDOW, allocated in POOL.  */
+svn_txdelta_window_t *svn_txdelta_window_dup (const svn_txdelta_window_t
+                                              *window,
+                                              apr_pool_t *pool);
+
+
+/* Compose two delta windows, yielding a third, allocated in POOL.
+
+   WINDOW_A describes how to produce a stretch of some intermediate
+   text from a source view; WINDOW_B describes how to produce a stretch
+   of the final target from a source view over that intermediate text.
+   The source view of WINDOW_B must be exactly the target view of
+   WINDOW_A, so WINDOW_B->sview_len must equal WINDOW_A->tview_len.
+
+   The result has WINDOW_A's source view and WINDOW_B's target view,
+   and reconstructs WINDOW_B's target view directly from WINDOW_A's
+   source view.  The intermediate text is never materialised; source
+   instructions in WINDOW_B are mapped through WINDOW_A's instruction
+   list.  */
+svn_txdelta_window_t *
+svn_txdelta_compose_windows (const svn_txdelta_window_t *window_A,
+                             const svn_txdelta_window_t *window_B,
+                             apr_pool_t *pool);
+
+
+/* Set *STREAM to a delta stream that turns the source of STREAM_A
+   into the target of STREAM_B, where the target of STREAM_A is the
+   source of STREAM_B.
+
+   Windows are pulled from STREAM_B one at a time; windows from
+   STREAM_A are read ahead only as far as needed to cover the source
+   view of the current STREAM_B window, and are released as soon as
+   STREAM_B's source view slides past them.  So memory use is bounded
+   by the window sizes of the two streams, not by the size of the
+   texts.  The composed stream's MD5 digest is that of STREAM_B.
+
+   Do any necessary allocation in a sub-pool of POOL.  */
+void svn_txdelta_compose (svn_txdelta_stream_t **stream,
+                          svn_txdelta_stream_t *stream_A,
+                          svn_txdelta_stream_t *stream_B,
+                          apr_pool_t *pool);
+
+
 /* Send the contents of STRING to window-handler HANDLER/BATON. This is
    effectively a 'copy' operation, resulting in delta windows that make
    the target equivalent to the value of STRING.
@@ -937,6 +1026,39 @@ svn_error_t *svn_delta_xml_auto_parse (svn_stream_t *source,
                                        apr_pool_t *pool);
 
 
+
+/* Creates an editor which writes a compact, length-prefixed binary
+   encoding of the editor drive to OUTPUT.  Text deltas are written
+   as raw svndiff data, and paths and property values are written
+   as-is, so nothing needs escaping or base64 encoding.  On return,
+   *EDITOR and *EDIT_BATON will be set to the editor and its baton.
+   The editor's memory will live in a sub-pool of POOL.  OUTPUT is
+   closed by close_edit or abort_edit.
+
+   Use svn_delta_binary_parse() to replay the drive. */
+svn_error_t *
+svn_delta_get_binary_editor (svn_stream_t *output,
+                             const svn_delta_editor_t **editor,
+                             void **edit_baton,
+                             apr_pool_t *pool);
+
+
+/* Read an editor drive written by svn_delta_get_binary_editor() from
+   SOURCE, making the same calls, in the same order, into EDITOR and
+   EDIT_BATON.  Data is pulled from SOURCE in fixed-size chunks, so
+   memory use does not depend on the size of the drive.
+
+   Return SVN_ERR_EDITOR_DRIVE_UNEXPECTED_END if SOURCE runs out
+   before the drive's close_edit or abort_edit call, and
+   SVN_ERR_EDITOR_DRIVE_CORRUPT if the data is not a valid drive.
+   Errors from EDITOR are returned as-is.  Use POOL for all
+   allocations. */
+svn_error_t *svn_delta_binary_parse (svn_stream_t *source,
+                                     const svn_delta_editor_t *editor,
+                                     void *edit_baton,
+                                     apr_pool_t *pool);
+
+
 
 
 
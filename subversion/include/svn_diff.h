@@ -0,0 +1,61 @@
+/*  svn_diff.h:  comparing texts line by line.
+ *
+ * ====================================================================
+ * Copyright (c) 2000-2002 CollabNet.  All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.  The terms
+ * are also available at http://subversion.tigris.org/license-1.html.
+ * If newer versions of this license are posted there, you may use a
+ * newer version instead, at your option.
+ *
+ * This software consists of voluntary contributions made by many
+ * individuals.  For exact contribution history, see the revision
+ * history and logs, available at http://subversion.tigris.org/.
+ * ====================================================================
+ */
+
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#ifndef SVN_DIFF_H
+#define SVN_DIFF_H
+
+#include "svn_string.h"
+#include "svn_error.h"
+#include "svn_io.h"
+
+/* Compare ORIGINAL and MODIFIED line by line, and write the
+   differences to OUT in unified diff format, with CONTEXT lines of
+   unchanged text around each change.  ORIGINAL_HEADER and
+   MODIFIED_HEADER are the labels for the "---" and "+++" lines.
+
+   A line is everything up to and including a newline; a final line
+   without one is marked "\ No newline at end of file", as GNU diff
+   does.  If the texts are the same, nothing at all is written.
+
+   Use POOL for temporary allocations.  */
+svn_error_t *svn_diff_unified (svn_stream_t *out,
+                               const svn_string_t *original,
+                               const svn_string_t *modified,
+                               const char *original_header,
+                               const char *modified_header,
+                               int context,
+                               apr_pool_t *pool);
+
+
+#endif /* SVN_DIFF_H */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+
+/* --------------------------------------------------------------
+ * local variables:
+ * eval: (load-file "../../tools/dev/svn-dev.el")
+ * end:
+ */
@@ -306,6 +306,18 @@ SVN_ERROR_START
   SVN_ERRDEF (SVN_ERR_REPOS_NO_DATA_FOR_REPORT,
               "A report cannot be generated because no data was supplied.")
 
+  SVN_ERRDEF (SVN_ERR_REPOS_BAD_DUMP_STREAM,
+              "Malformed repository dump stream")
+
+  SVN_ERRDEF (SVN_ERR_REPOS_BAD_DUMP_VERSION,
+              "Unsupported repository dump stream version")
+
+  SVN_ERRDEF (SVN_ERR_REPOS_READ_ONLY,
+              "The repository is a read-only replica")
+
+  SVN_ERRDEF (SVN_ERR_REPOS_NOT_REPLICA,
+              "The repository is not a replica")
+
   SVN_ERRDEF (SVN_ERR_EXTERNAL_PROGRAM,
               "Error calling external program")
 
@@ -380,6 +392,19 @@ SVN_ERROR_START
 
   /* END svndiff errors */
 
+  /* BEGIN binary editor drive errors */
+
+  SVN_ERRDEF (SVN_ERR_EDITOR_DRIVE_INVALID_HEADER,
+              "Editor drive data has invalid header")
+
+  SVN_ERRDEF (SVN_ERR_EDITOR_DRIVE_CORRUPT,
+              "Editor drive data is corrupt")
+
+  SVN_ERRDEF (SVN_ERR_EDITOR_DRIVE_UNEXPECTED_END,
+              "Editor drive data ends unexpectedly")
+
+  /* END binary editor drive errors */
+
   /* BEGIN mod_dav_svn errors */
 
   SVN_ERRDEF (SVN_ERR_APMOD_MISSING_PATH_TO_FS,
@@ -131,6 +131,18 @@ svn_error_t *svn_fs_open_berkeley (svn_fs_t *fs, const char *path);
 const char *svn_fs_berkeley_path (svn_fs_t *fs, apr_pool_t *pool);
 
 
+/* Set *TRAILS to the number of Berkeley DB transactions FS has begun
+   since it was created with svn_fs_new(), and *DEADLOCK_RETRIES to
+   how many of those deadlocked with another and were tried again.
+   Either of TRAILS and DEADLOCK_RETRIES may be zero.
+
+   These counts are not protected against concurrent use of FS; like
+   the rest of FS, they belong to one thread at a time.  */
+void svn_fs_trail_stats (unsigned long *trails,
+                         unsigned long *deadlock_retries,
+                         svn_fs_t *fs);
+
+
 /* Register an error handling function for Berkeley DB error messages.
    If a Berkeley DB error occurs, the filesystem will call HANDLER
    with two strings: an error message prefix, which will be zero, and
@@ -181,6 +193,90 @@ svn_error_t *svn_fs_berkeley_recover (const char *path,
                                       apr_pool_t *pool);
 
 
+/* Make a consistent copy of the Berkeley DB environment of the open
+   filesystem FS at DEST_PATH, which must not exist yet, while FS stays
+   in use.  Copy the database files and then the log files, and run
+   catastrophic recovery on the copy to replay the logs.
+
+   If INCREMENTAL is non-zero, DEST_PATH must instead be an earlier
+   copy made by this function, which nothing else is using: copy only
+   the log files written since, and replay them.
+
+   This never removes log files from FS.  Use POOL for all
+   allocations.  */
+svn_error_t *svn_fs_hotcopy_berkeley (svn_fs_t *fs,
+                                      const char *dest_path,
+                                      svn_boolean_t incremental,
+                                      apr_pool_t *pool);
+
+
+/* What svn_fs_verify() found.  */
+typedef struct svn_fs_verify_stats_t
+{
+  /* Representations whose contents matched their recorded checksums. */
+  int checked;
+
+  /* Representations reconstructed, but with no checksum to compare
+     against: they are mutable, or were stored before checksums were
+     recorded, or were deleted while the verification ran. */
+  int skipped;
+
+  /* Representations that could not be reconstructed, or whose
+     contents did not match their checksums. */
+  int corrupt;
+
+} svn_fs_verify_stats_t;
+
+
+/* Check every representation in FS: reconstruct its contents, and
+   compare them against the MD5 checksum recorded when it was
+   committed.  Share the work among NUM_THREADS threads, each with its
+   own handle on FS; if NUM_THREADS is less than two, or APR has no
+   thread support, do it all in the calling thread.  If STATS is
+   non-null, fill it in.  Use POOL for all allocations.
+
+   If any representation is corrupt, return an SVN_ERR_FS_CORRUPT error
+   whose chain lists every corrupt representation and what was wrong
+   with it.  */
+svn_error_t *svn_fs_verify (svn_fs_verify_stats_t *stats,
+                            svn_fs_t *fs,
+                            int num_threads,
+                            apr_pool_t *pool);
+
+
+/* What svn_fs_gc() deleted.  */
+typedef struct svn_fs_gc_stats_t
+{
+  /* Mutable node revisions that no live transaction could reach. */
+  int nodes;
+
+  /* Representations that nothing referred to. */
+  int reps;
+
+  /* Strings that no representation referred to. */
+  int strings;
+
+} svn_fs_gc_stats_t;
+
+
+/* Collect the garbage in FS: delete the mutable node revisions that
+   no live transaction can reach, and the representations and strings
+   nothing refers to, such as those left behind by transactions that
+   were removed by a process that crashed part way through.  Work
+   through each table in trails of at most BATCH_SIZE records, so that
+   FS can stay in use while this runs; if BATCH_SIZE is zero or less,
+   pick a reasonable size.  An interrupted collection can simply be
+   run again.  If STATS is non-null, fill it in.  Use POOL for all
+   allocations.
+
+   This does not remove transactions themselves, however old they
+   are; use svn_fs_abort_txn() for that first.  */
+svn_error_t *svn_fs_gc (svn_fs_gc_stats_t *stats,
+                        svn_fs_t *fs,
+                        int batch_size,
+                        apr_pool_t *pool);
+
+
 
 /* Node and Node Revision ID's.  */
 
@@ -505,6 +601,30 @@ svn_error_t *svn_fs_list_transactions (char ***names_p,
                                        svn_fs_t *fs,
                                        apr_pool_t *pool);
 
+
+/* Set *TXN_NAME_P to the name of the transaction recorded as the
+   transaction of ACTIVITY_ID in FS by `svn_fs_set_activity_txn', or
+   to zero if none is.  Allocate the name in POOL.
+
+   An activity is a client's name for a transaction, as in WebDAV's
+   versioning extensions; the filesystem keeps a table of them, so
+   they can be looked up directly.  */
+svn_error_t *svn_fs_activity_txn (const char **txn_name_p,
+                                  svn_fs_t *fs,
+                                  const char *activity_id,
+                                  apr_pool_t *pool);
+
+/* Record TXN_NAME as the transaction of ACTIVITY_ID in FS, replacing
+   any transaction recorded for it before.  If TXN_NAME is zero,
+   forget ACTIVITY_ID instead.  Do any temporary allocation in POOL.
+
+   Committing or aborting a transaction does not forget its activity;
+   the caller should do that.  */
+svn_error_t *svn_fs_set_activity_txn (svn_fs_t *fs,
+                                      const char *activity_id,
+                                      const char *txn_name,
+                                      apr_pool_t *pool);
+
 /* Transaction properties */
 
 /* Set *VALUE_P to the value of the property named PROPNAME on
@@ -661,6 +781,12 @@ svn_node_kind_t svn_fs_check_path (svn_fs_root_t *root,
    The array of *REVS are sorted in descending order. All duplicates
    will also be removed. PATHS is an array of `const char *' entries.
 
+   If OLDEST is a valid revision, leave out revisions older than it.
+   If LIMIT is non-zero, return at most the LIMIT youngest revisions.
+   Each path's history is walked youngest first, and the walk stops as
+   soon as either bound is reached, so a bounded request costs time in
+   proportion to the revisions it returns, not to the whole history.
+
    NOTE: This function uses node-id ancestry alone to determine
    modifiedness, and therefore does NOT claim that in any of the
    returned revisions file contents changed, properties changed,
@@ -668,6 +794,8 @@ svn_node_kind_t svn_fs_check_path (svn_fs_root_t *root,
 svn_error_t *svn_fs_revisions_changed (apr_array_header_t **revs,
                                        svn_fs_root_t *root,
                                        const apr_array_header_t *paths,
+                                       svn_revnum_t oldest,
+                                       int limit,
                                        apr_pool_t *pool);
 
 
@@ -925,6 +1053,40 @@ svn_error_t *svn_fs_dir_entries (apr_hash_t **entries_p,
                                  apr_pool_t *pool);
 
 
+/* What svn_fs_node_info tells about a node.  */
+typedef struct svn_fs_node_info_t {
+
+  /* The node revision ID.  */
+  svn_fs_id_t *id;
+
+  /* Whether the node is a file or a directory.  */
+  svn_node_kind_t kind;
+
+  /* The revision in which the node was created, or SVN_INVALID_REVNUM
+     for an uncommitted node; see svn_fs_node_created_rev.  */
+  svn_revnum_t created_rev;
+
+} svn_fs_node_info_t;
+
+
+/* Set *INFO_P to the ID, kind and created revision of PATH in ROOT.
+
+   If ENTRIES_P is non-zero, then if PATH is a directory, set
+   *ENTRIES_P to a hash table of the same for each of its entries,
+   whose keys are entry names and whose values are pointers to
+   svn_fs_node_info_t structures; if PATH is a file, set *ENTRIES_P to
+   zero.
+
+   This reads everything in a single Berkeley DB transaction, so it is
+   much cheaper than asking for each entry's ID and created revision
+   in turn.  Allocate the results in POOL.  */
+svn_error_t *svn_fs_node_info (svn_fs_node_info_t **info_p,
+                               apr_hash_t **entries_p,
+                               svn_fs_root_t *root,
+                               const char *path,
+                               apr_pool_t *pool);
+
+
 /* Create a new directory named PATH in ROOT.  The new directory has
    no entries, and no properties.  ROOT must be the root of a
    transaction, not a revision.
@@ -1027,6 +1189,17 @@ svn_error_t *svn_fs_file_length (apr_off_t *length_p,
                                  apr_pool_t *pool);
 
 
+/* Set DIGEST, which must have room for MD5_DIGESTSIZE bytes, to the
+   MD5 checksum of the contents of the file PATH in ROOT.  For a file
+   in a revision this is the checksum recorded when it was committed,
+   so the contents are not read; otherwise it is computed.  Do any
+   necessary temporary allocation in POOL.  */
+svn_error_t *svn_fs_file_md5_checksum (unsigned char digest[],
+                                       svn_fs_root_t *root,
+                                       const char *path,
+                                       apr_pool_t *pool);
+
+
 /* Set *CONTENTS to a readable generic stream will yield the contents
    of the file PATH in ROOT.  Allocate the stream in POOL.  You can
    only use *CONTENTS for as long as the underlying filesystem is
@@ -1046,6 +1219,16 @@ svn_error_t *svn_fs_file_contents (svn_stream_t **contents,
                                    apr_pool_t *pool);
 
 
+/* Like svn_fs_file_contents, but the stream starts OFFSET bytes into
+   the file.  This doesn't read the contents before OFFSET from the
+   database, so it is the way to read just a range of a large file.  */
+svn_error_t *svn_fs_file_contents_at (svn_stream_t **contents,
+                                      svn_fs_root_t *root,
+                                      const char *path,
+                                      apr_size_t offset,
+                                      apr_pool_t *pool);
+
+
 /* Create a new file named PATH in ROOT.  The file's initial contents
    are the empty string, and it has no properties.  ROOT must be the
    root of a transaction, not a revision.
@@ -1079,7 +1262,11 @@ svn_error_t *svn_fs_apply_textdelta (svn_txdelta_window_handler_t *contents_p,
 /* Set *CHANGED_P to 1 if the contents at PATH1 under ROOT1 differ
    from those at PATH2 under ROOT2, or set it to 0 if they are the
    same.  Both paths must exist under their respective roots, and both
-   roots must be in the same filesystem.  */
+   roots must be in the same filesystem.
+
+   Committed contents are compared by their recorded checksums, so
+   identical contents stored separately compare the same, and neither
+   is read.  */
 svn_error_t *svn_fs_contents_changed (int *changed_p,
                                       svn_fs_root_t *root1,
                                       const char *path1,
@@ -209,6 +209,12 @@ svn_error_t *svn_io_filesizes_different_p (svn_boolean_t *different_p,
 apr_status_t svn_io_fd_from_file (int *fd_p, apr_file_t *file);
 
 
+/* Flush any data buffered for FILE, and don't return until the
+   operating system has written it to the disk.  Use POOL for the
+   error, if there is one. */
+svn_error_t *svn_io_file_flush_to_disk (apr_file_t *file, apr_pool_t *pool);
+
+
 
 /* Generic byte-streams */
 
@@ -413,6 +419,12 @@ svn_error_t *svn_io_run_diff3 (const char *dir,
 svn_error_t *svn_io_detect_mimetype (const char **mimetype,
                                      const char *file,
                                      apr_pool_t *pool);
+
+
+/* Return TRUE if the LEN bytes at DATA look like binary data rather
+   than text, by the same rule svn_io_detect_mimetype() applies to the
+   first block of a file.  */
+svn_boolean_t svn_io_is_binary_data (const void *data, apr_size_t len);
                                       
 
 
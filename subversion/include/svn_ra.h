@@ -489,6 +489,9 @@ typedef struct svn_ra_plugin_t
      the hash's keys are all the paths committed in that revision.
      Otherwise, each call to receiver passes null for CHANGED_PATHS.
     
+     If LIMIT is non-zero, only invoke RECEIVER on the first LIMIT
+     log messages.
+    
      If any invocation of RECEIVER returns error, return that error
      immediately and without wrapping it.
     
@@ -497,6 +500,7 @@ typedef struct svn_ra_plugin_t
                            const apr_array_header_t *paths,
                            svn_revnum_t start,
                            svn_revnum_t end,
+                           int limit,
                            svn_boolean_t discover_changed_paths,
                            svn_log_message_receiver_t receiver,
                            void *receiver_baton);
@@ -27,6 +27,7 @@ extern "C" {
 
 #include <apr_pools.h>
 #include <apr_hash.h>
+#include <apr_time.h>
 #include "svn_fs.h"
 #include "svn_delta.h"
 #include "svn_types.h"
@@ -48,7 +49,12 @@ typedef struct svn_repos_t svn_repos_t;
    Acquires a shared lock on the repository, and attaches a cleanup
    function to POOL to remove the lock.  If no lock can be acquired,
    returns error, with undefined effect on *REPOS_P.  If an exclusive
-   lock is present, this blocks until it's gone.  */
+   lock is present, this blocks until it's gone.
+
+   If the repository is a read-only replica (see
+   svn_repos_replicate), the object can be used for reading, but
+   attempts to commit to the repository or load into it through it
+   fail with SVN_ERR_REPOS_READ_ONLY.  */
 svn_error_t *svn_repos_open (svn_repos_t **repos_p,
                              const char *path,
                              apr_pool_t *pool);
@@ -68,9 +74,32 @@ svn_error_t *svn_repos_close (svn_repos_t *repos);
    necessary allocations. */
 svn_error_t *svn_repos_delete (const char *path, apr_pool_t *pool);
 
+/* Make a hot copy of the repository at SRC_PATH at DST_PATH, while
+   the repository stays in use: copy its configuration, hooks and lock
+   files, and make a consistent copy of its Berkeley DB environment
+   with svn_fs_hotcopy_berkeley().  DST_PATH must not exist, or must
+   be an empty directory.
+
+   If INCREMENTAL is non-zero, DST_PATH must instead be an earlier hot
+   copy of the same repository; bring its database up to date by
+   shipping and replaying only the Berkeley DB log files written since.
+   This takes an exclusive lock on the copy while it runs.
+
+   Use POOL for all allocations.  */
+svn_error_t *svn_repos_hotcopy (const char *src_path,
+                                const char *dst_path,
+                                svn_boolean_t incremental,
+                                apr_pool_t *pool);
+
 /* Return the filesystem associated with repository object REPOS. */
 svn_fs_t *svn_repos_fs (svn_repos_t *repos);
 
+/* Have updates reported against REPOS (see svn_repos_begin_report)
+   read ahead on NUM_THREADS worker threads, as
+   svn_repos_dir_delta_pipelined() does.  The default, zero, does all
+   the work in the caller's thread. */
+void svn_repos_set_delta_threads (svn_repos_t *repos, int num_threads);
+
 
 /* Repository Paths */
 
@@ -102,6 +131,10 @@ const char *svn_repos_post_commit_hook (svn_repos_t *repos, apr_pool_t *pool);
 const char *svn_repos_read_sentinel_hook (svn_repos_t *repos, apr_pool_t *pool);
 const char *svn_repos_write_sentinel_hook (svn_repos_t *repos, apr_pool_t *pool);
 
+/* Return the path to REPOS's hook plugin (see svn_repos_hook_plugin_t),
+   allocated in POOL. */
+const char *svn_repos_hook_plugin (svn_repos_t *repos, apr_pool_t *pool);
+
 
 
 /* ---------------------------------------------------------------*/
@@ -110,20 +143,23 @@ const char *svn_repos_write_sentinel_hook (svn_repos_t *repos, apr_pool_t *pool)
 
 
 /* Construct and return a REPORT_BATON that will be paired with some
-   svn_ra_reporter_t table.  The table and baton are used to build a
-   transaction in the system;  when the report is finished,
-   svn_repos_dir_delta is called on the transaction, driving
-   EDITOR/EDIT_BATON. 
-
-   Specifically, the report will create a transaction made by
-   USERNAME, relative to FS_BASE in the filesystem.  TARGET is a
+   svn_ra_reporter_t table.  The table and baton are used to record
+   the state of a working copy;  when the report is finished, a tree
+   delta from that state is computed as by svn_repos_dir_delta,
+   driving EDITOR/EDIT_BATON.  Reporting never writes to the
+   filesystem: the working copy's state is kept in memory, and each
+   path is read from the revision it was reported at.
+
+   Specifically, the report is made by USERNAME, relative to FS_BASE
+   in the filesystem.  TARGET is a
    single path component, used to limit the scope of the report to a
    single entry of FS_BASE, or NULL if all of FS_BASE itself is the
    main subject of the report.
 
    TGT_PATH and REVNUM is the fs path/revision pair that is the
    "target" of dir_delta.  In other words, a tree delta will be
-   returned that transforms the transaction into TGT_PATH/REVNUM.
+   returned that transforms the reported working copy into
+   TGT_PATH/REVNUM.
  
    TEXT_DELTAS instructs the driver of the EDITOR to enable to disable
    the generation of text deltas.
@@ -149,13 +185,12 @@ svn_repos_begin_report (void **report_baton,
 
 
 /* Given a REPORT_BATON constructed by svn_repos_begin_report(), this
-   routine will build REVISION:PATH into the current transaction.
-   This routine is called multiple times to create a transaction that
-   is a "mirror" of a working copy.
+   routine will record that the working copy has PATH at REVISION.
+   This routine is called multiple times to describe a working copy
+   with mixed revisions.
 
-   The first call of this in a given report usually passes an empty
-   PATH; that allows the reporter to set up the correct root revision
-   (useful when creating a txn, for example).  */
+   The first call of this in a given report must pass an empty PATH;
+   that sets the revision of everything not reported otherwise.  */
 svn_error_t *
 svn_repos_set_path (void *report_baton,
                     const char *path,
@@ -163,20 +198,20 @@ svn_repos_set_path (void *report_baton,
 
 
 /* Given a REPORT_BATON constructed by svn_repos_begin_report(), this
-   routine will remove PATH from the current fs transaction. 
+   routine will record that PATH is missing from the working copy. 
 
    (This allows the reporter's driver to describe missing pieces of a
    working copy, so that 'svn up' can recreate them.) */   
 svn_error_t *svn_repos_delete_path (void *report_baton,
                                     const char *path);
 
-/* Make the filesystem compare the transaction to a revision and have
-   it drive an update editor (using svn_repos_delta_dirs()).  Then
-   abort the transaction. */
+/* Make the filesystem compare the reported working copy to a
+   revision and have it drive an update editor (as
+   svn_repos_dir_delta() would). */
 svn_error_t *svn_repos_finish_report (void *report_baton);
 
 
-/* The report-driver is bailing, so abort the fs transaction. */
+/* The report-driver is bailing, so throw away the report. */
 svn_error_t *svn_repos_abort_report (void *report_baton);
 
 
@@ -241,6 +276,89 @@ svn_repos_dir_delta (svn_fs_root_t *src_root,
                      apr_pool_t *pool);
 
 
+/* Like svn_repos_dir_delta, but read ahead of EDITOR on NUM_THREADS
+   worker threads.  The workers open FS again for themselves and, in
+   the order the traversal will reach them, prepare the property
+   changes and text delta windows of the files ahead, while the
+   caller's thread makes the same editor calls, in the same order, as
+   svn_repos_dir_delta would.  This lets filesystem reads and delta
+   computation overlap with whatever the editor does with its input,
+   such as writing it to the network.  Since the workers read ahead,
+   EDITOR must not change SRC_ROOT or TGT_ROOT.
+
+   Read-ahead is bounded at a few files per thread, and files longer
+   than a megabyte only have their properties read ahead.  If
+   NUM_THREADS is less than one, APR has no thread support, or the
+   workers cannot open the filesystem, this is the same as
+   svn_repos_dir_delta.
+
+   If REPOS is non-NULL, it must be the repository TGT_ROOT belongs
+   to, and not in use by another call at the same time.  The workers'
+   filesystem handles are then kept in REPOS when the delta is done,
+   and later calls reuse them rather than opening the filesystem
+   again.  */
+svn_error_t *
+svn_repos_dir_delta_pipelined (svn_fs_root_t *src_root,
+                               const char *src_parent_dir,
+                               const char *src_entry,
+                               apr_hash_t *src_revs,
+                               svn_fs_root_t *tgt_root,
+                               const char *tgt_path,
+                               const svn_delta_edit_fns_t *editor,
+                               void *edit_baton,
+                               svn_boolean_t text_deltas,
+                               svn_boolean_t recurse,
+                               svn_boolean_t use_copyfrom_args,
+                               svn_repos_t *repos,
+                               int num_threads,
+                               apr_pool_t *pool);
+
+
+/* ---------------------------------------------------------------*/
+
+/*** Making commits. */
+
+/* The type of function called when a commit editor's edit succeeds:
+   NEW_REVISION is the revision it made, and DATE and AUTHOR are that
+   revision's svn:date and svn:author.  BATON is the baton given to
+   svn_repos_get_commit_editor().  */
+typedef svn_error_t *svn_repos_commit_callback_t (svn_revnum_t new_revision,
+                                                  const char *date,
+                                                  const char *author,
+                                                  void *baton);
+
+/* Set *EDITOR and *EDIT_BATON to an editor which commits the changes
+   it is driven with to REPOS, as USER, with LOG_MSG as the log
+   message.  Paths in the drive are relative to BASE_PATH, an absolute
+   path in REPOS's filesystem.
+
+   The transaction is begun (and the start-commit hooks run) by
+   open_root, always against the youngest revision, and committed by
+   close_edit; a drive which finds a node newer than the revision the
+   driver named returns an out-of-dateness error.  abort_edit aborts
+   the transaction.  When the commit succeeds, CALLBACK is called with
+   CALLBACK_BATON.
+
+   REPOS_URL is the URL of REPOS's root directory.  Copy sources must
+   be URLs within it; the rest of such a URL is the path of the source
+   in REPOS.  Only the paths of the URLs are compared, since a client
+   may know the server by another name than the one it knows itself
+   by.
+
+   Allocate the editor and its batons in POOL.  */
+svn_error_t *
+svn_repos_get_commit_editor (const svn_delta_editor_t **editor,
+                             void **edit_baton,
+                             svn_repos_t *repos,
+                             const char *repos_url,
+                             const char *base_path,
+                             const char *user,
+                             const svn_string_t *log_msg,
+                             svn_repos_commit_callback_t *callback,
+                             void *callback_baton,
+                             apr_pool_t *pool);
+
+
 /* ---------------------------------------------------------------*/
 
 /*** Finding particular revisions. */
@@ -319,8 +437,13 @@ svn_repos_get_committed_info (svn_revnum_t *committed_rev,
  * see http://subversion.tigris.org/issues/show_bug.cgi?id=562 for
  * more information.
  *
+ * If LIMIT is non-zero, stop after RECEIVER has been called for LIMIT
+ * revisions.
+ *
  * If any invocation of RECEIVER returns error, return that error
- * immediately and without wrapping it.
+ * immediately and without wrapping it.  A receiver that wants no more
+ * messages (say, because whoever asked for them has gone away) can
+ * return SVN_ERR_CANCELED to stop the search.
  *
  * See also the documentation for `svn_log_message_receiver_t'.
  *
@@ -330,6 +453,7 @@ svn_repos_get_logs (svn_repos_t *repos,
                     const apr_array_header_t *paths,
                     svn_revnum_t start,
                     svn_revnum_t end,
+                    int limit,
                     svn_boolean_t discover_changed_paths,
                     svn_log_message_receiver_t receiver,
                     void *receiver_baton,
@@ -341,8 +465,138 @@ svn_repos_get_logs (svn_repos_t *repos,
 /*** Hook-sensitive wrappers for libsvn_fs routines. ***/
 
 
+/* A hook plugin is a shared library in the repository's hooks
+ * directory, named by svn_repos_hook_plugin(), that runs hooks inside
+ * the server process instead of as separate programs.  It is loaded
+ * the first time one of REPOS's hooks is run, and stays loaded for as
+ * long as REPOS is open.
+ *
+ * The library must export a function named
+ * SVN_REPOS_HOOK_PLUGIN_INIT_NAME, of type
+ * svn_repos_hook_plugin_init_t.  Each function in the table it returns
+ * may be NULL; for those hooks, the repository's hook program of the
+ * same name is run as usual.  A hook the plugin does implement
+ * replaces the hook program, which is then not run at all.
+ *
+ * An error returned by a start-commit or pre-commit function blocks
+ * the commit, just as a hook program exiting non-zero would.
+ *
+ * CHANGED_PATHS maps each path changed by the txn or revision (with a
+ * leading slash) to (void *) 'A', 'D', or 'R', for added, deleted, or
+ * modified; see svn_repos_get_logs().  All other arguments are for the
+ * duration of the call only: do temporary allocation in POOL, and do
+ * not hold on to TXN or the roots afterwards.  BATON is the one
+ * returned by the init function.  */
+typedef struct svn_repos_hook_plugin_t
+{
+  /* Called before USER's txn is created. */
+  svn_error_t *(*start_commit) (void *baton,
+                                svn_repos_t *repos,
+                                const char *user,
+                                apr_pool_t *pool);
+
+  /* Called when TXN is finished but not yet committed.  TXN_ROOT is
+     its root, open for reading. */
+  svn_error_t *(*pre_commit) (void *baton,
+                              svn_repos_t *repos,
+                              svn_fs_txn_t *txn,
+                              svn_fs_root_t *txn_root,
+                              apr_hash_t *changed_paths,
+                              apr_pool_t *pool);
+
+  /* Called after revision REV, whose root is REV_ROOT, is committed.
+     Errors are reported to the committer, but the commit stands. */
+  svn_error_t *(*post_commit) (void *baton,
+                               svn_repos_t *repos,
+                               svn_revnum_t rev,
+                               svn_fs_root_t *rev_root,
+                               apr_hash_t *changed_paths,
+                               apr_pool_t *pool);
+
+} svn_repos_hook_plugin_t;
+
+/* The version of svn_repos_hook_plugin_t above.  Plugins should refuse
+   to load, by returning an error from their init function, when handed
+   a version they were not written for. */
+#define SVN_REPOS_HOOK_PLUGIN_ABI_VERSION 1
+
+/* The name of the function a hook plugin exports. */
+#define SVN_REPOS_HOOK_PLUGIN_INIT_NAME "svn_repos_hook_plugin_init"
+
+/* Set *PLUGIN to the plugin's function table, and *BATON to the baton
+   to pass to those functions, for use with REPOS.  ABI_VERSION is
+   SVN_REPOS_HOOK_PLUGIN_ABI_VERSION.  POOL lives as long as REPOS; the
+   plugin may allocate *PLUGIN and *BATON in it, and register cleanups
+   on it.  */
+typedef svn_error_t *(*svn_repos_hook_plugin_init_t)
+     (const svn_repos_hook_plugin_t **plugin,
+      void **baton,
+      int abi_version,
+      svn_repos_t *repos,
+      apr_pool_t *pool);
+
+
+/* If ASYNC is true, have svn_repos_fs_commit_txn() put REPOS's
+ * post-commit hook in the repository's post-commit queue, to be run
+ * later by svn_repos_run_post_commit_queue(), rather than run it
+ * before returning.  The default is to run it at once.  */
+void svn_repos_set_post_commit_async (svn_repos_t *repos,
+                                      svn_boolean_t async);
+
+/* What a run of svn_repos_run_post_commit_queue() did. */
+typedef struct svn_repos_hook_queue_stats_t
+{
+  /* The number of hooks that ran successfully, that failed and were
+     left queued for another try, and that failed for the last time. */
+  int run;
+  int retried;
+  int failed;
+
+  /* The number of hooks still queued when the run finished. */
+  int queued;
+
+  /* The total and the longest time the hooks took to run. */
+  apr_interval_time_t total_time;
+  apr_interval_time_t max_time;
+
+  /* The longest time between a revision being queued and its hook
+     running successfully. */
+  apr_interval_time_t max_wait;
+
+} svn_repos_hook_queue_stats_t;
+
+/* Set *DEPTH to the number of post-commit hooks waiting in REPOS's
+ * queue, and *OLDEST to the time the longest-waiting of them was
+ * queued, or 0 if none are.  Use POOL for temporary allocations.  */
+svn_error_t *svn_repos_post_commit_queue_depth (int *depth,
+                                                apr_time_t *oldest,
+                                                svn_repos_t *repos,
+                                                apr_pool_t *pool);
+
+/* Run the post-commit hooks waiting in REPOS's queue, oldest revision
+ * first, on NUM_THREADS threads (each with its own repository
+ * object), and record what happened in *STATS.  Hooks run this way
+ * fail if they exit non-zero.  Each hook that succeeds is removed from
+ * the queue; one that fails is tried again on a later run, until it
+ * has failed MAX_ATTEMPTS times, after which it is set aside for the
+ * administrator.  Only one run at a time is made on a repository;
+ * others wait for it to finish.  Use POOL for temporary allocations.
+ *
+ * When run on several threads, hooks for later revisions may finish
+ * before (or run at the same time as) those for earlier ones.  */
+svn_error_t *svn_repos_run_post_commit_queue
+             (svn_repos_hook_queue_stats_t *stats,
+              svn_repos_t *repos,
+              int num_threads,
+              int max_attempts,
+              apr_pool_t *pool);
+
+
 /* Like svn_fs_commit_txn(), but invoke the REPOS's pre- and
- * post-commit hooks around the commit.  Use TXN's pool for temporary
+ * post-commit hooks around the commit (or queue the post-commit hook;
+ * see svn_repos_set_post_commit_async).  If REPOS has a replication
+ * spool, write the new revision to it before running the post-commit
+ * hook (see svn_repos_spool_revisions).  Use TXN's pool for temporary
  * allocations.
  *
  * CONFLICT_P, NEW_REV, and TXN are as in svn_fs_commit_txn().  */
@@ -458,6 +712,148 @@ svn_error_t *svn_repos_node_editor (const svn_delta_edit_fns_t **editor,
 svn_repos_node_t *svn_repos_node_from_baton (void *edit_baton);
 
 
+
+/* ---------------------------------------------------------------*/
+
+/*** Dumping and loading filesystem data. ***/
+
+/* A dump stream is a portable, self-describing serialization of a
+   range of revisions.  It starts with a format version line and is
+   followed by a sequence of records, each of which is a block of
+   "Name: value" header lines, a blank line, and then exactly
+   Content-length bytes of content.
+
+   A revision record (with a Revision-number header) carries the
+   revision's properties.  It is followed by one node record (with a
+   Node-path header) for each path changed in that revision.  A node
+   record's content is a property list of Prop-content-length bytes,
+   followed by Text-content-length bytes of file text.  Either part
+   may be absent; an absent part means "unchanged".  If Text-delta is
+   "true", the text is an svndiff delta against the node's previous
+   contents rather than a fulltext.
+
+   Property lists are written as in svn_hash_write(), but end with
+   the line "PROPS-END" rather than "END".  */
+
+#define SVN_REPOS_DUMPFILE_MAGIC_HEADER            "SVN-fs-dump-format-version"
+
+/* Version 1 streams hold fulltexts only; version 2 adds Text-delta. */
+#define SVN_REPOS_DUMPFILE_FORMAT_VERSION           2
+
+#define SVN_REPOS_DUMPFILE_REVISION_NUMBER         "Revision-number"
+#define SVN_REPOS_DUMPFILE_NODE_PATH               "Node-path"
+#define SVN_REPOS_DUMPFILE_NODE_KIND               "Node-kind"
+#define SVN_REPOS_DUMPFILE_NODE_ACTION             "Node-action"
+#define SVN_REPOS_DUMPFILE_NODE_COPYFROM_PATH      "Node-copyfrom-path"
+#define SVN_REPOS_DUMPFILE_NODE_COPYFROM_REV       "Node-copyfrom-rev"
+#define SVN_REPOS_DUMPFILE_PROP_CONTENT_LENGTH     "Prop-content-length"
+#define SVN_REPOS_DUMPFILE_TEXT_CONTENT_LENGTH     "Text-content-length"
+#define SVN_REPOS_DUMPFILE_TEXT_DELTA              "Text-delta"
+#define SVN_REPOS_DUMPFILE_CONTENT_LENGTH          "Content-length"
+
+
+/* Write the revisions START_REV through END_REV of REPOS's
+   filesystem to DUMPSTREAM, as a dump stream.  If START_REV is
+   SVN_INVALID_REVNUM, start at revision 0; if END_REV is
+   SVN_INVALID_REVNUM, stop at the youngest revision.
+
+   The first revision dumped contains the whole tree of that revision
+   as additions, so the stream can be loaded into an empty
+   repository.  Copies from revisions before START_REV are dumped as
+   plain additions for the same reason.
+
+   If USE_DELTAS is TRUE, file texts are written as svndiff deltas
+   against the node's previous contents; else they are written in
+   full.
+
+   If FEEDBACK_STREAM is not NULL, write a line to it as each revision
+   is finished.
+
+   Memory use does not grow with the number of revisions or the size
+   of files: file texts are copied through in chunks, and deltas are
+   spooled through a temporary file in the repository directory so
+   that their length can be written ahead of them.  Use POOL for all
+   allocation.  */
+svn_error_t *svn_repos_dump_fs (svn_repos_t *repos,
+                                svn_stream_t *dumpstream,
+                                svn_stream_t *feedback_stream,
+                                svn_revnum_t start_rev,
+                                svn_revnum_t end_rev,
+                                svn_boolean_t use_deltas,
+                                apr_pool_t *pool);
+
+
+/* Read a dump stream from DUMPSTREAM and commit each revision in it
+   to REPOS's filesystem, one transaction per revision.  The new
+   revisions are numbered after the youngest revision already in the
+   filesystem; copy sources are renumbered to match, and the original
+   datestamps are kept.  Repository hooks are not run.
+
+   If FEEDBACK_STREAM is not NULL, write a line to it as each revision
+   is committed.
+
+   The stream is read in chunks; only headers and property lists are
+   held in memory.  Use POOL for all allocation.  */
+svn_error_t *svn_repos_load_fs (svn_repos_t *repos,
+                                svn_stream_t *dumpstream,
+                                svn_stream_t *feedback_stream,
+                                apr_pool_t *pool);
+
+
+
+/* ---------------------------------------------------------------*/
+
+/*** Replication. ***/
+
+/* A master repository can feed any number of read-only replicas, each
+   with a Berkeley DB environment of its own, on the same machine or
+   elsewhere.  Once the master has a spool directory, every commit
+   writes the new revision there, as an incremental dump stream with
+   deltas, in a file named by its revision number.  Replicas are
+   brought up to date by loading the revisions they lack from the
+   spool, in order; they can read it over a network filesystem, which
+   the master's database can't be.  */
+
+/* Give REPOS a replication spool, if it hasn't one already, and write
+   revisions START_REV through END_REV to it.  If START_REV is
+   SVN_INVALID_REVNUM, start at revision 1; if END_REV is
+   SVN_INVALID_REVNUM, stop at the youngest revision.  Revisions
+   already in the spool are written again.
+
+   New replicas start from revision 1, so a master whose spool is
+   created after its first commit should be given its earlier
+   revisions this way.  It is also how to fill in a revision that a
+   commit failed to spool.  Use POOL for all allocations.  */
+svn_error_t *svn_repos_spool_revisions (svn_repos_t *repos,
+                                        svn_revnum_t start_rev,
+                                        svn_revnum_t end_rev,
+                                        apr_pool_t *pool);
+
+/* Bring the replica at REPLICA_PATH up to date from the spool
+   directory SPOOL_PATH, loading each revision after its youngest that
+   the spool has, until one is missing.  If there is nothing at
+   REPLICA_PATH, create a new, empty replica there first; if there is
+   a repository there that is not a replica, fail with
+   SVN_ERR_REPOS_NOT_REPLICA.  Set *YOUNGEST_P to the replica's
+   youngest revision afterwards.
+
+   If FEEDBACK_STREAM is not NULL, write a line to it as each revision
+   is loaded.  Only one replication at a time runs on a replica;
+   others wait for it to finish.  Use POOL for all allocations.  */
+svn_error_t *svn_repos_replicate (svn_revnum_t *youngest_p,
+                                  const char *spool_path,
+                                  const char *replica_path,
+                                  svn_stream_t *feedback_stream,
+                                  apr_pool_t *pool);
+
+/* Remove revisions up to and including THROUGH_REV from the spool
+   directory SPOOL_PATH, once every replica it feeds has them.  Use
+   POOL for temporary allocations.  */
+svn_error_t *svn_repos_prune_spool (const char *spool_path,
+                                    svn_revnum_t through_rev,
+                                    apr_pool_t *pool);
+
+
 
 
 #endif /* SVN_REPOS_H */
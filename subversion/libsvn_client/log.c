@@ -50,6 +50,7 @@ svn_client_log (svn_client_auth_baton_t *auth_baton,
                 const apr_array_header_t *targets,
                 const svn_client_revision_t *start,
                 const svn_client_revision_t *end,
+                int limit,
                 svn_boolean_t discover_changed_paths,
                 svn_log_message_receiver_t receiver,
                 void *receiver_baton,
@@ -160,6 +161,7 @@ svn_client_log (svn_client_auth_baton_t *auth_baton,
                             condensed_targets,
                             start_revnum,
                             end_revnum,
+                            limit,
                             discover_changed_paths,
                             receiver,
                             receiver_baton));
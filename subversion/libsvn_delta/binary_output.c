@@ -0,0 +1,502 @@
+/*
+ * binary_output.c:  output a binary editor drive
+ *
+ * ====================================================================
+ * Copyright (c) 2000-2002 CollabNet.  All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.  The terms
+ * are also available at http://subversion.tigris.org/license-1.html.
+ * If newer versions of this license are posted there, you may use a
+ * newer version instead, at your option.
+ *
+ * This software consists of voluntary contributions made by many
+ * individuals.  For exact contribution history, see the revision
+ * history and logs, available at http://subversion.tigris.org/.
+ * ====================================================================
+ */
+
+#include <string.h>
+#include <assert.h>
+#include "svn_types.h"
+#include "svn_string.h"
+#include "svn_error.h"
+#include "svn_delta.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "delta.h"
+
+/* The format written here is described in delta.h.  Each editor call
+   becomes exactly one record, built up in the edit baton's scratch
+   buffer and handed to the output stream with a single write. */
+
+
+
+struct edit_baton
+{
+  svn_stream_t *output;
+  svn_stringbuf_t *record;      /* Scratch buffer for the current record. */
+  apr_uint64_t next_id;         /* Id to give the next dir or file. */
+  apr_pool_t *pool;
+};
+
+
+/* Directory and file batons are the same shape: just an id. */
+struct node_baton
+{
+  struct edit_baton *edit_baton;
+  apr_uint64_t id;
+  apr_pool_t *pool;
+};
+
+
+
+/*** Record building. ***/
+
+/* Start a new record for command CMD in EB's scratch buffer. */
+static void
+start_record (struct edit_baton *eb, char cmd)
+{
+  svn_stringbuf_setempty (eb->record);
+  svn_stringbuf_appendbytes (eb->record, &cmd, 1);
+}
+
+
+/* Append VAL to the current record using the svndiff variable-length
+   integer encoding: seven data bits per byte, high-order bits first,
+   with the top bit set on all but the last byte. */
+static void
+append_int (struct edit_baton *eb, apr_uint64_t val)
+{
+  char buf[10], *p = buf + sizeof (buf);
+
+  *--p = (char) (val & 0x7f);
+  while ((val >>= 7) != 0)
+    *--p = (char) ((val & 0x7f) | 0x80);
+  svn_stringbuf_appendbytes (eb->record, p, buf + sizeof (buf) - p);
+}
+
+
+/* Append revision number REV, which may be SVN_INVALID_REVNUM. */
+static void
+append_rev (struct edit_baton *eb, svn_revnum_t rev)
+{
+  append_int (eb, SVN_IS_VALID_REVNUM (rev) ? (apr_uint64_t) rev + 1 : 0);
+}
+
+
+/* Append the LEN bytes at DATA as a counted string. */
+static void
+append_bytes (struct edit_baton *eb, const char *data, apr_size_t len)
+{
+  append_int (eb, len);
+  svn_stringbuf_appendbytes (eb->record, data, len);
+}
+
+
+/* Append the C string STR. */
+static void
+append_cstring (struct edit_baton *eb, const char *str)
+{
+  append_bytes (eb, str, strlen (str));
+}
+
+
+/* Append the possibly-NULL C string STR. */
+static void
+append_opt_cstring (struct edit_baton *eb, const char *str)
+{
+  if (str == NULL)
+    append_int (eb, 0);
+  else
+    {
+      apr_size_t len = strlen (str);
+      append_int (eb, (apr_uint64_t) len + 1);
+      svn_stringbuf_appendbytes (eb->record, str, len);
+    }
+}
+
+
+/* Append the possibly-NULL property value VALUE. */
+static void
+append_opt_string (struct edit_baton *eb, const svn_string_t *value)
+{
+  if (value == NULL)
+    append_int (eb, 0);
+  else
+    {
+      append_int (eb, (apr_uint64_t) value->len + 1);
+      svn_stringbuf_appendbytes (eb->record, value->data, value->len);
+    }
+}
+
+
+/* Write the current record to EB's output stream. */
+static svn_error_t *
+finish_record (struct edit_baton *eb)
+{
+  apr_size_t len = eb->record->len;
+
+  return svn_stream_write (eb->output, eb->record->data, &len);
+}
+
+
+static struct node_baton *
+make_node_baton (struct edit_baton *eb, apr_pool_t *pool)
+{
+  struct node_baton *nb = apr_palloc (pool, sizeof (*nb));
+
+  nb->edit_baton = eb;
+  nb->id = eb->next_id++;
+  nb->pool = pool;
+  return nb;
+}
+
+
+
+/*** Editor functions. ***/
+
+static svn_error_t *
+set_target_revision (void *edit_baton,
+                     svn_revnum_t target_revision)
+{
+  struct edit_baton *eb = edit_baton;
+
+  start_record (eb, SVN_DELTA__BINARY_SET_TARGET_REV);
+  append_rev (eb, target_revision);
+  return finish_record (eb);
+}
+
+
+static svn_error_t *
+open_root (void *edit_baton,
+           svn_revnum_t base_revision,
+           apr_pool_t *pool,
+           void **root_baton)
+{
+  struct edit_baton *eb = edit_baton;
+  struct node_baton *nb = make_node_baton (eb, pool);
+
+  start_record (eb, SVN_DELTA__BINARY_OPEN_ROOT);
+  append_rev (eb, base_revision);
+  append_int (eb, nb->id);
+
+  *root_baton = nb;
+  return finish_record (eb);
+}
+
+
+static svn_error_t *
+delete_entry (const char *path,
+              svn_revnum_t revision,
+              void *parent_baton,
+              apr_pool_t *pool)
+{
+  struct node_baton *pb = parent_baton;
+  struct edit_baton *eb = pb->edit_baton;
+
+  start_record (eb, SVN_DELTA__BINARY_DELETE_ENTRY);
+  append_int (eb, pb->id);
+  append_cstring (eb, path);
+  append_rev (eb, revision);
+  return finish_record (eb);
+}
+
+
+/* Write an add_directory or add_file record (CMD) and set *CHILD_BATON
+   to a new node baton allocated in POOL. */
+static svn_error_t *
+output_add (char cmd,
+            const char *path,
+            struct node_baton *pb,
+            const char *copyfrom_path,
+            svn_revnum_t copyfrom_revision,
+            apr_pool_t *pool,
+            void **child_baton)
+{
+  struct edit_baton *eb = pb->edit_baton;
+  struct node_baton *nb = make_node_baton (eb, pool);
+
+  start_record (eb, cmd);
+  append_int (eb, pb->id);
+  append_cstring (eb, path);
+  append_opt_cstring (eb, copyfrom_path);
+  append_rev (eb, copyfrom_revision);
+  append_int (eb, nb->id);
+
+  *child_baton = nb;
+  return finish_record (eb);
+}
+
+
+/* Write an open_directory or open_file record (CMD) and set
+   *CHILD_BATON to a new node baton allocated in POOL. */
+static svn_error_t *
+output_open (char cmd,
+             const char *path,
+             struct node_baton *pb,
+             svn_revnum_t base_revision,
+             apr_pool_t *pool,
+             void **child_baton)
+{
+  struct edit_baton *eb = pb->edit_baton;
+  struct node_baton *nb = make_node_baton (eb, pool);
+
+  start_record (eb, cmd);
+  append_int (eb, pb->id);
+  append_cstring (eb, path);
+  append_rev (eb, base_revision);
+  append_int (eb, nb->id);
+
+  *child_baton = nb;
+  return finish_record (eb);
+}
+
+
+/* Write a change_dir_prop or change_file_prop record (CMD). */
+static svn_error_t *
+output_propset (char cmd,
+                struct node_baton *nb,
+                const char *name,
+                const svn_string_t *value)
+{
+  struct edit_baton *eb = nb->edit_baton;
+
+  start_record (eb, cmd);
+  append_int (eb, nb->id);
+  append_cstring (eb, name);
+  append_opt_string (eb, value);
+  return finish_record (eb);
+}
+
+
+/* Write a close_directory or close_file record (CMD). */
+static svn_error_t *
+output_close (char cmd, struct node_baton *nb)
+{
+  struct edit_baton *eb = nb->edit_baton;
+
+  start_record (eb, cmd);
+  append_int (eb, nb->id);
+  return finish_record (eb);
+}
+
+
+static svn_error_t *
+add_directory (const char *path,
+               void *parent_baton,
+               const char *copyfrom_path,
+               svn_revnum_t copyfrom_revision,
+               apr_pool_t *pool,
+               void **child_baton)
+{
+  return output_add (SVN_DELTA__BINARY_ADD_DIR, path, parent_baton,
+                     copyfrom_path, copyfrom_revision, pool, child_baton);
+}
+
+
+static svn_error_t *
+open_directory (const char *path,
+                void *parent_baton,
+                svn_revnum_t base_revision,
+                apr_pool_t *pool,
+                void **child_baton)
+{
+  return output_open (SVN_DELTA__BINARY_OPEN_DIR, path, parent_baton,
+                      base_revision, pool, child_baton);
+}
+
+
+static svn_error_t *
+change_dir_prop (void *dir_baton,
+                 const char *name,
+                 const svn_string_t *value,
+                 apr_pool_t *pool)
+{
+  return output_propset (SVN_DELTA__BINARY_CHANGE_DIR_PROP,
+                         dir_baton, name, value);
+}
+
+
+static svn_error_t *
+close_directory (void *dir_baton)
+{
+  return output_close (SVN_DELTA__BINARY_CLOSE_DIR, dir_baton);
+}
+
+
+static svn_error_t *
+add_file (const char *path,
+          void *parent_baton,
+          const char *copyfrom_path,
+          svn_revnum_t copyfrom_revision,
+          apr_pool_t *pool,
+          void **file_baton)
+{
+  return output_add (SVN_DELTA__BINARY_ADD_FILE, path, parent_baton,
+                     copyfrom_path, copyfrom_revision, pool, file_baton);
+}
+
+
+static svn_error_t *
+open_file (const char *path,
+           void *parent_baton,
+           svn_revnum_t base_revision,
+           apr_pool_t *pool,
+           void **file_baton)
+{
+  return output_open (SVN_DELTA__BINARY_OPEN_FILE, path, parent_baton,
+                      base_revision, pool, file_baton);
+}
+
+
+/* Write handler for the svndiff data of a text delta: wrap each
+   chunk of svndiff in a TEXTDELTA_CHUNK record.  The data is written
+   straight through after the record header, without copying. */
+static svn_error_t *
+output_svndiff_data (void *baton,
+                     const char *data,
+                     apr_size_t *len)
+{
+  struct node_baton *fb = baton;
+  struct edit_baton *eb = fb->edit_baton;
+  apr_size_t write_len = *len;
+
+  start_record (eb, SVN_DELTA__BINARY_TEXTDELTA_CHUNK);
+  append_int (eb, fb->id);
+  append_int (eb, *len);
+  SVN_ERR (finish_record (eb));
+  return svn_stream_write (eb->output, data, &write_len);
+}
+
+
+/* Close handler for the svndiff data of a text delta. */
+static svn_error_t *
+finish_svndiff_data (void *baton)
+{
+  return output_close (SVN_DELTA__BINARY_TEXTDELTA_END, baton);
+}
+
+
+static svn_error_t *
+apply_textdelta (void *file_baton,
+                 svn_txdelta_window_handler_t *handler,
+                 void **handler_baton)
+{
+  struct node_baton *fb = file_baton;
+  struct edit_baton *eb = fb->edit_baton;
+  svn_stream_t *output;
+
+  SVN_ERR (output_close (SVN_DELTA__BINARY_APPLY_TEXTDELTA, fb));
+
+  /* Set up a handler which will write svndiff data, wrapped in
+     chunk records, to the editor's output stream.  It lives in the
+     file's pool, so that a drive touching many files doesn't pile up
+     svndiff state for the whole edit.  */
+  output = svn_stream_create (fb, fb->pool);
+  svn_stream_set_write (output, output_svndiff_data);
+  svn_stream_set_close (output, finish_svndiff_data);
+  svn_txdelta_to_svndiff (output, fb->pool, handler, handler_baton);
+
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+change_file_prop (void *file_baton,
+                  const char *name,
+                  const svn_string_t *value,
+                  apr_pool_t *pool)
+{
+  return output_propset (SVN_DELTA__BINARY_CHANGE_FILE_PROP,
+                         file_baton, name, value);
+}
+
+
+static svn_error_t *
+close_file (void *file_baton)
+{
+  return output_close (SVN_DELTA__BINARY_CLOSE_FILE, file_baton);
+}
+
+
+/* Write the final record CMD, close the output and free EB. */
+static svn_error_t *
+output_finish (struct edit_baton *eb, char cmd)
+{
+  svn_error_t *err;
+
+  start_record (eb, cmd);
+  err = finish_record (eb);
+  if (err == SVN_NO_ERROR)
+    err = svn_stream_close (eb->output);
+  svn_pool_destroy (eb->pool);
+  return err;
+}
+
+
+static svn_error_t *
+close_edit (void *edit_baton)
+{
+  return output_finish (edit_baton, SVN_DELTA__BINARY_CLOSE_EDIT);
+}
+
+
+static svn_error_t *
+abort_edit (void *edit_baton)
+{
+  return output_finish (edit_baton, SVN_DELTA__BINARY_ABORT_EDIT);
+}
+
+
+svn_error_t *
+svn_delta_get_binary_editor (svn_stream_t *output,
+                             const svn_delta_editor_t **editor,
+                             void **edit_baton,
+                             apr_pool_t *pool)
+{
+  struct edit_baton *eb;
+  apr_pool_t *subpool = svn_pool_create (pool);
+  svn_delta_editor_t *tree_editor = svn_delta_default_editor (pool);
+  apr_size_t len = 4;
+
+  /* Write the header right away, so that even an empty drive is
+     recognizable. */
+  SVN_ERR (svn_stream_write (output, SVN_DELTA__BINARY_MAGIC, &len));
+
+  /* Construct an edit baton. */
+  eb = apr_palloc (subpool, sizeof (*eb));
+  eb->pool = subpool;
+  eb->output = output;
+  eb->record = svn_stringbuf_create ("", subpool);
+  eb->next_id = 0;
+
+  /* Construct an editor. */
+  tree_editor->set_target_revision = set_target_revision;
+  tree_editor->open_root = open_root;
+  tree_editor->delete_entry = delete_entry;
+  tree_editor->add_directory = add_directory;
+  tree_editor->open_directory = open_directory;
+  tree_editor->change_dir_prop = change_dir_prop;
+  tree_editor->close_directory = close_directory;
+  tree_editor->add_file = add_file;
+  tree_editor->open_file = open_file;
+  tree_editor->apply_textdelta = apply_textdelta;
+  tree_editor->change_file_prop = change_file_prop;
+  tree_editor->close_file = close_file;
+  tree_editor->close_edit = close_edit;
+  tree_editor->abort_edit = abort_edit;
+
+  *edit_baton = eb;
+  *editor = tree_editor;
+
+  return SVN_NO_ERROR;
+}
+
+
+
+/*
+ * local variables:
+ * eval: (load-file "../../tools/dev/svn-dev.el")
+ * end:
+ */
@@ -0,0 +1,618 @@
+/*
+ * binary_parse.c:  replay a binary editor drive into an editor
+ *
+ * ====================================================================
+ * Copyright (c) 2000-2002 CollabNet.  All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.  The terms
+ * are also available at http://subversion.tigris.org/license-1.html.
+ * If newer versions of this license are posted there, you may use a
+ * newer version instead, at your option.
+ *
+ * This software consists of voluntary contributions made by many
+ * individuals.  For exact contribution history, see the revision
+ * history and logs, available at http://subversion.tigris.org/.
+ * ====================================================================
+ */
+
+#include <string.h>
+#include "apr_hash.h"
+#include "svn_types.h"
+#include "svn_string.h"
+#include "svn_error.h"
+#include "svn_delta.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "delta.h"
+
+/* The format read here is described in delta.h. */
+
+
+
+/* An open directory or file in the drive being replayed. */
+struct node
+{
+  apr_uint64_t id;              /* The id the drive uses for this node. */
+  void *baton;                  /* The baton the target editor gave us. */
+  apr_pool_t *pool;             /* The pool we gave the target editor. */
+  svn_stream_t *svndiff;        /* svndiff parser for a text delta in
+                                   progress, or NULL.  */
+};
+
+
+struct parse_baton
+{
+  /* Where the drive comes from, and a read buffer over it. */
+  svn_stream_t *source;
+  char *buf;
+  apr_size_t buf_pos;
+  apr_size_t buf_len;
+
+  /* The editor we are driving. */
+  const svn_delta_editor_t *editor;
+  void *edit_baton;
+
+  /* All open nodes, keyed on their id. */
+  apr_hash_t *nodes;
+
+  /* POOL holds the parser and every node's pool.  SCRATCH is cleared
+     after each record. */
+  apr_pool_t *pool;
+  apr_pool_t *scratch;
+};
+
+
+/* Helper for errors about malformed input. */
+static svn_error_t *
+corrupt (struct parse_baton *pb, const char *msg)
+{
+  return svn_error_create (SVN_ERR_EDITOR_DRIVE_CORRUPT, 0, NULL,
+                           pb->pool, msg);
+}
+
+
+
+/*** Reading primitives. ***/
+
+/* Make sure PB's buffer holds at least one unread byte, reading more
+   from the source if needed.  Return an error if the source is
+   exhausted. */
+static svn_error_t *
+fill_buffer (struct parse_baton *pb)
+{
+  if (pb->buf_pos < pb->buf_len)
+    return SVN_NO_ERROR;
+
+  pb->buf_pos = 0;
+  pb->buf_len = SVN_STREAM_CHUNK_SIZE;
+  SVN_ERR (svn_stream_read (pb->source, pb->buf, &pb->buf_len));
+  if (pb->buf_len == 0)
+    return svn_error_create (SVN_ERR_EDITOR_DRIVE_UNEXPECTED_END, 0, NULL,
+                             pb->pool, "editor drive ended unexpectedly");
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+read_byte (struct parse_baton *pb, unsigned char *c)
+{
+  SVN_ERR (fill_buffer (pb));
+  *c = (unsigned char) pb->buf[pb->buf_pos++];
+  return SVN_NO_ERROR;
+}
+
+
+/* Read LEN bytes into DATA. */
+static svn_error_t *
+read_data (struct parse_baton *pb, char *data, apr_size_t len)
+{
+  while (len > 0)
+    {
+      apr_size_t n;
+
+      SVN_ERR (fill_buffer (pb));
+      n = pb->buf_len - pb->buf_pos;
+      if (n > len)
+        n = len;
+      memcpy (data, pb->buf + pb->buf_pos, n);
+      pb->buf_pos += n;
+      data += n;
+      len -= n;
+    }
+  return SVN_NO_ERROR;
+}
+
+
+/* Read a variable-length integer; see append_int in binary_output.c. */
+static svn_error_t *
+read_int (struct parse_baton *pb, apr_uint64_t *val)
+{
+  unsigned char c;
+  int i;
+
+  *val = 0;
+  for (i = 0; i < 10; i++)
+    {
+      SVN_ERR (read_byte (pb, &c));
+      *val = (*val << 7) | (c & 0x7f);
+      if ((c & 0x80) == 0)
+        return SVN_NO_ERROR;
+    }
+  return corrupt (pb, "integer too long in editor drive");
+}
+
+
+static svn_error_t *
+read_rev (struct parse_baton *pb, svn_revnum_t *rev)
+{
+  apr_uint64_t val;
+
+  SVN_ERR (read_int (pb, &val));
+  *rev = (val == 0) ? SVN_INVALID_REVNUM : (svn_revnum_t) (val - 1);
+  return SVN_NO_ERROR;
+}
+
+
+/* Read a string of LEN bytes into a new null-terminated string
+   allocated in PB's scratch pool, and return it in *STR. */
+static svn_error_t *
+read_counted_string (struct parse_baton *pb,
+                     svn_string_t **str,
+                     apr_uint64_t len)
+{
+  char *data;
+
+  if (len != (apr_size_t) len)
+    return corrupt (pb, "string too long in editor drive");
+
+  data = apr_palloc (pb->scratch, (apr_size_t) len + 1);
+  SVN_ERR (read_data (pb, data, (apr_size_t) len));
+  data[len] = '\0';
+
+  *str = apr_palloc (pb->scratch, sizeof (**str));
+  (*str)->data = data;
+  (*str)->len = (apr_size_t) len;
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+read_cstring (struct parse_baton *pb, const char **str)
+{
+  apr_uint64_t len;
+  svn_string_t *s;
+
+  SVN_ERR (read_int (pb, &len));
+  SVN_ERR (read_counted_string (pb, &s, len));
+  *str = s->data;
+  return SVN_NO_ERROR;
+}
+
+
+/* Read a string which may be absent; set *STR to NULL if it is. */
+static svn_error_t *
+read_opt_string (struct parse_baton *pb, svn_string_t **str)
+{
+  apr_uint64_t len;
+
+  SVN_ERR (read_int (pb, &len));
+  if (len == 0)
+    *str = NULL;
+  else
+    SVN_ERR (read_counted_string (pb, str, len - 1));
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+read_opt_cstring (struct parse_baton *pb, const char **str)
+{
+  svn_string_t *s;
+
+  SVN_ERR (read_opt_string (pb, &s));
+  *str = s ? s->data : NULL;
+  return SVN_NO_ERROR;
+}
+
+
+
+/*** Nodes. ***/
+
+/* Read a node id and set *NODE to the open node it names. */
+static svn_error_t *
+read_node (struct parse_baton *pb, struct node **node)
+{
+  apr_uint64_t id;
+
+  SVN_ERR (read_int (pb, &id));
+  *node = apr_hash_get (pb->nodes, &id, sizeof (id));
+  if (*node == NULL)
+    return corrupt (pb, "editor drive refers to an unknown directory "
+                    "or file");
+  return SVN_NO_ERROR;
+}
+
+
+/* Read the id of a node that is about to be opened, and set *NODE to
+   a new node for it with its own pool.  The node is not registered
+   until add_node is called, once the target editor has given us a
+   baton for it. */
+static svn_error_t *
+read_new_node (struct parse_baton *pb, struct node **node)
+{
+  apr_uint64_t id;
+  apr_pool_t *pool;
+
+  SVN_ERR (read_int (pb, &id));
+  if (apr_hash_get (pb->nodes, &id, sizeof (id)) != NULL)
+    return corrupt (pb, "editor drive reuses an open directory or file id");
+
+  pool = svn_pool_create (pb->pool);
+  *node = apr_palloc (pool, sizeof (**node));
+  (*node)->id = id;
+  (*node)->baton = NULL;
+  (*node)->pool = pool;
+  (*node)->svndiff = NULL;
+  return SVN_NO_ERROR;
+}
+
+
+static void
+add_node (struct parse_baton *pb, struct node *node)
+{
+  apr_hash_set (pb->nodes, &node->id, sizeof (node->id), node);
+}
+
+
+/* Forget NODE and free its pool. */
+static void
+remove_node (struct parse_baton *pb, struct node *node)
+{
+  apr_hash_set (pb->nodes, &node->id, sizeof (node->id), NULL);
+  svn_pool_destroy (node->pool);
+}
+
+
+
+/*** Records. ***/
+
+static svn_error_t *
+parse_open_root (struct parse_baton *pb)
+{
+  svn_revnum_t base_revision;
+  struct node *node;
+
+  SVN_ERR (read_rev (pb, &base_revision));
+  SVN_ERR (read_new_node (pb, &node));
+  SVN_ERR (pb->editor->open_root (pb->edit_baton, base_revision,
+                                  node->pool, &node->baton));
+  add_node (pb, node);
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+parse_delete_entry (struct parse_baton *pb)
+{
+  struct node *parent;
+  const char *path;
+  svn_revnum_t revision;
+
+  SVN_ERR (read_node (pb, &parent));
+  SVN_ERR (read_cstring (pb, &path));
+  SVN_ERR (read_rev (pb, &revision));
+  return pb->editor->delete_entry (path, revision, parent->baton,
+                                   pb->scratch);
+}
+
+
+/* Handle an add_directory or add_file record, as given by IS_DIR. */
+static svn_error_t *
+parse_add (struct parse_baton *pb, svn_boolean_t is_dir)
+{
+  struct node *parent, *node;
+  const char *path, *copyfrom_path;
+  svn_revnum_t copyfrom_revision;
+
+  SVN_ERR (read_node (pb, &parent));
+  SVN_ERR (read_cstring (pb, &path));
+  SVN_ERR (read_opt_cstring (pb, &copyfrom_path));
+  SVN_ERR (read_rev (pb, &copyfrom_revision));
+  SVN_ERR (read_new_node (pb, &node));
+
+  if (is_dir)
+    SVN_ERR (pb->editor->add_directory (path, parent->baton,
+                                        copyfrom_path, copyfrom_revision,
+                                        node->pool, &node->baton));
+  else
+    SVN_ERR (pb->editor->add_file (path, parent->baton,
+                                   copyfrom_path, copyfrom_revision,
+                                   node->pool, &node->baton));
+  add_node (pb, node);
+  return SVN_NO_ERROR;
+}
+
+
+/* Handle an open_directory or open_file record, as given by IS_DIR. */
+static svn_error_t *
+parse_open (struct parse_baton *pb, svn_boolean_t is_dir)
+{
+  struct node *parent, *node;
+  const char *path;
+  svn_revnum_t base_revision;
+
+  SVN_ERR (read_node (pb, &parent));
+  SVN_ERR (read_cstring (pb, &path));
+  SVN_ERR (read_rev (pb, &base_revision));
+  SVN_ERR (read_new_node (pb, &node));
+
+  if (is_dir)
+    SVN_ERR (pb->editor->open_directory (path, parent->baton, base_revision,
+                                         node->pool, &node->baton));
+  else
+    SVN_ERR (pb->editor->open_file (path, parent->baton, base_revision,
+                                    node->pool, &node->baton));
+  add_node (pb, node);
+  return SVN_NO_ERROR;
+}
+
+
+/* Handle a change_dir_prop or change_file_prop record. */
+static svn_error_t *
+parse_propset (struct parse_baton *pb, svn_boolean_t is_dir)
+{
+  struct node *node;
+  const char *name;
+  svn_string_t *value;
+
+  SVN_ERR (read_node (pb, &node));
+  SVN_ERR (read_cstring (pb, &name));
+  SVN_ERR (read_opt_string (pb, &value));
+
+  if (is_dir)
+    return pb->editor->change_dir_prop (node->baton, name, value,
+                                        pb->scratch);
+  else
+    return pb->editor->change_file_prop (node->baton, name, value,
+                                         pb->scratch);
+}
+
+
+/* Handle a close_directory or close_file record. */
+static svn_error_t *
+parse_close (struct parse_baton *pb, svn_boolean_t is_dir)
+{
+  struct node *node;
+
+  SVN_ERR (read_node (pb, &node));
+  if (node->svndiff)
+    return corrupt (pb, "editor drive closes a file in the middle of "
+                    "a text delta");
+
+  if (is_dir)
+    SVN_ERR (pb->editor->close_directory (node->baton));
+  else
+    SVN_ERR (pb->editor->close_file (node->baton));
+
+  remove_node (pb, node);
+  return SVN_NO_ERROR;
+}
+
+
+/* Write handler which throws away text delta data nobody wants. */
+static svn_error_t *
+discard_data (void *baton, const char *data, apr_size_t *len)
+{
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+parse_apply_textdelta (struct parse_baton *pb)
+{
+  struct node *node;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+
+  SVN_ERR (read_node (pb, &node));
+  if (node->svndiff)
+    return corrupt (pb, "editor drive starts a second text delta "
+                    "for a file");
+
+  SVN_ERR (pb->editor->apply_textdelta (node->baton,
+                                        &handler, &handler_baton));
+
+  /* If the editor isn't interested in the delta, we still have to
+     get past its data. */
+  if (handler)
+    node->svndiff = svn_txdelta_parse_svndiff (handler, handler_baton,
+                                               TRUE, node->pool);
+  else
+    {
+      node->svndiff = svn_stream_create (NULL, node->pool);
+      svn_stream_set_write (node->svndiff, discard_data);
+    }
+  return SVN_NO_ERROR;
+}
+
+
+/* Pass the data of a text delta chunk record straight from the read
+   buffer to the file's svndiff parser. */
+static svn_error_t *
+parse_textdelta_chunk (struct parse_baton *pb)
+{
+  struct node *node;
+  apr_uint64_t len;
+
+  SVN_ERR (read_node (pb, &node));
+  SVN_ERR (read_int (pb, &len));
+  if (! node->svndiff)
+    return corrupt (pb, "editor drive has text delta data outside "
+                    "a text delta");
+
+  while (len > 0)
+    {
+      apr_size_t n, write_len;
+
+      SVN_ERR (fill_buffer (pb));
+      n = pb->buf_len - pb->buf_pos;
+      if (n > len)
+        n = (apr_size_t) len;
+
+      /* The svndiff parser doesn't leave WRITE_LEN alone, so keep
+         our own count. */
+      write_len = n;
+      SVN_ERR (svn_stream_write (node->svndiff, pb->buf + pb->buf_pos,
+                                 &write_len));
+      pb->buf_pos += n;
+      len -= n;
+    }
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+parse_textdelta_end (struct parse_baton *pb)
+{
+  struct node *node;
+  svn_stream_t *svndiff;
+
+  SVN_ERR (read_node (pb, &node));
+  if (! node->svndiff)
+    return corrupt (pb, "editor drive ends a text delta that was "
+                    "never started");
+
+  svndiff = node->svndiff;
+  node->svndiff = NULL;
+  return svn_stream_close (svndiff);
+}
+
+
+
+/* Check the header of PB's drive, then replay its records into PB's
+   editor up to and including the final close_edit or abort_edit. */
+static svn_error_t *
+parse_drive (struct parse_baton *pb)
+{
+  char header[4];
+
+  SVN_ERR (read_data (pb, header, sizeof (header)));
+  if (memcmp (header, SVN_DELTA__BINARY_MAGIC, sizeof (header)) != 0)
+    return svn_error_create (SVN_ERR_EDITOR_DRIVE_INVALID_HEADER, 0, NULL,
+                             pb->pool, "editor drive has invalid header");
+
+  for (;;)
+    {
+      unsigned char cmd;
+      svn_revnum_t revision;
+
+      SVN_ERR (read_byte (pb, &cmd));
+      switch (cmd)
+        {
+        case SVN_DELTA__BINARY_SET_TARGET_REV:
+          SVN_ERR (read_rev (pb, &revision));
+          SVN_ERR (pb->editor->set_target_revision (pb->edit_baton,
+                                                    revision));
+          break;
+
+        case SVN_DELTA__BINARY_OPEN_ROOT:
+          SVN_ERR (parse_open_root (pb));
+          break;
+
+        case SVN_DELTA__BINARY_DELETE_ENTRY:
+          SVN_ERR (parse_delete_entry (pb));
+          break;
+
+        case SVN_DELTA__BINARY_ADD_DIR:
+          SVN_ERR (parse_add (pb, TRUE));
+          break;
+
+        case SVN_DELTA__BINARY_OPEN_DIR:
+          SVN_ERR (parse_open (pb, TRUE));
+          break;
+
+        case SVN_DELTA__BINARY_CHANGE_DIR_PROP:
+          SVN_ERR (parse_propset (pb, TRUE));
+          break;
+
+        case SVN_DELTA__BINARY_CLOSE_DIR:
+          SVN_ERR (parse_close (pb, TRUE));
+          break;
+
+        case SVN_DELTA__BINARY_ADD_FILE:
+          SVN_ERR (parse_add (pb, FALSE));
+          break;
+
+        case SVN_DELTA__BINARY_OPEN_FILE:
+          SVN_ERR (parse_open (pb, FALSE));
+          break;
+
+        case SVN_DELTA__BINARY_APPLY_TEXTDELTA:
+          SVN_ERR (parse_apply_textdelta (pb));
+          break;
+
+        case SVN_DELTA__BINARY_TEXTDELTA_CHUNK:
+          SVN_ERR (parse_textdelta_chunk (pb));
+          break;
+
+        case SVN_DELTA__BINARY_TEXTDELTA_END:
+          SVN_ERR (parse_textdelta_end (pb));
+          break;
+
+        case SVN_DELTA__BINARY_CHANGE_FILE_PROP:
+          SVN_ERR (parse_propset (pb, FALSE));
+          break;
+
+        case SVN_DELTA__BINARY_CLOSE_FILE:
+          SVN_ERR (parse_close (pb, FALSE));
+          break;
+
+        case SVN_DELTA__BINARY_CLOSE_EDIT:
+          return pb->editor->close_edit (pb->edit_baton);
+
+        case SVN_DELTA__BINARY_ABORT_EDIT:
+          return pb->editor->abort_edit (pb->edit_baton);
+
+        default:
+          return corrupt (pb, "unknown command in editor drive");
+        }
+
+      svn_pool_clear (pb->scratch);
+    }
+}
+
+
+svn_error_t *
+svn_delta_binary_parse (svn_stream_t *source,
+                        const svn_delta_editor_t *editor,
+                        void *edit_baton,
+                        apr_pool_t *pool)
+{
+  apr_pool_t *subpool = svn_pool_create (pool);
+  struct parse_baton *pb = apr_palloc (subpool, sizeof (*pb));
+  svn_error_t *err;
+
+  pb->source = source;
+  pb->buf = apr_palloc (subpool, SVN_STREAM_CHUNK_SIZE);
+  pb->buf_pos = 0;
+  pb->buf_len = 0;
+  pb->editor = editor;
+  pb->edit_baton = edit_baton;
+  pb->nodes = apr_hash_make (subpool);
+  pb->pool = subpool;
+  pb->scratch = svn_pool_create (subpool);
+
+  /* Our errors live in the error pool, so they survive SUBPOOL. */
+  err = parse_drive (pb);
+  svn_pool_destroy (subpool);
+  return err;
+}
+
+
+
+/*
+ * local variables:
+ * eval: (load-file "../../tools/dev/svn-dev.el")
+ * end:
+ */
@@ -0,0 +1,531 @@
+/*
+ * compose_delta.c:  Delta window composition.
+ *
+ * ====================================================================
+ * Copyright (c) 2000-2002 CollabNet.  All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.  The terms
+ * are also available at http://subversion.tigris.org/license-1.html.
+ * If newer versions of this license are posted there, you may use a
+ * newer version instead, at your option.
+ *
+ * This software consists of voluntary contributions made by many
+ * individuals.  For exact contribution history, see the revision
+ * history and logs, available at http://subversion.tigris.org/.
+ * ====================================================================
+ */
+
+
+#include <assert.h>
+#include <string.h>
+
+#include <apr_general.h>        /* For APR_INLINE */
+
+#include "svn_delta.h"
+#include "svn_pools.h"
+#include "delta.h"
+
+
+/* Composition works purely on instruction lists.  Given a window A
+   that produces some stretch of an intermediate text, and a window B
+   whose source view lies over that intermediate text, every source
+   instruction in B names a range of A's target view.  We find the A
+   instructions which produced that range and copy them (trimmed to
+   fit) into the composite window.  A's target-copy instructions refer
+   back into A's own target view, so they are resolved recursively
+   until only source and new-data instructions remain.  B's own
+   target-copy and new-data instructions pass through unchanged.  */
+
+
+
+/* Offset index: for each instruction in a window, the offset in the
+   target view at which that instruction starts.  OFFS has
+   window->num_ops + 1 elements; the last one is the target view
+   length.  */
+typedef struct offset_index_t
+{
+  int length;
+  apr_size_t *offs;
+} offset_index_t;
+
+
+/* Build an offset index for WINDOW in POOL. */
+static offset_index_t *
+create_offset_index (const svn_txdelta_window_t *window, apr_pool_t *pool)
+{
+  offset_index_t *ndx = apr_palloc (pool, sizeof (*ndx));
+  apr_size_t offset = 0;
+  int i;
+
+  ndx->length = window->num_ops;
+  ndx->offs = apr_palloc (pool, (ndx->length + 1) * sizeof (*ndx->offs));
+
+  for (i = 0; i < ndx->length; ++i)
+    {
+      ndx->offs[i] = offset;
+      offset += window->ops[i].length;
+    }
+  ndx->offs[ndx->length] = offset;
+
+  return ndx;
+}
+
+
+/* Return the index of the instruction in NDX that produces the byte
+   at target view OFFSET.  OFFSET must be less than the target view
+   length.  */
+static int
+search_offset_index (const offset_index_t *ndx, apr_size_t offset)
+{
+  int lo = 0, hi = ndx->length - 1;
+
+  assert (offset < ndx->offs[ndx->length]);
+
+  /* Find the last instruction that starts at or before OFFSET.  */
+  while (lo < hi)
+    {
+      const int op = (lo + hi + 1) / 2;
+      if (ndx->offs[op] <= offset)
+        lo = op;
+      else
+        hi = op - 1;
+    }
+
+  assert (ndx->offs[lo] <= offset && offset < ndx->offs[lo + 1]);
+  return lo;
+}
+
+
+
+/* Append an instruction to the window being built in BOB, merging it
+   with the previous instruction when both are of the same kind and
+   contiguous.  Arguments are as for svn_txdelta__insert_op.  */
+static void
+push_op (struct build_ops_baton_t *bob,
+         enum svn_delta_action opcode,
+         apr_off_t offset,
+         apr_off_t length,
+         const char *new_data,
+         apr_pool_t *pool)
+{
+  if (length == 0)
+    return;
+
+  if (bob->num_ops > 0)
+    {
+      svn_txdelta_op_t *const last = &bob->ops[bob->num_ops - 1];
+
+      if (last->action_code == opcode)
+        {
+          if (opcode == svn_txdelta_new)
+            {
+              /* New data is always appended in order, so consecutive
+                 new-data instructions are always contiguous. */
+              svn_stringbuf_appendbytes (bob->new_data, new_data, length);
+              last->length += length;
+              return;
+            }
+          else if (last->offset + last->length == offset)
+            {
+              last->length += length;
+              return;
+            }
+        }
+    }
+
+  svn_txdelta__insert_op (bob, opcode, offset, length, new_data, pool);
+}
+
+
+/* Copy to BOB the instructions of WINDOW (indexed by NDX) that
+   produce bytes OFFSET up to LIMIT of WINDOW's target view.  Source
+   offsets are shifted by SOURCE_DELTA, so that they are relative to
+   the composite window's source view.  Allocate in POOL.  */
+static void
+copy_source_ops (apr_size_t offset,
+                 apr_size_t limit,
+                 const svn_txdelta_window_t *window,
+                 const offset_index_t *ndx,
+                 apr_off_t source_delta,
+                 struct build_ops_baton_t *bob,
+                 apr_pool_t *pool)
+{
+  int op_ndx;
+
+  if (offset >= limit)
+    return;
+
+  for (op_ndx = search_offset_index (ndx, offset);
+       offset < limit;
+       ++op_ndx)
+    {
+      const svn_txdelta_op_t *const op = &window->ops[op_ndx];
+      const apr_size_t op_start = ndx->offs[op_ndx];
+      const apr_size_t op_limit = ndx->offs[op_ndx + 1];
+      const apr_size_t fix_offset = offset - op_start;
+      const apr_size_t fix_limit =
+        (limit < op_limit ? limit : op_limit) - op_start;
+
+      switch (op->action_code)
+        {
+        case svn_txdelta_source:
+          push_op (bob, svn_txdelta_source,
+                   op->offset + fix_offset + source_delta,
+                   fix_limit - fix_offset, NULL, pool);
+          break;
+
+        case svn_txdelta_new:
+          push_op (bob, svn_txdelta_new, 0,
+                   fix_limit - fix_offset,
+                   window->new_data->data + op->offset + fix_offset,
+                   pool);
+          break;
+
+        case svn_txdelta_target:
+          {
+            /* The byte at OP_START + K is the byte at OP->OFFSET + K.
+               When the copy overlaps itself, that byte may be one this
+               same instruction produced, so the source repeats with a
+               period of OP_START - OP->OFFSET.  Map each stretch back
+               into the part of the target view that precedes this
+               instruction, and resolve it there.  */
+            const apr_size_t period = op_start - op->offset;
+            apr_size_t k = fix_offset;
+
+            assert (op->offset < op_start);
+            while (k < fix_limit)
+              {
+                const apr_size_t from = op->offset + k % period;
+                apr_size_t len = period - k % period;
+
+                if (len > fix_limit - k)
+                  len = fix_limit - k;
+                copy_source_ops (from, from + len, window, ndx,
+                                 source_delta, bob, pool);
+                k += len;
+              }
+          }
+          break;
+
+        default:
+          assert (!"unknown delta op.");
+        }
+
+      offset = op_start + fix_limit;
+    }
+}
+
+
+
+svn_txdelta_window_t *
+svn_txdelta_window_dup (const svn_txdelta_window_t *window,
+                        apr_pool_t *pool)
+{
+  svn_txdelta_window_t *new_window = apr_palloc (pool, sizeof (*new_window));
+  svn_txdelta_op_t *ops = apr_palloc (pool, (window->num_ops
+                                             * sizeof (*ops)));
+
+  memcpy (ops, window->ops, window->num_ops * sizeof (*ops));
+  *new_window = *window;
+  new_window->ops = ops;
+  new_window->new_data = svn_string_dup (window->new_data, pool);
+  return new_window;
+}
+
+
+svn_txdelta_window_t *
+svn_txdelta_compose_windows (const svn_txdelta_window_t *window_A,
+                             const svn_txdelta_window_t *window_B,
+                             apr_pool_t *pool)
+{
+  struct build_ops_baton_t bob = { 0 };
+  svn_txdelta_window_t *composite;
+  offset_index_t *ndx = NULL;
+  int i;
+
+  assert (window_B->sview_len == window_A->tview_len);
+
+  bob.new_data = svn_stringbuf_create ("", pool);
+  for (i = 0; i < window_B->num_ops; ++i)
+    {
+      const svn_txdelta_op_t *const op = &window_B->ops[i];
+
+      switch (op->action_code)
+        {
+        case svn_txdelta_source:
+          if (! ndx)
+            ndx = create_offset_index (window_A, pool);
+          copy_source_ops (op->offset, op->offset + op->length,
+                           window_A, ndx, 0, &bob, pool);
+          break;
+
+        case svn_txdelta_target:
+          push_op (&bob, svn_txdelta_target,
+                   op->offset, op->length, NULL, pool);
+          break;
+
+        case svn_txdelta_new:
+          push_op (&bob, svn_txdelta_new, 0, op->length,
+                   window_B->new_data->data + op->offset, pool);
+          break;
+
+        default:
+          assert (!"unknown delta op.");
+        }
+    }
+
+  composite = svn_txdelta__make_window (&bob, pool);
+  composite->sview_offset = window_A->sview_offset;
+  composite->sview_len = window_A->sview_len;
+  composite->tview_len = window_B->tview_len;
+  return composite;
+}
+
+
+
+/* Streaming composition. */
+
+/* A window read from the first delta stream, along with its position
+   in the intermediate text. */
+struct window_A_t
+{
+  svn_txdelta_window_t *window;
+  offset_index_t *ndx;
+
+  /* The offset of this window's target view in the intermediate
+     text. */
+  apr_off_t toffset;
+
+  /* The pool holding this record; destroyed when the window is no
+     longer needed. */
+  apr_pool_t *pool;
+
+  struct window_A_t *next;
+};
+
+
+struct compose_baton
+{
+  /* These are copied from parameters passed to svn_txdelta_compose. */
+  svn_txdelta_stream_t *stream_A;
+  svn_txdelta_stream_t *stream_B;
+
+  /* Windows from STREAM_A that still overlap STREAM_B's source view,
+     oldest first.  */
+  struct window_A_t *first;
+  struct window_A_t *last;
+
+  /* Offset in the intermediate text just past the last window read
+     from STREAM_A.  */
+  apr_off_t limit_A;
+
+  /* TRUE once STREAM_A has returned its final NULL window. */
+  svn_boolean_t done_A;
+
+  /* The source view of the last composite window.  Source views may
+     not slide backwards, so windows that need nothing from STREAM_A
+     keep this view rather than inventing a new one.  */
+  apr_off_t sview_offset;
+  apr_size_t sview_len;
+
+  apr_pool_t *pool;
+};
+
+
+/* Make sure CB holds every window of the first stream that overlaps
+   the intermediate text from OFFSET up to LIMIT, and none that lie
+   wholly before OFFSET. */
+static svn_error_t *
+slide_windows_A (struct compose_baton *cb,
+                 apr_off_t offset,
+                 apr_off_t limit)
+{
+  /* Drop windows the second stream has slid past. */
+  while (cb->first
+         && cb->first->toffset + cb->first->window->tview_len <= offset)
+    {
+      struct window_A_t *old = cb->first;
+      cb->first = old->next;
+      if (! cb->first)
+        cb->last = NULL;
+      svn_pool_destroy (old->pool);
+    }
+
+  /* Read ahead until the requested range is covered. */
+  while (cb->limit_A < limit)
+    {
+      apr_pool_t *subpool;
+      svn_txdelta_window_t *window;
+      struct window_A_t *wa;
+
+      if (cb->done_A)
+        return svn_error_create (SVN_ERR_INCOMPLETE_DATA, 0, NULL, cb->pool,
+                                 "Delta source ended unexpectedly");
+
+      subpool = svn_pool_create (cb->pool);
+      SVN_ERR (svn_txdelta_next_window (&window, cb->stream_A, subpool));
+      if (! window)
+        {
+          cb->done_A = TRUE;
+          svn_pool_destroy (subpool);
+          continue;
+        }
+
+      wa = apr_palloc (subpool, sizeof (*wa));
+      wa->window = window;
+      wa->ndx = create_offset_index (window, subpool);
+      wa->toffset = cb->limit_A;
+      wa->pool = subpool;
+      wa->next = NULL;
+      cb->limit_A += window->tview_len;
+
+      if (wa->toffset + window->tview_len <= offset)
+        {
+          /* Nothing in this window is wanted. */
+          svn_pool_destroy (subpool);
+          continue;
+        }
+
+      if (cb->last)
+        cb->last->next = wa;
+      else
+        cb->first = wa;
+      cb->last = wa;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+compose_next_window (svn_txdelta_window_t **window,
+                     void *baton,
+                     apr_pool_t *pool)
+{
+  struct compose_baton *cb = baton;
+  struct build_ops_baton_t bob = { 0 };
+  svn_txdelta_window_t *window_B;
+  struct window_A_t *wa;
+  apr_off_t sview_offset, sview_limit;
+  int i;
+
+  SVN_ERR (svn_txdelta_next_window (&window_B, cb->stream_B, pool));
+  if (! window_B)
+    {
+      *window = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  /* Bring in the part of the intermediate text this window reads. */
+  if (window_B->sview_len > 0)
+    SVN_ERR (slide_windows_A (cb, window_B->sview_offset,
+                              window_B->sview_offset + window_B->sview_len));
+
+  /* The composite source view spans the source views of the retained
+     windows.  These slide forward as the second stream's source view
+     does, so the composite views do too. */
+  sview_offset = cb->sview_offset;
+  sview_limit = cb->sview_offset + cb->sview_len;
+  if (window_B->sview_len > 0 && cb->first)
+    {
+      if (cb->first->window->sview_offset > sview_offset)
+        sview_offset = cb->first->window->sview_offset;
+      if (cb->last->window->sview_offset + cb->last->window->sview_len
+          > sview_limit)
+        sview_limit = (cb->last->window->sview_offset
+                       + cb->last->window->sview_len);
+    }
+
+  bob.new_data = svn_stringbuf_create ("", pool);
+  for (i = 0; i < window_B->num_ops; ++i)
+    {
+      const svn_txdelta_op_t *const op = &window_B->ops[i];
+
+      switch (op->action_code)
+        {
+        case svn_txdelta_source:
+          {
+            const apr_off_t offset = window_B->sview_offset + op->offset;
+            const apr_off_t limit = offset + op->length;
+
+            for (wa = cb->first; wa && wa->toffset < limit; wa = wa->next)
+              {
+                const apr_off_t tlimit = wa->toffset + wa->window->tview_len;
+                if (tlimit <= offset)
+                  continue;
+                copy_source_ops ((offset > wa->toffset
+                                  ? offset - wa->toffset : 0),
+                                 (limit < tlimit
+                                  ? limit : tlimit) - wa->toffset,
+                                 wa->window, wa->ndx,
+                                 wa->window->sview_offset - sview_offset,
+                                 &bob, pool);
+              }
+          }
+          break;
+
+        case svn_txdelta_target:
+          push_op (&bob, svn_txdelta_target,
+                   op->offset, op->length, NULL, pool);
+          break;
+
+        case svn_txdelta_new:
+          push_op (&bob, svn_txdelta_new, 0, op->length,
+                   window_B->new_data->data + op->offset, pool);
+          break;
+
+        default:
+          assert (!"unknown delta op.");
+        }
+    }
+
+  *window = svn_txdelta__make_window (&bob, pool);
+  (*window)->sview_offset = sview_offset;
+  (*window)->sview_len = sview_limit - sview_offset;
+  (*window)->tview_len = window_B->tview_len;
+
+  cb->sview_offset = (*window)->sview_offset;
+  cb->sview_len = (*window)->sview_len;
+  return SVN_NO_ERROR;
+}
+
+
+static const unsigned char *
+compose_md5_digest (void *baton)
+{
+  struct compose_baton *cb = baton;
+  return svn_txdelta_md5_digest (cb->stream_B);
+}
+
+
+void
+svn_txdelta_compose (svn_txdelta_stream_t **stream,
+                     svn_txdelta_stream_t *stream_A,
+                     svn_txdelta_stream_t *stream_B,
+                     apr_pool_t *pool)
+{
+  apr_pool_t *subpool = svn_pool_create (pool);
+  struct compose_baton *cb = apr_palloc (subpool, sizeof (*cb));
+
+  cb->stream_A = stream_A;
+  cb->stream_B = stream_B;
+  cb->first = NULL;
+  cb->last = NULL;
+  cb->limit_A = 0;
+  cb->done_A = FALSE;
+  cb->sview_offset = 0;
+  cb->sview_len = 0;
+  cb->pool = subpool;
+
+  *stream = svn_txdelta_stream_create (cb, compose_next_window,
+                                       compose_md5_digest, subpool);
+}
+
+
+
+/*
+ * local variables:
+ * eval: (load-file "../../tools/dev/svn-dev.el")
+ * end:
+ */
@@ -22,6 +22,7 @@
 #include "apr_pools.h"
 #include "apr_hash.h"
 #include "svn_xml.h"
+#include "svn_delta.h"
 
 #ifndef SVN_LIBSVN_DELTA_H
 #define SVN_LIBSVN_DELTA_H
@@ -34,7 +35,22 @@ extern "C" {
 
 /* Private interface for text deltas. */
 
-struct build_ops_baton_t;
+/* Context/baton for building an operation sequence. */
+
+struct build_ops_baton_t {
+  int num_ops;                  /* current number of ops */
+  int ops_size;                 /* number of ops allocated */
+  svn_txdelta_op_t *ops;        /* the operations */
+
+  svn_stringbuf_t *new_data;    /* any new data used by the operations */
+};
+
+/* Allocate a delta window in POOL holding the ops and new data
+   accumulated in BOB.  The window's view offsets and lengths are left
+   zero for the caller to fill in.  */
+svn_txdelta_window_t *svn_txdelta__make_window (const struct
+                                                build_ops_baton_t *bob,
+                                                apr_pool_t *pool);
 
 /* Insert a delta op into the delta window being built via BUILD_BATON. If
    OPCODE is svn_delta_new, bytes from NEW_DATA are copied into the window
@@ -55,6 +71,52 @@ void svn_txdelta__vdelta (struct build_ops_baton_t *build_baton,
                           apr_pool_t *pool);
 
 
+
+/* The binary editor drive format, written by binary_output.c and read
+ * by binary_parse.c.
+ *
+ * A drive starts with the four bytes of SVN_DELTA__BINARY_MAGIC,
+ * followed by one record per editor call.  Each record is a single
+ * command byte followed by that command's arguments, in the order
+ * the editor function takes them:
+ *
+ *    - integers, including baton ids and lengths, use the svndiff
+ *      variable-length encoding;
+ *    - revision numbers are stored as REV + 1, so that
+ *      SVN_INVALID_REVNUM encodes as zero;
+ *    - strings are a length followed by that many bytes; strings
+ *      which may be absent (copyfrom paths, property values) store
+ *      LEN + 1, with zero meaning NULL.
+ *
+ * Directory and file batons are replaced by small integer ids,
+ * assigned in order by the open_root, add_* and open_* records and
+ * released by the close_* records.  Text deltas are carried as
+ * svndiff data split across any number of TEXTDELTA_CHUNK records
+ * (file id, length, bytes) between an APPLY_TEXTDELTA record and a
+ * TEXTDELTA_END record for the same file.
+ *
+ * Only CLOSE_EDIT or ABORT_EDIT may end a drive. */
+
+#define SVN_DELTA__BINARY_MAGIC              "SVE\0"
+
+#define SVN_DELTA__BINARY_SET_TARGET_REV     'T'
+#define SVN_DELTA__BINARY_OPEN_ROOT          'R'
+#define SVN_DELTA__BINARY_DELETE_ENTRY       'D'
+#define SVN_DELTA__BINARY_ADD_DIR            'A'
+#define SVN_DELTA__BINARY_OPEN_DIR           'O'
+#define SVN_DELTA__BINARY_CHANGE_DIR_PROP    'P'
+#define SVN_DELTA__BINARY_CLOSE_DIR          'C'
+#define SVN_DELTA__BINARY_ADD_FILE           'a'
+#define SVN_DELTA__BINARY_OPEN_FILE          'o'
+#define SVN_DELTA__BINARY_APPLY_TEXTDELTA    't'
+#define SVN_DELTA__BINARY_TEXTDELTA_CHUNK    'w'
+#define SVN_DELTA__BINARY_TEXTDELTA_END      'e'
+#define SVN_DELTA__BINARY_CHANGE_FILE_PROP   'p'
+#define SVN_DELTA__BINARY_CLOSE_FILE         'c'
+#define SVN_DELTA__BINARY_CLOSE_EDIT         'E'
+#define SVN_DELTA__BINARY_ABORT_EDIT         'X'
+
+
 
 /* These are the in-memory tree-delta stackframes; they are used to
  * keep track of a delta's state while the XML stream is being parsed.
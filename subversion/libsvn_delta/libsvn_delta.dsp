@@ -87,6 +87,18 @@ LIB32=link.exe -lib
 # PROP Default_Filter "cpp;c;cxx;rc;def;r;odl;idl;hpj;bat"
 # Begin Source File
 
+SOURCE=.\binary_output.c
+# End Source File
+# Begin Source File
+
+SOURCE=.\binary_parse.c
+# End Source File
+# Begin Source File
+
+SOURCE=.\compose_delta.c
+# End Source File
+# Begin Source File
+
 SOURCE=.\compose_editors.c
 # End Source File
 # Begin Source File
@@ -99,6 +111,10 @@ SOURCE=.\pipe_editors.c
 # End Source File
 # Begin Source File
 
+SOURCE=.\parallel_delta.c
+# End Source File
+# Begin Source File
+
 SOURCE=.\svndiff.c
 # End Source File
 # Begin Source File
@@ -0,0 +1,408 @@
+/*
+ * parallel_delta.c:  text delta streams computed on worker threads
+ *
+ * ====================================================================
+ * Copyright (c) 2000-2002 CollabNet.  All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.  The terms
+ * are also available at http://subversion.tigris.org/license-1.html.
+ * If newer versions of this license are posted there, you may use a
+ * newer version instead, at your option.
+ *
+ * This software consists of voluntary contributions made by many
+ * individuals.  For exact contribution history, see the revision
+ * history and logs, available at http://subversion.tigris.org/.
+ * ====================================================================
+ */
+
+
+#include <string.h>
+
+#include <apr_general.h>
+#include <apr_md5.h>
+
+#if APR_HAS_THREADS
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
+#endif
+
+#include "svn_delta.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "delta.h"
+
+
+#if APR_HAS_THREADS
+
+/* The vdelta run for a window depends only on that window's source
+   and target views, so once the views have been read the windows can
+   be computed in any order.  The stream below reads the views on the
+   caller's thread, exactly as txdelta_next_window does, and hands
+   each one to a small set of worker threads.  Windows are handed
+   back in the order they were read, so the consumer sees the same
+   sequence of windows svn_txdelta would have produced.  */
+
+
+/* How many windows to read ahead per worker thread.  Each one holds
+   up to two and a half chunks of view data, plus its ops.  */
+#define WINDOWS_PER_THREAD 2
+
+
+/* The life cycle of a delta job. */
+enum job_state
+{
+  job_free,                     /* Not in use. */
+  job_queued,                   /* Views read, waiting for a worker. */
+  job_running,                  /* A worker is running vdelta. */
+  job_done                      /* WINDOW is ready to be handed out. */
+};
+
+
+/* One window's worth of work.  */
+struct delta_job
+{
+  /* Source view followed by target view, as in txdelta_next_window. */
+  char *buf;
+  apr_off_t sview_offset;
+  apr_size_t sview_len;
+  apr_size_t tview_len;
+
+  /* The computed window, and the pool it lives in.  The pool is
+     cleared once the window has been copied out to the consumer.  */
+  svn_txdelta_window_t *window;
+  apr_pool_t *pool;
+
+  enum job_state state;
+};
+
+
+/* Baton for the stream built by svn_txdelta_parallel. */
+struct parallel_baton
+{
+  /* These are copied from parameters passed to svn_txdelta_parallel. */
+  svn_stream_t *source;
+  svn_stream_t *target;
+
+  /* Reader state; only touched by the consumer's thread. */
+  svn_boolean_t more;           /* TRUE until the target is exhausted. */
+  svn_boolean_t finished;       /* TRUE once the NULL window was returned. */
+  apr_off_t pos;                /* Offset of next read in source file. */
+  char *saved_source;           /* Tail of the last source view... */
+  apr_size_t saved_source_len;  /* ...and its length. */
+  apr_md5_ctx_t context;
+  unsigned char digest[MD5_DIGESTSIZE];
+
+  /* A ring of NUM_JOBS jobs.  The COUNT jobs starting at HEAD are in
+     use, in the order their windows are to be returned. */
+  struct delta_job *jobs;
+  int num_jobs;
+  int head;
+  int count;
+
+  /* Everything below is protected by LOCK.  Workers wait on
+     WORK_READY for queued jobs; the consumer waits on WORK_DONE for
+     the job at HEAD to finish.  NEXT_RUN is the next job a worker
+     should pick up, and NUM_QUEUED the number of jobs waiting. */
+  apr_thread_mutex_t *lock;
+  apr_thread_cond_t *work_ready;
+  apr_thread_cond_t *work_done;
+  int next_run;
+  int num_queued;
+  svn_boolean_t shutdown;
+
+  /* The worker threads.  NUM_THREADS is zero once they have been
+     joined. */
+  apr_thread_t **threads;
+  int num_threads;
+};
+
+
+
+/*** Worker threads. ***/
+
+/* Run vdelta over JOB's views and build its window in JOB->pool. */
+static void
+compute_window (struct delta_job *job)
+{
+  struct build_ops_baton_t bob = { 0 };
+  svn_txdelta_window_t *window;
+
+  bob.new_data = svn_stringbuf_create ("", job->pool);
+  svn_txdelta__vdelta (&bob, job->buf, job->sview_len, job->tview_len,
+                       job->pool);
+
+  window = svn_txdelta__make_window (&bob, job->pool);
+  window->sview_offset = job->sview_offset;
+  window->sview_len = job->sview_len;
+  window->tview_len = job->tview_len;
+  job->window = window;
+}
+
+
+/* Thread body: compute queued jobs until told to shut down. */
+static void * APR_THREAD_FUNC
+delta_worker (apr_thread_t *thread, void *baton)
+{
+  struct parallel_baton *pb = baton;
+
+  apr_thread_mutex_lock (pb->lock);
+  for (;;)
+    {
+      struct delta_job *job;
+
+      while (! pb->shutdown && pb->num_queued == 0)
+        apr_thread_cond_wait (pb->work_ready, pb->lock);
+      if (pb->shutdown)
+        break;
+
+      job = &pb->jobs[pb->next_run];
+      pb->next_run = (pb->next_run + 1) % pb->num_jobs;
+      pb->num_queued--;
+      job->state = job_running;
+      apr_thread_mutex_unlock (pb->lock);
+
+      compute_window (job);
+
+      apr_thread_mutex_lock (pb->lock);
+      job->state = job_done;
+      apr_thread_cond_signal (pb->work_done);
+    }
+  apr_thread_mutex_unlock (pb->lock);
+
+  return NULL;
+}
+
+
+/* Tell the workers of PB to exit, and wait until they have. */
+static void
+stop_workers (struct parallel_baton *pb)
+{
+  int i;
+  apr_status_t retval;
+
+  if (pb->num_threads == 0)
+    return;
+
+  apr_thread_mutex_lock (pb->lock);
+  pb->shutdown = TRUE;
+  apr_thread_cond_broadcast (pb->work_ready);
+  apr_thread_mutex_unlock (pb->lock);
+
+  for (i = 0; i < pb->num_threads; i++)
+    apr_thread_join (&retval, pb->threads[i]);
+  pb->num_threads = 0;
+}
+
+
+/* Pool cleanup: make sure no worker outlives the stream's memory,
+   even if the consumer abandons the stream before its last window. */
+static apr_status_t
+cleanup_workers (void *data)
+{
+  stop_workers (data);
+  return APR_SUCCESS;
+}
+
+
+
+/*** The delta stream. ***/
+
+/* Read views into free jobs of PB and queue them for the workers,
+   until the ring is full or the target is exhausted.
+
+   The choice of views is exactly that of txdelta_next_window: each
+   source view is the tail of the previous one plus a chunk of new
+   source data (a chunk and a half the first time), and each target
+   view is the next chunk of the target.  */
+static svn_error_t *
+fill_jobs (struct parallel_baton *pb)
+{
+  while (pb->more && pb->count < pb->num_jobs)
+    {
+      struct delta_job *job
+        = &pb->jobs[(pb->head + pb->count) % pb->num_jobs];
+      apr_size_t total_source_len;
+      apr_size_t new_source_len = SVN_STREAM_CHUNK_SIZE;
+      apr_size_t target_len = SVN_STREAM_CHUNK_SIZE;
+
+      if (pb->saved_source_len == 0)
+        new_source_len += SVN_STREAM_CHUNK_SIZE / 2;
+
+      memcpy (job->buf, pb->saved_source, pb->saved_source_len);
+      SVN_ERR (svn_stream_read (pb->source,
+                                job->buf + pb->saved_source_len,
+                                &new_source_len));
+      total_source_len = pb->saved_source_len + new_source_len;
+      apr_md5_update (&(pb->context), job->buf + pb->saved_source_len,
+                      new_source_len);
+
+      SVN_ERR (svn_stream_read (pb->target, job->buf + total_source_len,
+                                &target_len));
+      pb->pos += new_source_len;
+
+      if (target_len == 0)
+        {
+          pb->more = FALSE;
+          break;
+        }
+
+      job->sview_offset = pb->pos - total_source_len;
+      job->sview_len = total_source_len;
+      job->tview_len = target_len;
+
+      pb->saved_source_len = (total_source_len < SVN_STREAM_CHUNK_SIZE)
+        ? total_source_len : SVN_STREAM_CHUNK_SIZE;
+      memcpy (pb->saved_source,
+              job->buf + total_source_len - pb->saved_source_len,
+              pb->saved_source_len);
+
+      apr_thread_mutex_lock (pb->lock);
+      job->state = job_queued;
+      pb->num_queued++;
+      apr_thread_cond_signal (pb->work_ready);
+      apr_thread_mutex_unlock (pb->lock);
+      pb->count++;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+parallel_next_window (svn_txdelta_window_t **window,
+                      void *baton,
+                      apr_pool_t *pool)
+{
+  struct parallel_baton *pb = baton;
+  struct delta_job *job;
+
+  if (pb->finished)
+    {
+      *window = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR (fill_jobs (pb));
+
+  if (pb->count == 0)
+    {
+      apr_status_t apr_err;
+
+      stop_workers (pb);
+      apr_err = apr_md5_final (pb->digest, &(pb->context));
+      if (! APR_STATUS_IS_SUCCESS (apr_err))
+        return svn_error_create
+          (apr_err, 0, NULL, pool,
+           "svn_txdelta_next_window: MD5 finalization failed");
+
+      pb->finished = TRUE;
+      *window = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  /* Wait for the oldest window, and copy it out so its job can be
+     reused straight away. */
+  job = &pb->jobs[pb->head];
+  apr_thread_mutex_lock (pb->lock);
+  while (job->state != job_done)
+    apr_thread_cond_wait (pb->work_done, pb->lock);
+  apr_thread_mutex_unlock (pb->lock);
+
+  *window = svn_txdelta_window_dup (job->window, pool);
+  svn_pool_clear (job->pool);
+  job->window = NULL;
+  job->state = job_free;
+  pb->head = (pb->head + 1) % pb->num_jobs;
+  pb->count--;
+
+  /* Keep the workers busy while the consumer handles this window. */
+  return fill_jobs (pb);
+}
+
+
+static const unsigned char *
+parallel_md5_digest (void *baton)
+{
+  struct parallel_baton *pb = baton;
+
+  if (! pb->finished)
+    return NULL;
+
+  return pb->digest;
+}
+
+#endif /* APR_HAS_THREADS */
+
+
+void
+svn_txdelta_parallel (svn_txdelta_stream_t **stream,
+                      svn_stream_t *source,
+                      svn_stream_t *target,
+                      int num_threads,
+                      apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  if (num_threads > 0)
+    {
+      struct parallel_baton *pb = apr_pcalloc (pool, sizeof (*pb));
+      apr_pool_t *guard_pool;
+      int i;
+
+      pb->source = source;
+      pb->target = target;
+      pb->more = TRUE;
+      pb->saved_source = apr_palloc (pool, SVN_STREAM_CHUNK_SIZE);
+      apr_md5_init (&(pb->context));
+
+      pb->num_jobs = num_threads * WINDOWS_PER_THREAD;
+      pb->jobs = apr_pcalloc (pool, pb->num_jobs * sizeof (*pb->jobs));
+      for (i = 0; i < pb->num_jobs; i++)
+        {
+          pb->jobs[i].buf = apr_palloc (pool, 3 * SVN_STREAM_CHUNK_SIZE);
+          pb->jobs[i].pool = svn_pool_create (pool);
+          pb->jobs[i].state = job_free;
+        }
+
+      if (apr_thread_mutex_create (&pb->lock, APR_THREAD_MUTEX_DEFAULT,
+                                   pool) == APR_SUCCESS
+          && apr_thread_cond_create (&pb->work_ready, pool) == APR_SUCCESS
+          && apr_thread_cond_create (&pb->work_done, pool) == APR_SUCCESS)
+        {
+          pb->threads = apr_palloc (pool,
+                                    num_threads * sizeof (*pb->threads));
+          for (i = 0; i < num_threads; i++)
+            if (apr_thread_create (&pb->threads[pb->num_threads], NULL,
+                                   delta_worker, pb, pool) == APR_SUCCESS)
+              pb->num_threads++;
+        }
+
+      if (pb->num_threads > 0)
+        {
+          /* The workers use the job pools, which are destroyed before
+             POOL's own cleanups run.  Subpools go newest first, so a
+             cleanup on a subpool created after the job pools runs
+             while they are all still intact. */
+          guard_pool = svn_pool_create (pool);
+          apr_pool_cleanup_register (guard_pool, pb, cleanup_workers,
+                                     apr_pool_cleanup_null);
+
+          *stream = svn_txdelta_stream_create (pb, parallel_next_window,
+                                               parallel_md5_digest, pool);
+          return;
+        }
+    }
+#endif /* APR_HAS_THREADS */
+
+  /* No threads to be had; compute the windows in the caller's thread. */
+  svn_txdelta (stream, source, target, pool);
+}
+
+
+
+/*
+ * local variables:
+ * eval: (load-file "../../tools/dev/svn-dev.el")
+ * end:
+ */
@@ -32,6 +32,16 @@
 /* Text delta stream descriptor. */
 
 struct svn_txdelta_stream_t {
+  /* The baton and callbacks supplied to svn_txdelta_stream_create. */
+  void *baton;
+  svn_txdelta_next_window_fn_t next_window;
+  svn_txdelta_md5_digest_fn_t md5_digest;
+};
+
+
+/* Baton for the vdelta-based delta stream built by svn_txdelta. */
+
+struct txdelta_baton {
   /* These are copied from parameters passed to svn_txdelta. */
   svn_stream_t *source;
   svn_stream_t *target;
@@ -72,22 +82,11 @@ struct apply_baton {
 };
 
 
-/* Context/baton for building an operation sequence. */
-
-struct build_ops_baton_t {
-  int num_ops;                  /* current number of ops */
-  int ops_size;                 /* number of ops allocated */
-  svn_txdelta_op_t *ops;        /* the operations */
-
-  svn_stringbuf_t *new_data;    /* any new data used by the operations */
-};
-
-
-
 /* Allocate a delta window. */
 
-static svn_txdelta_window_t *
-make_window (apr_pool_t *pool, struct build_ops_baton_t *bob)
+svn_txdelta_window_t *
+svn_txdelta__make_window (const struct build_ops_baton_t *bob,
+                          apr_pool_t *pool)
 {
   svn_txdelta_window_t *window;
   svn_string_t *new_data = apr_palloc (pool, sizeof (*new_data));
@@ -166,24 +165,36 @@ svn_txdelta__insert_op (struct build_ops_baton_t *bob,
 
 
 
-/* Allocate a delta stream descriptor. */
+/* Generic delta streams. */
 
-void
-svn_txdelta (svn_txdelta_stream_t **stream,
-             svn_stream_t *source,
-             svn_stream_t *target,
-             apr_pool_t *pool)
+svn_txdelta_stream_t *
+svn_txdelta_stream_create (void *baton,
+                           svn_txdelta_next_window_fn_t next_window,
+                           svn_txdelta_md5_digest_fn_t md5_digest,
+                           apr_pool_t *pool)
 {
-  *stream = apr_palloc (pool, sizeof (**stream));
-  (*stream)->source = source; 
-  (*stream)->target = target;
-  (*stream)->more = TRUE;
-  (*stream)->pos = 0;
-  (*stream)->buf = apr_palloc (pool, 3 * SVN_STREAM_CHUNK_SIZE);
-  (*stream)->saved_source_len = 0;
+  svn_txdelta_stream_t *stream = apr_palloc (pool, sizeof (*stream));
 
-  /* Initialize MD5 digest calculation. */
-  apr_md5_init (&((*stream)->context));
+  stream->baton = baton;
+  stream->next_window = next_window;
+  stream->md5_digest = md5_digest;
+  return stream;
+}
+
+
+svn_error_t *
+svn_txdelta_next_window (svn_txdelta_window_t **window,
+                         svn_txdelta_stream_t *stream,
+                         apr_pool_t *pool)
+{
+  return stream->next_window (window, stream->baton, pool);
+}
+
+
+const unsigned char *
+svn_txdelta_md5_digest (svn_txdelta_stream_t *stream)
+{
+  return stream->md5_digest (stream->baton);
 }
 
 
@@ -209,11 +220,13 @@ svn_txdelta (svn_txdelta_stream_t **stream,
    If we run out of source data before we run out of target data, we
    reuse the final chunk of data for the remaining windows.  No grand
    scheme at work there; that's just how the code worked out. */
-svn_error_t *
-svn_txdelta_next_window (svn_txdelta_window_t **window,
-                         svn_txdelta_stream_t *stream,
-                         apr_pool_t *pool)
+static svn_error_t *
+txdelta_next_window (svn_txdelta_window_t **window,
+                     void *baton,
+                     apr_pool_t *pool)
 {
+  struct txdelta_baton *stream = baton;
+
   if (!stream->more)
     {
       apr_status_t apr_err;
@@ -280,7 +293,7 @@ svn_txdelta_next_window (svn_txdelta_window_t **window,
                            pool);
 
       /* Create the delta window. */
-      *window = make_window (pool, &bob);
+      *window = svn_txdelta__make_window (&bob, pool);
       (*window)->sview_offset = stream->pos - total_source_len;
       (*window)->sview_len = total_source_len;
       (*window)->tview_len = target_len;
@@ -298,9 +311,11 @@ svn_txdelta_next_window (svn_txdelta_window_t **window,
 }
 
 
-const unsigned char *
-svn_txdelta_md5_digest (svn_txdelta_stream_t *stream)
+static const unsigned char *
+txdelta_md5_digest (void *baton)
 {
+  struct txdelta_baton *stream = baton;
+
   /* If there are more windows for this stream, the digest has not yet
      been calculated.  */
   if (stream->more)
@@ -310,6 +325,31 @@ svn_txdelta_md5_digest (svn_txdelta_stream_t *stream)
 }
 
 
+/* Allocate a delta stream descriptor. */
+
+void
+svn_txdelta (svn_txdelta_stream_t **stream,
+             svn_stream_t *source,
+             svn_stream_t *target,
+             apr_pool_t *pool)
+{
+  struct txdelta_baton *b = apr_palloc (pool, sizeof (*b));
+
+  b->source = source;
+  b->target = target;
+  b->more = TRUE;
+  b->pos = 0;
+  b->buf = apr_palloc (pool, 3 * SVN_STREAM_CHUNK_SIZE);
+  b->saved_source_len = 0;
+
+  /* Initialize MD5 digest calculation. */
+  apr_md5_init (&(b->context));
+
+  *stream = svn_txdelta_stream_create (b, txdelta_next_window,
+                                       txdelta_md5_digest, pool);
+}
+
+
 
 /* Functions for applying deltas.  */
 
@@ -265,7 +265,8 @@ output_addopen (struct edit_baton *eb,
   att = apr_hash_make (pool);
   if ((addopen == elem_add) && (base_path != NULL))
     apr_hash_set (att, SVN_DELTA__XML_ATTR_COPYFROM_PATH, 
-                  strlen (SVN_DELTA__XML_ATTR_COPYFROM_PATH), base_path);
+                  strlen (SVN_DELTA__XML_ATTR_COPYFROM_PATH),
+                  svn_stringbuf_create (base_path, pool));
 
   if (SVN_IS_VALID_REVNUM (base_revision))
     {
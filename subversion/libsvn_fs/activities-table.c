@@ -0,0 +1,117 @@
+/* activities-table.c : operations on the `activities' table
+ *
+ * ====================================================================
+ * Copyright (c) 2000-2002 CollabNet.  All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.  The terms
+ * are also available at http://subversion.tigris.org/license-1.html.
+ * If newer versions of this license are posted there, you may use a
+ * newer version instead, at your option.
+ *
+ * This software consists of voluntary contributions made by many
+ * individuals.  For exact contribution history, see the revision
+ * history and logs, available at http://subversion.tigris.org/.
+ * ====================================================================
+ */
+
+#include "apr_strings.h"
+
+#include "db.h"
+#include "fs.h"
+#include "err.h"
+#include "dbt.h"
+#include "trail.h"
+#include "activities-table.h"
+
+
+int
+svn_fs__open_activities_table (DB **activities_p,
+                               DB_ENV *env,
+                               int create)
+{
+  DB *activities;
+
+  DB_ERR (db_create (&activities, env, 0));
+  DB_ERR (activities->open (activities, "activities", 0, DB_BTREE,
+                            create ? (DB_CREATE | DB_EXCL) : DB_CREATE,
+                            0666));
+
+  *activities_p = activities;
+  return 0;
+}
+
+
+svn_error_t *
+svn_fs__get_activity (const char **txn_name_p,
+                      svn_fs_t *fs,
+                      const char *activity_id,
+                      trail_t *trail)
+{
+  DBT key, value;
+  int db_err;
+
+  db_err = fs->activities->get (fs->activities, trail->db_txn,
+                                svn_fs__str_to_dbt (&key,
+                                                    (char *) activity_id),
+                                svn_fs__result_dbt (&value),
+                                0);
+  svn_fs__track_dbt (&value, trail->pool);
+
+  if (db_err == DB_NOTFOUND)
+    {
+      *txn_name_p = NULL;
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR (DB_WRAP (fs, "reading activity", db_err));
+
+  *txn_name_p = apr_pstrndup (trail->pool, value.data, value.size);
+  return SVN_NO_ERROR;
+}
+
+
+svn_error_t *
+svn_fs__put_activity (svn_fs_t *fs,
+                      const char *activity_id,
+                      const char *txn_name,
+                      trail_t *trail)
+{
+  DBT key, value;
+
+  /* Only in the context of this function do we know that the DB call
+     will not attempt to modify these strings, so the casts belong
+     here.  */
+  svn_fs__str_to_dbt (&key, (char *) activity_id);
+  svn_fs__str_to_dbt (&value, (char *) txn_name);
+  SVN_ERR (DB_WRAP (fs, "storing activity record",
+                    fs->activities->put (fs->activities, trail->db_txn,
+                                         &key, &value, 0)));
+
+  return SVN_NO_ERROR;
+}
+
+
+svn_error_t *
+svn_fs__delete_activity (svn_fs_t *fs,
+                         const char *activity_id,
+                         trail_t *trail)
+{
+  DBT key;
+  int db_err;
+
+  svn_fs__str_to_dbt (&key, (char *) activity_id);
+  db_err = fs->activities->del (fs->activities, trail->db_txn, &key, 0);
+  if (db_err == DB_NOTFOUND)
+    return SVN_NO_ERROR;
+  SVN_ERR (DB_WRAP (fs, "deleting entry from `activities' table", db_err));
+
+  return SVN_NO_ERROR;
+}
+
+
+
+/*
+ * local variables:
+ * eval: (load-file "../../tools/dev/svn-dev.el")
+ * end:
+ */
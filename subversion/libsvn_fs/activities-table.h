@@ -0,0 +1,75 @@
+/* activities-table.h : internal interface to ops on `activities' table
+ *
+ * ====================================================================
+ * Copyright (c) 2000-2002 CollabNet.  All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.  The terms
+ * are also available at http://subversion.tigris.org/license-1.html.
+ * If newer versions of this license are posted there, you may use a
+ * newer version instead, at your option.
+ *
+ * This software consists of voluntary contributions made by many
+ * individuals.  For exact contribution history, see the revision
+ * history and logs, available at http://subversion.tigris.org/.
+ * ====================================================================
+ */
+
+#ifndef SVN_LIBSVN_FS_ACTIVITIES_TABLE_H
+#define SVN_LIBSVN_FS_ACTIVITIES_TABLE_H
+
+#include "svn_fs.h"
+#include "trail.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+
+/* Open an `activities' table in ENV.  If CREATE is non-zero, create
+   one, failing if it already exists; otherwise create it only if it
+   doesn't exist, since filesystems made before the table was added
+   don't have one.  Set *ACTIVITIES_P to the new table.  Return a
+   Berkeley DB error code.  */
+int svn_fs__open_activities_table (DB **activities_p,
+                                   DB_ENV *env,
+                                   int create);
+
+
+/* Set *TXN_NAME_P to the name of the transaction recorded for
+   ACTIVITY_ID in the `activities' table of FS, as part of TRAIL, or
+   to zero if there is none.  Allocate *TXN_NAME_P in TRAIL->pool.  */
+svn_error_t *svn_fs__get_activity (const char **txn_name_p,
+                                   svn_fs_t *fs,
+                                   const char *activity_id,
+                                   trail_t *trail);
+
+
+/* Record TXN_NAME as the transaction of ACTIVITY_ID in the
+   `activities' table of FS, as part of TRAIL, replacing any
+   transaction recorded for it already.  */
+svn_error_t *svn_fs__put_activity (svn_fs_t *fs,
+                                   const char *activity_id,
+                                   const char *txn_name,
+                                   trail_t *trail);
+
+
+/* Remove ACTIVITY_ID from the `activities' table of FS, as part of
+   TRAIL.  It is not an error if there is no such activity.  */
+svn_error_t *svn_fs__delete_activity (svn_fs_t *fs,
+                                      const char *activity_id,
+                                      trail_t *trail);
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_LIBSVN_FS_ACTIVITIES_TABLE_H */
+
+
+/*
+ * local variables:
+ * eval: (load-file "../../tools/dev/svn-dev.el")
+ * end:
+ */
@@ -17,6 +17,7 @@
 
 #include <string.h>
 #include <assert.h>
+#include <apr_md5.h>
 
 #include "svn_pools.h"
 #include "svn_path.h"
@@ -1407,6 +1408,7 @@ svn_fs__dag_link (dag_node_t *parent,
 svn_error_t *
 svn_fs__dag_get_contents (svn_stream_t **contents,
                           dag_node_t *file,
+                          apr_size_t offset,
                           apr_pool_t *pool,
                           trail_t *trail)
 { 
@@ -1440,7 +1442,7 @@ svn_fs__dag_get_contents (svn_stream_t **contents,
      temporary trail.  */
 
   *contents = svn_fs__rep_contents_read_stream (file->fs, rep_key,
-                                                0, NULL, pool);
+                                                offset, NULL, pool);
 
   /* Note that we're not registering any `close' func, because there's
      nothing to cleanup outside of our trail.  When the trail is
@@ -1485,6 +1487,39 @@ svn_fs__dag_file_length (apr_size_t *length,
 
 
 
+svn_error_t *
+svn_fs__dag_file_checksum (unsigned char digest[],
+                           dag_node_t *file,
+                           trail_t *trail)
+{ 
+  skel_t *node_rev;
+  const char *rep_key;
+  
+  if (! svn_fs__dag_is_file (file))
+    return 
+      svn_error_createf 
+      (SVN_ERR_FS_NOT_FILE, 0, NULL, trail->pool,
+       "Attempted to get checksum of a *non*-file node.");
+
+  SVN_ERR (get_node_revision (&node_rev, file, trail));
+  rep_key = apr_pstrndup (trail->pool,
+                          (SVN_FS__NR_DATA_KEY (node_rev))->data,
+                          (SVN_FS__NR_DATA_KEY (node_rev))->len);
+
+  /* A file that has never had contents is empty. */
+  if (rep_key[0] == '\0')
+    {
+      apr_md5_ctx_t context;
+
+      apr_md5_init (&context);
+      apr_md5_final (digest, &context);
+      return SVN_NO_ERROR;
+    }
+
+  return svn_fs__rep_contents_checksum (digest, file->fs, rep_key, trail);
+}
+
+
 svn_error_t *
 svn_fs__dag_get_edit_stream (svn_stream_t **contents,
                              dag_node_t *file,
@@ -1995,12 +2030,27 @@ svn_fs__things_different (int *props_changed,
         *props_changed = 1;
     }
 
-  /* Compare contents keys. */
+  /* Compare contents keys.  Different keys may still hold the same
+     contents, which their checksums can tell us without reading
+     either.  */
   if (contents_changed != NULL)
     {
-      if (svn_fs__skels_are_equal 
-          (SVN_FS__NR_DATA_KEY (node_rev1), SVN_FS__NR_DATA_KEY (node_rev2)))
+      skel_t *key1 = SVN_FS__NR_DATA_KEY (node_rev1);
+      skel_t *key2 = SVN_FS__NR_DATA_KEY (node_rev2);
+
+      if (svn_fs__skels_are_equal (key1, key2))
         *contents_changed = 0;
+      else if (key1->len && key2->len)
+        {
+          int same;
+
+          SVN_ERR (svn_fs__rep_same_contents
+                   (&same, node1->fs,
+                    apr_pstrndup (trail->pool, key1->data, key1->len),
+                    apr_pstrndup (trail->pool, key2->data, key2->len),
+                    trail));
+          *contents_changed = ! same;
+        }
       else
         *contents_changed = 1;
     }
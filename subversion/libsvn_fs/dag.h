@@ -371,12 +371,13 @@ svn_error_t *svn_fs__dag_make_dir (dag_node_t **child_p,
 
 
 /* Set *CONTENTS to a readable generic stream which yields the
-   contents of FILE, as part of TRAIL.  Allocate the stream in POOL,
-   which may or may not be TRAIL->pool.
+   contents of FILE, as part of TRAIL, starting OFFSET bytes in.
+   Allocate the stream in POOL, which may or may not be TRAIL->pool.
 
    If FILE is not a file, return SVN_ERR_FS_NOT_FILE.  */
 svn_error_t *svn_fs__dag_get_contents (svn_stream_t **contents,
                                        dag_node_t *file,
+                                       apr_size_t offset,
                                        apr_pool_t *pool,
                                        trail_t *trail);
 
@@ -402,6 +403,13 @@ svn_error_t *svn_fs__dag_file_length (apr_size_t *length,
                                       trail_t *trail);
 
 
+/* Set DIGEST to the MD5 checksum of the contents of FILE, as part of
+   TRAIL.  DIGEST must have room for MD5_DIGESTSIZE bytes.  */
+svn_error_t *svn_fs__dag_file_checksum (unsigned char digest[],
+                                        dag_node_t *file,
+                                        trail_t *trail);
+
+
 /* Create a new mutable file named NAME in PARENT, as part of TRAIL.
    Set *CHILD_P to a reference to the new node, allocated in
    TRAIL->pool.  The new file's contents are the empty string, and it
@@ -458,11 +466,9 @@ svn_error_t *svn_fs__dag_copied_from (svn_revnum_t *rev_p,
  * contents will be compared to the other's entries list.  (Not
  * terribly useful, I suppose, but that's the caller's business.)
  *
- * ### todo:
- * This function only compares rep keys at the moment.  This may leave
- * us with a slight chance of a false positive, though I don't really
- * see how that would happen in practice.  Nevertheless, it should
- * probably be fixed.
+ * Contents are compared by rep key, and failing that by the MD5
+ * checksums recorded in the reps; the contents themselves are never
+ * read.  Property lists are compared by rep key only.
  */
 svn_error_t *svn_fs__things_different (int *props_changed,
                                        int *contents_changed,
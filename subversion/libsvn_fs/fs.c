@@ -23,8 +23,10 @@
 #include "apr_general.h"
 #include "apr_pools.h"
 #include "apr_file_io.h"
+#include "apr_hash.h"
 
 #include "svn_pools.h"
+#include "svn_io.h"
 #include "db.h"
 #include "svn_fs.h"
 #include "fs.h"
@@ -34,6 +36,7 @@
 #include "txn-table.h"
 #include "reps-table.h"
 #include "strings-table.h"
+#include "activities-table.h"
 #include "dag.h"
 #include "svn_private_config.h"
 
@@ -129,6 +132,7 @@ cleanup_fs (svn_fs_t *fs)
   SVN_ERR (cleanup_fs_db (fs, &fs->transactions, "transactions"));
   SVN_ERR (cleanup_fs_db (fs, &fs->representations, "representations"));
   SVN_ERR (cleanup_fs_db (fs, &fs->strings, "strings"));
+  SVN_ERR (cleanup_fs_db (fs, &fs->activities, "activities"));
 
   /* Checkpoint any changes.  */
   {
@@ -382,6 +386,18 @@ svn_fs_berkeley_path (svn_fs_t *fs, apr_pool_t *pool)
 }
 
 
+void
+svn_fs_trail_stats (unsigned long *trails,
+                    unsigned long *deadlock_retries,
+                    svn_fs_t *fs)
+{
+  if (trails)
+    *trails = fs->trails;
+  if (deadlock_retries)
+    *deadlock_retries = fs->deadlock_retries;
+}
+
+
 
 svn_error_t *
 svn_fs_create_berkeley (svn_fs_t *fs, const char *path)
@@ -474,6 +490,10 @@ svn_fs_create_berkeley (svn_fs_t *fs, const char *path)
                      svn_fs__open_strings_table (&fs->strings,
                                                  fs->env, 1));
   if (svn_err) goto error;
+  svn_err = DB_WRAP (fs, "creating `activities' table",
+                     svn_fs__open_activities_table (&fs->activities,
+                                                    fs->env, 1));
+  if (svn_err) goto error;
 
   /* Initialize the DAG subsystem. */
   svn_err = svn_fs__dag_init_fs (fs);
@@ -533,6 +553,10 @@ svn_fs_open_berkeley (svn_fs_t *fs, const char *path)
                      svn_fs__open_strings_table (&fs->strings,
                                                  fs->env, 0));
   if (svn_err) goto error;
+  svn_err = DB_WRAP (fs, "opening `activities' table",
+                     svn_fs__open_activities_table (&fs->activities,
+                                                    fs->env, 0));
+  if (svn_err) goto error;
 
   return SVN_NO_ERROR;
   
@@ -546,9 +570,13 @@ svn_fs_open_berkeley (svn_fs_t *fs, const char *path)
 /* Running recovery on a Berkeley DB-based filesystem.  */
 
 
-svn_error_t *
-svn_fs_berkeley_recover (const char *path,
-                         apr_pool_t *pool)
+/* Run recovery on the Berkeley DB environment at PATH, passing
+   RECOVER_FLAG (DB_RECOVER or DB_RECOVER_FATAL) to the environment's
+   open.  Use POOL for any errors.  */
+static svn_error_t *
+run_recovery (const char *path,
+              u_int32_t recover_flag,
+              apr_pool_t *pool)
 {
   int db_err;
   DB_ENV *env;
@@ -567,7 +595,7 @@ svn_fs_berkeley_recover (const char *path,
      we leave the region around, the application that should create
      it will simply join it instead, and will then be running with
      incorrectly sized (and probably terribly small) caches.  */
-  db_err = env->open (env, path, (DB_RECOVER | DB_CREATE
+  db_err = env->open (env, path, (recover_flag | DB_CREATE
                                   | DB_INIT_LOCK | DB_INIT_LOG
                                   | DB_INIT_MPOOL | DB_INIT_TXN
                                   | DB_PRIVATE),
@@ -583,6 +611,167 @@ svn_fs_berkeley_recover (const char *path,
 }
 
 
+svn_error_t *
+svn_fs_berkeley_recover (const char *path,
+                         apr_pool_t *pool)
+{
+  return run_recovery (path, DB_RECOVER, pool);
+}
+
+
+
+/* Hot copies of a Berkeley DB-based filesystem.  */
+
+/* This follows the Berkeley DB hot backup procedure: force a
+   checkpoint, copy the database files, then copy every log file, and
+   run catastrophic recovery on the copy.  The database files may
+   change while they are being copied, but the logs are copied after
+   them and so record every change the copies might have missed;
+   recovery replays those changes.  Bringing a copy up to date means
+   copying just the log files written since, and recovering again.  */
+
+/* The database files of a filesystem, relative to its environment.  */
+static const char * const db_files[] =
+{
+  "nodes",
+  "revisions",
+  "transactions",
+  "representations",
+  "strings",
+  "activities",
+  NULL
+};
+
+
+/* Copy the file NAME from the directory SRC_DIR into the directory
+   DEST_DIR.  Use POOL for all allocations.  */
+static svn_error_t *
+copy_env_file (const char *src_dir,
+               const char *dest_dir,
+               const char *name,
+               apr_pool_t *pool)
+{
+  return svn_io_copy_file (apr_psprintf (pool, "%s/%s", src_dir, name),
+                           apr_psprintf (pool, "%s/%s", dest_dir, name),
+                           TRUE, pool);
+}
+
+
+/* Copy the log files of FS's environment into DEST_PATH, in order,
+   skipping any whose names sort before SINCE if SINCE is non-null.
+   Use POOL for all allocations.  */
+static svn_error_t *
+copy_log_files (svn_fs_t *fs,
+                const char *dest_path,
+                const char *since,
+                apr_pool_t *pool)
+{
+  char **logs, **log;
+  svn_error_t *err = SVN_NO_ERROR;
+
+  /* Relative names, so they're the same in the copy. */
+  SVN_ERR (DB_WRAP (fs, "listing log files",
+                    fs->env->log_archive (fs->env, &logs, DB_ARCH_LOG)));
+  if (! logs)
+    return SVN_NO_ERROR;
+
+  for (log = logs; *log && ! err; log++)
+    if (! since || strcmp (*log, since) >= 0)
+      err = copy_env_file (fs->path, dest_path, *log, pool);
+
+  /* Berkeley DB allocated the list with malloc.  */
+  free (logs);
+  return err;
+}
+
+
+/* Set *NEWEST_P to the name of the newest log file in the Berkeley DB
+   environment directory PATH, or to NULL if it has none.  Log file
+   names are fixed-width, so the newest sorts last.  Allocate *NEWEST_P
+   in POOL.  */
+static svn_error_t *
+newest_log_file (const char **newest_p,
+                 const char *path,
+                 apr_pool_t *pool)
+{
+  apr_hash_t *dirents;
+  apr_hash_index_t *hi;
+  const char *newest = NULL;
+
+  SVN_ERR (svn_io_get_dirents (&dirents, svn_stringbuf_create (path, pool),
+                               pool));
+  for (hi = apr_hash_first (pool, dirents); hi; hi = apr_hash_next (hi))
+    {
+      const void *key;
+      const char *name;
+
+      apr_hash_this (hi, &key, NULL, NULL);
+      name = key;
+      if (strncmp (name, "log.", 4) == 0
+          && (! newest || strcmp (name, newest) > 0))
+        newest = name;
+    }
+
+  *newest_p = newest;
+  return SVN_NO_ERROR;
+}
+
+
+svn_error_t *
+svn_fs_hotcopy_berkeley (svn_fs_t *fs,
+                         const char *dest_path,
+                         svn_boolean_t incremental,
+                         apr_pool_t *pool)
+{
+  const char *since = NULL;
+  apr_status_t apr_err;
+  int i;
+
+  SVN_ERR (svn_fs__check_fs (fs));
+
+  /* Make the recovery ahead of us as short as possible. */
+  {
+    int db_err = fs->env->txn_checkpoint (fs->env, 0, 0, DB_FORCE);
+
+    while (db_err == DB_INCOMPLETE)
+      {
+        apr_sleep (1000000L); /* microseconds, so 1000000L == 1 second */
+        db_err = fs->env->txn_checkpoint (fs->env, 0, 0, DB_FORCE);
+      }
+    SVN_ERR (DB_WRAP (fs, "checkpointing before a hot copy", db_err));
+  }
+
+  if (incremental)
+    {
+      /* The copy's newest log file has probably grown since it was
+         copied, so start with that one.  */
+      SVN_ERR (newest_log_file (&since, dest_path, pool));
+      if (! since)
+        return svn_error_createf
+          (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+           "`%s' has no log files, so it is not a hot copy", dest_path);
+    }
+  else
+    {
+      apr_err = apr_dir_make (dest_path, APR_OS_DEFAULT, pool);
+      if (! APR_STATUS_IS_SUCCESS (apr_err))
+        return svn_error_createf (apr_err, 0, NULL, pool,
+                                  "creating Berkeley DB environment dir `%s'",
+                                  dest_path);
+
+      SVN_ERR (copy_env_file (fs->path, dest_path, "DB_CONFIG", pool));
+      for (i = 0; db_files[i]; i++)
+        SVN_ERR (copy_env_file (fs->path, dest_path, db_files[i], pool));
+    }
+
+  SVN_ERR (copy_log_files (fs, dest_path, since, pool));
+
+  /* Replay the logs against the copied databases. */
+  return run_recovery (dest_path, DB_RECOVER_FATAL, pool);
+}
+
+
+
 
 /* Deleting a Berkeley DB-based filesystem.  */
 
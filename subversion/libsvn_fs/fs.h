@@ -46,6 +46,7 @@ struct svn_fs_t {
 
   /* The filesystem's various tables.  See `structure' for details.  */
   DB *nodes, *revisions, *transactions, *representations, *strings;
+  DB *activities;
 
   /* A callback function for printing warning messages, and a baton to
      pass through to it.  */
@@ -74,6 +75,12 @@ struct svn_fs_t {
      fs_cleanup won't overwrite a pointer to an existing svn_error_t
      if it finds one.  */
   svn_error_t **cleanup_error;
+
+  /* The number of Berkeley DB transactions begun in this filesystem,
+     and how many of those were retried after a deadlock.  See
+     svn_fs_trail_stats.  */
+  unsigned long trails;
+  unsigned long deadlock_retries;
 };
 
 
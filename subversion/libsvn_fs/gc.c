@@ -0,0 +1,685 @@
+/* gc.c : collecting garbage nodes, representations and strings
+ *
+ * ====================================================================
+ * Copyright (c) 2000-2002 CollabNet.  All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.  The terms
+ * are also available at http://subversion.tigris.org/license-1.html.
+ * If newer versions of this license are posted there, you may use a
+ * newer version instead, at your option.
+ *
+ * This software consists of voluntary contributions made by many
+ * individuals.  For exact contribution history, see the revision
+ * history and logs, available at http://subversion.tigris.org/.
+ * ====================================================================
+ */
+
+#include <string.h>
+#include <apr_pools.h>
+#include <apr_hash.h>
+
+#include "svn_pools.h"
+#include "svn_fs.h"
+#include "db.h"
+#include "fs.h"
+#include "err.h"
+#include "dbt.h"
+#include "trail.h"
+#include "id.h"
+#include "skel.h"
+#include "dag.h"
+#include "node-rev.h"
+#include "nodes-table.h"
+#include "txn-table.h"
+#include "reps-table.h"
+#include "strings-table.h"
+#include "reps-strings.h"
+#include "key-gen.h"
+
+
+
+/* How garbage collection works.  */
+
+/* Garbage is anything a crashed or careless client left behind:
+
+   - mutable node revisions that no live transaction can reach,
+     because the transaction that made them was removed without
+     cleaning up after itself, or because they were unlinked from a
+     transaction's tree without being deleted;
+
+   - representations that no node revision, and no other
+     representation's delta windows, refer to; and
+
+   - strings that no representation refers to.
+
+   Immutable node revisions are never garbage: they were all reachable
+   from a revision root when they were committed, and revisions are
+   forever.
+
+   The collector runs in five passes over the `nodes',
+   `representations' and `strings' tables, each a series of trails
+   covering at most BATCH_SIZE records apiece, so that it never holds
+   a Berkeley DB transaction open for long, and other processes can
+   keep using the filesystem while it runs.
+
+   First, it reads the `next-key' values of the `representations' and
+   `strings' tables.  Keys are handed out in increasing order, and a
+   new rep or string is always created in the same trail as whatever
+   refers to it, so anything whose key sorts at or after these
+   watermarks was created after the collection began, and is left
+   alone.
+
+   Second, it sweeps the `nodes' table.  Each batch works out, in its
+   own trail, which mutable node revisions the live transactions can
+   reach, and deletes the mutable ones in the batch that aren't among
+   them, along with their mutable representations.
+
+   Third, it marks every representation a node revision refers to,
+   and everything those representations use as delta bases.
+
+   Fourth, it sweeps the `representations' table, deleting the
+   unmarked representations below the watermark, with their strings.
+
+   Fifth, it marks every string the remaining representations refer
+   to, and sweeps the `strings' table the same way.
+
+   Every batch commits on its own, so an interrupted collection loses
+   nothing; running it again picks up whatever garbage is left.  */
+
+
+/* How many records to handle per trail, if the caller doesn't say.  */
+#define DEFAULT_BATCH_SIZE 500
+
+
+
+/* Reading the watermarks.  */
+
+struct watermark_args
+{
+  svn_fs_t *fs;
+  const char *reps_key;         /* OUT parameter */
+  const char *strings_key;      /* OUT parameter */
+  apr_pool_t *pool;
+};
+
+
+/* Set *KEY_P to the value of the `next-key' key in TABLE, which is one
+   of FS's tables, as part of TRAIL.  Allocate *KEY_P in POOL.  */
+static svn_error_t *
+get_next_key (const char **key_p,
+              svn_fs_t *fs,
+              DB *table,
+              apr_pool_t *pool,
+              trail_t *trail)
+{
+  DBT query, result;
+
+  svn_fs__str_to_dbt (&query, (char *) svn_fs__next_key_key);
+  SVN_ERR (DB_WRAP (fs, "collecting garbage (getting next-key)",
+                    table->get (table, trail->db_txn, &query,
+                                svn_fs__result_dbt (&result), 0)));
+  svn_fs__track_dbt (&result, trail->pool);
+
+  *key_p = apr_pstrndup (pool, result.data, result.size);
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+txn_body_get_watermarks (void *baton, trail_t *trail)
+{
+  struct watermark_args *args = baton;
+
+  SVN_ERR (get_next_key (&args->reps_key, args->fs,
+                         args->fs->representations, args->pool, trail));
+  SVN_ERR (get_next_key (&args->strings_key, args->fs,
+                         args->fs->strings, args->pool, trail));
+  return SVN_NO_ERROR;
+}
+
+
+
+/* Deleting dead mutable node revisions.  */
+
+/* Add to LIVE the ID of node revision ID in FS, and those of all its
+   descendants, as long as they are mutable, as part of TRAIL.  The
+   keys of LIVE are unparsed node revision IDs.  Allocate them in
+   TRAIL->pool.  */
+static svn_error_t *
+mark_mutable_tree (apr_hash_t *live,
+                   svn_fs_t *fs,
+                   svn_fs_id_t *id,
+                   trail_t *trail)
+{
+  dag_node_t *node;
+  svn_boolean_t is_mutable;
+  svn_stringbuf_t *unparsed;
+
+  SVN_ERR (svn_fs__dag_get_node (&node, fs, id, trail));
+  SVN_ERR (svn_fs__dag_check_mutable (&is_mutable, node, trail));
+
+  /* An immutable node's descendants are all immutable too. */
+  if (! is_mutable)
+    return SVN_NO_ERROR;
+
+  unparsed = svn_fs_unparse_id (id, trail->pool);
+  apr_hash_set (live, unparsed->data, unparsed->len, (void *) 1);
+
+  if (svn_fs__dag_is_directory (node))
+    {
+      skel_t *entries, *entry;
+      SVN_ERR (svn_fs__dag_dir_entries_skel (&entries, node, trail));
+
+      for (entry = entries->children; entry; entry = entry->next)
+        {
+          skel_t *id_skel = entry->children->next;
+          svn_fs_id_t *this_id
+            = svn_fs_parse_id (id_skel->data, id_skel->len, trail->pool);
+
+          SVN_ERR (mark_mutable_tree (live, fs, this_id, trail));
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Set *LIVE_P to a hash whose keys are the unparsed IDs of all the
+   mutable node revisions reachable from the roots of FS's live
+   transactions, as part of TRAIL.  Allocate it in TRAIL->pool.  */
+static svn_error_t *
+get_live_nodes (apr_hash_t **live_p,
+                svn_fs_t *fs,
+                trail_t *trail)
+{
+  apr_hash_t *live = apr_hash_make (trail->pool);
+  char **names;
+
+  SVN_ERR (svn_fs__get_txn_list (&names, fs, trail->pool, trail));
+  for (; *names; names++)
+    {
+      svn_fs_id_t *root_id, *base_root_id;
+
+      SVN_ERR (svn_fs__get_txn_ids (&root_id, &base_root_id,
+                                    fs, *names, trail));
+      SVN_ERR (mark_mutable_tree (live, fs, root_id, trail));
+    }
+
+  *live_p = live;
+  return SVN_NO_ERROR;
+}
+
+
+/* Delete the representation whose key is the atom KEY_SKEL from FS,
+   if it is mutable, as part of TRAIL.  Do nothing if KEY_SKEL is
+   null or empty, or if there is no such representation.  */
+static svn_error_t *
+delete_mutable_rep (svn_fs_t *fs, skel_t *key_skel, trail_t *trail)
+{
+  const char *key;
+  svn_error_t *err;
+
+  if (! key_skel || key_skel->len == 0)
+    return SVN_NO_ERROR;
+
+  key = apr_pstrndup (trail->pool, key_skel->data, key_skel->len);
+  err = svn_fs__delete_rep_if_mutable (fs, key, trail);
+  if (err && err->apr_err == SVN_ERR_FS_NO_SUCH_REPRESENTATION)
+    {
+      svn_error_clear_all (err);
+      return SVN_NO_ERROR;
+    }
+
+  return err;
+}
+
+
+struct sweep_nodes_args
+{
+  svn_fs_t *fs;
+  const svn_fs_id_t *after;
+  int batch_size;
+  const svn_fs_id_t *last;      /* OUT: the batch's last ID, or null */
+  int deleted;                  /* OUT parameter */
+  apr_pool_t *pool;
+};
+
+
+static svn_error_t *
+txn_body_sweep_nodes (void *baton, trail_t *trail)
+{
+  struct sweep_nodes_args *args = baton;
+  apr_array_header_t *ids;
+  apr_hash_t *live = NULL;
+  int i;
+
+  args->last = NULL;
+  args->deleted = 0;
+
+  SVN_ERR (svn_fs__get_node_ids (&ids, args->fs, args->after,
+                                 args->batch_size, trail->pool, trail));
+
+  for (i = 0; i < ids->nelts; i++)
+    {
+      svn_fs_id_t *id = APR_ARRAY_IDX (ids, i, svn_fs_id_t *);
+      svn_stringbuf_t *unparsed;
+      skel_t *node_rev;
+
+      SVN_ERR (svn_fs__get_node_revision (&node_rev, args->fs, id, trail));
+      if (SVN_FS__NR_HDR_REV (SVN_FS__NR_HEADER (node_rev))->len != 0)
+        continue;
+
+      /* Only walk the transactions once the batch turns out to have
+         something mutable in it; most batches are all committed
+         node revisions.  */
+      if (! live)
+        SVN_ERR (get_live_nodes (&live, args->fs, trail));
+
+      unparsed = svn_fs_unparse_id (id, trail->pool);
+      if (apr_hash_get (live, unparsed->data, unparsed->len))
+        continue;
+
+      /* Its directory entries, if any, are in this same table, and
+         get their turn.  */
+      SVN_ERR (delete_mutable_rep (args->fs, SVN_FS__NR_PROP_KEY (node_rev),
+                                   trail));
+      SVN_ERR (delete_mutable_rep (args->fs, SVN_FS__NR_DATA_KEY (node_rev),
+                                   trail));
+      SVN_ERR (delete_mutable_rep (args->fs, SVN_FS__NR_EDIT_KEY (node_rev),
+                                   trail));
+      SVN_ERR (svn_fs__delete_node_revision (args->fs, id, trail));
+      args->deleted++;
+    }
+
+  if (ids->nelts)
+    args->last = svn_fs__id_copy (APR_ARRAY_IDX (ids, ids->nelts - 1,
+                                                 svn_fs_id_t *),
+                                  args->pool);
+  return SVN_NO_ERROR;
+}
+
+
+
+/* Marking representations and strings.  */
+
+/* Add the atom KEY_SKEL to the set MARKED, allocating the key in
+   MARKED's pool, unless KEY_SKEL is null or empty.  */
+static void
+mark_key_skel (apr_hash_t *marked, skel_t *key_skel)
+{
+  if (key_skel && key_skel->len)
+    apr_hash_set (marked,
+                  apr_pstrndup (apr_hash_pool_get (marked),
+                                key_skel->data, key_skel->len),
+                  key_skel->len, (void *) 1);
+}
+
+
+struct mark_nodes_args
+{
+  svn_fs_t *fs;
+  const svn_fs_id_t *after;
+  int batch_size;
+  apr_hash_t *marked;
+  const svn_fs_id_t *last;      /* OUT: the batch's last ID, or null */
+  apr_pool_t *pool;
+};
+
+
+/* Add to ARGS->marked the representations that a batch of node
+   revisions refer to.  Marking is idempotent, so it doesn't matter if
+   a retried trail marks the same reps again.  */
+static svn_error_t *
+txn_body_mark_nodes (void *baton, trail_t *trail)
+{
+  struct mark_nodes_args *args = baton;
+  apr_array_header_t *ids;
+  int i;
+
+  args->last = NULL;
+
+  SVN_ERR (svn_fs__get_node_ids (&ids, args->fs, args->after,
+                                 args->batch_size, trail->pool, trail));
+
+  for (i = 0; i < ids->nelts; i++)
+    {
+      skel_t *node_rev;
+
+      SVN_ERR (svn_fs__get_node_revision
+               (&node_rev, args->fs, APR_ARRAY_IDX (ids, i, svn_fs_id_t *),
+                trail));
+      mark_key_skel (args->marked, SVN_FS__NR_PROP_KEY (node_rev));
+      mark_key_skel (args->marked, SVN_FS__NR_DATA_KEY (node_rev));
+      mark_key_skel (args->marked, SVN_FS__NR_EDIT_KEY (node_rev));
+    }
+
+  if (ids->nelts)
+    args->last = svn_fs__id_copy (APR_ARRAY_IDX (ids, ids->nelts - 1,
+                                                 svn_fs_id_t *),
+                                  args->pool);
+  return SVN_NO_ERROR;
+}
+
+
+struct scan_reps_args
+{
+  svn_fs_t *fs;
+  const char *after;
+  int batch_size;
+
+  /* If non-null, map each delta rep's key to an array of the keys of
+     its delta bases. */
+  apr_hash_t *bases;
+
+  /* If non-null, mark the strings the reps refer to. */
+  apr_hash_t *strings;
+
+  const char *last;             /* OUT: the batch's last key, or null */
+  apr_pool_t *pool;
+};
+
+
+static svn_error_t *
+txn_body_scan_reps (void *baton, trail_t *trail)
+{
+  struct scan_reps_args *args = baton;
+  apr_array_header_t *keys;
+  int i, j;
+
+  args->last = NULL;
+
+  SVN_ERR (svn_fs__get_rep_keys (&keys, args->fs, args->after,
+                                 args->batch_size, trail->pool, trail));
+
+  for (i = 0; i < keys->nelts; i++)
+    {
+      const char *key = APR_ARRAY_IDX (keys, i, const char *);
+      apr_array_header_t *str_keys, *base_keys;
+
+      SVN_ERR (svn_fs__rep_refs (&str_keys, &base_keys, args->fs, key,
+                                 trail->pool, trail));
+
+      if (args->bases && base_keys->nelts)
+        {
+          apr_array_header_t *copy
+            = apr_array_make (args->pool, base_keys->nelts,
+                              sizeof (const char *));
+
+          for (j = 0; j < base_keys->nelts; j++)
+            (*((const char **) apr_array_push (copy)))
+              = apr_pstrdup (args->pool,
+                             APR_ARRAY_IDX (base_keys, j, const char *));
+          apr_hash_set (args->bases, apr_pstrdup (args->pool, key),
+                        APR_HASH_KEY_STRING, copy);
+        }
+
+      if (args->strings)
+        for (j = 0; j < str_keys->nelts; j++)
+          apr_hash_set (args->strings,
+                        apr_pstrdup (args->pool,
+                                     APR_ARRAY_IDX (str_keys, j,
+                                                    const char *)),
+                        APR_HASH_KEY_STRING, (void *) 1);
+    }
+
+  if (keys->nelts)
+    args->last = apr_pstrdup (args->pool,
+                              APR_ARRAY_IDX (keys, keys->nelts - 1,
+                                             const char *));
+  return SVN_NO_ERROR;
+}
+
+
+/* Add to MARKED every rep reachable through the delta base map BASES
+   from a rep that is already in MARKED, or whose key is not less than
+   WATERMARK.  Allocate in POOL.  */
+static void
+mark_delta_bases (apr_hash_t *marked,
+                  apr_hash_t *bases,
+                  const char *watermark,
+                  apr_pool_t *pool)
+{
+  apr_array_header_t *todo = apr_array_make (pool, 64, sizeof (const char *));
+  apr_hash_index_t *hi;
+
+  for (hi = apr_hash_first (pool, bases); hi; hi = apr_hash_next (hi))
+    {
+      const void *key;
+      apr_hash_this (hi, &key, NULL, NULL);
+
+      if (apr_hash_get (marked, key, APR_HASH_KEY_STRING)
+          || svn_fs__key_compare (key, watermark) >= 0)
+        (*((const char **) apr_array_push (todo))) = key;
+    }
+
+  while (todo->nelts)
+    {
+      const char *key = *((const char **) apr_array_pop (todo));
+      apr_array_header_t *base_keys
+        = apr_hash_get (bases, key, APR_HASH_KEY_STRING);
+      int i;
+
+      if (! base_keys)
+        continue;
+
+      for (i = 0; i < base_keys->nelts; i++)
+        {
+          const char *base = APR_ARRAY_IDX (base_keys, i, const char *);
+
+          if (! apr_hash_get (marked, base, APR_HASH_KEY_STRING))
+            {
+              apr_hash_set (marked, base, APR_HASH_KEY_STRING, (void *) 1);
+              (*((const char **) apr_array_push (todo))) = base;
+            }
+        }
+    }
+}
+
+
+
+/* Sweeping representations and strings.  */
+
+struct sweep_keys_args
+{
+  svn_fs_t *fs;
+  const char *after;
+  int batch_size;
+
+  /* Sweep the `strings' table if true, else `representations'. */
+  svn_boolean_t strings;
+
+  /* Delete everything not in MARKED whose key sorts before WATERMARK. */
+  apr_hash_t *marked;
+  const char *watermark;
+
+  const char *last;             /* OUT: the batch's last key, or null */
+  int deleted;                  /* OUT parameter */
+  apr_pool_t *pool;
+};
+
+
+static svn_error_t *
+txn_body_sweep_keys (void *baton, trail_t *trail)
+{
+  struct sweep_keys_args *args = baton;
+  apr_array_header_t *keys;
+  int i;
+
+  args->last = NULL;
+  args->deleted = 0;
+
+  if (args->strings)
+    SVN_ERR (svn_fs__get_string_keys (&keys, args->fs, args->after,
+                                      args->batch_size, trail->pool, trail));
+  else
+    SVN_ERR (svn_fs__get_rep_keys (&keys, args->fs, args->after,
+                                   args->batch_size, trail->pool, trail));
+
+  for (i = 0; i < keys->nelts; i++)
+    {
+      const char *key = APR_ARRAY_IDX (keys, i, const char *);
+
+      if (svn_fs__key_compare (key, args->watermark) >= 0
+          || apr_hash_get (args->marked, key, APR_HASH_KEY_STRING))
+        continue;
+
+      if (args->strings)
+        SVN_ERR (svn_fs__string_delete (args->fs, key, trail));
+      else
+        SVN_ERR (svn_fs__rep_delete (args->fs, key, trail));
+      args->deleted++;
+    }
+
+  if (keys->nelts)
+    args->last = apr_pstrdup (args->pool,
+                              APR_ARRAY_IDX (keys, keys->nelts - 1,
+                                             const char *));
+  return SVN_NO_ERROR;
+}
+
+
+
+/* The collector.  */
+
+svn_error_t *
+svn_fs_gc (svn_fs_gc_stats_t *stats,
+           svn_fs_t *fs,
+           int batch_size,
+           apr_pool_t *pool)
+{
+  struct watermark_args wm_args;
+  struct sweep_nodes_args node_args;
+  struct mark_nodes_args mark_args;
+  struct scan_reps_args scan_args;
+  struct sweep_keys_args sweep_args;
+  svn_fs_gc_stats_t counts;
+  apr_hash_t *marked_reps = apr_hash_make (pool);
+  apr_hash_t *marked_strings = apr_hash_make (pool);
+  apr_pool_t *subpool;
+
+  SVN_ERR (svn_fs__check_fs (fs));
+
+  if (batch_size <= 0)
+    batch_size = DEFAULT_BATCH_SIZE;
+  memset (&counts, 0, sizeof (counts));
+  subpool = svn_pool_create (pool);
+
+  /* Anything created from here on is not garbage. */
+  wm_args.fs = fs;
+  wm_args.pool = pool;
+  SVN_ERR (svn_fs__retry_txn (fs, txn_body_get_watermarks, &wm_args,
+                              subpool));
+  svn_pool_clear (subpool);
+
+  /* Delete the mutable node revisions no transaction can reach. */
+  memset (&node_args, 0, sizeof (node_args));
+  node_args.fs = fs;
+  node_args.batch_size = batch_size;
+  node_args.pool = pool;
+  do
+    {
+      SVN_ERR (svn_fs__retry_txn (fs, txn_body_sweep_nodes, &node_args,
+                                  subpool));
+      svn_pool_clear (subpool);
+      counts.nodes += node_args.deleted;
+      node_args.after = node_args.last;
+    }
+  while (node_args.last);
+
+  /* Mark the reps that the surviving node revisions refer to, ... */
+  memset (&mark_args, 0, sizeof (mark_args));
+  mark_args.fs = fs;
+  mark_args.batch_size = batch_size;
+  mark_args.marked = marked_reps;
+  mark_args.pool = pool;
+  do
+    {
+      SVN_ERR (svn_fs__retry_txn (fs, txn_body_mark_nodes, &mark_args,
+                                  subpool));
+      svn_pool_clear (subpool);
+      mark_args.after = mark_args.last;
+    }
+  while (mark_args.last);
+
+  /* ... and the reps that those, and new reps, are deltas against. */
+  memset (&scan_args, 0, sizeof (scan_args));
+  scan_args.fs = fs;
+  scan_args.batch_size = batch_size;
+  scan_args.bases = apr_hash_make (pool);
+  scan_args.pool = pool;
+  do
+    {
+      SVN_ERR (svn_fs__retry_txn (fs, txn_body_scan_reps, &scan_args,
+                                  subpool));
+      svn_pool_clear (subpool);
+      scan_args.after = scan_args.last;
+    }
+  while (scan_args.last);
+  mark_delta_bases (marked_reps, scan_args.bases, wm_args.reps_key, pool);
+
+  /* Sweep the reps. */
+  memset (&sweep_args, 0, sizeof (sweep_args));
+  sweep_args.fs = fs;
+  sweep_args.batch_size = batch_size;
+  sweep_args.strings = FALSE;
+  sweep_args.marked = marked_reps;
+  sweep_args.watermark = wm_args.reps_key;
+  sweep_args.pool = pool;
+  do
+    {
+      SVN_ERR (svn_fs__retry_txn (fs, txn_body_sweep_keys, &sweep_args,
+                                  subpool));
+      svn_pool_clear (subpool);
+      counts.reps += sweep_args.deleted;
+      sweep_args.after = sweep_args.last;
+    }
+  while (sweep_args.last);
+
+  /* Mark the strings the remaining reps refer to. */
+  memset (&scan_args, 0, sizeof (scan_args));
+  scan_args.fs = fs;
+  scan_args.batch_size = batch_size;
+  scan_args.strings = marked_strings;
+  scan_args.pool = pool;
+  do
+    {
+      SVN_ERR (svn_fs__retry_txn (fs, txn_body_scan_reps, &scan_args,
+                                  subpool));
+      svn_pool_clear (subpool);
+      scan_args.after = scan_args.last;
+    }
+  while (scan_args.last);
+
+  /* Sweep the strings. */
+  memset (&sweep_args, 0, sizeof (sweep_args));
+  sweep_args.fs = fs;
+  sweep_args.batch_size = batch_size;
+  sweep_args.strings = TRUE;
+  sweep_args.marked = marked_strings;
+  sweep_args.watermark = wm_args.strings_key;
+  sweep_args.pool = pool;
+  do
+    {
+      SVN_ERR (svn_fs__retry_txn (fs, txn_body_sweep_keys, &sweep_args,
+                                  subpool));
+      svn_pool_clear (subpool);
+      counts.strings += sweep_args.deleted;
+      sweep_args.after = sweep_args.last;
+    }
+  while (sweep_args.last);
+
+  svn_pool_destroy (subpool);
+
+  if (stats)
+    *stats = counts;
+  return SVN_NO_ERROR;
+}
+
+
+
+/*
+ * local variables:
+ * eval: (load-file "../../tools/dev/svn-dev.el")
+ * end:
+ */
@@ -15,6 +15,7 @@
  * ====================================================================
  */
 
+#include <string.h>
 #include "apr.h"
 #include "key-gen.h"
 
@@ -178,6 +179,24 @@ svn_fs__next_key (const char *this, apr_size_t *len, char *next)
 }
 
 
+int
+svn_fs__key_compare (const char *a, const char *b)
+{
+  apr_size_t a_len = strlen (a);
+  apr_size_t b_len = strlen (b);
+  int cmp;
+
+  /* Keys never have leading zeros, so a longer key is a bigger
+     number; and the digits sort in ASCII order.  */
+  if (a_len > b_len)
+    return 1;
+  if (b_len > a_len)
+    return -1;
+  cmp = strcmp (a, b);
+  return (cmp > 0 ? 1 : (cmp < 0 ? -1 : 0));
+}
+
+
 
 
 /* 
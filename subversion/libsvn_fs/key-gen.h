@@ -71,6 +71,12 @@ extern const char svn_fs__next_key_key[];
 void svn_fs__next_key (const char *this, apr_size_t *len, char *next);
 
 
+/* Compare two keys A and B, as generated by svn_fs__next_key.  Return
+   -1, 0, or 1 if A is less than, equal to, or greater than B.  Keys
+   are handed out in increasing order, so a key that compares less
+   than the current `next-key' value was allocated before it was read.  */
+int svn_fs__key_compare (const char *a, const char *b);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
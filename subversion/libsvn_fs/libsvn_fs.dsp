@@ -87,6 +87,10 @@ LIB32=link.exe -lib
 # PROP Default_Filter "cpp;c;cxx;rc;def;r;odl;idl;hpj;bat"
 # Begin Source File
 
+SOURCE=".\activities-table.c"
+# End Source File
+# Begin Source File
+
 SOURCE=.\dag.c
 # End Source File
 # Begin Source File
@@ -107,6 +111,10 @@ SOURCE=.\fs.c
 # End Source File
 # Begin Source File
 
+SOURCE=.\gc.c
+# End Source File
+# Begin Source File
+
 SOURCE=.\id.c
 # End Source File
 # Begin Source File
@@ -165,12 +173,20 @@ SOURCE=.\txn.c
 
 SOURCE=.\validate.c
 # End Source File
+# Begin Source File
+
+SOURCE=.\verify.c
+# End Source File
 # End Group
 # Begin Group "Header Files"
 
 # PROP Default_Filter "h;hpp;hxx;hm;inl"
 # Begin Source File
 
+SOURCE=".\activities-table.h"
+# End Source File
+# Begin Source File
+
 SOURCE=".\dag.h"
 # End Source File
 # Begin Source File
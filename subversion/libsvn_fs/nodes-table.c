@@ -511,6 +511,82 @@ svn_fs__delete_nodes_entry (svn_fs_t *fs,
 
 
 
+/* Listing node revision IDs.  */
+
+
+svn_error_t *
+svn_fs__get_node_ids (apr_array_header_t **ids_p,
+                      svn_fs_t *fs,
+                      const svn_fs_id_t *after,
+                      int limit,
+                      apr_pool_t *pool,
+                      trail_t *trail)
+{
+  apr_array_header_t *ids = apr_array_make (pool, 64, sizeof (svn_fs_id_t *));
+  DBC *cursor;
+  DBT key, value;
+  int db_err, db_c_err;
+
+  SVN_ERR (DB_WRAP (fs, "listing node revisions (opening cursor)",
+                    fs->nodes->cursor (fs->nodes, trail->db_txn,
+                                       &cursor, 0)));
+
+  /* Start at the first ID, or at the first one not before AFTER.  */
+  if (after)
+    {
+      svn_fs__id_to_dbt (&key, after, trail->pool);
+      key.flags |= DB_DBT_MALLOC;
+      db_err = cursor->c_get (cursor, &key, svn_fs__nodata_dbt (&value),
+                              DB_SET_RANGE);
+    }
+  else
+    db_err = cursor->c_get (cursor,
+                            svn_fs__result_dbt (&key),
+                            svn_fs__nodata_dbt (&value),
+                            DB_FIRST);
+
+  for (;
+       db_err == 0;
+       db_err = cursor->c_get (cursor,
+                               svn_fs__result_dbt (&key),
+                               svn_fs__nodata_dbt (&value),
+                               DB_NEXT))
+    {
+      svn_fs_id_t *id;
+
+      svn_fs__track_dbt (&key, trail->pool);
+      id = svn_fs_parse_id (key.data, key.size, pool);
+      if (! id)
+        {
+          cursor->c_close (cursor);
+          return svn_fs__err_corrupt_nodes_key (fs);
+        }
+
+      if (after && svn_fs__id_eq (id, after))
+        continue;
+
+      (*((svn_fs_id_t **) apr_array_push (ids))) = id;
+
+      if (limit > 0 && ids->nelts >= limit)
+        break;
+    }
+
+  /* Check for errors, but close the cursor first. */
+  db_c_err = cursor->c_close (cursor);
+  if (db_err && db_err != DB_NOTFOUND)
+    {
+      SVN_ERR (DB_WRAP (fs, "listing node revisions (reading keys)",
+                        db_err));
+    }
+  SVN_ERR (DB_WRAP (fs, "listing node revisions (closing cursor)",
+                    db_c_err));
+
+  *ids_p = ids;
+  return SVN_NO_ERROR;
+}
+
+
+
 /* Storing and retrieving NODE-REVISION skels.  */
 
 
@@ -76,6 +76,20 @@ svn_error_t *svn_fs__new_successor_id (svn_fs_id_t **successor_p,
                                        trail_t *trail);
 
 
+/* Set *IDS_P to an array of the IDs (svn_fs_id_t *) of the node
+   revisions in FS, in table order, as part of TRAIL.  If AFTER is
+   non-null, start with the first ID that sorts after it; if LIMIT is
+   positive, return at most LIMIT IDs.  This works like
+   svn_fs__get_rep_keys, for walking the table in batches.  Allocate
+   the array and the IDs in POOL.  */
+svn_error_t *svn_fs__get_node_ids (apr_array_header_t **ids_p,
+                                   svn_fs_t *fs,
+                                   const svn_fs_id_t *after,
+                                   int limit,
+                                   apr_pool_t *pool,
+                                   trail_t *trail);
+
+
 /* Set *SKEL_P to the NODE-REVISION skel for the node ID in FS, as
    part of TRAIL.  Allocate the skel, and do any other temporary
    allocation, in TRAIL->pool.
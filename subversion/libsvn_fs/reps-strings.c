@@ -99,6 +99,58 @@ rep_set_mutable_flag (skel_t *rep, apr_pool_t *pool)
 }
 
 
+/* Return the MD5 checksum element of representation REP's header,
+   i.e. the list ("md5" DIGEST), or NULL if REP has no checksum.  */
+static skel_t *
+rep_checksum_skel (skel_t *rep)
+{
+  skel_t *flag;
+
+  for (flag = rep->children->children->next; flag; flag = flag->next)
+    if ((! flag->is_atom)
+        && svn_fs__list_length (flag) == 2
+        && svn_fs__matches_atom (flag->children, "md5")
+        && flag->children->next->is_atom
+        && flag->children->next->len == MD5_DIGESTSIZE)
+      return flag;
+
+  return NULL;
+}
+
+
+/* Set the MD5 checksum recorded in representation REP's header to
+   DIGEST, or remove it if DIGEST is null.  Allocate in POOL, which
+   should be at least as long-lived as the pool REP is allocated in.  */
+static void
+rep_set_checksum (skel_t *rep,
+                  const unsigned char *digest,
+                  apr_pool_t *pool)
+{
+  skel_t *header = rep->children;
+  skel_t *old = rep_checksum_skel (rep);
+
+  if (old)
+    {
+      skel_t *prev = header->children;
+
+      while (prev->next != old)
+        prev = prev->next;
+      prev->next = old->next;
+    }
+
+  if (digest)
+    {
+      skel_t *checksum = svn_fs__make_empty_list (pool);
+
+      svn_fs__prepend (svn_fs__mem_atom (apr_pmemdup (pool, digest,
+                                                      MD5_DIGESTSIZE),
+                                         MD5_DIGESTSIZE, pool), checksum);
+      svn_fs__prepend (svn_fs__str_atom ("md5", pool), checksum);
+      svn_fs__append (checksum, header);
+    }
+}
+
+
 /* Return a `fulltext' rep skel which references the string STR_KEY,
    performing allocations in POOL.  If MUTABLE is non-zero, make the
    representation mutable.  If non-NULL, STR_KEY will be copied into
@@ -681,8 +733,10 @@ svn_fs__get_mutable_rep (const char **new_rep,
           SVN_ERR (fulltext_string_key (&old_str, rep_skel, trail->pool));
           SVN_ERR (svn_fs__string_copy (fs, &new_str, old_str, trail));
           
-          /* Step 2:  Make this rep mutable. */
+          /* Step 2:  Make this rep mutable.  Its contents are about
+             to change, so the checksum no longer applies. */
           rep_set_mutable_flag (rep_skel, trail->pool);
+          rep_set_checksum (rep_skel, NULL, trail->pool);
           
           /* Step 3:  Change the string key to which this rep points. */
           rep_skel->children->next->data = new_str;
@@ -738,6 +792,36 @@ svn_fs__get_mutable_rep (const char **new_rep,
 }
 
 
+/* Set DIGEST to the MD5 checksum of the contents of REP in FS,
+   reading the contents as part of TRAIL.  */
+static svn_error_t *
+compute_rep_checksum (unsigned char digest[MD5_DIGESTSIZE],
+                      svn_fs_t *fs,
+                      const char *rep,
+                      trail_t *trail)
+{
+  apr_pool_t *subpool = svn_pool_create (trail->pool);
+  svn_stream_t *stream;
+  apr_md5_ctx_t context;
+  char *buf = apr_palloc (subpool, SVN_STREAM_CHUNK_SIZE);
+  apr_size_t len;
+
+  stream = svn_fs__rep_contents_read_stream (fs, rep, 0, trail, subpool);
+  apr_md5_init (&context);
+  do
+    {
+      len = SVN_STREAM_CHUNK_SIZE;
+      SVN_ERR (svn_stream_read (stream, buf, &len));
+      apr_md5_update (&context, (unsigned char *) buf, len);
+    }
+  while (len);
+  apr_md5_final (digest, &context);
+
+  svn_pool_destroy (subpool);
+  return SVN_NO_ERROR;
+}
+
+
 svn_error_t *
 svn_fs__make_rep_immutable (svn_fs_t *fs,
                             const char *rep,
@@ -745,22 +829,23 @@ svn_fs__make_rep_immutable (svn_fs_t *fs,
 {
   skel_t *rep_skel;
   skel_t *header, *flag, *prev;
+  unsigned char digest[MD5_DIGESTSIZE];
 
   SVN_ERR (svn_fs__read_rep (&rep_skel, fs, rep, trail));
   header = rep_skel->children;
 
   /* The flags start at the 2nd element of the header. */
-  for (flag = header->children->next, prev = NULL;
+  for (flag = header->children->next, prev = header->children;
        flag;
        prev = flag, flag = flag->next)
     {
       if (flag->is_atom && svn_fs__matches_atom (flag, "mutable"))
         {
-          /* We found it.  */
-          if (prev)
-            prev->next = flag->next;
-          else
-            header->children->next = NULL;
+          /* We found it.  Now that the contents can no longer change,
+             record their checksum alongside them.  */
+          prev->next = flag->next;
+          SVN_ERR (compute_rep_checksum (digest, fs, rep, trail));
+          rep_set_checksum (rep_skel, digest, trail->pool);
           
           SVN_ERR (svn_fs__write_rep (fs, rep, rep_skel, trail));
           break;
@@ -771,31 +856,106 @@ svn_fs__make_rep_immutable (svn_fs_t *fs,
 }
 
 
+/* Delete the rep REP, whose skel is REP_SKEL, from FS, along with
+   the strings it refers to, as part of TRAIL.  */
+static svn_error_t *
+delete_rep_and_strings (svn_fs_t *fs,
+                        const char *rep,
+                        skel_t *rep_skel,
+                        trail_t *trail)
+{
+  const char *str_key;
+
+  if (rep_is_fulltext (rep_skel))
+    {
+      SVN_ERR (fulltext_string_key (&str_key, rep_skel, trail->pool));
+      SVN_ERR (svn_fs__string_delete (fs, str_key, trail));
+    }
+  else /* delta */
+    {
+      apr_array_header_t *keys;
+      SVN_ERR (delta_string_keys (&keys, rep_skel, trail->pool));
+      SVN_ERR (delete_strings (keys, fs, trail));
+    }
+
+  SVN_ERR (svn_fs__delete_rep (fs, rep, trail));
+  return SVN_NO_ERROR;
+}
+
+
 svn_error_t *
 svn_fs__delete_rep_if_mutable (svn_fs_t *fs,
                                const char *rep,
                                trail_t *trail)
 {
   skel_t *rep_skel;
-  const char *str_key;
 
   SVN_ERR (svn_fs__read_rep (&rep_skel, fs, rep, trail));
   if (! rep_is_mutable (rep_skel))
     return SVN_NO_ERROR;
 
+  return delete_rep_and_strings (fs, rep, rep_skel, trail);
+}
+
+
+svn_error_t *
+svn_fs__rep_delete (svn_fs_t *fs,
+                    const char *rep,
+                    trail_t *trail)
+{
+  skel_t *rep_skel;
+
+  SVN_ERR (svn_fs__read_rep (&rep_skel, fs, rep, trail));
+  return delete_rep_and_strings (fs, rep, rep_skel, trail);
+}
+
+
+svn_error_t *
+svn_fs__rep_refs (apr_array_header_t **str_keys_p,
+                  apr_array_header_t **base_keys_p,
+                  svn_fs_t *fs,
+                  const char *rep,
+                  apr_pool_t *pool,
+                  trail_t *trail)
+{
+  skel_t *rep_skel;
+  apr_array_header_t *str_keys;
+  apr_array_header_t *base_keys = apr_array_make (pool, 1,
+                                                  sizeof (const char *));
+
+  SVN_ERR (svn_fs__read_rep (&rep_skel, fs, rep, trail));
+
   if (rep_is_fulltext (rep_skel))
     {
-      SVN_ERR (fulltext_string_key (&str_key, rep_skel, trail->pool));
-      SVN_ERR (svn_fs__string_delete (fs, str_key, trail));
+      const char *str_key;
+
+      SVN_ERR (fulltext_string_key (&str_key, rep_skel, pool));
+      str_keys = apr_array_make (pool, 1, sizeof (const char *));
+      (*((const char **) apr_array_push (str_keys))) = str_key;
     }
   else /* delta */
     {
-      apr_array_header_t *keys;
-      SVN_ERR (delta_string_keys (&keys, rep_skel, trail->pool));
-      SVN_ERR (delete_strings (keys, fs, trail));
+      skel_t *chunk;
+
+      SVN_ERR (delta_string_keys (&str_keys, rep_skel, pool));
+
+      /* Each chunk is (OFFSET WINDOW), and a window is
+         (DIFF SIZE CHECKSUM [REP-KEY [REP-OFFSET]]).  */
+      for (chunk = rep_skel->children->next; chunk; chunk = chunk->next)
+        {
+          skel_t *window = chunk->children->next;
+          skel_t *base = window->children->next->next->next;
+
+          if (base && base->is_atom)
+            (*((const char **) apr_array_push (base_keys)))
+              = apr_pstrndup (pool, base->data, base->len);
+        }
     }
 
-  SVN_ERR (svn_fs__delete_rep (fs, rep, trail));
+  if (str_keys_p)
+    *str_keys_p = str_keys;
+  if (base_keys_p)
+    *base_keys_p = base_keys;
   return SVN_NO_ERROR;
 }
 
@@ -942,6 +1102,94 @@ svn_fs__rep_contents (svn_string_t *str,
 }
 
 
+svn_error_t *
+svn_fs__rep_contents_checksum (unsigned char digest[],
+                               svn_fs_t *fs,
+                               const char *rep,
+                               trail_t *trail)
+{
+  skel_t *rep_skel, *checksum;
+
+  SVN_ERR (svn_fs__read_rep (&rep_skel, fs, rep, trail));
+
+  if ((checksum = rep_checksum_skel (rep_skel)))
+    memcpy (digest, checksum->children->next->data, MD5_DIGESTSIZE);
+  else
+    SVN_ERR (compute_rep_checksum (digest, fs, rep, trail));
+
+  return SVN_NO_ERROR;
+}
+
+
+svn_error_t *
+svn_fs__rep_same_contents (int *same_p,
+                           svn_fs_t *fs,
+                           const char *rep1,
+                           const char *rep2,
+                           trail_t *trail)
+{
+  skel_t *rep_skel1, *rep_skel2, *checksum1, *checksum2;
+
+  *same_p = 0;
+  if (strcmp (rep1, rep2) == 0)
+    {
+      *same_p = 1;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR (svn_fs__read_rep (&rep_skel1, fs, rep1, trail));
+  SVN_ERR (svn_fs__read_rep (&rep_skel2, fs, rep2, trail));
+  checksum1 = rep_checksum_skel (rep_skel1);
+  checksum2 = rep_checksum_skel (rep_skel2);
+
+  if (checksum1 && checksum2
+      && memcmp (checksum1->children->next->data,
+                 checksum2->children->next->data, MD5_DIGESTSIZE) == 0)
+    {
+      apr_size_t size1, size2;
+
+      SVN_ERR (svn_fs__rep_contents_size (&size1, fs, rep1, trail));
+      SVN_ERR (svn_fs__rep_contents_size (&size2, fs, rep2, trail));
+      *same_p = (size1 == size2);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+svn_error_t *
+svn_fs__rep_verify (int *checked_p,
+                    svn_fs_t *fs,
+                    const char *rep,
+                    trail_t *trail)
+{
+  skel_t *rep_skel, *checksum;
+  unsigned char digest[MD5_DIGESTSIZE];
+
+  SVN_ERR (svn_fs__read_rep (&rep_skel, fs, rep, trail));
+
+  /* Reconstruct the contents even if there is nothing to check them
+     against; that much, at least, must succeed.  */
+  SVN_ERR (compute_rep_checksum (digest, fs, rep, trail));
+
+  if (rep_is_mutable (rep_skel)
+      || ! (checksum = rep_checksum_skel (rep_skel)))
+    {
+      *checked_p = 0;
+      return SVN_NO_ERROR;
+    }
+
+  if (memcmp (digest, checksum->children->next->data, MD5_DIGESTSIZE) != 0)
+    return svn_error_createf
+      (SVN_ERR_FS_CORRUPT, 0, NULL, trail->pool,
+       "svn_fs__rep_verify: checksum mismatch for representation `%s'",
+       rep);
+
+  *checked_p = 1;
+  return SVN_NO_ERROR;
+}
+
+
 struct read_rep_args
 {
   struct rep_read_baton *rb;   /* The data source.             */
@@ -1396,6 +1644,9 @@ svn_fs__rep_deltify (svn_fs_t *fs,
   /* MD5 digest */
   const unsigned char *digest;
 
+  /* TARGET's rep skel before deltification, and its fulltext checksum */
+  skel_t *old_rep, *checksum;
+
   /* pool for holding the windows */
   apr_pool_t *wpool;
 
@@ -1497,7 +1748,6 @@ svn_fs__rep_deltify (svn_fs_t *fs,
      at it, we might as well figure out all the strings current used
      by REP so we can potentially delete them later. */
   {
-    skel_t *old_rep;
     apr_size_t old_size = 0;
     const char *str_key;
 
@@ -1586,9 +1836,13 @@ svn_fs__rep_deltify (svn_fs_t *fs,
         svn_fs__prepend (winhdr, rep);
       }
 
-    /* Don't forget to prepend the header! */
+    /* Don't forget to prepend the header!  The fulltext hasn't
+       changed, so neither has its checksum.  */
     svn_fs__prepend (svn_fs__str_atom ("delta", trail->pool), header);
     svn_fs__prepend (header, rep);
+    if ((checksum = rep_checksum_skel (old_rep)))
+      rep_set_checksum (rep, (const unsigned char *)
+                        checksum->children->next->data, trail->pool);
 
     /* Write out the new representation. */
     SVN_ERR (svn_fs__write_rep (fs, target, rep, trail));
@@ -1609,7 +1863,7 @@ svn_fs__rep_undeltify (svn_fs_t *fs,
   svn_stream_t *target_stream; /* stream to write the fulltext */
   struct write_string_baton target_baton;
   apr_array_header_t *orig_keys;
-  skel_t *rep_skel;
+  skel_t *rep_skel, *checksum;
   unsigned char buf[65536];
   apr_size_t len;
 
@@ -1652,7 +1906,11 @@ svn_fs__rep_undeltify (svn_fs_t *fs,
   /* Now `target_baton.key' has the key of the new string.  We
      should hook it into the representation.  So we make a new rep,
      write it out... */
+  checksum = rep_checksum_skel (rep_skel);
   rep_skel = make_fulltext_rep_skel (target_baton.key, 0, trail->pool);
+  if (checksum)
+    rep_set_checksum (rep_skel, (const unsigned char *)
+                      checksum->children->next->data, trail->pool);
   SVN_ERR (svn_fs__write_rep (fs, rep, rep_skel, trail));
 
   /* ...then we delete our original strings. */
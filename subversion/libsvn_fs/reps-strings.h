@@ -64,7 +64,8 @@ svn_error_t *svn_fs__get_mutable_rep (const char **new_rep,
                                       trail_t *trail);
 
 
-/* Make REP in FS immutable, if it isn't already, as part of TRAIL.
+/* Make REP in FS immutable, if it isn't already, as part of TRAIL,
+   and record the MD5 checksum of its contents in it.
    If no such rep, return SVN_ERR_FS_NO_SUCH_REPRESENTATION.  */
 svn_error_t *svn_fs__make_rep_immutable (svn_fs_t *fs,
                                          const char *rep,
@@ -81,6 +82,33 @@ svn_error_t *svn_fs__delete_rep_if_mutable (svn_fs_t *fs,
                                             trail_t *trail);
 
 
+/* Delete REP from FS, whether it is mutable or not, along with the
+   strings it refers to, as part of TRAIL.  Any other rep that uses
+   REP as a delta base is left unreadable; only the garbage collector
+   should call this, and only on reps nothing refers to.
+
+   If no such rep, return SVN_ERR_FS_NO_SUCH_REPRESENTATION.  */
+svn_error_t *svn_fs__rep_delete (svn_fs_t *fs,
+                                 const char *rep,
+                                 trail_t *trail);
+
+
+/* Set *STR_KEYS_P to an array of the keys (const char *) of the
+   strings that REP in FS refers to, and *BASE_KEYS_P to an array of
+   the keys of the reps that REP's delta windows use as their bases.
+   A fulltext rep has no bases.  Either of STR_KEYS_P and BASE_KEYS_P
+   may be null.  Allocate the arrays and keys in POOL; do any other
+   allocation in TRAIL->pool.
+
+   If no such rep, return SVN_ERR_FS_NO_SUCH_REPRESENTATION.  */
+svn_error_t *svn_fs__rep_refs (apr_array_header_t **str_keys_p,
+                               apr_array_header_t **base_keys_p,
+                               svn_fs_t *fs,
+                               const char *rep,
+                               apr_pool_t *pool,
+                               trail_t *trail);
+
+
 
 
 /*** Reading and writing rep contents. ***/
@@ -107,6 +135,37 @@ svn_error_t *svn_fs__rep_contents (svn_string_t *str,
                                    trail_t *trail);
 
 
+/* Set DIGEST to the MD5 checksum of REP's contents in FS, as part of
+   TRAIL.  This is the checksum recorded in REP when it was made
+   immutable, if there is one; otherwise it is computed by reading
+   the contents.  */
+svn_error_t *svn_fs__rep_contents_checksum (unsigned char digest[],
+                                            svn_fs_t *fs,
+                                            const char *rep,
+                                            trail_t *trail);
+
+
+/* Set *SAME_P to 1 if REP1 and REP2 in FS are known to have the same
+   contents, as part of TRAIL, without reading those contents: either
+   they are the same rep, or both have recorded checksums which match
+   and their sizes are equal.  Otherwise set *SAME_P to 0.  */
+svn_error_t *svn_fs__rep_same_contents (int *same_p,
+                                        svn_fs_t *fs,
+                                        const char *rep1,
+                                        const char *rep2,
+                                        trail_t *trail);
+
+
+/* Reconstruct the contents of REP in FS as part of TRAIL, and compare
+   them against REP's recorded checksum.  If they don't match, return
+   SVN_ERR_FS_CORRUPT.  Set *CHECKED_P to 1 if there was a checksum to
+   compare against, or to 0 if REP is mutable or predates checksums.  */
+svn_error_t *svn_fs__rep_verify (int *checked_p,
+                                 svn_fs_t *fs,
+                                 const char *rep,
+                                 trail_t *trail);
+
+
 /* Return a stream to read the contents of REP.  Allocate the stream
    in POOL, and start reading at OFFSET in the rep's contents.
 
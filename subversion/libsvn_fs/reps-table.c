@@ -15,6 +15,8 @@
  * ====================================================================
  */
 
+#include <string.h>
+
 #include "db.h"
 #include "svn_fs.h"
 #include "fs.h"
@@ -191,6 +193,79 @@ svn_fs__delete_rep (svn_fs_t *fs, const char *key, trail_t *trail)
 }
 
 
+svn_error_t *
+svn_fs__get_rep_keys (apr_array_header_t **keys_p,
+                      svn_fs_t *fs,
+                      const char *after,
+                      int limit,
+                      apr_pool_t *pool,
+                      trail_t *trail)
+{
+  apr_size_t const next_key_key_len = strlen (svn_fs__next_key_key);
+  apr_array_header_t *keys = apr_array_make (pool, 64, sizeof (const char *));
+  DBC *cursor;
+  DBT key, value;
+  int db_err, db_c_err;
+
+  SVN_ERR (DB_WRAP (fs, "listing representations (opening cursor)",
+                    fs->representations->cursor (fs->representations,
+                                                 trail->db_txn,
+                                                 &cursor, 0)));
+
+  /* Start at the first key, or at the first one not before AFTER.  */
+  if (after)
+    {
+      svn_fs__str_to_dbt (&key, (char *) after);
+      key.flags |= DB_DBT_MALLOC;
+      db_err = cursor->c_get (cursor, &key, svn_fs__nodata_dbt (&value),
+                              DB_SET_RANGE);
+    }
+  else
+    db_err = cursor->c_get (cursor,
+                            svn_fs__result_dbt (&key),
+                            svn_fs__nodata_dbt (&value),
+                            DB_FIRST);
+
+  for (;
+       db_err == 0;
+       db_err = cursor->c_get (cursor,
+                               svn_fs__result_dbt (&key),
+                               svn_fs__nodata_dbt (&value),
+                               DB_NEXT))
+    {
+      svn_fs__track_dbt (&key, trail->pool);
+
+      /* Ignore the "next-key" key, and AFTER itself. */
+      if (key.size == next_key_key_len
+          && 0 == memcmp (key.data, svn_fs__next_key_key, next_key_key_len))
+        continue;
+      if (after
+          && key.size == strlen (after)
+          && 0 == memcmp (key.data, after, key.size))
+        continue;
+
+      (*((const char **) apr_array_push (keys)))
+        = apr_pstrndup (pool, key.data, key.size);
+
+      if (limit > 0 && keys->nelts >= limit)
+        break;
+    }
+
+  /* Check for errors, but close the cursor first. */
+  db_c_err = cursor->c_close (cursor);
+  if (db_err && db_err != DB_NOTFOUND)
+    {
+      SVN_ERR (DB_WRAP (fs, "listing representations (reading keys)",
+                        db_err));
+    }
+  SVN_ERR (DB_WRAP (fs, "listing representations (closing cursor)",
+                    db_c_err));
+
+  *keys_p = keys;
+  return SVN_NO_ERROR;
+}
+
+
 
 /* 
  * local variables:
@@ -75,6 +75,21 @@ svn_error_t *svn_fs__delete_rep (svn_fs_t *fs,
                                  trail_t *trail);
 
 
+/* Set *KEYS_P to an array of the keys (const char *) of the
+   representations in FS, in table order, as part of TRAIL.  If AFTER
+   is non-null, start with the first key that sorts after it; if LIMIT
+   is positive, return at most LIMIT keys.  Callers walking a large
+   table in batches pass the last key of one batch as AFTER for the
+   next, and stop when they get an empty array.  Allocate the array
+   and the keys in POOL.  */
+svn_error_t *svn_fs__get_rep_keys (apr_array_header_t **keys_p,
+                                   svn_fs_t *fs,
+                                   const char *after,
+                                   int limit,
+                                   apr_pool_t *pool,
+                                   trail_t *trail);
+
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -127,6 +127,17 @@ svn_error_t *svn_fs__string_copy (svn_fs_t *fs,
                                   trail_t *trail);
 
 
+/* Set *KEYS_P to an array of the keys (const char *) of the strings
+   in FS, in table order, as part of TRAIL.  AFTER and LIMIT work as
+   for svn_fs__get_rep_keys.  Allocate the array and the keys in
+   POOL.  */
+svn_error_t *svn_fs__get_string_keys (apr_array_header_t **keys_p,
+                                      svn_fs_t *fs,
+                                      const char *after,
+                                      int limit,
+                                      apr_pool_t *pool,
+                                      trail_t *trail);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -122,6 +122,7 @@ svn_fs__retry_txn (svn_fs_t *fs,
       svn_error_t *svn_err;
       
       SVN_ERR (begin_trail (&trail, fs, pool));
+      fs->trails++;
 
       /* Do the body of the transaction.  */
       svn_err = (*txn_body) (baton, trail);
@@ -144,6 +145,7 @@ svn_fs__retry_txn (svn_fs_t *fs,
         }
 
       /* We deadlocked.  Abort the transaction, and try again.  */
+      fs->deadlock_retries++;
       SVN_ERR (abort_trail (trail, fs));
     }
 }
@@ -2002,6 +2002,102 @@ svn_fs_dir_entries (apr_hash_t **table_p,
 }
 
 
+/* Set *INFO_P to the ID, kind and created revision of NODE, as part of
+   TRAIL.  */
+static svn_error_t *
+get_node_info (svn_fs_node_info_t **info_p,
+               dag_node_t *node,
+               trail_t *trail)
+{
+  svn_fs_node_info_t *info = apr_pcalloc (trail->pool, sizeof (*info));
+
+  info->id = svn_fs__id_copy (svn_fs__dag_get_id (node), trail->pool);
+  info->kind = svn_fs__dag_node_kind (node);
+  SVN_ERR (svn_fs__dag_get_revision (&info->created_rev, node, trail));
+
+  *info_p = info;
+  return SVN_NO_ERROR;
+}
+
+
+struct node_info_args
+{
+  svn_fs_node_info_t **info_p;
+  apr_hash_t **entries_p;
+  svn_fs_root_t *root;
+  const char *path;
+};
+
+
+static svn_error_t *
+txn_body_node_info (void *baton,
+                    trail_t *trail)
+{
+  struct node_info_args *args = baton;
+  dag_node_t *node;
+  apr_hash_t *entries;
+  apr_hash_index_t *hi;
+
+  SVN_ERR (get_dag (&node, args->root, args->path, trail));
+  SVN_ERR (get_node_info (args->info_p, node, trail));
+
+  if (! args->entries_p)
+    return SVN_NO_ERROR;
+
+  *args->entries_p = NULL;
+  if (! svn_fs__dag_is_directory (node))
+    return SVN_NO_ERROR;
+
+  /* The entries give us the children's IDs; each child's node
+     revision gives us the rest.  */
+  SVN_ERR (svn_fs__dag_dir_entries_hash (&entries, node, trail));
+  for (hi = apr_hash_first (trail->pool, entries); hi; hi = apr_hash_next (hi))
+    {
+      const void *key;
+      apr_ssize_t klen;
+      void *val;
+      svn_fs_dirent_t *dirent;
+      dag_node_t *child;
+      svn_fs_node_info_t *child_info;
+
+      apr_hash_this (hi, &key, &klen, &val);
+      dirent = val;
+
+      SVN_ERR (svn_fs__dag_get_node (&child, args->root->fs, dirent->id,
+                                     trail));
+      SVN_ERR (get_node_info (&child_info, child, trail));
+      apr_hash_set (entries, key, klen, child_info);
+    }
+
+  *args->entries_p = entries;
+  return SVN_NO_ERROR;
+}
+
+
+svn_error_t *
+svn_fs_node_info (svn_fs_node_info_t **info_p,
+                  apr_hash_t **entries_p,
+                  svn_fs_root_t *root,
+                  const char *path,
+                  apr_pool_t *pool)
+{
+  struct node_info_args args;
+  svn_fs_node_info_t *info;
+  apr_hash_t *entries;
+
+  args.info_p    = &info;
+  args.entries_p = entries_p ? &entries : NULL;
+  args.root      = root;
+  args.path      = path;
+  SVN_ERR (svn_fs__retry_txn (root->fs, txn_body_node_info, &args, pool));
+
+  *info_p = info;
+  if (entries_p)
+    *entries_p = entries;
+  return SVN_NO_ERROR;
+}
+
+
 
 struct make_dir_args
 {
@@ -2407,15 +2503,49 @@ svn_fs_file_length (apr_off_t *length_p,
 }
 
 
+struct file_checksum_args
+{
+  svn_fs_root_t *root;
+  const char *path;
+  unsigned char *digest;  /* OUT parameter, MD5_DIGESTSIZE bytes */
+};
+
+static svn_error_t *
+txn_body_file_checksum (void *baton,
+                        trail_t *trail)
+{
+  struct file_checksum_args *args = baton;
+  dag_node_t *file;
+  
+  SVN_ERR (get_dag (&file, args->root, args->path, trail));
+  return svn_fs__dag_file_checksum (args->digest, file, trail);
+}
+
+svn_error_t *
+svn_fs_file_md5_checksum (unsigned char digest[],
+                          svn_fs_root_t *root,
+                          const char *path,
+                          apr_pool_t *pool)
+{
+  struct file_checksum_args args;
+
+  args.root = root;
+  args.path = path;
+  args.digest = digest;
+  return svn_fs__retry_txn (root->fs, txn_body_file_checksum, &args, pool);
+}
+
+
 /* --- Machinery for svn_fs_file_contents() ---  */
 
 
 /* Local baton type for txn_body_get_file_contents. */
 typedef struct file_contents_baton_t
 {
-  /* The file we want to read. */
+  /* The file we want to read, and where in it to start. */
   svn_fs_root_t *root;
   const char *path;
+  apr_size_t offset;
 
   /* The dag_node that will be made from the above. */
   dag_node_t *node;
@@ -2443,6 +2573,7 @@ txn_body_get_file_contents (void *baton, trail_t *trail)
   /* Then create a readable stream from the dag_node_t. */
   SVN_ERR (svn_fs__dag_get_contents (&(fb->file_stream),
                                      fb->node,
+                                     fb->offset,
                                      fb->pool,
                                      trail));
   return SVN_NO_ERROR;
@@ -2455,10 +2586,22 @@ svn_fs_file_contents (svn_stream_t **contents,
                       svn_fs_root_t *root,
                       const char *path,
                       apr_pool_t *pool)
+{
+  return svn_fs_file_contents_at (contents, root, path, 0, pool);
+}
+
+
+svn_error_t *
+svn_fs_file_contents_at (svn_stream_t **contents,
+                         svn_fs_root_t *root,
+                         const char *path,
+                         apr_size_t offset,
+                         apr_pool_t *pool)
 {
   file_contents_baton_t *fb = apr_pcalloc (pool, sizeof(*fb));
   fb->root = root;
   fb->path = path;
+  fb->offset = offset;
   fb->pool = pool;
 
   /* Create the readable stream in the context of a db txn.  */
@@ -2601,6 +2744,7 @@ txn_body_apply_textdelta (void *baton, trail_t *trail)
      The stream is returned in tb->source_stream. */
   SVN_ERR (svn_fs__dag_get_contents (&(tb->source_stream),
                                      tb->node,
+                                     0,
                                      tb->pool,
                                      trail));
 
@@ -2765,6 +2909,8 @@ struct revisions_changed_args
   apr_array_header_t **revs;
   svn_fs_t *fs;
   apr_array_header_t *ids;
+  svn_revnum_t oldest;
+  int limit;
   apr_pool_t *pool;
 };
 
@@ -2783,10 +2929,19 @@ txn_body_revisions_changed (void *baton, trail_t *trail)
   /* Check the ID for each path */
   for (i = 0; i < args->ids->nelts; i++)
     {
-      svn_fs_id_t *tmp_id = APR_ARRAY_IDX (args->ids, i, svn_fs_id_t *);
+      /* Work on a copy, so that the IDs are intact if this trail has
+         to be retried.  */
+      svn_fs_id_t *tmp_id
+        = svn_fs__id_copy (APR_ARRAY_IDX (args->ids, i, svn_fs_id_t *),
+                           subpool);
+      svn_revnum_t last_rev = SVN_INVALID_REVNUM;
+      int found = 0;
 
       /* Loop, from ID, through its predecessors, until it ceases to
-         exist.  */
+         exist.  Each predecessor was made in an older revision than
+         the node before it, so the revisions come youngest first, and
+         we can stop as soon as we have all this path can contribute:
+         the LIMIT youngest, none older than OLDEST.  */
       do
         {
           svn_revnum_t revision;
@@ -2799,7 +2954,16 @@ txn_body_revisions_changed (void *baton, trail_t *trail)
           /* Now get the revision from the dag. */
           SVN_ERR (svn_fs__dag_get_revision (&revision, node, trail));
 
-          (*((svn_revnum_t *) apr_array_push (array))) = revision;
+          if (SVN_IS_VALID_REVNUM (args->oldest) && revision < args->oldest)
+            break;
+
+          if (revision != last_rev)
+            {
+              (*((svn_revnum_t *) apr_array_push (array))) = revision;
+              last_rev = revision;
+              if (args->limit && ++found >= args->limit)
+                break;
+            }
 
           /* Hack up TMP_ID so that it represents its own predecessor.
              Node IDs come in pairs, terminated by a trailing -1. So
@@ -2816,11 +2980,14 @@ txn_body_revisions_changed (void *baton, trail_t *trail)
   qsort (array->elts, array->nelts, array->elt_size, 
          svn_sort_compare_revisions);
 
-  /* Now build the return array, removing duplicates along the way. */
+  /* Now build the return array, removing duplicates along the way,
+     and keeping only the LIMIT youngest of the paths' revisions.  */
   *(args->revs) = apr_array_make (args->pool, 4, sizeof (svn_revnum_t));
   prev_rev = SVN_INVALID_REVNUM;
   for (i = 0; i < array->nelts; i++)
     {
+      if (args->limit && (*(args->revs))->nelts >= args->limit)
+        break;
       if (APR_ARRAY_IDX (array, i, svn_revnum_t) != prev_rev)
         (*((svn_revnum_t *) apr_array_push (*(args->revs)))) =
             APR_ARRAY_IDX (array, i, svn_revnum_t);
@@ -2836,6 +3003,8 @@ svn_error_t *
 svn_fs_revisions_changed (apr_array_header_t **revs,
                           svn_fs_root_t *root,
                           const apr_array_header_t *paths,
+                          svn_revnum_t oldest,
+                          int limit,
                           apr_pool_t *pool)
 {
   struct revisions_changed_args args;
@@ -2848,6 +3017,8 @@ svn_fs_revisions_changed (apr_array_header_t **revs,
   /* Populate the baton. */
   args.revs = revs;
   args.fs = fs;
+  args.oldest = oldest;
+  args.limit = limit;
   args.pool = pool;
   args.ids = apr_array_make (subpool, 1, sizeof (svn_fs_id_t *));
 
@@ -32,6 +32,7 @@
 #include "trail.h"
 #include "rev-table.h"
 #include "txn-table.h"
+#include "activities-table.h"
 #include "tree.h"
 
 
@@ -326,6 +327,80 @@ svn_fs_list_transactions (char ***names_p,
 }
 
 
+struct activity_txn_args
+{
+  const char **txn_name_p;
+  svn_fs_t *fs;
+  const char *activity_id;
+};
+
+static svn_error_t *
+txn_body_activity_txn (void *baton,
+                       trail_t *trail)
+{
+  struct activity_txn_args *args = baton;
+  return svn_fs__get_activity (args->txn_name_p, args->fs,
+                               args->activity_id, trail);
+}
+
+svn_error_t *
+svn_fs_activity_txn (const char **txn_name_p,
+                     svn_fs_t *fs,
+                     const char *activity_id,
+                     apr_pool_t *pool)
+{
+  const char *txn_name;
+  struct activity_txn_args args;
+
+  SVN_ERR (svn_fs__check_fs (fs));
+
+  args.txn_name_p = &txn_name;
+  args.fs = fs;
+  args.activity_id = activity_id;
+  SVN_ERR (svn_fs__retry_txn (fs, txn_body_activity_txn, &args, pool));
+
+  *txn_name_p = txn_name;
+  return SVN_NO_ERROR;
+}
+
+
+struct set_activity_txn_args
+{
+  svn_fs_t *fs;
+  const char *activity_id;
+  const char *txn_name;
+};
+
+static svn_error_t *
+txn_body_set_activity_txn (void *baton,
+                           trail_t *trail)
+{
+  struct set_activity_txn_args *args = baton;
+
+  if (args->txn_name)
+    return svn_fs__put_activity (args->fs, args->activity_id,
+                                 args->txn_name, trail);
+  else
+    return svn_fs__delete_activity (args->fs, args->activity_id, trail);
+}
+
+svn_error_t *
+svn_fs_set_activity_txn (svn_fs_t *fs,
+                         const char *activity_id,
+                         const char *txn_name,
+                         apr_pool_t *pool)
+{
+  struct set_activity_txn_args args;
+
+  SVN_ERR (svn_fs__check_fs (fs));
+
+  args.fs = fs;
+  args.activity_id = activity_id;
+  args.txn_name = txn_name;
+  return svn_fs__retry_txn (fs, txn_body_set_activity_txn, &args, pool);
+}
+
+
 
 /*** Accessors. ***/
 
@@ -0,0 +1,349 @@
+/* verify.c : checking representations against their checksums
+ *
+ * ====================================================================
+ * Copyright (c) 2000-2002 CollabNet.  All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.  The terms
+ * are also available at http://subversion.tigris.org/license-1.html.
+ * If newer versions of this license are posted there, you may use a
+ * newer version instead, at your option.
+ *
+ * This software consists of voluntary contributions made by many
+ * individuals.  For exact contribution history, see the revision
+ * history and logs, available at http://subversion.tigris.org/.
+ * ====================================================================
+ */
+
+#include <string.h>
+#include <apr_pools.h>
+#if APR_HAS_THREADS
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#endif
+
+#include "svn_pools.h"
+#include "svn_fs.h"
+#include "fs.h"
+#include "err.h"
+#include "trail.h"
+#include "reps-table.h"
+#include "reps-strings.h"
+
+
+
+/* Verifying representations.  */
+
+
+/* Every representation is reconstructed in a trail of its own, so
+   that verifying a large filesystem doesn't hold one enormous Berkeley
+   DB transaction open.  With worker threads, each worker has its own
+   handle on the filesystem, and they take representation keys off a
+   shared list in turn.  */
+
+struct verify_baton
+{
+  /* All the representation keys in the filesystem, and the index of
+     the next one to verify. */
+  apr_array_header_t *keys;
+  int next;
+
+  /* The results so far.  For each corrupt rep, CORRUPT holds its key
+     and CORRUPT_MSGS the error it produced, allocated in POOL. */
+  svn_fs_verify_stats_t stats;
+  apr_array_header_t *corrupt;
+  apr_array_header_t *corrupt_msgs;
+
+#if APR_HAS_THREADS
+  /* Protects everything above, when there are worker threads. */
+  apr_thread_mutex_t *lock;
+#endif
+
+  apr_pool_t *pool;
+};
+
+
+struct verify_rep_args
+{
+  svn_fs_t *fs;
+  const char *key;
+  int checked;          /* OUT parameter */
+};
+
+
+static svn_error_t *
+txn_body_verify_rep (void *baton, trail_t *trail)
+{
+  struct verify_rep_args *args = baton;
+  return svn_fs__rep_verify (&args->checked, args->fs, args->key, trail);
+}
+
+
+/* How many rep keys to list per trail.  */
+#define KEYS_PER_TRAIL 1000
+
+
+struct get_rep_keys_args
+{
+  svn_fs_t *fs;
+  const char *after;
+  apr_array_header_t *keys;     /* OUT parameter */
+  apr_pool_t *pool;
+};
+
+
+static svn_error_t *
+txn_body_get_rep_keys (void *baton, trail_t *trail)
+{
+  struct get_rep_keys_args *args = baton;
+  return svn_fs__get_rep_keys (&args->keys, args->fs, args->after,
+                               KEYS_PER_TRAIL, args->pool, trail);
+}
+
+
+static void
+lock_baton (struct verify_baton *vb)
+{
+#if APR_HAS_THREADS
+  if (vb->lock)
+    apr_thread_mutex_lock (vb->lock);
+#endif
+}
+
+
+static void
+unlock_baton (struct verify_baton *vb)
+{
+#if APR_HAS_THREADS
+  if (vb->lock)
+    apr_thread_mutex_unlock (vb->lock);
+#endif
+}
+
+
+/* Verify representations from VB's list, reading them through FS,
+   until there are none left.  Use POOL for temporary allocations.
+   Errors reading a rep are recorded in VB, not returned.  */
+static void
+verify_reps (struct verify_baton *vb, svn_fs_t *fs, apr_pool_t *pool)
+{
+  apr_pool_t *subpool = svn_pool_create (pool);
+
+  for (;;)
+    {
+      struct verify_rep_args args;
+      svn_error_t *err;
+
+      lock_baton (vb);
+      if (vb->next >= vb->keys->nelts)
+        {
+          unlock_baton (vb);
+          break;
+        }
+      args.fs = fs;
+      args.key = APR_ARRAY_IDX (vb->keys, vb->next++, const char *);
+      unlock_baton (vb);
+
+      err = svn_fs__retry_txn (fs, txn_body_verify_rep, &args, subpool);
+
+      lock_baton (vb);
+      if (! err)
+        {
+          if (args.checked)
+            vb->stats.checked++;
+          else
+            vb->stats.skipped++;
+        }
+      else if (err->apr_err == SVN_ERR_FS_NO_SUCH_REPRESENTATION)
+        {
+          /* Deleted since we listed it: a transaction was aborted, or
+             a mutable rep was replaced.  */
+          vb->stats.skipped++;
+          svn_error_clear_all (err);
+        }
+      else
+        {
+          svn_error_t *e;
+          const char *msg = "";
+
+          for (e = err; e; e = e->child)
+            if (e->message)
+              msg = apr_pstrcat (vb->pool, msg, (msg[0] ? ": " : ""),
+                                 e->message, NULL);
+
+          vb->stats.corrupt++;
+          (*((const char **) apr_array_push (vb->corrupt)))
+            = apr_pstrdup (vb->pool, args.key);
+          (*((const char **) apr_array_push (vb->corrupt_msgs))) = msg;
+          svn_error_clear_all (err);
+        }
+      unlock_baton (vb);
+
+      svn_pool_clear (subpool);
+    }
+
+  svn_pool_destroy (subpool);
+}
+
+
+#if APR_HAS_THREADS
+
+struct verify_worker
+{
+  struct verify_baton *vb;
+
+  /* The worker's own filesystem handle, and the root pool it lives
+     in; errors in a thread need a root pool of their own. */
+  svn_fs_t *fs;
+  apr_pool_t *pool;
+};
+
+
+static void * APR_THREAD_FUNC
+verify_worker (apr_thread_t *thread, void *data)
+{
+  struct verify_worker *w = data;
+
+  verify_reps (w->vb, w->fs, w->pool);
+  apr_thread_exit (thread, APR_SUCCESS);
+  return NULL;
+}
+
+
+/* Verify VB's representations in FS on NUM_THREADS worker threads.
+   Use POOL for allocations.  */
+static svn_error_t *
+verify_threaded (struct verify_baton *vb,
+                 svn_fs_t *fs,
+                 int num_threads,
+                 apr_pool_t *pool)
+{
+  struct verify_worker *workers;
+  apr_thread_t **threads;
+  const char *path = svn_fs_berkeley_path (fs, pool);
+  apr_status_t apr_err;
+  svn_error_t *err = SVN_NO_ERROR;
+  int i, started = 0;
+
+  apr_err = apr_thread_mutex_create (&vb->lock, APR_THREAD_MUTEX_DEFAULT,
+                                     pool);
+  if (apr_err)
+    return svn_error_create (apr_err, 0, NULL, pool,
+                             "svn_fs_verify: creating mutex");
+
+  workers = apr_pcalloc (pool, num_threads * sizeof (*workers));
+  threads = apr_pcalloc (pool, num_threads * sizeof (*threads));
+
+  /* Open the workers' filesystem handles before starting any of
+     them, so that a failure leaves nothing running.  */
+  for (i = 0; i < num_threads && ! err; i++)
+    {
+      workers[i].vb = vb;
+      workers[i].pool = svn_pool_create (NULL);
+      workers[i].fs = svn_fs_new (workers[i].pool);
+      err = svn_fs_open_berkeley (workers[i].fs, path);
+    }
+
+  /* If a thread can't be started, the ones that were still get
+     through the whole list between them.  */
+  for (i = 0; i < num_threads && ! err; i++, started++)
+    if (apr_thread_create (&threads[i], NULL, verify_worker,
+                           &workers[i], pool))
+      break;
+
+  for (i = 0; i < started; i++)
+    {
+      apr_status_t retval;
+      apr_thread_join (&retval, threads[i]);
+    }
+
+  /* And if none could be started, we do the work ourselves. */
+  if (! err && started == 0)
+    {
+      apr_thread_mutex_destroy (vb->lock);
+      vb->lock = NULL;
+      verify_reps (vb, fs, pool);
+    }
+
+  for (i = 0; i < num_threads; i++)
+    if (workers[i].pool)
+      svn_pool_destroy (workers[i].pool);
+
+  if (vb->lock)
+    apr_thread_mutex_destroy (vb->lock);
+  vb->lock = NULL;
+  return err;
+}
+
+#endif /* APR_HAS_THREADS */
+
+
+svn_error_t *
+svn_fs_verify (svn_fs_verify_stats_t *stats,
+               svn_fs_t *fs,
+               int num_threads,
+               apr_pool_t *pool)
+{
+  struct verify_baton vb;
+  struct get_rep_keys_args args;
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  SVN_ERR (svn_fs__check_fs (fs));
+
+  memset (&vb, 0, sizeof (vb));
+  vb.pool = pool;
+  vb.corrupt = apr_array_make (pool, 0, sizeof (const char *));
+  vb.corrupt_msgs = apr_array_make (pool, 0, sizeof (const char *));
+  vb.keys = apr_array_make (pool, 64, sizeof (const char *));
+
+  /* List the keys a batch at a time, so the listing doesn't hold a
+     Berkeley DB transaction open across the whole table either.  */
+  args.fs = fs;
+  args.after = NULL;
+  args.pool = pool;
+  do
+    {
+      SVN_ERR (svn_fs__retry_txn (fs, txn_body_get_rep_keys, &args, pool));
+      for (i = 0; i < args.keys->nelts; i++)
+        (*((const char **) apr_array_push (vb.keys)))
+          = APR_ARRAY_IDX (args.keys, i, const char *);
+      if (args.keys->nelts)
+        args.after = APR_ARRAY_IDX (args.keys, args.keys->nelts - 1,
+                                    const char *);
+    }
+  while (args.keys->nelts);
+
+#if APR_HAS_THREADS
+  if (num_threads > 1)
+    SVN_ERR (verify_threaded (&vb, fs, num_threads, pool));
+  else
+#endif
+    verify_reps (&vb, fs, pool);
+
+  if (stats)
+    *stats = vb.stats;
+
+  /* Report every corrupt rep, in the order they were found.  */
+  for (i = vb.corrupt->nelts - 1; i >= 0; i--)
+    err = svn_error_createf (SVN_ERR_FS_CORRUPT, 0, err, pool,
+                             "representation `%s': %s",
+                             APR_ARRAY_IDX (vb.corrupt, i, const char *),
+                             APR_ARRAY_IDX (vb.corrupt_msgs, i,
+                                            const char *));
+  if (err)
+    err = svn_error_createf (SVN_ERR_FS_CORRUPT, 0, err, pool,
+                             "svn_fs_verify: %d corrupt representation%s "
+                             "in `%s'", vb.corrupt->nelts,
+                             vb.corrupt->nelts == 1 ? "" : "s", fs->path);
+
+  return err;
+}
+
+
+
+/*
+ * local variables:
+ * eval: (load-file "../../tools/dev/svn-dev.el")
+ * end:
+ */
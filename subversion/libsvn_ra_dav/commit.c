@@ -97,6 +97,10 @@ typedef struct
   /* The author (also according to the repository) of this commit. */
   const char **committed_author;
 
+  /* For a single-request commit, the file the request body is written
+     to until it is sent. */
+  apr_file_t *body_file;
+
 } commit_ctx_t;
 
 typedef struct
@@ -231,51 +235,15 @@ static svn_error_t * get_version_url(commit_ctx_t *cc,
   return NULL;
 }
 
-static svn_error_t * get_activity_url(commit_ctx_t *cc,
-                                      const svn_string_t **activity_url)
+/* create an activity under ACTIVITY_URL, the server's activity collection */
+static svn_error_t * create_activity(commit_ctx_t *cc,
+                                     const svn_string_t *activity_url)
 {
-
-  if (cc->get_func != NULL)
-    {
-      /* with a get_func, we can just ask for the activity URL from the
-         property store. */
-
-      /* get the URL where we should create activities */
-      SVN_ERR( (*cc->get_func)(cc->close_baton,
-                               ".",
-                               SVN_RA_DAV__LP_ACTIVITY_URL,
-                               activity_url,
-                               cc->ras->pool) );
-
-      if (*activity_url != NULL)
-        {
-          /* the property was there. return it. */
-
-          /* ### urk. copy the thing to get a proper pool in there */
-          *activity_url = svn_string_dup(*activity_url, cc->ras->pool);
-
-          return NULL;
-        }
-
-      /* property not found for some reason. get it from the server. */
-    }
-
-  /* use our utility function to fetch the activity URL */
-  return svn_ra_dav__get_activity_url(activity_url, cc->ras,
-                                      cc->ras->root.path, cc->ras->pool);
-}
-
-static svn_error_t * create_activity(commit_ctx_t *cc)
-{
-  const svn_string_t * activity_url;
   apr_uuid_t uuid;
   char uuid_buf[APR_UUID_FORMATTED_LENGTH + 1];
   int code;
   svn_stringbuf_t *urlbuf;
 
-  /* get the URL where we'll create activities */
-  SVN_ERR( get_activity_url(cc, &activity_url) );
-
   /* the URL for our activity will be ACTIVITY_URL/UUID */
   apr_uuid_get(&uuid);
   apr_uuid_format(uuid_buf, &uuid);
@@ -557,6 +525,9 @@ add_valid_target (commit_ctx_t *cc,
                   enum svn_recurse_kind kind)
 {
   apr_hash_t *hash = cc->valid_targets;
+
+  /* the hash outlives the editor call that gives us PATH */
+  path = apr_pstrdup (cc->ras->pool, path);
   apr_hash_set (hash, path, APR_HASH_KEY_STRING, &kind);
 }
 
@@ -1107,6 +1078,247 @@ static svn_error_t * apply_log_message(commit_ctx_t *cc,
   return SVN_NO_ERROR;
 }
 
+
+/*
+** The single-request commit.
+**
+** When the server takes a whole commit in one POST, the editor drive is
+** written to a temp file in the binary editor format as it is made, after
+** the log message, and sent at close_edit time. The editor below runs
+** alongside the binary editor and notes the paths the commit touches,
+** just as the editor above does, so that the merge response updates the
+** same working copy properties.
+*/
+
+typedef struct
+{
+  commit_ctx_t *cc;
+  const char *path;             /* relative to the root of the commit */
+} track_baton_t;
+
+static track_baton_t *make_track_baton(commit_ctx_t *cc,
+                                       const char *path,
+                                       apr_pool_t *pool)
+{
+  track_baton_t *tb = apr_pcalloc(pool, sizeof(*tb));
+
+  tb->cc = cc;
+  tb->path = apr_pstrdup(pool, path);
+  return tb;
+}
+
+static svn_error_t * track_open_root(void *edit_baton,
+                                     svn_revnum_t base_revision,
+                                     apr_pool_t *dir_pool,
+                                     void **root_baton)
+{
+  *root_baton = make_track_baton(edit_baton, "", dir_pool);
+  return NULL;
+}
+
+static svn_error_t * track_delete_entry(const char *path,
+                                        svn_revnum_t revision,
+                                        void *parent_baton,
+                                        apr_pool_t *pool)
+{
+  track_baton_t *parent = parent_baton;
+
+  add_valid_target (parent->cc, path, svn_nonrecursive);
+  return NULL;
+}
+
+static svn_error_t * track_add_dir(const char *path,
+                                   void *parent_baton,
+                                   const char *copyfrom_path,
+                                   svn_revnum_t copyfrom_revision,
+                                   apr_pool_t *dir_pool,
+                                   void **child_baton)
+{
+  track_baton_t *parent = parent_baton;
+
+  add_valid_target (parent->cc, path, 
+                    copyfrom_path ? svn_recursive : svn_nonrecursive);
+  *child_baton = make_track_baton(parent->cc, path, dir_pool);
+  return NULL;
+}
+
+static svn_error_t * track_open_dir(const char *path,
+                                    void *parent_baton,
+                                    svn_revnum_t base_revision,
+                                    apr_pool_t *dir_pool,
+                                    void **child_baton)
+{
+  track_baton_t *parent = parent_baton;
+
+  *child_baton = make_track_baton(parent->cc, path, dir_pool);
+  return NULL;
+}
+
+static svn_error_t * track_change_prop(void *baton,
+                                       const char *name,
+                                       const svn_string_t *value,
+                                       apr_pool_t *pool)
+{
+  track_baton_t *tb = baton;
+
+  add_valid_target (tb->cc, tb->path, svn_nonrecursive);
+  return NULL;
+}
+
+static svn_error_t * track_add_file(const char *path,
+                                    void *parent_baton,
+                                    const char *copyfrom_path,
+                                    svn_revnum_t copyfrom_revision,
+                                    apr_pool_t *file_pool,
+                                    void **file_baton)
+{
+  track_baton_t *parent = parent_baton;
+
+  add_valid_target (parent->cc, path, svn_nonrecursive);
+  *file_baton = make_track_baton(parent->cc, path, file_pool);
+  return NULL;
+}
+
+static svn_error_t * track_open_file(const char *path,
+                                     void *parent_baton,
+                                     svn_revnum_t base_revision,
+                                     apr_pool_t *file_pool,
+                                     void **file_baton)
+{
+  track_baton_t *parent = parent_baton;
+
+  *file_baton = make_track_baton(parent->cc, path, file_pool);
+  return NULL;
+}
+
+static svn_error_t * track_apply_txdelta(void *file_baton, 
+                                         svn_txdelta_window_handler_t *handler,
+                                         void **handler_baton)
+{
+  track_baton_t *file = file_baton;
+
+  add_valid_target (file->cc, file->path, svn_nonrecursive);
+
+  /* the binary editor takes the windows */
+  *handler = NULL;
+  *handler_baton = NULL;
+  return NULL;
+}
+
+static svn_error_t * track_close_edit(void *edit_baton)
+{
+  commit_ctx_t *cc = edit_baton;
+  apr_status_t status;
+  apr_off_t offset = 0;
+  int fdesc;
+  svn_error_t *err;
+
+  /* Rewind the body file. */
+  status = apr_file_seek(cc->body_file, APR_SET, &offset);
+  if (status)
+    {
+      (void) apr_file_close(cc->body_file);
+      return svn_error_create(status, 0, NULL, cc->ras->pool,
+                              "Couldn't rewind the commit body file.");
+    }
+  /* Convert the (apr_file_t *)body_file into a file descriptor for neon. */
+  status = svn_io_fd_from_file(&fdesc, cc->body_file);
+  if (status)
+    {
+      (void) apr_file_close(cc->body_file);
+      return svn_error_create(status, 0, NULL, cc->ras->pool,
+                              "Couldn't get file-descriptor of the commit "
+                              "body file.");
+    }
+
+  err = svn_ra_dav__single_commit(cc->new_rev,
+                                  cc->committed_date,
+                                  cc->committed_author,
+                                  cc->ras,
+                                  cc->ras->root.path,
+                                  fdesc,
+                                  cc->valid_targets,
+                                  cc->ras->pool);
+
+  /* we're done with the file.  this should delete it. */
+  (void) apr_file_close(cc->body_file);
+
+  if (err)
+    return err;
+
+  SVN_ERR( svn_ra_dav__maybe_store_auth_info(cc->ras) );
+
+  return NULL;
+}
+
+static svn_error_t * track_abort_edit(void *edit_baton)
+{
+  commit_ctx_t *cc = edit_baton;
+
+  /* nothing has been sent; just toss the file. */
+  (void) apr_file_close(cc->body_file);
+  return NULL;
+}
+
+/* Set *EDITOR and *EDIT_BATON to an editor which commits the changes
+   described to it, with the log message LOG_MSG, in a single request
+   at close_edit time. */
+static svn_error_t * get_single_commit_editor(const svn_delta_editor_t **editor,
+                                              void **edit_baton,
+                                              commit_ctx_t *cc,
+                                              svn_stringbuf_t *log_msg)
+{
+  svn_ra_session_t *ras = cc->ras;
+  const svn_delta_editor_t *binary_editor;
+  void *binary_baton;
+  svn_delta_editor_t *track_editor;
+  const char *log_len;
+  apr_status_t status;
+
+  /* Use the client callback to create a tmpfile for the body. */
+  SVN_ERR( ras->callbacks->open_tmp_file(&cc->body_file,
+                                         ras->callback_baton) );
+
+  /* The body starts with the log message, preceded by its length. */
+  log_len = apr_psprintf(ras->pool, "%lu\n", (unsigned long) log_msg->len);
+  status = apr_file_write_full(cc->body_file, log_len, strlen(log_len), NULL);
+  if (! status)
+    status = apr_file_write_full(cc->body_file, log_msg->data, log_msg->len,
+                                 NULL);
+  if (status)
+    {
+      (void) apr_file_close(cc->body_file);
+      return svn_error_create(status, 0, NULL, ras->pool,
+                              "Could not write the log message to the "
+                              "commit body file.");
+    }
+
+  /* The editor drive follows.  Closing the binary editor's stream leaves
+     the file open for track_close_edit to send. */
+  SVN_ERR( svn_delta_get_binary_editor(svn_stream_from_aprfile(cc->body_file,
+                                                               ras->pool),
+                                       &binary_editor, &binary_baton,
+                                       ras->pool) );
+
+  track_editor = svn_delta_default_editor(ras->pool);
+  track_editor->open_root = track_open_root;
+  track_editor->delete_entry = track_delete_entry;
+  track_editor->add_directory = track_add_dir;
+  track_editor->open_directory = track_open_dir;
+  track_editor->change_dir_prop = track_change_prop;
+  track_editor->add_file = track_add_file;
+  track_editor->open_file = track_open_file;
+  track_editor->apply_textdelta = track_apply_txdelta;
+  track_editor->change_file_prop = track_change_prop;
+  track_editor->close_edit = track_close_edit;
+  track_editor->abort_edit = track_abort_edit;
+
+  svn_delta_compose_editors(editor, edit_baton,
+                            binary_editor, binary_baton,
+                            track_editor, cc, ras->pool);
+  return SVN_NO_ERROR;
+}
+
 svn_error_t * svn_ra_dav__get_commit_editor(
   void *session_baton,
   const svn_delta_editor_t **editor,
@@ -1119,6 +1331,8 @@ svn_error_t * svn_ra_dav__get_commit_editor(
   svn_ra_session_t *ras = session_baton;
   svn_delta_editor_t *commit_editor;
   commit_ctx_t *cc;
+  const svn_string_t *activity_url;
+  svn_boolean_t single_commit;
 
   /* Build the main commit editor's baton. */
   cc = apr_pcalloc(ras->pool, sizeof(*cc));
@@ -1133,15 +1347,19 @@ svn_error_t * svn_ra_dav__get_commit_editor(
   cc->committed_date = committed_date;
   cc->committed_author = committed_author;
 
-  /* ### should we perform an OPTIONS to validate the server we're about
-     ### to talk to? */
+  /* Ask the server where activities go, and whether it can take the
+     whole commit in one request instead. */
+  SVN_ERR( svn_ra_dav__get_commit_options(&activity_url, &single_commit,
+                                          ras, ras->root.path, ras->pool) );
+  if (single_commit)
+    return get_single_commit_editor(editor, edit_baton, cc, log_msg);
 
   /*
   ** Create an Activity. This corresponds directly to an FS transaction.
   ** We will check out all further resources within the context of this
   ** activity.
   */
-  SVN_ERR( create_activity(cc) );
+  SVN_ERR( create_activity(cc, activity_url) );
 
   /*
   ** Find the latest baseline resource, check it out, and then apply the
@@ -42,6 +42,7 @@
 #include "svn_path.h"
 #include "svn_xml.h"
 #include "svn_dav.h"
+#include "svn_base64.h"
 
 #include "ra_dav.h"
 
@@ -123,6 +124,26 @@ typedef struct {
   svn_boolean_t fetch_content;
   svn_boolean_t fetch_props;
 
+  /* Is the server sending file texts and property changes inline (a
+     "send-all" report), so that nothing needs fetching? */
+  svn_boolean_t receiving_all;
+
+  /* While receiving a file's svndiff inline: the parser that passes
+     its windows to the editor. */
+  svn_stream_t *svndiff_decoder;
+
+  /* While receiving a property inline: its name, and whether its
+     value is base64-encoded. */
+  svn_stringbuf_t *set_prop_name;
+  svn_boolean_t set_prop_base64;
+
+  /* For decoding inline data; cleared after each element. */
+  apr_pool_t *scratch_pool;
+
+  /* For whatever lasts as long as the current file, such as its
+     svndiff parser; cleared when the file is closed. */
+  apr_pool_t *file_pool;
+
   const svn_delta_edit_fns_t *editor;
   void *edit_baton;
 
@@ -144,6 +165,13 @@ typedef struct {
 static const char report_head[] = "<S:update-report xmlns:S=\""
                                    SVN_XML_NAMESPACE
                                    "\">" DEBUG_CR;
+
+/* Asks the server to send file texts and property changes inline.
+   Servers that don't know how simply ignore the attribute. */
+static const char report_head_send_all[] = "<S:update-report xmlns:S=\""
+                                            SVN_XML_NAMESPACE
+                                            "\" send-all=\"true\">"
+                                            DEBUG_CR;
 static const char report_tail[] = "</S:update-report>" DEBUG_CR;
 
 static const struct ne_xml_elm report_elements[] =
@@ -163,6 +191,9 @@ static const struct ne_xml_elm report_elements[] =
   { SVN_XML_NAMESPACE, "remove-prop", ELEM_remove_prop, 0 },
   { SVN_XML_NAMESPACE, "fetch-file", ELEM_fetch_file, 0 },
   { SVN_XML_NAMESPACE, "prop", ELEM_prop, 0 },
+  { SVN_XML_NAMESPACE, "txdelta", ELEM_txdelta, 0 },
+  { SVN_XML_NAMESPACE, "svndiff", ELEM_svndiff, NE_XML_CDATA },
+  { SVN_XML_NAMESPACE, "set-prop", ELEM_set_prop, NE_XML_CDATA },
 
   { "DAV:", "version-name", ELEM_version_name, NE_XML_CDATA },
   { "DAV:", "creationdate", ELEM_creationdate, NE_XML_CDATA },
@@ -1139,7 +1170,8 @@ static int validate_element(void *userdata,
           || child == ELEM_remove_prop
           || child == ELEM_delete_entry
           || child == ELEM_prop
-          || child == ELEM_checked_in)
+          || child == ELEM_checked_in
+          || child == ELEM_set_prop)
         return NE_XML_VALID;
       else
         return NE_XML_INVALID;
@@ -1148,7 +1180,8 @@ static int validate_element(void *userdata,
       if (child == ELEM_add_directory
           || child == ELEM_add_file
           || child == ELEM_prop
-          || child == ELEM_checked_in)
+          || child == ELEM_checked_in
+          || child == ELEM_set_prop)
         return NE_XML_VALID;
       else
         return NE_XML_INVALID;
@@ -1158,14 +1191,24 @@ static int validate_element(void *userdata,
           || child == ELEM_fetch_file
           || child == ELEM_prop
           || child == ELEM_fetch_props
-          || child == ELEM_remove_prop)
+          || child == ELEM_remove_prop
+          || child == ELEM_txdelta
+          || child == ELEM_set_prop)
         return NE_XML_VALID;
       else
         return NE_XML_INVALID;
 
     case ELEM_add_file:
       if (child == ELEM_checked_in
-          || child == ELEM_prop)
+          || child == ELEM_prop
+          || child == ELEM_txdelta
+          || child == ELEM_set_prop)
+        return NE_XML_VALID;
+      else
+        return NE_XML_INVALID;
+
+    case ELEM_txdelta:
+      if (child == ELEM_svndiff)
         return NE_XML_VALID;
       else
         return NE_XML_INVALID;
@@ -1226,6 +1269,12 @@ static int start_element(void *userdata, const struct ne_xml_elm *elm,
 
   switch (elm->id)
     {
+    case ELEM_update_report:
+      att = get_attr(atts, "send-all");
+      if (att != NULL && strcmp(att, "true") == 0)
+        rb->receiving_all = TRUE;
+      break;
+
     case ELEM_target_revision:
       att = get_attr(atts, "rev");
       /* ### verify we got it. punt on error. */
@@ -1294,8 +1343,9 @@ static int start_element(void *userdata, const struct ne_xml_elm *elm,
       /* push the new baton onto the directory baton stack */
       push_dir(rb, new_dir_baton, pathbuf);
 
-      /* Property fetching is implied in addition. */
-      TOP_DIR(rb).fetch_props = TRUE;
+      /* Property fetching is implied in addition, unless the server
+         is sending the properties inline. */
+      TOP_DIR(rb).fetch_props = !rb->receiving_all;
       break;
 
     case ELEM_open_file:
@@ -1339,8 +1389,9 @@ static int start_element(void *userdata, const struct ne_xml_elm *elm,
       CHKERR( (*rb->editor->add_file)(rb->namestr, parent_dir->baton,
                                       cpath, crev, &rb->file_baton) );
 
-      /* Property fetching is implied in addition. */
-      rb->fetch_props = TRUE;
+      /* Property fetching is implied in addition, unless the server
+         is sending the properties inline. */
+      rb->fetch_props = !rb->receiving_all;
 
       /* Add this file's name into the directory's path buffer. It will be
          removed in end_element() */
@@ -1404,6 +1455,35 @@ static int start_element(void *userdata, const struct ne_xml_elm *elm,
                                           TOP_DIR(rb).baton) );
       break;
 
+    case ELEM_txdelta:
+      {
+        svn_txdelta_window_handler_t handler;
+        void *handler_baton;
+
+        /* The svndiff arrives in pieces; each is handed to this parser,
+           which passes complete windows on to the editor. */
+        CHKERR( (*rb->editor->apply_textdelta)(rb->file_baton,
+                                               &handler, &handler_baton) );
+        rb->svndiff_decoder = svn_txdelta_parse_svndiff(handler,
+                                                        handler_baton,
+                                                        TRUE,
+                                                        rb->file_pool);
+      }
+      break;
+
+    case ELEM_set_prop:
+      name = get_attr(atts, "name");
+      if (name == NULL)
+        CHKERR( svn_error_create(SVN_ERR_XML_ATTRIB_NOT_FOUND, 0, NULL,
+                                 rb->ras->pool,
+                                 "The server sent a property with no "
+                                 "name.") );
+      svn_stringbuf_set(rb->set_prop_name, name);
+
+      att = get_attr(atts, "encoding");
+      rb->set_prop_base64 = (att != NULL && strcmp(att, "base64") == 0);
+      break;
+
     default:
       break;
     }
@@ -1485,14 +1565,15 @@ static int end_element(void *userdata,
       /* we wait until the close element to do the work. this allows us to
          retrieve the href before fetching. */
 
-      /* fetch file */
-      CHKERR( simple_fetch_file(rb->ras->sess2, rb->href->data,
-                                TOP_DIR(rb).pathbuf->data,
-                                rb->fetch_content,
-                                rb->file_baton, rb->editor,
-                                rb->ras->callbacks->get_wc_prop,
-                                rb->ras->callback_baton,
-                                rb->ras->pool) );
+      /* fetch file, unless the server sent it inline */
+      if (!rb->receiving_all)
+        CHKERR( simple_fetch_file(rb->ras->sess2, rb->href->data,
+                                  TOP_DIR(rb).pathbuf->data,
+                                  rb->fetch_content,
+                                  rb->file_baton, rb->editor,
+                                  rb->ras->callbacks->get_wc_prop,
+                                  rb->ras->callback_baton,
+                                  rb->ras->pool) );
 
 
       /*** FALLTHRU ***/
@@ -1504,11 +1585,50 @@ static int end_element(void *userdata,
       /* close the file and mark that we are no longer operating on a file */
       CHKERR( (*rb->editor->close_file)(rb->file_baton) );
       rb->file_baton = NULL;
+      svn_pool_clear(rb->file_pool);
 
       /* Yank this file out of the directory's path buffer. */
       svn_path_remove_component(TOP_DIR(rb).pathbuf);
       break;
 
+    case ELEM_svndiff:
+      {
+        svn_stringbuf_t *data;
+        apr_size_t len;
+
+        data = svn_base64_decode_string(svn_stringbuf_create(cdata,
+                                                             rb->scratch_pool),
+                                        rb->scratch_pool);
+        len = data->len;
+        CHKERR( svn_stream_write(rb->svndiff_decoder, data->data, &len) );
+        svn_pool_clear(rb->scratch_pool);
+      }
+      break;
+
+    case ELEM_txdelta:
+      /* this tells the editor's handler that the text is complete. */
+      CHKERR( svn_stream_close(rb->svndiff_decoder) );
+      rb->svndiff_decoder = NULL;
+      break;
+
+    case ELEM_set_prop:
+      {
+        svn_stringbuf_t *value = svn_stringbuf_create(cdata,
+                                                      rb->scratch_pool);
+
+        if (rb->set_prop_base64)
+          value = svn_base64_decode_string(value, rb->scratch_pool);
+
+        if (rb->file_baton == NULL)
+          CHKERR( rb->editor->change_dir_prop(TOP_DIR(rb).baton,
+                                              rb->set_prop_name, value) );
+        else
+          CHKERR( rb->editor->change_file_prop(rb->file_baton,
+                                               rb->set_prop_name, value) );
+        svn_pool_clear(rb->scratch_pool);
+      }
+      break;
+
     case NE_ELM_href:
       /* do nothing if we aren't fetching content. */
       if (!rb->fetch_content)
@@ -1652,6 +1772,9 @@ static svn_error_t * reporter_finish_report(void *report_baton)
   rb->namestr = MAKE_BUFFER(rb->ras->pool);
   rb->cpathstr = MAKE_BUFFER(rb->ras->pool);
   rb->href = MAKE_BUFFER(rb->ras->pool);
+  rb->set_prop_name = MAKE_BUFFER(rb->ras->pool);
+  rb->scratch_pool = svn_pool_create(rb->ras->pool);
+  rb->file_pool = svn_pool_create(rb->ras->pool);
 
   rb->vuh.name = svn_stringbuf_create(SVN_RA_DAV__LP_VSN_URL, rb->ras->pool);
   rb->vuh.value = MAKE_BUFFER(rb->ras->pool);
@@ -1751,9 +1874,14 @@ make_reporter (void *session_baton,
      ### will ensure that the file always gets tossed, even if we exit
      ### with an error. */
 
-  /* prep the file */
-  status = apr_file_write_full(rb->tmpfile,
-                               report_head, sizeof(report_head) - 1, NULL);
+  /* prep the file. when we want the contents of what changed, ask for
+     them inline, saving a GET and a PROPFIND for each file. */
+  if (fetch_content)
+    status = apr_file_write_full(rb->tmpfile, report_head_send_all,
+                                 sizeof(report_head_send_all) - 1, NULL);
+  else
+    status = apr_file_write_full(rb->tmpfile, report_head,
+                                 sizeof(report_head) - 1, NULL);
   if (status)
     {
       msg = "Could not write the header for the temporary report file.";
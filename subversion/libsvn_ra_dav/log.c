@@ -74,6 +74,12 @@ struct log_baton
   svn_log_message_receiver_t receiver;
   void *receiver_baton;
 
+  /* The most items to pass to `receiver', or zero for no limit, and
+     how many it has been passed so far.  A server that doesn't know
+     about limits sends us the whole range; the rest is ignored. */
+  int limit;
+  int count;
+
   /* If `receiver' returns error, it is stored here. */
   svn_error_t *err;
 };
@@ -176,12 +182,16 @@ log_end_element(void *userdata,
            attribute on the end element of the last item.  This is a
            change to mod_dav_svn too. */
         
-        svn_error_t *err = (*(lb->receiver))(lb->receiver_baton,
-                                             lb->changed_paths,
-                                             lb->revision,
-                                             lb->author,
-                                             lb->date,
-                                             lb->msg);
+        svn_error_t *err = SVN_NO_ERROR;
+
+        if (lb->limit == 0 || lb->count < lb->limit)
+          err = (*(lb->receiver))(lb->receiver_baton,
+                                  lb->changed_paths,
+                                  lb->revision,
+                                  lb->author,
+                                  lb->date,
+                                  lb->msg);
+        lb->count++;
         
         reset_log_item (lb);
         
@@ -215,6 +225,7 @@ svn_error_t * svn_ra_dav__get_log(void *session_baton,
                                   const apr_array_header_t *paths,
                                   svn_revnum_t start,
                                   svn_revnum_t end,
+                                  int limit,
                                   svn_boolean_t discover_changed_paths,
                                   svn_log_message_receiver_t receiver,
                                   void *receiver_baton)
@@ -228,9 +239,14 @@ svn_error_t * svn_ra_dav__get_log(void *session_baton,
    * report and invoke RECEIVER (which is an entirely separate
    * instance of `svn_log_message_receiver_t') on each individual
    * message in that report.
+   *
+   * The server sends each message as soon as it has it, and neon
+   * hands us the report as it arrives, so RECEIVER sees the first
+   * messages long before a big range is finished.
    */
 
   int i;
+  svn_error_t *err;
   svn_ra_session_t *ras = session_baton;
   svn_stringbuf_t *request_body = svn_stringbuf_create("", ras->pool);
   struct log_baton lb;
@@ -270,6 +286,12 @@ svn_error_t * svn_ra_dav__get_log(void *session_baton,
   svn_stringbuf_appendcstr(request_body,
                            apr_psprintf(ras->pool, "<S:end-revision>%ld"
                                         "</S:end-revision>", end));
+  if (limit)
+    {
+      svn_stringbuf_appendcstr(request_body,
+                               apr_psprintf(ras->pool,
+                                            "<S:limit>%d</S:limit>", limit));
+    }
   if (discover_changed_paths)
     {
       svn_stringbuf_appendcstr(request_body,
@@ -292,23 +314,36 @@ svn_error_t * svn_ra_dav__get_log(void *session_baton,
 
   lb.receiver = receiver;
   lb.receiver_baton = receiver_baton;
+  lb.limit = limit;
+  lb.count = 0;
+  lb.err = SVN_NO_ERROR;
   lb.subpool = svn_pool_create (ras->pool);
   reset_log_item (&lb);
 
-  SVN_ERR( svn_ra_dav__parsed_request(ras,
-                                      "REPORT",
-                                      ras->root.path,
-                                      request_body->data,
-                                      0,  /* ignored */
-                                      log_report_elements, 
-                                      log_validate,
-                                      log_start_element,
-                                      log_end_element,
-                                      &lb,
-                                      ras->pool) );
+  err = svn_ra_dav__parsed_request(ras,
+                                   "REPORT",
+                                   ras->root.path,
+                                   request_body->data,
+                                   0,  /* ignored */
+                                   log_report_elements, 
+                                   log_validate,
+                                   log_start_element,
+                                   log_end_element,
+                                   &lb,
+                                   ras->pool);
   
   svn_pool_destroy (lb.subpool);
 
+  /* If RECEIVER failed, the parse was stopped on its account; its
+     error says more than the parser's does. */
+  if (lb.err)
+    {
+      if (err)
+        svn_error_clear_all (err);
+      return lb.err;
+    }
+  SVN_ERR (err);
+
   return SVN_NO_ERROR;
 }
 
@@ -31,6 +31,7 @@
 #include "svn_error.h"
 #include "svn_path.h"
 #include "svn_ra.h"
+#include "svn_dav.h"
 
 #include "ra_dav.h"
 
@@ -506,18 +507,22 @@ static int end_element(void *userdata, const struct ne_xml_elm *elm,
   return 0;
 }
 
-svn_error_t * svn_ra_dav__merge_activity(
-    svn_revnum_t *new_rev,
-    const char **committed_date,
-    const char **committed_author,
-    svn_ra_session_t *ras,
-    const char *repos_url,
-    const char *activity_url,
-    apr_hash_t *valid_targets,
-    apr_pool_t *pool)
+/* Send a METHOD request to REPOS_URL, whose body is BODY or, if that is
+   null, the contents of the file FD, with a Content-Type of CONTENT_TYPE.
+   Handle the merge response as svn_ra_dav__merge_activity does. */
+static svn_error_t * merge_request(svn_revnum_t *new_rev,
+                                   const char **committed_date,
+                                   const char **committed_author,
+                                   svn_ra_session_t *ras,
+                                   const char *method,
+                                   const char *repos_url,
+                                   const char *body,
+                                   int fd,
+                                   const char *content_type,
+                                   apr_hash_t *valid_targets,
+                                   apr_pool_t *pool)
 {
   merge_ctx_t mc = { 0 };
-  const char *body;
 
   mc.pool = pool;
   mc.base_href = repos_url;
@@ -534,22 +539,11 @@ svn_error_t * svn_ra_dav__merge_activity(
   mc.committed_date = MAKE_BUFFER(pool);
   mc.last_author = MAKE_BUFFER(pool);
 
-
-  body = apr_psprintf(pool,
-                      "<?xml version=\"1.0\" encoding=\"utf-8\"?>"
-                      "<D:merge xmlns:D=\"DAV:\">"
-                      "<D:source><D:href>%s</D:href></D:source>"
-                      "<D:no-auto-merge/><D:no-checkout/>"
-                      "<D:prop>"
-                      "<D:checked-in/><D:version-name/><D:resourcetype/>"
-                      "<D:creationdate/><D:creator-displayname/>"
-                      "</D:prop>"
-                      "</D:merge>", activity_url);
-
-  SVN_ERR( svn_ra_dav__parsed_request(ras, "MERGE", repos_url, body, 0,
-                                      merge_elements, validate_element,
-                                      start_element, end_element, &mc,
-                                      pool) );
+  SVN_ERR( svn_ra_dav__parsed_request_full(ras, method, repos_url, body, fd,
+                                           content_type, NULL, NULL, NULL,
+                                           merge_elements, validate_element,
+                                           start_element, end_element, &mc,
+                                           pool) );
 
   /* is there an error stashed away in our context? */
   if (mc.err != NULL)
@@ -570,7 +564,51 @@ svn_error_t * svn_ra_dav__merge_activity(
   return NULL;
 }
 
-
+svn_error_t * svn_ra_dav__merge_activity(
+    svn_revnum_t *new_rev,
+    const char **committed_date,
+    const char **committed_author,
+    svn_ra_session_t *ras,
+    const char *repos_url,
+    const char *activity_url,
+    apr_hash_t *valid_targets,
+    apr_pool_t *pool)
+{
+  const char *body;
+
+  body = apr_psprintf(pool,
+                      "<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+                      "<D:merge xmlns:D=\"DAV:\">"
+                      "<D:source><D:href>%s</D:href></D:source>"
+                      "<D:no-auto-merge/><D:no-checkout/>"
+                      "<D:prop>"
+                      "<D:checked-in/><D:version-name/><D:resourcetype/>"
+                      "<D:creationdate/><D:creator-displayname/>"
+                      "</D:prop>"
+                      "</D:merge>", activity_url);
+
+  return merge_request(new_rev, committed_date, committed_author, ras,
+                       "MERGE", repos_url, body, 0, "text/xml",
+                       valid_targets, pool);
+}
+
+svn_error_t * svn_ra_dav__single_commit(
+    svn_revnum_t *new_rev,
+    const char **committed_date,
+    const char **committed_author,
+    svn_ra_session_t *ras,
+    const char *repos_url,
+    int fd,
+    apr_hash_t *valid_targets,
+    apr_pool_t *pool)
+{
+  /* the server answers with the same body as for a MERGE */
+  return merge_request(new_rev, committed_date, committed_author, ras,
+                       "POST", repos_url, NULL, fd, SVN_DAV_COMMIT_MIME_TYPE,
+                       valid_targets, pool);
+}
+
+
 /* 
  * local variables:
  * eval: (load-file "../../tools/dev/svn-dev.el")
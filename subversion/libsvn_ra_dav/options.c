@@ -19,12 +19,16 @@
 
 
 #include <apr_pools.h>
+#define APR_WANT_STRFUNC
+#include <apr_want.h>
 
 #include <ne_request.h>
 #include <ne_xml.h>
 
 #include "svn_error.h"
+#include "svn_string.h"
 #include "svn_ra.h"
+#include "svn_dav.h"
 
 #include "ra_dav.h"
 
@@ -40,6 +44,7 @@ static const struct ne_xml_elm options_elements[] =
 
 typedef struct {
   const svn_string_t *activity_url;
+  svn_boolean_t single_commit;  /* the DAV: header lists single-commit */
   apr_pool_t *pool;
 
 } options_ctx_t;
@@ -95,29 +100,40 @@ static int end_element(void *userdata, const struct ne_xml_elm *elm,
   return 0;
 }
 
-svn_error_t * svn_ra_dav__get_activity_url(const svn_string_t **activity_url,
-                                           svn_ra_session_t *ras,
-                                           const char *url,
-                                           apr_pool_t *pool)
+/* Look for the single-commit token in a DAV: header. */
+static void dav_header_handler(void *userdata, const char *value)
 {
-  options_ctx_t oc = { 0 };
+  options_ctx_t *oc = userdata;
+  apr_array_header_t *tokens = svn_cstring_split(value, ',', TRUE, oc->pool);
+  int i;
+
+  for (i = 0; i < tokens->nelts; i++)
+    if (strcmp(APR_ARRAY_IDX(tokens, i, const char *),
+               SVN_DAV_OPTION_SINGLE_COMMIT) == 0)
+      oc->single_commit = TRUE;
+}
 
-#if 0
-  ne_add_response_header_handler(req, "dav",
-                                 ne_duplicate_header, &dav_header);
-#endif
+svn_error_t * svn_ra_dav__get_commit_options(const svn_string_t **activity_url,
+                                             svn_boolean_t *single_commit,
+                                             svn_ra_session_t *ras,
+                                             const char *url,
+                                             apr_pool_t *pool)
+{
+  options_ctx_t oc = { 0 };
 
   oc.pool = pool;
 
-  SVN_ERR( svn_ra_dav__parsed_request(ras, "OPTIONS", url,
-                                      "<?xml version=\"1.0\" "
-                                      "encoding=\"utf-8\"?>"
-                                      "<D:options xmlns:D=\"DAV:\">"
-                                      "<D:activity-collection-set/>"
-                                      "</D:options>", 0,
-                                      options_elements, validate_element,
-                                      start_element, end_element, &oc,
-                                      pool) );
+  SVN_ERR( svn_ra_dav__parsed_request_full(ras, "OPTIONS", url,
+                                           "<?xml version=\"1.0\" "
+                                           "encoding=\"utf-8\"?>"
+                                           "<D:options xmlns:D=\"DAV:\">"
+                                           "<D:activity-collection-set/>"
+                                           "</D:options>", 0,
+                                           "text/xml",
+                                           "dav", dav_header_handler, &oc,
+                                           options_elements, validate_element,
+                                           start_element, end_element, &oc,
+                                           pool) );
 
   if (oc.activity_url == NULL)
     {
@@ -131,11 +147,23 @@ svn_error_t * svn_ra_dav__get_activity_url(const svn_string_t **activity_url,
     }
 
   *activity_url = oc.activity_url;
+  *single_commit = oc.single_commit;
 
   return SVN_NO_ERROR;
 }
 
-
+svn_error_t * svn_ra_dav__get_activity_url(const svn_string_t **activity_url,
+                                           svn_ra_session_t *ras,
+                                           const char *url,
+                                           apr_pool_t *pool)
+{
+  svn_boolean_t single_commit;
+
+  return svn_ra_dav__get_commit_options(activity_url, &single_commit,
+                                        ras, url, pool);
+}
+
+
 /* 
  * local variables:
  * eval: (load-file "../../tools/dev/svn-dev.el")
@@ -134,6 +134,7 @@ svn_error_t * svn_ra_dav__get_log(
   const apr_array_header_t *paths,
   svn_revnum_t start,
   svn_revnum_t end,
+  int limit,
   svn_boolean_t discover_changed_paths,
   svn_log_message_receiver_t receiver,
   void *receiver_baton);
@@ -271,6 +272,15 @@ svn_error_t * svn_ra_dav__get_activity_url(const svn_string_t **activity_url,
                                            const char *url,
                                            apr_pool_t *pool);
 
+/* Like svn_ra_dav__get_activity_url, and also set *SINGLE_COMMIT to
+   whether the server takes a whole commit in one POST (see
+   SVN_DAV_OPTION_SINGLE_COMMIT). */
+svn_error_t * svn_ra_dav__get_commit_options(const svn_string_t **activity_url,
+                                             svn_boolean_t *single_commit,
+                                             svn_ra_session_t *ras,
+                                             const char *url,
+                                             apr_pool_t *pool);
+
 
 /* Send a METHOD request (e.g., "MERGE", "REPORT", "PROPFIND") to URL
  * in session RAS, and parse the response.  If BODY is non-null, it is
@@ -296,6 +306,28 @@ svn_error_t *svn_ra_dav__parsed_request(svn_ra_session_t *ras,
                                         void *baton,
                                         apr_pool_t *pool);
 
+/* Like svn_ra_dav__parsed_request, but send the body with a Content-Type
+ * of CONTENT_TYPE rather than "text/xml", and, if HEADER_NAME is
+ * non-null, call HEADER_HANDLER with HEADER_BATON for each response
+ * header of that name.
+ */
+svn_error_t *
+svn_ra_dav__parsed_request_full(svn_ra_session_t *ras,
+                                const char *method,
+                                const char *url,
+                                const char *body,
+                                int fd,
+                                const char *content_type,
+                                const char *header_name,
+                                ne_header_handler header_handler,
+                                void *header_baton,
+                                const struct ne_xml_elm *elements, 
+                                ne_xml_validate_cb validate_cb,
+                                ne_xml_startelm_cb startelm_cb, 
+                                ne_xml_endelm_cb endelm_cb,
+                                void *baton,
+                                apr_pool_t *pool);
+
 
 /* ### add SVN_RA_DAV_ to these to prefix conflicts with (sys) headers? */
 enum {
@@ -341,7 +373,10 @@ enum {
   ELEM_name_creationdate,
   ELEM_name_creator_displayname,
   ELEM_svn_error,
-  ELEM_human_readable
+  ELEM_human_readable,
+  ELEM_txdelta,
+  ELEM_svndiff,
+  ELEM_set_prop
 };
 
 /* ### docco */
@@ -355,6 +390,19 @@ svn_error_t * svn_ra_dav__merge_activity(
     apr_hash_t *valid_targets,
     apr_pool_t *pool);
 
+/* POST the commit body in the file FD (see SVN_DAV_COMMIT_MIME_TYPE) to
+   REPOS_URL, and handle the response as svn_ra_dav__merge_activity
+   does. */
+svn_error_t * svn_ra_dav__single_commit(
+    svn_revnum_t *new_rev,
+    const char **committed_date,
+    const char **committed_author,
+    svn_ra_session_t *ras,
+    const char *repos_url,
+    int fd,
+    apr_hash_t *valid_targets,
+    apr_pool_t *pool);
+
 
 /* Make a buffer for repeated use with svn_stringbuf_set().
    ### it would be nice to start this buffer with N bytes, but there isn't
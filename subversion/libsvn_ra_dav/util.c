@@ -218,6 +218,31 @@ svn_error_t *svn_ra_dav__parsed_request(svn_ra_session_t *ras,
                                         ne_xml_endelm_cb endelm_cb,
                                         void *baton,
                                         apr_pool_t *pool)
+{
+  return svn_ra_dav__parsed_request_full(ras, method, url, body, fd,
+                                         "text/xml", NULL, NULL, NULL,
+                                         elements, validate_cb,
+                                         startelm_cb, endelm_cb, baton,
+                                         pool);
+}
+
+
+svn_error_t *
+svn_ra_dav__parsed_request_full(svn_ra_session_t *ras,
+                                const char *method,
+                                const char *url,
+                                const char *body,
+                                int fd,
+                                const char *content_type,
+                                const char *header_name,
+                                ne_header_handler header_handler,
+                                void *header_baton,
+                                const struct ne_xml_elm *elements, 
+                                ne_xml_validate_cb validate_cb,
+                                ne_xml_startelm_cb startelm_cb, 
+                                ne_xml_endelm_cb endelm_cb,
+                                void *baton,
+                                apr_pool_t *pool)
 {
   ne_request *req;
   ne_xml_parser *success_parser;
@@ -238,8 +263,11 @@ svn_error_t *svn_ra_dav__parsed_request(svn_ra_session_t *ras,
   else
     ne_set_request_body_fd(req, fd);
 
-  /* ### use a symbolic name somewhere for this MIME type? */
-  ne_add_request_header(req, "Content-Type", "text/xml");
+  ne_add_request_header(req, "Content-Type", content_type);
+
+  if (header_name != NULL)
+    ne_add_response_header_handler(req, header_name,
+                                   header_handler, header_baton);
 
   /* create a parser to read the normal response body */
   success_parser = ne_xml_create();
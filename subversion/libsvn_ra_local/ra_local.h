@@ -69,27 +69,6 @@ typedef struct svn_ra_local__session_baton_t
 
 
 
-
-/*** Making changes to a filesystem, editor-style.  */
-
-/* Hook function type for commits.  When a filesystem commit succeeds,
- * an instance of this is invoked on the NEW_REVISION, DATE, and
- * AUTHOR of the commit, along with the BATON closure.
- *
- * See also svn_ra_local__get_editor.
- *
- * NOTE: this "hook" is not related to the standard repository hooks
- * run before and after commits, which are configured in the
- * repository's conf/ subdirectory.  When most users say "hook",
- * they're talking about those, not about this function type.
- */
-typedef svn_error_t *svn_ra_local__commit_hook_t (svn_revnum_t new_revision,
-                                                  const char *date,
-                                                  const char *author,
-                                                  void *baton);
-
-
-
 
 /** Private routines **/
 
@@ -126,36 +105,6 @@ svn_ra_local__checkout (svn_fs_t *fs,
                         apr_pool_t *pool);
 
 
-/* Return an EDITOR and EDIT_BATON to commit changes to SESSION->fs,
- * beginning at location `rev:SESSION->base_path', where "rev" is the
- * argument given to open_root().  Store SESSION->user as the
- * author of the commit and LOG_MSG as the commit message.
- *
- * FS is a previously opened file system.
- *
- * Calling (*EDITOR)->close_edit completes the commit.  Before
- * close_edit returns, but after the commit has succeeded, it will
- * invoke HOOK with the new revision number, the commit date (as a
- * const char *), commit author (as a const char *), and HOOK_BATON
- * as arguments.  If HOOK returns an error, that error will be
- * returned from close_edit, otherwise close_edit will return
- * successfully (unless it encountered an error before invoking HOOK).
- *
- * NOTE: this HOOK is not related to the standard repository hooks
- * run before and after commits, which are configured in the
- * repository's conf/ subdirectory.  When most users say "hook",
- * they're referring to those, not to this HOOK argument.
- */
-svn_error_t *svn_ra_local__get_editor (const svn_delta_editor_t **editor,
-                                       void **edit_baton,
-                                       svn_ra_local__session_baton_t *session,
-                                       svn_stringbuf_t *log_msg,
-                                       svn_ra_local__commit_hook_t *hook,
-                                       void *hook_baton,
-                                       apr_pool_t *pool);
-
-
-
 /* Return an EDITOR and EDIT_BATON which "wrap" around a given
    UPDATE_EDITOR and UPDATE_EDIT_BATON.  SESSION is the currently open
    ra_local session object.
@@ -53,7 +53,7 @@ struct commit_cleanup_baton
 };
 
 
-/* An instance of svn_ra_local__commit_hook_t.
+/* An instance of svn_repos_commit_callback_t.
  * 
  * BATON is `struct commit_cleanup_baton *'.  Loop over all committed
  * target paths in BATON->committed_targets, invoking
@@ -64,7 +64,7 @@ struct commit_cleanup_baton
  * *(BATON->committed_date) respectively, allocating the new storage
  * in BATON->pool.
  *
- * This routine is originally passed as a "hook" to the filesystem
+ * This routine is originally passed as a callback to the repository
  * commit editor.  When we get here, the track-editor has already
  * stored committed targets inside the baton.
  */
@@ -236,6 +236,17 @@ svn_ra_local__get_commit_editor (void *session_baton,
   svn_ra_local__session_baton_t *sess_baton = session_baton;
   struct commit_cleanup_baton *cb
     = apr_pcalloc (sess_baton->pool, sizeof (*cb));
+  svn_string_t log_str;
+
+  /* The URL of the repository itself is the session's URL, less the
+     path within the repository. */
+  const char *repos_url
+    = apr_pstrndup (sess_baton->pool, sess_baton->repository_URL->data,
+                    (sess_baton->repository_URL->len
+                     - sess_baton->fs_path->len));
+
+  log_str.data = log_msg->data;
+  log_str.len = log_msg->len;
 
   /* Construct a commit cleanup baton */
   cb->pool = sess_baton->pool;
@@ -245,9 +256,14 @@ svn_ra_local__get_commit_editor (void *session_baton,
   cb->committed_author = committed_author;
                                          
   /* Get the repos commit-editor */     
-  SVN_ERR (svn_ra_local__get_editor (editor, edit_baton, sess_baton,
-                                     log_msg, cleanup_commit, cb,
-                                     sess_baton->pool));
+  SVN_ERR (svn_repos_get_commit_editor (editor, edit_baton,
+                                        sess_baton->repos,
+                                        repos_url,
+                                        sess_baton->fs_path->data,
+                                        sess_baton->username,
+                                        &log_str,
+                                        cleanup_commit, cb,
+                                        sess_baton->pool));
 
   return SVN_NO_ERROR;
 }
@@ -485,6 +501,7 @@ svn_ra_local__get_log (void *session_baton,
                        const apr_array_header_t *paths,
                        svn_revnum_t start,
                        svn_revnum_t end,
+                       int limit,
                        svn_boolean_t discover_changed_paths,
                        svn_log_message_receiver_t receiver,
                        void *receiver_baton)
@@ -519,6 +536,7 @@ svn_ra_local__get_log (void *session_baton,
                              abs_paths,
                              start,
                              end,
+                             limit,
                              discover_changed_paths,
                              receiver,
                              receiver_baton,
@@ -1,4 +1,4 @@
-/* commit-editor.c --- editor for commiting changes to a filesystem.
+/* commit.c --- editor for committing changes to a repository.
  *
  * ====================================================================
  * Copyright (c) 2000-2002 CollabNet.  All rights reserved.
@@ -27,7 +27,6 @@
 #include "svn_delta.h"
 #include "svn_fs.h"
 #include "svn_repos.h"
-#include "ra_local.h"
 
 
 
@@ -39,9 +38,6 @@ struct edit_baton
 
   /** Supplied when the editor is created: **/
 
-  /* The active RA session */
-  svn_ra_local__session_baton_t *session;
-
   /* The user doing the commit.  Presumably, some higher layer has
      already authenticated this user. */
   const char *user;
@@ -49,13 +45,16 @@ struct edit_baton
   /* Commit message for this commit. */
   svn_string_t log_msg;
 
-  /* Hook to run when when the commit is done. */
-  svn_ra_local__commit_hook_t *hook;
-  void *hook_baton;
+  /* Callback to run when the commit is done. */
+  svn_repos_commit_callback_t *callback;
+  void *callback_baton;
 
   /* The already-open svn repository to commit to. */
   svn_repos_t *repos;
 
+  /* The URL of the repository's root; copy sources must lie within it. */
+  const char *repos_url;
+
   /* The filesystem associated with the REPOS above (here for
      convenience). */
   svn_fs_t *fs;
@@ -114,6 +113,52 @@ out_of_date (const char *path, const char *txn_name, apr_pool_t *pool)
 }
 
 
+/* Return the path part of URL: whatever follows the scheme and the
+   host, if it has them. */
+static const char *
+url_path (const char *url)
+{
+  const char *p = strstr (url, "://");
+
+  if (p == NULL)
+    return url;
+
+  p = strchr (p + 3, '/');
+  return p ? p : "";
+}
+
+
+/* Set *FS_PATH to the path in EB's repository of the copy source
+   COPY_URL, which is to be copied to FULL_PATH.  Return an error if
+   COPY_URL is not in that repository.  */
+static svn_error_t *
+copy_source_path (const char **fs_path,
+                  struct edit_baton *eb,
+                  const char *copy_url,
+                  const char *full_path,
+                  apr_pool_t *pool)
+{
+  const char *repos_path = url_path (eb->repos_url);
+  const char *src_path = url_path (copy_url);
+  apr_size_t len = strlen (repos_path);
+
+  /* A root of "/" (or "") matches every path. */
+  if (len > 0 && repos_path[len - 1] == '/')
+    len--;
+
+  /* For now, require that the url come from the same repository
+     that this commit is operating on. */
+  if (strncmp (src_path, repos_path, len) != 0
+      || (src_path[len] != '/' && src_path[len] != '\0'))
+    return svn_error_createf 
+      (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+       "copy of `%s': copy_url is from different repo", full_path);
+
+  *fs_path = src_path[len] ? src_path + len : "/";
+  return SVN_NO_ERROR;
+}
+
+
 
 /*** Editor functions ***/
 
@@ -213,8 +258,7 @@ add_directory (const char *path,
 
   if (copy_path)
     {
-      const svn_string_t *repos_path;
-      const svn_string_t *fs_path;
+      const char *fs_path;
       svn_fs_root_t *copy_root;
       svn_node_kind_t kind;
 
@@ -224,23 +268,15 @@ add_directory (const char *path,
       if (kind != svn_node_none)
         return out_of_date (full_path, eb->txn_name, subpool);
 
-      /* This add has history.  Let's split the copy_url. */
-      SVN_ERR (svn_ra_local__split_URL 
-               (&repos_path, &fs_path, 
-                svn_stringbuf_create (copy_path, subpool), subpool));
-
-      /* For now, require that the url come from the same repository
-         that this commit is operating on. */
-      if (strcmp (eb->session->repos_path->data, repos_path->data) != 0)
-        return svn_error_createf 
-          (SVN_ERR_FS_GENERAL, 0, NULL, subpool,
-           "add_dir `%s': copy_url is from different repo", full_path);
+      /* This add has history.  Find the source in the repository. */
+      SVN_ERR (copy_source_path (&fs_path, eb, copy_path, full_path,
+                                 subpool));
       
       /* Now use the "fs_path" as an absolute path within the
          repository to make the copy from. */      
       SVN_ERR (svn_fs_revision_root (&copy_root, eb->fs,
                                      copy_revision, subpool));
-      SVN_ERR (svn_fs_copy (copy_root, fs_path->data,
+      SVN_ERR (svn_fs_copy (copy_root, fs_path,
                             eb->txn_root, full_path, subpool));
     }
   else
@@ -334,8 +370,7 @@ add_file (const char *path,
 
   if (copy_path)
     {      
-      const svn_string_t *repos_path; 
-      const svn_string_t *fs_path;
+      const char *fs_path;
       svn_fs_root_t *copy_root;
       svn_node_kind_t kind;
 
@@ -345,23 +380,15 @@ add_file (const char *path,
       if (kind != svn_node_none)
         return out_of_date (full_path, eb->txn_name, subpool);
 
-      /* This add has history.  Let's split the copyfrom_url. */
-      SVN_ERR (svn_ra_local__split_URL 
-               (&repos_path, &fs_path, 
-                svn_stringbuf_create (copy_path, subpool), subpool));
-
-      /* For now, require that the url come from the same repository
-         that this commit is operating on. */
-      if (strcmp (eb->session->repos_path->data, repos_path->data) != 0)
-            return svn_error_createf 
-              (SVN_ERR_FS_GENERAL, 0, NULL, eb->pool,
-               "add_file `%s': copy_url is from different repo", full_path);
+      /* This add has history.  Find the source in the repository. */
+      SVN_ERR (copy_source_path (&fs_path, eb, copy_path, full_path,
+                                 subpool));
       
       /* Now use the "fs_path" as an absolute path within the
          repository to make the copy from. */      
       SVN_ERR (svn_fs_revision_root (&copy_root, eb->fs,
                                      copy_revision, subpool));
-      SVN_ERR (svn_fs_copy (copy_root, fs_path->data, 
+      SVN_ERR (svn_fs_copy (copy_root, fs_path, 
                             eb->txn_root, full_path, subpool));
     }
   else
@@ -478,12 +505,16 @@ close_edit (void *edit_baton)
          orignal error. There's likely something seriously wrong already, and
          we don't want to cover it up.  */
       svn_fs_abort_txn (eb->txn);
+      eb->txn = NULL;
       return err;
     }
 
-  /* Pass new revision information to the caller's hook.  Note that
-     this hook is unrelated to the standard repository post-commit
-     hooks.  See svn_repos.h for more on this. */
+  /* The txn is a revision now; there is nothing left to abort. */
+  eb->txn = NULL;
+
+  /* Pass new revision information to the caller's callback.  Note
+     that this is unrelated to the standard repository post-commit
+     hooks. */
   {
     svn_string_t *date, *author;
 
@@ -495,8 +526,8 @@ close_edit (void *edit_baton)
                                    new_revision, SVN_PROP_REVISION_AUTHOR,
                                    eb->pool));
 
-    SVN_ERR ((*eb->hook) (new_revision, date->data, author->data,
-                          eb->hook_baton));
+    SVN_ERR ((*eb->callback) (new_revision, date->data, author->data,
+                              eb->callback_baton));
   }
 
   return SVN_NO_ERROR;
@@ -508,7 +539,14 @@ static svn_error_t *
 abort_edit (void *edit_baton)
 {
   struct edit_baton *eb = edit_baton;
-  return (eb->txn ? svn_fs_abort_txn (eb->txn) : SVN_NO_ERROR);
+  svn_fs_txn_t *txn = eb->txn;
+
+  /* Forget the txn first, so that aborting the edit again is
+     harmless even if this abort fails. */
+  if (! txn)
+    return SVN_NO_ERROR;
+  eb->txn = NULL;
+  return svn_fs_abort_txn (txn);
 }
 
 
@@ -517,13 +555,16 @@ abort_edit (void *edit_baton)
 /*** Public interface. ***/
 
 svn_error_t *
-svn_ra_local__get_editor (const svn_delta_editor_t **editor,
-                          void **edit_baton,
-                          svn_ra_local__session_baton_t *session,
-                          svn_stringbuf_t *log_msg,
-                          svn_ra_local__commit_hook_t *hook,
-                          void *hook_baton,
-                          apr_pool_t *pool)
+svn_repos_get_commit_editor (const svn_delta_editor_t **editor,
+                             void **edit_baton,
+                             svn_repos_t *repos,
+                             const char *repos_url,
+                             const char *base_path,
+                             const char *user,
+                             const svn_string_t *log_msg,
+                             svn_repos_commit_callback_t *callback,
+                             void *callback_baton,
+                             apr_pool_t *pool)
 {
   svn_delta_editor_t *e = svn_delta_default_editor (pool);
   apr_pool_t *subpool = svn_pool_create (pool);
@@ -544,15 +585,15 @@ svn_ra_local__get_editor (const svn_delta_editor_t **editor,
 
   /* Set up the edit baton. */
   eb->pool = subpool;
-  eb->user = apr_pstrdup (subpool, session->username);
+  eb->user = apr_pstrdup (subpool, user);
   eb->log_msg.data = apr_pmemdup (subpool, log_msg->data, log_msg->len + 1);
   eb->log_msg.len = log_msg->len;
-  eb->hook = hook;
-  eb->hook_baton = hook_baton;
-  eb->base_path = svn_stringbuf_create_from_string (session->fs_path, subpool);
-  eb->session = session;
-  eb->repos = session->repos;
-  eb->fs = svn_repos_fs (session->repos);
+  eb->callback = callback;
+  eb->callback_baton = callback_baton;
+  eb->base_path = svn_stringbuf_create (base_path, subpool);
+  eb->repos = repos;
+  eb->repos_url = apr_pstrdup (subpool, repos_url);
+  eb->fs = svn_repos_fs (repos);
   eb->txn = NULL;
 
   *edit_baton = eb;
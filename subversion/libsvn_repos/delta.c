@@ -17,13 +17,25 @@
  */
 
 
+#include <string.h>
+
+#include <apr_general.h>
+
+#if APR_HAS_THREADS
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
+#endif
+
 #include "svn_types.h"
 #include "svn_delta.h"
 #include "svn_fs.h"
 #include "svn_path.h"
 #include "apr_hash.h"
+#include "apr_strings.h"
 #include "svn_repos.h"
 #include "svn_pools.h"
+#include "repos.h"
 
 
 
@@ -49,6 +61,22 @@ struct context {
   svn_boolean_t recurse;
   svn_boolean_t use_copyfrom_args;
   int target_is_rev;
+
+  /* If non-NULL, the source tree is described by this sorted array of
+     reported paths instead of SOURCE_ROOT and SOURCE_REV_DIFFS; see
+     svn_repos__dir_delta_report().  Each source path is read from the
+     revision root of FS given by its nearest reported ancestor.  */
+  const apr_array_header_t *report_paths;
+  svn_fs_t *fs;
+
+  /* The revision roots opened for REPORT_PATHS so far, keyed on
+     svn_revnum_t, and the pool they live in.  */
+  apr_hash_t *report_roots;
+  apr_pool_t *pool;
+
+  /* If non-NULL, worker threads reading ahead of the traversal; see
+     svn_repos_dir_delta_pipelined().  */
+  struct prefetcher *prefetch;
 };
 
 
@@ -74,6 +102,60 @@ static svn_revnum_t get_revision_from_hash (apr_hash_t *hash,
                                             apr_pool_t *pool);
 
 
+/* Reading the source tree.  */
+static svn_error_t *get_source_root (svn_fs_root_t **root,
+                                     struct context *c,
+                                     const char *path,
+                                     apr_pool_t *pool);
+
+static svn_revnum_t get_source_revision (struct context *c,
+                                         const char *path,
+                                         apr_pool_t *pool);
+
+static svn_error_t *get_source_entries (apr_hash_t **entries,
+                                        struct context *c,
+                                        const char *path,
+                                        apr_pool_t *pool);
+
+static svn_boolean_t has_reported_children (struct context *c,
+                                            const char *path);
+
+
+/* Reading ahead on worker threads.  */
+struct prefetch_job;
+
+static svn_error_t *prefetch_start (struct prefetcher **pf,
+                                    struct context *c,
+                                    svn_repos_t *repos,
+                                    int num_threads,
+                                    apr_pool_t *pool);
+
+static void prefetch_stop (struct prefetcher *pf);
+
+static svn_error_t *prefetch_dir (int *batch,
+                                  struct context *c,
+                                  const char *source_path,
+                                  const char *target_path,
+                                  apr_hash_t *s_entries,
+                                  apr_hash_t *t_entries,
+                                  apr_pool_t *pool);
+
+static void prefetch_end_dir (struct context *c, int batch);
+
+static struct prefetch_job *prefetch_take (struct context *c,
+                                           const char *source_path,
+                                           const char *target_path);
+
+static svn_error_t *send_prefetched_file (struct context *c,
+                                          void *file_baton,
+                                          struct prefetch_job *job,
+                                          const char *source_path,
+                                          const char *target_path,
+                                          apr_pool_t *pool);
+
+static void prefetch_release (struct context *c, struct prefetch_job *job);
+
+
 /* proplist_change_fn_t property changing functions.  */
 static svn_error_t *change_dir_prop (struct context *c, 
                                      void *object,
@@ -160,23 +242,20 @@ not_a_dir_error (const char *role,
 }
 
 
-/* Public interface to computing directory deltas.  */
-svn_error_t *
-svn_repos_dir_delta (svn_fs_root_t *src_root,
-                     const char *src_parent_dir,
-                     const char *src_entry,
-                     apr_hash_t *src_revs,
-                     svn_fs_root_t *tgt_root,
-                     const char *tgt_path,
-                     const svn_delta_edit_fns_t *editor,
-                     void *edit_baton,
-                     svn_boolean_t text_deltas,
-                     svn_boolean_t recurse,
-                     svn_boolean_t use_copyfrom_args,
-                     apr_pool_t *pool)
+/* Compute the delta described by the context C, as documented for
+   svn_repos_dir_delta().  */
+static svn_error_t *
+dir_delta (struct context *c,
+           const char *src_parent_dir,
+           const char *src_entry,
+           const char *tgt_path,
+           void *edit_baton,
+           apr_pool_t *pool)
 {
+  const svn_delta_edit_fns_t *editor = c->editor;
+  svn_fs_root_t *tgt_root = c->target_root;
+  svn_fs_root_t *src_root;
   void *root_baton;
-  struct context c;
   svn_stringbuf_t *tgt_parent_dir, *tgt_entry;
   svn_stringbuf_t *src_fullpath;
   svn_fs_id_t *src_id, *tgt_id;
@@ -216,47 +295,35 @@ svn_repos_dir_delta (svn_fs_root_t *src_root,
   svn_stringbuf_set (tempbuf, src_parent_dir);
   if (! svn_path_is_empty (tempbuf))
     {
-      int s_dir, t_dir;
-      SVN_ERR (svn_fs_is_dir (&s_dir, src_root, src_parent_dir, pool));
+      int s_dir = 0, t_dir;
+      SVN_ERR (get_source_root (&src_root, c, src_parent_dir, pool));
+      if (src_root)
+        SVN_ERR (svn_fs_is_dir (&s_dir, src_root, src_parent_dir, pool));
       SVN_ERR (svn_fs_is_dir (&t_dir, tgt_root, tgt_parent_dir->data, pool));
       if ((! s_dir) || (! t_dir))
         return not_a_dir_error ("source parent", src_parent_dir, pool);
     }
   if (! svn_path_is_empty (tgt_parent_dir))
     {
-      int s_dir, t_dir;
-      SVN_ERR (svn_fs_is_dir (&s_dir, src_root, tgt_parent_dir->data, pool));
+      int s_dir = 0, t_dir;
+      SVN_ERR (get_source_root (&src_root, c, tgt_parent_dir->data, pool));
+      if (src_root)
+        SVN_ERR (svn_fs_is_dir (&s_dir, src_root, tgt_parent_dir->data,
+                                pool));
       SVN_ERR (svn_fs_is_dir (&t_dir, tgt_root, tgt_parent_dir->data, pool));
       if ((! s_dir) || (! t_dir))
         return not_a_dir_error ("target parent", tgt_parent_dir->data, pool);
     }
-  
-  /* Setup our pseudo-global structure here.  We need these variables
-     throughout the deltafication process, so pass them around by
-     reference to all the helper functions. */
-  c.editor = editor;
-  c.source_root = src_root;
-  c.source_rev_diffs = src_revs;
-  c.target_root = tgt_root;
-  c.target_is_rev = svn_fs_is_revision_root (tgt_root);
-  c.recurse = recurse;
-  c.text_deltas = text_deltas;
-
-#if SVN_REPOS_SUPPORT_COPY_FROM_ARGS
-  c.use_copyfrom_args = use_copyfrom_args;
-#else
-  c.use_copyfrom_args = FALSE;
-#endif
 
   /* Set the global target revision if the target is a revision. */
-  if (c.target_is_rev)
+  if (c->target_is_rev)
     SVN_ERR (editor->set_target_revision 
              (edit_baton, svn_fs_revision_root_revision (tgt_root)));
 
   /* Call open_root to get our root_baton... */
   SVN_ERR (editor->open_root 
            (edit_baton, 
-            get_revision_from_hash (src_revs, src_parent_dir, pool),
+            get_source_revision (c, src_parent_dir, pool),
             &root_baton));
 
   /* Construct the full path of the source and target update items. */
@@ -273,7 +340,7 @@ svn_repos_dir_delta (svn_fs_root_t *src_root,
           /* Caller thinks that target still exists, but it doesn't.
              So just delete the target and go home.  */
           svn_error_clear_all (err);
-          SVN_ERR (delete (&c, root_baton, src_entry, pool));
+          SVN_ERR (delete (c, root_baton, src_entry, pool));
           goto cleanup;
         }
       else
@@ -281,7 +348,12 @@ svn_repos_dir_delta (svn_fs_root_t *src_root,
           return err;
         }
     }
-  err = svn_fs_node_id (&src_id, src_root, src_fullpath->data, pool);
+  SVN_ERR (get_source_root (&src_root, c, src_fullpath->data, pool));
+  if (src_root)
+    err = svn_fs_node_id (&src_id, src_root, src_fullpath->data, pool);
+  else
+    err = svn_error_create (SVN_ERR_FS_NOT_FOUND, 0, 0, pool,
+                            "svn_repos_dir_delta: source was not reported");
   if (err)
     {
       if (err->apr_err == SVN_ERR_FS_NOT_FOUND)
@@ -289,7 +361,7 @@ svn_repos_dir_delta (svn_fs_root_t *src_root,
           /* The target has been deleted from our working copy. Add
              back a new one. */
           svn_error_clear_all (err);
-          SVN_ERR (add_file_or_dir (&c, root_baton,
+          SVN_ERR (add_file_or_dir (c, root_baton,
                                     NULL,
                                     NULL,
                                     tgt_parent_dir->data,
@@ -306,7 +378,7 @@ svn_repos_dir_delta (svn_fs_root_t *src_root,
       /* Use the distance between the node ids to determine the best
          way to update the requested entry. */
       distance = svn_fs_id_distance (src_id, tgt_id);
-      if (distance == 0)
+      if (distance == 0 && ! has_reported_children (c, src_fullpath->data))
         {
           /* They're the same node!  No-op (you gotta love those). */
         }
@@ -314,8 +386,8 @@ svn_repos_dir_delta (svn_fs_root_t *src_root,
         {
           /* The nodes are not related at all.  Delete the one, and
              add the other. */
-          SVN_ERR (delete (&c, root_baton, src_entry, pool));
-          SVN_ERR (add_file_or_dir (&c, root_baton,
+          SVN_ERR (delete (c, root_baton, src_entry, pool));
+          SVN_ERR (add_file_or_dir (c, root_baton,
                                     NULL, NULL,
                                     tgt_parent_dir->data,
                                     tgt_entry->data,
@@ -325,7 +397,7 @@ svn_repos_dir_delta (svn_fs_root_t *src_root,
         {
           /* The nodes are at least related.  Just open the one
              with the other. */
-          SVN_ERR (replace_file_or_dir (&c, root_baton,
+          SVN_ERR (replace_file_or_dir (c, root_baton,
                                         src_parent_dir,
                                         src_entry,
                                         tgt_parent_dir->data,
@@ -336,7 +408,7 @@ svn_repos_dir_delta (svn_fs_root_t *src_root,
   else
     {
       /* There is no entry given, so update the whole parent directory. */
-      SVN_ERR (delta_dirs (&c, root_baton,
+      SVN_ERR (delta_dirs (c, root_baton,
                            src_fullpath->data, tgt_path,
                            pool));
     }
@@ -354,7 +426,133 @@ svn_repos_dir_delta (svn_fs_root_t *src_root,
 }
 
 
-
+/* Run dir_delta() in the context C, reading ahead on NUM_THREADS
+   worker threads if that is more than zero, with filesystem handles
+   kept in REPOS if that is non-NULL.  */
+static svn_error_t *
+run_dir_delta (struct context *c,
+               svn_repos_t *repos,
+               int num_threads,
+               const char *src_parent_dir,
+               const char *src_entry,
+               const char *tgt_path,
+               void *edit_baton,
+               apr_pool_t *pool)
+{
+  svn_error_t *err;
+
+  c->prefetch = NULL;
+  SVN_ERR (prefetch_start (&c->prefetch, c, repos, num_threads, pool));
+  err = dir_delta (c, src_parent_dir, src_entry, tgt_path, edit_baton, pool);
+  prefetch_stop (c->prefetch);
+
+  return err;
+}
+
+
+/* Public interface to computing directory deltas.  */
+svn_error_t *
+svn_repos_dir_delta (svn_fs_root_t *src_root,
+                     const char *src_parent_dir,
+                     const char *src_entry,
+                     apr_hash_t *src_revs,
+                     svn_fs_root_t *tgt_root,
+                     const char *tgt_path,
+                     const svn_delta_edit_fns_t *editor,
+                     void *edit_baton,
+                     svn_boolean_t text_deltas,
+                     svn_boolean_t recurse,
+                     svn_boolean_t use_copyfrom_args,
+                     apr_pool_t *pool)
+{
+  return svn_repos_dir_delta_pipelined (src_root, src_parent_dir, src_entry,
+                                        src_revs, tgt_root, tgt_path,
+                                        editor, edit_baton, text_deltas,
+                                        recurse, use_copyfrom_args,
+                                        NULL, 0, pool);
+}
+
+
+svn_error_t *
+svn_repos_dir_delta_pipelined (svn_fs_root_t *src_root,
+                               const char *src_parent_dir,
+                               const char *src_entry,
+                               apr_hash_t *src_revs,
+                               svn_fs_root_t *tgt_root,
+                               const char *tgt_path,
+                               const svn_delta_edit_fns_t *editor,
+                               void *edit_baton,
+                               svn_boolean_t text_deltas,
+                               svn_boolean_t recurse,
+                               svn_boolean_t use_copyfrom_args,
+                               svn_repos_t *repos,
+                               int num_threads,
+                               apr_pool_t *pool)
+{
+  struct context c;
+
+  /* Setup our pseudo-global structure here.  We need these variables
+     throughout the deltafication process, so pass them around by
+     reference to all the helper functions. */
+  c.editor = editor;
+  c.source_root = src_root;
+  c.source_rev_diffs = src_revs;
+  c.target_root = tgt_root;
+  c.target_is_rev = svn_fs_is_revision_root (tgt_root);
+  c.recurse = recurse;
+  c.text_deltas = text_deltas;
+  c.report_paths = NULL;
+  c.fs = NULL;
+  c.report_roots = NULL;
+  c.pool = pool;
+
+#if SVN_REPOS_SUPPORT_COPY_FROM_ARGS
+  c.use_copyfrom_args = use_copyfrom_args;
+#else
+  c.use_copyfrom_args = FALSE;
+#endif
+
+  return run_dir_delta (&c, repos, num_threads, src_parent_dir, src_entry,
+                        tgt_path, edit_baton, pool);
+}
+
+
+svn_error_t *
+svn_repos__dir_delta_report (svn_fs_t *fs,
+                             const apr_array_header_t *report_paths,
+                             const char *src_parent_dir,
+                             const char *src_entry,
+                             svn_fs_root_t *tgt_root,
+                             const char *tgt_path,
+                             const svn_delta_edit_fns_t *editor,
+                             void *edit_baton,
+                             svn_boolean_t text_deltas,
+                             svn_boolean_t recurse,
+                             svn_repos_t *repos,
+                             apr_pool_t *pool)
+{
+  struct context c;
+
+  c.editor = editor;
+  c.source_root = NULL;
+  c.source_rev_diffs = NULL;
+  c.target_root = tgt_root;
+  c.target_is_rev = svn_fs_is_revision_root (tgt_root);
+  c.recurse = recurse;
+  c.text_deltas = text_deltas;
+  c.use_copyfrom_args = FALSE;
+  c.report_paths = report_paths;
+  c.fs = fs;
+  c.report_roots = apr_hash_make (pool);
+  c.pool = pool;
+
+  return run_dir_delta (&c, repos, repos->delta_threads, src_parent_dir,
+                        src_entry, tgt_path, edit_baton, pool);
+}
+
+
+
+
 /* Retrieving the base revision from the path/revision hash.  */
 
 
@@ -402,6 +600,223 @@ get_revision_from_hash (apr_hash_t *hash, const char *path,
 
 
 
+
+/* Reading the source tree.  */
+
+
+/* Return PATH without any leading slashes, the form in which paths
+   are kept in a report.  */
+static const char *
+report_key (const char *path)
+{
+  while (*path == '/')
+    path++;
+  return path;
+}
+
+
+/* Return the index of the first entry of the sorted REPORT_PATHS
+   whose path is not less than KEY.  */
+static int
+report_lower_bound (const apr_array_header_t *report_paths,
+                    const char *key)
+{
+  int lo = 0, hi = report_paths->nelts;
+
+  while (lo < hi)
+    {
+      int mid = (lo + hi) / 2;
+      const svn_repos__report_path_t *rp
+        = APR_ARRAY_IDX (report_paths, mid, svn_repos__report_path_t *);
+
+      if (strcmp (rp->path, key) < 0)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  return lo;
+}
+
+
+/* Return the entry reported for PATH itself or, failing that, for its
+   nearest reported ancestor; or NULL if there is none.  */
+static const svn_repos__report_path_t *
+find_report_path (struct context *c, const char *path, apr_pool_t *pool)
+{
+  char *key = apr_pstrdup (pool, report_key (path));
+
+  while (1)
+    {
+      int i = report_lower_bound (c->report_paths, key);
+      char *slash;
+
+      if (i < c->report_paths->nelts)
+        {
+          const svn_repos__report_path_t *rp
+            = APR_ARRAY_IDX (c->report_paths, i, svn_repos__report_path_t *);
+          if (strcmp (rp->path, key) == 0)
+            return rp;
+        }
+
+      if (*key == '\0')
+        return NULL;
+      slash = strrchr (key, '/');
+      if (slash)
+        *slash = '\0';
+      else
+        *key = '\0';
+    }
+}
+
+
+/* Set *ROOT to the root from which the source tree's node at PATH
+   should be read, or to NULL if the source tree has no such path.  */
+static svn_error_t *
+get_source_root (svn_fs_root_t **root,
+                 struct context *c,
+                 const char *path,
+                 apr_pool_t *pool)
+{
+  const svn_repos__report_path_t *rp;
+
+  if (! c->report_paths)
+    {
+      *root = c->source_root;
+      return SVN_NO_ERROR;
+    }
+
+  rp = find_report_path (c, path, pool);
+  if (! rp || rp->deleted)
+    {
+      *root = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  *root = apr_hash_get (c->report_roots, &rp->revision,
+                        sizeof (rp->revision));
+  if (! *root)
+    {
+      SVN_ERR (svn_fs_revision_root (root, c->fs, rp->revision, c->pool));
+      apr_hash_set (c->report_roots, &rp->revision, sizeof (rp->revision),
+                    *root);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Return the base revision of the source tree's node at PATH, to be
+   passed on to the editor.  */
+static svn_revnum_t
+get_source_revision (struct context *c,
+                     const char *path,
+                     apr_pool_t *pool)
+{
+  const svn_repos__report_path_t *rp;
+
+  if (! c->report_paths)
+    return get_revision_from_hash (c->source_rev_diffs, path, pool);
+
+  rp = find_report_path (c, path, pool);
+  return (rp && ! rp->deleted) ? rp->revision : SVN_INVALID_REVNUM;
+}
+
+
+/* Set *ENTRIES to the entries of the source tree's directory PATH, as
+   svn_fs_dir_entries() would.  When reading from a report, entries
+   reported at another revision than PATH's are taken from that
+   revision, and entries reported missing are left out.  */
+static svn_error_t *
+get_source_entries (apr_hash_t **entries,
+                    struct context *c,
+                    const char *path,
+                    apr_pool_t *pool)
+{
+  svn_fs_root_t *root;
+  const char *key, *prefix;
+  apr_size_t prefix_len;
+  int i;
+
+  SVN_ERR (get_source_root (&root, c, path, pool));
+  if (! root)
+    return svn_error_createf (SVN_ERR_FS_NOT_FOUND, 0, 0, pool,
+                              "get_source_entries: `%s' was not reported",
+                              path);
+  SVN_ERR (svn_fs_dir_entries (entries, root, path, pool));
+  if (! c->report_paths)
+    return SVN_NO_ERROR;
+
+  /* Reported children of PATH are contiguous in the sorted report,
+     starting with the first path after "PATH/".  */
+  key = report_key (path);
+  prefix = (*key == '\0') ? "" : apr_pstrcat (pool, key, "/", NULL);
+  prefix_len = strlen (prefix);
+
+  for (i = report_lower_bound (c->report_paths, prefix);
+       i < c->report_paths->nelts;
+       i++)
+    {
+      const svn_repos__report_path_t *rp
+        = APR_ARRAY_IDX (c->report_paths, i, svn_repos__report_path_t *);
+      const char *name = rp->path + prefix_len;
+
+      if (strncmp (rp->path, prefix, prefix_len) != 0)
+        break;
+      if (*name == '\0' || strchr (name, '/'))
+        continue;
+
+      if (rp->deleted)
+        apr_hash_set (*entries, name, APR_HASH_KEY_STRING, NULL);
+      else
+        {
+          svn_fs_dirent_t *dirent = apr_palloc (pool, sizeof (*dirent));
+          svn_fs_root_t *child_root;
+
+          SVN_ERR (get_source_root (&child_root, c, rp->path, pool));
+          dirent->name = apr_pstrdup (pool, name);
+          SVN_ERR (svn_fs_node_id (&dirent->id, child_root, rp->path, pool));
+          apr_hash_set (*entries, dirent->name, APR_HASH_KEY_STRING, dirent);
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Return TRUE if any path below PATH was reported separately, in
+   which case the source node at PATH differs from the one in PATH's
+   revision even though its node id is the same.  */
+static svn_boolean_t
+has_reported_children (struct context *c, const char *path)
+{
+  const char *key;
+  apr_size_t len;
+  int i;
+
+  if (! c->report_paths)
+    return FALSE;
+
+  key = report_key (path);
+  len = strlen (key);
+  for (i = report_lower_bound (c->report_paths, key);
+       i < c->report_paths->nelts;
+       i++)
+    {
+      const svn_repos__report_path_t *rp
+        = APR_ARRAY_IDX (c->report_paths, i, svn_repos__report_path_t *);
+
+      if (strncmp (rp->path, key, len) != 0)
+        return FALSE;
+      if (len == 0 ? *rp->path != '\0' : rp->path[len] == '/')
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+
+
 
 /* proplist_change_fn_t property changing functions.  */
 
@@ -462,10 +877,14 @@ delta_proplists (struct context *c,
   apr_hash_t *t_props = 0;
   apr_hash_index_t *hi;
   apr_pool_t *subpool;
+  svn_fs_root_t *source_root = NULL;
 
   /* Make a subpool for local allocations. */ 
   subpool = svn_pool_create (pool);
 
+  if (source_path)
+    SVN_ERR (get_source_root (&source_root, c, source_path, subpool));
+
   if (source_path && target_path)
     {
       int changed;
@@ -474,7 +893,7 @@ delta_proplists (struct context *c,
       SVN_ERR (svn_fs_props_changed (&changed,
                                      c->target_root,
                                      target_path,
-                                     c->source_root,
+                                     source_root,
                                      source_path,
                                      subpool));
       if (! changed)
@@ -487,7 +906,7 @@ delta_proplists (struct context *c,
   /* Get the source file's properties */
   if (source_path)
     SVN_ERR (svn_fs_node_proplist 
-             (&s_props, c->source_root, source_path,
+             (&s_props, source_root, source_path,
               subpool));
 
   /* Get the target file's properties */
@@ -598,11 +1017,23 @@ delta_files (struct context *c, void *file_baton,
              apr_pool_t *pool)
 {
   svn_txdelta_stream_t *delta_stream;
+  struct prefetch_job *job;
   apr_pool_t *subpool;
 
   /* Make a subpool for local allocations. */
   subpool = svn_pool_create (pool);
 
+  /* If a worker has already done the reading, just pass it on. */
+  job = prefetch_take (c, source_path, target_path);
+  if (job)
+    {
+      SVN_ERR (send_prefetched_file (c, file_baton, job,
+                                     source_path, target_path, subpool));
+      prefetch_release (c, job);
+      svn_pool_destroy (subpool);
+      return SVN_NO_ERROR;
+    }
+
   /* Compare the files' property lists.  */
   SVN_ERR (delta_proplists (c, source_path, target_path,
                             change_file_prop, file_baton, subpool));
@@ -612,13 +1043,16 @@ delta_files (struct context *c, void *file_baton,
 
   if (source_path)
     {
+      svn_fs_root_t *source_root;
       int changed;
 
+      SVN_ERR (get_source_root (&source_root, c, source_path, subpool));
+
       /* Is this deltification worth our time? */
       SVN_ERR (svn_fs_contents_changed (&changed,
                                         c->target_root,
                                         target_path,
-                                        c->source_root,
+                                        source_root,
                                         source_path,
                                         subpool));
       if (! changed)
@@ -631,7 +1065,7 @@ delta_files (struct context *c, void *file_baton,
          TARGET_PATH's contents.  */
       SVN_ERR (svn_fs_get_file_delta_stream 
                (&delta_stream, 
-                c->source_root, source_path,
+                source_root, source_path,
                 c->target_root, target_path,
                 subpool));
     }
@@ -655,64 +1089,1027 @@ delta_files (struct context *c, void *file_baton,
 
 
 
-/* Generic directory deltafication routines.  */
+/* Reading ahead on worker threads.  */
 
 
-/* Emit a delta to delete the entry named TARGET_ENTRY from DIR_BATON.  */
-static svn_error_t *
-delete (struct context *c, 
-        void *dir_baton, 
-        const char *target_entry,
-        apr_pool_t *pool)
-{
-  /* ### change the editor prototypes... */
-  svn_stringbuf_t *entrybuf = svn_stringbuf_create (target_entry, pool);
+/* When svn_repos_dir_delta_pipelined() is given worker threads, each
+   directory's entries are looked over before the editor hears about
+   any of them, and the files among them that will need deltas are
+   queued for the workers in the order the traversal will reach them.
+   A worker prepares a file's property changes and text delta windows
+   in memory, using its own handle on the filesystem, so that Berkeley
+   DB reads and delta computation for the files ahead overlap with the
+   editor's handling of the current one.  The main thread still makes
+   every editor call, in exactly the order svn_repos_dir_delta() would.
+   Opening a filesystem handle means opening a Berkeley DB environment,
+   which would cost more than a small update saves, so given a
+   repository the workers' handles are kept in it for the next delta.
 
-  return c->editor->delete_entry (entrybuf, SVN_INVALID_REVNUM, dir_baton);
-}
+   Whenever the traversal reaches a file that no worker has started
+   on, or whose worker failed, the main thread just does the work
+   itself as usual.  */
 
+#if APR_HAS_THREADS
 
-/* Emit a delta to create the entry named TARGET_ENTRY in the
-   directory TARGET_PARENT.  If SOURCE_PARENT and SOURCE_ENTRY are
-   valid, use them to determine the copyfrom args in the editor's add
-   calls.  Pass DIR_BATON through to editor functions that require it.  */
-static svn_error_t *
-add_file_or_dir (struct context *c, void *dir_baton,
-                 const char *source_parent,
-                 const char *source_entry,
-                 const char *target_parent,
-                 const char *target_entry,
-                 apr_pool_t *pool)
+/* How many files to read ahead per worker thread. */
+#define FILES_PER_THREAD 4
+
+/* Files whose target text is longer than this only have their
+   properties read ahead; their text deltas are computed when the
+   editor gets to them, so read-ahead memory stays bounded.  */
+#define PREFETCH_MAX_TEXT (1024 * 1024)
+
+
+/* A file the traversal will reach, not yet handed to a worker. */
+struct prefetch_item
 {
-  int is_dir;
-  svn_stringbuf_t *target_full_path;
-  svn_stringbuf_t *source_full_path;
-  svn_revnum_t base_revision = SVN_INVALID_REVNUM;
+  /* The source path, or NULL if the file will be added, and the
+     revision (or, if SOURCE_TXN is non-NULL, the transaction) it is
+     to be read from. */
+  const char *source_path;
+  svn_revnum_t source_rev;
+  const char *source_txn;
 
-  /* ### change the delta interface */
-  svn_stringbuf_t *namebuf;
+  const char *target_path;
 
-  if (!target_parent || !target_entry)
-    abort();
+  /* The prefetch_dir() call that asked for this file. */
+  int batch;
 
-  /* Get the target's full path */
-  target_full_path = svn_stringbuf_create (target_parent, pool);
-  svn_path_add_component_nts (target_full_path, target_entry);
+  struct prefetch_item *next;
+};
 
-  /* Is the target a file or a directory?  */
-  SVN_ERR (svn_fs_is_dir (&is_dir, c->target_root, 
-                          target_full_path->data, pool));
 
-  if (source_parent && source_entry)
+/* The life cycle of a prefetch job. */
+enum job_state
+{
+  job_free,                     /* Not in use. */
+  job_queued,                   /* Waiting for a worker. */
+  job_running,                  /* A worker is reading ahead. */
+  job_done                      /* The results are ready. */
+};
+
+
+/* A property change to be passed on to the editor. */
+struct prop_change
+{
+  const char *name;
+  const svn_string_t *value;
+};
+
+
+/* One file's worth of read-ahead.  */
+struct prefetch_job
+{
+  enum job_state state;
+  int seq;                      /* Jobs are run in order of SEQ. */
+  int batch;                    /* As for prefetch_item, or -1 once the
+                                   batch is gone. */
+
+  /* Copied from the prefetch_item, into POOL. */
+  const char *source_path;
+  svn_revnum_t source_rev;
+  const char *source_txn;
+  const char *target_path;
+
+  /* The results, allocated in POOL.  ERR is set if the worker failed,
+     and IS_FILE is FALSE if TARGET_PATH turned out not to be a file;
+     either way the job is of no use.  HAVE_TEXT is FALSE if the text
+     delta was not read ahead after all.  */
+  svn_error_t *err;
+  svn_boolean_t is_file;
+  apr_array_header_t *prop_changes;     /* struct prop_change */
+  svn_boolean_t text_changed;
+  svn_boolean_t have_text;
+  apr_array_header_t *windows;          /* svn_txdelta_window_t * */
+
+  /* A root pool, so that errors raised in a worker thread have an
+     error pool of their own. */
+  apr_pool_t *pool;
+};
+
+
+/* A worker thread's own view of the filesystem. */
+struct prefetch_worker
+{
+  struct prefetcher *pf;
+
+  /* The worker's filesystem handle, borrowed for this delta, and
+     FS_HANDLE->fs. */
+  svn_repos__worker_fs_t *fs_handle;
+  svn_fs_t *fs;
+
+  svn_fs_root_t *target_root;
+
+  /* Source roots opened so far, keyed on "rREV" or "tTXN-NAME". */
+  apr_hash_t *source_roots;
+
+  /* A root pool holding the roots, and a subpool for each job's
+     temporary allocations. */
+  apr_pool_t *pool;
+  apr_pool_t *scratch;
+};
+
+
+struct prefetcher
+{
+  svn_boolean_t text_deltas;
+
+  /* Files still to be queued, in traversal order.  Only the main
+     thread touches these. */
+  struct prefetch_item *wanted;
+  int next_batch;
+  int next_seq;
+
+  struct prefetch_job *jobs;
+  int num_jobs;
+
+  /* LOCK protects the jobs' STATE fields and SHUTDOWN.  Workers wait
+     on WORK_READY for queued jobs; the main thread waits on WORK_DONE
+     for a running one to finish. */
+  apr_thread_mutex_t *lock;
+  apr_thread_cond_t *work_ready;
+  apr_thread_cond_t *work_done;
+  svn_boolean_t shutdown;
+
+  struct prefetch_worker *workers;
+  apr_thread_t **threads;
+  int num_threads;
+
+  /* Where the workers' filesystem handles go back to when they are
+     done, or NULL to close them. */
+  svn_repos_t *repos;
+
+  apr_pool_t *pool;
+};
+
+
+
+/*** Worker threads. ***/
+
+/* Set *ROOT to the root of revision REV in FS, or of the transaction
+   named TXN_NAME if that is non-NULL.  Allocate it in POOL. */
+static svn_error_t *
+open_worker_root (svn_fs_root_t **root,
+                  svn_fs_t *fs,
+                  svn_revnum_t rev,
+                  const char *txn_name,
+                  apr_pool_t *pool)
+{
+  if (txn_name)
+    {
+      svn_fs_txn_t *txn;
+
+      SVN_ERR (svn_fs_open_txn (&txn, fs, txn_name, pool));
+      return svn_fs_txn_root (root, txn, pool);
+    }
+
+  return svn_fs_revision_root (root, fs, rev, pool);
+}
+
+
+/* Pool cleanup for a repository: close the worker filesystem handles
+   kept in the svn_repos_t DATA. */
+static apr_status_t
+close_worker_fs (void *data)
+{
+  svn_repos_t *repos = data;
+  int i;
+
+  for (i = 0; i < repos->worker_fs->nelts; i++)
+    svn_pool_destroy (APR_ARRAY_IDX (repos->worker_fs, i,
+                                     svn_repos__worker_fs_t *)->pool);
+  repos->worker_fs = NULL;
+  return APR_SUCCESS;
+}
+
+
+/* Set *HANDLE to a worker filesystem handle on the filesystem at
+   FS_PATH: one kept in REPOS, if REPOS is non-NULL and has one, else a
+   newly opened one. */
+static svn_error_t *
+borrow_worker_fs (svn_repos__worker_fs_t **handle,
+                  svn_repos_t *repos,
+                  const char *fs_path)
+{
+  svn_repos__worker_fs_t *h;
+  apr_pool_t *pool;
+  svn_error_t *err;
+
+  if (repos && repos->worker_fs && repos->worker_fs->nelts > 0)
+    {
+      *handle = *((svn_repos__worker_fs_t **)
+                  apr_array_pop (repos->worker_fs));
+      return SVN_NO_ERROR;
+    }
+
+  pool = svn_pool_create (NULL);
+  h = apr_pcalloc (pool, sizeof (*h));
+  h->pool = pool;
+  h->fs = svn_fs_new (pool);
+  err = svn_fs_open_berkeley (h->fs, fs_path);
+  if (err)
+    {
+      svn_pool_destroy (pool);
+      return err;
+    }
+
+  *handle = h;
+  return SVN_NO_ERROR;
+}
+
+
+/* Keep the worker filesystem handle HANDLE in REPOS for reuse, or
+   close it if REPOS is NULL. */
+static void
+return_worker_fs (svn_repos_t *repos, svn_repos__worker_fs_t *handle)
+{
+  if (! repos)
+    {
+      svn_pool_destroy (handle->pool);
+      return;
+    }
+
+  if (! repos->worker_fs)
+    {
+      repos->worker_fs = apr_array_make (repos->pool, 1, sizeof (handle));
+      apr_pool_cleanup_register (repos->pool, repos, close_worker_fs,
+                                 apr_pool_cleanup_null);
+    }
+  (*((svn_repos__worker_fs_t **) apr_array_push (repos->worker_fs)))
+    = handle;
+}
+
+
+/* A proplist_change_fn_t that records the change in the prefetch job
+   OBJECT. */
+static svn_error_t *
+record_prop_change (struct context *c,
+                    void *object,
+                    const char *name,
+                    const svn_string_t *value,
+                    apr_pool_t *pool)
+{
+  struct prefetch_job *job = object;
+  struct prop_change *change = apr_array_push (job->prop_changes);
+
+  change->name = apr_pstrdup (job->pool, name);
+  change->value = value ? svn_string_dup (value, job->pool) : NULL;
+  return SVN_NO_ERROR;
+}
+
+
+/* Read ahead for JOB on worker W, doing just what delta_files() would
+   do, short of calling the editor. */
+static svn_error_t *
+compute_job (struct prefetch_worker *w, struct prefetch_job *job)
+{
+  struct context wc;
+  svn_fs_root_t *source_root = NULL;
+  svn_txdelta_stream_t *delta_stream;
+  svn_txdelta_window_t *window;
+  apr_off_t length;
+  int is_file;
+
+  SVN_ERR (svn_fs_is_file (&is_file, w->target_root, job->target_path,
+                           w->scratch));
+  job->is_file = is_file;
+  if (! is_file)
+    return SVN_NO_ERROR;
+
+  if (job->source_path)
+    {
+      const char *key
+        = job->source_txn
+        ? apr_pstrcat (w->scratch, "t", job->source_txn, NULL)
+        : apr_psprintf (w->scratch, "r%ld", (long) job->source_rev);
+
+      source_root = apr_hash_get (w->source_roots, key, APR_HASH_KEY_STRING);
+      if (! source_root)
+        {
+          SVN_ERR (open_worker_root (&source_root, w->fs, job->source_rev,
+                                     job->source_txn, w->pool));
+          apr_hash_set (w->source_roots, apr_pstrdup (w->pool, key),
+                        APR_HASH_KEY_STRING, source_root);
+        }
+    }
+
+  /* A context of the worker's own, so that delta_proplists() reads
+     through the worker's filesystem handle. */
+  memset (&wc, 0, sizeof (wc));
+  wc.source_root = source_root;
+  wc.target_root = w->target_root;
+
+  job->prop_changes = apr_array_make (job->pool, 0,
+                                      sizeof (struct prop_change));
+  SVN_ERR (delta_proplists (&wc, job->source_path, job->target_path,
+                            record_prop_change, job, w->scratch));
+
+  if (job->source_path)
+    {
+      int changed;
+
+      SVN_ERR (svn_fs_contents_changed (&changed,
+                                        w->target_root, job->target_path,
+                                        source_root, job->source_path,
+                                        w->scratch));
+      if (! changed)
+        return SVN_NO_ERROR;
+    }
+  job->text_changed = TRUE;
+
+  /* Without text deltas, only a NULL window is ever sent. */
+  if (! w->pf->text_deltas)
+    {
+      job->have_text = TRUE;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR (svn_fs_file_length (&length, w->target_root, job->target_path,
+                               w->scratch));
+  if (length > PREFETCH_MAX_TEXT)
+    return SVN_NO_ERROR;
+
+  SVN_ERR (svn_fs_get_file_delta_stream (&delta_stream,
+                                         source_root, job->source_path,
+                                         w->target_root, job->target_path,
+                                         w->scratch));
+  job->windows = apr_array_make (job->pool, 1, sizeof (window));
+  do
+    {
+      SVN_ERR (svn_txdelta_next_window (&window, delta_stream, job->pool));
+      if (window)
+        (*((svn_txdelta_window_t **) apr_array_push (job->windows)))
+          = window;
+    }
+  while (window);
+
+  job->have_text = TRUE;
+  return SVN_NO_ERROR;
+}
+
+
+/* Return the queued job of PF that was queued first, or NULL if
+   there is none.  Call with PF->lock held. */
+static struct prefetch_job *
+next_queued_job (struct prefetcher *pf)
+{
+  struct prefetch_job *next = NULL;
+  int i;
+
+  for (i = 0; i < pf->num_jobs; i++)
+    if (pf->jobs[i].state == job_queued
+        && (! next || pf->jobs[i].seq < next->seq))
+      next = &pf->jobs[i];
+
+  return next;
+}
+
+
+/* Thread body: run queued jobs until told to shut down. */
+static void * APR_THREAD_FUNC
+prefetch_worker (apr_thread_t *thread, void *baton)
+{
+  struct prefetch_worker *w = baton;
+  struct prefetcher *pf = w->pf;
+
+  apr_thread_mutex_lock (pf->lock);
+  for (;;)
+    {
+      struct prefetch_job *job;
+
+      while (! pf->shutdown && ! (job = next_queued_job (pf)))
+        apr_thread_cond_wait (pf->work_ready, pf->lock);
+      if (pf->shutdown)
+        break;
+
+      job->state = job_running;
+      apr_thread_mutex_unlock (pf->lock);
+
+      job->err = compute_job (w, job);
+      svn_pool_clear (w->scratch);
+
+      apr_thread_mutex_lock (pf->lock);
+      job->state = job_done;
+      apr_thread_cond_broadcast (pf->work_done);
+    }
+  apr_thread_mutex_unlock (pf->lock);
+
+  return NULL;
+}
+
+
+/* Pool cleanup for a prefetcher: stop its workers, and destroy the
+   root pools it made. */
+static apr_status_t
+cleanup_prefetcher (void *data)
+{
+  struct prefetcher *pf = data;
+  apr_status_t retval;
+  int i;
+
+  if (pf->num_threads > 0)
+    {
+      apr_thread_mutex_lock (pf->lock);
+      pf->shutdown = TRUE;
+      apr_thread_cond_broadcast (pf->work_ready);
+      apr_thread_mutex_unlock (pf->lock);
+
+      for (i = 0; i < pf->num_threads; i++)
+        apr_thread_join (&retval, pf->threads[i]);
+    }
+
+  for (i = 0; i < pf->num_threads; i++)
+    {
+      svn_pool_destroy (pf->workers[i].pool);
+      return_worker_fs (pf->repos, pf->workers[i].fs_handle);
+    }
+  for (i = 0; i < pf->num_jobs; i++)
+    svn_pool_destroy (pf->jobs[i].pool);
+
+  pf->num_threads = 0;
+  pf->num_jobs = 0;
+  return APR_SUCCESS;
+}
+
+
+
+/*** The main thread's side. ***/
+
+/* Return the state of JOB. */
+static enum job_state
+get_job_state (struct prefetcher *pf, struct prefetch_job *job)
+{
+  enum job_state state;
+
+  apr_thread_mutex_lock (pf->lock);
+  state = job->state;
+  apr_thread_mutex_unlock (pf->lock);
+
+  return state;
+}
+
+
+/* Make JOB, which must not be running, available for reuse. */
+static void
+free_job (struct prefetcher *pf, struct prefetch_job *job)
+{
+  apr_thread_mutex_lock (pf->lock);
+  job->state = job_free;
+  apr_thread_mutex_unlock (pf->lock);
+
+  if (job->err)
+    svn_error_clear_all (job->err);
+  job->err = NULL;
+  job->prop_changes = NULL;
+  job->windows = NULL;
+  job->is_file = job->text_changed = job->have_text = FALSE;
+  svn_pool_clear (job->pool);
+}
+
+
+/* Free those finished jobs of PF that nobody is going to take. */
+static void
+reap_jobs (struct prefetcher *pf)
+{
+  int i;
+
+  for (i = 0; i < pf->num_jobs; i++)
+    {
+      struct prefetch_job *job = &pf->jobs[i];
+
+      if (get_job_state (pf, job) == job_done
+          && (job->err || ! job->is_file || job->batch == -1))
+        free_job (pf, job);
+    }
+}
+
+
+/* Hand wanted files of PF to free jobs, as long as there are both. */
+static void
+queue_jobs (struct prefetcher *pf)
+{
+  int i;
+
+  for (i = 0; i < pf->num_jobs && pf->wanted; i++)
+    {
+      struct prefetch_job *job = &pf->jobs[i];
+      struct prefetch_item *item = pf->wanted;
+
+      if (get_job_state (pf, job) != job_free)
+        continue;
+
+      pf->wanted = item->next;
+      job->seq = pf->next_seq++;
+      job->batch = item->batch;
+      job->source_path = item->source_path
+        ? apr_pstrdup (job->pool, item->source_path) : NULL;
+      job->source_rev = item->source_rev;
+      job->source_txn = item->source_txn
+        ? apr_pstrdup (job->pool, item->source_txn) : NULL;
+      job->target_path = apr_pstrdup (job->pool, item->target_path);
+
+      apr_thread_mutex_lock (pf->lock);
+      job->state = job_queued;
+      apr_thread_cond_signal (pf->work_ready);
+      apr_thread_mutex_unlock (pf->lock);
+    }
+}
+
+
+/* Start up to NUM_THREADS workers reading ahead for the context C, and
+   set *PF_P to the lot.  If no worker can be started, set *PF_P to
+   NULL; the traversal then runs entirely in the caller's thread. */
+static svn_error_t *
+prefetch_start (struct prefetcher **pf_p,
+                struct context *c,
+                svn_repos_t *repos,
+                int num_threads,
+                apr_pool_t *pool)
+{
+  struct prefetcher *pf;
+  const char *fs_path, *target_txn = NULL;
+  svn_revnum_t target_rev = SVN_INVALID_REVNUM;
+  int i;
+
+  *pf_p = NULL;
+  if (num_threads < 1)
+    return SVN_NO_ERROR;
+
+  /* The workers open the target root again on their own handles. */
+  if (svn_fs_is_txn_root (c->target_root))
+    target_txn = svn_fs_txn_root_name (c->target_root, pool);
+  else if (svn_fs_is_revision_root (c->target_root))
+    target_rev = svn_fs_revision_root_revision (c->target_root);
+  else
+    return SVN_NO_ERROR;
+  fs_path = svn_fs_berkeley_path (svn_fs_root_fs (c->target_root), pool);
+
+  pf = apr_pcalloc (pool, sizeof (*pf));
+  pf->text_deltas = c->text_deltas;
+  pf->repos = repos;
+  pf->pool = pool;
+  pf->num_jobs = num_threads * FILES_PER_THREAD;
+  pf->jobs = apr_pcalloc (pool, pf->num_jobs * sizeof (*pf->jobs));
+  for (i = 0; i < pf->num_jobs; i++)
+    {
+      pf->jobs[i].pool = svn_pool_create (NULL);
+      pf->jobs[i].state = job_free;
+    }
+  pf->workers = apr_pcalloc (pool, num_threads * sizeof (*pf->workers));
+  pf->threads = apr_pcalloc (pool, num_threads * sizeof (*pf->threads));
+  apr_pool_cleanup_register (pool, pf, cleanup_prefetcher,
+                             apr_pool_cleanup_null);
+
+  if (apr_thread_mutex_create (&pf->lock, APR_THREAD_MUTEX_DEFAULT,
+                               pool) == APR_SUCCESS
+      && apr_thread_cond_create (&pf->work_ready, pool) == APR_SUCCESS
+      && apr_thread_cond_create (&pf->work_done, pool) == APR_SUCCESS)
+    {
+      while (pf->num_threads < num_threads)
+        {
+          struct prefetch_worker *w = &pf->workers[pf->num_threads];
+          svn_error_t *err;
+
+          w->pf = pf;
+          err = borrow_worker_fs (&w->fs_handle, repos, fs_path);
+          if (err)
+            {
+              svn_error_clear_all (err);
+              break;
+            }
+          w->fs = w->fs_handle->fs;
+          w->pool = svn_pool_create (NULL);
+          w->scratch = svn_pool_create (w->pool);
+          w->source_roots = apr_hash_make (w->pool);
+          err = open_worker_root (&w->target_root, w->fs, target_rev,
+                                  target_txn, w->pool);
+          if (err)
+            {
+              svn_error_clear_all (err);
+              svn_pool_destroy (w->pool);
+              return_worker_fs (repos, w->fs_handle);
+              break;
+            }
+
+          if (apr_thread_create (&pf->threads[pf->num_threads], NULL,
+                                 prefetch_worker, w, pool) != APR_SUCCESS)
+            {
+              svn_pool_destroy (w->pool);
+              return_worker_fs (repos, w->fs_handle);
+              break;
+            }
+          pf->num_threads++;
+        }
+    }
+
+  if (pf->num_threads == 0)
+    {
+      apr_pool_cleanup_run (pool, pf, cleanup_prefetcher);
+      return SVN_NO_ERROR;
+    }
+
+  *pf_p = pf;
+  return SVN_NO_ERROR;
+}
+
+
+/* Stop the workers of PF, if any, and throw away their work. */
+static void
+prefetch_stop (struct prefetcher *pf)
+{
+  if (pf)
+    apr_pool_cleanup_run (pf->pool, pf, cleanup_prefetcher);
+}
+
+
+/* Queue for reading ahead the files among T_ENTRIES, the entries of
+   the target directory TARGET_PATH, that delta_dirs() will want deltas
+   for, in the order it will come to them.  S_ENTRIES are the entries
+   of the source directory SOURCE_PATH, or NULL if there is none.  Set
+   *BATCH to a number to pass to prefetch_end_dir() once delta_dirs()
+   is done with the directory.  Allocate the queue in POOL, which must
+   last until then. */
+static svn_error_t *
+prefetch_dir (int *batch,
+              struct context *c,
+              const char *source_path,
+              const char *target_path,
+              apr_hash_t *s_entries,
+              apr_hash_t *t_entries,
+              apr_pool_t *pool)
+{
+  struct prefetcher *pf = c->prefetch;
+  struct prefetch_item *items = NULL, **tail = &items;
+  apr_hash_index_t *hi;
+
+  if (! pf)
+    return SVN_NO_ERROR;
+
+  *batch = pf->next_batch++;
+
+  /* This is the same walk delta_dirs() makes.  We can't tell files
+     from directories without asking the filesystem, so leave that to
+     the workers. */
+  for (hi = apr_hash_first (pool, t_entries); hi; hi = apr_hash_next (hi))
+    {
+      const void *key;
+      apr_ssize_t klen;
+      void *val;
+      const svn_fs_dirent_t *t_entry, *s_entry = NULL;
+      struct prefetch_item *item;
+      svn_stringbuf_t *target_fullpath;
+
+      apr_hash_this (hi, &key, &klen, &val);
+      t_entry = val;
+      if (s_entries)
+        s_entry = apr_hash_get (s_entries, key, klen);
+
+      item = apr_pcalloc (pool, sizeof (*item));
+      item->source_rev = SVN_INVALID_REVNUM;
+
+      if (s_entry)
+        {
+          int distance = svn_fs_id_distance (s_entry->id, t_entry->id);
+
+          /* Unchanged files need nothing.  Unrelated ones are deleted
+             and added afresh. */
+          if (distance == 0)
+            continue;
+          if (distance != -1)
+            {
+              svn_stringbuf_t *source_fullpath
+                = svn_stringbuf_create (source_path, pool);
+              svn_fs_root_t *source_root;
+
+              svn_path_add_component_nts (source_fullpath, s_entry->name);
+              SVN_ERR (get_source_root (&source_root, c,
+                                        source_fullpath->data, pool));
+              if (source_root && svn_fs_is_txn_root (source_root))
+                item->source_txn = svn_fs_txn_root_name (source_root, pool);
+              else if (source_root && svn_fs_is_revision_root (source_root))
+                item->source_rev
+                  = svn_fs_revision_root_revision (source_root);
+              else
+                continue;
+              item->source_path = source_fullpath->data;
+            }
+        }
+
+      target_fullpath = svn_stringbuf_create (target_path, pool);
+      svn_path_add_component_nts (target_fullpath, t_entry->name);
+      item->target_path = target_fullpath->data;
+      item->batch = *batch;
+
+      *tail = item;
+      tail = &item->next;
+    }
+
+  /* Everything in this directory comes before the rest of its
+     parent's files. */
+  *tail = pf->wanted;
+  pf->wanted = items;
+
+  reap_jobs (pf);
+  queue_jobs (pf);
+  return SVN_NO_ERROR;
+}
+
+
+/* Forget about any read-ahead for batch BATCH of C that was not
+   taken.  */
+static void
+prefetch_end_dir (struct context *c, int batch)
+{
+  struct prefetcher *pf = c->prefetch;
+  struct prefetch_item **item;
+  int i;
+
+  if (! pf)
+    return;
+
+  for (item = &pf->wanted; *item; )
+    if ((*item)->batch == batch)
+      *item = (*item)->next;
+    else
+      item = &(*item)->next;
+
+  for (i = 0; i < pf->num_jobs; i++)
+    {
+      struct prefetch_job *job = &pf->jobs[i];
+      enum job_state state;
+
+      if (job->batch != batch)
+        continue;
+
+      /* A queued job might be picked up at any moment, so check and
+         cancel it in one go. */
+      apr_thread_mutex_lock (pf->lock);
+      state = job->state;
+      if (state == job_queued)
+        job->state = job_done;
+      apr_thread_mutex_unlock (pf->lock);
+
+      if (state == job_running)
+        job->batch = -1;
+      else if (state != job_free)
+        free_job (pf, job);
+    }
+
+  reap_jobs (pf);
+  queue_jobs (pf);
+}
+
+
+/* Return the read-ahead for the file SOURCE_PATH (NULL if there is
+   none) and TARGET_PATH, waiting for its worker to finish if need be,
+   or NULL if there is none to be had.  Pass the job to
+   prefetch_release() when done with it. */
+static struct prefetch_job *
+prefetch_take (struct context *c,
+               const char *source_path,
+               const char *target_path)
+{
+  struct prefetcher *pf = c->prefetch;
+  struct prefetch_job *job = NULL;
+  struct prefetch_item **item;
+  enum job_state state = job_free;
+  int i;
+
+  if (! pf)
+    return NULL;
+
+  reap_jobs (pf);
+
+  for (i = 0; i < pf->num_jobs && ! job; i++)
+    if (get_job_state (pf, &pf->jobs[i]) != job_free
+        && strcmp (pf->jobs[i].target_path, target_path) == 0)
+      job = &pf->jobs[i];
+
+  if (job)
+    {
+      /* Take a queued job back: we'd only be waiting for a worker to
+         do what we can do ourselves right now.  Otherwise, wait for
+         the worker to finish. */
+      apr_thread_mutex_lock (pf->lock);
+      state = job->state;
+      if (state == job_queued)
+        job->state = job_done;
+      else
+        while (job->state != job_done)
+          apr_thread_cond_wait (pf->work_done, pf->lock);
+      apr_thread_mutex_unlock (pf->lock);
+
+      /* The job may not fit after all: delta_dirs() could have settled
+         on some other source for this file. */
+      if (state == job_queued || job->err || ! job->is_file
+          || (source_path == NULL) != (job->source_path == NULL)
+          || (source_path && strcmp (source_path, job->source_path) != 0))
+        {
+          free_job (pf, job);
+          job = NULL;
+        }
+    }
+  else
+    {
+      /* Don't let a worker start on this file after we've done it. */
+      for (item = &pf->wanted; *item; item = &(*item)->next)
+        if (strcmp ((*item)->target_path, target_path) == 0)
+          {
+            *item = (*item)->next;
+            break;
+          }
+    }
+
+  queue_jobs (pf);
+  return job;
+}
+
+
+/* Send the property changes and text delta read ahead by JOB for the
+   file SOURCE_PATH/TARGET_PATH to FILE_BATON, as delta_files() would
+   have done.  */
+static svn_error_t *
+send_prefetched_file (struct context *c,
+                      void *file_baton,
+                      struct prefetch_job *job,
+                      const char *source_path,
+                      const char *target_path,
+                      apr_pool_t *pool)
+{
+  svn_txdelta_window_handler_t delta_handler;
+  void *delta_handler_baton;
+  int i;
+
+  for (i = 0; i < job->prop_changes->nelts; i++)
+    {
+      const struct prop_change *change
+        = &APR_ARRAY_IDX (job->prop_changes, i, struct prop_change);
+
+      SVN_ERR (change_file_prop (c, file_baton, change->name, change->value,
+                                 pool));
+    }
+
+  if (! job->text_changed)
+    return SVN_NO_ERROR;
+
+  /* The worker left a long text to us. */
+  if (! job->have_text)
+    {
+      svn_fs_root_t *source_root = NULL;
+      svn_txdelta_stream_t *delta_stream;
+
+      if (source_path)
+        SVN_ERR (get_source_root (&source_root, c, source_path, pool));
+      SVN_ERR (svn_fs_get_file_delta_stream (&delta_stream,
+                                             source_root, source_path,
+                                             c->target_root, target_path,
+                                             pool));
+      return send_text_delta (c, file_baton, delta_stream, pool);
+    }
+
+  SVN_ERR (c->editor->apply_textdelta
+           (file_baton, &delta_handler, &delta_handler_baton));
+  if (job->windows)
+    for (i = 0; i < job->windows->nelts; i++)
+      SVN_ERR (delta_handler (APR_ARRAY_IDX (job->windows, i,
+                                             svn_txdelta_window_t *),
+                              delta_handler_baton));
+
+  return delta_handler (NULL, delta_handler_baton);
+}
+
+
+/* Let the workers reuse JOB, taken with prefetch_take(). */
+static void
+prefetch_release (struct context *c, struct prefetch_job *job)
+{
+  free_job (c->prefetch, job);
+  queue_jobs (c->prefetch);
+}
+
+
+#else /* ! APR_HAS_THREADS */
+
+/* Without threads, the traversal always runs in the caller's thread. */
+
+static svn_error_t *
+prefetch_start (struct prefetcher **pf_p,
+                struct context *c,
+                svn_repos_t *repos,
+                int num_threads,
+                apr_pool_t *pool)
+{
+  *pf_p = NULL;
+  return SVN_NO_ERROR;
+}
+
+static void
+prefetch_stop (struct prefetcher *pf)
+{
+}
+
+static svn_error_t *
+prefetch_dir (int *batch,
+              struct context *c,
+              const char *source_path,
+              const char *target_path,
+              apr_hash_t *s_entries,
+              apr_hash_t *t_entries,
+              apr_pool_t *pool)
+{
+  return SVN_NO_ERROR;
+}
+
+static void
+prefetch_end_dir (struct context *c, int batch)
+{
+}
+
+static struct prefetch_job *
+prefetch_take (struct context *c,
+               const char *source_path,
+               const char *target_path)
+{
+  return NULL;
+}
+
+static svn_error_t *
+send_prefetched_file (struct context *c,
+                      void *file_baton,
+                      struct prefetch_job *job,
+                      const char *source_path,
+                      const char *target_path,
+                      apr_pool_t *pool)
+{
+  return SVN_NO_ERROR;
+}
+
+static void
+prefetch_release (struct context *c, struct prefetch_job *job)
+{
+}
+
+#endif /* APR_HAS_THREADS */
+
+
+
+
+/* Generic directory deltafication routines.  */
+
+
+/* Emit a delta to delete the entry named TARGET_ENTRY from DIR_BATON.  */
+static svn_error_t *
+delete (struct context *c, 
+        void *dir_baton, 
+        const char *target_entry,
+        apr_pool_t *pool)
+{
+  /* ### change the editor prototypes... */
+  svn_stringbuf_t *entrybuf = svn_stringbuf_create (target_entry, pool);
+
+  return c->editor->delete_entry (entrybuf, SVN_INVALID_REVNUM, dir_baton);
+}
+
+
+/* Emit a delta to create the entry named TARGET_ENTRY in the
+   directory TARGET_PARENT.  If SOURCE_PARENT and SOURCE_ENTRY are
+   valid, use them to determine the copyfrom args in the editor's add
+   calls.  Pass DIR_BATON through to editor functions that require it.  */
+static svn_error_t *
+add_file_or_dir (struct context *c, void *dir_baton,
+                 const char *source_parent,
+                 const char *source_entry,
+                 const char *target_parent,
+                 const char *target_entry,
+                 apr_pool_t *pool)
+{
+  int is_dir;
+  svn_stringbuf_t *target_full_path;
+  svn_stringbuf_t *source_full_path;
+  svn_revnum_t base_revision = SVN_INVALID_REVNUM;
+
+  /* ### change the delta interface */
+  svn_stringbuf_t *namebuf;
+
+  if (!target_parent || !target_entry)
+    abort();
+
+  /* Get the target's full path */
+  target_full_path = svn_stringbuf_create (target_parent, pool);
+  svn_path_add_component_nts (target_full_path, target_entry);
+
+  /* Is the target a file or a directory?  */
+  SVN_ERR (svn_fs_is_dir (&is_dir, c->target_root, 
+                          target_full_path->data, pool));
+
+  if (source_parent && source_entry)
     {
       /* Get the source's full path */
       source_full_path = svn_stringbuf_create (source_parent, pool);
       svn_path_add_component_nts (source_full_path, source_entry);
 
       /* Get the base revision for the entry from the hash. */
-      base_revision = get_revision_from_hash (c->source_rev_diffs,
-                                              source_full_path->data,
-                                              pool);
+      base_revision = get_source_revision (c, source_full_path->data, pool);
     }
   else
     source_full_path = NULL;
@@ -786,9 +2183,7 @@ replace_file_or_dir (struct context *c,
   svn_path_add_component_nts (source_full_path, source_entry);
 
   /* Get the base revision for the entry from the hash. */
-  base_revision = get_revision_from_hash (c->source_rev_diffs,
-                                          source_full_path->data,
-                                          pool);
+  base_revision = get_source_revision (c, source_full_path->data, pool);
 
   namebuf = svn_stringbuf_create (target_entry, pool);
   if (is_dir)
@@ -858,8 +2253,7 @@ find_nearest_entry (svn_fs_dirent_t **s_entry,
      pool that was passed in instead of the subpool...we're returning
      a reference to an item in this hash, and it would suck to blow it
      away before our caller gets a chance to see it.  */
-  SVN_ERR (svn_fs_dir_entries (&s_entries, c->source_root,
-                               source_parent, pool));
+  SVN_ERR (get_source_entries (&s_entries, c, source_parent, pool));
 
   target_full_path = svn_stringbuf_create (target_parent, subpool);
   svn_path_add_component_nts (target_full_path, t_entry->name);
@@ -883,6 +2277,7 @@ find_nearest_entry (svn_fs_dirent_t **s_entry,
       int this_distance;
       svn_fs_dirent_t *this_entry;
       int s_is_dir;
+      svn_fs_root_t *source_root;
      
       /* KEY will be the entry name in source, VAL the dirent */
       apr_hash_this (hi, &key, &klen, &val);
@@ -892,7 +2287,9 @@ find_nearest_entry (svn_fs_dirent_t **s_entry,
       svn_path_add_component_nts (source_full_path, this_entry->name);
 
       /* Is this entry a file or a directory?  */
-      SVN_ERR (svn_fs_is_dir (&s_is_dir, c->source_root, 
+      SVN_ERR (get_source_root (&source_root, c, source_full_path->data,
+                                subpool));
+      SVN_ERR (svn_fs_is_dir (&s_is_dir, source_root, 
                               source_full_path->data, subpool));
 
       /* If we aren't looking at the same node type, skip this
@@ -944,6 +2341,7 @@ delta_dirs (struct context *c,
   apr_hash_t *s_entries = 0, *t_entries = 0;
   apr_hash_index_t *hi;
   apr_pool_t *subpool;
+  int batch;
 
   /* Compare the property lists.  */
   SVN_ERR (delta_proplists (c, source_path, target_path,
@@ -963,10 +2361,13 @@ delta_dirs (struct context *c,
 
   if (source_path)
     {
-      SVN_ERR (svn_fs_dir_entries (&s_entries, c->source_root,
-                                   source_path, pool));
+      SVN_ERR (get_source_entries (&s_entries, c, source_path, pool));
     }
 
+  /* Let any worker threads start reading ahead. */
+  SVN_ERR (prefetch_dir (&batch, c, source_path, target_path,
+                         s_entries, t_entries, pool));
+
   /* Make a subpool for local allocations. */
   subpool = svn_pool_create (pool);
 
@@ -1023,7 +2424,22 @@ delta_dirs (struct context *c,
               distance = svn_fs_id_distance (s_entry->id, t_entry->id);
               if (distance == 0)
                 {
-                  /* no-op */
+                  /* Paths reported below the source entry make it
+                     differ from its node after all. */
+                  svn_stringbuf_t *source_fullpath
+                    = svn_stringbuf_create (source_path, subpool);
+                  svn_path_add_component_nts (source_fullpath,
+                                              s_entry->name);
+                  if (has_reported_children (c, source_fullpath->data))
+                    SVN_ERR (replace_file_or_dir
+                             (c, dir_baton, 
+                              source_path,
+                              s_entry->name,
+                              target_path,
+                              t_entry->name,
+                              subpool));
+
+                  /* Otherwise, no-op. */
                 }
               else if (distance == -1)
                 {
@@ -1139,6 +2555,7 @@ delta_dirs (struct context *c,
           svn_stringbuf_t *source_fullpath = svn_stringbuf_create (source_path,
                                                                    subpool);
           int is_dir;
+          svn_fs_root_t *source_root;
           
           /* KEY is the entry name in source, VAL the dirent */
           apr_hash_this (hi, &key, &klen, &val);
@@ -1146,8 +2563,10 @@ delta_dirs (struct context *c,
           svn_path_add_component_nts (source_fullpath, s_entry->name);
 
           /* Do we actually want to delete the dir if we're non-recursive? */
+          SVN_ERR (get_source_root (&source_root, c, source_fullpath->data,
+                                    subpool));
           SVN_ERR (svn_fs_is_dir (&is_dir,
-                                  c->source_root,
+                                  source_root,
                                   source_fullpath->data,
                                   subpool));
 
@@ -1158,6 +2577,8 @@ delta_dirs (struct context *c,
         }
     }
 
+  prefetch_end_dir (c, batch);
+
   /* Destroy local allocation subpool. */
   svn_pool_destroy (subpool);
 
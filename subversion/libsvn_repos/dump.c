@@ -0,0 +1,891 @@
+/* dump.c --- writing filesystem contents into a portable 'dumpfile' format.
+ *
+ * ====================================================================
+ * Copyright (c) 2000-2002 CollabNet.  All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.  The terms
+ * are also available at http://subversion.tigris.org/license-1.html.
+ * If newer versions of this license are posted there, you may use a
+ * newer version instead, at your option.
+ *
+ * This software consists of voluntary contributions made by many
+ * individuals.  For exact contribution history, see the revision
+ * history and logs, available at http://subversion.tigris.org/.
+ * ====================================================================
+ */
+
+
+#include <string.h>
+
+#include "apr_pools.h"
+#include "apr_hash.h"
+#include "apr_file_io.h"
+#include "apr_strings.h"
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_fs.h"
+#include "svn_repos.h"
+#include "svn_path.h"
+#include "svn_delta.h"
+#include "svn_io.h"
+#include "repos.h"
+
+
+
+/*** Writing the stream. ***/
+
+/* Write the null-terminated string DATA to STREAM. */
+static svn_error_t *
+write_cstring (svn_stream_t *stream, const char *data)
+{
+  apr_size_t len = strlen (data);
+
+  return svn_stream_write (stream, data, &len);
+}
+
+
+/* Write a header line "NAME: VALUE" to STREAM. */
+static svn_error_t *
+write_header (svn_stream_t *stream,
+              const char *name,
+              const char *value,
+              apr_pool_t *pool)
+{
+  return write_cstring (stream, apr_psprintf (pool, "%s: %s\n",
+                                              name, value));
+}
+
+
+/* Append the property list PROPS to BUF, in the hash dump format
+   ended by "PROPS-END". */
+static void
+write_proplist (svn_stringbuf_t *buf,
+                apr_hash_t *props,
+                apr_pool_t *pool)
+{
+  apr_hash_index_t *hi;
+
+  for (hi = apr_hash_first (pool, props); hi; hi = apr_hash_next (hi))
+    {
+      const void *key;
+      apr_ssize_t keylen;
+      void *val;
+      const svn_string_t *value;
+
+      apr_hash_this (hi, &key, &keylen, &val);
+      value = val;
+
+      svn_stringbuf_appendcstr (buf, apr_psprintf (pool, "K %ld\n",
+                                                   (long) keylen));
+      svn_stringbuf_appendbytes (buf, key, keylen);
+      svn_stringbuf_appendcstr (buf, apr_psprintf (pool, "\nV %ld\n",
+                                                   (long) value->len));
+      svn_stringbuf_appendbytes (buf, value->data, value->len);
+      svn_stringbuf_appendcstr (buf, "\n");
+    }
+  svn_stringbuf_appendcstr (buf, "PROPS-END\n");
+}
+
+
+/* Copy everything from FROM to TO, a chunk at a time. */
+static svn_error_t *
+copy_stream (svn_stream_t *from, svn_stream_t *to, apr_pool_t *pool)
+{
+  char *buf = apr_palloc (pool, SVN_STREAM_CHUNK_SIZE);
+  apr_size_t len;
+
+  do
+    {
+      len = SVN_STREAM_CHUNK_SIZE;
+      SVN_ERR (svn_stream_read (from, buf, &len));
+      if (len > 0)
+        SVN_ERR (svn_stream_write (to, buf, &len));
+    }
+  while (len > 0);
+
+  return SVN_NO_ERROR;
+}
+
+
+
+/*** The dump editor. ***/
+
+/* svn_repos_dir_delta drives this editor from the previous revision
+   to the one being dumped.  Each changed node becomes a node record.
+
+   Copies need extra care, since dir_delta knows nothing about them:
+   a copied directory shows up as an added directory whose entire
+   subtree is added too.  When we see an added node with copy history
+   from this revision, we write it as a copy and remember its copy
+   source as the node's "comparison" path.  Added nodes beneath it are
+   then compared against the matching path under the copy source, and
+   only the differences are written; entries of the copy source that
+   are missing from the new tree are written as deletions when the
+   directory is closed.  */
+
+struct edit_baton
+{
+  /* Where the records go. */
+  svn_stream_t *stream;
+
+  svn_fs_t *fs;
+
+  /* The revision being dumped, and its root. */
+  svn_revnum_t current_rev;
+  svn_fs_root_t *fs_root;
+
+  /* Copies from revisions older than this are dumped as plain adds,
+     because the revisions they refer to are not in the stream. */
+  svn_revnum_t oldest_dumped_rev;
+
+  /* Whether to write file texts as deltas. */
+  svn_boolean_t use_deltas;
+
+  /* The prefix for temporary files holding deltas. */
+  const char *tempfile_prefix;
+
+  apr_pool_t *pool;
+};
+
+
+struct dir_baton
+{
+  struct edit_baton *edit_baton;
+  struct dir_baton *parent_dir_baton;
+
+  /* Full path of this directory, without a leading slash. */
+  const char *path;
+
+  /* If this directory is a copy, or is beneath one, the path and
+     revision it should be compared with; else NULL. */
+  const char *cmp_path;
+  svn_revnum_t cmp_rev;
+
+  /* TRUE if this directory's record has already been written, so
+     property changes need no record of their own. */
+  svn_boolean_t written_out;
+
+  /* TRUE if the editor has changed a property of this directory. */
+  svn_boolean_t props_changed;
+
+  apr_pool_t *pool;
+};
+
+
+struct file_baton
+{
+  struct edit_baton *edit_baton;
+
+  const char *path;
+
+  /* 'A'dded or opened for 'R'eplacement, as in svn_repos_node_t. */
+  char action;
+
+  /* As for directories. */
+  const char *cmp_path;
+  svn_revnum_t cmp_rev;
+
+  /* Whether this is a copy from CMP_PATH in CMP_REV. */
+  svn_boolean_t is_copy;
+
+  /* What the editor said changed in an opened file. */
+  svn_boolean_t text_changed;
+  svn_boolean_t props_changed;
+
+  apr_pool_t *pool;
+};
+
+
+/* Write a node record for PATH, of KIND, to EB's stream.  ACTION is
+   "add", "change" or "delete".  If IS_COPY, the node is a copy of
+   CMP_PATH in CMP_REV.  Include the node's properties if DUMP_PROPS,
+   and its text if DUMP_TEXT.
+
+   Deltas are taken against CMP_PATH in CMP_REV if CMP_PATH is not
+   NULL; else against the same path in the previous revision for a
+   change, or against the empty file for an add.  */
+static svn_error_t *
+dump_node (struct edit_baton *eb,
+           const char *path,
+           enum svn_node_kind kind,
+           const char *action,
+           svn_boolean_t is_copy,
+           const char *cmp_path,
+           svn_revnum_t cmp_rev,
+           svn_boolean_t dump_props,
+           svn_boolean_t dump_text,
+           apr_pool_t *pool)
+{
+  svn_stream_t *stream = eb->stream;
+  svn_stringbuf_t *propstring = NULL;
+  svn_stream_t *text = NULL;
+  apr_file_t *delta_file = NULL;
+  apr_off_t textlen = 0;
+
+  SVN_ERR (write_header (stream, SVN_REPOS_DUMPFILE_NODE_PATH, path, pool));
+  if (kind == svn_node_file)
+    SVN_ERR (write_header (stream, SVN_REPOS_DUMPFILE_NODE_KIND,
+                           "file", pool));
+  else if (kind == svn_node_dir)
+    SVN_ERR (write_header (stream, SVN_REPOS_DUMPFILE_NODE_KIND,
+                           "dir", pool));
+  SVN_ERR (write_header (stream, SVN_REPOS_DUMPFILE_NODE_ACTION,
+                         action, pool));
+
+  if (is_copy)
+    {
+      SVN_ERR (write_header (stream, SVN_REPOS_DUMPFILE_NODE_COPYFROM_REV,
+                             apr_psprintf (pool, "%ld", (long) cmp_rev),
+                             pool));
+      SVN_ERR (write_header (stream, SVN_REPOS_DUMPFILE_NODE_COPYFROM_PATH,
+                             cmp_path, pool));
+    }
+
+  if (dump_props)
+    {
+      apr_hash_t *props;
+
+      SVN_ERR (svn_fs_node_proplist (&props, eb->fs_root, path, pool));
+      propstring = svn_stringbuf_create ("", pool);
+      write_proplist (propstring, props, pool);
+      SVN_ERR (write_header (stream, SVN_REPOS_DUMPFILE_PROP_CONTENT_LENGTH,
+                             apr_psprintf (pool, "%lu",
+                                           (unsigned long) propstring->len),
+                             pool));
+    }
+
+  if (dump_text && kind == svn_node_file)
+    {
+      if (eb->use_deltas)
+        {
+          svn_fs_root_t *src_root = NULL;
+          const char *src_path = NULL;
+          svn_txdelta_stream_t *delta_stream;
+          svn_txdelta_window_handler_t handler;
+          void *handler_baton;
+          svn_stringbuf_t *tempname;
+          apr_off_t offset = 0;
+          apr_status_t apr_err;
+
+          if (cmp_path)
+            {
+              SVN_ERR (svn_fs_revision_root (&src_root, eb->fs, cmp_rev,
+                                             pool));
+              src_path = cmp_path;
+            }
+          else if (strcmp (action, "change") == 0)
+            {
+              SVN_ERR (svn_fs_revision_root (&src_root, eb->fs,
+                                             eb->current_rev - 1, pool));
+              src_path = path;
+            }
+
+          /* The length has to go out before the delta does, so spool
+             the delta to a temporary file first. */
+          SVN_ERR (svn_io_open_unique_file (&delta_file, &tempname,
+                                            eb->tempfile_prefix, ".tmp",
+                                            TRUE, pool));
+          svn_txdelta_to_svndiff (svn_stream_from_aprfile (delta_file, pool),
+                                  pool, &handler, &handler_baton);
+          SVN_ERR (svn_fs_get_file_delta_stream (&delta_stream,
+                                                 src_root, src_path,
+                                                 eb->fs_root, path, pool));
+          SVN_ERR (svn_txdelta_send_txstream (delta_stream, handler,
+                                              handler_baton, pool));
+
+          apr_err = apr_file_seek (delta_file, APR_CUR, &offset);
+          if (! apr_err)
+            {
+              textlen = offset;
+              offset = 0;
+              apr_err = apr_file_seek (delta_file, APR_SET, &offset);
+            }
+          if (apr_err)
+            return svn_error_createf (apr_err, 0, NULL, pool,
+                                      "dump: can't rewind `%s'",
+                                      tempname->data);
+
+          text = svn_stream_from_aprfile (delta_file, pool);
+          SVN_ERR (write_header (stream, SVN_REPOS_DUMPFILE_TEXT_DELTA,
+                                 "true", pool));
+        }
+      else
+        {
+          SVN_ERR (svn_fs_file_length (&textlen, eb->fs_root, path, pool));
+          SVN_ERR (svn_fs_file_contents (&text, eb->fs_root, path, pool));
+        }
+
+      SVN_ERR (write_header (stream, SVN_REPOS_DUMPFILE_TEXT_CONTENT_LENGTH,
+                             apr_psprintf (pool, "%" APR_OFF_T_FMT, textlen),
+                             pool));
+    }
+
+  if (propstring || text)
+    SVN_ERR (write_header (stream, SVN_REPOS_DUMPFILE_CONTENT_LENGTH,
+                           apr_psprintf (pool, "%" APR_OFF_T_FMT,
+                                         (apr_off_t)
+                                         ((propstring ? propstring->len : 0)
+                                          + textlen)),
+                           pool));
+
+  SVN_ERR (write_cstring (stream, "\n"));
+
+  if (propstring)
+    {
+      apr_size_t len = propstring->len;
+      SVN_ERR (svn_stream_write (stream, propstring->data, &len));
+    }
+  if (text)
+    SVN_ERR (copy_stream (text, stream, pool));
+  if (delta_file)
+    apr_file_close (delta_file);
+
+  return write_cstring (stream, "\n\n");
+}
+
+
+/* Work out how the node at PATH, being added beneath the directory
+   PB, relates to what came before it.
+
+   If PB has a comparison path and PATH's counterpart exists under it
+   with the same kind, set *CMP_PATH and *CMP_REV to that counterpart
+   and *IS_COPY to FALSE.  Else, if the node was copied in this
+   revision from a revision in the stream, set them to the copy source
+   and *IS_COPY to TRUE.  Else set *CMP_PATH to NULL.
+
+   If the counterpart exists with a different kind, write a deletion
+   for it, since the node is replacing it.  */
+static svn_error_t *
+find_comparison (const char **cmp_path,
+                 svn_revnum_t *cmp_rev,
+                 svn_boolean_t *is_copy,
+                 struct dir_baton *pb,
+                 const char *path,
+                 const char *name,
+                 enum svn_node_kind kind,
+                 apr_pool_t *pool)
+{
+  struct edit_baton *eb = pb->edit_baton;
+  svn_revnum_t copyfrom_rev;
+  const char *copyfrom_path;
+
+  *cmp_path = NULL;
+  *cmp_rev = SVN_INVALID_REVNUM;
+  *is_copy = FALSE;
+
+  if (pb->cmp_path)
+    {
+      svn_fs_root_t *cmp_root;
+      const char *path_in_source = svn_path_join (pb->cmp_path, name, pool);
+      enum svn_node_kind cmp_kind;
+
+      SVN_ERR (svn_fs_revision_root (&cmp_root, eb->fs, pb->cmp_rev, pool));
+      cmp_kind = svn_fs_check_path (cmp_root, path_in_source, pool);
+      if (cmp_kind == kind)
+        {
+          *cmp_path = path_in_source;
+          *cmp_rev = pb->cmp_rev;
+          return SVN_NO_ERROR;
+        }
+      else if (cmp_kind != svn_node_none)
+        SVN_ERR (dump_node (eb, path, svn_node_unknown, "delete", FALSE,
+                            NULL, SVN_INVALID_REVNUM, FALSE, FALSE, pool));
+    }
+
+  SVN_ERR (svn_fs_copied_from (&copyfrom_rev, &copyfrom_path,
+                               eb->fs_root, path, pool));
+  if (SVN_IS_VALID_REVNUM (copyfrom_rev)
+      && copyfrom_rev >= eb->oldest_dumped_rev)
+    {
+      svn_revnum_t created_rev;
+
+      /* Copy history under a copy is preserved, so make sure this
+         node was really copied in this revision. */
+      SVN_ERR (svn_fs_node_created_rev (&created_rev, eb->fs_root, path,
+                                        pool));
+      if (created_rev == eb->current_rev)
+        {
+          /* The fs keeps absolute paths; the stream does not. */
+          while (*copyfrom_path == '/')
+            copyfrom_path++;
+          *cmp_path = copyfrom_path;
+          *cmp_rev = copyfrom_rev;
+          *is_copy = TRUE;
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+static struct dir_baton *
+make_dir_baton (struct edit_baton *eb,
+                struct dir_baton *pb,
+                const char *name,
+                apr_pool_t *pool)
+{
+  apr_pool_t *subpool = svn_pool_create (pool);
+  struct dir_baton *db = apr_pcalloc (subpool, sizeof (*db));
+
+  db->edit_baton = eb;
+  db->parent_dir_baton = pb;
+  db->path = pb ? svn_path_join (pb->path, name, subpool) : "";
+  db->cmp_rev = SVN_INVALID_REVNUM;
+  db->pool = subpool;
+  return db;
+}
+
+
+static struct file_baton *
+make_file_baton (struct dir_baton *pb,
+                 const char *name,
+                 char action)
+{
+  apr_pool_t *subpool = svn_pool_create (pb->pool);
+  struct file_baton *fb = apr_pcalloc (subpool, sizeof (*fb));
+
+  fb->edit_baton = pb->edit_baton;
+  fb->path = svn_path_join (pb->path, name, subpool);
+  fb->action = action;
+  fb->cmp_rev = SVN_INVALID_REVNUM;
+  fb->pool = subpool;
+  return fb;
+}
+
+
+static svn_error_t *
+open_root (void *edit_baton,
+           svn_revnum_t base_revision,
+           void **root_baton)
+{
+  struct edit_baton *eb = edit_baton;
+
+  *root_baton = make_dir_baton (eb, NULL, NULL, eb->pool);
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+delete_entry (svn_stringbuf_t *name,
+              svn_revnum_t revision,
+              void *parent_baton)
+{
+  struct dir_baton *pb = parent_baton;
+
+  return dump_node (pb->edit_baton,
+                    svn_path_join (pb->path, name->data, pb->pool),
+                    svn_node_unknown, "delete", FALSE,
+                    NULL, SVN_INVALID_REVNUM, FALSE, FALSE, pb->pool);
+}
+
+
+static svn_error_t *
+add_directory (svn_stringbuf_t *name,
+               void *parent_baton,
+               svn_stringbuf_t *copyfrom_path,
+               svn_revnum_t copyfrom_revision,
+               void **child_baton)
+{
+  struct dir_baton *pb = parent_baton;
+  struct edit_baton *eb = pb->edit_baton;
+  struct dir_baton *db = make_dir_baton (eb, pb, name->data, pb->pool);
+  svn_boolean_t is_copy;
+
+  SVN_ERR (find_comparison (&db->cmp_path, &db->cmp_rev, &is_copy,
+                            pb, db->path, name->data, svn_node_dir,
+                            db->pool));
+
+  if (! db->cmp_path)
+    {
+      /* A brand new directory. */
+      SVN_ERR (dump_node (eb, db->path, svn_node_dir, "add", FALSE,
+                          NULL, SVN_INVALID_REVNUM, TRUE, FALSE, db->pool));
+    }
+  else
+    {
+      svn_fs_root_t *cmp_root;
+      int props_changed;
+
+      SVN_ERR (svn_fs_revision_root (&cmp_root, eb->fs, db->cmp_rev,
+                                     db->pool));
+      SVN_ERR (svn_fs_props_changed (&props_changed, cmp_root, db->cmp_path,
+                                     eb->fs_root, db->path, db->pool));
+      if (is_copy || props_changed)
+        SVN_ERR (dump_node (eb, db->path, svn_node_dir,
+                            is_copy ? "add" : "change", is_copy,
+                            db->cmp_path, db->cmp_rev,
+                            props_changed, FALSE, db->pool));
+    }
+
+  db->written_out = TRUE;
+  *child_baton = db;
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+open_directory (svn_stringbuf_t *name,
+                void *parent_baton,
+                svn_revnum_t base_revision,
+                void **child_baton)
+{
+  struct dir_baton *pb = parent_baton;
+
+  *child_baton = make_dir_baton (pb->edit_baton, pb, name->data, pb->pool);
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+change_dir_prop (void *dir_baton,
+                 svn_stringbuf_t *name,
+                 svn_stringbuf_t *value)
+{
+  struct dir_baton *db = dir_baton;
+
+  db->props_changed = TRUE;
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+close_directory (void *dir_baton)
+{
+  struct dir_baton *db = dir_baton;
+  struct edit_baton *eb = db->edit_baton;
+
+  if (db->props_changed && ! db->written_out)
+    SVN_ERR (dump_node (eb, db->path, svn_node_dir, "change", FALSE,
+                        NULL, SVN_INVALID_REVNUM, TRUE, FALSE, db->pool));
+
+  /* Anything under the comparison path that is gone from the new
+     tree was deleted in this revision. */
+  if (db->cmp_path)
+    {
+      svn_fs_root_t *cmp_root;
+      apr_hash_t *cmp_entries, *entries;
+      apr_hash_index_t *hi;
+
+      SVN_ERR (svn_fs_revision_root (&cmp_root, eb->fs, db->cmp_rev,
+                                     db->pool));
+      SVN_ERR (svn_fs_dir_entries (&cmp_entries, cmp_root, db->cmp_path,
+                                   db->pool));
+      SVN_ERR (svn_fs_dir_entries (&entries, eb->fs_root, db->path,
+                                   db->pool));
+      for (hi = apr_hash_first (db->pool, cmp_entries); hi;
+           hi = apr_hash_next (hi))
+        {
+          const void *key;
+          apr_ssize_t klen;
+
+          apr_hash_this (hi, &key, &klen, NULL);
+          if (! apr_hash_get (entries, key, klen))
+            SVN_ERR (dump_node (eb, svn_path_join (db->path, key, db->pool),
+                                svn_node_unknown, "delete", FALSE,
+                                NULL, SVN_INVALID_REVNUM, FALSE, FALSE,
+                                db->pool));
+        }
+    }
+
+  svn_pool_destroy (db->pool);
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+add_file (svn_stringbuf_t *name,
+          void *parent_baton,
+          svn_stringbuf_t *copyfrom_path,
+          svn_revnum_t copyfrom_revision,
+          void **file_baton)
+{
+  struct dir_baton *pb = parent_baton;
+  struct file_baton *fb = make_file_baton (pb, name->data, 'A');
+
+  SVN_ERR (find_comparison (&fb->cmp_path, &fb->cmp_rev, &fb->is_copy,
+                            pb, fb->path, name->data, svn_node_file,
+                            fb->pool));
+  *file_baton = fb;
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+open_file (svn_stringbuf_t *name,
+           void *parent_baton,
+           svn_revnum_t base_revision,
+           void **file_baton)
+{
+  *file_baton = make_file_baton (parent_baton, name->data, 'R');
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+window_handler (svn_txdelta_window_t *window, void *baton)
+{
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+apply_textdelta (void *file_baton,
+                 svn_txdelta_window_handler_t *handler,
+                 void **handler_baton)
+{
+  struct file_baton *fb = file_baton;
+
+  fb->text_changed = TRUE;
+  *handler = window_handler;
+  *handler_baton = NULL;
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+change_file_prop (void *file_baton,
+                  svn_stringbuf_t *name,
+                  svn_stringbuf_t *value)
+{
+  struct file_baton *fb = file_baton;
+
+  fb->props_changed = TRUE;
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+close_file (void *file_baton)
+{
+  struct file_baton *fb = file_baton;
+  struct edit_baton *eb = fb->edit_baton;
+
+  if (fb->action == 'R')
+    {
+      SVN_ERR (dump_node (eb, fb->path, svn_node_file, "change", FALSE,
+                          NULL, SVN_INVALID_REVNUM,
+                          fb->props_changed, fb->text_changed, fb->pool));
+    }
+  else if (! fb->cmp_path)
+    {
+      SVN_ERR (dump_node (eb, fb->path, svn_node_file, "add", FALSE,
+                          NULL, SVN_INVALID_REVNUM, TRUE, TRUE, fb->pool));
+    }
+  else
+    {
+      /* A copy, or a file beneath a copied directory: write only what
+         differs from the comparison file. */
+      svn_fs_root_t *cmp_root;
+      int props_changed, text_changed;
+
+      SVN_ERR (svn_fs_revision_root (&cmp_root, eb->fs, fb->cmp_rev,
+                                     fb->pool));
+      SVN_ERR (svn_fs_props_changed (&props_changed, cmp_root, fb->cmp_path,
+                                     eb->fs_root, fb->path, fb->pool));
+      SVN_ERR (svn_fs_contents_changed (&text_changed,
+                                        cmp_root, fb->cmp_path,
+                                        eb->fs_root, fb->path, fb->pool));
+      if (fb->is_copy || props_changed || text_changed)
+        SVN_ERR (dump_node (eb, fb->path, svn_node_file,
+                            fb->is_copy ? "add" : "change", fb->is_copy,
+                            fb->cmp_path, fb->cmp_rev,
+                            props_changed, text_changed, fb->pool));
+    }
+
+  svn_pool_destroy (fb->pool);
+  return SVN_NO_ERROR;
+}
+
+
+static svn_delta_edit_fns_t *
+get_dump_editor (struct edit_baton **edit_baton,
+                 svn_stream_t *stream,
+                 svn_fs_t *fs,
+                 svn_revnum_t oldest_dumped_rev,
+                 svn_boolean_t use_deltas,
+                 const char *tempfile_prefix,
+                 apr_pool_t *pool)
+{
+  svn_delta_edit_fns_t *editor = svn_delta_old_default_editor (pool);
+  struct edit_baton *eb = apr_pcalloc (pool, sizeof (*eb));
+
+  editor->open_root = open_root;
+  editor->delete_entry = delete_entry;
+  editor->add_directory = add_directory;
+  editor->open_directory = open_directory;
+  editor->change_dir_prop = change_dir_prop;
+  editor->close_directory = close_directory;
+  editor->add_file = add_file;
+  editor->open_file = open_file;
+  editor->apply_textdelta = apply_textdelta;
+  editor->change_file_prop = change_file_prop;
+  editor->close_file = close_file;
+
+  eb->stream = stream;
+  eb->fs = fs;
+  eb->oldest_dumped_rev = oldest_dumped_rev;
+  eb->use_deltas = use_deltas;
+  eb->tempfile_prefix = tempfile_prefix;
+  eb->pool = pool;
+
+  *edit_baton = eb;
+  return editor;
+}
+
+
+
+/*** Public interface. ***/
+
+/* Write the revision record for REV of FS to STREAM. */
+static svn_error_t *
+write_revision_record (svn_stream_t *stream,
+                       svn_fs_t *fs,
+                       svn_revnum_t rev,
+                       apr_pool_t *pool)
+{
+  apr_hash_t *props;
+  svn_stringbuf_t *propstring = svn_stringbuf_create ("", pool);
+  const char *len;
+  apr_size_t size;
+
+  SVN_ERR (svn_fs_revision_proplist (&props, fs, rev, pool));
+  write_proplist (propstring, props, pool);
+  len = apr_psprintf (pool, "%lu", (unsigned long) propstring->len);
+
+  SVN_ERR (write_header (stream, SVN_REPOS_DUMPFILE_REVISION_NUMBER,
+                         apr_psprintf (pool, "%ld", (long) rev), pool));
+  SVN_ERR (write_header (stream, SVN_REPOS_DUMPFILE_PROP_CONTENT_LENGTH,
+                         len, pool));
+  SVN_ERR (write_header (stream, SVN_REPOS_DUMPFILE_CONTENT_LENGTH,
+                         len, pool));
+  SVN_ERR (write_cstring (stream, "\n"));
+
+  size = propstring->len;
+  SVN_ERR (svn_stream_write (stream, propstring->data, &size));
+  return write_cstring (stream, "\n");
+}
+
+
+/* Write revisions START_REV through END_REV of REPOS's filesystem to
+   DUMPSTREAM, as for svn_repos_dump_fs().  If INCREMENTAL, describe
+   START_REV by its changes from the revision before, like the rest,
+   and keep copies from any revision as copies; the stream can then
+   only be loaded on top of the revisions before it.  */
+static svn_error_t *
+dump_revisions (svn_repos_t *repos,
+                svn_stream_t *dumpstream,
+                svn_stream_t *feedback_stream,
+                svn_revnum_t start_rev,
+                svn_revnum_t end_rev,
+                svn_boolean_t incremental,
+                svn_boolean_t use_deltas,
+                apr_pool_t *pool)
+{
+  svn_fs_t *fs = svn_repos_fs (repos);
+  svn_revnum_t youngest, rev;
+  const char *tempfile_prefix;
+  apr_pool_t *subpool;
+
+  SVN_ERR (svn_fs_youngest_rev (&youngest, fs, pool));
+  if (! SVN_IS_VALID_REVNUM (start_rev))
+    start_rev = 0;
+  if (! SVN_IS_VALID_REVNUM (end_rev))
+    end_rev = youngest;
+  if (start_rev > end_rev || end_rev > youngest)
+    return svn_error_createf (SVN_ERR_FS_NO_SUCH_REVISION, 0, NULL, pool,
+                              "dump: bad revision range %ld:%ld "
+                              "(youngest is %ld)",
+                              (long) start_rev, (long) end_rev,
+                              (long) youngest);
+
+  tempfile_prefix = svn_path_join (repos->path, "dump", pool);
+
+  /* Fulltext-only streams stay readable by version 1 loaders. */
+  SVN_ERR (write_cstring
+           (dumpstream,
+            apr_psprintf (pool, "%s: %d\n\n",
+                          SVN_REPOS_DUMPFILE_MAGIC_HEADER,
+                          (use_deltas
+                           ? SVN_REPOS_DUMPFILE_FORMAT_VERSION : 1))));
+
+  subpool = svn_pool_create (pool);
+  for (rev = start_rev; rev <= end_rev; rev++)
+    {
+      SVN_ERR (write_revision_record (dumpstream, fs, rev, subpool));
+
+      /* Revision 0 is always empty.  Otherwise, describe the changes
+         from the previous revision; or, for the first revision in
+         the stream, from the empty tree of revision 0, so that the
+         stream stands on its own. */
+      if (rev > 0)
+        {
+          svn_revnum_t from_rev
+            = (rev == start_rev && ! incremental) ? 0 : rev - 1;
+          svn_fs_root_t *from_root;
+          apr_hash_t *src_revs = apr_hash_make (subpool);
+          svn_revnum_t *from_revp = apr_palloc (subpool, sizeof (*from_revp));
+          const svn_delta_edit_fns_t *editor;
+          struct edit_baton *eb;
+
+          *from_revp = from_rev;
+          apr_hash_set (src_revs, "", APR_HASH_KEY_STRING, from_revp);
+
+          editor = get_dump_editor (&eb, dumpstream, fs,
+                                    incremental ? 0 : start_rev,
+                                    use_deltas, tempfile_prefix, subpool);
+          eb->current_rev = rev;
+          SVN_ERR (svn_fs_revision_root (&eb->fs_root, fs, rev, subpool));
+          SVN_ERR (svn_fs_revision_root (&from_root, fs, from_rev, subpool));
+
+          SVN_ERR (svn_repos_dir_delta (from_root, "", NULL, src_revs,
+                                        eb->fs_root, "",
+                                        editor, eb,
+                                        FALSE, TRUE, FALSE, subpool));
+        }
+
+      if (feedback_stream)
+        SVN_ERR (write_cstring (feedback_stream,
+                                apr_psprintf (subpool,
+                                              "* Dumped revision %ld.\n",
+                                              (long) rev)));
+      svn_pool_clear (subpool);
+    }
+
+  svn_pool_destroy (subpool);
+  return SVN_NO_ERROR;
+}
+
+
+svn_error_t *
+svn_repos_dump_fs (svn_repos_t *repos,
+                   svn_stream_t *dumpstream,
+                   svn_stream_t *feedback_stream,
+                   svn_revnum_t start_rev,
+                   svn_revnum_t end_rev,
+                   svn_boolean_t use_deltas,
+                   apr_pool_t *pool)
+{
+  return dump_revisions (repos, dumpstream, feedback_stream,
+                         start_rev, end_rev, FALSE, use_deltas, pool);
+}
+
+
+svn_error_t *
+svn_repos__dump_incremental (svn_repos_t *repos,
+                             svn_stream_t *dumpstream,
+                             svn_revnum_t start_rev,
+                             svn_revnum_t end_rev,
+                             apr_pool_t *pool)
+{
+  return dump_revisions (repos, dumpstream, NULL,
+                         start_rev, end_rev, TRUE, TRUE, pool);
+}
+
+
+
+/*
+ * local variables:
+ * eval: (load-file "../../tools/dev/svn-dev.el")
+ * end:
+ */
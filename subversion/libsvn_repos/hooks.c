@@ -18,15 +18,24 @@
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdlib.h>
 
 #include "apr_pools.h"
 #include "apr_file_io.h"
+#include "apr_dso.h"
+#include "apr_time.h"
+#if APR_HAS_THREADS
+#include "apr_thread_proc.h"
+#include "apr_thread_mutex.h"
+#endif /* APR_HAS_THREADS */
 
 #include "svn_pools.h"
 #include "svn_error.h"
 #include "svn_path.h"
 #include "svn_delta.h"
 #include "svn_fs.h"
+#include "svn_io.h"
+#include "svn_time.h"
 #include "svn_repos.h"
 #include "repos.h"
 
@@ -139,10 +148,12 @@ run_pre_commit_hook (svn_repos_t *repos,
 
 
 /* Run the post-commit hook for REPOS.  Use POOL for any temporary
-   allocations.  If the hook fails, run SVN_ERR_REPOS_HOOK_FAILURE.  */
+   allocations.  If the hook fails, run SVN_ERR_REPOS_HOOK_FAILURE.
+   Its exit status is ignored unless CHECK_STATUS is true.  */
 static svn_error_t  *
 run_post_commit_hook (svn_repos_t *repos,
                       svn_revnum_t rev,
+                      svn_boolean_t check_status,
                       apr_pool_t *pool)
 {
   enum svn_node_kind kind;
@@ -152,6 +163,8 @@ run_post_commit_hook (svn_repos_t *repos,
       && (kind == svn_node_file))
     {
       svn_error_t *err;
+      int exitcode;
+      apr_exit_why_e exitwhy;
       const char *args[4];
 
       args[0] = hook;
@@ -159,18 +172,648 @@ run_post_commit_hook (svn_repos_t *repos,
       args[2] = apr_psprintf (pool, "%lu", rev);
       args[3] = NULL;
 
-      if ((err = run_cmd_with_output (hook, args, NULL, NULL, pool)))
+      if ((err = run_cmd_with_output (hook, args, &exitcode, &exitwhy, pool)))
         {
           return svn_error_createf 
             (SVN_ERR_REPOS_HOOK_FAILURE, 0, err, pool,
              "run_post_commit_hook: error running cmd `%s'", hook);
         }
+      if (check_status
+          && (! APR_PROC_CHECK_EXIT (exitwhy) || exitcode != 0))
+        {
+          return svn_error_create
+              (SVN_ERR_REPOS_HOOK_FAILURE, 0, NULL, pool,
+               "post-commit hook return non-zero status.");
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+
+/*** Hook plugins. ***/
+
+/* Record that loading REPOS's hook plugin failed with APR_ERR and
+   MESSAGE, wrapping CHILD if it is non-null, and return that error,
+   allocated in POOL.  */
+static svn_error_t *
+hook_plugin_failed (svn_repos_t *repos,
+                    apr_status_t apr_err,
+                    svn_error_t *child,
+                    const char *message,
+                    apr_pool_t *pool)
+{
+  repos->hook_plugin = NULL;
+  repos->hook_plugin_loaded = TRUE;
+  repos->hook_plugin_errcode = apr_err;
+  repos->hook_plugin_errmsg
+    = (child && child->message)
+      ? apr_psprintf (repos->pool, "%s: %s", message, child->message)
+      : apr_pstrdup (repos->pool, message);
+
+  return svn_error_create (apr_err, 0, child, pool, message);
+}
+
+
+/* Load REPOS's hook plugin, if it has one and it has not been loaded
+   already.  Afterwards REPOS->hook_plugin is the plugin's function
+   table, or NULL if there is no plugin.  If loading the plugin fails,
+   return the error, and return it again on every later call rather
+   than trying again.  Use POOL for any temporary allocations.  */
+static svn_error_t *
+load_hook_plugin (svn_repos_t *repos, apr_pool_t *pool)
+{
+  if (repos->hook_plugin_loaded)
+    {
+      if (repos->hook_plugin_errmsg)
+        return svn_error_create (repos->hook_plugin_errcode, 0, NULL, pool,
+                                 repos->hook_plugin_errmsg);
+      return SVN_NO_ERROR;
+    }
+
+#if APR_HAS_DSO
+  {
+    enum svn_node_kind kind;
+    const char *libname = svn_repos_hook_plugin (repos, pool);
+
+    if ((! svn_io_check_path (libname, &kind, pool))
+        && (kind == svn_node_file))
+      {
+        apr_dso_handle_t *dso;
+        apr_dso_handle_sym_t symbol;
+        apr_status_t status;
+        svn_error_t *err;
+
+        /* note: the library will be unloaded at REPOS's pool cleanup */
+        status = apr_dso_load (&dso, libname, repos->pool);
+        if (status)
+          return hook_plugin_failed
+            (repos, status, NULL,
+             apr_psprintf (pool, "loading hook plugin `%s'", libname),
+             pool);
+
+        status = apr_dso_sym (&symbol, dso, SVN_REPOS_HOOK_PLUGIN_INIT_NAME);
+        if (status)
+          {
+            /* Nothing of the library's has run yet, so it's safe to
+               drop it now rather than keep it until REPOS goes. */
+            apr_dso_unload (dso);
+            return hook_plugin_failed
+              (repos, status, NULL,
+               apr_psprintf (pool, "%s does not define %s()",
+                             libname, SVN_REPOS_HOOK_PLUGIN_INIT_NAME),
+               pool);
+          }
+
+        err = ((svn_repos_hook_plugin_init_t) symbol)
+          (&repos->hook_plugin, &repos->hook_plugin_baton,
+           SVN_REPOS_HOOK_PLUGIN_ABI_VERSION, repos, repos->pool);
+        if (err)
+          return hook_plugin_failed
+            (repos, SVN_ERR_REPOS_HOOK_FAILURE, err,
+             apr_psprintf (pool, "initializing hook plugin `%s'", libname),
+             pool);
+      }
+  }
+#endif /* APR_HAS_DSO */
+
+  repos->hook_plugin_loaded = TRUE;
+  return SVN_NO_ERROR;
+}
+
+
+/* Run REPOS's start-commit hook for USER: the plugin's, if it has one,
+   else the hook program.  Use POOL for any temporary allocations.  */
+static svn_error_t *
+start_commit_hook (svn_repos_t *repos,
+                   const char *user,
+                   apr_pool_t *pool)
+{
+  const svn_repos_hook_plugin_t *plugin;
+  svn_error_t *err;
+
+  SVN_ERR (load_hook_plugin (repos, pool));
+  plugin = repos->hook_plugin;
+  if (! (plugin && plugin->start_commit))
+    return run_start_commit_hook (repos, user, pool);
+
+  if ((err = plugin->start_commit (repos->hook_plugin_baton,
+                                   repos, user, pool)))
+    return svn_error_create (SVN_ERR_REPOS_HOOK_FAILURE, 0, err, pool,
+                             "start-commit hook plugin failed");
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Call REPOS's plugin's pre-commit hook for TXN, allocating the roots
+   and changed paths it is given in POOL.  */
+static svn_error_t *
+run_pre_commit_plugin (svn_repos_t *repos,
+                       svn_fs_txn_t *txn,
+                       apr_pool_t *pool)
+{
+  svn_fs_root_t *base_root, *txn_root;
+  apr_hash_t *changed_paths;
+  svn_error_t *err;
+
+  SVN_ERR (svn_fs_txn_root (&txn_root, txn, pool));
+  SVN_ERR (svn_fs_revision_root (&base_root, repos->fs,
+                                 svn_fs_txn_base_revision (txn), pool));
+  SVN_ERR (svn_repos__changed_paths (&changed_paths, repos,
+                                     base_root, txn_root, pool));
+
+  if ((err = repos->hook_plugin->pre_commit (repos->hook_plugin_baton, repos,
+                                             txn, txn_root, changed_paths,
+                                             pool)))
+    return svn_error_create (SVN_ERR_REPOS_HOOK_FAILURE, 0, err, pool,
+                             "pre-commit hook plugin failed.  Aborting txn.");
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Run REPOS's pre-commit hook for TXN: the plugin's, if it has one,
+   else the hook program.  Use POOL for any temporary allocations.  */
+static svn_error_t *
+pre_commit_hook (svn_repos_t *repos,
+                 svn_fs_txn_t *txn,
+                 apr_pool_t *pool)
+{
+  apr_pool_t *subpool;
+  svn_error_t *err;
+
+  SVN_ERR (load_hook_plugin (repos, pool));
+  if (! (repos->hook_plugin && repos->hook_plugin->pre_commit))
+    {
+      const char *txn_name;
+
+      SVN_ERR (svn_fs_txn_name (&txn_name, txn, pool));
+      return run_pre_commit_hook (repos, txn_name, pool);
+    }
+
+  /* Errors live in the error pool, so they outlast SUBPOOL. */
+  subpool = svn_pool_create (pool);
+  err = run_pre_commit_plugin (repos, txn, subpool);
+  svn_pool_destroy (subpool);
+  return err;
+}
+
+
+/* Call REPOS's plugin's post-commit hook for revision REV, allocating
+   the roots and changed paths it is given in POOL.  */
+static svn_error_t *
+run_post_commit_plugin (svn_repos_t *repos,
+                        svn_revnum_t rev,
+                        apr_pool_t *pool)
+{
+  svn_fs_root_t *base_root, *rev_root;
+  apr_hash_t *changed_paths;
+  svn_error_t *err;
+
+  SVN_ERR (svn_fs_revision_root (&rev_root, repos->fs, rev, pool));
+  SVN_ERR (svn_fs_revision_root (&base_root, repos->fs, rev - 1, pool));
+  SVN_ERR (svn_repos__changed_paths (&changed_paths, repos,
+                                     base_root, rev_root, pool));
+
+  if ((err = repos->hook_plugin->post_commit (repos->hook_plugin_baton,
+                                              repos, rev, rev_root,
+                                              changed_paths, pool)))
+    return svn_error_create (SVN_ERR_REPOS_HOOK_FAILURE, 0, err, pool,
+                             "post-commit hook plugin failed");
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Run REPOS's post-commit hook for revision REV: the plugin's, if it
+   has one, else the hook program.  CHECK_STATUS is as for
+   run_post_commit_hook().  Use POOL for any temporary allocations.  */
+static svn_error_t *
+post_commit_hook (svn_repos_t *repos,
+                  svn_revnum_t rev,
+                  svn_boolean_t check_status,
+                  apr_pool_t *pool)
+{
+  apr_pool_t *subpool;
+  svn_error_t *err;
+
+  SVN_ERR (load_hook_plugin (repos, pool));
+  if (! (repos->hook_plugin && repos->hook_plugin->post_commit))
+    return run_post_commit_hook (repos, rev, check_status, pool);
+
+  /* Errors live in the error pool, so they outlast SUBPOOL. */
+  subpool = svn_pool_create (pool);
+  err = run_post_commit_plugin (repos, rev, subpool);
+  svn_pool_destroy (subpool);
+  return err;
+}
+
+
+
+
+/*** The post-commit queue. ***/
+
+/* Queued post-commit hooks live in the SVN_REPOS__HOOK_QUEUE_DIR
+   directory of the repository's hooks directory, one file per
+   revision, named by the revision number.  The file's first line is
+   the time the revision was queued, its second the number of times
+   its hook has failed so far, and the rest the message from the last
+   failure, if any.  Entries are written under a temporary name,
+   synced to disk, and renamed into place, so that neither a reader
+   nor a crash ever leaves half of one.  */
+
+/* Return the path to REPOS's post-commit queue, allocated in POOL. */
+static const char *
+queue_dir (svn_repos_t *repos, apr_pool_t *pool)
+{
+  return apr_pstrcat (pool, repos->hook_path, "/" SVN_REPOS__HOOK_QUEUE_DIR,
+                      NULL);
+}
+
+
+/* Write the queue entry for REV in QUEUE_DIR: it was queued at QUEUED,
+   and its hook has failed ATTEMPTS times, most recently with the
+   message LAST_ERROR (which may be NULL).  Use POOL for temporary
+   allocations.  */
+static svn_error_t *
+write_queue_entry (const char *queue_dir,
+                   svn_revnum_t rev,
+                   apr_time_t queued,
+                   int attempts,
+                   const char *last_error,
+                   apr_pool_t *pool)
+{
+  const char *path = apr_psprintf (pool, "%s/%ld", queue_dir, (long) rev);
+  const char *tmp_path = apr_pstrcat (pool, path,
+                                      SVN_REPOS__HOOK_QUEUE_TMP_EXT, NULL);
+  const char *contents;
+  apr_file_t *f;
+  apr_size_t written;
+  apr_status_t apr_err;
+
+  contents = apr_psprintf (pool, "%s\n%d\n%s",
+                           svn_time_to_nts (queued, pool), attempts,
+                           last_error ? last_error : "");
+
+  apr_err = apr_file_open (&f, tmp_path,
+                           (APR_WRITE | APR_CREATE | APR_TRUNCATE),
+                           APR_OS_DEFAULT, pool);
+  if (apr_err)
+    return svn_error_createf (apr_err, 0, NULL, pool,
+                              "creating queue entry `%s'", tmp_path);
+
+  apr_err = apr_file_write_full (f, contents, strlen (contents), &written);
+  if (apr_err)
+    return svn_error_createf (apr_err, 0, NULL, pool,
+                              "writing queue entry `%s'", tmp_path);
+
+  /* The entry must be on disk before the rename makes it visible. */
+  SVN_ERR (svn_io_file_flush_to_disk (f, pool));
+
+  apr_err = apr_file_close (f);
+  if (apr_err)
+    return svn_error_createf (apr_err, 0, NULL, pool,
+                              "closing queue entry `%s'", tmp_path);
+
+  apr_err = apr_file_rename (tmp_path, path, pool);
+  if (apr_err)
+    return svn_error_createf (apr_err, 0, NULL, pool,
+                              "renaming queue entry `%s'", tmp_path);
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Read the queue entry for REV in QUEUE_DIR, setting *QUEUED and
+   *ATTEMPTS as described for write_queue_entry().  Use POOL for
+   temporary allocations.  */
+static svn_error_t *
+read_queue_entry (apr_time_t *queued,
+                  int *attempts,
+                  const char *queue_dir,
+                  svn_revnum_t rev,
+                  apr_pool_t *pool)
+{
+  const char *path = apr_psprintf (pool, "%s/%ld", queue_dir, (long) rev);
+  svn_stringbuf_t *contents;
+  char *time_str, *attempts_str, *eol;
+
+  SVN_ERR (svn_string_from_file (&contents, path, pool));
+
+  time_str = contents->data;
+  eol = strchr (time_str, '\n');
+  if (! eol)
+    return svn_error_createf (SVN_ERR_REPOS_HOOK_FAILURE, 0, NULL, pool,
+                              "malformed queue entry `%s'", path);
+  *eol = '\0';
+  attempts_str = eol + 1;
+
+  *queued = svn_time_from_nts (time_str);
+  *attempts = atoi (attempts_str);
+  return SVN_NO_ERROR;
+}
+
+
+/* Set *REVS to the revisions queued in QUEUE_DIR, oldest first.  Use
+   POOL for all allocations.  */
+static svn_error_t *
+list_queue (apr_array_header_t **revs,
+            const char *queue_dir,
+            apr_pool_t *pool)
+{
+  apr_hash_t *dirents;
+  apr_hash_index_t *hi;
+  enum svn_node_kind kind;
+  int i, j;
+
+  *revs = apr_array_make (pool, 0, sizeof (svn_revnum_t));
+
+  SVN_ERR (svn_io_check_path (queue_dir, &kind, pool));
+  if (kind != svn_node_dir)
+    return SVN_NO_ERROR;
+
+  SVN_ERR (svn_io_get_dirents (&dirents, svn_stringbuf_create (queue_dir,
+                                                               pool),
+                               pool));
+  for (hi = apr_hash_first (pool, dirents); hi; hi = apr_hash_next (hi))
+    {
+      const void *key;
+      const char *name, *p;
+
+      apr_hash_this (hi, &key, NULL, NULL);
+      name = key;
+
+      /* Skip temporary and given-up-on entries. */
+      for (p = name; *p && isdigit ((unsigned char) *p); p++)
+        ;
+      if (p == name || *p)
+        continue;
+
+      (*((svn_revnum_t *) apr_array_push (*revs))) = SVN_STR_TO_REV (name);
+    }
+
+  /* Sort oldest first.  There are rarely more than a handful. */
+  for (i = 1; i < (*revs)->nelts; i++)
+    {
+      svn_revnum_t rev = APR_ARRAY_IDX (*revs, i, svn_revnum_t);
+
+      for (j = i; j > 0 && APR_ARRAY_IDX (*revs, j - 1, svn_revnum_t) > rev;
+           j--)
+        APR_ARRAY_IDX (*revs, j, svn_revnum_t)
+          = APR_ARRAY_IDX (*revs, j - 1, svn_revnum_t);
+      APR_ARRAY_IDX (*revs, j, svn_revnum_t) = rev;
     }
 
   return SVN_NO_ERROR;
 }
 
 
+/* Queue REPOS's post-commit hook for revision REV, if it has one.  Use
+   POOL for temporary allocations.  */
+static svn_error_t *
+queue_post_commit_hook (svn_repos_t *repos,
+                        svn_revnum_t rev,
+                        apr_pool_t *pool)
+{
+  const char *dir = queue_dir (repos, pool);
+  apr_status_t apr_err;
+
+  SVN_ERR (load_hook_plugin (repos, pool));
+  if (! (repos->hook_plugin && repos->hook_plugin->post_commit))
+    {
+      enum svn_node_kind kind;
+
+      if (svn_io_check_path (svn_repos_post_commit_hook (repos, pool),
+                             &kind, pool)
+          || kind != svn_node_file)
+        return SVN_NO_ERROR;
+    }
+
+  apr_err = apr_dir_make (dir, APR_OS_DEFAULT, pool);
+  if (apr_err && ! APR_STATUS_IS_EEXIST (apr_err))
+    return svn_error_createf (apr_err, 0, NULL, pool,
+                              "creating queue dir `%s'", dir);
+
+  return write_queue_entry (dir, rev, apr_time_now (), 0, NULL, pool);
+}
+
+
+/* Run the queued post-commit hook for REV of REPOS, whose queue
+   directory is QUEUE_DIR, and remove, update, or set aside its queue
+   entry according to how that went.  A hook that has now failed
+   MAX_ATTEMPTS times is set aside.  Add the outcome to STATS.  Use
+   POOL for temporary allocations.  */
+static svn_error_t *
+run_queue_entry (svn_repos_hook_queue_stats_t *stats,
+                 svn_repos_t *repos,
+                 const char *queue_dir,
+                 svn_revnum_t rev,
+                 int max_attempts,
+                 apr_pool_t *pool)
+{
+  const char *path = apr_psprintf (pool, "%s/%ld", queue_dir, (long) rev);
+  apr_time_t queued, start, now;
+  int attempts;
+  svn_error_t *err, *e;
+  svn_stringbuf_t *msg;
+
+  SVN_ERR (read_queue_entry (&queued, &attempts, queue_dir, rev, pool));
+
+  start = apr_time_now ();
+  err = post_commit_hook (repos, rev, TRUE, pool);
+  now = apr_time_now ();
+
+  stats->total_time += now - start;
+  if (now - start > stats->max_time)
+    stats->max_time = now - start;
+
+  if (! err)
+    {
+      if (now - queued > stats->max_wait)
+        stats->max_wait = now - queued;
+      stats->run++;
+      return svn_io_remove_file (path, pool);
+    }
+
+  msg = svn_stringbuf_create ("", pool);
+  for (e = err; e; e = e->child)
+    if (e->message)
+      {
+        svn_stringbuf_appendcstr (msg, e->message);
+        svn_stringbuf_appendcstr (msg, "\n");
+      }
+  svn_error_clear_all (err);
+
+  SVN_ERR (write_queue_entry (queue_dir, rev, queued, ++attempts,
+                              msg->data, pool));
+  if (attempts < max_attempts)
+    {
+      stats->retried++;
+      return SVN_NO_ERROR;
+    }
+
+  stats->failed++;
+  {
+    const char *failed_path = apr_pstrcat (pool, path,
+                                           SVN_REPOS__HOOK_QUEUE_FAIL_EXT,
+                                           NULL);
+    apr_status_t apr_err = apr_file_rename (path, failed_path, pool);
+
+    if (apr_err)
+      return svn_error_createf (apr_err, 0, NULL, pool,
+                                "renaming queue entry `%s'", path);
+  }
+
+  return SVN_NO_ERROR;
+}
+
+
+#if APR_HAS_THREADS
+
+/* A run of the queue on several threads. */
+struct queue_run
+{
+  const char *repos_path;
+  const char *queue_dir;
+  const apr_array_header_t *revs;
+  int max_attempts;
+
+  /* The index in REVS of the next revision to run, protected by LOCK. */
+  int next;
+  apr_thread_mutex_t *lock;
+};
+
+/* One thread of a queue run. */
+struct queue_worker
+{
+  struct queue_run *run;
+
+  /* A root pool, so that errors and the repository object belong to
+     this thread alone. */
+  apr_pool_t *pool;
+  svn_repos_t *repos;
+
+  /* What this thread did, and the error that stopped it, if any. */
+  svn_repos_hook_queue_stats_t stats;
+  svn_error_t *err;
+};
+
+
+/* Thread body: run queue entries until there are none left. */
+static void * APR_THREAD_FUNC
+queue_worker (apr_thread_t *thread, void *baton)
+{
+  struct queue_worker *w = baton;
+  struct queue_run *run = w->run;
+  apr_pool_t *subpool = svn_pool_create (w->pool);
+
+  while (! w->err)
+    {
+      svn_revnum_t rev;
+
+      apr_thread_mutex_lock (run->lock);
+      if (run->next < run->revs->nelts)
+        rev = APR_ARRAY_IDX (run->revs, run->next++, svn_revnum_t);
+      else
+        rev = SVN_INVALID_REVNUM;
+      apr_thread_mutex_unlock (run->lock);
+
+      if (! SVN_IS_VALID_REVNUM (rev))
+        break;
+
+      w->err = run_queue_entry (&w->stats, w->repos, run->queue_dir, rev,
+                                run->max_attempts, subpool);
+      svn_pool_clear (subpool);
+    }
+
+  return NULL;
+}
+
+
+/* Run the revisions REVS queued in REPOS's QUEUE_DIR on NUM_THREADS
+   threads, as for svn_repos_run_post_commit_queue().  Set *STARTED to
+   the number of threads that could be started; if none were, nothing
+   has been done.  Add what they did to STATS.  Use POOL for
+   allocations.  */
+static svn_error_t *
+run_queue_threaded (int *started,
+                    svn_repos_hook_queue_stats_t *stats,
+                    svn_repos_t *repos,
+                    const char *queue_dir,
+                    const apr_array_header_t *revs,
+                    int num_threads,
+                    int max_attempts,
+                    apr_pool_t *pool)
+{
+  struct queue_run run;
+  struct queue_worker *workers;
+  apr_thread_t **threads;
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  *started = 0;
+  run.repos_path = repos->path;
+  run.queue_dir = queue_dir;
+  run.revs = revs;
+  run.max_attempts = max_attempts;
+  run.next = 0;
+  if (apr_thread_mutex_create (&run.lock, APR_THREAD_MUTEX_DEFAULT, pool))
+    return SVN_NO_ERROR;
+
+  workers = apr_pcalloc (pool, num_threads * sizeof (*workers));
+  threads = apr_pcalloc (pool, num_threads * sizeof (*threads));
+  while (*started < num_threads)
+    {
+      struct queue_worker *w = &workers[*started];
+
+      w->run = &run;
+      w->pool = svn_pool_create (NULL);
+      if (svn_repos_open (&w->repos, run.repos_path, w->pool)
+          || apr_thread_create (&threads[*started], NULL, queue_worker,
+                                w, pool))
+        {
+          svn_pool_destroy (w->pool);
+          break;
+        }
+      (*started)++;
+    }
+
+  for (i = 0; i < *started; i++)
+    {
+      struct queue_worker *w = &workers[i];
+      apr_status_t retval;
+
+      apr_thread_join (&retval, threads[i]);
+
+      stats->run += w->stats.run;
+      stats->retried += w->stats.retried;
+      stats->failed += w->stats.failed;
+      stats->total_time += w->stats.total_time;
+      if (w->stats.max_time > stats->max_time)
+        stats->max_time = w->stats.max_time;
+      if (w->stats.max_wait > stats->max_wait)
+        stats->max_wait = w->stats.max_wait;
+
+      /* Keep the first error, copied out of the worker's pool. */
+      if (w->err && ! err)
+        err = svn_error_create (w->err->apr_err, w->err->src_err, NULL,
+                                pool, w->err->message);
+
+      svn_repos_close (w->repos);
+      svn_pool_destroy (w->pool);
+    }
+
+  apr_thread_mutex_destroy (run.lock);
+  return err;
+}
+
+#endif /* APR_HAS_THREADS */
+
+
+
+
 
 /*** Public interface. ***/
 
@@ -182,30 +825,152 @@ svn_repos_fs_commit_txn (const char **conflict_p,
 {
   svn_fs_t *fs = repos->fs;
   apr_pool_t *pool = svn_fs_txn_pool (txn);
+  svn_error_t *spool_err, *err;
 
   if (fs != svn_fs_txn_fs (txn))
     return svn_error_createf 
       (SVN_ERR_FS_GENERAL, 0, NULL, pool,
        "Transaction does not belong to given repository's filesystem");
 
-  /* Run pre-commit hooks. */
-  {
-    const char *txn_name;
+  if (repos->replica_of)
+    return svn_repos__read_only_error (repos, pool);
 
-    SVN_ERR (svn_fs_txn_name (&txn_name, txn, pool));
-    SVN_ERR (run_pre_commit_hook (repos, txn_name, pool));
-  }
+  /* Run pre-commit hooks. */
+  SVN_ERR (pre_commit_hook (repos, txn, pool));
 
   /* Commit. */
   SVN_ERR (svn_fs_commit_txn (conflict_p, new_rev, txn));
 
-  /* Run post-commit hooks. */
-  SVN_ERR (run_post_commit_hook (repos, *new_rev, pool));
+  /* Hand the new revision to the replicas.  The commit has happened
+     whether or not this works, so the post-commit hook runs either
+     way.  */
+  spool_err = svn_repos__spool_revision (repos, *new_rev, pool);
+
+  /* Run post-commit hooks, or queue them to be run later. */
+  if (repos->post_commit_async)
+    err = queue_post_commit_hook (repos, *new_rev, pool);
+  else
+    err = post_commit_hook (repos, *new_rev, FALSE, pool);
+
+  if (spool_err)
+    {
+      if (err)
+        svn_error_clear_all (err);
+      return svn_error_createf
+        (spool_err->apr_err, 0, spool_err, pool,
+         "revision %ld was committed, but could not be spooled for replicas",
+         (long) *new_rev);
+    }
+
+  return err;
+}
+
+
+svn_error_t *
+svn_repos_post_commit_queue_depth (int *depth,
+                                   apr_time_t *oldest,
+                                   svn_repos_t *repos,
+                                   apr_pool_t *pool)
+{
+  const char *dir = queue_dir (repos, pool);
+  apr_array_header_t *revs;
+  int attempts;
+
+  SVN_ERR (list_queue (&revs, dir, pool));
+  *depth = revs->nelts;
+  *oldest = 0;
+
+  /* The oldest revision was queued first, retries notwithstanding. */
+  if (revs->nelts)
+    SVN_ERR (read_queue_entry (oldest, &attempts, dir,
+                               APR_ARRAY_IDX (revs, 0, svn_revnum_t), pool));
 
   return SVN_NO_ERROR;
 }
 
 
+/* Run the revisions queued in REPOS's QUEUE_DIR, whose lock the
+   caller holds, as for svn_repos_run_post_commit_queue().  Use POOL
+   for all allocations.  */
+static svn_error_t *
+run_queue (svn_repos_hook_queue_stats_t *stats,
+           svn_repos_t *repos,
+           const char *queue_dir,
+           int num_threads,
+           int max_attempts,
+           apr_pool_t *pool)
+{
+  apr_array_header_t *revs;
+  apr_time_t oldest;
+  int started = 0;
+  int i;
+
+  SVN_ERR (list_queue (&revs, queue_dir, pool));
+
+#if APR_HAS_THREADS
+  if (num_threads > 1 && revs->nelts > 1)
+    SVN_ERR (run_queue_threaded (&started, stats, repos, queue_dir, revs,
+                                 num_threads, max_attempts, pool));
+#endif /* APR_HAS_THREADS */
+
+  if (! started)
+    {
+      apr_pool_t *iterpool = svn_pool_create (pool);
+
+      for (i = 0; i < revs->nelts; i++)
+        {
+          SVN_ERR (run_queue_entry (stats, repos, queue_dir,
+                                    APR_ARRAY_IDX (revs, i, svn_revnum_t),
+                                    max_attempts, iterpool));
+          svn_pool_clear (iterpool);
+        }
+    }
+
+  return svn_repos_post_commit_queue_depth (&stats->queued, &oldest,
+                                            repos, pool);
+}
+
+
+svn_error_t *
+svn_repos_run_post_commit_queue (svn_repos_hook_queue_stats_t *stats,
+                                 svn_repos_t *repos,
+                                 int num_threads,
+                                 int max_attempts,
+                                 apr_pool_t *pool)
+{
+  const char *lockfile_path;
+  apr_file_t *lockfile;
+  apr_pool_t *subpool = svn_pool_create (pool);
+  apr_status_t apr_err;
+  svn_error_t *err;
+
+  memset (stats, 0, sizeof (*stats));
+
+  /* Only one run at a time.  The lock goes away when SUBPOOL closes
+     the lockfile, so SUBPOOL must go on every return from here. */
+  lockfile_path = apr_pstrcat (subpool, repos->lock_path,
+                               "/" SVN_REPOS__HOOK_QUEUE_LOCKFILE, NULL);
+  apr_err = apr_file_open (&lockfile, lockfile_path,
+                           (APR_WRITE | APR_CREATE), APR_OS_DEFAULT,
+                           subpool);
+  if (! apr_err)
+    apr_err = apr_file_lock (lockfile, APR_FLOCK_EXCLUSIVE);
+  if (apr_err)
+    {
+      err = svn_error_createf (apr_err, 0, NULL, pool,
+                               "locking queue lockfile `%s'", lockfile_path);
+      svn_pool_destroy (subpool);
+      return err;
+    }
+
+  /* Errors live in the error pool, so they outlast SUBPOOL. */
+  err = run_queue (stats, repos, queue_dir (repos, subpool),
+                   num_threads, max_attempts, subpool);
+  svn_pool_destroy (subpool);
+  return err;
+}
+
+
 svn_error_t *
 svn_repos_fs_begin_txn_for_commit (svn_fs_txn_t **txn_p,
                                    svn_repos_t *repos,
@@ -214,8 +979,11 @@ svn_repos_fs_begin_txn_for_commit (svn_fs_txn_t **txn_p,
                                    svn_string_t *log_msg,
                                    apr_pool_t *pool)
 {
+  if (repos->replica_of)
+    return svn_repos__read_only_error (repos, pool);
+
   /* Run start-commit hooks. */
-  SVN_ERR (run_start_commit_hook (repos, author, pool));
+  SVN_ERR (start_commit_hook (repos, author, pool));
 
   /* Begin the transaction. */
   SVN_ERR (svn_fs_begin_txn (txn_p, repos->fs, rev, pool));
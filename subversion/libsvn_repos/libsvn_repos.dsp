@@ -87,14 +87,26 @@ LIB32=link.exe -lib
 # PROP Default_Filter "cpp;c;cxx;rc;def;r;odl;idl;hpj;bat"
 # Begin Source File
 
+SOURCE=.\commit.c
+# End Source File
+# Begin Source File
+
 SOURCE=.\delta.c
 # End Source File
 # Begin Source File
 
+SOURCE=.\dump.c
+# End Source File
+# Begin Source File
+
 SOURCE=.\hooks.c
 # End Source File
 # Begin Source File
 
+SOURCE=.\load.c
+# End Source File
+# Begin Source File
+
 SOURCE=.\log.c
 # End Source File
 # Begin Source File
@@ -107,6 +119,10 @@ SOURCE=.\reporter.c
 # End Source File
 # Begin Source File
 
+SOURCE=.\replicate.c
+# End Source File
+# Begin Source File
+
 SOURCE=.\repos.c
 # End Source File
 # Begin Source File
@@ -0,0 +1,733 @@
+/* load.c --- parsing a 'dumpfile'-formatted stream into a filesystem.
+ *
+ * ====================================================================
+ * Copyright (c) 2000-2002 CollabNet.  All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.  The terms
+ * are also available at http://subversion.tigris.org/license-1.html.
+ * If newer versions of this license are posted there, you may use a
+ * newer version instead, at your option.
+ *
+ * This software consists of voluntary contributions made by many
+ * individuals.  For exact contribution history, see the revision
+ * history and logs, available at http://subversion.tigris.org/.
+ * ====================================================================
+ */
+
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "apr_pools.h"
+#include "apr_hash.h"
+#include "apr_strings.h"
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_fs.h"
+#include "svn_repos.h"
+#include "svn_delta.h"
+#include "svn_io.h"
+#include "svn_string.h"
+#include "repos.h"
+
+
+
+/*** Reading the stream. ***/
+
+/* A buffered reader on top of a generic stream.  Headers are read a
+   line at a time, and content a block at a time, out of the same
+   buffer. */
+struct reader
+{
+  svn_stream_t *stream;
+  char *buf;
+  apr_size_t start, end;
+  svn_boolean_t eof;
+};
+
+
+static svn_error_t *
+malformed (const char *msg, apr_pool_t *pool)
+{
+  return svn_error_createf (SVN_ERR_REPOS_BAD_DUMP_STREAM, 0, NULL, pool,
+                            "load: %s", msg);
+}
+
+
+/* Make sure R's buffer holds some unread data, unless the stream is
+   exhausted. */
+static svn_error_t *
+fill_buffer (struct reader *r)
+{
+  if (r->start == r->end && ! r->eof)
+    {
+      apr_size_t len = SVN_STREAM_CHUNK_SIZE;
+
+      SVN_ERR (svn_stream_read (r->stream, r->buf, &len));
+      r->start = 0;
+      r->end = len;
+      if (len == 0)
+        r->eof = TRUE;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Read the next line from R into LINE, without its newline.  Set
+   *EOF to TRUE if the stream ended before anything was read. */
+static svn_error_t *
+read_line (svn_stringbuf_t *line, svn_boolean_t *eof, struct reader *r)
+{
+  svn_stringbuf_setempty (line);
+
+  while (1)
+    {
+      const char *nl;
+
+      SVN_ERR (fill_buffer (r));
+      if (r->start == r->end)
+        {
+          *eof = (line->len == 0);
+          return SVN_NO_ERROR;
+        }
+
+      nl = memchr (r->buf + r->start, '\n', r->end - r->start);
+      if (nl)
+        {
+          svn_stringbuf_appendbytes (line, r->buf + r->start,
+                                     nl - (r->buf + r->start));
+          r->start = nl - r->buf + 1;
+          *eof = FALSE;
+          return SVN_NO_ERROR;
+        }
+
+      svn_stringbuf_appendbytes (line, r->buf + r->start,
+                                 r->end - r->start);
+      r->start = r->end;
+    }
+}
+
+
+/* Copy exactly LEN bytes from R to DEST; if DEST is NULL, discard
+   them. */
+static svn_error_t *
+read_bytes (char *dest, apr_size_t len, struct reader *r, apr_pool_t *pool)
+{
+  while (len > 0)
+    {
+      apr_size_t n;
+
+      SVN_ERR (fill_buffer (r));
+      if (r->start == r->end)
+        return malformed ("unexpected end of stream", pool);
+
+      n = r->end - r->start;
+      if (n > len)
+        n = len;
+      if (dest)
+        {
+          memcpy (dest, r->buf + r->start, n);
+          dest += n;
+        }
+      r->start += n;
+      len -= n;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+/* A readable stream of the next REMAINING bytes of a reader, used to
+   hand a file's text to the filesystem without holding it in memory. */
+struct content_baton
+{
+  struct reader *reader;
+  apr_size_t remaining;
+  apr_pool_t *pool;
+};
+
+
+static svn_error_t *
+read_content (void *baton, char *buffer, apr_size_t *len)
+{
+  struct content_baton *cb = baton;
+
+  if (*len > cb->remaining)
+    *len = cb->remaining;
+  SVN_ERR (read_bytes (buffer, *len, cb->reader, cb->pool));
+  cb->remaining -= *len;
+  return SVN_NO_ERROR;
+}
+
+
+/* Read a block of header lines from R into *HEADERS, a hash mapping
+   header names to values (both const char *).  Blank lines before the
+   block are skipped.  If the stream ends first, set *HEADERS to NULL. */
+static svn_error_t *
+read_header_block (apr_hash_t **headers,
+                   struct reader *r,
+                   apr_pool_t *pool)
+{
+  svn_stringbuf_t *line = svn_stringbuf_create ("", pool);
+  svn_boolean_t eof;
+
+  do
+    {
+      SVN_ERR (read_line (line, &eof, r));
+      if (eof)
+        {
+          *headers = NULL;
+          return SVN_NO_ERROR;
+        }
+    }
+  while (line->len == 0);
+
+  *headers = apr_hash_make (pool);
+  while (line->len > 0)
+    {
+      char *colon = strchr (line->data, ':');
+
+      if (! colon || colon[1] != ' ')
+        return malformed (apr_psprintf (pool, "bad header line `%s'",
+                                        line->data), pool);
+
+      apr_hash_set (*headers,
+                    apr_pstrndup (pool, line->data, colon - line->data),
+                    APR_HASH_KEY_STRING,
+                    apr_pstrdup (pool, colon + 2));
+
+      SVN_ERR (read_line (line, &eof, r));
+      if (eof)
+        break;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Return the value of the numeric header NAME in HEADERS, or -1 if
+   it is absent. */
+static long
+header_number (apr_hash_t *headers, const char *name)
+{
+  const char *val = apr_hash_get (headers, name, APR_HASH_KEY_STRING);
+
+  return val ? atol (val) : -1;
+}
+
+
+/* Parse the LEN-byte property list at DATA into *PROPS, a hash mapping
+   property names to svn_string_t * values. */
+static svn_error_t *
+parse_proplist (apr_hash_t **props,
+                const char *data,
+                apr_size_t len,
+                apr_pool_t *pool)
+{
+  const char *p = data, *end = data + len;
+
+  *props = apr_hash_make (pool);
+  while (1)
+    {
+      const char *key;
+      apr_size_t keylen, vallen;
+      char *tail;
+
+      if (end - p >= 9 && strncmp (p, "PROPS-END", 9) == 0)
+        return SVN_NO_ERROR;
+
+      if (end - p < 2 || p[0] != 'K' || p[1] != ' ')
+        return malformed ("bad property list", pool);
+      keylen = strtoul (p + 2, &tail, 10);
+      if (tail >= end || *tail != '\n' || keylen + 1 > (apr_size_t)
+          (end - tail - 1))
+        return malformed ("bad property key", pool);
+      key = tail + 1;
+      p = key + keylen + 1;
+
+      if (end - p < 2 || p[0] != 'V' || p[1] != ' ')
+        return malformed ("bad property list", pool);
+      vallen = strtoul (p + 2, &tail, 10);
+      if (tail >= end || *tail != '\n' || vallen + 1 > (apr_size_t)
+          (end - tail - 1))
+        return malformed ("bad property value", pool);
+
+      apr_hash_set (*props, apr_pstrndup (pool, key, keylen), keylen,
+                    svn_string_ncreate (tail + 1, vallen, pool));
+      p = tail + 1 + vallen + 1;
+    }
+}
+
+
+/* Read the LEN-byte property list of the current record from R into
+   *PROPS. */
+static svn_error_t *
+read_proplist (apr_hash_t **props,
+               long len,
+               struct reader *r,
+               apr_pool_t *pool)
+{
+  char *data = apr_palloc (pool, len + 1);
+
+  SVN_ERR (read_bytes (data, len, r, pool));
+  data[len] = '\0';
+  return parse_proplist (props, data, len, pool);
+}
+
+
+
+/*** Loading. ***/
+
+struct load_baton
+{
+  struct reader *reader;
+  svn_fs_t *fs;
+  svn_stream_t *feedback_stream;
+
+  /* Maps revision numbers in the stream (svn_revnum_t keys) to the
+     revisions they were committed as. */
+  apr_hash_t *rev_map;
+
+  /* Whether we are feeding a replica, whose revisions must be
+     numbered exactly as in the stream; see svn_repos__load_replica(). */
+  svn_boolean_t replicating;
+
+  /* The transaction for the revision being loaded, if any, and the
+     revision's number in the stream and original date. */
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t rev;
+  svn_string_t *date;
+
+  apr_pool_t *pool;
+};
+
+
+/* Commit LB's pending transaction, if there is one. */
+static svn_error_t *
+finish_revision (struct load_baton *lb, apr_pool_t *pool)
+{
+  const char *conflict;
+  svn_revnum_t new_rev, *key, *val;
+
+  if (! lb->txn)
+    return SVN_NO_ERROR;
+
+  SVN_ERR (svn_fs_commit_txn (&conflict, &new_rev, lb->txn));
+  lb->txn = NULL;
+  lb->txn_root = NULL;
+
+  /* Committing stamps the revision with the current time; put back
+     the one it was originally made at. */
+  if (lb->date)
+    SVN_ERR (svn_fs_change_rev_prop (lb->fs, new_rev, SVN_PROP_REVISION_DATE,
+                                     lb->date, pool));
+
+  key = apr_palloc (lb->pool, sizeof (*key));
+  val = apr_palloc (lb->pool, sizeof (*val));
+  *key = lb->rev;
+  *val = new_rev;
+  apr_hash_set (lb->rev_map, key, sizeof (*key), val);
+
+  if (lb->feedback_stream)
+    {
+      const char *msg = apr_psprintf (pool,
+                                      "------- Committed new rev %ld"
+                                      " (loaded from original rev %ld) >>>\n",
+                                      (long) new_rev, (long) lb->rev);
+      apr_size_t len = strlen (msg);
+
+      SVN_ERR (svn_stream_write (lb->feedback_stream, msg, &len));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Start loading the revision whose record has HEADERS.  Allocate the
+   transaction in REV_POOL. */
+static svn_error_t *
+start_revision (struct load_baton *lb,
+                apr_hash_t *headers,
+                apr_pool_t *rev_pool)
+{
+  long prop_len = header_number (headers,
+                                 SVN_REPOS_DUMPFILE_PROP_CONTENT_LENGTH);
+  long content_len = header_number (headers,
+                                    SVN_REPOS_DUMPFILE_CONTENT_LENGTH);
+  apr_hash_t *props = NULL;
+  apr_hash_index_t *hi;
+  svn_revnum_t youngest;
+
+  lb->rev = header_number (headers, SVN_REPOS_DUMPFILE_REVISION_NUMBER);
+  lb->date = NULL;
+  if (prop_len >= 0)
+    SVN_ERR (read_proplist (&props, prop_len, lb->reader, rev_pool));
+  else
+    prop_len = 0;
+
+  /* Skip anything in the record we don't know about. */
+  if (content_len > prop_len)
+    SVN_ERR (read_bytes (NULL, content_len - prop_len, lb->reader, rev_pool));
+
+  /* Revision 0 exists in every filesystem already, so there is no
+     transaction to put its properties on; set them on the revision. */
+  if (lb->rev == 0)
+    {
+      svn_revnum_t *zero = apr_pcalloc (lb->pool, sizeof (*zero));
+      apr_hash_set (lb->rev_map, zero, sizeof (*zero), zero);
+
+      if (props)
+        for (hi = apr_hash_first (rev_pool, props); hi;
+             hi = apr_hash_next (hi))
+          {
+            const void *key;
+            void *val;
+
+            apr_hash_this (hi, &key, NULL, &val);
+            SVN_ERR (svn_fs_change_rev_prop (lb->fs, 0, key, val, rev_pool));
+          }
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR (svn_fs_youngest_rev (&youngest, lb->fs, rev_pool));
+  if (lb->replicating && lb->rev != youngest + 1)
+    return svn_error_createf (SVN_ERR_REPOS_BAD_DUMP_STREAM, 0, NULL,
+                              rev_pool,
+                              "load: replica is at revision %ld, and can't "
+                              "take revision %ld next",
+                              (long) youngest, (long) lb->rev);
+  SVN_ERR (svn_fs_begin_txn (&lb->txn, lb->fs, youngest, rev_pool));
+  SVN_ERR (svn_fs_txn_root (&lb->txn_root, lb->txn, rev_pool));
+
+  if (props)
+    for (hi = apr_hash_first (rev_pool, props); hi; hi = apr_hash_next (hi))
+      {
+        const void *key;
+        void *val;
+
+        apr_hash_this (hi, &key, NULL, &val);
+        SVN_ERR (svn_fs_change_txn_prop (lb->txn, key, val, rev_pool));
+        if (strcmp (key, SVN_PROP_REVISION_DATE) == 0)
+          lb->date = val;
+      }
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Make the node at PATH's properties exactly PROPS. */
+static svn_error_t *
+set_node_props (struct load_baton *lb,
+                const char *path,
+                apr_hash_t *props,
+                apr_pool_t *pool)
+{
+  apr_hash_t *old_props;
+  apr_hash_index_t *hi;
+
+  SVN_ERR (svn_fs_node_proplist (&old_props, lb->txn_root, path, pool));
+  for (hi = apr_hash_first (pool, old_props); hi; hi = apr_hash_next (hi))
+    {
+      const void *key;
+      apr_ssize_t klen;
+
+      apr_hash_this (hi, &key, &klen, NULL);
+      if (! apr_hash_get (props, key, klen))
+        SVN_ERR (svn_fs_change_node_prop (lb->txn_root, path, key, NULL,
+                                          pool));
+    }
+
+  for (hi = apr_hash_first (pool, props); hi; hi = apr_hash_next (hi))
+    {
+      const void *key;
+      void *val;
+
+      apr_hash_this (hi, &key, NULL, &val);
+      SVN_ERR (svn_fs_change_node_prop (lb->txn_root, path, key, val, pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Replace the text of the file at PATH with the LEN bytes of content
+   that follow in the stream, which are an svndiff delta against the
+   file's current text if IS_DELTA, else a fulltext. */
+static svn_error_t *
+set_node_text (struct load_baton *lb,
+               const char *path,
+               long len,
+               svn_boolean_t is_delta,
+               apr_pool_t *pool)
+{
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+
+  SVN_ERR (svn_fs_apply_textdelta (&handler, &handler_baton,
+                                   lb->txn_root, path, pool));
+
+  if (is_delta)
+    {
+      svn_stream_t *parser = svn_txdelta_parse_svndiff (handler,
+                                                        handler_baton,
+                                                        TRUE, pool);
+      char *buf = apr_palloc (pool, SVN_STREAM_CHUNK_SIZE);
+
+      while (len > 0)
+        {
+          apr_size_t chunk = (len > SVN_STREAM_CHUNK_SIZE
+                              ? SVN_STREAM_CHUNK_SIZE : len);
+          apr_size_t n = chunk;
+
+          SVN_ERR (read_bytes (buf, chunk, lb->reader, pool));
+          SVN_ERR (svn_stream_write (parser, buf, &n));
+          len -= chunk;
+        }
+      SVN_ERR (svn_stream_close (parser));
+    }
+  else
+    {
+      struct content_baton *cb = apr_palloc (pool, sizeof (*cb));
+      svn_stream_t *content = svn_stream_create (cb, pool);
+
+      cb->reader = lb->reader;
+      cb->remaining = len;
+      cb->pool = pool;
+      svn_stream_set_read (content, read_content);
+      SVN_ERR (svn_txdelta_send_stream (content, handler, handler_baton,
+                                        pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Apply the node record with HEADERS to LB's transaction. */
+static svn_error_t *
+load_node (struct load_baton *lb, apr_hash_t *headers, apr_pool_t *pool)
+{
+  const char *path = apr_hash_get (headers, SVN_REPOS_DUMPFILE_NODE_PATH,
+                                   APR_HASH_KEY_STRING);
+  const char *action = apr_hash_get (headers, SVN_REPOS_DUMPFILE_NODE_ACTION,
+                                     APR_HASH_KEY_STRING);
+  const char *kind = apr_hash_get (headers, SVN_REPOS_DUMPFILE_NODE_KIND,
+                                   APR_HASH_KEY_STRING);
+  const char *copyfrom_path
+    = apr_hash_get (headers, SVN_REPOS_DUMPFILE_NODE_COPYFROM_PATH,
+                    APR_HASH_KEY_STRING);
+  const char *text_delta = apr_hash_get (headers,
+                                         SVN_REPOS_DUMPFILE_TEXT_DELTA,
+                                         APR_HASH_KEY_STRING);
+  long prop_len = header_number (headers,
+                                 SVN_REPOS_DUMPFILE_PROP_CONTENT_LENGTH);
+  long text_len = header_number (headers,
+                                 SVN_REPOS_DUMPFILE_TEXT_CONTENT_LENGTH);
+  long content_len = header_number (headers,
+                                    SVN_REPOS_DUMPFILE_CONTENT_LENGTH);
+
+  if (! lb->txn)
+    return malformed (apr_psprintf (pool, "node `%s' outside a revision",
+                                    path), pool);
+  if (! action)
+    return malformed (apr_psprintf (pool, "node `%s' has no action",
+                                    path), pool);
+
+  if (strcmp (action, "delete") == 0 || strcmp (action, "replace") == 0)
+    SVN_ERR (svn_fs_delete_tree (lb->txn_root, path, pool));
+
+  if (strcmp (action, "add") == 0 || strcmp (action, "replace") == 0)
+    {
+      if (copyfrom_path)
+        {
+          svn_revnum_t copyfrom_rev
+            = header_number (headers, SVN_REPOS_DUMPFILE_NODE_COPYFROM_REV);
+          svn_revnum_t *new_rev = apr_hash_get (lb->rev_map, &copyfrom_rev,
+                                                sizeof (copyfrom_rev));
+          svn_fs_root_t *copy_root;
+
+          /* A replica has every revision before the stream's, under
+             the same numbers. */
+          if (! new_rev && lb->replicating)
+            new_rev = &copyfrom_rev;
+
+          if (! new_rev)
+            return malformed (apr_psprintf (pool, "`%s' is copied from "
+                                            "revision %ld, which is not in "
+                                            "the stream", path,
+                                            (long) copyfrom_rev), pool);
+          SVN_ERR (svn_fs_revision_root (&copy_root, lb->fs, *new_rev, pool));
+          SVN_ERR (svn_fs_copy (copy_root, copyfrom_path,
+                                lb->txn_root, path, pool));
+        }
+      else if (kind && strcmp (kind, "dir") == 0)
+        SVN_ERR (svn_fs_make_dir (lb->txn_root, path, pool));
+      else if (kind && strcmp (kind, "file") == 0)
+        SVN_ERR (svn_fs_make_file (lb->txn_root, path, pool));
+      else
+        return malformed (apr_psprintf (pool, "node `%s' has no kind", path),
+                          pool);
+    }
+  else if (strcmp (action, "change") != 0 && strcmp (action, "delete") != 0)
+    return malformed (apr_psprintf (pool, "unknown action `%s'", action),
+                      pool);
+
+  if (prop_len >= 0)
+    {
+      apr_hash_t *props;
+
+      SVN_ERR (read_proplist (&props, prop_len, lb->reader, pool));
+      SVN_ERR (set_node_props (lb, path, props, pool));
+    }
+  else
+    prop_len = 0;
+
+  if (text_len >= 0)
+    SVN_ERR (set_node_text (lb, path, text_len,
+                            text_delta && strcmp (text_delta, "true") == 0,
+                            pool));
+  else
+    text_len = 0;
+
+  /* Skip anything in the record we don't know about. */
+  if (content_len > prop_len + text_len)
+    SVN_ERR (read_bytes (NULL, content_len - prop_len - text_len,
+                         lb->reader, pool));
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Read the records of LB's dump stream into LB's filesystem, up to the
+   end of the stream.  Allocate the pending revision's transaction in
+   REV_POOL, and use SUBPOOL, which is cleared after each record, for
+   everything else.  POOL is the pool LB was made in. */
+static svn_error_t *
+load_records (struct load_baton *lb,
+              apr_pool_t *rev_pool,
+              apr_pool_t *subpool,
+              apr_pool_t *pool)
+{
+  struct reader *r = lb->reader;
+  apr_hash_t *headers;
+  const char *version;
+
+  SVN_ERR (read_header_block (&headers, r, subpool));
+  version = headers ? apr_hash_get (headers, SVN_REPOS_DUMPFILE_MAGIC_HEADER,
+                                    APR_HASH_KEY_STRING) : NULL;
+  if (! version)
+    return malformed ("missing format version", pool);
+  if (atoi (version) < 1 || atoi (version) > SVN_REPOS_DUMPFILE_FORMAT_VERSION)
+    return svn_error_createf (SVN_ERR_REPOS_BAD_DUMP_VERSION, 0, NULL, pool,
+                              "load: dump format version %s", version);
+  svn_pool_clear (subpool);
+
+  while (1)
+    {
+      SVN_ERR (read_header_block (&headers, r, subpool));
+      if (! headers)
+        break;
+
+      if (apr_hash_get (headers, SVN_REPOS_DUMPFILE_REVISION_NUMBER,
+                        APR_HASH_KEY_STRING))
+        {
+          SVN_ERR (finish_revision (lb, subpool));
+          svn_pool_clear (rev_pool);
+          SVN_ERR (start_revision (lb, headers, rev_pool));
+        }
+      else if (apr_hash_get (headers, SVN_REPOS_DUMPFILE_NODE_PATH,
+                             APR_HASH_KEY_STRING))
+        {
+          SVN_ERR (load_node (lb, headers, subpool));
+        }
+      else
+        {
+          /* A record type from a newer format; skip it. */
+          long len = header_number (headers,
+                                    SVN_REPOS_DUMPFILE_CONTENT_LENGTH);
+          if (len > 0)
+            SVN_ERR (read_bytes (NULL, len, r, subpool));
+        }
+
+      svn_pool_clear (subpool);
+    }
+
+  return finish_revision (lb, subpool);
+}
+
+
+/* Load DUMPSTREAM into REPOS, as for svn_repos_load_fs().  If
+   REPLICATING, number the revisions as in the stream and take copies
+   from revisions before it as they are; see svn_repos__load_replica(). */
+static svn_error_t *
+load_stream (svn_repos_t *repos,
+             svn_stream_t *dumpstream,
+             svn_stream_t *feedback_stream,
+             svn_boolean_t replicating,
+             apr_pool_t *pool)
+{
+  struct load_baton lb;
+  struct reader r;
+  svn_error_t *err;
+  apr_pool_t *rev_pool = svn_pool_create (pool);
+  apr_pool_t *subpool = svn_pool_create (pool);
+
+  r.stream = dumpstream;
+  r.buf = apr_palloc (pool, SVN_STREAM_CHUNK_SIZE);
+  r.start = r.end = 0;
+  r.eof = FALSE;
+
+  memset (&lb, 0, sizeof (lb));
+  lb.reader = &r;
+  lb.fs = svn_repos_fs (repos);
+  lb.feedback_stream = feedback_stream;
+  lb.rev_map = apr_hash_make (pool);
+  lb.replicating = replicating;
+  lb.rev = SVN_INVALID_REVNUM;
+  lb.pool = pool;
+
+  err = load_records (&lb, rev_pool, subpool, pool);
+
+  /* Don't leave the revision we were in the middle of behind as a
+     dead transaction; the error we already have is the one to
+     report. */
+  if (err && lb.txn)
+    svn_error_clear_all (svn_fs_abort_txn (lb.txn));
+
+  svn_pool_destroy (subpool);
+  svn_pool_destroy (rev_pool);
+  return err;
+}
+
+
+svn_error_t *
+svn_repos_load_fs (svn_repos_t *repos,
+                   svn_stream_t *dumpstream,
+                   svn_stream_t *feedback_stream,
+                   apr_pool_t *pool)
+{
+  if (repos->replica_of)
+    return svn_repos__read_only_error (repos, pool);
+
+  return load_stream (repos, dumpstream, feedback_stream, FALSE, pool);
+}
+
+
+svn_error_t *
+svn_repos__load_replica (svn_repos_t *repos,
+                         svn_stream_t *dumpstream,
+                         svn_stream_t *feedback_stream,
+                         apr_pool_t *pool)
+{
+  return load_stream (repos, dumpstream, feedback_stream, TRUE, pool);
+}
+
+
+
+/*
+ * local variables:
+ * eval: (load-file "../../tools/dev/svn-dev.el")
+ * end:
+ */
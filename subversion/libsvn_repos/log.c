@@ -90,11 +90,46 @@ detect_changed (apr_hash_t *changed,
 }
 
 
+svn_error_t *
+svn_repos__changed_paths (apr_hash_t **changed,
+                          svn_repos_t *repos,
+                          svn_fs_root_t *base_root,
+                          svn_fs_root_t *root,
+                          apr_pool_t *pool)
+{
+  const svn_delta_edit_fns_t *editor;
+  void *edit_baton;
+  apr_pool_t *subpool = svn_pool_create (pool);
+
+  /* Use a dir_deltas run with the node editor between the two roots
+     to see what changed.
+
+     ### todo: not sure this needs an editor and dir_deltas.  Might
+     be easier to just walk the one revision tree, looking at
+     created-rev fields... */
+  *changed = apr_hash_make (pool);
+  SVN_ERR (svn_repos_node_editor (&editor, &edit_baton, repos,
+                                  base_root, root, subpool, subpool));
+  SVN_ERR (svn_repos_dir_delta (base_root, "", NULL, NULL, root, "",
+                                editor, edit_baton,
+                                FALSE, TRUE, FALSE, subpool));
+
+  /* ### Feels slightly bogus to assume "/" as the right start for
+     repository style. */
+  detect_changed (*changed, svn_repos_node_from_baton (edit_baton),
+                  svn_stringbuf_create ("/", subpool), pool);
+
+  svn_pool_destroy (subpool);
+  return SVN_NO_ERROR;
+}
+
+
 svn_error_t *
 svn_repos_get_logs (svn_repos_t *repos,
                     const apr_array_header_t *paths,
                     svn_revnum_t start,
                     svn_revnum_t end,
+                    int limit,
                     svn_boolean_t discover_changed_paths,
                     svn_log_message_receiver_t receiver,
                     void *receiver_baton,
@@ -105,6 +140,7 @@ svn_repos_get_logs (svn_repos_t *repos,
   apr_hash_t *changed_paths = NULL;
   svn_fs_t *fs = repos->fs;
   apr_array_header_t *revs = NULL;
+  svn_revnum_t count, sent;
 
   /* If no START revision was given, use HEAD. */
   if (! SVN_IS_VALID_REVNUM (start))
@@ -142,8 +178,14 @@ svn_repos_get_logs (svn_repos_t *repos,
       SVN_ERR (svn_fs_revision_root (&rev_root, fs, 
                                      (start > end) ? start : end, pool));
 
-      /* And the search is on... */
-      SVN_ERR (svn_fs_revisions_changed (&revs, rev_root, cpaths, pool));
+      /* And the search is on...  It need go no further back than the
+         older end of the range.  When the youngest revisions are
+         wanted first, it can also stop once it has found LIMIT of
+         them; going the other way, the ones we want are found last.  */
+      SVN_ERR (svn_fs_revisions_changed (&revs, rev_root, cpaths,
+                                         (start > end) ? end : start,
+                                         (start >= end) ? limit : 0,
+                                         pool));
 
       /* If no revisions were found for these entries, we have nothing
          to show. Just return now before we break a sweat.  */
@@ -151,26 +193,24 @@ svn_repos_get_logs (svn_repos_t *repos,
         return SVN_NO_ERROR;
     }
 
-  for (this_rev = start;
-       ((start >= end) ? (this_rev >= end) : (this_rev <= end));
-       ((start >= end) ? this_rev-- : this_rev++))
+  /* Visit the revisions in the range, or just the ones the paths were
+     changed in if we have a list of those.  The list is youngest
+     first, and all within the range.  */
+  if (revs)
+    count = revs->nelts;
+  else
+    count = ((start >= end) ? (start - end) : (end - start)) + 1;
+
+  for (sent = 0; (sent < count) && ((limit == 0) || (sent < limit)); sent++)
     {
       svn_string_t *author, *date, *message;
 
-      /* If we have a list of revs for use, check to make sure this is
-         one of them.  */
       if (revs)
-        {
-          int i, matched = 0;
-          for (i = 0; ((i < revs->nelts) && (! matched)); i++)
-            {
-              if (this_rev == ((svn_revnum_t *)(revs->elts))[i])
-                matched = 1;
-            }
-
-          if (! matched)
-            continue;
-	}
+        this_rev = APR_ARRAY_IDX (revs,
+                                  (start >= end) ? sent : count - 1 - sent,
+                                  svn_revnum_t);
+      else
+        this_rev = (start >= end) ? start - sent : start + sent;
 
       SVN_ERR (svn_fs_revision_prop
                (&author, fs, this_rev, SVN_PROP_REVISION_AUTHOR, subpool));
@@ -189,34 +229,14 @@ svn_repos_get_logs (svn_repos_t *repos,
       if ((this_rev > 0) && 
           (discover_changed_paths || (paths && paths->nelts > 0)))
         {
-          const svn_delta_edit_fns_t *editor;
           svn_fs_root_t *oldroot, *newroot;
-          void *edit_baton;
 
-          changed_paths = apr_hash_make (subpool);
-          
-          /* Use a dir_deltas run with the node editor between the
-             current revision and its immediate predecessor to see
-             what changed in this revision.
-
-             ### todo: not sure this needs an editor and dir_deltas.
-             Might be easier to just walk the one revision tree,
-             looking at created-rev fields... */
+          /* See what changed between the current revision and its
+             immediate predecessor. */
           SVN_ERR (svn_fs_revision_root (&oldroot, fs, this_rev - 1, subpool));
           SVN_ERR (svn_fs_revision_root (&newroot, fs, this_rev, subpool));
-          SVN_ERR (svn_repos_node_editor (&editor, &edit_baton, fs,
-                                          oldroot, newroot, subpool, subpool));
-          SVN_ERR (svn_repos_dir_delta (oldroot, "", NULL, NULL,
-                                        newroot, "",
-                                        editor, edit_baton,
-                                        FALSE, TRUE, FALSE, subpool));
-          detect_changed (changed_paths,
-                          svn_repos_node_from_baton (edit_baton),
-                          svn_stringbuf_create ("/", subpool),
-                          subpool);
-
-          /* ### Feels slightly bogus to assume "/" as the right start
-             for repository style. */
+          SVN_ERR (svn_repos__changed_paths (&changed_paths, repos,
+                                             oldroot, newroot, subpool));
         }
 
 #endif /* SVN_REPOS_ALLOW_LOG_WITH_PATHS */
@@ -227,7 +247,7 @@ svn_repos_get_logs (svn_repos_t *repos,
                             author ? author->data : "",
                             date ? date->data : "",
                             message ? message->data : ""));
-      
+
       svn_pool_clear (subpool);
     }
 
@@ -0,0 +1,307 @@
+/* replicate.c --- feeding read-only replicas from a master's commits
+ *
+ * ====================================================================
+ * Copyright (c) 2000-2002 CollabNet.  All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.  The terms
+ * are also available at http://subversion.tigris.org/license-1.html.
+ * If newer versions of this license are posted there, you may use a
+ * newer version instead, at your option.
+ *
+ * This software consists of voluntary contributions made by many
+ * individuals.  For exact contribution history, see the revision
+ * history and logs, available at http://subversion.tigris.org/.
+ * ====================================================================
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "apr_pools.h"
+#include "apr_file_io.h"
+#include "apr_hash.h"
+
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_io.h"
+#include "svn_fs.h"
+#include "svn_repos.h"
+#include "repos.h"
+
+
+
+/*** The master's side. ***/
+
+svn_error_t *
+svn_repos__read_only_error (svn_repos_t *repos, apr_pool_t *pool)
+{
+  return svn_error_createf (SVN_ERR_REPOS_READ_ONLY, 0, NULL, pool,
+                            "`%s' is a read-only replica of `%s'",
+                            repos->path, repos->replica_of);
+}
+
+
+svn_error_t *
+svn_repos__spool_revision (svn_repos_t *repos,
+                           svn_revnum_t rev,
+                           apr_pool_t *pool)
+{
+  const char *dir = apr_psprintf (pool, "%s/%s", repos->path,
+                                  SVN_REPOS__SPOOL_DIR);
+  const char *path, *tmp_path;
+  enum svn_node_kind kind;
+  apr_file_t *f;
+  svn_stream_t *stream;
+  apr_status_t apr_err;
+
+  /* No spool, no replicas. */
+  SVN_ERR (svn_io_check_path (dir, &kind, pool));
+  if (kind != svn_node_dir)
+    return SVN_NO_ERROR;
+
+  /* Replicas take entries as soon as they appear, so write each one
+     under another name and rename it when it's complete.  */
+  path = apr_psprintf (pool, "%s/%ld", dir, (long) rev);
+  tmp_path = apr_pstrcat (pool, path, SVN_REPOS__SPOOL_TMP_EXT, NULL);
+
+  apr_err = apr_file_open (&f, tmp_path,
+                           (APR_WRITE | APR_CREATE | APR_TRUNCATE),
+                           APR_OS_DEFAULT, pool);
+  if (apr_err)
+    return svn_error_createf (apr_err, 0, NULL, pool,
+                              "creating spool entry `%s'", tmp_path);
+
+  stream = svn_stream_from_aprfile (f, pool);
+  SVN_ERR (svn_repos__dump_incremental (repos, stream, rev, rev, pool));
+
+  apr_err = apr_file_close (f);
+  if (apr_err)
+    return svn_error_createf (apr_err, 0, NULL, pool,
+                              "closing spool entry `%s'", tmp_path);
+
+  apr_err = apr_file_rename (tmp_path, path, pool);
+  if (apr_err)
+    return svn_error_createf (apr_err, 0, NULL, pool,
+                              "renaming spool entry `%s'", tmp_path);
+
+  return SVN_NO_ERROR;
+}
+
+
+svn_error_t *
+svn_repos_spool_revisions (svn_repos_t *repos,
+                           svn_revnum_t start_rev,
+                           svn_revnum_t end_rev,
+                           apr_pool_t *pool)
+{
+  const char *dir = apr_psprintf (pool, "%s/%s", repos->path,
+                                  SVN_REPOS__SPOOL_DIR);
+  apr_pool_t *subpool;
+  svn_revnum_t youngest, rev;
+  apr_status_t apr_err;
+
+  if (repos->replica_of)
+    return svn_repos__read_only_error (repos, pool);
+
+  apr_err = apr_dir_make (dir, APR_OS_DEFAULT, pool);
+  if (apr_err && ! APR_STATUS_IS_EEXIST (apr_err))
+    return svn_error_createf (apr_err, 0, NULL, pool,
+                              "creating spool dir `%s'", dir);
+
+  SVN_ERR (svn_fs_youngest_rev (&youngest, repos->fs, pool));
+  if (! SVN_IS_VALID_REVNUM (start_rev))
+    start_rev = 1;
+  if (! SVN_IS_VALID_REVNUM (end_rev))
+    end_rev = youngest;
+
+  if (start_rev < 1 || start_rev > end_rev || end_rev > youngest)
+    return svn_error_createf (SVN_ERR_INCORRECT_PARAMS, 0, NULL, pool,
+                              "can't spool revisions %ld through %ld; "
+                              "the youngest revision is %ld",
+                              (long) start_rev, (long) end_rev,
+                              (long) youngest);
+
+  subpool = svn_pool_create (pool);
+  for (rev = start_rev; rev <= end_rev; rev++)
+    {
+      SVN_ERR (svn_repos__spool_revision (repos, rev, subpool));
+      svn_pool_clear (subpool);
+    }
+  svn_pool_destroy (subpool);
+
+  return SVN_NO_ERROR;
+}
+
+
+
+/*** The replica's side. ***/
+
+/* Create a new, empty replica of the spool SPOOL_PATH at
+   REPLICA_PATH, and open it in *REPOS_P.  Use POOL for all
+   allocations.  */
+static svn_error_t *
+create_replica (svn_repos_t **repos_p,
+                const char *spool_path,
+                const char *replica_path,
+                apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  const char *marker = apr_psprintf (pool, "%s/%s", replica_path,
+                                     SVN_REPOS__REPLICA);
+  const char *contents = apr_pstrcat (pool, spool_path, "\n", NULL);
+  apr_file_t *f;
+  apr_size_t written;
+  apr_status_t apr_err;
+
+  SVN_ERR (svn_repos_create (&repos, replica_path, pool));
+
+  apr_err = apr_file_open (&f, marker,
+                           (APR_WRITE | APR_CREATE | APR_TRUNCATE),
+                           APR_OS_DEFAULT, pool);
+  if (apr_err)
+    return svn_error_createf (apr_err, 0, NULL, pool,
+                              "creating replica marker `%s'", marker);
+
+  apr_err = apr_file_write_full (f, contents, strlen (contents), &written);
+  if (apr_err)
+    return svn_error_createf (apr_err, 0, NULL, pool,
+                              "writing replica marker `%s'", marker);
+
+  apr_err = apr_file_close (f);
+  if (apr_err)
+    return svn_error_createf (apr_err, 0, NULL, pool,
+                              "closing replica marker `%s'", marker);
+
+  repos->replica_of = apr_pstrdup (pool, spool_path);
+  *repos_p = repos;
+  return SVN_NO_ERROR;
+}
+
+
+svn_error_t *
+svn_repos_replicate (svn_revnum_t *youngest_p,
+                     const char *spool_path,
+                     const char *replica_path,
+                     svn_stream_t *feedback_stream,
+                     apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  enum svn_node_kind kind;
+  apr_pool_t *lockpool, *subpool;
+  const char *lockfile_path;
+  apr_file_t *lockfile_handle;
+  svn_revnum_t youngest;
+  apr_status_t apr_err;
+
+  SVN_ERR (svn_io_check_path (replica_path, &kind, pool));
+  if (kind == svn_node_none)
+    SVN_ERR (create_replica (&repos, spool_path, replica_path, pool));
+  else
+    {
+      SVN_ERR (svn_repos_open (&repos, replica_path, pool));
+      if (! repos->replica_of)
+        return svn_error_createf (SVN_ERR_REPOS_NOT_REPLICA, 0, NULL, pool,
+                                  "`%s' is not a replica", replica_path);
+    }
+
+  /* One replication at a time; the lock goes when LOCKPOOL does. */
+  lockpool = svn_pool_create (pool);
+  lockfile_path = apr_psprintf (lockpool, "%s/%s/%s", replica_path,
+                                SVN_REPOS__LOCK_DIR,
+                                SVN_REPOS__REPLICATE_LOCKFILE);
+  apr_err = apr_file_open (&lockfile_handle, lockfile_path,
+                           (APR_WRITE | APR_CREATE), APR_OS_DEFAULT,
+                           lockpool);
+  if (apr_err)
+    return svn_error_createf (apr_err, 0, NULL, pool,
+                              "svn_repos_replicate: error opening "
+                              "lockfile `%s'", lockfile_path);
+
+  apr_err = apr_file_lock (lockfile_handle, APR_FLOCK_EXCLUSIVE);
+  if (apr_err)
+    return svn_error_createf (apr_err, 0, NULL, pool,
+                              "svn_repos_replicate: exclusive lock on "
+                              "`%s' failed", replica_path);
+
+  /* Load each revision the replica lacks, until the spool runs out. */
+  subpool = svn_pool_create (pool);
+  for (;;)
+    {
+      const char *path;
+      apr_file_t *f;
+
+      SVN_ERR (svn_fs_youngest_rev (&youngest, repos->fs, subpool));
+      path = apr_psprintf (subpool, "%s/%ld", spool_path,
+                           (long) (youngest + 1));
+      SVN_ERR (svn_io_check_path (path, &kind, subpool));
+      if (kind != svn_node_file)
+        break;
+
+      apr_err = apr_file_open (&f, path, APR_READ, APR_OS_DEFAULT, subpool);
+      if (apr_err)
+        return svn_error_createf (apr_err, 0, NULL, pool,
+                                  "opening spool entry `%s'", path);
+
+      SVN_ERR (svn_repos__load_replica (repos,
+                                        svn_stream_from_aprfile (f, subpool),
+                                        feedback_stream, subpool));
+
+      apr_err = apr_file_close (f);
+      if (apr_err)
+        return svn_error_createf (apr_err, 0, NULL, pool,
+                                  "closing spool entry `%s'", path);
+
+      svn_pool_clear (subpool);
+    }
+  svn_pool_destroy (subpool);
+  svn_pool_destroy (lockpool);
+
+  *youngest_p = youngest;
+  return SVN_NO_ERROR;
+}
+
+
+svn_error_t *
+svn_repos_prune_spool (const char *spool_path,
+                       svn_revnum_t through_rev,
+                       apr_pool_t *pool)
+{
+  apr_hash_t *dirents;
+  apr_hash_index_t *hi;
+  apr_pool_t *subpool = svn_pool_create (pool);
+
+  SVN_ERR (svn_io_get_dirents (&dirents, svn_stringbuf_create (spool_path,
+                                                               pool),
+                               pool));
+
+  for (hi = apr_hash_first (pool, dirents); hi; hi = apr_hash_next (hi))
+    {
+      const void *key;
+      const char *name;
+
+      apr_hash_this (hi, &key, NULL, NULL);
+      name = key;
+
+      /* Leave alone anything that isn't a finished entry. */
+      if (name[strspn (name, "0123456789")] != '\0')
+        continue;
+
+      if (SVN_STR_TO_REV (name) <= through_rev)
+        SVN_ERR (svn_io_remove_file (apr_psprintf (subpool, "%s/%s",
+                                                   spool_path, name),
+                                     subpool));
+      svn_pool_clear (subpool);
+    }
+
+  svn_pool_destroy (subpool);
+  return SVN_NO_ERROR;
+}
+
+
+
+/*
+ * local variables:
+ * eval: (load-file "../../tools/dev/svn-dev.el")
+ * end:
+ */
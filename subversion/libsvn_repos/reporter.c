@@ -16,6 +16,10 @@
  * ====================================================================
  */
 
+#include <stdlib.h>
+#include <string.h>
+
+#include "apr_strings.h"
 #include "svn_path.h"
 #include "svn_fs.h"
 #include "svn_repos.h"
@@ -25,13 +29,10 @@
    driven by the client as it describes its working copy revisions. */
 typedef struct svn_repos_report_baton_t
 {
-  /* The transaction being built in the repository, a mirror of the
-     working copy. */
+  /* The repository being reported against. */
   svn_repos_t *repos;
-  svn_fs_txn_t *txn;
-  svn_fs_root_t *txn_root;
 
-  /* Which user is doing the update (building the temporary txn) */
+  /* Which user is doing the update */
   const char *username;
 
   /* The fs path under which all reporting will happen */
@@ -41,7 +42,7 @@ typedef struct svn_repos_report_baton_t
   svn_stringbuf_t *target;
 
   /* -- These items are used by finish_report() when it calls
-        svn_repos_dir_delta(): --  */
+        svn_repos__dir_delta_report(): --  */
 
   /* whether or not to generate text-deltas */
   svn_boolean_t text_deltas; 
@@ -61,9 +62,11 @@ typedef struct svn_repos_report_baton_t
   const svn_delta_edit_fns_t *update_editor;
   void *update_edit_baton; 
 
-  /* This hash describes the mixed revisions in the transaction; it
-     maps pathnames (char *) to revision numbers (svn_revnum_t). */
-  apr_hash_t *path_rev_hash;
+  /* The working copy as reported so far: maps full fs paths (without
+     leading slashes) to svn_repos__report_path_t *.  The root of the
+     report is the empty path.  A later report of a path replaces an
+     earlier one. */
+  apr_hash_t *reported_paths;
 
   /* Pool from the session baton. */
   apr_pool_t *pool;
@@ -71,18 +74,58 @@ typedef struct svn_repos_report_baton_t
 } svn_repos_report_baton_t;
 
 
+/* Return the full fs path described by PATH, relative to the target
+   of the report in RBATON, without leading slashes. */
+static const char *
+full_report_path (svn_repos_report_baton_t *rbaton, const char *path)
+{
+  /* The path we are dealing with is the anchor (where the reporter
+     is rooted) + target (the top-level thing being reported) + path
+     (stuff relative to the target...this is the empty string in the
+     file case since the target is the file itself, not a directory
+     containing the file). */
+  svn_stringbuf_t *full_path = svn_stringbuf_create (rbaton->base_path,
+                                                     rbaton->pool);
+  const char *key;
+
+  if (rbaton->target)
+    svn_path_add_component (full_path, rbaton->target);
+  svn_path_add_component_nts (full_path, path);
+
+  for (key = full_path->data; *key == '/'; key++)
+    ;
+  return key;
+}
+
+
+/* Record that the working copy has PATH (a full fs path, as returned
+   by full_report_path) at REVISION, or that it is missing PATH if
+   DELETED. */
+static void
+record_path (svn_repos_report_baton_t *rbaton,
+             const char *path,
+             svn_revnum_t revision,
+             svn_boolean_t deleted)
+{
+  svn_repos__report_path_t *rp = apr_palloc (rbaton->pool, sizeof (*rp));
+
+  rp->path = path;
+  rp->revision = revision;
+  rp->deleted = deleted;
+  apr_hash_set (rbaton->reported_paths, rp->path, APR_HASH_KEY_STRING, rp);
+}
+
+
 svn_error_t *
 svn_repos_set_path (void *report_baton,
                     const char *path,
                     svn_revnum_t revision)
 {
-  svn_fs_root_t *from_root;
-  svn_stringbuf_t *from_path;
   svn_repos_report_baton_t *rbaton = report_baton;
-  svn_revnum_t *rev_ptr = apr_palloc (rbaton->pool, sizeof(*rev_ptr));
 
-  /* If this is the very first call, no txn exists yet. */
-  if (! rbaton->txn)
+  /* If this is the very first call, set the base revision of the
+     whole report. */
+  if (apr_hash_count (rbaton->reported_paths) == 0)
     {
       /* ### need to change svn_path_is_empty() */
       svn_stringbuf_t *pathbuf = svn_stringbuf_create (path, rbaton->pool);
@@ -95,46 +138,11 @@ svn_repos_set_path (void *report_baton,
           (SVN_ERR_RA_BAD_REVISION_REPORT, 0, NULL, rbaton->pool,
            "svn_repos_set_path: initial revision report was bogus.");
 
-      /* Start a transaction based on REVISION. */
-      SVN_ERR (svn_repos_fs_begin_txn_for_update (&(rbaton->txn),
-                                                  rbaton->repos,
-                                                  revision,
-                                                  rbaton->username,
-                                                  rbaton->pool));
-      SVN_ERR (svn_fs_txn_root (&(rbaton->txn_root), rbaton->txn,
-                                rbaton->pool));
-      
-      /* In our hash, map the root of the txn ("") to the initial base
-         revision. */
-      *rev_ptr = revision;
-      apr_hash_set (rbaton->path_rev_hash, "", APR_HASH_KEY_STRING, rev_ptr);
+      record_path (rbaton, "", revision, FALSE);
     }
-
   else  /* this is not the first call to set_path. */ 
     {
-      /* Create the "from" root and path. */
-      SVN_ERR (svn_fs_revision_root (&from_root, rbaton->repos->fs,
-                                     revision, rbaton->pool));
-
-      /* The path we are dealing with is the anchor (where the
-         reporter is rooted) + target (the top-level thing being
-         reported) + path (stuff relative to the target...this is the
-         empty string in the file case since the target is the file
-         itself, not a directory containing the file). */
-      from_path = svn_stringbuf_create (rbaton->base_path, rbaton->pool);
-      if (rbaton->target)
-        svn_path_add_component (from_path, rbaton->target);
-      svn_path_add_component_nts (from_path, path);
-
-      /* Copy into our txn. */
-      SVN_ERR (svn_fs_link (from_root, from_path->data,
-                            rbaton->txn_root, from_path->data, rbaton->pool));
-      
-      /* Remember this path in our hashtable. */
-      *rev_ptr = revision;
-      apr_hash_set (rbaton->path_rev_hash, from_path->data,
-                    from_path->len, rev_ptr);    
-
+      record_path (rbaton, full_report_path (rbaton, path), revision, FALSE);
     }
 
   return SVN_NO_ERROR;
@@ -146,42 +154,59 @@ svn_error_t *
 svn_repos_delete_path (void *report_baton,
                        const char *path)
 {
-  svn_stringbuf_t *delete_path;
   svn_repos_report_baton_t *rbaton = report_baton;
-  
-  /* The path we are dealing with is the anchor (where the
-     reporter is rooted) + target (the top-level thing being
-     reported) + path (stuff relative to the target...this is the
-     empty string in the file case since the target is the file
-     itself, not a directory containing the file). */
-  delete_path = svn_stringbuf_create (rbaton->base_path, rbaton->pool);
-  if (rbaton->target)
-    svn_path_add_component (delete_path, rbaton->target);
-  svn_path_add_component_nts (delete_path, path);
-
-
-  /* Remove the file or directory (recursively) from the txn. */
-  SVN_ERR (svn_fs_delete_tree (rbaton->txn_root, delete_path->data, 
-                               rbaton->pool));
 
+  record_path (rbaton, full_report_path (rbaton, path),
+               SVN_INVALID_REVNUM, TRUE);
   return SVN_NO_ERROR;
 }
 
 
 
+/* qsort comparison for an array of svn_repos__report_path_t *. */
+static int
+compare_report_paths (const void *a, const void *b)
+{
+  const svn_repos__report_path_t *rp_a
+    = *((const svn_repos__report_path_t * const *) a);
+  const svn_repos__report_path_t *rp_b
+    = *((const svn_repos__report_path_t * const *) b);
+
+  return strcmp (rp_a->path, rp_b->path);
+}
+
 
 svn_error_t *
 svn_repos_finish_report (void *report_baton)
 {
   svn_fs_root_t *rev_root;
   svn_repos_report_baton_t *rbaton = (svn_repos_report_baton_t *) report_baton;
+  apr_array_header_t *report_paths;
+  apr_hash_index_t *hi;
 
   /* If nothing was described, then we have an error */
-  if (rbaton->txn == NULL)
+  if (apr_hash_count (rbaton->reported_paths) == 0)
     return svn_error_create(SVN_ERR_REPOS_NO_DATA_FOR_REPORT, 0, NULL,
                             rbaton->pool,
-                            "svn_repos_finish_report: no transaction was "
-                            "present, meaning no data was provided.");
+                            "svn_repos_finish_report: no revisions were "
+                            "reported, meaning no data was provided.");
+
+  /* Sort the report, so dir_delta can find the paths reported in and
+     under each directory quickly. */
+  report_paths = apr_array_make (rbaton->pool,
+                                 apr_hash_count (rbaton->reported_paths),
+                                 sizeof (svn_repos__report_path_t *));
+  for (hi = apr_hash_first (rbaton->pool, rbaton->reported_paths);
+       hi;
+       hi = apr_hash_next (hi))
+    {
+      void *val;
+
+      apr_hash_this (hi, NULL, NULL, &val);
+      (*((svn_repos__report_path_t **) apr_array_push (report_paths))) = val;
+    }
+  qsort (report_paths->elts, report_paths->nelts, report_paths->elt_size,
+         compare_report_paths);
 
   /* Get the root of the revision we want to update to. */
   SVN_ERR (svn_fs_revision_root (&rev_root, rbaton->repos->fs,
@@ -189,22 +214,19 @@ svn_repos_finish_report (void *report_baton)
                                  rbaton->pool));
 
   /* Drive the update-editor. */
-  SVN_ERR (svn_repos_dir_delta (rbaton->txn_root, 
-                                rbaton->base_path, 
-                                rbaton->target ? 
-                                rbaton->target->data : NULL,
-                                rbaton->path_rev_hash,
-                                rev_root, 
-                                rbaton->tgt_path,
-                                rbaton->update_editor,
-                                rbaton->update_edit_baton,
-                                rbaton->text_deltas,
-                                rbaton->recurse,
-                                FALSE,
-                                rbaton->pool));
-  
-  /* Still here?  Great!  Throw out the transaction. */
-  SVN_ERR (svn_fs_abort_txn (rbaton->txn));
+  SVN_ERR (svn_repos__dir_delta_report (rbaton->repos->fs,
+                                        report_paths,
+                                        rbaton->base_path, 
+                                        rbaton->target ? 
+                                        rbaton->target->data : NULL,
+                                        rev_root, 
+                                        rbaton->tgt_path,
+                                        rbaton->update_editor,
+                                        rbaton->update_edit_baton,
+                                        rbaton->text_deltas,
+                                        rbaton->recurse,
+                                        rbaton->repos,
+                                        rbaton->pool));
 
   return SVN_NO_ERROR;
 }
@@ -214,14 +236,7 @@ svn_repos_finish_report (void *report_baton)
 svn_error_t *
 svn_repos_abort_report (void *report_baton)
 {
-  svn_repos_report_baton_t *rbaton = (svn_repos_report_baton_t *) report_baton;
-
-  /* if we have a transaction, then abort it */
-  if (rbaton->txn != NULL)
-    {
-      SVN_ERR (svn_fs_abort_txn (rbaton->txn));
-    }
-
+  /* The report lives only in memory, so there is nothing to undo. */
   return SVN_NO_ERROR;
 }
 
@@ -249,7 +264,7 @@ svn_repos_begin_report (void **report_baton,
   rbaton->revnum_to_update_to = revnum;
   rbaton->update_editor = editor;
   rbaton->update_edit_baton = edit_baton;
-  rbaton->path_rev_hash = apr_hash_make (pool);
+  rbaton->reported_paths = apr_hash_make (pool);
   rbaton->repos = repos;
   rbaton->text_deltas = text_deltas;
   rbaton->recurse = recurse;
@@ -21,6 +21,7 @@
 #include "svn_pools.h"
 #include "svn_error.h"
 #include "svn_path.h"
+#include "svn_io.h"
 #include "svn_fs.h"
 #include "svn_repos.h"
 #include "repos.h"
@@ -119,6 +120,15 @@ svn_repos_write_sentinel_hook (svn_repos_t *repos, apr_pool_t *pool)
 }
 
 
+const char *
+svn_repos_hook_plugin (svn_repos_t *repos, apr_pool_t *pool)
+{
+  return apr_pstrcat (pool,
+                      repos->hook_path, "/" SVN_REPOS__HOOK_PLUGIN,
+                      NULL);
+}
+
+
 static svn_error_t *
 create_locks (svn_repos_t *repos, const char *path, apr_pool_t *pool)
 {
@@ -369,6 +379,10 @@ create_hooks (svn_repos_t *repos, const char *path, apr_pool_t *pool)
       "# can use the `svnlook' utility to help it examine the\n"
       "# newly-committed tree.\n"
       "#\n"
+      "# If the server queues post-commit hooks instead of running them\n"
+      "# (see `svnadmin runhooks'), a non-zero exit code means the hook\n"
+      "# will be run again later.\n"
+      "#\n"
       "# On a Unix system, the normal procedure is to have "
       "`"
       SVN_REPOS__HOOK_POST_COMMIT
@@ -680,6 +694,23 @@ svn_repos_open (svn_repos_t **repos_p,
                                apr_pool_cleanup_null);
   }
 
+  /* Is this a read-only replica? */
+  {
+    const char *replica_file
+      = apr_psprintf (pool, "%s/%s", path, SVN_REPOS__REPLICA);
+    enum svn_node_kind kind;
+
+    SVN_ERR (svn_io_check_path (replica_file, &kind, pool));
+    if (kind == svn_node_file)
+      {
+        svn_stringbuf_t *spool_path;
+
+        SVN_ERR (svn_string_from_file (&spool_path, replica_file, pool));
+        svn_stringbuf_strip_whitespace (spool_path);
+        repos->replica_of = spool_path->data;
+      }
+  }
+
   *repos_p = repos;
   return SVN_NO_ERROR;
 }
@@ -705,6 +736,102 @@ svn_repos_delete (const char *path,
 }
 
 
+/* Copy the directory NAME in the repository at SRC_PATH into the new
+   repository at DST_PATH.  Use POOL for all allocations.  */
+static svn_error_t *
+hotcopy_dir (const char *src_path,
+             const char *dst_path,
+             const char *name,
+             apr_pool_t *pool)
+{
+  return svn_io_copy_dir_recursively
+    (svn_stringbuf_createf (pool, "%s/%s", src_path, name),
+     svn_stringbuf_create (dst_path, pool),
+     svn_stringbuf_create (name, pool),
+     TRUE, pool);
+}
+
+
+svn_error_t *
+svn_repos_hotcopy (const char *src_path,
+                   const char *dst_path,
+                   svn_boolean_t incremental,
+                   apr_pool_t *pool)
+{
+  svn_repos_t *src_repos;
+  apr_pool_t *subpool = svn_pool_create (pool);
+  apr_status_t apr_err;
+  const char *dst_db_path
+    = apr_psprintf (pool, "%s/%s", dst_path, SVN_REPOS__DB_DIR);
+
+  /* A shared lock on the source, like any other accessor. */
+  SVN_ERR (svn_repos_open (&src_repos, src_path, pool));
+
+  if (incremental)
+    {
+      /* Keep everyone else out of the copy while its logs are
+         replayed; the lock goes when SUBPOOL does.  */
+      apr_file_t *lockfile_handle;
+      const char *lockfile_path
+        = apr_psprintf (subpool, "%s/%s/%s", dst_path,
+                        SVN_REPOS__LOCK_DIR, SVN_REPOS__DB_LOCKFILE);
+
+      apr_err = apr_file_open (&lockfile_handle, lockfile_path,
+                               (APR_WRITE | APR_APPEND), APR_OS_DEFAULT,
+                               subpool);
+      if (! APR_STATUS_IS_SUCCESS (apr_err))
+        return svn_error_createf
+          (apr_err, 0, NULL, pool,
+           "svn_repos_hotcopy: error opening db lockfile `%s'",
+           lockfile_path);
+
+      apr_err = apr_file_lock (lockfile_handle, APR_FLOCK_EXCLUSIVE);
+      if (! APR_STATUS_IS_SUCCESS (apr_err))
+        return svn_error_createf
+          (apr_err, 0, NULL, pool,
+           "svn_repos_hotcopy: exclusive db lock on `%s' failed",
+           dst_path);
+
+      apr_pool_cleanup_register (subpool, lockfile_handle, clear_and_close,
+                                 apr_pool_cleanup_null);
+    }
+  else
+    {
+      apr_err = apr_dir_make (dst_path, APR_OS_DEFAULT, pool);
+      if (! APR_STATUS_IS_SUCCESS (apr_err)
+          && ! (APR_STATUS_IS_EEXIST (apr_err)
+                && APR_STATUS_IS_SUCCESS (apr_check_dir_empty (dst_path,
+                                                               pool))))
+        return svn_error_createf
+          (apr_err, 0, 0, pool,
+           "unable to create hot copy `%s'", dst_path);
+
+      /* Everything but the database is just files. */
+      SVN_ERR (svn_io_copy_file
+               (apr_psprintf (pool, "%s/%s", src_path, SVN_REPOS__README),
+                apr_psprintf (pool, "%s/%s", dst_path, SVN_REPOS__README),
+                TRUE, pool));
+      SVN_ERR (hotcopy_dir (src_path, dst_path, SVN_REPOS__DAV_DIR, pool));
+      SVN_ERR (hotcopy_dir (src_path, dst_path, SVN_REPOS__CONF_DIR, pool));
+      SVN_ERR (hotcopy_dir (src_path, dst_path, SVN_REPOS__LOCK_DIR, pool));
+      SVN_ERR (hotcopy_dir (src_path, dst_path, SVN_REPOS__HOOK_DIR, pool));
+
+      /* A copy of a replica is a replica of the same master. */
+      if (src_repos->replica_of)
+        SVN_ERR (svn_io_copy_file
+                 (apr_psprintf (pool, "%s/%s", src_path, SVN_REPOS__REPLICA),
+                  apr_psprintf (pool, "%s/%s", dst_path, SVN_REPOS__REPLICA),
+                  TRUE, pool));
+    }
+
+  SVN_ERR (svn_fs_hotcopy_berkeley (src_repos->fs, dst_db_path,
+                                    incremental, pool));
+
+  svn_pool_destroy (subpool);
+  return SVN_NO_ERROR;
+}
+
+
 svn_error_t *
 svn_repos_close (svn_repos_t *repos)
 {
@@ -726,6 +853,20 @@ svn_repos_fs (svn_repos_t *repos)
 }
 
 
+void
+svn_repos_set_delta_threads (svn_repos_t *repos, int num_threads)
+{
+  repos->delta_threads = num_threads;
+}
+
+
+void
+svn_repos_set_post_commit_async (svn_repos_t *repos, svn_boolean_t async)
+{
+  repos->post_commit_async = async;
+}
+
+
 
 /* 
  * local variables:
@@ -20,7 +20,10 @@
 
 #include "apr_pools.h"
 #include "apr_hash.h"
+#include "apr_tables.h"
 #include "svn_fs.h"
+#include "svn_delta.h"
+#include "svn_repos.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -47,10 +50,44 @@ extern "C" {
 #define SVN_REPOS__HOOK_POST_COMMIT     "post-commit"
 #define SVN_REPOS__HOOK_READ_SENTINEL   "read-sentinels"
 #define SVN_REPOS__HOOK_WRITE_SENTINEL  "write-sentinels"
+#define SVN_REPOS__HOOK_PLUGIN          "hook-plugin.so"
+
+/* In the hooks directory, the post-commit queue, and the extensions of
+   its temporary and given-up-on entries; and in the locks directory,
+   the lockfile held while the queue is run. */
+#define SVN_REPOS__HOOK_QUEUE_DIR       "post-commit.queue"
+#define SVN_REPOS__HOOK_QUEUE_TMP_EXT   ".tmp"
+#define SVN_REPOS__HOOK_QUEUE_FAIL_EXT  ".failed"
+#define SVN_REPOS__HOOK_QUEUE_LOCKFILE  "hook-queue.lock"
 
 /* The extension added to the names of example hook scripts. */
 #define SVN_REPOS__HOOK_DESC_EXT        ".tmpl"
 
+/* A master writes each new revision to the SVN_REPOS__SPOOL_DIR
+   directory, if it has one, for its replicas to read; entries are
+   written under a name ending in SVN_REPOS__SPOOL_TMP_EXT and renamed
+   into place.  A replica has an SVN_REPOS__REPLICA file naming the
+   spool it was made from, and, in the locks directory, a lockfile
+   that keeps two replications from running on it at once.  */
+#define SVN_REPOS__SPOOL_DIR            "spool"
+#define SVN_REPOS__SPOOL_TMP_EXT        ".tmp"
+#define SVN_REPOS__REPLICA              "replica"
+#define SVN_REPOS__REPLICATE_LOCKFILE   "replicate.lock"
+
+
+/* A filesystem handle for a worker thread of
+   svn_repos_dir_delta_pipelined(), opened on its own Berkeley DB
+   environment handle. */
+typedef struct svn_repos__worker_fs_t
+{
+  svn_fs_t *fs;
+
+  /* A root pool holding FS, since the worker allocates in it from a
+     thread of its own. */
+  apr_pool_t *pool;
+
+} svn_repos__worker_fs_t;
+
 
 /* The Repository object, created by svn_repos_open() and
    svn_repos_create(), allocated in POOL. */
@@ -77,12 +114,135 @@ struct svn_repos_t
   /* The path to the Berkeley DB filesystem environment. */
   char *db_path;
 
+  /* How many worker threads updates should read ahead on; see
+     svn_repos_set_delta_threads(). */
+  int delta_threads;
+
+  /* Worker filesystem handles, opened on DB_PATH by earlier pipelined
+     deltas and not in use now: an array of svn_repos__worker_fs_t *,
+     or NULL before the first is opened.  Reusing them saves opening a
+     Berkeley DB environment per worker per update. */
+  apr_array_header_t *worker_fs;
+
+  /* The hook plugin's function table and baton, or NULL if REPOS has
+     no plugin.  Only meaningful once HOOK_PLUGIN_LOADED is set. */
+  const svn_repos_hook_plugin_t *hook_plugin;
+  void *hook_plugin_baton;
+  svn_boolean_t hook_plugin_loaded;
+
+  /* If loading the hook plugin failed, the error code and message it
+     failed with, allocated in POOL; else 0 and NULL.  Later hooks
+     report these again rather than retrying the load. */
+  apr_status_t hook_plugin_errcode;
+  const char *hook_plugin_errmsg;
+
+  /* Whether to queue post-commit hooks rather than run them; see
+     svn_repos_set_post_commit_async(). */
+  svn_boolean_t post_commit_async;
+
+  /* If this repository is a read-only replica, the spool it was made
+     from; else NULL. */
+  const char *replica_of;
+
   /* A pool, filled with allocated memory, a diving board, and a tube
      slide. */
   apr_pool_t *pool;
 };
 
 
+/*** Hooks. ***/
+
+/* Set *CHANGED to a hash describing the changes from BASE_ROOT to ROOT
+   in REPOS's filesystem, as handed to hook plugins: each changed path,
+   with a leading slash, maps to (void *) 'A', 'D', or 'R'.  Allocate
+   *CHANGED in POOL.  */
+svn_error_t *
+svn_repos__changed_paths (apr_hash_t **changed,
+                          svn_repos_t *repos,
+                          svn_fs_root_t *base_root,
+                          svn_fs_root_t *root,
+                          apr_pool_t *pool);
+
+
+
+/*** Replication. ***/
+
+/* Return the error for an attempt to change REPOS, which is a
+   read-only replica.  Allocate it in POOL.  */
+svn_error_t *
+svn_repos__read_only_error (svn_repos_t *repos, apr_pool_t *pool);
+
+/* If REPOS has a spool, write revision REV to it for its replicas.
+   Use POOL for temporary allocations.  */
+svn_error_t *
+svn_repos__spool_revision (svn_repos_t *repos,
+                           svn_revnum_t rev,
+                           apr_pool_t *pool);
+
+/* Like svn_repos_dump_fs() with deltas, but describe START_REV by its
+   changes from the revision before it, like every other revision, and
+   keep all copies as copies.  The stream can only be loaded, with
+   svn_repos__load_replica(), on top of the revisions before it.  */
+svn_error_t *
+svn_repos__dump_incremental (svn_repos_t *repos,
+                             svn_stream_t *dumpstream,
+                             svn_revnum_t start_rev,
+                             svn_revnum_t end_rev,
+                             apr_pool_t *pool);
+
+/* Like svn_repos_load_fs(), but for a replica: each revision must be
+   the one after REPOS's youngest, copy sources outside the stream are
+   taken to be in REPOS already, and REPOS being read-only doesn't
+   stop us.  */
+svn_error_t *
+svn_repos__load_replica (svn_repos_t *repos,
+                         svn_stream_t *dumpstream,
+                         svn_stream_t *feedback_stream,
+                         apr_pool_t *pool);
+
+
+
+/*** Reporting. ***/
+
+/* One path of a working copy, as described to the reporter by
+   svn_repos_set_path() or svn_repos_delete_path(). */
+typedef struct svn_repos__report_path_t
+{
+  /* The full filesystem path, without a leading slash. */
+  const char *path;
+
+  /* The revision the working copy has of PATH, and whether PATH is
+     missing from the working copy altogether. */
+  svn_revnum_t revision;
+  svn_boolean_t deleted;
+
+} svn_repos__report_path_t;
+
+
+/* Like svn_repos_dir_delta(), but read the source tree from the
+   revisions of FS described by REPORT_PATHS, an array of
+   svn_repos__report_path_t * sorted by path with strcmp().  Each source
+   path is read from the revision given for its nearest reported
+   ancestor (the report should include the empty path), and does not
+   exist if that ancestor is reported deleted.  No copyfrom arguments
+   are ever sent.  Read ahead on REPOS's delta threads, keeping the
+   workers' filesystem handles in REPOS, as
+   svn_repos_dir_delta_pipelined() does.  */
+svn_error_t *
+svn_repos__dir_delta_report (svn_fs_t *fs,
+                             const apr_array_header_t *report_paths,
+                             const char *src_parent_dir,
+                             const char *src_entry,
+                             svn_fs_root_t *tgt_root,
+                             const char *tgt_path,
+                             const svn_delta_edit_fns_t *editor,
+                             void *edit_baton,
+                             svn_boolean_t text_deltas,
+                             svn_boolean_t recurse,
+                             svn_repos_t *repos,
+                             apr_pool_t *pool);
+
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,607 @@
+/*
+ * diff.c:  comparing texts line by line
+ *
+ * ====================================================================
+ * Copyright (c) 2000-2002 CollabNet.  All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.  The terms
+ * are also available at http://subversion.tigris.org/license-1.html.
+ * If newer versions of this license are posted there, you may use a
+ * newer version instead, at your option.
+ *
+ * This software consists of voluntary contributions made by many
+ * individuals.  For exact contribution history, see the revision
+ * history and logs, available at http://subversion.tigris.org/.
+ * ====================================================================
+ */
+
+
+
+#include <string.h>
+#include <limits.h>
+
+#include <apr_pools.h>
+#include <apr_hash.h>
+#include <apr_strings.h>
+
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_io.h"
+#include "svn_diff.h"
+
+
+/* This is the algorithm from Eugene W. Myers, "An O(ND) Difference
+   Algorithm and Its Variations", in its linear space form: find the
+   middle snake of the shortest edit script, then recurse on either
+   side of it.  It is the same algorithm GNU diff uses, and the
+   shortcut for very expensive comparisons is taken from there too.
+
+   Every line is first replaced by a small integer, equal for equal
+   lines, so that the comparison proper never looks at text.  */
+
+
+
+/*** Splitting the texts into lines. ***/
+
+struct line_t
+{
+  const char *data;
+  apr_size_t len;
+};
+
+
+/* One of the two texts being compared. */
+struct text_t
+{
+  struct line_t *lines;
+  int *ids;                     /* the number standing for each line */
+  char *changed;                /* non-zero for lines not in the LCS;
+                                   index -1 and COUNT are always zero */
+  int count;
+};
+
+
+/* Split STR into lines in TEXT, numbering each one with its entry in
+   IDS (a hash of line contents to numbers, shared between the two
+   texts), and using *NEXT_ID for lines not seen before.  */
+static void
+split_lines (struct text_t *text,
+             const svn_string_t *str,
+             apr_hash_t *ids,
+             int *next_id,
+             apr_pool_t *pool)
+{
+  const char *p = str->data;
+  const char *end = str->data + str->len;
+  int n = 0;
+
+  /* Count first, so each array is allocated once. */
+  for (; p < end; n++)
+    {
+      const char *eol = memchr (p, '\n', end - p);
+      p = eol ? eol + 1 : end;
+    }
+
+  text->count = n;
+  text->lines = apr_palloc (pool, (n + 1) * sizeof (*text->lines));
+  text->ids = apr_palloc (pool, (n + 1) * sizeof (*text->ids));
+  /* With a zero on either side, so that runs of changes can be
+     scanned for without bounds checks.  */
+  text->changed = (char *) apr_pcalloc (pool, n + 2) + 1;
+
+  for (p = str->data, n = 0; p < end; n++)
+    {
+      const char *eol = memchr (p, '\n', end - p);
+      const char *next = eol ? eol + 1 : end;
+      int *id;
+
+      text->lines[n].data = p;
+      text->lines[n].len = next - p;
+
+      id = apr_hash_get (ids, p, next - p);
+      if (! id)
+        {
+          id = apr_palloc (pool, sizeof (*id));
+          *id = (*next_id)++;
+          apr_hash_set (ids, p, next - p, id);
+        }
+      text->ids[n] = *id;
+      p = next;
+    }
+}
+
+
+
+/*** Finding the changed lines. ***/
+
+struct compare_t
+{
+  const int *xv, *yv;           /* line numbers of the two texts */
+  char *xchanged, *ychanged;
+
+  /* Furthest reaching D-paths, forward and backward, indexed by
+     diagonal (x - y); they point into storage offset so that every
+     diagonal between -(ylen + 1) and xlen + 1 is a valid index.  */
+  int *fdiag, *bdiag;
+
+  /* Give up on an optimal split after this many rounds. */
+  int too_expensive;
+};
+
+
+/* Find a point (*XMID, *YMID) on a shortest edit script between lines
+   XOFF to XLIM of the first text and YOFF to YLIM of the second,
+   which are known to differ at both ends.  */
+static void
+find_split (struct compare_t *cmp,
+            int xoff, int xlim, int yoff, int ylim,
+            int *xmid, int *ymid)
+{
+  const int *xv = cmp->xv, *yv = cmp->yv;
+  int *fd = cmp->fdiag, *bd = cmp->bdiag;
+  const int dmin = xoff - ylim;
+  const int dmax = xlim - yoff;
+  const int fmid = xoff - yoff;
+  const int bmid = xlim - ylim;
+  int fmin = fmid, fmax = fmid;
+  int bmin = bmid, bmax = bmid;
+  const int odd = (fmid - bmid) & 1;
+  int c;
+
+  fd[fmid] = xoff;
+  bd[bmid] = xlim;
+
+  for (c = 1;; c++)
+    {
+      int d;
+
+      /* Extend the forward paths by one edit. */
+      if (fmin > dmin)
+        fd[--fmin - 1] = -1;
+      else
+        fmin++;
+      if (fmax < dmax)
+        fd[++fmax + 1] = -1;
+      else
+        fmax--;
+      for (d = fmax; d >= fmin; d -= 2)
+        {
+          int x, y;
+          int tlo = fd[d - 1], thi = fd[d + 1];
+
+          x = (tlo >= thi) ? tlo + 1 : thi;
+          y = x - d;
+          while (x < xlim && y < ylim && xv[x] == yv[y])
+            x++, y++;
+          fd[d] = x;
+          if (odd && bmin <= d && d <= bmax && bd[d] <= x)
+            {
+              *xmid = x;
+              *ymid = y;
+              return;
+            }
+        }
+
+      /* And the backward ones. */
+      if (bmin > dmin)
+        bd[--bmin - 1] = INT_MAX;
+      else
+        bmin++;
+      if (bmax < dmax)
+        bd[++bmax + 1] = INT_MAX;
+      else
+        bmax--;
+      for (d = bmax; d >= bmin; d -= 2)
+        {
+          int x, y;
+          int tlo = bd[d - 1], thi = bd[d + 1];
+
+          x = (tlo < thi) ? tlo : thi - 1;
+          y = x - d;
+          while (x > xoff && y > yoff && xv[x - 1] == yv[y - 1])
+            x--, y--;
+          bd[d] = x;
+          if (! odd && fmin <= d && d <= fmax && x <= fd[d])
+            {
+              *xmid = x;
+              *ymid = y;
+              return;
+            }
+        }
+
+      /* This is taking too long.  Settle for the forward path that has
+         got furthest, as long as it hasn't got all the way to the end;
+         the result is still a correct diff, if not the smallest.  */
+      if (c >= cmp->too_expensive)
+        {
+          int best = -1;
+
+          for (d = fmax; d >= fmin; d -= 2)
+            {
+              int x = fd[d] < xlim ? fd[d] : xlim;
+              int y = x - d;
+
+              if (y > ylim)
+                x = ylim + d, y = ylim;
+              if (x + y > best && ! (x == xlim && y == ylim))
+                {
+                  best = x + y;
+                  *xmid = x;
+                  *ymid = y;
+                }
+            }
+          if (best > xoff + yoff)
+            return;
+        }
+    }
+}
+
+
+/* Mark the lines between XOFF and XLIM of the first text, and YOFF and
+   YLIM of the second, that are not on a shortest edit script between
+   the two as changed.  */
+static void
+compare_seq (struct compare_t *cmp,
+             int xoff, int xlim, int yoff, int ylim)
+{
+  const int *xv = cmp->xv, *yv = cmp->yv;
+
+  /* Lines the same at either end are no part of the problem. */
+  while (xoff < xlim && yoff < ylim && xv[xoff] == yv[yoff])
+    xoff++, yoff++;
+  while (xlim > xoff && ylim > yoff && xv[xlim - 1] == yv[ylim - 1])
+    xlim--, ylim--;
+
+  if (xoff == xlim)
+    while (yoff < ylim)
+      cmp->ychanged[yoff++] = 1;
+  else if (yoff == ylim)
+    while (xoff < xlim)
+      cmp->xchanged[xoff++] = 1;
+  else
+    {
+      int xmid, ymid;
+
+      find_split (cmp, xoff, xlim, yoff, ylim, &xmid, &ymid);
+      compare_seq (cmp, xoff, xmid, yoff, ymid);
+      compare_seq (cmp, xmid, xlim, ymid, ylim);
+    }
+}
+
+
+/* Where a run of changed lines in TEXT could equally well be drawn a
+   line or more up or down, because the lines at its edges are the same,
+   move it as far down as it will go, merging it with any runs it
+   meets, but stop at a run of changes in OTHER if it passes one, so
+   that changes on both sides line up.  This is GNU diff's rule, and it
+   keeps our hunks where people are used to seeing them.  */
+static void
+shift_boundaries (struct text_t *text, const struct text_t *other)
+{
+  char *changed = text->changed;
+  const char *other_changed = other->changed;
+  const int *ids = text->ids;
+  int i = 0, j = 0;
+  const int i_end = text->count;
+
+  for (;;)
+    {
+      int runlength, start, corresponding;
+
+      /* Find the start of the next run, keeping track of the
+         corresponding place in OTHER. */
+      while (i < i_end && ! changed[i])
+        {
+          while (other_changed[j++])
+            continue;
+          i++;
+        }
+      if (i == i_end)
+        break;
+
+      start = i;
+      while (changed[++i])
+        continue;
+      while (other_changed[j])
+        j++;
+
+      do
+        {
+          runlength = i - start;
+
+          /* Move the run up as far as it goes, merging with runs
+             before it. */
+          while (start && ids[start - 1] == ids[i - 1])
+            {
+              changed[--start] = 1;
+              changed[--i] = 0;
+              while (changed[start - 1])
+                start--;
+              while (other_changed[--j])
+                continue;
+            }
+
+          /* The last place the end of the run lines up with a run of
+             changes in OTHER, if there is one. */
+          corresponding = other_changed[j - 1] ? i : i_end;
+
+          /* And then down as far as it goes, merging with runs
+             after it. */
+          while (i != i_end && ids[start] == ids[i])
+            {
+              changed[start++] = 0;
+              changed[i++] = 1;
+              while (changed[i])
+                i++;
+              while (other_changed[++j])
+                corresponding = i;
+            }
+        }
+      while (runlength != i - start);
+
+      /* Move the whole run back to line up with OTHER's, if it can. */
+      while (corresponding < i)
+        {
+          changed[--start] = 1;
+          changed[--i] = 0;
+          while (other_changed[--j])
+            continue;
+        }
+    }
+}
+
+
+/* Lines of TEXT whose numbers have no entry in IN_OTHER can't be in
+   common with the other text, so mark them changed now, and return
+   the numbers of the rest in *IDS_P, their line indexes in *MAP_P,
+   and how many there are in *COUNT_P.  Taking out the lines that can
+   never match is what makes comparing two quite different texts
+   cheap.  */
+static void
+discard_unmatched (int **ids_p,
+                   int **map_p,
+                   int *count_p,
+                   struct text_t *text,
+                   const char *in_other,
+                   apr_pool_t *pool)
+{
+  int *ids = apr_palloc (pool, (text->count + 1) * sizeof (*ids));
+  int *map = apr_palloc (pool, (text->count + 1) * sizeof (*map));
+  int i, n = 0;
+
+  for (i = 0; i < text->count; i++)
+    {
+      if (in_other[text->ids[i]])
+        {
+          ids[n] = text->ids[i];
+          map[n++] = i;
+        }
+      else
+        text->changed[i] = 1;
+    }
+
+  *ids_p = ids;
+  *map_p = map;
+  *count_p = n;
+}
+
+
+/* Mark the changed lines of ORIG and MOD, whose lines are numbered
+   from zero to NUM_IDS - 1.  */
+static void
+compare_texts (struct text_t *orig,
+               struct text_t *mod,
+               int num_ids,
+               apr_pool_t *pool)
+{
+  struct compare_t cmp;
+  char *in_orig = apr_pcalloc (pool, num_ids + 1);
+  char *in_mod = apr_pcalloc (pool, num_ids + 1);
+  int *xv, *yv, *xmap, *ymap;
+  int xlen, ylen, diags, i;
+
+  for (i = 0; i < orig->count; i++)
+    in_orig[orig->ids[i]] = 1;
+  for (i = 0; i < mod->count; i++)
+    in_mod[mod->ids[i]] = 1;
+  discard_unmatched (&xv, &xmap, &xlen, orig, in_mod, pool);
+  discard_unmatched (&yv, &ymap, &ylen, mod, in_orig, pool);
+
+  cmp.xv = xv;
+  cmp.yv = yv;
+  cmp.xchanged = apr_pcalloc (pool, xlen + 1);
+  cmp.ychanged = apr_pcalloc (pool, ylen + 1);
+  diags = xlen + ylen + 3;
+  cmp.fdiag = (int *) apr_palloc (pool, diags * sizeof (int)) + ylen + 1;
+  cmp.bdiag = (int *) apr_palloc (pool, diags * sizeof (int)) + ylen + 1;
+
+  /* Roughly the square root of the number of diagonals, but not too
+     small, as GNU diff has it.  */
+  for (cmp.too_expensive = 1; diags != 0; diags >>= 2)
+    cmp.too_expensive <<= 1;
+  if (cmp.too_expensive < 4096)
+    cmp.too_expensive = 4096;
+
+  compare_seq (&cmp, 0, xlen, 0, ylen);
+
+  for (i = 0; i < xlen; i++)
+    if (cmp.xchanged[i])
+      orig->changed[xmap[i]] = 1;
+  for (i = 0; i < ylen; i++)
+    if (cmp.ychanged[i])
+      mod->changed[ymap[i]] = 1;
+
+  shift_boundaries (orig, mod);
+  shift_boundaries (mod, orig);
+}
+
+
+
+/*** Writing the unified diff. ***/
+
+/* A run of changed lines: LEN lines of the original text from START
+   replaced by MOD_LEN lines of the modified text from MOD_START.  */
+struct change_t
+{
+  int start, len;
+  int mod_start, mod_len;
+};
+
+
+/* Append LINE to BUF with PREFIX in front of it.  */
+static void
+append_line (svn_stringbuf_t *buf, char prefix, const struct line_t *line)
+{
+  svn_stringbuf_appendbytes (buf, &prefix, 1);
+  svn_stringbuf_appendbytes (buf, line->data, line->len);
+  if (line->len == 0 || line->data[line->len - 1] != '\n')
+    svn_stringbuf_appendcstr (buf, "\n\\ No newline at end of file\n");
+}
+
+
+/* Append a hunk header range of LEN lines from START to BUF.  */
+static void
+append_range (svn_stringbuf_t *buf, int start, int len, apr_pool_t *pool)
+{
+  if (len == 1)
+    svn_stringbuf_appendcstr (buf, apr_psprintf (pool, "%d", start + 1));
+  else if (len == 0)
+    svn_stringbuf_appendcstr (buf, apr_psprintf (pool, "%d,0", start));
+  else
+    svn_stringbuf_appendcstr (buf, apr_psprintf (pool, "%d,%d",
+                                                 start + 1, len));
+}
+
+
+static svn_error_t *
+write_buf (svn_stream_t *out, svn_stringbuf_t *buf)
+{
+  apr_size_t len = buf->len;
+
+  SVN_ERR (svn_stream_write (out, buf->data, &len));
+  svn_stringbuf_setempty (buf);
+  return SVN_NO_ERROR;
+}
+
+
+svn_error_t *
+svn_diff_unified (svn_stream_t *out,
+                  const svn_string_t *original,
+                  const svn_string_t *modified,
+                  const char *original_header,
+                  const char *modified_header,
+                  int context,
+                  apr_pool_t *pool)
+{
+  apr_pool_t *subpool = svn_pool_create (pool);
+  apr_hash_t *ids = apr_hash_make (subpool);
+  struct text_t orig, mod;
+  apr_array_header_t *changes;
+  svn_stringbuf_t *buf;
+  int next_id = 0;
+  int i, j;
+
+  if (context < 0)
+    context = 0;
+
+  split_lines (&orig, original, ids, &next_id, subpool);
+  split_lines (&mod, modified, ids, &next_id, subpool);
+  compare_texts (&orig, &mod, next_id, subpool);
+
+  /* Collect the runs of changed lines.  Unchanged lines pair off one
+     for one between the texts, so we can walk them in step.  */
+  changes = apr_array_make (subpool, 16, sizeof (struct change_t));
+  for (i = 0, j = 0; i < orig.count || j < mod.count;)
+    {
+      struct change_t *change;
+
+      if (! ((i < orig.count && orig.changed[i])
+             || (j < mod.count && mod.changed[j])))
+        {
+          i++, j++;
+          continue;
+        }
+
+      change = apr_array_push (changes);
+      change->start = i;
+      change->mod_start = j;
+      while (i < orig.count && orig.changed[i])
+        i++;
+      while (j < mod.count && mod.changed[j])
+        j++;
+      change->len = i - change->start;
+      change->mod_len = j - change->mod_start;
+    }
+
+  if (changes->nelts == 0)
+    {
+      svn_pool_destroy (subpool);
+      return SVN_NO_ERROR;
+    }
+
+  buf = svn_stringbuf_create ("", subpool);
+  svn_stringbuf_appendcstr (buf, apr_psprintf (subpool, "--- %s\n+++ %s\n",
+                                               original_header,
+                                               modified_header));
+
+  /* Each hunk takes in every change that is within twice the context
+     of the one before.  */
+  for (i = 0; i < changes->nelts; i = j)
+    {
+      struct change_t *first = &APR_ARRAY_IDX (changes, i, struct change_t);
+      struct change_t *last = first;
+      int lo, hi, mod_lo, mod_hi, x, y, k;
+
+      for (j = i + 1; j < changes->nelts; j++)
+        {
+          struct change_t *next = &APR_ARRAY_IDX (changes, j,
+                                                  struct change_t);
+          if (next->start - (last->start + last->len) > 2 * context)
+            break;
+          last = next;
+        }
+
+      lo = first->start > context ? first->start - context : 0;
+      mod_lo = first->mod_start - (first->start - lo);
+      hi = last->start + last->len + context;
+      if (hi > orig.count)
+        hi = orig.count;
+      mod_hi = last->mod_start + last->mod_len
+        + (hi - (last->start + last->len));
+
+      svn_stringbuf_appendcstr (buf, "@@ -");
+      append_range (buf, lo, hi - lo, subpool);
+      svn_stringbuf_appendcstr (buf, " +");
+      append_range (buf, mod_lo, mod_hi - mod_lo, subpool);
+      svn_stringbuf_appendcstr (buf, " @@\n");
+
+      for (x = lo, y = mod_lo, k = i; k < j; k++)
+        {
+          struct change_t *change = &APR_ARRAY_IDX (changes, k,
+                                                    struct change_t);
+
+          for (; x < change->start; x++, y++)
+            append_line (buf, ' ', &orig.lines[x]);
+          for (; x < change->start + change->len; x++)
+            append_line (buf, '-', &orig.lines[x]);
+          for (; y < change->mod_start + change->mod_len; y++)
+            append_line (buf, '+', &mod.lines[y]);
+        }
+      for (; x < hi; x++)
+        append_line (buf, ' ', &orig.lines[x]);
+
+      SVN_ERR (write_buf (out, buf));
+    }
+
+  svn_pool_destroy (subpool);
+  return SVN_NO_ERROR;
+}
+
+
+
+/*
+ * local variables:
+ * eval: (load-file "../../tools/dev/svn-dev.el")
+ * end:
+ */
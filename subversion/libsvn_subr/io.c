@@ -36,6 +36,10 @@
 #include "svn_pools.h"
 #include "svn_private_config.h" /* for SVN_CLIENT_DIFF */
 
+#ifndef SVN_WIN32
+#include <unistd.h>             /* for fsync */
+#endif
+
 
 struct svn_stream_t {
   void *baton;
@@ -1117,6 +1121,48 @@ svn_io_run_diff3 (const char *dir,
 
 
 
+svn_boolean_t
+svn_io_is_binary_data (const void *data, apr_size_t len)
+{
+  const unsigned char *buf = data;
+
+  /* Right now, this function is going to be really stupid.  It's
+     going to examine the data, and make sure that 85% of the bytes
+     are such that their value is in the ranges 0x07-0x0D or
+     0x20-0x7F, and that 100% of those bytes is not 0x00.
+
+     If those criteria are not met, we're calling it binary. */
+  if (len > 0)
+    {
+      apr_size_t i;
+      apr_size_t binary_count = 0;
+      
+      /* Run through the data, counting the 'binary-ish' bytes.  HINT:
+         If we see a 0x00 byte, we'll set our count to its max and stop
+         looking. */
+      for (i = 0; i < len; i++)
+        {
+          if (buf[i] == 0)
+            {
+              binary_count = len;
+              break;
+            }
+          if ((buf[i] < 0x07)
+              || ((buf[i] > 0x0D) && (buf[i] < 0x20))
+              || (buf[i] > 0x7F))
+            {
+              binary_count++;
+            }
+        }
+      
+      if (((binary_count * 1000) / len) > 850)
+        return TRUE;
+    }
+  
+  return FALSE;
+}
+
+
 svn_error_t *
 svn_io_detect_mimetype (const char **mimetype,
                         const char *file,
@@ -1158,42 +1204,9 @@ svn_io_detect_mimetype (const char **mimetype,
   apr_file_close (fh);
 
 
-  /* Right now, this function is going to be really stupid.  It's
-     going to examine the first block of data, and make sure that 85%
-     of the bytes are such that their value is in the ranges 0x07-0x0D
-     or 0x20-0x7F, and that 100% of those bytes is not 0x00.
+  if (svn_io_is_binary_data (block, amt_read))
+    *mimetype = generic_binary;
 
-     If those criteria are not met, we're calling it binary. */
-  if (amt_read > 0)
-    {
-      apr_size_t i;
-      int binary_count = 0;
-      
-      /* Run through the data we've read, counting the 'binary-ish'
-         bytes.  HINT: If we see a 0x00 byte, we'll set our count to its
-         max and stop reading the file. */
-      for (i = 0; i < amt_read; i++)
-        {
-          if (block[i] == 0)
-            {
-              binary_count = amt_read;
-              break;
-            }
-          if ((block[i] < 0x07)
-              || ((block[i] > 0x0D) && (block[i] < 0x20))
-              || (block[i] > 0x7F))
-            {
-              binary_count++;
-            }
-        }
-      
-      if (((binary_count * 1000) / amt_read) > 850)
-        {
-          *mimetype = generic_binary;
-          return SVN_NO_ERROR;
-        }
-    }
-  
   return SVN_NO_ERROR;
 }
 
@@ -1249,6 +1262,41 @@ svn_io_fd_from_file (int *fd_p, apr_file_t *file)
 }
 
 
+svn_error_t *
+svn_io_file_flush_to_disk (apr_file_t *file, apr_pool_t *pool)
+{
+  apr_os_file_t fd;
+  apr_status_t status;
+
+  status = apr_file_flush (file);
+  if (! status)
+    status = apr_os_file_get (&fd, file);
+  if (status)
+    return svn_error_create (status, 0, NULL, pool,
+                             "svn_io_file_flush_to_disk: can't flush file");
+
+#ifdef SVN_WIN32
+  if (! FlushFileBuffers (fd))
+    return svn_error_create (apr_get_os_error (), 0, NULL, pool,
+                             "svn_io_file_flush_to_disk: can't sync file");
+#else
+  {
+    int rv;
+
+    do
+      rv = fsync (fd);
+    while (rv == -1 && errno == EINTR);
+
+    if (rv == -1)
+      return svn_error_create (errno, 0, NULL, pool,
+                               "svn_io_file_flush_to_disk: can't sync file");
+  }
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+
 apr_status_t
 apr_check_dir_empty (const char *path, 
                      apr_pool_t *pool)
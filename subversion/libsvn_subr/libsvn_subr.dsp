@@ -103,6 +103,10 @@ SOURCE=.\config_win.c
 # End Source File
 # Begin Source File
 
+SOURCE=.\diff.c
+# End Source File
+# Begin Source File
+
 SOURCE=.\getdate.c
 # End Source File
 # Begin Source File
@@ -34,15 +34,41 @@
 static const char base64tab[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
                                 "abcdefghijklmnopqrstuvwxyz0123456789+/";
 
+/* The number of input bytes which make up one full output line. */
+#define BYTES_PER_LINE (BASE64_LINELEN / 4 * 3)
+
+/* The inverse of base64tab: the six-bit value of each base64
+   character, or -1 for characters which are not part of the base64
+   alphabet (including '=', which is handled separately).  */
+static const signed char reverse_base64[256] = {
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
+  52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+  -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+  15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+  -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+  41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
 
 
 /* Binary input --> base64-encoded output */
 
 struct encode_baton {
   svn_stream_t *output;
-  char buf[3];                  /* Bytes waiting to be encoded */
+  unsigned char buf[3];         /* Bytes waiting to be encoded */
   int buflen;                   /* Number of bytes waiting */
   int linelen;                  /* Bytes output so far on this line */
+  svn_stringbuf_t *encoded;     /* Output buffer, reused across writes */
   apr_pool_t *pool;
 };
 
@@ -66,41 +92,91 @@ encode_group (const unsigned char *in, char *out)
    data from call to call, and *LINELEN carries the length of the
    current output line.  Make INBUF have room for three characters and
    initialize *INBUFLEN and *LINELEN to 0.  Output will be appended to
-   STR.  */
+   STR.
+
+   The output is written directly into STR's buffer, which is grown
+   once up front, and whole lines are encoded in a tight loop when we
+   are at the start of a line.  */
 static void
 encode_bytes (svn_stringbuf_t *str, const char *data, apr_size_t len,
               unsigned char *inbuf, int *inbuflen, int *linelen)
 {
-  char group[4];
-  const char *p = data, *end = data + len;
+  const unsigned char *p = (const unsigned char *) data;
+  const unsigned char *end = p + len;
+  apr_size_t groups;
+  char *q;
 
-  /* Keep encoding three-byte groups until we run out.  */
-  while (*inbuflen + (end - p) >= 3)
+  /* Not enough for a group?  Just tack it onto *INBUF.  */
+  if (*inbuflen + len < 3)
+    {
+      memcpy (inbuf + *inbuflen, p, len);
+      *inbuflen += len;
+      return;
+    }
+
+  /* Make room for everything we are about to write: four bytes per
+     group plus a newline per line, and the terminating null.  */
+  groups = (*inbuflen + len) / 3;
+  svn_stringbuf_ensure (str, str->len + groups * 4
+                        + (groups * 4 + *linelen) / BASE64_LINELEN + 1);
+  q = str->data + str->len;
+
+  /* Finish off the group left over from last time, if any.  */
+  if (*inbuflen > 0)
     {
       memcpy (inbuf + *inbuflen, p, 3 - *inbuflen);
       p += (3 - *inbuflen);
-      encode_group (inbuf, group);
-      svn_stringbuf_appendbytes (str, group, 4);
+      encode_group (inbuf, q);
+      q += 4;
       *inbuflen = 0;
       *linelen += 4;
       if (*linelen == BASE64_LINELEN)
         {
-          svn_stringbuf_appendcstr (str, "\n");
+          *q++ = '\n';
           *linelen = 0;
         }
     }
 
+  /* Keep encoding three-byte groups until we run out.  */
+  while (end - p >= 3)
+    {
+      if (*linelen == 0 && end - p >= BYTES_PER_LINE)
+        {
+          /* A whole line at once.  */
+          const unsigned char *line_end = p + BYTES_PER_LINE;
+
+          for (; p < line_end; p += 3, q += 4)
+            encode_group (p, q);
+          *q++ = '\n';
+        }
+      else
+        {
+          encode_group (p, q);
+          p += 3;
+          q += 4;
+          *linelen += 4;
+          if (*linelen == BASE64_LINELEN)
+            {
+              *q++ = '\n';
+              *linelen = 0;
+            }
+        }
+    }
+
+  str->len = q - str->data;
+  str->data[str->len] = '\0';
+
   /* Tack any extra input onto *INBUF.  */
-  memcpy (inbuf + *inbuflen, p, end - p);
-  *inbuflen += (end - p);
+  memcpy (inbuf, p, end - p);
+  *inbuflen = end - p;
 }
 
 
 /* Encode leftover data, if any, and possibly a final newline,
    appending to STR.  LEN must be in the range 0..2.  */
 static void
-encode_partial_group (svn_stringbuf_t *str, const char *extra, int len,
-                      int linelen)
+encode_partial_group (svn_stringbuf_t *str, const unsigned char *extra,
+                      int len, int linelen)
 {
   unsigned char ingroup[3];
   char outgroup[4];
@@ -124,17 +200,15 @@ static svn_error_t *
 encode_data (void *baton, const char *data, apr_size_t *len)
 {
   struct encode_baton *eb = baton;
-  apr_pool_t *subpool = svn_pool_create (eb->pool);
-  svn_stringbuf_t *encoded = svn_stringbuf_create ("", subpool);
   apr_size_t enclen;
   svn_error_t *err = SVN_NO_ERROR;
 
   /* Encode this block of data and write it out.  */
-  encode_bytes (encoded, data, *len, eb->buf, &eb->buflen, &eb->linelen);
-  enclen = encoded->len;
+  svn_stringbuf_setempty (eb->encoded);
+  encode_bytes (eb->encoded, data, *len, eb->buf, &eb->buflen, &eb->linelen);
+  enclen = eb->encoded->len;
   if (enclen != 0)
-    err = svn_stream_write (eb->output, encoded->data, &enclen);
-  svn_pool_destroy (subpool);
+    err = svn_stream_write (eb->output, eb->encoded->data, &enclen);
   return err;
 }
 
@@ -172,6 +246,7 @@ svn_base64_encode (svn_stream_t *output, apr_pool_t *pool)
   eb->output = output;
   eb->buflen = 0;
   eb->linelen = 0;
+  eb->encoded = svn_stringbuf_create ("", subpool);
   eb->pool = subpool;
   stream = svn_stream_create (eb, pool);
   svn_stream_set_write (stream, encode_data);
@@ -184,7 +259,7 @@ svn_stringbuf_t *
 svn_base64_encode_string (svn_stringbuf_t *str, apr_pool_t *pool)
 {
   svn_stringbuf_t *encoded = svn_stringbuf_create ("", pool);
-  char ingroup[3];
+  unsigned char ingroup[3];
   int ingrouplen = 0, linelen = 0;
 
   encode_bytes (encoded, str->data, str->len, ingroup, &ingrouplen, &linelen);
@@ -201,6 +276,7 @@ struct decode_baton {
   unsigned char buf[4];         /* Bytes waiting to be decoded */
   int buflen;                   /* Number of bytes waiting */
   svn_boolean_t done;		/* True if we already saw an '=' */
+  svn_stringbuf_t *decoded;     /* Output buffer, reused across writes */
   apr_pool_t *pool;
 };
 
@@ -223,40 +299,77 @@ decode_group (const unsigned char *in, char *out)
    from call to call, and *DONE keeps track of whether we've seen an
    '=' which terminates the encoded data.  Have room for four bytes in
    INBUF and initialize *INBUFLEN to 0 and *DONE to FALSE.  Output
-   will be appended to STR.  */
+   will be appended to STR.  Characters outside the base64 alphabet,
+   such as line breaks, are skipped.
+
+   Runs of four valid characters are decoded straight from DATA into
+   STR's buffer; everything else goes through INBUF one character at
+   a time.  */
 static void
 decode_bytes (svn_stringbuf_t *str, const char *data, apr_size_t len,
               unsigned char *inbuf, int *inbuflen, svn_boolean_t *done)
 {
-  const char *p, *find;
-  char group[3];
+  const unsigned char *p = (const unsigned char *) data;
+  const unsigned char *end = p + len;
+  char *q;
+
+  if (*done)
+    return;
 
-  for (p = data; !*done && p < data + len; p++)
+  /* Every four input characters make at most three output bytes. */
+  svn_stringbuf_ensure (str, str->len + (*inbuflen + len) / 4 * 3 + 4);
+  q = str->data + str->len;
+
+  while (p < end)
     {
+      if (*inbuflen == 0 && end - p >= 4)
+        {
+          signed char a = reverse_base64[p[0]];
+          signed char b = reverse_base64[p[1]];
+          signed char c = reverse_base64[p[2]];
+          signed char d = reverse_base64[p[3]];
+
+          if ((a | b | c | d) >= 0)
+            {
+              q[0] = (char) ((a << 2) | (b >> 4));
+              q[1] = (char) (((b & 0xf) << 4) | (c >> 2));
+              q[2] = (char) (((c & 0x3) << 6) | d);
+              p += 4;
+              q += 3;
+              continue;
+            }
+        }
+
       if (*p == '=')
-	{
-	  /* We are at the end and have to decode a partial group.  */
-	  if (*inbuflen >= 2)
-	    {
-	      memset (inbuf + *inbuflen, 0, 4 - *inbuflen);
-	      decode_group (inbuf, group);
-	      svn_stringbuf_appendbytes (str, group, *inbuflen - 1);
-	    }
-	  *done = TRUE;
-	}
-      else
-	{
-	  find = strchr (base64tab, *p);
-	  if (find != NULL)
-	    inbuf[(*inbuflen)++] = find - base64tab;
-	  if (*inbuflen == 4)
-	    {
-	      decode_group (inbuf, group);
-	      svn_stringbuf_appendbytes (str, group, 3);
-	      *inbuflen = 0;
-	    }
-	}
+        {
+          /* We are at the end and have to decode a partial group.  */
+          if (*inbuflen >= 2)
+            {
+              char group[3];
+
+              memset (inbuf + *inbuflen, 0, 4 - *inbuflen);
+              decode_group (inbuf, group);
+              memcpy (q, group, *inbuflen - 1);
+              q += *inbuflen - 1;
+            }
+          *done = TRUE;
+          break;
+        }
+      else if (reverse_base64[*p] >= 0)
+        {
+          inbuf[(*inbuflen)++] = reverse_base64[*p];
+          if (*inbuflen == 4)
+            {
+              decode_group (inbuf, q);
+              q += 3;
+              *inbuflen = 0;
+            }
+        }
+      p++;
     }
+
+  str->len = q - str->data;
+  str->data[str->len] = '\0';
 }
 
 
@@ -265,21 +378,17 @@ static svn_error_t *
 decode_data (void *baton, const char *data, apr_size_t *len)
 {
   struct decode_baton *db = baton;
-  apr_pool_t *subpool;
-  svn_stringbuf_t *decoded;
   apr_size_t declen;
   svn_error_t *err = SVN_NO_ERROR;
 
   /* Decode this block of data.  */
-  subpool = svn_pool_create (db->pool);
-  decoded = svn_stringbuf_create ("", subpool);
-  decode_bytes (decoded, data, *len, db->buf, &db->buflen, &db->done);
+  svn_stringbuf_setempty (db->decoded);
+  decode_bytes (db->decoded, data, *len, db->buf, &db->buflen, &db->done);
 
   /* Write the output, clean up, go home.  */
-  declen = decoded->len;
+  declen = db->decoded->len;
   if (declen != 0)
-    err = svn_stream_write (db->output, decoded->data, &declen);
-  svn_pool_destroy (subpool);
+    err = svn_stream_write (db->output, db->decoded->data, &declen);
   return err;
 }
 
@@ -308,6 +417,7 @@ svn_base64_decode (svn_stream_t *output, apr_pool_t *pool)
   db->output = output;
   db->buflen = 0;
   db->done = FALSE;
+  db->decoded = svn_stringbuf_create ("", subpool);
   db->pool = subpool;
   stream = svn_stream_create (db, pool);
   svn_stream_set_write (stream, decode_data);
@@ -18,56 +18,173 @@
 
 
 
+#include <string.h>
+
 #include <httpd.h>
+#include <http_log.h>
 #include <mod_dav.h>
 
-#include <apr_dbm.h>
+#include <apr_pools.h>
+#include <apr_hash.h>
+#include <apr_strings.h>
+#if APR_HAS_THREADS
+#include <apr_thread_mutex.h>
+#endif
 
+#include "svn_pools.h"
 #include "svn_string.h"
-#include "svn_path.h"
 #include "svn_fs.h"
 #include "svn_repos.h"
 
 #include "dav_svn.h"
 
-#define ACTIVITY_DB "dav/activities"
 
+/* An activity's transaction is recorded in the filesystem's table of
+   activities, which finds it with a single lookup.  Each server
+   process also remembers the activities it has seen; the requests of
+   a commit mostly go to the same process, so most lookups need only
+   that.  */
 
-const char *dav_svn_get_txn(const dav_svn_repos *repos,
-                            const char *activity_id)
+/* How many activities each process remembers; when it has seen more,
+   it forgets them all and starts again. */
+#define DAV_SVN_ACTIVITY_CACHE_SIZE 256
+
+/* The activities this process has seen: transaction names, keyed by
+   the repository path and activity ID.  The cache, and everything in
+   it, is allocated in CACHE_POOL.  CACHE is NULL outside the life of
+   the process's pool. */
+static apr_hash_t *cache;
+static apr_pool_t *cache_pool;
+
+#if APR_HAS_THREADS
+/* Protects the two above. */
+static apr_thread_mutex_t *cache_lock;
+#endif
+
+
+static void lock_cache(void)
+{
+#if APR_HAS_THREADS
+  if (cache_lock)
+    apr_thread_mutex_lock(cache_lock);
+#endif
+}
+
+static void unlock_cache(void)
+{
+#if APR_HAS_THREADS
+  if (cache_lock)
+    apr_thread_mutex_unlock(cache_lock);
+#endif
+}
+
+/* Return the cache key for ACTIVITY_ID in REPOS, allocated in POOL. */
+static const char *make_key(const dav_svn_repos *repos,
+                            const char *activity_id,
+                            apr_pool_t *pool)
+{
+  return apr_pstrcat(pool, activity_id, " ", repos->fs_path, NULL);
+}
+
+/* Remember that ACTIVITY_ID in REPOS is TXN_NAME, or forget about it
+   if TXN_NAME is NULL. */
+static void cache_activity(const dav_svn_repos *repos,
+                           const char *activity_id,
+                           const char *txn_name)
 {
-  apr_dbm_t *dbm;
+  const char *key;
+
+  lock_cache();
+  if (cache != NULL)
+    {
+      if (txn_name != NULL)
+        {
+          if (apr_hash_count(cache) >= DAV_SVN_ACTIVITY_CACHE_SIZE)
+            {
+              svn_pool_clear(cache_pool);
+              cache = apr_hash_make(cache_pool);
+            }
+          key = make_key(repos, activity_id, cache_pool);
+          txn_name = apr_pstrdup(cache_pool, txn_name);
+        }
+      else
+        key = make_key(repos, activity_id, repos->pool);
+
+      apr_hash_set(cache, key, APR_HASH_KEY_STRING, txn_name);
+    }
+  unlock_cache();
+}
+
+/* Cleanup for the process's pool: stop caching. */
+static apr_status_t close_cache(void *data)
+{
+  lock_cache();
+  cache = NULL;
+  cache_pool = NULL;
+  unlock_cache();
+
+#if APR_HAS_THREADS
+  /* The mutex goes with the pool it was made in. */
+  cache_lock = NULL;
+#endif
+  return APR_SUCCESS;
+}
+
+
+void dav_svn_init_activities(apr_pool_t *p, server_rec *s)
+{
+#if APR_HAS_THREADS
   apr_status_t status;
-  svn_stringbuf_t *pathname;
-  apr_datum_t key;
-  apr_datum_t value;
-  const char *txn_name;
-
-  pathname = svn_stringbuf_create(repos->fs_path, repos->pool);
-  svn_path_add_component_nts(pathname, ACTIVITY_DB);
-  status = apr_dbm_open(&dbm, pathname->data, APR_DBM_READONLY,
-                        APR_OS_DEFAULT, repos->pool);
+
+  status = apr_thread_mutex_create(&cache_lock, APR_THREAD_MUTEX_DEFAULT, p);
   if (status != APR_SUCCESS)
     {
-      /* ### let's just assume that any error means the DB doesn't exist,
-         ### therefore, the activity/transaction doesn't exist */
-      return NULL;
+      /* Without a lock, activities are always looked up in the FS. */
+      ap_log_error(APLOG_MARK, APLOG_ERR, status, s,
+                   "mod_dav_svn: could not create the activity cache "
+                   "lock; activities will not be cached");
+      cache_lock = NULL;
+      return;
     }
+#endif
 
-  key.dptr = (char *)activity_id;
-  key.dsize = strlen(activity_id) + 1;  /* null-term'd */
-  status = apr_dbm_fetch(dbm, key, &value);
-  if (status != APR_SUCCESS)
+  cache_pool = svn_pool_create(p);
+  cache = apr_hash_make(cache_pool);
+  apr_pool_cleanup_register(p, NULL, close_cache, apr_pool_cleanup_null);
+}
+
+
+const char *dav_svn_get_txn(const dav_svn_repos *repos,
+                            const char *activity_id)
+{
+  const char *txn_name = NULL;
+  svn_error_t *serr;
+
+  lock_cache();
+  if (cache != NULL)
     {
-      /* ### again: assume failure means it doesn't exist */
-      apr_dbm_close(dbm);
-      return NULL;
+      txn_name = apr_hash_get(cache, make_key(repos, activity_id, repos->pool),
+                              APR_HASH_KEY_STRING);
+      if (txn_name != NULL)
+        txn_name = apr_pstrdup(repos->pool, txn_name);
     }
+  unlock_cache();
 
-  txn_name = apr_pstrdup(repos->pool, value.dptr);   /* null-term'd */
-  apr_dbm_freedatum(dbm, value);
+  if (txn_name != NULL)
+    return txn_name;
 
-  apr_dbm_close(dbm);
+  /* Not seen here before: look it up in the filesystem. */
+  serr = svn_fs_activity_txn(&txn_name, repos->fs, activity_id, repos->pool);
+  if (serr != NULL)
+    {
+      /* ### let's just assume that any error means the activity
+         ### doesn't exist */
+      svn_error_clear_all(serr);
+      return NULL;
+    }
+
+  if (txn_name != NULL)
+    cache_activity(repos, activity_id, txn_name);
 
   return txn_name;
 }
@@ -76,34 +193,30 @@ dav_error *dav_svn_store_activity(const dav_svn_repos *repos,
                                   const char *activity_id,
                                   const char *txn_name)
 {
-  apr_dbm_t *dbm;
-  apr_status_t status;
-  svn_stringbuf_t *pathname;
-  apr_datum_t key;
-  apr_datum_t value;
-
-  pathname = svn_stringbuf_create(repos->fs_path, repos->pool);
-  svn_path_add_component_nts(pathname, ACTIVITY_DB);
-  status = apr_dbm_open(&dbm, pathname->data, APR_DBM_RWCREATE,
-                        APR_OS_DEFAULT, repos->pool);
-  if (status != APR_SUCCESS)
-    {
-      /* ### return an error */
-      return NULL;
-    }
+  svn_error_t *serr;
 
-  key.dptr = (char *)activity_id;
-  key.dsize = strlen(activity_id) + 1;  /* null-term'd */
-  value.dptr = (char *)txn_name;
-  value.dsize = strlen(txn_name) + 1;   /* null-term'd */
-  status = apr_dbm_store(dbm, key, value);
-  apr_dbm_close(dbm);
-  if (status != APR_SUCCESS)
-    {
-      /* ### return an error */
-      return NULL;
-    }
+  serr = svn_fs_set_activity_txn(repos->fs, activity_id, txn_name,
+                                 repos->pool);
+  if (serr != NULL)
+    return dav_svn_convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                               "could not record the activity's "
+                               "transaction");
 
+  cache_activity(repos, activity_id, txn_name);
+  return NULL;
+}
+
+dav_error *dav_svn_forget_activity(const dav_svn_repos *repos,
+                                   const char *activity_id)
+{
+  svn_error_t *serr;
+
+  cache_activity(repos, activity_id, NULL);
+
+  serr = svn_fs_set_activity_txn(repos->fs, activity_id, NULL, repos->pool);
+  if (serr != NULL)
+    return dav_svn_convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                               "could not forget the activity");
   return NULL;
 }
 
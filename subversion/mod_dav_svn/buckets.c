@@ -0,0 +1,237 @@
+/*
+ * buckets.c: a bucket type for reading file contents from the FS
+ *
+ * ====================================================================
+ * Copyright (c) 2000-2002 CollabNet.  All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.  The terms
+ * are also available at http://subversion.tigris.org/license-1.html.
+ * If newer versions of this license are posted there, you may use a
+ * newer version instead, at your option.
+ *
+ * This software consists of voluntary contributions made by many
+ * individuals.  For exact contribution history, see the revision
+ * history and logs, available at http://subversion.tigris.org/.
+ * ====================================================================
+ */
+
+
+
+#include <string.h>
+
+#include <httpd.h>
+#include <http_log.h>
+#include <mod_dav.h>
+
+#include <apr_pools.h>
+
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_fs.h"
+#include "svn_io.h"
+
+#include "dav_svn.h"
+
+
+/* An FS bucket stands for a range of a file's contents, and reads
+   nothing from the FS until it is itself read.  It works like a FILE
+   bucket: reading it turns it into a HEAP bucket holding the first
+   chunk of its range, followed by a new FS bucket for the rest.  So a
+   GET can hand the whole file to the output filters at once, and they
+   read it a chunk at a time, keeping whatever they need without
+   copying it.
+
+   Splitting an FS bucket only divides the range, so the byterange
+   filter can pick out the parts of the file a Range header asks for
+   without anything being read; each part's stream then starts at its
+   own offset (see svn_fs_file_contents_at).  */
+
+/* The file all the pieces of one FS bucket read from.  Reads usually
+   carry on from where the last one stopped, so the stream is kept
+   for the next piece, and only opened afresh if a read starts
+   anywhere else.  */
+typedef struct {
+  apr_bucket_refcount refcount;
+
+  /* The file, and the request reading it, whose pool holds the root
+     and everything the bucket allocates. */
+  svn_fs_root_t *root;
+  const char *path;
+  request_rec *r;
+
+  /* The stream, and the offset it will read from next. */
+  svn_stream_t *stream;
+  apr_size_t stream_offset;
+
+} dav_svn_fs_file;
+
+
+static void fs_bucket_destroy(void *data)
+{
+  dav_svn_fs_file *f = data;
+
+  if (apr_bucket_shared_destroy(f))
+    apr_bucket_free(f);
+}
+
+/* Read LEN bytes of F, starting at OFFSET, into BUF. */
+static apr_status_t read_fs_file(dav_svn_fs_file *f, apr_size_t offset,
+                                 char *buf, apr_size_t len)
+{
+  svn_error_t *serr = NULL;
+  apr_size_t got;
+
+  if (f->stream == NULL || f->stream_offset != offset)
+    {
+      serr = svn_fs_file_contents_at(&f->stream, f->root, f->path,
+                                     offset, f->r->pool);
+      if (serr != NULL)
+        f->stream = NULL;
+      f->stream_offset = offset;
+    }
+
+  /* The rep may hand over less than we ask for at a time. */
+  while (serr == NULL && len > 0)
+    {
+      got = len;
+      serr = svn_stream_read(f->stream, buf, &got);
+      if (serr == NULL && got == 0)
+        serr = svn_error_createf(SVN_ERR_FS_CORRUPT, 0, NULL, f->r->pool,
+                                 "`%s' ended before its recorded length",
+                                 f->path);
+      buf += got;
+      len -= got;
+      f->stream_offset += got;
+    }
+
+  if (serr != NULL)
+    {
+      apr_status_t status = serr->apr_err;
+
+      ap_log_rerror(APLOG_MARK, APLOG_ERR, status, f->r,
+                    "could not read the file contents: %s",
+                    serr->message ? serr->message : "");
+      svn_error_clear_all(serr);
+
+      /* Don't trust the stream's position after a failed read. */
+      f->stream = NULL;
+      return status;
+    }
+
+  return APR_SUCCESS;
+}
+
+static apr_status_t fs_bucket_read(apr_bucket *e, const char **str,
+                                   apr_size_t *len, apr_read_type_e block)
+{
+  dav_svn_fs_file *f = e->data;
+  apr_size_t offset = (apr_size_t) e->start;
+  apr_size_t remaining = e->length;
+  apr_size_t amount = remaining;
+  apr_bucket *rest;
+  apr_status_t status;
+  char *buf;
+
+  if (amount > SVN_STREAM_CHUNK_SIZE)
+    amount = SVN_STREAM_CHUNK_SIZE;
+
+  buf = apr_bucket_alloc(amount, e->list);
+  status = read_fs_file(f, offset, buf, amount);
+  if (status != APR_SUCCESS)
+    {
+      apr_bucket_free(buf);
+      return status;
+    }
+
+  /* This bucket becomes the chunk just read.  If there is more, a new
+     FS bucket for it takes over this one's reference to F. */
+  apr_bucket_heap_make(e, buf, amount, apr_bucket_free);
+  *str = buf;
+  *len = amount;
+
+  if (remaining > amount)
+    {
+      rest = apr_bucket_alloc(sizeof(*rest), e->list);
+      APR_BUCKET_INIT(rest);
+      rest->start = offset + amount;
+      rest->length = remaining - amount;
+      rest->data = f;
+      rest->type = &dav_svn_bucket_type_fs;
+      rest->free = apr_bucket_free;
+      rest->list = e->list;
+      APR_BUCKET_INSERT_AFTER(e, rest);
+    }
+  else
+    fs_bucket_destroy(f);
+
+  return APR_SUCCESS;
+}
+
+/* The FS root lives in the request's pool, so an FS bucket can't be
+   kept any longer than that.  If it is to be set aside in a pool that
+   might outlive the request, read it all into memory now. */
+static apr_status_t fs_bucket_setaside(apr_bucket *e, apr_pool_t *pool)
+{
+  dav_svn_fs_file *f = e->data;
+  apr_size_t amount = e->length;
+  apr_status_t status;
+  char *buf;
+
+  if (apr_pool_is_ancestor(f->r->pool, pool))
+    return APR_SUCCESS;
+
+  buf = apr_bucket_alloc(amount, e->list);
+  status = read_fs_file(f, (apr_size_t) e->start, buf, amount);
+  if (status != APR_SUCCESS)
+    {
+      apr_bucket_free(buf);
+      return status;
+    }
+
+  fs_bucket_destroy(f);
+  apr_bucket_heap_make(e, buf, amount, apr_bucket_free);
+  return APR_SUCCESS;
+}
+
+
+const apr_bucket_type_t dav_svn_bucket_type_fs = {
+  "SVN_FS", 5,
+  fs_bucket_destroy,
+  fs_bucket_read,
+  fs_bucket_setaside,
+  apr_bucket_shared_split,
+  apr_bucket_shared_copy
+};
+
+
+apr_bucket *dav_svn_bucket_fs_create(svn_fs_root_t *root,
+                                     const char *path,
+                                     apr_size_t length,
+                                     request_rec *r,
+                                     apr_bucket_alloc_t *list)
+{
+  apr_bucket *e = apr_bucket_alloc(sizeof(*e), list);
+  dav_svn_fs_file *f = apr_bucket_alloc(sizeof(*f), list);
+
+  f->root = root;
+  f->path = path;
+  f->r = r;
+  f->stream = NULL;
+  f->stream_offset = 0;
+
+  APR_BUCKET_INIT(e);
+  e->free = apr_bucket_free;
+  e->list = list;
+  e = apr_bucket_shared_make(e, f, 0, length);
+  e->type = &dav_svn_bucket_type_fs;
+
+  return e;
+}
+
+
+/*
+ * local variables:
+ * eval: (load-file "../../tools/dev/svn-dev.el")
+ * end:
+ */
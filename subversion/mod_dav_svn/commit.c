@@ -0,0 +1,362 @@
+/*
+ * commit.c: handle a whole commit sent in a single POST
+ *
+ * ====================================================================
+ * Copyright (c) 2000-2002 CollabNet.  All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.  The terms
+ * are also available at http://subversion.tigris.org/license-1.html.
+ * If newer versions of this license are posted there, you may use a
+ * newer version instead, at your option.
+ *
+ * This software consists of voluntary contributions made by many
+ * individuals.  For exact contribution history, see the revision
+ * history and logs, available at http://subversion.tigris.org/.
+ * ====================================================================
+ */
+
+
+
+#include <string.h>
+
+#include <httpd.h>
+#include <http_log.h>
+#include <http_protocol.h>
+#include <mod_dav.h>
+
+#include <apr_pools.h>
+#include <apr_strings.h>
+#include <apr_xml.h>
+
+#include "svn_error.h"
+#include "svn_string.h"
+#include "svn_io.h"
+#include "svn_delta.h"
+#include "svn_repos.h"
+#include "svn_dav.h"
+
+#include "dav_svn.h"
+
+
+/* A commit the usual way takes a round trip for the activity, one for
+   each CHECKOUT, PUT, PROPPATCH, DELETE or COPY, and one for the MERGE.
+   A client which sees SVN_DAV_OPTION_SINGLE_COMMIT in our OPTIONS
+   response can instead POST the whole editor drive to the collection
+   it is committing in, with a Content-Type of SVN_DAV_COMMIT_MIME_TYPE
+   (see svn_dav.h for the body's format).  We replay the drive into the
+   repository's commit editor as it arrives, and answer with the same
+   body as a successful MERGE, so the client learns the new revision
+   and the new version resources the same way either way.  */
+
+/* The longest log message we accept, whatever the body's length. */
+#define MAX_LOG_LENGTH (16 * 1024 * 1024)
+
+/* How much of the log message to read at a time. */
+#define LOG_CHUNK_SIZE 8192
+
+
+/* Baton for a stream reading the request body. */
+struct body_baton
+{
+  request_rec *r;
+  apr_pool_t *pool;
+};
+
+static svn_error_t *read_body(void *baton, char *buffer, apr_size_t *len)
+{
+  struct body_baton *bb = baton;
+  long got;
+
+  got = ap_get_client_block(bb->r, buffer, *len);
+  if (got < 0)
+    return svn_error_create(SVN_ERR_EDITOR_DRIVE_UNEXPECTED_END, 0, NULL,
+                            bb->pool, "Could not read the request body.");
+
+  *len = got;
+  return SVN_NO_ERROR;
+}
+
+/* Return a stream reading R's body, which has been set up for reading
+   with ap_setup_client_block. */
+static svn_stream_t *body_stream(request_rec *r)
+{
+  struct body_baton *bb = apr_palloc(r->pool, sizeof(*bb));
+  svn_stream_t *stream = svn_stream_create(bb, r->pool);
+
+  bb->r = r;
+  bb->pool = r->pool;
+  svn_stream_set_read(stream, read_body);
+  return stream;
+}
+
+
+/* Read the log message at the start of a commit body from STREAM into
+   *LOG_MSG, allocated in POOL.  The message may be no longer than
+   MAX_LEN bytes.
+
+   The message is read as it arrives rather than allocated at the
+   length the body declares, so a client can't make us allocate more
+   than it actually sends. */
+static svn_error_t *read_log_msg(svn_string_t *log_msg,
+                                 svn_stream_t *stream,
+                                 apr_size_t max_len,
+                                 apr_pool_t *pool)
+{
+  apr_size_t log_len = 0;
+  apr_size_t len;
+  char c;
+  char buf[LOG_CHUNK_SIZE];
+  svn_stringbuf_t *data;
+  int digits = 0;
+
+  while (1)
+    {
+      len = 1;
+      SVN_ERR( svn_stream_read(stream, &c, &len) );
+      if (len == 0 || c == '\n')
+        break;
+      if (c < '0' || c > '9')
+        return svn_error_create(SVN_ERR_EDITOR_DRIVE_CORRUPT, 0, NULL, pool,
+                                "The commit body does not start with the "
+                                "log message's length.");
+      if (log_len > max_len / 10 || log_len * 10 + (c - '0') > max_len)
+        return svn_error_create(SVN_ERR_EDITOR_DRIVE_CORRUPT, 0, NULL, pool,
+                                "The commit body's log message is too "
+                                "long.");
+      log_len = log_len * 10 + (c - '0');
+      digits++;
+    }
+  if (len == 0 || digits == 0)
+    return svn_error_create(SVN_ERR_EDITOR_DRIVE_UNEXPECTED_END, 0, NULL,
+                            pool, "The commit body ended before the log "
+                            "message.");
+
+  data = svn_stringbuf_create("", pool);
+  while (data->len < log_len)
+    {
+      len = log_len - data->len;
+      if (len > sizeof(buf))
+        len = sizeof(buf);
+      SVN_ERR( svn_stream_read(stream, buf, &len) );
+      if (len == 0)
+        return svn_error_create(SVN_ERR_EDITOR_DRIVE_UNEXPECTED_END, 0, NULL,
+                                pool, "The commit body ended in the log "
+                                "message.");
+      svn_stringbuf_appendbytes(data, buf, len);
+    }
+
+  log_msg->data = data->data;
+  log_msg->len = data->len;
+  return SVN_NO_ERROR;
+}
+
+
+/* An instance of svn_repos_commit_callback_t; BATON is where to put
+   the new revision. */
+static svn_error_t *record_new_rev(svn_revnum_t new_revision,
+                                   const char *date,
+                                   const char *author,
+                                   void *baton)
+{
+  svn_revnum_t *new_rev = baton;
+
+  *new_rev = new_revision;
+  return SVN_NO_ERROR;
+}
+
+
+/* The close_edit and abort_edit of an editor composed in front of the
+   commit editor: note, in the svn_boolean_t that EDIT_BATON points to,
+   that the drive has reached its end.  From then on the commit editor
+   has committed or aborted the transaction itself, whether or not it
+   succeeded, so it must not be aborted again. */
+static svn_error_t *note_drive_done(void *edit_baton)
+{
+  svn_boolean_t *done = edit_baton;
+
+  *done = TRUE;
+  return SVN_NO_ERROR;
+}
+
+
+/* Log ERR, and send the innermost tagged error in it as a <D:error>
+   body, the way mod_dav does for the methods it handles.  Return the
+   value the handler should return. */
+static int send_error(request_rec *r, dav_error *err)
+{
+  dav_error *errscan;
+
+  for (errscan = err; errscan != NULL; errscan = errscan->prev)
+    ap_log_rerror(APLOG_MARK, APLOG_ERR, errscan->save_errno, r,
+                  "%s  [%d, #%d]",
+                  errscan->desc, errscan->status, errscan->error_id);
+
+  for (errscan = err; errscan != NULL; errscan = errscan->prev)
+    if (errscan->tagname != NULL)
+      break;
+  if (errscan == NULL)
+    return err->status;
+
+  r->status = errscan->status;
+  r->status_line = ap_get_status_line(errscan->status);
+  r->content_type = "text/xml; charset=\"utf-8\"";
+
+  ap_rputs(DAV_XML_HEADER DEBUG_CR
+           "<D:error xmlns:D=\"DAV:\" "
+           "xmlns:m=\"http://apache.org/dav/xmlns\" "
+           "xmlns:C=\"" SVN_DAV_ERROR_NAMESPACE "\">" DEBUG_CR, r);
+  ap_rprintf(r, "<C:%s/>" DEBUG_CR, errscan->tagname);
+  if (errscan->desc != NULL)
+    ap_rprintf(r,
+               "<m:human-readable errcode=\"%d\">" DEBUG_CR
+               "%s" DEBUG_CR
+               "</m:human-readable>" DEBUG_CR,
+               errscan->error_id,
+               apr_xml_quote_string(r->pool, errscan->desc, 0));
+  ap_rputs("</D:error>" DEBUG_CR, r);
+
+  return DONE;
+}
+
+
+int dav_svn_commit_handler(request_rec *r)
+{
+  const char *ct, *root_dir;
+  dav_resource *resource;
+  dav_svn_repos *repos;
+  dav_error *derr;
+  svn_error_t *serr;
+  svn_stream_t *body;
+  svn_string_t log_msg;
+  apr_size_t max_log_len;
+  const svn_delta_editor_t *commit_editor, *editor;
+  svn_delta_editor_t *tracker;
+  void *commit_baton, *edit_baton;
+  svn_boolean_t drive_done = FALSE;
+  svn_revnum_t new_rev = SVN_INVALID_REVNUM;
+  int status;
+
+  if (r->method_number != M_POST || dav_svn_get_fs_path(r) == NULL)
+    return DECLINED;
+
+  ct = apr_table_get(r->headers_in, "content-type");
+  if (ct == NULL || strcmp(ct, SVN_DAV_COMMIT_MIME_TYPE) != 0)
+    return DECLINED;
+
+  if ((root_dir = dav_svn_get_root_dir(r)) == NULL)
+    return DECLINED;
+
+  derr = dav_svn_hooks_repos.get_resource(r, root_dir, NULL, 0, &resource);
+  if (derr != NULL)
+    {
+      (void) ap_discard_request_body(r);
+      return send_error(r, derr);
+    }
+  repos = resource->info->repos;
+
+  dav_svn_metrics_set_kind(r, DAV_SVN_REQUEST_COMMIT);
+
+  if (resource->type != DAV_RESOURCE_TYPE_REGULAR
+      || !resource->exists || !resource->collection)
+    {
+      (void) ap_discard_request_body(r);
+      return send_error(r, dav_new_error_tag(r->pool, HTTP_CONFLICT,
+                                             SVN_ERR_INCORRECT_PARAMS,
+                                             "A commit can only be posted "
+                                             "to an existing collection.",
+                                             SVN_DAV_ERROR_NAMESPACE,
+                                             SVN_DAV_ERROR_TAG));
+    }
+
+  if ((status = ap_setup_client_block(r, REQUEST_CHUNKED_DECHUNK)) != OK)
+    return status;
+  if (!ap_should_client_block(r))
+    return send_error(r, dav_new_error_tag(r->pool, HTTP_BAD_REQUEST,
+                                           SVN_ERR_EDITOR_DRIVE_UNEXPECTED_END,
+                                           "The commit body is empty.",
+                                           SVN_DAV_ERROR_NAMESPACE,
+                                           SVN_DAV_ERROR_TAG));
+  body = body_stream(r);
+
+  /* The log message can't be longer than the body, when we know how
+     long that is. */
+  max_log_len = MAX_LOG_LENGTH;
+  if (!r->read_chunked && r->remaining > 0 && r->remaining < max_log_len)
+    max_log_len = (apr_size_t) r->remaining;
+
+  serr = read_log_msg(&log_msg, body, max_log_len, r->pool);
+  if (serr != NULL)
+    {
+      (void) ap_discard_request_body(r);
+      return send_error(r, dav_svn_convert_err(serr, HTTP_BAD_REQUEST,
+                                               "Could not read the log "
+                                               "message."));
+    }
+
+  serr = svn_repos_get_commit_editor(&commit_editor, &commit_baton,
+                                     repos->repos,
+                                     ap_construct_url(r->pool, root_dir, r),
+                                     resource->info->repos_path,
+                                     repos->username, &log_msg,
+                                     record_new_rev, &new_rev, r->pool);
+  if (serr != NULL)
+    {
+      (void) ap_discard_request_body(r);
+      return send_error(r, dav_svn_convert_err(serr,
+                                               HTTP_INTERNAL_SERVER_ERROR,
+                                               "Could not start the "
+                                               "commit."));
+    }
+
+  tracker = svn_delta_default_editor(r->pool);
+  tracker->close_edit = note_drive_done;
+  tracker->abort_edit = note_drive_done;
+  svn_delta_compose_editors(&editor, &edit_baton, tracker, &drive_done,
+                            commit_editor, commit_baton, r->pool);
+
+  /* Replay the drive as it arrives.  A drive that is cut short or
+     fails partway leaves the transaction to be aborted; one that gets
+     as far as close_edit or abort_edit has left the commit editor to
+     commit or abort it. */
+  serr = svn_delta_binary_parse(body, editor, edit_baton, r->pool);
+  if (serr == NULL && !SVN_IS_VALID_REVNUM(new_rev))
+    serr = svn_error_create(SVN_ERR_INCORRECT_PARAMS, 0, NULL, r->pool,
+                            "The commit body aborted the commit.");
+  if (serr != NULL)
+    {
+      int http_status;
+
+      if (!drive_done)
+        svn_error_clear_all(commit_editor->abort_edit(commit_baton));
+      (void) ap_discard_request_body(r);
+
+      if (serr->apr_err == SVN_ERR_EDITOR_DRIVE_INVALID_HEADER
+          || serr->apr_err == SVN_ERR_EDITOR_DRIVE_CORRUPT
+          || serr->apr_err == SVN_ERR_EDITOR_DRIVE_UNEXPECTED_END)
+        http_status = HTTP_BAD_REQUEST;
+      else
+        http_status = HTTP_CONFLICT;
+
+      return send_error(r, dav_svn_convert_err(serr, http_status,
+                                               "An error occurred while "
+                                               "committing the posted "
+                                               "changes."));
+    }
+
+  /* process the response for the new revision. */
+  r->content_type = "text/xml; charset=\"utf-8\"";
+  derr = dav_svn__merge_response(r->output_filters, repos, new_rev,
+                                 NULL, r->pool);
+  if (derr != NULL)
+    return send_error(r, derr);
+
+  return OK;
+}
+
+
+/*
+ * local variables:
+ * eval: (load-file "../../tools/dev/svn-dev.el")
+ * end:
+ */
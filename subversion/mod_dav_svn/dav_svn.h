@@ -44,7 +44,8 @@ extern "C" {
  *
  * Note that we do not refcount this structure. Presumably, we will need
  * it throughout the life of the request. Therefore, we can just leave it
- * for the request pool to cleanup/close.
+ * for the request pool to cleanup/close. (The open svn_repos_t itself
+ * outlives the request; see dav_svn_open_repos.)
  *
  * Also, note that it is possible that two resources may have distinct
  * dav_svn_repos structures, yet refer to the same repository. This is
@@ -192,6 +193,10 @@ struct dav_resource_private {
 
   /* ### record the base for computing a delta during a GET */
   const char *delta_base;
+
+  /* for REGULAR resources: TRUE if the resource was reached through a
+     Baseline Collection, so that its URL names a specific revision */
+  int in_baseline_coll;
 };
 
 
@@ -230,6 +235,29 @@ void dav_svn_insert_all_liveprops(request_rec *r, const dav_resource *resource,
 /* register our live property URIs with mod_dav. */
 void dav_svn_register_uris(apr_pool_t *p);
 
+/* Set *INFO to the ID, kind and created revision of PATH in ROOT. If
+   ENTRIES is not NULL, set *ENTRIES to the same for each of PATH's
+   entries, or to NULL if PATH is a file (see svn_fs_node_info).
+
+   Nothing in a revision root changes, so for those, the answers are
+   kept in POOL for the rest of the request, entries included. Walking
+   a collection asks for its entries once, and every member's live
+   properties are then found without going back to the FS. */
+svn_error_t *dav_svn_get_node_info(const svn_fs_node_info_t **info,
+                                   apr_hash_t **entries,
+                                   svn_fs_root_t *root,
+                                   const char *path,
+                                   apr_pool_t *pool);
+
+/* Set *VALUE to the revision property NAME of REV in FS, or to NULL if
+   it is not set. A revision's properties are read all at once, and
+   kept in POOL for the rest of the request. */
+svn_error_t *dav_svn_get_rev_prop(const svn_string_t **value,
+                                  svn_fs_t *fs,
+                                  svn_revnum_t rev,
+                                  const char *name,
+                                  apr_pool_t *pool);
+
 /* generate an ETag for the given resource and return it. */
 const char * dav_svn_getetag(const dav_resource *resource);
 
@@ -269,12 +297,111 @@ const char *dav_svn_get_fs_path(request_rec *r);
    the root_dir when the resource structure is built.
 */
 
+/* Return the URL path of the Location this request's repository is
+   configured at, without a trailing slash (unless it is "/"), or NULL
+   if it isn't configured at one. */
+const char *dav_svn_get_root_dir(request_rec *r);
+
 /* Return the special URI to be used for this resource. */
 const char *dav_svn_get_special_uri(request_rec *r);
 
 /* Return a descriptive name for the repository */
 const char *dav_svn_get_repo_name(request_rec *r);
 
+/* Return whether commits should queue the repository's post-commit
+   hook rather than wait for it (see svn_repos_set_post_commit_async) */
+int dav_svn_get_async_post_commit(request_rec *r);
+
+/* Return how many worker threads updates should compute deltas on
+   (see svn_repos_set_delta_threads) */
+int dav_svn_get_delta_threads(request_rec *r);
+
+/* Return how many open repository handles each process should keep
+   for later requests to reuse */
+int dav_svn_get_repos_cache_size(request_rec *r);
+
+/* Set up this process's cache of open repository handles; P is the
+   process's pool. */
+void dav_svn_init_handles(apr_pool_t *p, server_rec *s);
+
+/* Set *REPOS to an open repository at FS_PATH for R to use: one that
+   an earlier request in this process has finished with, if there is
+   one, or else a newly opened one. Either way, it is R's alone until
+   R's pool is cleaned up, and then it is kept open for later requests
+   (see dav_svn_get_repos_cache_size). */
+svn_error_t *dav_svn_open_repos(svn_repos_t **repos,
+                                const char *fs_path,
+                                request_rec *r);
+
+/* How well the repository handle cache is doing, since the process
+   started */
+typedef struct {
+  unsigned long hits;           /* requests given an idle handle */
+  unsigned long misses;         /* requests that opened a repository */
+  int idle;                     /* idle handles in the cache now */
+} dav_svn_handle_stats;
+
+/* Set *STATS_P to the repository handle cache's statistics */
+void dav_svn_get_handle_stats(dav_svn_handle_stats *stats_p);
+
+/* Return the most memory, in bytes, each process should use to keep
+   computed svndiffs for later requests */
+apr_size_t dav_svn_get_delta_cache_size(request_rec *r);
+
+/* Set up this process's cache of computed svndiffs; P is the process's
+   pool. */
+void dav_svn_init_delta_cache(apr_pool_t *p, server_rec *s);
+
+/* Return the size of the biggest svndiff R may add to the delta cache,
+   or 0 if R should not use the cache at all. */
+apr_size_t dav_svn_delta_cache_limit(request_rec *r);
+
+/* If the delta cache has the svndiff from the node revision BASE_ID to
+   TARGET_ID in the repository at FS_PATH, send it to OUTPUT, followed
+   by an EOS, and set *DELIVERED to 1; otherwise set it to 0.  YOUNGEST
+   is the repository's youngest revision.  Use POOL for allocations. */
+dav_error *dav_svn_deliver_cached_delta(int *delivered,
+                                        const char *fs_path,
+                                        const char *base_id,
+                                        const char *target_id,
+                                        svn_revnum_t youngest,
+                                        ap_filter_t *output,
+                                        apr_pool_t *pool);
+
+/* Add SVNDIFF, computed by R from BASE_ID to TARGET_ID in the repository
+   at FS_PATH whose youngest revision is YOUNGEST, to the delta cache,
+   evicting the least recently used entries to make room. */
+void dav_svn_cache_delta(request_rec *r,
+                         const char *fs_path,
+                         const char *base_id,
+                         const char *target_id,
+                         svn_revnum_t youngest,
+                         const svn_stringbuf_t *svndiff);
+
+/* How well the delta cache is doing, since the process started */
+typedef struct {
+  unsigned long hits;           /* deltas sent from the cache */
+  unsigned long misses;         /* deltas looked for and computed */
+  unsigned long evictions;      /* entries thrown away */
+  unsigned long entries;        /* entries in the cache now */
+  apr_size_t bytes;             /* the memory they take */
+} dav_svn_delta_cache_stats;
+
+/* Set *STATS_P to the delta cache's statistics */
+void dav_svn_get_delta_cache_stats(dav_svn_delta_cache_stats *stats_p);
+
+/* A bucket type that reads a file's contents from the FS on demand */
+extern const apr_bucket_type_t dav_svn_bucket_type_fs;
+
+/* Return a bucket, allocated in LIST, for the LENGTH bytes of the file
+   PATH in ROOT, which R will read.  The bucket must not outlive R's
+   pool, in which ROOT must have been opened. */
+apr_bucket *dav_svn_bucket_fs_create(svn_fs_root_t *root,
+                                     const char *path,
+                                     apr_size_t length,
+                                     request_rec *r,
+                                     apr_bucket_alloc_t *list);
+
 /* convert an svn_error_t into a dav_error, possibly pushing a message. use
    the provided HTTP status for the DAV errors */
 dav_error * dav_svn_convert_err(const svn_error_t *serr, int status,
@@ -290,6 +417,57 @@ dav_error *dav_svn_create_activity(const dav_svn_repos *repos,
                                    const char **ptxn_name,
                                    apr_pool_t *pool);
 
+/* Stop recording ACTIVITY_ID in REPOS, whose transaction is about to
+   be committed */
+dav_error *dav_svn_forget_activity(const dav_svn_repos *repos,
+                                   const char *activity_id);
+
+/* Set up this process's cache of activities; P is the process's pool. */
+void dav_svn_init_activities(apr_pool_t *p, server_rec *s);
+
+/* The kinds of request counted in the metrics */
+typedef enum {
+  DAV_SVN_REQUEST_OTHER,
+  DAV_SVN_REQUEST_GET,
+  DAV_SVN_REQUEST_GET_DELTA,    /* a GET answered with an svndiff */
+  DAV_SVN_REQUEST_PROPFIND,
+  DAV_SVN_REQUEST_PROPPATCH,
+  DAV_SVN_REQUEST_OPTIONS,
+  DAV_SVN_REQUEST_REPORT,       /* a REPORT of no known kind */
+  DAV_SVN_REQUEST_UPDATE_REPORT,
+  DAV_SVN_REQUEST_LOG_REPORT,
+  DAV_SVN_REQUEST_MKACTIVITY,
+  DAV_SVN_REQUEST_CHECKOUT,
+  DAV_SVN_REQUEST_PUT,
+  DAV_SVN_REQUEST_DELETE,
+  DAV_SVN_REQUEST_MKCOL,
+  DAV_SVN_REQUEST_COPY,
+  DAV_SVN_REQUEST_MERGE,
+  DAV_SVN_REQUEST_COMMIT,       /* a whole commit in one POST */
+  DAV_SVN_REQUEST_KINDS         /* the number of kinds */
+} dav_svn_request_kind;
+
+/* The handler name ("SetHandler svn-metrics") for the metrics page */
+#define DAV_SVN_METRICS_HANDLER "svn-metrics"
+
+/* Set up this process's metrics; P is the process's pool. */
+void dav_svn_init_metrics(apr_pool_t *p, server_rec *s);
+
+/* Start counting R, which uses the filesystem FS, as a request of the
+   kind its method suggests.  Only the first call for a request counts;
+   subrequests aren't counted. */
+void dav_svn_metrics_begin(request_rec *r, svn_fs_t *fs);
+
+/* Count R, if it is being counted, as a request of kind KIND. */
+void dav_svn_metrics_set_kind(request_rec *r, dav_svn_request_kind kind);
+
+/* The handler for the metrics page. */
+int dav_svn_metrics_handler(request_rec *r);
+
+/* The handler for a commit POSTed as a single request (see
+   SVN_DAV_COMMIT_MIME_TYPE). */
+int dav_svn_commit_handler(request_rec *r);
+
 /*
   Construct a working resource for a given resource.
 
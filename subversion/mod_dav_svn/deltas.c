@@ -0,0 +1,364 @@
+/*
+ * deltas.c: keeping computed svndiffs for later requests
+ *
+ * ====================================================================
+ * Copyright (c) 2000-2002 CollabNet.  All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.  The terms
+ * are also available at http://subversion.tigris.org/license-1.html.
+ * If newer versions of this license are posted there, you may use a
+ * newer version instead, at your option.
+ *
+ * This software consists of voluntary contributions made by many
+ * individuals.  For exact contribution history, see the revision
+ * history and logs, available at http://subversion.tigris.org/.
+ * ====================================================================
+ */
+
+
+
+#include <string.h>
+
+#include <httpd.h>
+#include <http_log.h>
+#include <mod_dav.h>
+
+#include <apr_pools.h>
+#include <apr_strings.h>
+#include <apr_hash.h>
+#if APR_HAS_THREADS
+#include <apr_thread_mutex.h>
+#endif
+
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_string.h"
+
+#include "dav_svn.h"
+
+
+/* After a commit to a much-used file, every client that updates asks
+   for the same delta: from the file's previous node revision to its
+   new one.  Each server process keeps the svndiffs it has computed
+   for such GETs, keyed by the repository and the two node revision
+   IDs, and later requests for the same delta are sent the svndiff
+   straight from memory.
+
+   Committed node revisions never change, so neither do the deltas
+   between them; only deltas to a node in a revision root are kept.
+   A repository that is deleted and created afresh at the same path
+   will reuse the IDs, though, so each entry also notes the youngest
+   revision when it was made, and is thrown away if the repository is
+   found to have gone backwards since.
+
+   Each entry lives in a root pool of its own, so that evicting it
+   gives its memory back.  The entries are kept in order of last use,
+   and the least recently used go first when the cache is over its
+   size (see dav_svn_get_delta_cache_size).  */
+
+typedef struct dav_svn_delta_entry {
+  /* The entry's key, and the svndiff. */
+  const char *key;
+  const char *data;
+  apr_size_t len;
+
+  /* The youngest revision of the repository when the entry was made. */
+  svn_revnum_t youngest;
+
+  /* How many bytes the entry is counted as taking. */
+  apr_size_t size;
+
+  /* The number of requests sending the svndiff right now, and whether
+     the entry has been evicted; the last of them to finish destroys an
+     evicted entry. */
+  int users;
+  int evicted;
+
+  /* The root pool the entry lives in. */
+  apr_pool_t *pool;
+
+  /* The more and less recently used entries. */
+  struct dav_svn_delta_entry *prev;
+  struct dav_svn_delta_entry *next;
+
+} dav_svn_delta_entry;
+
+/* The entries by key, and in order of use, most recent first. CACHE
+   is NULL outside the life of the process's pool. */
+static apr_hash_t *cache;
+static dav_svn_delta_entry *newest;
+static dav_svn_delta_entry *oldest;
+
+/* The total size of the entries, and the counts for the statistics. */
+static dav_svn_delta_cache_stats stats;
+
+#if APR_HAS_THREADS
+/* Protects all of the above, and the entries' USERS and EVICTED. */
+static apr_thread_mutex_t *cache_lock;
+#endif
+
+
+static void lock_cache(void)
+{
+#if APR_HAS_THREADS
+  if (cache_lock)
+    apr_thread_mutex_lock(cache_lock);
+#endif
+}
+
+static void unlock_cache(void)
+{
+#if APR_HAS_THREADS
+  if (cache_lock)
+    apr_thread_mutex_unlock(cache_lock);
+#endif
+}
+
+/* Take ENTRY out of the cache, destroying it unless a request is still
+   sending it.  The cache must be locked.  */
+static void evict(dav_svn_delta_entry *entry)
+{
+  apr_hash_set(cache, entry->key, APR_HASH_KEY_STRING, NULL);
+
+  if (entry->prev)
+    entry->prev->next = entry->next;
+  else
+    newest = entry->next;
+  if (entry->next)
+    entry->next->prev = entry->prev;
+  else
+    oldest = entry->prev;
+
+  stats.entries--;
+  stats.bytes -= entry->size;
+  stats.evictions++;
+
+  entry->evicted = 1;
+  if (entry->users == 0)
+    apr_pool_destroy(entry->pool);
+}
+
+/* Make ENTRY the most recently used.  The cache must be locked. */
+static void touch(dav_svn_delta_entry *entry)
+{
+  if (entry == newest)
+    return;
+
+  entry->prev->next = entry->next;
+  if (entry->next)
+    entry->next->prev = entry->prev;
+  else
+    oldest = entry->prev;
+
+  entry->prev = NULL;
+  entry->next = newest;
+  newest->prev = entry;
+  newest = entry;
+}
+
+/* Return the key for the delta from BASE_ID to TARGET_ID in the
+   repository at FS_PATH, allocated in POOL. */
+static const char *make_key(const char *fs_path,
+                            const char *base_id,
+                            const char *target_id,
+                            apr_pool_t *pool)
+{
+  return apr_pstrcat(pool, base_id, " ", target_id, " ", fs_path, NULL);
+}
+
+/* Cleanup for the process's pool: empty the cache. */
+static apr_status_t close_cache(void *data)
+{
+  server_rec *s = data;
+
+  lock_cache();
+  ap_log_error(APLOG_MARK, APLOG_INFO, 0, s,
+               "mod_dav_svn: delta cache: %lu hits, %lu misses, "
+               "%lu evictions",
+               stats.hits, stats.misses, stats.evictions);
+  while (oldest != NULL)
+    evict(oldest);
+  cache = NULL;
+  unlock_cache();
+
+#if APR_HAS_THREADS
+  /* The mutex goes with the pool it was made in. */
+  cache_lock = NULL;
+#endif
+  return APR_SUCCESS;
+}
+
+
+void dav_svn_init_delta_cache(apr_pool_t *p, server_rec *s)
+{
+#if APR_HAS_THREADS
+  apr_status_t status;
+
+  status = apr_thread_mutex_create(&cache_lock, APR_THREAD_MUTEX_DEFAULT, p);
+  if (status != APR_SUCCESS)
+    {
+      /* Without a lock, every delta is computed afresh. */
+      ap_log_error(APLOG_MARK, APLOG_ERR, status, s,
+                   "mod_dav_svn: could not create the delta cache lock; "
+                   "deltas will not be cached");
+      cache_lock = NULL;
+      return;
+    }
+#endif
+
+  memset(&stats, 0, sizeof(stats));
+  newest = oldest = NULL;
+  cache = apr_hash_make(p);
+  apr_pool_cleanup_register(p, s, close_cache, apr_pool_cleanup_null);
+}
+
+
+apr_size_t dav_svn_delta_cache_limit(request_rec *r)
+{
+  apr_size_t limit = dav_svn_get_delta_cache_size(r);
+
+  /* No one delta may take more than an eighth of the cache, so that a
+     few big ones can't push out all the rest. */
+  return cache ? limit / 8 : 0;
+}
+
+
+dav_error *dav_svn_deliver_cached_delta(int *delivered,
+                                        const char *fs_path,
+                                        const char *base_id,
+                                        const char *target_id,
+                                        svn_revnum_t youngest,
+                                        ap_filter_t *output,
+                                        apr_pool_t *pool)
+{
+  const char *key = make_key(fs_path, base_id, target_id, pool);
+  dav_svn_delta_entry *entry;
+  apr_bucket_brigade *bb;
+  apr_status_t status;
+
+  *delivered = 0;
+
+  lock_cache();
+  if (cache == NULL)
+    {
+      unlock_cache();
+      return NULL;
+    }
+
+  entry = apr_hash_get(cache, key, APR_HASH_KEY_STRING);
+  if (entry != NULL && youngest < entry->youngest)
+    {
+      /* The repository has been replaced since the entry was made. */
+      evict(entry);
+      entry = NULL;
+    }
+
+  if (entry == NULL)
+    {
+      stats.misses++;
+      unlock_cache();
+      return NULL;
+    }
+
+  stats.hits++;
+  touch(entry);
+  entry->users++;
+  unlock_cache();
+
+  /* The svndiff is only borrowed until the brigade has been passed on;
+     any filter that holds on to it past then sets it aside. */
+  bb = apr_brigade_create(pool, output->c->bucket_alloc);
+  APR_BRIGADE_INSERT_TAIL(bb,
+                          apr_bucket_transient_create(entry->data,
+                                                      entry->len,
+                                                      output->c->bucket_alloc));
+  APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_eos_create(output->c->bucket_alloc));
+  status = ap_pass_brigade(output, bb);
+
+  lock_cache();
+  if (--entry->users == 0 && entry->evicted)
+    apr_pool_destroy(entry->pool);
+  unlock_cache();
+
+  if (status != APR_SUCCESS)
+    return dav_new_error(pool, HTTP_INTERNAL_SERVER_ERROR, 0,
+                         "Could not write data to filter.");
+
+  *delivered = 1;
+  return NULL;
+}
+
+
+void dav_svn_cache_delta(request_rec *r,
+                         const char *fs_path,
+                         const char *base_id,
+                         const char *target_id,
+                         svn_revnum_t youngest,
+                         const svn_stringbuf_t *svndiff)
+{
+  apr_size_t limit = dav_svn_get_delta_cache_size(r);
+  dav_svn_delta_entry *entry;
+  dav_svn_delta_entry *old;
+  apr_pool_t *pool;
+  char *data;
+
+  if (svndiff->len > dav_svn_delta_cache_limit(r))
+    return;
+
+  if (apr_pool_create(&pool, NULL) != APR_SUCCESS)
+    return;
+
+  entry = apr_pcalloc(pool, sizeof(*entry));
+  entry->key = make_key(fs_path, base_id, target_id, pool);
+  data = apr_palloc(pool, svndiff->len);
+  memcpy(data, svndiff->data, svndiff->len);
+  entry->data = data;
+  entry->len = svndiff->len;
+  entry->youngest = youngest;
+  entry->size = sizeof(*entry) + strlen(entry->key) + entry->len;
+  entry->pool = pool;
+
+  lock_cache();
+  if (cache == NULL)
+    {
+      unlock_cache();
+      apr_pool_destroy(pool);
+      return;
+    }
+
+  /* Another request might have computed the same delta meanwhile. */
+  old = apr_hash_get(cache, entry->key, APR_HASH_KEY_STRING);
+  if (old != NULL)
+    evict(old);
+
+  while (oldest != NULL && stats.bytes + entry->size > limit)
+    evict(oldest);
+
+  entry->next = newest;
+  if (newest)
+    newest->prev = entry;
+  else
+    oldest = entry;
+  newest = entry;
+  apr_hash_set(cache, entry->key, APR_HASH_KEY_STRING, entry);
+
+  stats.entries++;
+  stats.bytes += entry->size;
+  unlock_cache();
+}
+
+
+void dav_svn_get_delta_cache_stats(dav_svn_delta_cache_stats *stats_p)
+{
+  lock_cache();
+  *stats_p = stats;
+  unlock_cache();
+}
+
+
+/*
+ * local variables:
+ * eval: (load-file "../../tools/dev/svn-dev.el")
+ * end:
+ */
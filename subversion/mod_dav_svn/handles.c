@@ -0,0 +1,422 @@
+/*
+ * handles.c: keeping repositories open from one request to the next
+ *
+ * ====================================================================
+ * Copyright (c) 2000-2002 CollabNet.  All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.  The terms
+ * are also available at http://subversion.tigris.org/license-1.html.
+ * If newer versions of this license are posted there, you may use a
+ * newer version instead, at your option.
+ *
+ * This software consists of voluntary contributions made by many
+ * individuals.  For exact contribution history, see the revision
+ * history and logs, available at http://subversion.tigris.org/.
+ * ====================================================================
+ */
+
+
+
+#include <string.h>
+#include <limits.h>
+
+#include <httpd.h>
+#include <http_log.h>
+#include <mod_dav.h>
+
+#include <apr_pools.h>
+#include <apr_strings.h>
+#include <apr_time.h>
+#if APR_HAS_THREADS
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
+#endif
+
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_fs.h"
+#include "svn_repos.h"
+
+#include "dav_svn.h"
+
+
+/* Opening a repository means opening its Berkeley DB environment and
+   every table in it, and taking the shared lock on its db lockfile;
+   doing that for every request, only to close it all again when the
+   request is done, is most of the cost of a small GET or PROPFIND.
+   So instead, each server process keeps the handles its requests have
+   finished with, and gives them to later requests for the same
+   repository.
+
+   A handle is only ever used by one request at a time: it is taken
+   off the idle list when a request gets it, and put back when that
+   request's pool is cleaned up.  Each handle lives in a root pool of
+   its own, so that it can outlive the request that opened it.  */
+
+/* How long a handle may sit unused before it is closed.  Cached
+   handles hold the repository's shared lock, which keeps out anyone
+   wanting it exclusively, such as 'svnadmin recover'.  So where there
+   are threads, each process has a reaper thread which wakes every
+   DAV_SVN_HANDLE_REAP_INTERVAL and closes the handles that have been
+   idle this long, whether or not any requests have come in since.
+   Without threads, idle handles are only closed by the next request
+   the process serves, so a process that gets no more requests holds
+   the lock until it exits.  */
+#define DAV_SVN_HANDLE_IDLE_TIME (60 * APR_USEC_PER_SEC)
+#define DAV_SVN_HANDLE_REAP_INTERVAL (DAV_SVN_HANDLE_IDLE_TIME / 4)
+
+/* How many requests a handle serves before it is closed.  Errors the
+   filesystem creates in its own pool stay there for as long as the
+   handle is open, so this bounds the memory they take.  */
+#define DAV_SVN_HANDLE_MAX_USES 1000
+
+typedef struct dav_svn_handle {
+  /* The repository's path, as given to SVNPath, and the open handle. */
+  const char *fs_path;
+  svn_repos_t *repos;
+
+  /* The root pool the handle lives in. */
+  apr_pool_t *pool;
+
+  /* How many requests have used the handle so far. */
+  int uses;
+
+  /* While in use: the request using it, and the number of idle
+     handles its server wants kept.  While idle: when it was last
+     used, and the next idle handle. */
+  request_rec *r;
+  int cache_size;
+  apr_time_t idle_since;
+  struct dav_svn_handle *next;
+
+} dav_svn_handle;
+
+/* The idle handles, most recently used first.  CACHE_OPEN is true
+   between the process starting and its pool being cleaned up; handles
+   released outside that time are closed. */
+static dav_svn_handle *idle_handles;
+static int cache_open;
+
+/* How often requests found a handle to reuse, and how often not. */
+static unsigned long cache_hits;
+static unsigned long cache_misses;
+
+#if APR_HAS_THREADS
+/* Protects all of the above. */
+static apr_thread_mutex_t *cache_lock;
+
+/* The reaper thread, if there is one, and what wakes it early when
+   the cache closes. */
+static apr_thread_t *reaper;
+static apr_thread_cond_t *reaper_wake;
+#endif
+
+
+static void lock_cache(void)
+{
+#if APR_HAS_THREADS
+  if (cache_lock)
+    apr_thread_mutex_lock(cache_lock);
+#endif
+}
+
+static void unlock_cache(void)
+{
+#if APR_HAS_THREADS
+  if (cache_lock)
+    apr_thread_mutex_unlock(cache_lock);
+#endif
+}
+
+/* The warning function for handles no request is using. */
+static void idle_warning(void *baton, const char *fmt, ...)
+{
+  char buf[256];
+  va_list va;
+
+  va_start(va, fmt);
+  apr_vsnprintf(buf, sizeof(buf), fmt, va);
+  va_end(va);
+
+  ap_log_error(APLOG_MARK, APLOG_ERR, APR_EGENERAL, NULL, "%s", buf);
+}
+
+/* Close the handles in the list starting at H. */
+static void close_handles(dav_svn_handle *h)
+{
+  while (h != NULL)
+    {
+      dav_svn_handle *next = h->next;
+
+      svn_pool_destroy(h->pool);
+      h = next;
+    }
+}
+
+/* Take off the idle list, and return in a list of their own, the
+   handles that have been idle too long as of NOW or that are more
+   than CACHE_SIZE in number.  The cache must be locked.  */
+static dav_svn_handle *trim_cache(apr_time_t now, int cache_size)
+{
+  dav_svn_handle **link = &idle_handles;
+  dav_svn_handle *doomed;
+  int kept = 0;
+
+  /* The list is in order of last use, so everything after the first
+     handle to go goes too. */
+  while (*link != NULL
+         && kept < cache_size
+         && now - (*link)->idle_since < DAV_SVN_HANDLE_IDLE_TIME)
+    {
+      link = &(*link)->next;
+      ++kept;
+    }
+
+  doomed = *link;
+  *link = NULL;
+  return doomed;
+}
+
+/* Pool cleanup for the request using the handle DATA: put the handle
+   back on the idle list, or close it.  */
+static apr_status_t release_handle(void *data)
+{
+  dav_svn_handle *h = data;
+  dav_svn_handle *doomed;
+
+  /* The request is going away, and its warning baton with it. */
+  svn_fs_set_warning_func(svn_repos_fs(h->repos), idle_warning, NULL);
+
+  /* A server error might have been the repository's doing, so a
+     handle that saw one isn't trusted with another request. */
+  if (++h->uses >= DAV_SVN_HANDLE_MAX_USES
+      || h->r->status >= HTTP_INTERNAL_SERVER_ERROR)
+    {
+      svn_pool_destroy(h->pool);
+      return APR_SUCCESS;
+    }
+
+  h->r = NULL;
+  h->idle_since = apr_time_now();
+
+  lock_cache();
+  if (cache_open)
+    {
+      h->next = idle_handles;
+      idle_handles = h;
+      doomed = trim_cache(h->idle_since, h->cache_size);
+    }
+  else
+    {
+      h->next = NULL;
+      doomed = h;
+    }
+  unlock_cache();
+
+  close_handles(doomed);
+  return APR_SUCCESS;
+}
+
+#if APR_HAS_THREADS
+/* Body of the reaper thread: until the cache closes, close the handles
+   that have been idle too long every DAV_SVN_HANDLE_REAP_INTERVAL. */
+static void * APR_THREAD_FUNC reap_handles(apr_thread_t *thread, void *data)
+{
+  dav_svn_handle *doomed;
+
+  lock_cache();
+  while (cache_open)
+    {
+      apr_thread_cond_timedwait(reaper_wake, cache_lock,
+                                DAV_SVN_HANDLE_REAP_INTERVAL);
+      if (!cache_open)
+        break;
+
+      /* Only age matters here; each request keeps the list within its
+         server's SVNReposCacheSize. */
+      doomed = trim_cache(apr_time_now(), INT_MAX);
+      unlock_cache();
+
+      close_handles(doomed);
+      lock_cache();
+    }
+  unlock_cache();
+
+  return NULL;
+}
+#endif
+
+/* Pool cleanup to destroy the pool DATA. */
+static apr_status_t destroy_pool(void *data)
+{
+  svn_pool_destroy(data);
+  return APR_SUCCESS;
+}
+
+/* Cleanup for the process's pool: close all the idle handles. */
+static apr_status_t close_cache(void *data)
+{
+  dav_svn_handle *doomed;
+
+  lock_cache();
+  cache_open = 0;
+  doomed = idle_handles;
+  idle_handles = NULL;
+#if APR_HAS_THREADS
+  if (reaper != NULL)
+    apr_thread_cond_signal(reaper_wake);
+#endif
+  unlock_cache();
+
+#if APR_HAS_THREADS
+  /* The reaper may be closing handles it took; wait for it. */
+  if (reaper != NULL)
+    {
+      apr_status_t retval;
+
+      apr_thread_join(&retval, reaper);
+      reaper = NULL;
+    }
+#endif
+
+  close_handles(doomed);
+
+#if APR_HAS_THREADS
+  /* The mutex and condition go with the pool they were made in. */
+  cache_lock = NULL;
+  reaper_wake = NULL;
+#endif
+  return APR_SUCCESS;
+}
+
+
+void dav_svn_init_handles(apr_pool_t *p, server_rec *s)
+{
+#if APR_HAS_THREADS
+  apr_status_t status;
+
+  status = apr_thread_mutex_create(&cache_lock, APR_THREAD_MUTEX_DEFAULT, p);
+  if (status != APR_SUCCESS)
+    {
+      /* Without a lock, requests open their repositories afresh. */
+      ap_log_error(APLOG_MARK, APLOG_ERR, status, s,
+                   "mod_dav_svn: could not create the repository handle "
+                   "cache lock; handles will not be reused");
+      cache_lock = NULL;
+      return;
+    }
+#endif
+
+  idle_handles = NULL;
+  cache_hits = cache_misses = 0;
+  cache_open = 1;
+
+#if APR_HAS_THREADS
+  /* Pool cleanups run last-registered-first, so these must be made
+     before close_cache is registered: it signals the condition and
+     joins the thread, which must both still exist then. */
+  reaper = NULL;
+  status = apr_thread_cond_create(&reaper_wake, p);
+  if (status == APR_SUCCESS)
+    status = apr_thread_create(&reaper, NULL, reap_handles, NULL, p);
+  if (status != APR_SUCCESS)
+    {
+      reaper = NULL;
+      ap_log_error(APLOG_MARK, APLOG_WARNING, status, s,
+                   "mod_dav_svn: could not start the repository handle "
+                   "reaper; idle handles will only be closed as later "
+                   "requests arrive");
+    }
+#endif
+
+  apr_pool_cleanup_register(p, NULL, close_cache, apr_pool_cleanup_null);
+}
+
+
+svn_error_t *dav_svn_open_repos(svn_repos_t **repos,
+                                const char *fs_path,
+                                request_rec *r)
+{
+  int cache_size = dav_svn_get_repos_cache_size(r);
+  dav_svn_handle *h = NULL;
+  dav_svn_handle *doomed = NULL;
+  dav_svn_handle **link;
+  svn_error_t *serr;
+  int use_cache;
+
+  lock_cache();
+  use_cache = cache_open && cache_size > 0;
+  if (use_cache)
+    {
+      for (link = &idle_handles; *link != NULL; link = &(*link)->next)
+        if (strcmp((*link)->fs_path, fs_path) == 0)
+          {
+            h = *link;
+            *link = h->next;
+            break;
+          }
+      doomed = trim_cache(apr_time_now(), cache_size);
+      if (h != NULL)
+        cache_hits++;
+      else
+        cache_misses++;
+    }
+  unlock_cache();
+
+  close_handles(doomed);
+
+  if (!use_cache)
+    return svn_repos_open(repos, fs_path, r->pool);
+
+  if (h == NULL)
+    {
+      apr_pool_t *pool = svn_pool_create(NULL);
+
+      serr = svn_repos_open(repos, fs_path, pool);
+      if (serr != NULL)
+        {
+          /* The error lives in POOL, so keep that until the request
+             is done with it. */
+          apr_pool_cleanup_register(r->pool, pool, destroy_pool,
+                                    apr_pool_cleanup_null);
+          return serr;
+        }
+
+      h = apr_pcalloc(pool, sizeof(*h));
+      h->fs_path = apr_pstrdup(pool, fs_path);
+      h->repos = *repos;
+      h->pool = pool;
+    }
+
+  h->r = r;
+  h->cache_size = cache_size;
+  h->next = NULL;
+  apr_pool_cleanup_register(r->pool, h, release_handle,
+                            apr_pool_cleanup_null);
+
+  *repos = h->repos;
+  return SVN_NO_ERROR;
+}
+
+
+void dav_svn_get_handle_stats(dav_svn_handle_stats *stats_p)
+{
+  dav_svn_handle *h;
+
+  lock_cache();
+  stats_p->hits = cache_hits;
+  stats_p->misses = cache_misses;
+  stats_p->idle = 0;
+  for (h = idle_handles; h != NULL; h = h->next)
+    stats_p->idle++;
+  unlock_cache();
+}
+
+
+/* 
+ * local variables:
+ * eval: (load-file "../../tools/dev/svn-dev.el")
+ * end:
+ */
@@ -18,11 +18,17 @@
 
 
 
+#include <string.h>
+
 #include <httpd.h>
 #include <util_xml.h>
 #include <apr_tables.h>
+#include <apr_hash.h>
+#include <apr_strings.h>
 #include <mod_dav.h>
 
+#include "svn_fs.h"
+
 #include "dav_svn.h"
 
 
@@ -97,6 +103,186 @@ static const dav_liveprop_group dav_svn_liveprop_group =
 };
 
 
+/* A PROPFIND on a collection asks the same few questions of every
+   member: its ID, its created revision, and that revision's date and
+   author. Asking the FS each of these separately costs a trail apiece
+   per member, so instead, what we learn is kept for the rest of the
+   request, in the request's pool. Walking a collection reads all its
+   entries in one go (see dav_svn_get_node_info), and each revision's
+   properties are read only once however many members it created. */
+
+/* What's known about one node of the memo's root. */
+typedef struct {
+  const svn_fs_node_info_t *info;
+
+  /* Whether the node's entries have been read, and what they are. */
+  int have_entries;
+  apr_hash_t *entries;
+
+} dav_svn_node_memo;
+
+typedef struct {
+  /* A revision root, and a dav_svn_node_memo for each of its paths
+     we know about. */
+  svn_fs_root_t *root;
+  apr_hash_t *nodes;
+
+  /* A filesystem, and the property list of each of its revisions
+     we've looked at. */
+  svn_fs_t *fs;
+  apr_hash_t *revprops;
+
+} dav_svn_prop_memo;
+
+#define DAV_SVN_PROP_MEMO_KEY "dav_svn-prop-memo"
+
+
+static dav_svn_prop_memo *get_prop_memo(apr_pool_t *pool)
+{
+  void *data;
+  dav_svn_prop_memo *memo;
+
+  apr_pool_userdata_get(&data, DAV_SVN_PROP_MEMO_KEY, pool);
+  if (data != NULL)
+    return data;
+
+  memo = apr_pcalloc(pool, sizeof(*memo));
+  apr_pool_userdata_set(memo, DAV_SVN_PROP_MEMO_KEY, apr_pool_cleanup_null,
+                        pool);
+  return memo;
+}
+
+/* Remember INFO for PATH in MEMO, unless we already know about PATH.
+   Return the node's memo entry. */
+static dav_svn_node_memo *remember_node(dav_svn_prop_memo *memo,
+                                        const char *path,
+                                        const svn_fs_node_info_t *info,
+                                        apr_pool_t *pool)
+{
+  dav_svn_node_memo *node = apr_hash_get(memo->nodes, path,
+                                         APR_HASH_KEY_STRING);
+
+  if (node == NULL)
+    {
+      node = apr_pcalloc(pool, sizeof(*node));
+      node->info = info;
+      apr_hash_set(memo->nodes, apr_pstrdup(pool, path), APR_HASH_KEY_STRING,
+                   node);
+    }
+  return node;
+}
+
+svn_error_t *dav_svn_get_node_info(const svn_fs_node_info_t **info,
+                                   apr_hash_t **entries,
+                                   svn_fs_root_t *root,
+                                   const char *path,
+                                   apr_pool_t *pool)
+{
+  dav_svn_prop_memo *memo;
+  dav_svn_node_memo *node;
+  svn_fs_node_info_t *found;
+  apr_hash_t *found_entries;
+  apr_hash_index_t *hi;
+
+  /* A transaction can change under us, so always ask afresh. */
+  if (!svn_fs_is_revision_root(root))
+    {
+      SVN_ERR( svn_fs_node_info(&found, entries, root, path, pool) );
+      *info = found;
+      return SVN_NO_ERROR;
+    }
+
+  memo = get_prop_memo(pool);
+  if (memo->root != root)
+    {
+      memo->root = root;
+      memo->nodes = apr_hash_make(pool);
+    }
+
+  node = apr_hash_get(memo->nodes, path, APR_HASH_KEY_STRING);
+  if (node != NULL && (entries == NULL || node->have_entries))
+    {
+      *info = node->info;
+      if (entries != NULL)
+        *entries = node->entries;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR( svn_fs_node_info(&found, entries ? &found_entries : NULL,
+                            root, path, pool) );
+  node = remember_node(memo, path, found, pool);
+
+  if (entries != NULL)
+    {
+      node->have_entries = 1;
+      node->entries = found_entries;
+
+      /* The members are what we'll be asked about next. */
+      if (found_entries != NULL)
+        for (hi = apr_hash_first(pool, found_entries); hi;
+             hi = apr_hash_next(hi))
+          {
+            const void *key;
+            void *val;
+            const char *child;
+
+            apr_hash_this(hi, &key, NULL, &val);
+            child = (path[0] != '\0' && path[strlen(path) - 1] == '/')
+              ? apr_pstrcat(pool, path, key, NULL)
+              : apr_pstrcat(pool, path, "/", key, NULL);
+            (void) remember_node(memo, child, val, pool);
+          }
+
+      *entries = node->entries;
+    }
+
+  *info = node->info;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *dav_svn_get_rev_prop(const svn_string_t **value,
+                                  svn_fs_t *fs,
+                                  svn_revnum_t rev,
+                                  const char *name,
+                                  apr_pool_t *pool)
+{
+  dav_svn_prop_memo *memo = get_prop_memo(pool);
+  apr_hash_t *props;
+
+  if (memo->fs != fs)
+    {
+      memo->fs = fs;
+      memo->revprops = apr_hash_make(pool);
+    }
+
+  props = apr_hash_get(memo->revprops, &rev, sizeof(rev));
+  if (props == NULL)
+    {
+      svn_revnum_t *key = apr_palloc(pool, sizeof(*key));
+
+      SVN_ERR( svn_fs_revision_proplist(&props, fs, rev, pool) );
+      *key = rev;
+      apr_hash_set(memo->revprops, key, sizeof(*key), props);
+    }
+
+  *value = apr_hash_get(props, name, APR_HASH_KEY_STRING);
+  return SVN_NO_ERROR;
+}
+
+/* Set *REV to the revision in which RESOURCE was last changed. */
+static svn_error_t *get_created_rev(svn_revnum_t *rev,
+                                    const dav_resource *resource)
+{
+  const svn_fs_node_info_t *info;
+
+  SVN_ERR( dav_svn_get_node_info(&info, NULL, resource->info->root.root,
+                                 DAV_SVN_REPOS_PATH(resource),
+                                 resource->pool) );
+  *rev = info->created_rev;
+  return SVN_NO_ERROR;
+}
+
+
 static dav_prop_insert dav_svn_insert_prop(const dav_resource *resource,
                                            int propid, dav_prop_insert what,
                                            ap_text_header *phdr)
@@ -127,13 +313,11 @@ static dav_prop_insert dav_svn_insert_prop(const dav_resource *resource,
     case DAV_PROPID_creationdate:
       {
         svn_revnum_t committed_rev = SVN_INVALID_REVNUM;
-        svn_string_t *committed_date = NULL;
+        const svn_string_t *committed_date = NULL;
         
         /* Get the CR field out of the node's skel.  Notice that the
            root object might be an ID root -or- a revision root. */
-        serr = svn_fs_node_created_rev(&committed_rev,
-                                       resource->info->root.root,
-                                       DAV_SVN_REPOS_PATH(resource), p);
+        serr = get_created_rev(&committed_rev, resource);
         if (serr != NULL)
           {
             /* ### what to do? */
@@ -142,7 +326,7 @@ static dav_prop_insert dav_svn_insert_prop(const dav_resource *resource,
           }
         
         /* Get the date property of the created revision. */
-        serr = svn_fs_revision_prop(&committed_date,
+        serr = dav_svn_get_rev_prop(&committed_date,
                                     resource->info->repos->fs,
                                     committed_rev,
                                     SVN_PROP_REVISION_DATE, p);
@@ -163,13 +347,11 @@ static dav_prop_insert dav_svn_insert_prop(const dav_resource *resource,
     case DAV_PROPID_creator_displayname:
       {        
         svn_revnum_t committed_rev = SVN_INVALID_REVNUM;
-        svn_string_t *last_author = NULL;
+        const svn_string_t *last_author = NULL;
         
         /* Get the CR field out of the node's skel.  Notice that the
            root object might be an ID root -or- a revision root. */
-        serr = svn_fs_node_created_rev(&committed_rev,
-                                       resource->info->root.root,
-                                       DAV_SVN_REPOS_PATH(resource), p);
+        serr = get_created_rev(&committed_rev, resource);
         if (serr != NULL)
           {
             /* ### what to do? */
@@ -178,7 +360,7 @@ static dav_prop_insert dav_svn_insert_prop(const dav_resource *resource,
           }
         
         /* Get the date property of the created revision. */
-        serr = svn_fs_revision_prop(&last_author,
+        serr = dav_svn_get_rev_prop(&last_author,
                                     resource->info->repos->fs,
                                     committed_rev,
                                     SVN_PROP_REVISION_AUTHOR, p);
@@ -264,11 +446,11 @@ static dav_prop_insert dav_svn_insert_prop(const dav_resource *resource,
         }
       else
         {
-          svn_fs_id_t *id;
+          const svn_fs_node_info_t *node;
           svn_stringbuf_t *stable_id;
 
-          serr = svn_fs_node_id(&id, resource->info->root.root,
-                                resource->info->repos_path, p);
+          serr = dav_svn_get_node_info(&node, NULL, resource->info->root.root,
+                                       resource->info->repos_path, p);
           if (serr != NULL)
             {
               /* ### what to do? */
@@ -276,7 +458,7 @@ static dav_prop_insert dav_svn_insert_prop(const dav_resource *resource,
               break;
             }
 
-          stable_id = svn_fs_unparse_id(id, p);
+          stable_id = svn_fs_unparse_id(node->id, p);
           svn_stringbuf_appendcstr(stable_id, resource->info->repos_path);
 
           s = dav_svn_build_uri(resource->info->repos,
@@ -317,9 +499,7 @@ static dav_prop_insert dav_svn_insert_prop(const dav_resource *resource,
           
           /* Get the CR field out of the node's skel.  Notice that the
              root object might be an ID root -or- a revision root. */
-          serr = svn_fs_node_created_rev(&committed_rev,
-                                         resource->info->root.root,
-                                         DAV_SVN_REPOS_PATH(resource), p);
+          serr = get_created_rev(&committed_rev, resource);
           if (serr != NULL)
             {
               /* ### what to do? */
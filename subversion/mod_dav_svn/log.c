@@ -18,6 +18,8 @@
 
 
 
+#include <stdlib.h>
+
 #include <apr_pools.h>
 #include <apr_strings.h>
 #include <apr_xml.h>
@@ -32,6 +34,13 @@
 #include "dav_svn.h"
 
 
+/* Log items are flushed to the client after the first one, and then
+   every this many.  A big log arrives as it is found, so the client
+   can show the first messages at once, and can hang up as soon as it
+   has seen enough. */
+#define DAV_SVN_LOG_FLUSH_INTERVAL 64
+
+
 struct log_receiver_baton
 {
   /* this buffers the output for a bit and is automatically flushed,
@@ -41,6 +50,9 @@ struct log_receiver_baton
   /* where to deliver the output */
   ap_filter_t *output;
 
+  /* How many log items have been sent so far. */
+  int count;
+
   /* For temporary allocations. */
   apr_pool_t *pool;
 };
@@ -66,6 +78,12 @@ static svn_error_t * log_receiver(void *baton,
 {
   struct log_receiver_baton *lrb = baton;
 
+  /* If the client has gone away, there's no point looking for more. */
+  if (lrb->output->c->aborted)
+    return svn_error_create(SVN_ERR_CANCELED, 0, NULL, lrb->pool,
+                            "log report canceled: the client "
+                            "has disconnected");
+
   send_xml(lrb,
            "<S:log-item>" DEBUG_CR
            "<D:version-name>%lu</D:version-name>" DEBUG_CR
@@ -113,6 +131,12 @@ static svn_error_t * log_receiver(void *baton,
   /* Clear out anything we may have placed in here. */
   svn_pool_clear(lrb->pool);
 
+  if (lrb->count++ % DAV_SVN_LOG_FLUSH_INTERVAL == 0
+      && ap_fflush(lrb->output, lrb->bb) != APR_SUCCESS)
+    return svn_error_create(SVN_ERR_CANCELED, 0, NULL, lrb->pool,
+                            "log report canceled: could not "
+                            "send to the client");
+
   return SVN_NO_ERROR;
 }
 
@@ -133,6 +157,7 @@ dav_error * dav_svn__log_report(const dav_resource *resource,
   /* These get determined from the request document. */
   svn_revnum_t start = SVN_INVALID_REVNUM;   /* defaults to HEAD */
   svn_revnum_t end = SVN_INVALID_REVNUM;     /* defaults to HEAD */
+  int limit = 0;                             /* no limit by default */
   svn_boolean_t discover_changed_paths = 0;  /* off by default */
 
   /* ### why are these paths stringbuf? they aren't going to be changed... */
@@ -167,6 +192,13 @@ dav_error * dav_svn__log_report(const dav_resource *resource,
           /* ### assume no white space, no child elems, etc */
           end = SVN_STR_TO_REV(child->first_cdata.first->text);
         }
+      else if (strcmp(child->name, "limit") == 0)
+        {
+          /* ### assume no white space, no child elems, etc */
+          limit = atoi(child->first_cdata.first->text);
+          if (limit < 0)
+            limit = 0;
+        }
       else if (strcmp(child->name, "discover-changed-paths") == 0)
         {
           /* ### todo: value doesn't matter, presence alone is enough?
@@ -196,6 +228,7 @@ dav_error * dav_svn__log_report(const dav_resource *resource,
   lrb.bb = apr_brigade_create(resource->pool,  /* not the subpool! */
                               output->c->bucket_alloc);
   lrb.output = output;
+  lrb.count = 0;
   lrb.pool = svn_pool_create(resource->pool);
 
   /* Start the log report. */
@@ -209,6 +242,7 @@ dav_error * dav_svn__log_report(const dav_resource *resource,
                             paths,
                             start,
                             end,
+                            limit,
                             discover_changed_paths,
                             log_receiver,
                             &lrb,
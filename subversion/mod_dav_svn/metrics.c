@@ -0,0 +1,360 @@
+/*
+ * metrics.c: counting what the requests do, and reporting it
+ *
+ * ====================================================================
+ * Copyright (c) 2000-2002 CollabNet.  All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.  The terms
+ * are also available at http://subversion.tigris.org/license-1.html.
+ * If newer versions of this license are posted there, you may use a
+ * newer version instead, at your option.
+ *
+ * This software consists of voluntary contributions made by many
+ * individuals.  For exact contribution history, see the revision
+ * history and logs, available at http://subversion.tigris.org/.
+ * ====================================================================
+ */
+
+
+
+#include <string.h>
+
+#include <httpd.h>
+#include <http_log.h>
+#include <http_protocol.h>
+#include <mod_dav.h>
+
+#include <apr_pools.h>
+#include <apr_time.h>
+#if APR_HAS_THREADS
+#include <apr_thread_mutex.h>
+#endif
+#if APR_HAVE_UNISTD_H
+#include <unistd.h>             /* for getpid() */
+#endif
+
+#include "svn_fs.h"
+
+#include "dav_svn.h"
+
+
+/* Each server process counts the requests it serves, by kind: how many
+   there have been and how many are running now, how long they took,
+   how many bytes they sent, and how many FS trails they ran.  A
+   request is counted from the first time dav_svn_get_resource sees it
+   until its pool is cleaned up; the REPORT, GET and commit entry points
+   say what kind of request it turned out to be.
+
+   The "svn-metrics" handler reports this process's counts, along with
+   the repository handle and delta cache statistics, as plain text,
+   one "Name: value" per line.  With several server processes, each
+   reports only its own; the ServerProcess line says which one
+   answered.  */
+
+/* The names of the kinds of request, as reported. */
+static const char * const kind_names[DAV_SVN_REQUEST_KINDS] = {
+  "Other",
+  "GET",
+  "GET-delta",
+  "PROPFIND",
+  "PROPPATCH",
+  "OPTIONS",
+  "REPORT",
+  "REPORT-update",
+  "REPORT-log",
+  "MKACTIVITY",
+  "CHECKOUT",
+  "PUT",
+  "DELETE",
+  "MKCOL",
+  "COPY",
+  "MERGE",
+  "POST-commit"
+};
+
+/* The upper bounds of the latency histogram's buckets, in
+   microseconds; the last bucket holds everything slower. */
+#define LATENCY_BUCKETS 6
+static const apr_interval_time_t latency_bounds[LATENCY_BUCKETS - 1] = {
+  1000, 10000, 100000, 1000000, 10000000
+};
+static const char * const latency_names[LATENCY_BUCKETS] = {
+  "1ms", "10ms", "100ms", "1s", "10s", "More"
+};
+
+typedef struct {
+  unsigned long requests;       /* requests finished */
+  int in_flight;                /* requests running now */
+  apr_off_t bytes_sent;         /* response bytes, headers excluded */
+  unsigned long trails;         /* FS trails run */
+  unsigned long deadlock_retries; /* trails retried after a deadlock */
+  unsigned long latency[LATENCY_BUCKETS];
+} dav_svn_kind_metrics;
+
+/* The counts for each kind of request, and when the process started
+   counting. COUNTING is true between the process starting and its pool
+   being cleaned up. */
+static dav_svn_kind_metrics metrics[DAV_SVN_REQUEST_KINDS];
+static apr_time_t started;
+static int counting;
+
+#if APR_HAS_THREADS
+/* Protects all of the above. */
+static apr_thread_mutex_t *metrics_lock;
+#endif
+
+/* A request being counted. */
+typedef struct {
+  request_rec *r;
+  dav_svn_request_kind kind;
+
+  /* The filesystem the request uses, and its trail counts when the
+     request started using it. */
+  svn_fs_t *fs;
+  unsigned long trails;
+  unsigned long deadlock_retries;
+
+} dav_svn_request_metrics;
+
+#define DAV_SVN_METRICS_KEY "dav_svn-metrics"
+
+
+static void lock_metrics(void)
+{
+#if APR_HAS_THREADS
+  if (metrics_lock)
+    apr_thread_mutex_lock(metrics_lock);
+#endif
+}
+
+static void unlock_metrics(void)
+{
+#if APR_HAS_THREADS
+  if (metrics_lock)
+    apr_thread_mutex_unlock(metrics_lock);
+#endif
+}
+
+/* Return the kind of request R is, going by its method alone. */
+static dav_svn_request_kind method_kind(request_rec *r)
+{
+  switch (r->method_number)
+    {
+    case M_GET:         return DAV_SVN_REQUEST_GET;
+    case M_PROPFIND:    return DAV_SVN_REQUEST_PROPFIND;
+    case M_PROPPATCH:   return DAV_SVN_REQUEST_PROPPATCH;
+    case M_OPTIONS:     return DAV_SVN_REQUEST_OPTIONS;
+    case M_REPORT:      return DAV_SVN_REQUEST_REPORT;
+    case M_MKACTIVITY:  return DAV_SVN_REQUEST_MKACTIVITY;
+    case M_CHECKOUT:    return DAV_SVN_REQUEST_CHECKOUT;
+    case M_PUT:         return DAV_SVN_REQUEST_PUT;
+    case M_DELETE:      return DAV_SVN_REQUEST_DELETE;
+    case M_MKCOL:       return DAV_SVN_REQUEST_MKCOL;
+    case M_COPY:        return DAV_SVN_REQUEST_COPY;
+    case M_MERGE:       return DAV_SVN_REQUEST_MERGE;
+    default:            return DAV_SVN_REQUEST_OTHER;
+    }
+}
+
+/* Cleanup for a counted request's pool: add the request to the counts. */
+static apr_status_t end_request(void *data)
+{
+  dav_svn_request_metrics *rm = data;
+  apr_interval_time_t latency = apr_time_now() - rm->r->request_time;
+  unsigned long trails, deadlock_retries;
+  dav_svn_kind_metrics *m;
+  int i;
+
+  svn_fs_trail_stats(&trails, &deadlock_retries, rm->fs);
+
+  for (i = 0; i < LATENCY_BUCKETS - 1; i++)
+    if (latency < latency_bounds[i])
+      break;
+
+  lock_metrics();
+  if (counting)
+    {
+      m = &metrics[rm->kind];
+      m->requests++;
+      m->in_flight--;
+      m->bytes_sent += rm->r->bytes_sent;
+      m->trails += trails - rm->trails;
+      m->deadlock_retries += deadlock_retries - rm->deadlock_retries;
+      m->latency[i]++;
+    }
+  unlock_metrics();
+
+  return APR_SUCCESS;
+}
+
+/* Cleanup for the process's pool: stop counting. */
+static apr_status_t close_metrics(void *data)
+{
+  lock_metrics();
+  counting = 0;
+  unlock_metrics();
+
+#if APR_HAS_THREADS
+  /* The mutex goes with the pool it was made in. */
+  metrics_lock = NULL;
+#endif
+  return APR_SUCCESS;
+}
+
+
+void dav_svn_init_metrics(apr_pool_t *p, server_rec *s)
+{
+#if APR_HAS_THREADS
+  apr_status_t status;
+
+  status = apr_thread_mutex_create(&metrics_lock, APR_THREAD_MUTEX_DEFAULT,
+                                   p);
+  if (status != APR_SUCCESS)
+    {
+      ap_log_error(APLOG_MARK, APLOG_ERR, status, s,
+                   "mod_dav_svn: could not create the metrics lock; "
+                   "requests will not be counted");
+      metrics_lock = NULL;
+      return;
+    }
+#endif
+
+  memset(metrics, 0, sizeof(metrics));
+  started = apr_time_now();
+  counting = 1;
+  apr_pool_cleanup_register(p, NULL, close_metrics, apr_pool_cleanup_null);
+}
+
+
+void dav_svn_metrics_begin(request_rec *r, svn_fs_t *fs)
+{
+  void *data;
+  dav_svn_request_metrics *rm;
+
+  /* Subrequests are counted as part of their main request. */
+  if (r->main != NULL)
+    return;
+
+  /* Only the first resource a request looks up starts the count. */
+  apr_pool_userdata_get(&data, DAV_SVN_METRICS_KEY, r->pool);
+  if (data != NULL)
+    return;
+
+  rm = apr_pcalloc(r->pool, sizeof(*rm));
+  rm->r = r;
+  rm->kind = method_kind(r);
+  rm->fs = fs;
+  svn_fs_trail_stats(&rm->trails, &rm->deadlock_retries, fs);
+
+  lock_metrics();
+  if (!counting)
+    {
+      unlock_metrics();
+      return;
+    }
+  metrics[rm->kind].in_flight++;
+  unlock_metrics();
+
+  apr_pool_userdata_set(rm, DAV_SVN_METRICS_KEY, apr_pool_cleanup_null,
+                        r->pool);
+
+  /* The repository handle is released by a cleanup registered before
+     this one, so it runs after this one: the trail counts are read
+     while the handle is still this request's. */
+  apr_pool_cleanup_register(r->pool, rm, end_request, apr_pool_cleanup_null);
+}
+
+
+void dav_svn_metrics_set_kind(request_rec *r, dav_svn_request_kind kind)
+{
+  void *data;
+  dav_svn_request_metrics *rm;
+
+  apr_pool_userdata_get(&data, DAV_SVN_METRICS_KEY, r->pool);
+  if (data == NULL)
+    return;
+  rm = data;
+
+  lock_metrics();
+  if (counting)
+    {
+      metrics[rm->kind].in_flight--;
+      metrics[kind].in_flight++;
+    }
+  rm->kind = kind;
+  unlock_metrics();
+}
+
+
+int dav_svn_metrics_handler(request_rec *r)
+{
+  dav_svn_kind_metrics snapshot[DAV_SVN_REQUEST_KINDS];
+  apr_time_t since;
+  dav_svn_handle_stats handles;
+  dav_svn_delta_cache_stats deltas;
+  int k, i;
+
+  if (strcmp(r->handler, DAV_SVN_METRICS_HANDLER) != 0)
+    return DECLINED;
+
+  r->allowed = (AP_METHOD_BIT << M_GET);
+  if (r->method_number != M_GET)
+    return DECLINED;
+
+  r->content_type = "text/plain";
+  if (r->header_only)
+    return OK;
+
+  lock_metrics();
+  memcpy(snapshot, metrics, sizeof(snapshot));
+  since = started;
+  unlock_metrics();
+
+  dav_svn_get_handle_stats(&handles);
+  dav_svn_get_delta_cache_stats(&deltas);
+
+#if APR_HAVE_UNISTD_H
+  ap_rprintf(r, "ServerProcess: %ld\n", (long) getpid());
+#endif
+  ap_rprintf(r, "Uptime: %ld\n",
+             (long) apr_time_sec(apr_time_now() - since));
+
+  ap_rprintf(r, "ReposHandleHits: %lu\n", handles.hits);
+  ap_rprintf(r, "ReposHandleMisses: %lu\n", handles.misses);
+  ap_rprintf(r, "ReposHandlesIdle: %d\n", handles.idle);
+
+  ap_rprintf(r, "DeltaCacheHits: %lu\n", deltas.hits);
+  ap_rprintf(r, "DeltaCacheMisses: %lu\n", deltas.misses);
+  ap_rprintf(r, "DeltaCacheEvictions: %lu\n", deltas.evictions);
+  ap_rprintf(r, "DeltaCacheEntries: %lu\n", deltas.entries);
+  ap_rprintf(r, "DeltaCacheBytes: %lu\n", (unsigned long) deltas.bytes);
+
+  ap_rprintf(r, "CommitsInFlight: %d\n",
+             snapshot[DAV_SVN_REQUEST_MERGE].in_flight
+             + snapshot[DAV_SVN_REQUEST_COMMIT].in_flight);
+
+  for (k = 0; k < DAV_SVN_REQUEST_KINDS; k++)
+    {
+      const char *name = kind_names[k];
+      dav_svn_kind_metrics *m = &snapshot[k];
+
+      ap_rprintf(r, "%s Requests: %lu\n", name, m->requests);
+      ap_rprintf(r, "%s InFlight: %d\n", name, m->in_flight);
+      ap_rprintf(r, "%s BytesSent: %" APR_OFF_T_FMT "\n", name, m->bytes_sent);
+      ap_rprintf(r, "%s Trails: %lu\n", name, m->trails);
+      ap_rprintf(r, "%s DeadlockRetries: %lu\n", name, m->deadlock_retries);
+      for (i = 0; i < LATENCY_BUCKETS; i++)
+        ap_rprintf(r, "%s Latency%s: %lu\n",
+                   name, latency_names[i], m->latency[i]);
+    }
+
+  return OK;
+}
+
+
+/*
+ * local variables:
+ * eval: (load-file "../../tools/dev/svn-dev.el")
+ * end:
+ */
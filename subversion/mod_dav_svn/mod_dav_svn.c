@@ -20,11 +20,14 @@
 
 
 
+#include <stdlib.h>
+
 #include <httpd.h>
 #include <http_config.h>
 #include <mod_dav.h>
 
 #include <apr_strings.h>
+#include <apr_lib.h>
 
 #include "svn_version.h"
 #include "svn_pools.h"
@@ -36,16 +39,36 @@
    (e.g. working resources, activities) */
 #define SVN_DEFAULT_SPECIAL_URI "$svn"
 
+/* This is the default number of open repository handles each process
+   keeps for later requests to reuse */
+#define SVN_DEFAULT_REPOS_CACHE_SIZE 8
+
+/* This is the default amount of memory, in kilobytes, each process uses
+   to keep computed svndiffs for later requests */
+#define SVN_DEFAULT_DELTA_CACHE_SIZE 4096
+
 /* per-server configuration */
 typedef struct {
   const char *special_uri;
+  int repos_cache_size;         /* -1 means "inherit" */
+  int delta_cache_size;         /* in kilobytes; -1 means "inherit" */
 
 } dav_svn_server_conf;
 
+/* a flag directive's value; CONF_FLAG_DEFAULT means "inherit" */
+enum conf_flag {
+  CONF_FLAG_DEFAULT,
+  CONF_FLAG_ON,
+  CONF_FLAG_OFF
+};
+
 /* per-dir configuration */
 typedef struct {
+  const char *root_dir;         /* the Location this config is for */
   const char *fs_path;          /* path to the SVN FS */
   const char *repo_name;        /* repository name */
+  enum conf_flag async_post_commit; /* queue post-commit hooks? */
+  int delta_threads;            /* worker threads for updates; -1 = unset */
 } dav_svn_dir_conf;
 
 #define INHERIT_VALUE(parent, child, field) \
@@ -79,9 +102,23 @@ static int dav_svn_header_parser(request_rec *r)
     return OK;
 }
 
+static void dav_svn_child_init(apr_pool_t *p, server_rec *s)
+{
+    dav_svn_init_handles(p, s);
+    dav_svn_init_delta_cache(p, s);
+    dav_svn_init_activities(p, s);
+    dav_svn_init_metrics(p, s);
+}
+
 static void *dav_svn_create_server_config(apr_pool_t *p, server_rec *s)
 {
-    return apr_pcalloc(p, sizeof(dav_svn_server_conf));
+    dav_svn_server_conf *conf;
+
+    conf = apr_pcalloc(p, sizeof(*conf));
+    conf->repos_cache_size = -1;
+    conf->delta_cache_size = -1;
+
+    return conf;
 }
 
 static void *dav_svn_merge_server_config(apr_pool_t *p,
@@ -94,6 +131,12 @@ static void *dav_svn_merge_server_config(apr_pool_t *p,
     newconf = apr_pcalloc(p, sizeof(*newconf));
 
     newconf->special_uri = INHERIT_VALUE(parent, child, special_uri);
+    newconf->repos_cache_size = (child->repos_cache_size >= 0
+                                 ? child->repos_cache_size
+                                 : parent->repos_cache_size);
+    newconf->delta_cache_size = (child->delta_cache_size >= 0
+                                 ? child->delta_cache_size
+                                 : parent->delta_cache_size);
 
     return newconf;
 }
@@ -101,8 +144,22 @@ static void *dav_svn_merge_server_config(apr_pool_t *p,
 static void *dav_svn_create_dir_config(apr_pool_t *p, char *dir)
 {
     /* NOTE: dir==NULL creates the default per-dir config */
+    dav_svn_dir_conf *conf = apr_pcalloc(p, sizeof(*conf));
+
+    conf->delta_threads = -1;
 
-    return apr_pcalloc(p, sizeof(dav_svn_dir_conf));
+    /* strip the trailing slash, as mod_dav does for its root_dir */
+    if (dir != NULL)
+      {
+        apr_size_t len = strlen(dir);
+
+        if (len > 1 && dir[len - 1] == '/')
+          conf->root_dir = apr_pstrndup(p, dir, len - 1);
+        else
+          conf->root_dir = apr_pstrdup(p, dir);
+      }
+
+    return conf;
 }
 
 static void *dav_svn_merge_dir_config(apr_pool_t *p,
@@ -114,8 +171,14 @@ static void *dav_svn_merge_dir_config(apr_pool_t *p,
 
     newconf = apr_pcalloc(p, sizeof(*newconf));
 
+    newconf->root_dir = INHERIT_VALUE(parent, child, root_dir);
     newconf->fs_path = INHERIT_VALUE(parent, child, fs_path);
     newconf->repo_name = INHERIT_VALUE(parent, child, repo_name);
+    newconf->async_post_commit = INHERIT_VALUE(parent, child,
+                                               async_post_commit);
+    newconf->delta_threads = (child->delta_threads >= 0
+                              ? child->delta_threads
+                              : parent->delta_threads);
 
     return newconf;
 }
@@ -140,6 +203,33 @@ static const char *dav_svn_path_cmd(cmd_parms *cmd, void *config,
     return NULL;
 }
 
+static const char *dav_svn_async_post_commit_cmd(cmd_parms *cmd,
+                                                 void *config, int arg)
+{
+    dav_svn_dir_conf *conf = config;
+
+    conf->async_post_commit = arg ? CONF_FLAG_ON : CONF_FLAG_OFF;
+
+    return NULL;
+}
+
+static const char *dav_svn_delta_threads_cmd(cmd_parms *cmd, void *config,
+                                             const char *arg1)
+{
+    dav_svn_dir_conf *conf = config;
+    const char *p;
+
+    for (p = arg1; *p; ++p)
+      if (!apr_isdigit(*p))
+        break;
+    if (p == arg1 || *p)
+      return "SVNDeltaThreads requires a number of threads (0 or more).";
+
+    conf->delta_threads = atoi(arg1);
+
+    return NULL;
+}
+
 static const char *dav_svn_special_uri_cmd(cmd_parms *cmd, void *config,
                                            const char *arg1)
 {
@@ -171,6 +261,44 @@ static const char *dav_svn_special_uri_cmd(cmd_parms *cmd, void *config,
     return NULL;
 }
 
+static const char *dav_svn_repos_cache_size_cmd(cmd_parms *cmd, void *config,
+                                                const char *arg1)
+{
+    dav_svn_server_conf *conf;
+    const char *p;
+
+    for (p = arg1; *p; ++p)
+      if (!apr_isdigit(*p))
+        break;
+    if (p == arg1 || *p)
+      return "SVNReposCacheSize requires a number of handles (0 or more).";
+
+    conf = ap_get_module_config(cmd->server->module_config,
+                                &dav_svn_module);
+    conf->repos_cache_size = atoi(arg1);
+
+    return NULL;
+}
+
+static const char *dav_svn_delta_cache_size_cmd(cmd_parms *cmd, void *config,
+                                                const char *arg1)
+{
+    dav_svn_server_conf *conf;
+    const char *p;
+
+    for (p = arg1; *p; ++p)
+      if (!apr_isdigit(*p))
+        break;
+    if (p == arg1 || *p)
+      return "SVNDeltaCacheSize requires a number of kilobytes (0 or more).";
+
+    conf = ap_get_module_config(cmd->server->module_config,
+                                &dav_svn_module);
+    conf->delta_cache_size = atoi(arg1);
+
+    return NULL;
+}
+
 
 /** Accessor functions for the module's configuration state **/
 
@@ -182,6 +310,14 @@ const char *dav_svn_get_fs_path(request_rec *r)
     return conf->fs_path;
 }
 
+const char *dav_svn_get_root_dir(request_rec *r)
+{
+    dav_svn_dir_conf *conf;
+
+    conf = ap_get_module_config(r->per_dir_config, &dav_svn_module);
+    return conf->root_dir;
+}
+
 const char *dav_svn_get_repo_name(request_rec *r)
 {
     dav_svn_dir_conf *conf;
@@ -190,6 +326,22 @@ const char *dav_svn_get_repo_name(request_rec *r)
     return conf->repo_name;
 }
 
+int dav_svn_get_async_post_commit(request_rec *r)
+{
+    dav_svn_dir_conf *conf;
+
+    conf = ap_get_module_config(r->per_dir_config, &dav_svn_module);
+    return conf->async_post_commit == CONF_FLAG_ON;
+}
+
+int dav_svn_get_delta_threads(request_rec *r)
+{
+    dav_svn_dir_conf *conf;
+
+    conf = ap_get_module_config(r->per_dir_config, &dav_svn_module);
+    return conf->delta_threads >= 0 ? conf->delta_threads : 0;
+}
+
 const char *dav_svn_get_special_uri(request_rec *r)
 {
     dav_svn_server_conf *conf;
@@ -199,6 +351,28 @@ const char *dav_svn_get_special_uri(request_rec *r)
     return conf->special_uri ? conf->special_uri : SVN_DEFAULT_SPECIAL_URI;
 }
 
+int dav_svn_get_repos_cache_size(request_rec *r)
+{
+    dav_svn_server_conf *conf;
+
+    conf = ap_get_module_config(r->server->module_config,
+                                &dav_svn_module);
+    return (conf->repos_cache_size >= 0
+            ? conf->repos_cache_size
+            : SVN_DEFAULT_REPOS_CACHE_SIZE);
+}
+
+apr_size_t dav_svn_get_delta_cache_size(request_rec *r)
+{
+    dav_svn_server_conf *conf;
+
+    conf = ap_get_module_config(r->server->module_config,
+                                &dav_svn_module);
+    return (apr_size_t) (conf->delta_cache_size >= 0
+                         ? conf->delta_cache_size
+                         : SVN_DEFAULT_DELTA_CACHE_SIZE) * 1024;
+}
+
 
 /** Module framework stuff **/
 
@@ -214,10 +388,37 @@ static const command_rec dav_svn_cmds[] =
                 "specify the URI component for special Subversion "
                 "resources"),
 
+  /* per server */
+  AP_INIT_TAKE1("SVNReposCacheSize", dav_svn_repos_cache_size_cmd, NULL,
+                RSRC_CONF,
+                "specify how many open repository handles each server "
+                "process keeps for later requests to reuse (0 to open "
+                "the repository afresh for every request)"),
+
+  /* per server */
+  AP_INIT_TAKE1("SVNDeltaCacheSize", dav_svn_delta_cache_size_cmd, NULL,
+                RSRC_CONF,
+                "specify how many kilobytes each server process uses to "
+                "keep computed deltas for later requests (0 to compute "
+                "every delta afresh)"),
+
   /* per directory/location */
   AP_INIT_TAKE1("SVNReposName", dav_svn_repo_name, NULL, ACCESS_CONF,
                 "specify the name of a Subversion repository"),
 
+  /* per directory/location */
+  AP_INIT_FLAG("SVNAsyncPostCommit", dav_svn_async_post_commit_cmd, NULL,
+               ACCESS_CONF,
+               "queue post-commit hooks to be run by 'svnadmin runhooks' "
+               "rather than run them before a commit completes."),
+
+  /* per directory/location */
+  AP_INIT_TAKE1("SVNDeltaThreads", dav_svn_delta_threads_cmd, NULL,
+                ACCESS_CONF,
+                "specify how many worker threads compute the deltas for "
+                "an update ahead of sending them (0 to compute them as "
+                "they are sent)"),
+
   { NULL }
 };
 
@@ -234,6 +435,10 @@ static void register_hooks(apr_pool_t *pconf)
 {
     ap_hook_post_config(dav_svn_init, NULL, NULL, APR_HOOK_MIDDLE);
     ap_hook_header_parser(dav_svn_header_parser, NULL, NULL, APR_HOOK_MIDDLE);
+    ap_hook_child_init(dav_svn_child_init, NULL, NULL, APR_HOOK_MIDDLE);
+    ap_hook_handler(dav_svn_metrics_handler, NULL, NULL, APR_HOOK_MIDDLE);
+    /* ahead of mod_dav, which would otherwise take the POST */
+    ap_hook_handler(dav_svn_commit_handler, NULL, NULL, APR_HOOK_FIRST);
 
     /* our provider */
     dav_register_provider(pconf, "svn", &dav_svn_provider);
@@ -97,10 +97,26 @@ SOURCE=.\activity.c
 # End Source File
 # Begin Source File
 
+SOURCE=.\buckets.c
+# End Source File
+# Begin Source File
+
+SOURCE=.\commit.c
+# End Source File
+# Begin Source File
+
 SOURCE=.\deadprops.c
 # End Source File
 # Begin Source File
 
+SOURCE=.\deltas.c
+# End Source File
+# Begin Source File
+
+SOURCE=.\handles.c
+# End Source File
+# Begin Source File
+
 SOURCE=.\liveprops.c
 # End Source File
 # Begin Source File
@@ -113,6 +129,10 @@ SOURCE=.\merge.c
 # End Source File
 # Begin Source File
 
+SOURCE=.\metrics.c
+# End Source File
+# Begin Source File
+
 SOURCE=.\mod_dav_svn.c
 # End Source File
 # Begin Source File
@@ -34,10 +34,15 @@
 #include "svn_repos.h"
 #include "svn_dav.h"
 #include "svn_sorts.h"
+#include "svn_time.h"
 
 #include "dav_svn.h"
 
 
+/* how long, in seconds, caches may keep resources that never change
+   (a year, the most HTTP/1.1 allows) */
+#define DAV_SVN_IMMUTABLE_MAX_AGE "31536000"
+
 struct dav_stream {
   const dav_resource *res;
 
@@ -53,6 +58,12 @@ struct dav_stream {
 typedef struct {
   ap_filter_t *output;
   apr_pool_t *pool;
+
+  /* if the svndiff is to go into the delta cache, a copy of what has
+     been written so far, which can grow to LIMIT bytes; NULL if not (or
+     no longer) */
+  svn_stringbuf_t *svndiff;
+  apr_size_t limit;
 } dav_svn_diff_ctx_t;
 
 typedef struct {
@@ -296,6 +307,7 @@ static int dav_svn_parse_baseline_coll_uri(dav_resource_combined *comb,
   comb->res.versioned = TRUE;
   comb->priv.root.rev = revnum;
   comb->priv.repos_path = slash;
+  comb->priv.in_baseline_coll = TRUE;
 
   return FALSE;
 }
@@ -963,8 +975,8 @@ static dav_error * dav_svn_get_resource(request_rec *r,
   if ((repos->username = r->user) == NULL)
     repos->username = "anonymous";
 
-  /* open the SVN FS */
-  serr = svn_repos_open(&(repos->repos), fs_path, r->pool);
+  /* open the SVN FS, or reuse one an earlier request opened */
+  serr = dav_svn_open_repos(&(repos->repos), fs_path, r);
   if (serr != NULL)
     {
       return dav_svn_convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
@@ -976,6 +988,16 @@ static dav_error * dav_svn_get_resource(request_rec *r,
   /* cache the filesystem object */
   repos->fs = svn_repos_fs (repos->repos);
 
+  /* count the request from here on */
+  dav_svn_metrics_begin(r, repos->fs);
+
+  /* queue post-commit hooks, if so configured */
+  svn_repos_set_post_commit_async (repos->repos,
+                                   dav_svn_get_async_post_commit(r));
+
+  /* compute update deltas ahead on worker threads, if so configured */
+  svn_repos_set_delta_threads (repos->repos, dav_svn_get_delta_threads(r));
+
   /* capture warnings during cleanup of the FS */
   svn_fs_set_warning_func(repos->fs, log_warning, r);
 
@@ -1316,7 +1338,7 @@ static dav_error * dav_svn_seek_stream(dav_stream *stream,
 const char * dav_svn_getetag(const dav_resource *resource)
 {
   svn_error_t *serr;
-  svn_fs_id_t *id;      /* ### want const here */
+  const svn_fs_node_info_t *info;
   svn_stringbuf_t *idstr;
 
   /* if the resource doesn't exist, isn't a simple REGULAR or VERSION
@@ -1330,41 +1352,97 @@ const char * dav_svn_getetag(const dav_resource *resource)
 
   /* ### what kind of etag to return for collections, activities, etc? */
 
-  serr = svn_fs_node_id(&id, resource->info->root.root,
-                        DAV_SVN_REPOS_PATH(resource), resource->pool);
+  serr = dav_svn_get_node_info(&info, NULL, resource->info->root.root,
+                               DAV_SVN_REPOS_PATH(resource), resource->pool);
   if (serr != NULL) {
     /* ### what to do? */
     return "";
   }
 
-  idstr = svn_fs_unparse_id(id, resource->pool);
+  idstr = svn_fs_unparse_id(info->id, resource->pool);
   return apr_psprintf(resource->pool, "\"%s\"", idstr->data);
 }
 
+/* Set R's mtime to the date of the revision in which RESOURCE was
+   last changed.  Return FALSE if that can't be found out. */
+static int dav_svn_update_mtime(request_rec *r, const dav_resource *resource)
+{
+  svn_error_t *serr;
+  const svn_fs_node_info_t *info;
+  const svn_string_t *date;
+
+  serr = dav_svn_get_node_info(&info, NULL, resource->info->root.root,
+                               DAV_SVN_REPOS_PATH(resource), resource->pool);
+  if (serr == NULL)
+    serr = dav_svn_get_rev_prop(&date, resource->info->repos->fs,
+                                info->created_rev, SVN_PROP_REVISION_DATE,
+                                resource->pool);
+  if (serr != NULL)
+    {
+      svn_error_clear_all(serr);
+      return FALSE;
+    }
+  if (date == NULL)
+    return FALSE;
+
+  ap_update_mtime(r, svn_time_from_nts(date->data));
+  return TRUE;
+}
+
 static dav_error * dav_svn_set_headers(request_rec *r,
                                        const dav_resource *resource)
 {
   svn_error_t *serr;
   apr_off_t length;
   const char *mimetype;
+  const char *etag;
 
   if (!resource->exists)
     return NULL;
 
   /* ### what to do for collections, activities, etc */
 
-  /* make sure the proper mtime is in the request record */
-#if 0
-  ap_update_mtime(r, resource->info->finfo.mtime);
-#endif
+  /* A version resource, or a resource in a baseline collection, has a
+     revision in its URL, so it will never change: caches may keep it
+     as long as they like.  Anything else can change with the next
+     commit, so caches must check with us before using it again. */
+  if (resource->type == DAV_RESOURCE_TYPE_VERSION
+      || resource->info->in_baseline_coll)
+    apr_table_setn(r->headers_out, "Cache-Control",
+                   "max-age=" DAV_SVN_IMMUTABLE_MAX_AGE);
+  else
+    apr_table_setn(r->headers_out, "Cache-Control", "no-cache");
 
-  /* ### note that these use r->filename rather than <resource> */
-#if 0
-  ap_set_last_modified(r);
-#endif
+  /* The same URL gives the fulltext or an svndiff, depending on the
+     delta base the client asks for. */
+  if (!resource->collection)
+    apr_table_setn(r->headers_out, "Vary", SVN_DAV_DELTA_BASE_HEADER);
+
+  /* generate our etag and place it into the output. the etag is the
+     node revision's ID, which stands for the fulltext only; an svndiff
+     gets none. */
+  etag = dav_svn_getetag(resource);
+  if (resource->info->delta_base == NULL)
+    apr_table_setn(r->headers_out, "ETag", etag);
 
-  /* generate our etag and place it into the output */
-  apr_table_setn(r->headers_out, "ETag", dav_svn_getetag(resource));
+  /* A resource with an etag is in a revision, whose date is when it
+     was last modified.  With both of those, we can answer conditional
+     requests; a 304 response is sent by dav_svn_deliver (or for a
+     HEAD, by Apache). */
+  if (*etag != '\0' && dav_svn_update_mtime(r, resource))
+    {
+      int status;
+
+      ap_set_last_modified(r);
+
+      status = ap_meets_conditions(r);
+      if (status == HTTP_NOT_MODIFIED)
+        r->status = HTTP_NOT_MODIFIED;
+      else if (status != OK)
+        return dav_new_error(resource->pool, status, 0,
+                             "The resource does not meet the request's "
+                             "preconditions.");
+    }
 
   /* we accept byte-ranges */
   apr_table_setn(r->headers_out, "Accept-Ranges", "bytes");
@@ -1426,6 +1504,15 @@ static svn_error_t *dav_svn_write_to_filter(void *baton,
   apr_bucket *bkt;
   apr_status_t status;
 
+  /* keep a copy for the delta cache, unless it is getting too big */
+  if (dc->svndiff != NULL)
+    {
+      if (dc->svndiff->len + *len > dc->limit)
+        dc->svndiff = NULL;
+      else
+        svn_stringbuf_appendbytes(dc->svndiff, buffer, *len);
+    }
+
   /* take the current data and shove it into the filter */
   bb = apr_brigade_create(dc->pool, dc->output->c->bucket_alloc);
   bkt = apr_bucket_transient_create(buffer, *len, dc->output->c->bucket_alloc);
@@ -1473,6 +1560,19 @@ static dav_error * dav_svn_deliver(const dav_resource *resource,
                          "Cannot GET this type of resource.");
   }
 
+  /* dav_svn_set_headers found the client's copy is current, so the
+     response has no body. */
+  if (output->r->status == HTTP_NOT_MODIFIED) {
+    bb = apr_brigade_create(resource->pool, output->c->bucket_alloc);
+    bkt = apr_bucket_eos_create(output->c->bucket_alloc);
+    APR_BRIGADE_INSERT_TAIL(bb, bkt);
+    if ((status = ap_pass_brigade(output, bb)) != APR_SUCCESS) {
+      return dav_new_error(resource->pool, HTTP_INTERNAL_SERVER_ERROR, 0,
+                           "Could not write EOS to filter.");
+    }
+    return NULL;
+  }
+
   if (resource->collection) {
     apr_hash_t *entries;
     apr_pool_t *entry_pool;
@@ -1567,55 +1667,36 @@ static dav_error * dav_svn_deliver(const dav_resource *resource,
      request, then we just grab the file contents. */
   if (resource->info->delta_base == NULL)
     {
-      svn_stream_t *stream;
-      char *block;
+      apr_off_t length;
 
-      serr = svn_fs_file_contents(&stream,
-                                  resource->info->root.root,
-                                  DAV_SVN_REPOS_PATH(resource),
-                                  resource->pool);
+      serr = svn_fs_file_length(&length,
+                                resource->info->root.root,
+                                DAV_SVN_REPOS_PATH(resource),
+                                resource->pool);
       if (serr != NULL)
         {
           return dav_svn_convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
                                      "could not prepare to read the file");
         }
 
-      /* ### one day in the future, we can create a custom bucket type
-         ### which will read from the FS stream on demand */
-
-      block = apr_palloc(resource->pool, SVN_STREAM_CHUNK_SIZE);
-      while (1) {
-        apr_size_t bufsize = SVN_STREAM_CHUNK_SIZE;
-
-        /* read from the FS ... */
-        serr = svn_stream_read(stream, block, &bufsize);
-        if (serr != NULL)
-          {
-            return dav_svn_convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
-                                       "could not read the file contents");
-          }
-        if (bufsize == 0)
-          break;
-
-        /* build a brigade and write to the filter ... */
-        bb = apr_brigade_create(resource->pool, output->c->bucket_alloc);
-        bkt = apr_bucket_transient_create(block, bufsize, output->c->bucket_alloc);
-        APR_BRIGADE_INSERT_TAIL(bb, bkt);
-        if ((status = ap_pass_brigade(output, bb)) != APR_SUCCESS) {
-          /* ### what to do with status; and that HTTP code... */
-          return dav_new_error(resource->pool, HTTP_INTERNAL_SERVER_ERROR, 0,
-                               "Could not write data to filter.");
-        }
-      }
-
-      /* done with the file. write an EOS bucket now. */
+      /* hand the whole file to the filters in one FS bucket, which
+         reads from the FS as they read from it (and which the byterange
+         filter can cut up without reading anything). */
       bb = apr_brigade_create(resource->pool, output->c->bucket_alloc);
+      if (length > 0)
+        {
+          bkt = dav_svn_bucket_fs_create(resource->info->root.root,
+                                         DAV_SVN_REPOS_PATH(resource),
+                                         (apr_size_t) length, output->r,
+                                         output->c->bucket_alloc);
+          APR_BRIGADE_INSERT_TAIL(bb, bkt);
+        }
       bkt = apr_bucket_eos_create(output->c->bucket_alloc);
       APR_BRIGADE_INSERT_TAIL(bb, bkt);
       if ((status = ap_pass_brigade(output, bb)) != APR_SUCCESS) {
         /* ### what to do with status; and that HTTP code... */
         return dav_new_error(resource->pool, HTTP_INTERNAL_SERVER_ERROR, 0,
-                             "Could not write EOS to filter.");
+                             "Could not write data to filter.");
       }
 
       return NULL;
@@ -1632,6 +1713,12 @@ static dav_error * dav_svn_deliver(const dav_resource *resource,
     svn_txdelta_window_handler_t handler;
     void * h_baton;
     dav_svn_diff_ctx_t dc = { 0 };
+    request_rec *r = output->r;
+    apr_size_t limit = dav_svn_delta_cache_limit(r);
+    const char *target_id = NULL;
+    svn_revnum_t youngest = SVN_INVALID_REVNUM;
+
+    dav_svn_metrics_set_kind(r, DAV_SVN_REQUEST_GET_DELTA);
 
     /* First order of business is to parse it. */
     serr = dav_svn_simple_parse_uri(&info, resource,
@@ -1665,6 +1752,36 @@ static dav_error * dav_svn_deliver(const dav_resource *resource,
       return dav_new_error(resource->pool, HTTP_BAD_REQUEST, 0,
                            "the delta base does not refer to a file");
 
+    /* A delta between committed node revisions never changes, so it
+       may already be in the delta cache, and if not, can go there. */
+    if (limit > 0 && svn_fs_is_revision_root(resource->info->root.root))
+      {
+        svn_fs_id_t *id;
+        int delivered;
+        dav_error *derr;
+
+        serr = svn_fs_node_id(&id, resource->info->root.root,
+                              DAV_SVN_REPOS_PATH(resource), resource->pool);
+        if (serr == NULL)
+          serr = svn_fs_youngest_rev(&youngest, resource->info->repos->fs,
+                                     resource->pool);
+        if (serr != NULL)
+          return dav_svn_convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                     "could not identify the delta's target");
+        target_id = svn_fs_unparse_id(id, resource->pool)->data;
+
+        derr = dav_svn_deliver_cached_delta(&delivered,
+                                            resource->info->repos->fs_path,
+                                            id_str->data, target_id,
+                                            youngest, output,
+                                            resource->pool);
+        if (derr != NULL || delivered)
+          return derr;
+
+        dc.svndiff = svn_stringbuf_create("", resource->pool);
+        dc.limit = limit;
+      }
+
     /* Okay. Let's open up a delta stream for the client to read. */
     serr = svn_fs_get_file_delta_stream(&txd_stream,
                                         root, id_str->data,
@@ -1695,6 +1812,9 @@ static dav_error * dav_svn_deliver(const dav_resource *resource,
       return dav_svn_convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
                                  "could not deliver the txdelta stream");
 
+    if (dc.svndiff != NULL)
+      dav_svn_cache_delta(r, resource->info->repos->fs_path,
+                          id_str->data, target_id, youngest, dc.svndiff);
 
     return NULL;
   }
@@ -1829,6 +1949,7 @@ static dav_error * dav_svn_do_walk(dav_svn_walker_context *ctx, int depth)
   apr_size_t path_len;
   apr_size_t uri_len;
   apr_size_t repos_len;
+  const svn_fs_node_info_t *info;
   apr_hash_t *children;
 
   /* The current resource is a collection (possibly here thru recursion)
@@ -1882,13 +2003,17 @@ static dav_error * dav_svn_do_walk(dav_svn_walker_context *ctx, int depth)
   uri_len = ctx->uri->len;
   repos_len = ctx->repos_path->len;
 
-  /* fetch this collection's children */
+  /* fetch this collection's children, and what each one is. these
+     are remembered, so the callbacks' live properties are found
+     without asking the FS again. */
   /* ### shall we worry about filling params->pool? */
-  serr = svn_fs_dir_entries(&children, ctx->info.root.root,
-                            ctx->info.repos_path, params->pool);
+  serr = dav_svn_get_node_info(&info, &children, ctx->info.root.root,
+                               ctx->info.repos_path, params->pool);
   if (serr != NULL)
     return dav_svn_convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
                                "could not fetch collection members");
+  if (children == NULL)
+    return NULL;
 
   /* iterate over the children in this collection */
   for (hi = apr_hash_first(params->pool, children); hi; hi = apr_hash_next(hi))
@@ -1896,12 +2021,11 @@ static dav_error * dav_svn_do_walk(dav_svn_walker_context *ctx, int depth)
       const void *key;
       apr_ssize_t klen;
       void *val;
-      svn_fs_dirent_t *dirent;
-      int is_file;
+      const svn_fs_node_info_t *child;
 
       /* fetch one of the children */
       apr_hash_this(hi, &key, &klen, &val);
-      dirent = val;
+      child = val;
 
       /* authorize access to this resource, if applicable */
       if (params->walk_type & DAV_WALKTYPE_AUTH)
@@ -1918,14 +2042,7 @@ static dav_error * dav_svn_do_walk(dav_svn_walker_context *ctx, int depth)
       ctx->res.uri = ctx->uri->data;
       ctx->info.repos_path = ctx->repos_path->data;
 
-      serr = svn_fs_is_file(&is_file,
-                            ctx->info.root.root, ctx->info.repos_path,
-                            params->pool);
-      if (serr != NULL)
-        return dav_svn_convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
-                                   "could not determine resource kind");
-
-      if ( is_file )
+      if (child->kind == svn_node_file)
         {
           err = (*params->func)(&ctx->wres, DAV_CALLTYPE_MEMBER);
           if (err != NULL)
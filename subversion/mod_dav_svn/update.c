@@ -28,6 +28,7 @@
 #include "svn_fs.h"
 #include "svn_xml.h"
 #include "svn_path.h"
+#include "svn_base64.h"
 
 #include "dav_svn.h"
 
@@ -53,6 +54,11 @@ typedef struct {
 
   /* where to deliver the output */
   ap_filter_t *output;
+
+  /* did the client ask for a "send-all" report? if so, file texts and
+     property changes go inline in the report, rather than being left
+     for the client to fetch with separate requests. */
+  svn_boolean_t send_all;
 } update_ctx_t;
 
 typedef struct {
@@ -107,6 +113,12 @@ static void send_xml(update_ctx_t *uc, const char *fmt, ...)
   va_end(ap);
 }
 
+/* write LEN bytes of DATA into the report as they are */
+static void send_data(update_ctx_t *uc, const char *data, apr_size_t len)
+{
+  (void) apr_brigade_write(uc->bb, ap_filter_flush, uc->output, data, len);
+}
+
 static void send_vsn_url(item_baton_t *baton)
 {
   svn_error_t *serr;
@@ -270,11 +282,14 @@ static svn_error_t * upd_set_target_revision(void *edit_baton,
 {
   update_ctx_t *uc = edit_baton;
 
+  /* tell the client whether it is getting a send-all report; a client
+     that asked for one from an older server will get a plain one. */
   send_xml(uc,
            DAV_XML_HEADER DEBUG_CR
 	   "<S:update-report xmlns:S=\"" SVN_XML_NAMESPACE "\" "
-           "xmlns:D=\"DAV:\">" DEBUG_CR
-	   "<S:target-revision rev=\"%ld\"/>" DEBUG_CR, target_revision);
+           "xmlns:D=\"DAV:\"%s>" DEBUG_CR
+	   "<S:target-revision rev=\"%ld\"/>" DEBUG_CR,
+           uc->send_all ? " send-all=\"true\"" : "", target_revision);
 
   return NULL;
 }
@@ -349,6 +364,27 @@ static svn_error_t * upd_change_xxx_prop(void *baton,
 
   qname = svn_stringbuf_create (apr_xml_quote_string (b->pool, name->data, 1),
                                 b->pool);
+
+  /* in a send-all report, the change goes out right now. the values
+     may be binary, so they are base64-encoded. */
+  if (b->uc->send_all)
+    {
+      if (value)
+        {
+          svn_stringbuf_t *enc = svn_base64_encode_string(value, b->pool);
+
+          send_xml(b->uc, "<S:set-prop name=\"%s\" encoding=\"base64\">"
+                   DEBUG_CR, qname->data);
+          send_data(b->uc, enc->data, enc->len);
+          send_xml(b->uc, "</S:set-prop>" DEBUG_CR);
+        }
+      else
+        send_xml(b->uc, "<S:remove-prop name=\"%s\"/>" DEBUG_CR,
+                 qname->data);
+
+      return NULL;
+    }
+
   if (value)
     {
       if (! b->changed_props)
@@ -403,11 +439,53 @@ static svn_error_t * noop_handler(svn_txdelta_window_t *window, void *baton)
   return NULL;
 }
 
+/* In a send-all report, a file's svndiff is sent inside an <S:txdelta>
+   element, as a series of <S:svndiff> elements each holding one write's
+   worth of the svndiff data in base64. The svndiff encoder writes the
+   header and then each window separately, so the client can apply each
+   window as it arrives. */
+static svn_error_t * svndiff_write(void *baton, const char *data,
+                                   apr_size_t *len)
+{
+  item_baton_t *file = baton;
+  apr_pool_t *subpool = svn_pool_create(file->pool);
+  svn_stringbuf_t *enc;
+
+  enc = svn_base64_encode_string(svn_stringbuf_ncreate(data, *len, subpool),
+                                 subpool);
+  send_xml(file->uc, "<S:svndiff>");
+  send_data(file->uc, enc->data, enc->len);
+  send_xml(file->uc, "</S:svndiff>" DEBUG_CR);
+
+  svn_pool_destroy(subpool);
+  return NULL;
+}
+
+static svn_error_t * svndiff_close(void *baton)
+{
+  item_baton_t *file = baton;
+
+  send_xml(file->uc, "</S:txdelta>" DEBUG_CR);
+  return NULL;
+}
+
 static svn_error_t * upd_apply_textdelta(void *file_baton, 
                                        svn_txdelta_window_handler_t *handler,
                                        void **handler_baton)
 {
   item_baton_t *file = file_baton;
+  svn_stream_t *stream;
+
+  if (file->uc->send_all)
+    {
+      stream = svn_stream_create(file, file->pool);
+      svn_stream_set_write(stream, svndiff_write);
+      svn_stream_set_close(stream, svndiff_close);
+
+      send_xml(file->uc, "<S:txdelta>" DEBUG_CR);
+      svn_txdelta_to_svndiff(stream, file->pool, handler, handler_baton);
+      return NULL;
+    }
 
   /* if we added the file, then no need to tell the client to fetch it */
   if (!file->added)
@@ -440,6 +518,7 @@ dav_error * dav_svn__update_report(const dav_resource *resource,
 {
   svn_delta_edit_fns_t *editor;
   apr_xml_elem *child;
+  apr_xml_attr *attr;
   void *rbaton;
   update_ctx_t uc = { 0 };
   svn_revnum_t revnum = SVN_INVALID_REVNUM;
@@ -468,6 +547,13 @@ dav_error * dav_svn__update_report(const dav_resource *resource,
                            "is required.");
     }
   
+  /* a client that can take file texts and property changes inline
+     says so with a send-all attribute on the report element. */
+  for (attr = doc->root->attr; attr != NULL; attr = attr->next)
+    if (strcmp(attr->name, "send-all") == 0
+        && strcmp(attr->value, "true") == 0)
+      uc.send_all = TRUE;
+
   for (child = doc->root->first_child; child != NULL; child = child->next)
     {
       if (child->ns == ns && strcmp(child->name, "target-revision") == 0)
@@ -581,7 +667,7 @@ dav_error * dav_svn__update_report(const dav_resource *resource,
                                 repos->repos, 
                                 resource->info->repos_path, target,
                                 dir_delta_target,
-                                FALSE, /* don't send text-deltas */
+                                uc.send_all, /* send text-deltas? */
                                 recurse,
                                 editor, &uc, resource->pool);
 
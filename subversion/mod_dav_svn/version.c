@@ -74,6 +74,9 @@ static void dav_svn_get_vsn_options(apr_pool_t *p, ap_text_header *phdr)
   ap_text_append(p, phdr,
                  "merge,baseline,activity,version-controlled-collection");
 
+  /* we take a whole commit in one POST, too (see commit.c) */
+  ap_text_append(p, phdr, SVN_DAV_OPTION_SINGLE_COMMIT);
+
   /* ### fork-control? */
 }
 
@@ -399,10 +402,12 @@ static dav_error *dav_svn_deliver_report(request_rec *r,
 
       if (strcmp(doc->root->name, "update-report") == 0)
         {
+          dav_svn_metrics_set_kind(r, DAV_SVN_REQUEST_UPDATE_REPORT);
           return dav_svn__update_report(resource, doc, output);
         }
       if (strcmp(doc->root->name, "log-report") == 0)
         {
+          dav_svn_metrics_set_kind(r, DAV_SVN_REQUEST_LOG_REPORT);
           return dav_svn__log_report(resource, doc, output);
         }
     }
@@ -483,6 +488,11 @@ static dav_error *dav_svn_merge(dav_resource *target, dav_resource *source,
                       source->info->root.txn_name, pool)) != NULL)
     return err;
 
+  /* the activity ends with the commit. */
+  if ((err = dav_svn_forget_activity(source->info->repos,
+                                     source->info->root.activity_id)) != NULL)
+    return err;
+
   /* all righty... commit the bugger. */
   serr = svn_repos_fs_commit_txn(&conflict, source->info->repos->repos,
                                  &new_rev, txn);
@@ -26,14 +26,23 @@ typedef enum svnadmin_cmd_t
   svnadmin_cmd_create,
   svnadmin_cmd_createtxn,
   svnadmin_cmd_deltify,
+  svnadmin_cmd_dump,
+  svnadmin_cmd_gc,
+  svnadmin_cmd_hotcopy,
+  svnadmin_cmd_load,
   svnadmin_cmd_lscr,
+  svnadmin_cmd_lsqueue,
   svnadmin_cmd_lsrevs,
   svnadmin_cmd_lstxns,
   svnadmin_cmd_recover,
+  svnadmin_cmd_replicate,
   svnadmin_cmd_rmtxns,
+  svnadmin_cmd_runhooks,
   svnadmin_cmd_setlog,
   svnadmin_cmd_shell,
+  svnadmin_cmd_spool,
   svnadmin_cmd_undeltify,
+  svnadmin_cmd_verify,
   svnadmin_cmd_youngest
 
 } svnadmin_cmd_t;
@@ -125,6 +134,30 @@ usage (const char *progname, int exit_code)
      "      a directory, perform a recursive deltification of the\n"
      "      tree starting at PATH.\n"
      "\n"
+     "   dump      [--deltas] REPOS_PATH [LOWER_REV [UPPER_REV]]\n"
+     "      Dump the contents of the filesystem to stdout in a portable\n"
+     "      dumpfile format, sending feedback to stderr.  Dump revisions\n"
+     "      LOWER_REV through UPPER_REV, or all revisions if none are\n"
+     "      given.  With \"--deltas\", file texts are written as deltas.\n"
+     "\n"
+     "   gc        [--batch N] REPOS_PATH\n"
+     "      Delete the node revisions, representations and strings that\n"
+     "      nothing in the repository refers to any more, such as those\n"
+     "      left behind by crashed clients.  Work through N records per\n"
+     "      database transaction (default 500).  Safe to run while the\n"
+     "      repository is in use, and to run again if interrupted.\n"
+     "\n"
+     "   hotcopy   [--incremental] REPOS_PATH NEW_REPOS_PATH\n"
+     "      Make a consistent copy of a repository while it is in use.\n"
+     "      With \"--incremental\", NEW_REPOS_PATH must be an earlier hot\n"
+     "      copy; copy only the database log files written since, and\n"
+     "      replay them to bring it up to date.\n"
+     "\n"
+     "   load      REPOS_PATH\n"
+     "      Read a dumpfile-formatted stream from stdin, committing new\n"
+     "      revisions into the repository's filesystem.  Send progress\n"
+     "      feedback to stdout.\n"
+     "\n"
      "   lscr      REPOS_PATH PATH\n"
      "      Print, one-per-line and youngest-to-eldest, the revisions in\n"
      "      which PATH was modified.\n"
@@ -132,6 +165,10 @@ usage (const char *progname, int exit_code)
      "      uninteresting.  Also, PATH must exist in the HEAD of the\n"
      "      repository.)\n"
      "\n"
+     "   lsqueue   REPOS_PATH\n"
+     "      Print the number of post-commit hooks waiting in the\n"
+     "      repository's queue, and how many seconds the oldest has waited.\n"
+     "\n"
      "   lsrevs    REPOS_PATH [LOWER_REV [UPPER_REV]]\n"
      "      If no revision is given, all revision trees are printed.\n"
      "      If just LOWER_REV is given, that revision tree is printed.\n"
@@ -149,9 +186,21 @@ usage (const char *progname, int exit_code)
      "      ought to be run.\n"
      "\n"
 #endif /* 0 */
+     "   replicate [--prune] SPOOL_PATH REPLICA_PATH [...]\n"
+     "      Bring each REPLICA_PATH up to date from a master's spool,\n"
+     "      creating it as a read-only replica if it doesn't exist.\n"
+     "      With \"--prune\", then delete the spooled revisions that\n"
+     "      all of the named replicas have.\n"
+     "\n"
      "   rmtxns    REPOS_PATH TXN_NAME [...]\n"
      "      Delete the transaction(s) named TXN_NAME.\n"
      "\n"
+     "   runhooks  [--threads N] [--attempts N] REPOS_PATH\n"
+     "      Run the post-commit hooks waiting in the repository's queue,\n"
+     "      on N threads (default 1), and print what happened.  A hook\n"
+     "      that fails is left queued until it has failed N times\n"
+     "      (default 5), and then set aside as REV.failed.\n"
+     "\n"
      "   setlog    REPOS_PATH REVNUM FILE\n"
      "      Set the log-message on revision REVNUM to the contents of FILE.\n"
      "      (Careful!  Revision props are not historied, so this command\n"
@@ -160,11 +209,22 @@ usage (const char *progname, int exit_code)
      "   shell     REPOS_PATH\n"
      "      Enter interactive shell for exploring the repository.\n"
      "\n"
+     "   spool     REPOS_PATH [LOWER_REV [UPPER_REV]]\n"
+     "      Start spooling the repository's commits for replicas, and\n"
+     "      spool revisions LOWER_REV through UPPER_REV, or all\n"
+     "      revisions if none are given, for replicas yet to be made.\n"
+     "\n"
      "   undeltify REPOS_PATH REVISION PATH\n"
      "      Undeltify (ensure fulltext storage for) PATH in REVISION.\n"
      "      If PATH represents a directory, perform a recursive\n"
      "      undeltification of the tree starting at PATH.\n"
      "\n"
+     "   verify    [--threads N] REPOS_PATH\n"
+     "      Reconstruct the contents of every representation in the\n"
+     "      repository on N threads (default 1), check each against the\n"
+     "      MD5 checksum recorded when it was committed, and list any\n"
+     "      that are corrupt.\n"
+     "\n"
      "   youngest  REPOS_PATH\n"
      "      Print the latest revision number.\n"
      "\n"
@@ -206,6 +266,24 @@ parse_command (const char *command)
     return svnadmin_cmd_deltify;
   else if (! strcmp (command, "recover"))
     return svnadmin_cmd_recover;
+  else if (! strcmp (command, "dump"))
+    return svnadmin_cmd_dump;
+  else if (! strcmp (command, "load"))
+    return svnadmin_cmd_load;
+  else if (! strcmp (command, "lsqueue"))
+    return svnadmin_cmd_lsqueue;
+  else if (! strcmp (command, "runhooks"))
+    return svnadmin_cmd_runhooks;
+  else if (! strcmp (command, "verify"))
+    return svnadmin_cmd_verify;
+  else if (! strcmp (command, "gc"))
+    return svnadmin_cmd_gc;
+  else if (! strcmp (command, "hotcopy"))
+    return svnadmin_cmd_hotcopy;
+  else if (! strcmp (command, "spool"))
+    return svnadmin_cmd_spool;
+  else if (! strcmp (command, "replicate"))
+    return svnadmin_cmd_replicate;
 
   return svnadmin_cmd_unknown;
 }
@@ -291,7 +369,8 @@ main (int argc, const char * const *argv)
         fs = svn_repos_fs (repos);
         svn_fs_youngest_rev (&youngest_rev, fs, pool);
         INT_ERR (svn_fs_revision_root (&rev_root, fs, youngest_rev, pool));
-        INT_ERR (svn_fs_revisions_changed (&revs, rev_root, paths, pool));
+        INT_ERR (svn_fs_revisions_changed (&revs, rev_root, paths,
+                                           SVN_INVALID_REVNUM, 0, pool));
         for (i = 0; i < revs->nelts; i++)
           {
             svn_revnum_t this_rev = ((svn_revnum_t *)revs->elts)[i];
@@ -499,6 +578,257 @@ main (int argc, const char * const *argv)
       }
       break;
 
+    case svnadmin_cmd_dump:
+      {
+        svn_revnum_t
+          lower = SVN_INVALID_REVNUM,
+          upper = SVN_INVALID_REVNUM;
+        svn_boolean_t use_deltas = FALSE;
+        int i = 2;
+
+        if (strcmp (argv[2], "--deltas") == 0)
+          {
+            if (argc < 4)
+              {
+                usage (argv[0], 1);
+                /* NOTREACHED */
+              }
+            use_deltas = TRUE;
+            path = argv[3];
+            i = 3;
+          }
+
+        /* Do the args tell us what revisions to dump? */
+        if (argv[i + 1])
+          {
+            lower = SVN_STR_TO_REV (argv[i + 1]);
+            upper = argv[i + 2] ? SVN_STR_TO_REV (argv[i + 2]) : lower;
+          }
+
+        INT_ERR (svn_repos_open (&repos, path, pool));
+        INT_ERR (svn_repos_dump_fs (repos,
+                                    svn_stream_from_stdio (stdout, pool),
+                                    svn_stream_from_stdio (stderr, pool),
+                                    lower, upper, use_deltas, pool));
+      }
+      break;
+
+    case svnadmin_cmd_load:
+      {
+        INT_ERR (svn_repos_open (&repos, path, pool));
+        INT_ERR (svn_repos_load_fs (repos,
+                                    svn_stream_from_stdio (stdin, pool),
+                                    svn_stream_from_stdio (stdout, pool),
+                                    pool));
+      }
+      break;
+
+    case svnadmin_cmd_lsqueue:
+      {
+        int depth;
+        apr_time_t oldest;
+
+        INT_ERR (svn_repos_open (&repos, path, pool));
+        INT_ERR (svn_repos_post_commit_queue_depth (&depth, &oldest,
+                                                    repos, pool));
+        printf ("%d %ld\n", depth,
+                oldest ? (long int) ((apr_time_now () - oldest)
+                                     / APR_USEC_PER_SEC) : 0L);
+      }
+      break;
+
+    case svnadmin_cmd_runhooks:
+      {
+        svn_repos_hook_queue_stats_t stats;
+        int num_threads = 1, max_attempts = 5;
+        int i = 2;
+
+        while (argv[i] && argv[i][0] == '-' && argv[i][1] == '-')
+          {
+            if (! argv[i + 1])
+              {
+                usage (argv[0], 1);
+                /* NOTREACHED */
+              }
+            if (strcmp (argv[i], "--threads") == 0)
+              num_threads = atoi (argv[i + 1]);
+            else if (strcmp (argv[i], "--attempts") == 0)
+              max_attempts = atoi (argv[i + 1]);
+            else
+              {
+                usage (argv[0], 1);
+                /* NOTREACHED */
+              }
+            i += 2;
+          }
+        if (! argv[i] || num_threads < 1 || max_attempts < 1)
+          {
+            usage (argv[0], 1);
+            /* NOTREACHED */
+          }
+        path = argv[i];
+
+        INT_ERR (svn_repos_open (&repos, path, pool));
+        INT_ERR (svn_repos_run_post_commit_queue (&stats, repos, num_threads,
+                                                  max_attempts, pool));
+        printf ("Ran %d hooks: %d failed and will be retried, "
+                "%d failed for the last time.\n",
+                stats.run + stats.retried + stats.failed,
+                stats.retried, stats.failed);
+        printf ("Hook time: %.3fs total, %.3fs longest.\n",
+                (double) stats.total_time / APR_USEC_PER_SEC,
+                (double) stats.max_time / APR_USEC_PER_SEC);
+        printf ("Longest wait in queue: %.3fs.\n",
+                (double) stats.max_wait / APR_USEC_PER_SEC);
+        printf ("Still queued: %d.\n", stats.queued);
+      }
+      break;
+
+    case svnadmin_cmd_verify:
+      {
+        svn_fs_verify_stats_t stats;
+        svn_error_t *err;
+        int num_threads = 1;
+        int i = 2;
+
+        if (argv[i] && strcmp (argv[i], "--threads") == 0)
+          {
+            if (! argv[i + 1])
+              {
+                usage (argv[0], 1);
+                /* NOTREACHED */
+              }
+            num_threads = atoi (argv[i + 1]);
+            i += 2;
+          }
+        if (! argv[i] || num_threads < 1)
+          {
+            usage (argv[0], 1);
+            /* NOTREACHED */
+          }
+        path = argv[i];
+
+        memset (&stats, 0, sizeof (stats));
+        INT_ERR (svn_repos_open (&repos, path, pool));
+        err = svn_fs_verify (&stats, svn_repos_fs (repos), num_threads, pool);
+        printf ("Verified %d representations: %d matched their checksums, "
+                "%d had none, %d corrupt.\n",
+                stats.checked + stats.skipped + stats.corrupt,
+                stats.checked, stats.skipped, stats.corrupt);
+        INT_ERR (err);
+      }
+      break;
+
+    case svnadmin_cmd_gc:
+      {
+        svn_fs_gc_stats_t stats;
+        int batch_size = 0;
+        int i = 2;
+
+        if (argv[i] && strcmp (argv[i], "--batch") == 0)
+          {
+            if (! argv[i + 1])
+              {
+                usage (argv[0], 1);
+                /* NOTREACHED */
+              }
+            batch_size = atoi (argv[i + 1]);
+            i += 2;
+            if (batch_size < 1)
+              {
+                usage (argv[0], 1);
+                /* NOTREACHED */
+              }
+          }
+        if (! argv[i])
+          {
+            usage (argv[0], 1);
+            /* NOTREACHED */
+          }
+        path = argv[i];
+
+        INT_ERR (svn_repos_open (&repos, path, pool));
+        INT_ERR (svn_fs_gc (&stats, svn_repos_fs (repos), batch_size, pool));
+        printf ("Deleted %d node revisions, %d representations, "
+                "%d strings.\n", stats.nodes, stats.reps, stats.strings);
+      }
+      break;
+
+    case svnadmin_cmd_hotcopy:
+      {
+        svn_boolean_t incremental = FALSE;
+        int i = 2;
+
+        if (argv[i] && strcmp (argv[i], "--incremental") == 0)
+          {
+            incremental = TRUE;
+            i++;
+          }
+        if (! (argv[i] && argv[i + 1]) || argv[i + 2])
+          {
+            usage (argv[0], 1);
+            /* NOTREACHED */
+          }
+
+        INT_ERR (svn_repos_hotcopy (argv[i], argv[i + 1], incremental, pool));
+      }
+      break;
+
+    case svnadmin_cmd_spool:
+      {
+        svn_revnum_t
+          lower = SVN_INVALID_REVNUM,
+          upper = SVN_INVALID_REVNUM;
+
+        if (argv[3])
+          {
+            lower = SVN_STR_TO_REV (argv[3]);
+            upper = argv[4] ? SVN_STR_TO_REV (argv[4]) : lower;
+          }
+
+        INT_ERR (svn_repos_open (&repos, path, pool));
+        INT_ERR (svn_repos_spool_revisions (repos, lower, upper, pool));
+      }
+      break;
+
+    case svnadmin_cmd_replicate:
+      {
+        svn_revnum_t youngest, oldest = SVN_INVALID_REVNUM;
+        svn_boolean_t prune = FALSE;
+        const char *spool_path;
+        int i = 2;
+
+        if (strcmp (argv[i], "--prune") == 0)
+          {
+            prune = TRUE;
+            i++;
+          }
+        if (! (argv[i] && argv[i + 1]))
+          {
+            usage (argv[0], 1);
+            /* NOTREACHED */
+          }
+        spool_path = argv[i];
+
+        for (i++; i < argc; i++)
+          {
+            INT_ERR (svn_repos_replicate (&youngest, spool_path, argv[i],
+                                          svn_stream_from_stdio (stdout,
+                                                                 pool),
+                                          pool));
+            printf ("Replica `%s' is at revision %ld.\n",
+                    argv[i], (long int) youngest);
+            if (oldest == SVN_INVALID_REVNUM || youngest < oldest)
+              oldest = youngest;
+          }
+
+        /* Only the replicas named are considered; any others fed from
+           the same spool had better have what gets pruned.  */
+        if (prune)
+          INT_ERR (svn_repos_prune_spool (spool_path, oldest, pool));
+      }
+      break;
+
     case svnadmin_cmd_deltify:
     case svnadmin_cmd_undeltify:
       {
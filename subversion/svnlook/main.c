@@ -34,16 +34,12 @@
 #include "svn_fs.h"
 #include "svn_repos.h"
 #include "svn_time.h"
+#include "svn_io.h"
+#include "svn_diff.h"
 
 
 /*** Some convenience macros and types. ***/
 
-/* Temporary subdirectory created for use by svnlook.  ### todo: we
-   need to either find a way to query APR for a suitable (that is,
-   writable) temporary directory, or add this #define to the
-   svn_private_config.h stuffs (with a default of perhaps "/tmp/.svnlook" */
-#define SVNLOOK_TMPDIR       ".svnlook"
-
 typedef enum svnlook_cmd_t
 {
   svnlook_cmd_default = 0,
@@ -293,105 +289,81 @@ print_changed_tree (svn_repos_node_t *node,
 }
 
 
+/* Set *CONTENTS to the contents of the file PATH in ROOT, read
+   straight from the filesystem, or to the empty string if ROOT is
+   NULL.  Allocate *CONTENTS in POOL.  */
 static svn_error_t *
-open_writable_binary_file (apr_file_t **fh, 
-                           svn_stringbuf_t *path, 
-                           apr_pool_t *pool)
+get_file_contents (svn_string_t **contents,
+                   svn_fs_root_t *root,
+                   svn_stringbuf_t *path,
+                   apr_pool_t *pool)
 {
-  apr_array_header_t *path_pieces;
-  apr_status_t apr_err;
-  int i;
-  svn_stringbuf_t *full_path, *dir, *basename;
-  
-  /* Try the easy way to open the file. */
-  apr_err = apr_file_open (fh, path->data, 
-                           APR_WRITE | APR_CREATE | APR_TRUNCATE | APR_BINARY,
-                           APR_OS_DEFAULT, pool);
-  if (! apr_err)
-    return SVN_NO_ERROR;
-
-  svn_path_split (path, &dir, &basename, pool);
+  svn_stringbuf_t *buf = svn_stringbuf_create ("", pool);
 
-  /* If the file path has no parent, then we've already tried to open
-     it as best as we care to try above. */
-  if (svn_path_is_empty (dir))
-    return svn_error_createf (apr_err, 0, NULL, pool,
-                              "Error opening writable file %s", path->data);
-
-  path_pieces = svn_path_decompose (dir, pool);
-  if (! path_pieces->nelts)
-    return APR_SUCCESS;
-
-  full_path = svn_stringbuf_create ("", pool);
-  for (i = 0; i < path_pieces->nelts; i++)
+  if (root)
     {
-      enum svn_node_kind kind;
-      svn_stringbuf_t *piece = ((svn_stringbuf_t **) (path_pieces->elts))[i];
-      svn_path_add_component (full_path, piece);
-      SVN_ERR (svn_io_check_path (full_path->data, &kind, pool));
+      svn_stream_t *stream;
+      apr_off_t length;
+      apr_size_t len;
 
-      /* Does this path component exist at all? */
-      if (kind == svn_node_none)
-        {
-          apr_err = apr_dir_make (full_path->data, APR_OS_DEFAULT, pool);
-          if (apr_err)
-            return svn_error_createf (apr_err, 0, NULL, pool,
-                                      "Error creating dir %s", 
-                                      full_path->data);
-        }
-      else if (kind != svn_node_dir)
+      /* Size the buffer up front, so the text is copied only once. */
+      SVN_ERR (svn_fs_file_length (&length, root, path->data, pool));
+      svn_stringbuf_ensure (buf, (apr_size_t) length + 1);
+
+      SVN_ERR (svn_fs_file_contents (&stream, root, path->data, pool));
+      do
         {
-          if (apr_err)
-            return svn_error_createf (apr_err, 0, NULL, pool,
-                                      "Error creating dir %s (path exists)", 
-                                      full_path->data);
+          len = SVN_STREAM_CHUNK_SIZE;
+          svn_stringbuf_ensure (buf, buf->len + len + 1);
+          SVN_ERR (svn_stream_read (stream, buf->data + buf->len, &len));
+          buf->len += len;
         }
+      while (len == SVN_STREAM_CHUNK_SIZE);
+      buf->data[buf->len] = '\0';
     }
 
-  /* Now that we are ensured that the parent path for this file
-     exists, try once more to open it. */
-  apr_err = apr_file_open (fh, path->data, 
-                           APR_WRITE | APR_CREATE | APR_TRUNCATE | APR_BINARY,
-                           APR_OS_DEFAULT, pool);
-  if (apr_err)
-    return svn_error_createf (apr_err, 0, NULL, pool,
-                              "Error opening writable file %s", path->data);
-    
+  *contents = apr_palloc (pool, sizeof (**contents));
+  (*contents)->data = buf->data;
+  (*contents)->len = buf->len;
   return SVN_NO_ERROR;
 }
 
 
+/* How much of a file without an svn:mime-type to look at when
+   deciding whether it is binary. */
+#define BINARY_SNIFF_SIZE 1024
+
+/* Set *BINARY to TRUE if the file PATH in ROOT should not be shown as
+   text: if its svn:mime-type says it isn't text, or, lacking one, if
+   its first BINARY_SNIFF_SIZE bytes look binary.  Only that much of
+   the file is read.  ROOT may be NULL, for a file that isn't there.
+   Use POOL for temporary allocations.  */
 static svn_error_t *
-dump_contents (apr_file_t *fh,
-               svn_fs_root_t *root,
-               svn_stringbuf_t *path,
-               apr_pool_t *pool)
+is_binary_file (svn_boolean_t *binary,
+                svn_fs_root_t *root,
+                svn_stringbuf_t *path,
+                apr_pool_t *pool)
 {
-  apr_status_t apr_err;
-  apr_size_t len, len2;
+  svn_string_t *mime_type;
   svn_stream_t *stream;
-  unsigned char buffer[1024];
+  char buf[BINARY_SNIFF_SIZE];
+  apr_size_t len = sizeof (buf);
 
-  /* Get a stream to the current file's contents. */
-  SVN_ERR (svn_fs_file_contents (&stream, root, path->data, pool));
-  
-  /* Now, route that data into our temporary file. */
-  while (1)
+  *binary = FALSE;
+  if (! root)
+    return SVN_NO_ERROR;
+
+  SVN_ERR (svn_fs_node_prop (&mime_type, root, path->data,
+                             SVN_PROP_MIME_TYPE, pool));
+  if (mime_type)
     {
-      len = sizeof (buffer);
-      SVN_ERR (svn_stream_read (stream, buffer, &len));
-      len2 = len;
-      apr_err = apr_file_write (fh, buffer, &len2);
-      if ((apr_err) || (len2 != len))
-        return svn_error_createf 
-          (apr_err ? apr_err : SVN_ERR_INCOMPLETE_DATA, 0, NULL, pool,
-               "Error writing contents of %s", path->data);
-      if (len != sizeof (buffer))
-        break;
+      *binary = (strncmp (mime_type->data, "text/", 5) != 0);
+      return SVN_NO_ERROR;
     }
 
-  /* And close the file. */
-  apr_file_close (fh);
+  SVN_ERR (svn_fs_file_contents (&stream, root, path->data, pool));
+  SVN_ERR (svn_stream_read (stream, buf, &len));
+  *binary = svn_io_is_binary_data (buf, len);
   return SVN_NO_ERROR;
 }
 
@@ -407,8 +379,6 @@ print_diff_tree (svn_fs_root_t *root,
 {
   svn_repos_node_t *tmp_node;
   svn_stringbuf_t *full_path;
-  svn_stringbuf_t *orig_path = NULL, *new_path = NULL;
-  apr_file_t *fh1, *fh2;
       
   if (! node)
     return SVN_NO_ERROR;
@@ -416,76 +386,28 @@ print_diff_tree (svn_fs_root_t *root,
   /* Print the node. */
   tmp_node = node;
 
-  /* First, we'll just print file content diffs. */
-  if (tmp_node->kind == svn_node_file)
+  /* We'll just print file content diffs.  Both versions of the file
+     are read from the filesystem and compared in memory; an added
+     file is compared against nothing, and nothing against a deleted
+     one.  */
+  if ((tmp_node->kind == svn_node_file)
+      && (((tmp_node->action == 'R') && (tmp_node->text_mod))
+          || (tmp_node->action == 'A')
+          || (tmp_node->action == 'D')))
     {
-      /* Here's the generalized way we do our diffs:
-
-         - First, dump the contents of the new version of the file
-           into the svnlook temporary directory, building out the
-           actual directories that need to be created in order to
-           fully represent the filesystem path inside the tmp
-           directory.
-
-         - Then, dump the contents of the old version of the file into
-           the top level of the svnlook temporary directory using a
-           unique temporary file name (we do this *after* putting the
-           new version of the file there in case something actually
-           versioned has a name that looks like one of our unique
-           identifiers).
-           
-         - Next, we run 'diff', passing the repository path as the
-           label.  
-
-         - Finally, we delete the temporary files (but leave the
-           built-out directories in place until after all diff
-           handling has been finished).  */
-      if ((tmp_node->action == 'R') && (tmp_node->text_mod))
-        {
-          new_path = svn_stringbuf_create (SVNLOOK_TMPDIR, pool);
-          svn_path_add_component (new_path, path);
-          SVN_ERR (open_writable_binary_file (&fh1, new_path, pool));
-          SVN_ERR (dump_contents (fh1, root, path, pool));
-          apr_file_close (fh1);
-
-          SVN_ERR (svn_io_open_unique_file (&fh2, &orig_path, new_path->data,
-                                            NULL, FALSE, pool));
-          SVN_ERR (dump_contents (fh2, base_root, path, pool));
-          apr_file_close (fh2);
-        }
-      if (tmp_node->action == 'A')
-        {
-          new_path = svn_stringbuf_create (SVNLOOK_TMPDIR, pool);
-          svn_path_add_component (new_path, path);
-          SVN_ERR (open_writable_binary_file (&fh1, new_path, pool));
-          SVN_ERR (dump_contents (fh1, root, path, pool));
-          apr_file_close (fh1);
-
-          SVN_ERR (svn_io_open_unique_file (&fh2, &orig_path, new_path->data,
-                                            NULL, FALSE, pool));
-          apr_file_close (fh2);
-        }
-      if (tmp_node->action == 'D')
-        {
-          new_path = svn_stringbuf_create (SVNLOOK_TMPDIR, pool);
-          svn_path_add_component (new_path, path);
-          SVN_ERR (open_writable_binary_file (&fh1, new_path, pool));
-          apr_file_close (fh1);
-
-          SVN_ERR (svn_io_open_unique_file (&fh2, &orig_path, new_path->data,
-                                            NULL, FALSE, pool));
-          SVN_ERR (dump_contents (fh2, base_root, path, pool));
-          apr_file_close (fh2);
-        }
-    }
-
-  if (orig_path && new_path)
-    {
-      apr_file_t *outhandle;
-      apr_status_t apr_err;
-      const char *label;
-      svn_stringbuf_t *abs_path;
-      int exitcode;
+      apr_pool_t *subpool = svn_pool_create (pool);
+      svn_fs_root_t *orig_root = (tmp_node->action == 'A') ? NULL : base_root;
+      svn_fs_root_t *new_root = (tmp_node->action == 'D') ? NULL : root;
+      svn_string_t *orig_contents, *new_contents;
+      svn_boolean_t orig_binary, new_binary;
+
+      /* Decide from the mime-types, or the start of each file, before
+         reading either in full; binary files are never diffed. */
+      SVN_ERR (is_binary_file (&orig_binary, orig_root, path, subpool));
+      if (! orig_binary)
+        SVN_ERR (is_binary_file (&new_binary, new_root, path, subpool));
+      else
+        new_binary = FALSE;
 
       printf ("%s: %s\n", 
               ((tmp_node->action == 'A') ? "Added" : 
@@ -494,34 +416,28 @@ print_diff_tree (svn_fs_root_t *root,
               path->data);
       printf ("===============================================================\
 ===============\n");
-      fflush (stdout);
-
-      /* Get an apr_file_t representing stdout, which is where we'll have
-         the diff program print to. */
-      apr_err = apr_file_open_stdout (&outhandle, pool);
-      if (apr_err)
-        return svn_error_create 
-          (apr_err, 0, NULL, pool,
-           "print_diff_tree: can't open handle to stdout");
-
-      label = apr_psprintf (pool, "%s\t(original)", path->data);
-      SVN_ERR (svn_path_get_absolute (&abs_path, orig_path, pool));
-      SVN_ERR (svn_io_run_diff (SVNLOOK_TMPDIR, NULL, 0, label,
-                                abs_path->data, path->data, 
-                                &exitcode, outhandle, NULL, pool));
 
-      /* TODO: Handle exit code == 2 (i.e. diff error) here. */
+      if (orig_binary || new_binary)
+        printf ("(Binary files differ)\n");
+      else
+        {
+          SVN_ERR (get_file_contents (&orig_contents, orig_root, path,
+                                      subpool));
+          SVN_ERR (get_file_contents (&new_contents, new_root, path,
+                                      subpool));
+          SVN_ERR (svn_diff_unified
+                   (svn_stream_from_stdio (stdout, subpool),
+                    orig_contents, new_contents,
+                    apr_psprintf (subpool, "%s\t(original)", path->data),
+                    apr_psprintf (subpool, "%s\t(modified)", path->data),
+                    3, subpool));
+        }
 
       printf ("\n");
       fflush (stdout);
+      svn_pool_destroy (subpool);
     }
   
-  /* Now, delete any temporary files. */
-  if (orig_path)
-    apr_file_remove (orig_path->data, pool);
-  if (new_path)
-    apr_file_remove (new_path->data, pool);
-
   /* Return here if the node has no children. */
   tmp_node = tmp_node->child;
   if (! tmp_node)
@@ -824,7 +740,6 @@ do_diff (svnlook_ctxt_t *c, apr_pool_t *pool)
       SVN_ERR (svn_fs_revision_root (&base_root, c->fs, base_rev_id, pool));
       SVN_ERR (print_diff_tree 
                (root, base_root, tree, svn_stringbuf_create ("", pool), pool));
-      apr_dir_remove_recursively (SVNLOOK_TMPDIR, pool);
     }
   return SVN_NO_ERROR;
 }
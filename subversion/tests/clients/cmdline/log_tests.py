@@ -400,6 +400,38 @@ def versioned_log_message(sbox):
   return 0
 
 
+#----------------------------------------------------------------------
+def limited_log(sbox):
+  "'svn log --limit N' shows only the first N messages"
+
+  if guarantee_repos_and_wc(sbox):
+    return 1
+
+  was_cwd = os.getcwd()
+  os.chdir(sbox.wc_dir)
+
+  output, errput = svntest.main.run_svn (None, 'log', '--limit', '3')
+
+  if errput:
+    os.chdir (was_cwd)
+    return 1
+
+  log_chain = parse_log_output (output)
+  if (len (log_chain) != 3
+      or check_log_chain (log_chain, max_revision, max_revision - 2)):
+    os.chdir (was_cwd)
+    return 1
+
+  # A limit of zero is refused.
+  output, errput = svntest.main.run_svn (1, 'log', '--limit', '0')
+
+  os.chdir (was_cwd)
+  if not errput:
+    return 1
+
+  return 0
+
+
 ########################################################################
 # Run the tests
 
@@ -408,6 +440,7 @@ def versioned_log_message(sbox):
 test_list = [ None,
               plain_log,
               versioned_log_message,
+              limited_log,
              ]
 
 if __name__ == '__main__':
@@ -0,0 +1,410 @@
+/*
+ * binary-editor-test.c:  test the binary editor drive encoding
+ *
+ * ====================================================================
+ * Copyright (c) 2000-2002 CollabNet.  All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.  The terms
+ * are also available at http://subversion.tigris.org/license-1.html.
+ * If newer versions of this license are posted there, you may use a
+ * newer version instead, at your option.
+ *
+ * This software consists of voluntary contributions made by many
+ * individuals.  For exact contribution history, see the revision
+ * history and logs, available at http://subversion.tigris.org/.
+ * ====================================================================
+ */
+
+#include <string.h>
+#include "svn_delta.h"
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_io.h"
+
+
+
+/*** In-memory streams. ***/
+
+/* A stream which appends to a stringbuf. */
+static svn_error_t *
+write_to_stringbuf (void *baton, const char *data, apr_size_t *len)
+{
+  svn_stringbuf_appendbytes (baton, data, *len);
+  return SVN_NO_ERROR;
+}
+
+
+static svn_stream_t *
+stringbuf_write_stream (svn_stringbuf_t *str, apr_pool_t *pool)
+{
+  svn_stream_t *stream = svn_stream_create (str, pool);
+
+  svn_stream_set_write (stream, write_to_stringbuf);
+  return stream;
+}
+
+
+/* A stream which reads from a string, a few bytes at a time, so that
+   the parser has to cope with records split across reads. */
+struct string_reader
+{
+  const svn_stringbuf_t *str;
+  apr_size_t pos;
+  apr_size_t chunk;
+};
+
+
+static svn_error_t *
+read_from_string (void *baton, char *buffer, apr_size_t *len)
+{
+  struct string_reader *sr = baton;
+  apr_size_t remaining = sr->str->len - sr->pos;
+
+  if (*len > sr->chunk)
+    *len = sr->chunk;
+  if (*len > remaining)
+    *len = remaining;
+  memcpy (buffer, sr->str->data + sr->pos, *len);
+  sr->pos += *len;
+  return SVN_NO_ERROR;
+}
+
+
+static svn_stream_t *
+string_read_stream (const svn_stringbuf_t *str,
+                    apr_size_t chunk,
+                    apr_pool_t *pool)
+{
+  struct string_reader *sr = apr_palloc (pool, sizeof (*sr));
+  svn_stream_t *stream = svn_stream_create (sr, pool);
+
+  sr->str = str;
+  sr->pos = 0;
+  sr->chunk = chunk;
+  svn_stream_set_read (stream, read_from_string);
+  return stream;
+}
+
+
+
+/*** A sample editor drive. ***/
+
+/* Send CONTENTS as the text of the file FILE_BATON. */
+static svn_error_t *
+send_text (const svn_delta_editor_t *editor,
+           void *file_baton,
+           const svn_string_t *contents,
+           apr_pool_t *pool)
+{
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+
+  SVN_ERR (editor->apply_textdelta (file_baton, &handler, &handler_baton));
+  return svn_txdelta_send_string (contents, handler, handler_baton, pool);
+}
+
+
+/* Drive EDITOR with a small edit covering every editor call: adds
+   with and without history, opens, deletes, property sets and
+   deletions, and a text delta sent after its file's parent directory
+   has been closed.  The file texts include binary data, so there is
+   something for the XML encoding to inflate. */
+static svn_error_t *
+drive_editor (const svn_delta_editor_t *editor,
+              void *edit_baton,
+              apr_pool_t *pool)
+{
+  void *root_baton, *dir_baton, *file_baton, *lambda_baton;
+  svn_stringbuf_t *binary = svn_stringbuf_create ("", pool);
+  int i;
+
+  for (i = 0; i < 20000; i++)
+    {
+      char c = (char) ((i * 7919) ^ (i >> 5));
+      svn_stringbuf_appendbytes (binary, &c, 1);
+    }
+
+  SVN_ERR (editor->set_target_revision (edit_baton, 3));
+  SVN_ERR (editor->open_root (edit_baton, 2, pool, &root_baton));
+  SVN_ERR (editor->delete_entry ("iota", 2, root_baton, pool));
+
+  SVN_ERR (editor->add_directory ("A", root_baton, NULL,
+                                  SVN_INVALID_REVNUM, pool, &dir_baton));
+  SVN_ERR (editor->change_dir_prop (dir_baton, "color",
+                                    svn_string_create ("blue & <green>",
+                                                       pool),
+                                    pool));
+  SVN_ERR (editor->add_file ("A/mu", dir_baton, NULL, SVN_INVALID_REVNUM,
+                             pool, &file_baton));
+  SVN_ERR (send_text (editor, file_baton,
+                      svn_string_create ("This is the file 'mu'.\n", pool),
+                      pool));
+  SVN_ERR (editor->close_file (file_baton));
+  SVN_ERR (editor->add_file ("A/image.bin", dir_baton, "/trunk/iota", 1,
+                             pool, &file_baton));
+  SVN_ERR (editor->change_file_prop (file_baton, "svn:mime-type",
+                                     svn_string_create
+                                     ("application/octet-stream", pool),
+                                     pool));
+  SVN_ERR (send_text (editor, file_baton,
+                      svn_string_ncreate (binary->data, binary->len, pool),
+                      pool));
+  SVN_ERR (editor->close_file (file_baton));
+  SVN_ERR (editor->close_directory (dir_baton));
+
+  SVN_ERR (editor->open_directory ("B", root_baton, 2, pool, &dir_baton));
+  SVN_ERR (editor->open_file ("B/lambda", dir_baton, 2, pool,
+                              &lambda_baton));
+  SVN_ERR (editor->change_file_prop (lambda_baton, "obsolete", NULL, pool));
+  SVN_ERR (editor->change_dir_prop (dir_baton, "old", NULL, pool));
+  SVN_ERR (editor->close_directory (dir_baton));
+  SVN_ERR (editor->close_directory (root_baton));
+
+  /* A "postfix" text delta, after everything else is closed. */
+  SVN_ERR (send_text (editor, lambda_baton,
+                      svn_string_create ("This is the file 'lambda'.\n",
+                                         pool),
+                      pool));
+  SVN_ERR (editor->close_file (lambda_baton));
+
+  return editor->close_edit (edit_baton);
+}
+
+
+/* Run the sample drive into a binary editor and return the encoding
+   in *BINARY. */
+static svn_error_t *
+encode_sample_drive (svn_stringbuf_t **binary, apr_pool_t *pool)
+{
+  const svn_delta_editor_t *editor;
+  void *edit_baton;
+
+  *binary = svn_stringbuf_create ("", pool);
+  SVN_ERR (svn_delta_get_binary_editor (stringbuf_write_stream (*binary,
+                                                                pool),
+                                        &editor, &edit_baton, pool));
+  return drive_editor (editor, edit_baton, pool);
+}
+
+
+static svn_error_t *
+compare_strings (const svn_stringbuf_t *expected,
+                 const svn_stringbuf_t *actual,
+                 const char *what,
+                 apr_pool_t *pool)
+{
+  if (! svn_stringbuf_compare (expected, actual))
+    return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                              "%s differs (%lu bytes expected, %lu found)",
+                              what, (unsigned long) expected->len,
+                              (unsigned long) actual->len);
+  return SVN_NO_ERROR;
+}
+
+
+
+/*** Tests. ***/
+
+static svn_error_t *
+xml_round_trip (const char **msg,
+                svn_boolean_t msg_only,
+                apr_pool_t *pool)
+{
+  svn_stringbuf_t *binary, *xml_direct, *xml_replayed;
+  const svn_delta_editor_t *editor;
+  void *edit_baton;
+
+  *msg = "binary drive replays to the same XML";
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+  /* Drive the XML editor directly. */
+  xml_direct = svn_stringbuf_create ("", pool);
+  SVN_ERR (svn_delta_get_xml_editor (stringbuf_write_stream (xml_direct,
+                                                             pool),
+                                     &editor, &edit_baton, pool));
+  SVN_ERR (drive_editor (editor, edit_baton, pool));
+
+  /* Encode the same drive, then replay it into the XML editor. */
+  SVN_ERR (encode_sample_drive (&binary, pool));
+  xml_replayed = svn_stringbuf_create ("", pool);
+  SVN_ERR (svn_delta_get_xml_editor (stringbuf_write_stream (xml_replayed,
+                                                             pool),
+                                     &editor, &edit_baton, pool));
+  SVN_ERR (svn_delta_binary_parse (string_read_stream (binary, 7, pool),
+                                   editor, edit_baton, pool));
+
+  SVN_ERR (compare_strings (xml_direct, xml_replayed, "replayed XML", pool));
+
+  if (binary->len >= xml_direct->len)
+    return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                              "binary drive (%lu bytes) is not smaller "
+                              "than XML (%lu bytes)",
+                              (unsigned long) binary->len,
+                              (unsigned long) xml_direct->len);
+
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+xml_parser_round_trip (const char **msg,
+                       svn_boolean_t msg_only,
+                       apr_pool_t *pool)
+{
+  svn_stringbuf_t *xml, *binary, *xml_direct, *xml_replayed;
+  const svn_delta_editor_t *editor;
+  const svn_delta_edit_fns_t *wrapped_editor;
+  void *edit_baton, *wrapped_baton;
+
+  *msg = "XML parser drive survives a binary round trip";
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+  /* Produce an XML tree delta to parse. */
+  xml = svn_stringbuf_create ("", pool);
+  SVN_ERR (svn_delta_get_xml_editor (stringbuf_write_stream (xml, pool),
+                                     &editor, &edit_baton, pool));
+  SVN_ERR (drive_editor (editor, edit_baton, pool));
+
+  /* Parse it straight back into the XML editor... */
+  xml_direct = svn_stringbuf_create ("", pool);
+  SVN_ERR (svn_delta_get_xml_editor (stringbuf_write_stream (xml_direct,
+                                                             pool),
+                                     &editor, &edit_baton, pool));
+  svn_delta_compat_wrap (&wrapped_editor, &wrapped_baton,
+                         editor, edit_baton, pool);
+  SVN_ERR (svn_delta_xml_auto_parse (string_read_stream (xml, 4096, pool),
+                                     wrapped_editor, wrapped_baton,
+                                     "", SVN_INVALID_REVNUM, pool));
+
+  /* ...and through the binary encoding on the way. */
+  binary = svn_stringbuf_create ("", pool);
+  SVN_ERR (svn_delta_get_binary_editor (stringbuf_write_stream (binary,
+                                                                pool),
+                                        &editor, &edit_baton, pool));
+  svn_delta_compat_wrap (&wrapped_editor, &wrapped_baton,
+                         editor, edit_baton, pool);
+  SVN_ERR (svn_delta_xml_auto_parse (string_read_stream (xml, 4096, pool),
+                                     wrapped_editor, wrapped_baton,
+                                     "", SVN_INVALID_REVNUM, pool));
+
+  xml_replayed = svn_stringbuf_create ("", pool);
+  SVN_ERR (svn_delta_get_xml_editor (stringbuf_write_stream (xml_replayed,
+                                                             pool),
+                                     &editor, &edit_baton, pool));
+  SVN_ERR (svn_delta_binary_parse (string_read_stream (binary, 4096, pool),
+                                   editor, edit_baton, pool));
+
+  return compare_strings (xml_direct, xml_replayed, "replayed XML", pool);
+}
+
+
+static svn_error_t *
+binary_round_trip (const char **msg,
+                   svn_boolean_t msg_only,
+                   apr_pool_t *pool)
+{
+  svn_stringbuf_t *binary, *reencoded;
+  const svn_delta_editor_t *editor;
+  void *edit_baton;
+
+  *msg = "binary drive re-encodes identically";
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+  SVN_ERR (encode_sample_drive (&binary, pool));
+
+  reencoded = svn_stringbuf_create ("", pool);
+  SVN_ERR (svn_delta_get_binary_editor (stringbuf_write_stream (reencoded,
+                                                                pool),
+                                        &editor, &edit_baton, pool));
+  SVN_ERR (svn_delta_binary_parse (string_read_stream (binary, 1, pool),
+                                   editor, edit_baton, pool));
+
+  return compare_strings (binary, reencoded, "re-encoded drive", pool);
+}
+
+
+static svn_error_t *
+truncated_drive (const char **msg,
+                 svn_boolean_t msg_only,
+                 apr_pool_t *pool)
+{
+  svn_stringbuf_t *binary, *truncated;
+  apr_pool_t *subpool;
+  apr_size_t len;
+
+  *msg = "truncated or corrupt binary drives are rejected";
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+  SVN_ERR (encode_sample_drive (&binary, pool));
+
+  /* Every proper prefix of the drive must be reported as such, never
+     mistaken for a complete drive. */
+  subpool = svn_pool_create (pool);
+  for (len = 0; len < binary->len; len++)
+    {
+      svn_error_t *err;
+
+      truncated = svn_stringbuf_ncreate (binary->data, len, subpool);
+      err = svn_delta_binary_parse (string_read_stream (truncated, 4096,
+                                                        subpool),
+                                    svn_delta_default_editor (subpool),
+                                    NULL, subpool);
+      if (err == SVN_NO_ERROR)
+        return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                                  "drive truncated to %lu bytes was "
+                                  "accepted", (unsigned long) len);
+      if (err->apr_err != SVN_ERR_EDITOR_DRIVE_UNEXPECTED_END)
+        return svn_error_createf (SVN_ERR_TEST_FAILED, 0, err, pool,
+                                  "wrong error for drive truncated to "
+                                  "%lu bytes", (unsigned long) len);
+      svn_error_clear_all (err);
+      svn_pool_clear (subpool);
+    }
+
+  /* A bad header. */
+  truncated = svn_stringbuf_dup (binary, subpool);
+  truncated->data[0] = 'X';
+  {
+    svn_error_t *err
+      = svn_delta_binary_parse (string_read_stream (truncated, 4096,
+                                                    subpool),
+                                svn_delta_default_editor (subpool),
+                                NULL, subpool);
+    if (err == SVN_NO_ERROR
+        || err->apr_err != SVN_ERR_EDITOR_DRIVE_INVALID_HEADER)
+      return svn_error_create (SVN_ERR_TEST_FAILED, 0, err, pool,
+                               "bad header was not detected");
+    svn_error_clear_all (err);
+  }
+
+  svn_pool_destroy (subpool);
+  return SVN_NO_ERROR;
+}
+
+
+
+/* The test table.  */
+
+svn_error_t * (*test_funcs[]) (const char **msg,
+                               svn_boolean_t msg_only,
+                               apr_pool_t *pool) = {
+  0,
+  xml_round_trip,
+  xml_parser_round_trip,
+  binary_round_trip,
+  truncated_drive,
+  0
+};
+
+
+
+/*
+ * local variables:
+ * eval: (load-file "../../../tools/dev/svn-dev.el")
+ * end:
+ */
@@ -0,0 +1,923 @@
+/*
+ * delta-bench.c:  measure the speed of the text delta machinery
+ *
+ * ====================================================================
+ * Copyright (c) 2000-2002 CollabNet.  All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.  The terms
+ * are also available at http://subversion.tigris.org/license-1.html.
+ * If newer versions of this license are posted there, you may use a
+ * newer version instead, at your option.
+ *
+ * This software consists of voluntary contributions made by many
+ * individuals.  For exact contribution history, see the revision
+ * history and logs, available at http://subversion.tigris.org/.
+ * ====================================================================
+ */
+
+/* delta-bench runs each stage of the text delta pipeline -- delta
+   generation, svndiff encoding and decoding, delta application and
+   window composition -- over a corpus of file versions, and reports
+   throughput, compression ratio and memory use for every stage.
+
+   Without file arguments the corpus is generated, deterministically,
+   in four flavours that stress the delta code differently: source
+   code and prose edited here and there, binary data with patches and
+   insertions, and an append-only log.  Each item has three versions;
+   deltas are taken from the first to the second, and composition
+   combines that with the delta from the second to the third.
+
+   File arguments replace the generated corpus.  They are taken in
+   pairs of SOURCE and TARGET; composition then combines the delta
+   from SOURCE to TARGET with the one back again.
+
+   With -m the results are printed as tab-separated lines, one per
+   item and stage, for tracking regressions across changes.  */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <apr_general.h>
+#include <apr_getopt.h>
+#include <apr_pools.h>
+#include <apr_tables.h>
+#include <apr_time.h>
+
+#include "svn_delta.h"
+#include "svn_error.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_string.h"
+
+/* Default size of each generated corpus item, in kilobytes. */
+#define DEFAULT_SIZE 4096
+
+/* Default number of times each stage is run; the best time counts. */
+#define DEFAULT_REPEAT 3
+
+
+
+/*** The corpus. ***/
+
+/* Three versions of one corpus item. */
+typedef struct corpus_item_t
+{
+  const char *name;
+  svn_stringbuf_t *v1;
+  svn_stringbuf_t *v2;
+  svn_stringbuf_t *v3;
+} corpus_item_t;
+
+
+static unsigned long
+myrand (unsigned long *seed)
+{
+  *seed = (*seed * 1103515245 + 12345) & 0xffffffff;
+  return *seed;
+}
+
+
+/* Append a random line of source code to STR. */
+static void
+append_code_line (svn_stringbuf_t *str, unsigned long *seed)
+{
+  static const char * const words[] = {
+    "if", "(", ")", "{", "}", "return", "err", "=", "svn_error_t",
+    "*", "pool", "apr_pool_t", "len", "++", ";", "baton", "NULL",
+    "while", "for", "i", "<", "->", "data", "SVN_ERR", ",", "0",
+    "struct", "static", "void", "char", "const", "window"
+  };
+  int indent = (myrand (seed) >> 8) % 5;
+  int n = 2 + (myrand (seed) >> 8) % 10;
+
+  while (indent-- > 0)
+    svn_stringbuf_appendcstr (str, "  ");
+  while (n-- > 0)
+    {
+      svn_stringbuf_appendcstr
+        (str, words[(myrand (seed) >> 8) % (sizeof (words)
+                                            / sizeof (words[0]))]);
+      svn_stringbuf_appendcstr (str, " ");
+    }
+  svn_stringbuf_appendcstr (str, "\n");
+}
+
+
+/* Append a random line of prose to STR. */
+static void
+append_text_line (svn_stringbuf_t *str, unsigned long *seed)
+{
+  int n = 5 + (myrand (seed) >> 8) % 10;
+
+  while (n-- > 0)
+    {
+      int wordlen = 1 + (myrand (seed) >> 8) % 9;
+
+      while (wordlen-- > 0)
+        {
+          char c = 'a' + (myrand (seed) >> 8) % 26;
+          svn_stringbuf_appendbytes (str, &c, 1);
+        }
+      svn_stringbuf_appendcstr (str, n ? " " : ".\n");
+    }
+}
+
+
+/* Append a log line numbered SEQ to STR. */
+static void
+append_log_line (svn_stringbuf_t *str, int seq, unsigned long *seed)
+{
+  static const char * const events[] = {
+    "GET /repos/trunk/README 200",
+    "PROPFIND /repos/!svn/vcc/default 207",
+    "REPORT /repos/!svn/vcc/default 200",
+    "MKACTIVITY /repos/!svn/act/ 201",
+    "CHECKOUT /repos/!svn/ver/42/trunk 201"
+  };
+  char buf[128];
+
+  sprintf (buf, "2002-05-%02d %02d:%02d:%02d [%d] ",
+           1 + seq / 86400 % 28, seq / 3600 % 24, seq / 60 % 60, seq % 60,
+           (int) ((myrand (seed) >> 8) % 30000));
+  svn_stringbuf_appendcstr (str, buf);
+  svn_stringbuf_appendcstr
+    (str, events[(myrand (seed) >> 8) % (sizeof (events)
+                                         / sizeof (events[0]))]);
+  svn_stringbuf_appendcstr (str, "\n");
+}
+
+
+typedef void (*line_func_t) (svn_stringbuf_t *str, unsigned long *seed);
+
+/* Return SIZE bytes (or a line more) of lines made by APPEND_LINE. */
+static svn_stringbuf_t *
+generate_lines (line_func_t append_line, apr_size_t size,
+                unsigned long *seed, apr_pool_t *pool)
+{
+  svn_stringbuf_t *str = svn_stringbuf_create ("", pool);
+
+  while (str->len < size)
+    append_line (str, seed);
+  return str;
+}
+
+
+/* Return a copy of ORIG in which about one line in fifty has been
+   replaced, deleted, or had a new line from APPEND_LINE put before
+   it. */
+static svn_stringbuf_t *
+edit_lines (const svn_stringbuf_t *orig, line_func_t append_line,
+            unsigned long *seed, apr_pool_t *pool)
+{
+  svn_stringbuf_t *str = svn_stringbuf_create ("", pool);
+  const char *p = orig->data, *end = orig->data + orig->len;
+
+  while (p < end)
+    {
+      const char *eol = memchr (p, '\n', end - p);
+      apr_size_t linelen = eol ? (eol - p + 1) : (end - p);
+
+      switch ((myrand (seed) >> 8) % 200)
+        {
+        case 0: case 1:         /* replace */
+          append_line (str, seed);
+          break;
+        case 2:                 /* delete */
+          break;
+        case 3:                 /* insert */
+          append_line (str, seed);
+          /* fall through */
+        default:
+          svn_stringbuf_appendbytes (str, p, linelen);
+        }
+      p += linelen;
+    }
+  return str;
+}
+
+
+/* Return SIZE bytes of binary data: random records with some
+   repetition, as in an object file or an image. */
+static svn_stringbuf_t *
+generate_binary (apr_size_t size, unsigned long *seed, apr_pool_t *pool)
+{
+  svn_stringbuf_t *str = svn_stringbuf_create ("", pool);
+
+  while (str->len < size)
+    {
+      char record[64];
+      apr_size_t i, len = 8 + (myrand (seed) >> 8) % (sizeof (record) - 8);
+
+      if (str->len > 1024 && (myrand (seed) >> 8) % 4 == 0)
+        {
+          /* Repeat a record from earlier on. */
+          apr_size_t from = (myrand (seed) >> 4) % (str->len - len);
+          svn_stringbuf_appendbytes (str, str->data + from, len);
+          continue;
+        }
+      for (i = 0; i < len; i++)
+        record[i] = (char) (myrand (seed) >> 16);
+      svn_stringbuf_appendbytes (str, record, len);
+    }
+  return str;
+}
+
+
+/* Return a copy of ORIG with a few bytes patched, inserted or
+   removed about every 64 kilobytes. */
+static svn_stringbuf_t *
+edit_binary (const svn_stringbuf_t *orig, unsigned long *seed,
+             apr_pool_t *pool)
+{
+  svn_stringbuf_t *str = svn_stringbuf_create ("", pool);
+  apr_size_t pos = 0;
+
+  while (pos < orig->len)
+    {
+      apr_size_t run = (myrand (seed) >> 4) % (128 * 1024);
+      char patch[64];
+      apr_size_t i, patchlen = 1 + (myrand (seed) >> 8) % sizeof (patch);
+
+      if (run > orig->len - pos)
+        run = orig->len - pos;
+      svn_stringbuf_appendbytes (str, orig->data + pos, run);
+      pos += run;
+
+      for (i = 0; i < patchlen; i++)
+        patch[i] = (char) (myrand (seed) >> 16);
+      svn_stringbuf_appendbytes (str, patch, patchlen);
+
+      switch ((myrand (seed) >> 8) % 3)
+        {
+        case 0:                 /* overwrite */
+          pos += patchlen;
+          break;
+        case 1:                 /* insert */
+          break;
+        case 2:                 /* replace with something shorter */
+          pos += 2 * patchlen;
+          break;
+        }
+    }
+  return str;
+}
+
+
+/* Return a copy of ORIG with SIZE bytes (or a line more) of log lines
+   appended, numbered from *SEQ on. */
+static svn_stringbuf_t *
+append_log (const svn_stringbuf_t *orig, apr_size_t size, int *seq,
+            unsigned long *seed, apr_pool_t *pool)
+{
+  svn_stringbuf_t *str = svn_stringbuf_dup (orig, pool);
+
+  while (str->len < orig->len + size)
+    append_log_line (str, (*seq)++, seed);
+  return str;
+}
+
+
+/* Add the generated corpus, with items of about SIZE bytes, to
+   CORPUS. */
+static void
+generate_corpus (apr_array_header_t *corpus, apr_size_t size,
+                 apr_pool_t *pool)
+{
+  unsigned long seed = 1;
+  corpus_item_t *item;
+  int seq = 0;
+
+  item = apr_array_push (corpus);
+  item->name = "source";
+  item->v1 = generate_lines (append_code_line, size, &seed, pool);
+  item->v2 = edit_lines (item->v1, append_code_line, &seed, pool);
+  item->v3 = edit_lines (item->v2, append_code_line, &seed, pool);
+
+  item = apr_array_push (corpus);
+  item->name = "text";
+  item->v1 = generate_lines (append_text_line, size, &seed, pool);
+  item->v2 = edit_lines (item->v1, append_text_line, &seed, pool);
+  item->v3 = edit_lines (item->v2, append_text_line, &seed, pool);
+
+  item = apr_array_push (corpus);
+  item->name = "binary";
+  item->v1 = generate_binary (size, &seed, pool);
+  item->v2 = edit_binary (item->v1, &seed, pool);
+  item->v3 = edit_binary (item->v2, &seed, pool);
+
+  item = apr_array_push (corpus);
+  item->name = "log";
+  item->v1 = append_log (svn_stringbuf_create ("", pool), size, &seq,
+                         &seed, pool);
+  item->v2 = append_log (item->v1, size / 8, &seq, &seed, pool);
+  item->v3 = append_log (item->v2, size / 8, &seq, &seed, pool);
+}
+
+
+/* Read the contents of file PATH into *RESULT. */
+static svn_error_t *
+read_file (svn_stringbuf_t **result, const char *path, apr_pool_t *pool)
+{
+  FILE *fp = fopen (path, "rb");
+  char buf[SVN_STREAM_CHUNK_SIZE];
+  size_t len;
+
+  if (fp == NULL)
+    return svn_error_createf (SVN_ERR_BAD_FILENAME, 0, NULL, pool,
+                              "delta-bench: can't open `%s'", path);
+
+  *result = svn_stringbuf_create ("", pool);
+  while ((len = fread (buf, 1, sizeof (buf), fp)) > 0)
+    svn_stringbuf_appendbytes (*result, buf, len);
+  fclose (fp);
+  return SVN_NO_ERROR;
+}
+
+
+
+/*** Streams over strings and window lists. ***/
+
+struct string_baton
+{
+  const svn_stringbuf_t *str;
+  apr_size_t pos;
+};
+
+
+static svn_error_t *
+read_string (void *baton, char *buffer, apr_size_t *len)
+{
+  struct string_baton *sb = baton;
+
+  if (*len > sb->str->len - sb->pos)
+    *len = sb->str->len - sb->pos;
+  memcpy (buffer, sb->str->data + sb->pos, *len);
+  sb->pos += *len;
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+write_string (void *baton, const char *data, apr_size_t *len)
+{
+  svn_stringbuf_appendbytes (baton, data, *len);
+  return SVN_NO_ERROR;
+}
+
+
+/* Return a stream reading from STR. */
+static svn_stream_t *
+string_reader (const svn_stringbuf_t *str, apr_pool_t *pool)
+{
+  struct string_baton *sb = apr_palloc (pool, sizeof (*sb));
+  svn_stream_t *stream;
+
+  sb->str = str;
+  sb->pos = 0;
+  stream = svn_stream_create (sb, pool);
+  svn_stream_set_read (stream, read_string);
+  return stream;
+}
+
+
+/* Return a stream appending to STR. */
+static svn_stream_t *
+string_writer (svn_stringbuf_t *str, apr_pool_t *pool)
+{
+  svn_stream_t *stream = svn_stream_create (str, pool);
+
+  svn_stream_set_write (stream, write_string);
+  return stream;
+}
+
+
+struct list_baton
+{
+  apr_array_header_t *windows;
+  int next;
+};
+
+
+static svn_error_t *
+list_next_window (svn_txdelta_window_t **window,
+                  void *baton,
+                  apr_pool_t *pool)
+{
+  struct list_baton *lb = baton;
+
+  if (lb->next < lb->windows->nelts)
+    *window = ((svn_txdelta_window_t **) lb->windows->elts)[lb->next++];
+  else
+    *window = NULL;
+  return SVN_NO_ERROR;
+}
+
+
+static const unsigned char *
+list_md5_digest (void *baton)
+{
+  return NULL;
+}
+
+
+/* Return a delta stream yielding the windows in WINDOWS. */
+static svn_txdelta_stream_t *
+list_stream (apr_array_header_t *windows, apr_pool_t *pool)
+{
+  struct list_baton *lb = apr_palloc (pool, sizeof (*lb));
+
+  lb->windows = windows;
+  lb->next = 0;
+  return svn_txdelta_stream_create (lb, list_next_window, list_md5_digest,
+                                    pool);
+}
+
+
+/* Window handler that counts windows and otherwise drops them. */
+static svn_error_t *
+count_window (svn_txdelta_window_t *window, void *baton)
+{
+  if (window)
+    ++*(int *) baton;
+  return SVN_NO_ERROR;
+}
+
+
+
+/*** Measurement. ***/
+
+/* The results of running one stage over one corpus item. */
+typedef struct result_t
+{
+  apr_size_t bytes;             /* Bytes of text processed. */
+  apr_size_t out_bytes;         /* Bytes of output, where meaningful. */
+  apr_time_t time;              /* Best time over all runs. */
+  apr_size_t peak_pool;         /* Most pool memory in use at once. */
+} result_t;
+
+
+/* Bytes allocated in POOL and its subpools, or 0 if APR can't tell
+   us.  Only debugging builds of APR keep count.  */
+static apr_size_t
+pool_bytes (apr_pool_t *pool)
+{
+#if APR_POOL_DEBUG
+  return apr_pool_num_bytes (pool, 1);
+#else
+  return 0;
+#endif
+}
+
+
+static void
+note_pool (result_t *result, apr_pool_t *pool)
+{
+  apr_size_t bytes = pool_bytes (pool);
+
+  if (bytes > result->peak_pool)
+    result->peak_pool = bytes;
+}
+
+
+/* Compute the delta from SOURCE to TARGET, using NUM_THREADS threads
+   if that is more than one, and put copies of its windows, allocated
+   in POOL, into *WINDOWS. */
+static svn_error_t *
+run_delta (apr_array_header_t **windows,
+           const svn_stringbuf_t *source,
+           const svn_stringbuf_t *target,
+           int num_threads,
+           result_t *result,
+           apr_pool_t *pool)
+{
+  apr_pool_t *wpool = svn_pool_create (pool);
+  svn_txdelta_stream_t *stream;
+  svn_txdelta_window_t *window;
+
+  *windows = apr_array_make (pool, 16, sizeof (window));
+  if (num_threads > 1)
+    svn_txdelta_parallel (&stream, string_reader (source, pool),
+                          string_reader (target, pool), num_threads, pool);
+  else
+    svn_txdelta (&stream, string_reader (source, pool),
+                 string_reader (target, pool), pool);
+
+  do
+    {
+      SVN_ERR (svn_txdelta_next_window (&window, stream, wpool));
+      if (window)
+        *(svn_txdelta_window_t **) apr_array_push (*windows)
+          = svn_txdelta_window_dup (window, pool);
+      note_pool (result, pool);
+      svn_pool_clear (wpool);
+    }
+  while (window);
+
+  svn_pool_destroy (wpool);
+  return SVN_NO_ERROR;
+}
+
+
+/* Encode WINDOWS as svndiff into *SVNDIFF. */
+static svn_error_t *
+run_encode (svn_stringbuf_t **svndiff,
+            apr_array_header_t *windows,
+            result_t *result,
+            apr_pool_t *pool)
+{
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  int i;
+
+  *svndiff = svn_stringbuf_create ("", pool);
+  svn_txdelta_to_svndiff (string_writer (*svndiff, pool), pool,
+                          &handler, &handler_baton);
+  for (i = 0; i < windows->nelts; i++)
+    {
+      SVN_ERR (handler (((svn_txdelta_window_t **) windows->elts)[i],
+                        handler_baton));
+      note_pool (result, pool);
+    }
+  return handler (NULL, handler_baton);
+}
+
+
+/* Parse the svndiff data SVNDIFF. */
+static svn_error_t *
+run_decode (const svn_stringbuf_t *svndiff,
+            result_t *result,
+            apr_pool_t *pool)
+{
+  int count = 0;
+  svn_stream_t *stream = svn_txdelta_parse_svndiff (count_window, &count,
+                                                    TRUE, pool);
+  apr_size_t pos = 0;
+
+  /* Feed it the way a network layer would, a chunk at a time.  The
+     parser may change the length it is handed, so don't rely on it
+     afterwards. */
+  while (pos < svndiff->len)
+    {
+      apr_size_t chunk = svndiff->len - pos;
+      apr_size_t len;
+
+      if (chunk > SVN_STREAM_CHUNK_SIZE)
+        chunk = SVN_STREAM_CHUNK_SIZE;
+      len = chunk;
+      SVN_ERR (svn_stream_write (stream, svndiff->data + pos, &len));
+      pos += chunk;
+      note_pool (result, pool);
+    }
+  return svn_stream_close (stream);
+}
+
+
+/* Apply WINDOWS to SOURCE, putting the result in *TARGET. */
+static svn_error_t *
+run_apply (svn_stringbuf_t **target,
+           const svn_stringbuf_t *source,
+           apr_array_header_t *windows,
+           result_t *result,
+           apr_pool_t *pool)
+{
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  int i;
+
+  *target = svn_stringbuf_create ("", pool);
+  svn_txdelta_apply (string_reader (source, pool),
+                     string_writer (*target, pool), pool,
+                     &handler, &handler_baton);
+  for (i = 0; i < windows->nelts; i++)
+    {
+      SVN_ERR (handler (((svn_txdelta_window_t **) windows->elts)[i],
+                        handler_baton));
+      note_pool (result, pool);
+    }
+  return handler (NULL, handler_baton);
+}
+
+
+/* Compose WINDOWS_A with WINDOWS_B, putting the result in
+   *WINDOWS. */
+static svn_error_t *
+run_combine (apr_array_header_t **windows,
+             apr_array_header_t *windows_A,
+             apr_array_header_t *windows_B,
+             result_t *result,
+             apr_pool_t *pool)
+{
+  apr_pool_t *wpool = svn_pool_create (pool);
+  svn_txdelta_stream_t *stream;
+  svn_txdelta_window_t *window;
+
+  *windows = apr_array_make (pool, 16, sizeof (window));
+  svn_txdelta_compose (&stream, list_stream (windows_A, pool),
+                       list_stream (windows_B, pool), pool);
+  do
+    {
+      SVN_ERR (svn_txdelta_next_window (&window, stream, wpool));
+      if (window)
+        *(svn_txdelta_window_t **) apr_array_push (*windows)
+          = svn_txdelta_window_dup (window, pool);
+      note_pool (result, pool);
+      svn_pool_clear (wpool);
+    }
+  while (window);
+
+  svn_pool_destroy (wpool);
+  return SVN_NO_ERROR;
+}
+
+
+/* Return the size of the windows in WINDOWS, encoded as svndiff. */
+static svn_error_t *
+svndiff_size (apr_size_t *size,
+              apr_array_header_t *windows,
+              apr_pool_t *pool)
+{
+  result_t dummy = { 0 };
+  svn_stringbuf_t *svndiff;
+
+  SVN_ERR (run_encode (&svndiff, windows, &dummy, pool));
+  *size = svndiff->len;
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+check_result (const svn_stringbuf_t *expected,
+              const svn_stringbuf_t *actual,
+              const char *what,
+              apr_pool_t *pool)
+{
+  if (! svn_stringbuf_compare (expected, actual))
+    return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                              "delta-bench: %s produced the wrong text",
+                              what);
+  return SVN_NO_ERROR;
+}
+
+
+#define STAGE_DELTA   0
+#define STAGE_ENCODE  1
+#define STAGE_DECODE  2
+#define STAGE_APPLY   3
+#define STAGE_COMBINE 4
+#define NUM_STAGES    5
+
+static const char * const stage_names[NUM_STAGES] = {
+  "delta", "encode", "decode", "apply", "combine"
+};
+
+
+/* Run every stage over ITEM REPEAT times, and fill in RESULTS. */
+static svn_error_t *
+bench_item (result_t results[NUM_STAGES],
+            const corpus_item_t *item,
+            int repeat,
+            int num_threads,
+            apr_pool_t *pool)
+{
+  int run;
+
+  memset (results, 0, NUM_STAGES * sizeof (*results));
+
+  for (run = 0; run < repeat; run++)
+    {
+      apr_pool_t *subpool = svn_pool_create (pool);
+      apr_pool_t *stage_pool;
+      apr_array_header_t *windows_12, *windows_23, *windows_13;
+      svn_stringbuf_t *svndiff, *text;
+      apr_time_t times[NUM_STAGES], start;
+      result_t untimed = { 0 };
+      int i;
+
+      /* Each stage gets a fresh pool, so that its peak is its own.
+         The delta from v2 to v3, needed for composition, and the
+         check of the composed delta are not measured.  */
+      stage_pool = svn_pool_create (subpool);
+      start = apr_time_now ();
+      SVN_ERR (run_delta (&windows_12, item->v1, item->v2, num_threads,
+                          &results[STAGE_DELTA], stage_pool));
+      times[STAGE_DELTA] = apr_time_now () - start;
+
+      stage_pool = svn_pool_create (subpool);
+      start = apr_time_now ();
+      SVN_ERR (run_encode (&svndiff, windows_12,
+                           &results[STAGE_ENCODE], stage_pool));
+      times[STAGE_ENCODE] = apr_time_now () - start;
+      results[STAGE_ENCODE].out_bytes = svndiff->len;
+
+      stage_pool = svn_pool_create (subpool);
+      start = apr_time_now ();
+      SVN_ERR (run_decode (svndiff, &results[STAGE_DECODE], stage_pool));
+      times[STAGE_DECODE] = apr_time_now () - start;
+      svn_pool_destroy (stage_pool);
+
+      stage_pool = svn_pool_create (subpool);
+      start = apr_time_now ();
+      SVN_ERR (run_apply (&text, item->v1, windows_12,
+                          &results[STAGE_APPLY], stage_pool));
+      times[STAGE_APPLY] = apr_time_now () - start;
+      SVN_ERR (check_result (item->v2, text, "apply", pool));
+      svn_pool_destroy (stage_pool);
+
+      SVN_ERR (run_delta (&windows_23, item->v2, item->v3, 1,
+                          &untimed, subpool));
+      stage_pool = svn_pool_create (subpool);
+      start = apr_time_now ();
+      SVN_ERR (run_combine (&windows_13, windows_12, windows_23,
+                            &results[STAGE_COMBINE], stage_pool));
+      times[STAGE_COMBINE] = apr_time_now () - start;
+      SVN_ERR (run_apply (&text, item->v1, windows_13, &untimed, subpool));
+      SVN_ERR (check_result (item->v3, text, "combine", pool));
+      SVN_ERR (svndiff_size (&results[STAGE_COMBINE].out_bytes,
+                             windows_13, subpool));
+
+      results[STAGE_DELTA].out_bytes = results[STAGE_ENCODE].out_bytes;
+      results[STAGE_DECODE].out_bytes = results[STAGE_ENCODE].out_bytes;
+      results[STAGE_APPLY].out_bytes = item->v2->len;
+      for (i = 0; i < NUM_STAGES; i++)
+        {
+          results[i].bytes = (i == STAGE_COMBINE)
+            ? item->v3->len : item->v2->len;
+          if (run == 0 || times[i] < results[i].time)
+            results[i].time = times[i];
+        }
+
+      svn_pool_destroy (subpool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+static double
+megabytes_per_second (const result_t *result)
+{
+  if (result->time <= 0)
+    return 0.0;
+  return ((double) result->bytes / (1024 * 1024))
+    / ((double) result->time / APR_USEC_PER_SEC);
+}
+
+
+static double
+ratio (const result_t *result)
+{
+  if (result->bytes == 0)
+    return 0.0;
+  return (double) result->out_bytes / result->bytes;
+}
+
+
+static void
+print_results (const corpus_item_t *item,
+               const result_t results[NUM_STAGES],
+               svn_boolean_t machine)
+{
+  int i;
+
+  for (i = 0; i < NUM_STAGES; i++)
+    {
+      const result_t *r = &results[i];
+
+      if (machine)
+        printf ("%s\t%s\t%lu\t%lu\t%.6f\t%.2f\t%.4f\t%lu\n",
+                item->name, stage_names[i],
+                (unsigned long) r->bytes, (unsigned long) r->out_bytes,
+                (double) r->time / APR_USEC_PER_SEC,
+                megabytes_per_second (r), ratio (r),
+                (unsigned long) r->peak_pool);
+      else
+        {
+          printf ("%-12s %-8s %9.1f MB/s  ratio %6.4f",
+                  i == 0 ? item->name : "", stage_names[i],
+                  megabytes_per_second (r), ratio (r));
+          if (r->peak_pool)
+            printf ("  pool %7lu KB", (unsigned long) r->peak_pool / 1024);
+          printf ("\n");
+        }
+    }
+}
+
+
+
+static void
+usage (void)
+{
+  fprintf (stderr,
+           "Usage: delta-bench [-m] [-s SIZE] [-r REPEAT] [-j THREADS]"
+           " [SOURCE TARGET]...\n"
+           "\n"
+           "  -m          print tab-separated results for tools:\n"
+           "              corpus, stage, bytes in, bytes out, seconds,\n"
+           "              MB/s, ratio, peak pool bytes\n"
+           "  -s SIZE     size of each generated item in KB (default %d)\n"
+           "  -r REPEAT   runs per stage; the best counts (default %d)\n"
+           "  -j THREADS  compute deltas on THREADS threads\n"
+           "\n"
+           "Without files, a corpus of source code, text, binary data\n"
+           "and an append-only log is generated.  Peak pool sizes are\n"
+           "only reported when APR is built with pool debugging.\n",
+           DEFAULT_SIZE, DEFAULT_REPEAT);
+  exit (1);
+}
+
+
+int
+main (int argc, const char * const *argv)
+{
+  apr_pool_t *pool;
+  apr_getopt_t *opt;
+  char optch;
+  const char *opt_arg;
+  apr_status_t status;
+  apr_array_header_t *corpus;
+  svn_boolean_t machine = FALSE;
+  int size = DEFAULT_SIZE, repeat = DEFAULT_REPEAT, num_threads = 1;
+  int i;
+
+  apr_initialize ();
+  pool = svn_pool_create (NULL);
+
+  apr_getopt_init (&opt, pool, argc, argv);
+  while (APR_SUCCESS
+         == (status = apr_getopt (opt, "ms:r:j:", &optch, &opt_arg)))
+    {
+      switch (optch)
+        {
+        case 'm':
+          machine = TRUE;
+          break;
+        case 's':
+          size = atoi (opt_arg);
+          break;
+        case 'r':
+          repeat = atoi (opt_arg);
+          break;
+        case 'j':
+          num_threads = atoi (opt_arg);
+          break;
+        }
+    }
+  if (status != APR_EOF || size <= 0 || repeat <= 0
+      || (argc - opt->ind) % 2 != 0)
+    usage ();
+
+  corpus = apr_array_make (pool, 4, sizeof (corpus_item_t));
+  if (opt->ind == argc)
+    generate_corpus (corpus, size * 1024, pool);
+  else
+    for (i = opt->ind; i < argc; i += 2)
+      {
+        corpus_item_t *item = apr_array_push (corpus);
+        svn_error_t *err;
+
+        item->name = argv[i + 1];
+        err = read_file (&item->v1, argv[i], pool);
+        if (! err)
+          err = read_file (&item->v2, argv[i + 1], pool);
+        if (err)
+          {
+            svn_handle_error (err, stderr, 0);
+            exit (1);
+          }
+        item->v3 = item->v1;
+      }
+
+  if (machine)
+    printf ("corpus\tstage\tbytes\tout_bytes\tseconds\tmb_per_s"
+            "\tratio\tpeak_pool\n");
+
+  for (i = 0; i < corpus->nelts; i++)
+    {
+      const corpus_item_t *item = &((corpus_item_t *) corpus->elts)[i];
+      result_t results[NUM_STAGES];
+      svn_error_t *err = bench_item (results, item, repeat, num_threads,
+                                     pool);
+
+      if (err)
+        {
+          svn_handle_error (err, stderr, 0);
+          exit (1);
+        }
+      print_results (item, results, machine);
+    }
+
+  svn_pool_destroy (pool);
+  apr_terminate ();
+  return 0;
+}
+
+
+
+/*
+ * local variables:
+ * eval: (load-file "../../../tools/dev/svn-dev.el")
+ * end:
+ */
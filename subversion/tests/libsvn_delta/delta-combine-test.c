@@ -15,387 +15,524 @@
  * ====================================================================
  */
 
-#include <ctype.h>
 #include <stdio.h>
 #include <string.h>
-#include <apr_general.h>
-#include <apr_tables.h>
-#include "svn_base64.h"
-#include "svn_quoprint.h"
+#include <assert.h>
+#include "apr_general.h"
+#include "apr_getopt.h"
+#include "apr_tables.h"
+#include "apr_time.h"
 #include "svn_delta.h"
-#include "svn_error.h"
 #include "svn_pools.h"
-#include "svn_string.h"
+#include "svn_error.h"
 
+#define DEFAULT_ITERATIONS 20
+#define DEFAULT_MAXLEN (512 * 1024)
+#define DEFAULT_VERSIONS 4
+#define SEEDS 50
+#define MAXSEQ 100
 
-/* The test here is simple.  Given a string of N files:
+/* The size of the text used by the throughput test. */
+#define BENCH_LEN (4 * 1024 * 1024)
 
-   foreach file (files - 1)
-     generate svndiff which converts file to file + 1;
-     write diff to disk;
-   
-   combine the files - 1 diff data segments into a single diff data
-   file;
 
-   apply the One Diff to the first file, and hope it produces the
-   last.
-*/
+/* Initialize parameters for the tests. */
+extern int test_argc;
+extern const char **test_argv;
 
+static void init_params (unsigned long *seed,
+                         int *maxlen, int *iterations, int *versions,
+                         apr_pool_t *pool)
+{
+  apr_getopt_t *opt;
+  char optch;
+  const char *opt_arg;
+  apr_status_t status;
 
-#define INT_ERR(expr)                              \
-  do {                                             \
-    svn_error_t *svn_err__temp = (expr);           \
-    if (svn_err__temp) {                           \
-      svn_handle_error (svn_err__temp, stderr, 0); \
-      return EXIT_FAILURE;                         \
-    }                                              \
-  } while (0)
-      
+  *seed = (unsigned long) apr_time_now();
+  *maxlen = DEFAULT_MAXLEN;
+  *iterations = DEFAULT_ITERATIONS;
+  *versions = DEFAULT_VERSIONS;
+
+  apr_getopt_init (&opt, pool, test_argc, test_argv);
+  while (APR_SUCCESS
+         == (status = apr_getopt (opt, "s:l:n:v:", &optch, &opt_arg)))
+    {
+      switch (optch)
+        {
+        case 's':
+          *seed = atol (opt_arg);
+          break;
+        case 'l':
+          *maxlen = atoi (opt_arg);
+          break;
+        case 'n':
+          *iterations = atoi (opt_arg);
+          break;
+        case 'v':
+          *versions = atoi (opt_arg);
+          break;
+        }
+    }
 
-/* Print a usage message for program PROG, and return ERRVAL. */
-static int 
-do_usage (const char *prog, 
-          int errval)
+  /* We need at least two deltas to have anything to combine. */
+  if (*versions < 3)
+    *versions = 3;
+}
+
+
+
+static unsigned long
+myrand (unsigned long *seed)
 {
-  printf ("%s - testing svndiff delta combination\n", prog);
-  printf ("usage: %s FILE1 FILE2 FILE3 [ FILE4 [ FILE5 ... ]]\n\n", prog);
-  return errval;
+  *seed = (*seed * 1103515245 + 12345) & 0xffffffff;
+  return *seed;
 }
 
 
-/* Given a list of FILE_NAMES (of which there are NUM_FILES), generate
-   a collection of (NUM_FILES - 1) temporary files containing svndiff
-   data which describes the difference between each successive file in
-   FILE_NAMES.  Allocate an array, TMP_FILES_P, and populate it with
-   the names of the temporary files created in this process.  Use POOL
-   for all allocations.  */
-static svn_error_t *
-generate_file_diffs (apr_array_header_t **tmp_files_p,
-                     int num_files, 
-                     const char **file_names,
-                     apr_pool_t *pool)
-{ 
-  int i;
-  apr_array_header_t *tmp_files;
-  svn_txdelta_stream_t *txdelta_stream;
-  svn_txdelta_window_handler_t svndiff_handler;
-  svn_stream_t *out_stream;
-  void *svndiff_baton;
-
-  /* Allocate an array in which to store our temporary filenames. */
-  tmp_files = apr_array_make (pool, 2, sizeof (svn_stringbuf_t *));
-
-  /* Loop over our arguments, generating diff data between each
-     successive one and storing that diff data in a temporary file. */
-  for (i = 0; i < num_files - 1; i++)
+/* Generate a temporary file containing sort-of random data.  Runs of
+   this function with the same SUBSEED_BASE share a lot of common
+   substrings, so the deltas between them are interesting.  */
+static FILE *
+generate_random_file (int maxlen, unsigned long subseed_base,
+                      unsigned long *seed)
+{
+  int len, seqlen;
+  FILE *fp;
+  unsigned long r;
+
+  fp = tmpfile ();
+  assert (fp != NULL);
+  len = myrand (seed) % maxlen;       /* We might go over this by a bit.  */
+  while (len > 0)
     {
-      FILE *source_file;
-      FILE *target_file;
-      svn_stringbuf_t *tmpfile_name;
-      apr_file_t *tmp_file;
-
-      /* Open the two source files. */
-      source_file = fopen (file_names[i], "rb");
-      target_file = fopen (file_names[i + 1], "rb");
-
-      /* Open the output file (a tmpfile whose name we want to
-         remember!) */
-      SVN_ERR (svn_io_open_unique_file (&tmp_file, &tmpfile_name,
-                                        "svndiff", ".data", FALSE, pool));
-      
-      /* Create OUTSTREAM from TMPFILE. */
-      out_stream = svn_stream_from_aprfile (tmp_file, pool);
-
-      /* Create a TXDELTA_STREAM from the two files. */
-      svn_txdelta (&txdelta_stream, 
-                   svn_stream_from_stdio (source_file, pool),
-                   svn_stream_from_stdio (target_file, pool), 
-                   pool);
-      
-      
-      /* Note that we want our txdelta's converted to svndiff data,
-         and sent to OUTSTREAM.  */
-      svn_txdelta_to_svndiff (out_stream, pool, 
-                              &svndiff_handler, &svndiff_baton);
-
-      /* Now do the conversion. */
-      svn_txdelta_send_txstream (txdelta_stream, svndiff_handler,
-                                 svndiff_baton, pool);
-
-      /* Close all the files. */
-      fclose (source_file);
-      fclose (target_file);
-      apr_file_close (tmp_file);
-
-      /* ...but remember the tmpfile's name. */
-      (*((svn_stringbuf_t **) apr_array_push (tmp_files))) = tmpfile_name;
+      seqlen = myrand (seed) % MAXSEQ;
+      len -= seqlen;
+      r = subseed_base + myrand (seed) % SEEDS;
+      while (seqlen-- > 0)
+        {
+          putc (r % 256, fp);
+          r = r * 1103515245 + 12345;
+        }
     }
+  rewind (fp);
+  return fp;
+}
 
-  *tmp_files_p = tmp_files;
-  return SVN_NO_ERROR;
+
+/* Return a temporary file holding a copy of FP's contents. */
+static FILE *
+copy_file (FILE *fp)
+{
+  FILE *copy = tmpfile ();
+  int c;
+
+  assert (copy != NULL);
+  rewind (fp);
+  while ((c = getc (fp)) != EOF)
+    putc (c, copy);
+  rewind (copy);
+  return copy;
 }
 
 
-/* Given a array of SVNDIFF_FILES, combine them into a single file
-   containing the combined svndiff delta data across the set of diffs.
-   Return the name of the file which contains this combined delta data
-   in *OUT_FILENAME, and use POOL for all allocations.  */
+/* Compare two open files. The file positions may change. */
 static svn_error_t *
-do_delta_combination (const char **out_filename,
-                      apr_array_header_t *svndiff_files,
-                      apr_pool_t *pool)
+compare_files (FILE *f1, FILE *f2, apr_pool_t *pool)
 {
-  svn_stringbuf_t *target = ((svn_stringbuf_t **) (svndiff_files->elts))[0];
+  int c1, c2;
+  apr_off_t pos = 0;
+
+  rewind (f1);
+  rewind (f2);
+  for (;;)
+    {
+      c1 = getc (f1);
+      c2 = getc (f2);
+      ++pos;
+      if (c1 == EOF && c2 == EOF)
+        break;
+      if (c1 != c2)
+        return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                                  "mismatch at position %"APR_OFF_T_FMT,
+                                  pos);
+    }
+  return SVN_NO_ERROR;
+}
 
 
-  /* ### TODO:  RIGHT HERE!  HERE YA GO!  THIS IS THE SPOT!!
+
+/* A delta stream that replays an array of windows held in memory. */
+
+struct window_array_baton
+{
+  apr_array_header_t *windows;
+  int next;
+};
+
+
+static svn_error_t *
+window_array_next (svn_txdelta_window_t **window,
+                   void *baton,
+                   apr_pool_t *pool)
+{
+  struct window_array_baton *wab = baton;
 
-     Right about ... HERE ... would be a good place to put some delta
-     combination code.  See the docstring above for what should
-     happen.  */
-  *out_filename = apr_pstrdup (pool, target->data);
+  if (wab->next < wab->windows->nelts)
+    *window = APR_ARRAY_IDX (wab->windows, wab->next++,
+                             svn_txdelta_window_t *);
+  else
+    *window = NULL;
   return SVN_NO_ERROR;
 }
 
 
+static const unsigned char *
+window_array_md5 (void *baton)
+{
+  return NULL;
+}
+
 
+static svn_txdelta_stream_t *
+window_array_stream (apr_array_header_t *windows, apr_pool_t *pool)
+{
+  struct window_array_baton *wab = apr_palloc (pool, sizeof (*wab));
+
+  wab->windows = windows;
+  wab->next = 0;
+  return svn_txdelta_stream_create (wab, window_array_next,
+                                    window_array_md5, pool);
+}
 
-/* Apply the svndiff data found in SVNDIFF_FILENAME to the source data
-   found in SOURCE_FILENAME, and store the results in a temporary
-   file, whose name is returned in *OUT_FILENAME.  Use POOL for all
-   allocations.  */
+
+/* Read every window from STREAM into *WINDOWS, allocated in POOL. */
 static svn_error_t *
-apply_svndiff_data (const char **out_filename,
-                    const char *source_filename,
-                    const char *svndiff_filename,
-                    apr_pool_t *pool)
+collect_windows (apr_array_header_t **windows,
+                 svn_txdelta_stream_t *stream,
+                 apr_pool_t *pool)
 {
-  FILE *source_file, *svndiff_file;
-  apr_file_t *out_file;
-  svn_stringbuf_t *unique_file;
-  svn_txdelta_window_handler_t svndiff_handler;
-  svn_stream_t *out_stream, *in_stream;
-  void *svndiff_baton;
-  svn_boolean_t streaming;
-
-  /* Re-open the first file, the svndiff file, and a tmp-file for the
-     diff-applied output. */
-  source_file = fopen (source_filename, "rb");
-  svndiff_file = fopen (svndiff_filename, "rb");
-  SVN_ERR (svn_io_open_unique_file (&out_file, &unique_file,
-                                    "svndiff", ".data", FALSE, pool));
-
-  /* Store our returned filename. */
-  *out_filename = unique_file->data;
-
-  /* Get a handler/baton that will apply txdelta's to SOURCE_FILE, and
-     place the results in OUT_FILE.  */
-  svn_txdelta_apply (svn_stream_from_stdio (source_file, pool),
-                     svn_stream_from_aprfile (out_file, pool),
-                     pool, &svndiff_handler, &svndiff_baton);
-
-  /* Make OUT_STREAM a writable stream that will parse svndiff data,
-     calling a handler/baton for each window of that data. */
-  out_stream = svn_txdelta_parse_svndiff (svndiff_handler, svndiff_baton, 
-                                          TRUE, pool);
-
-  /* Make IN_STREAM a readable stream based on the tmpfile which
-     contains our combined delta data. */
-  in_stream = svn_stream_from_stdio (svndiff_file, pool);
-  
-  /* Now, read from IN_STREAM and write to OUT_STREAM. */
-  streaming = TRUE;
-  while (streaming)
+  apr_pool_t *wpool = svn_pool_create (pool);
+  svn_txdelta_window_t *window;
+
+  *windows = apr_array_make (pool, 4, sizeof (window));
+  do
     {
-      char buf[SVN_STREAM_CHUNK_SIZE];
-      apr_size_t len = SVN_STREAM_CHUNK_SIZE;
-      
-      SVN_ERR (svn_stream_read (in_stream, buf, &len));
-      if (len != SVN_STREAM_CHUNK_SIZE)
-        streaming = FALSE;
-      SVN_ERR (svn_stream_write (out_stream, buf, &len));
+      SVN_ERR (svn_txdelta_next_window (&window, stream, wpool));
+      if (window)
+        *((svn_txdelta_window_t **) apr_array_push (*windows))
+          = svn_txdelta_window_dup (window, pool);
+      svn_pool_clear (wpool);
     }
+  while (window != NULL);
 
-  /* Close the two streams. */
-  SVN_ERR (svn_stream_close (out_stream));
-  SVN_ERR (svn_stream_close (in_stream));
-
+  svn_pool_destroy (wpool);
   return SVN_NO_ERROR;
 }
 
 
-/* Verify that FILE1 and FILE2 definitely have different filesizes
-   (stolen from libsvn_wc/questions.c). */
+/* Push the windows of STREAM through svndiff encoding and decoding
+   and apply them to SOURCE, writing the result to TARGET.  Going
+   through svndiff makes the parser check that the source views never
+   slide backwards.  */
 static svn_error_t *
-filesizes_definitely_different_p (svn_boolean_t *different_p,
-                                  const char *file1,
-                                  const char *file2,
-                                  apr_pool_t *pool)
+apply_stream (svn_txdelta_stream_t *stream,
+              FILE *source,
+              FILE *target,
+              apr_pool_t *pool)
 {
-  apr_finfo_t finfo1;
-  apr_finfo_t finfo2;
-  apr_status_t status;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_stream_t *svndiff;
+
+  rewind (source);
+  svn_txdelta_apply (svn_stream_from_stdio (source, pool),
+                     svn_stream_from_stdio (target, pool),
+                     pool, &handler, &handler_baton);
+  svndiff = svn_txdelta_parse_svndiff (handler, handler_baton, TRUE, pool);
+  svn_txdelta_to_svndiff (svndiff, pool, &handler, &handler_baton);
+  SVN_ERR (svn_txdelta_send_txstream (stream, handler, handler_baton, pool));
+  fflush (target);
+  return SVN_NO_ERROR;
+}
 
-  /* Stat both files */
-  status = apr_stat (&finfo1, file1, APR_FINFO_MIN, pool);
-  if (status)
-    {
-      /* If we got an error stat'ing a file, it could be because the
-         file was removed... or who knows.  Whatever the case, we
-         don't know if the filesizes are definitely different, so
-         assume that they're not. */
-      *different_p = FALSE;
-      return SVN_NO_ERROR;
-    }
 
-  status = apr_stat (&finfo2, file2, APR_FINFO_MIN, pool);
-  if (status)
-    {
-      /* See previous comment. */
-      *different_p = FALSE;
-      return SVN_NO_ERROR;
-    }
+
+/* Build a window from an instruction list.  NEW_DATA is the window's
+   new data.  */
+static svn_txdelta_window_t *
+make_window (apr_off_t sview_offset,
+             apr_size_t sview_len,
+             apr_size_t tview_len,
+             const svn_txdelta_op_t *ops,
+             int num_ops,
+             const char *new_data,
+             apr_pool_t *pool)
+{
+  svn_txdelta_window_t *window = apr_palloc (pool, sizeof (*window));
+
+  window->sview_offset = sview_offset;
+  window->sview_len = sview_len;
+  window->tview_len = tview_len;
+  window->num_ops = num_ops;
+  window->ops = ops;
+  window->new_data = svn_string_create (new_data, pool);
+  return window;
+}
 
 
-  /* Examine file sizes */
-  if (finfo1.size == finfo2.size)
-    *different_p = FALSE;
-  else
-    *different_p = TRUE;
+static svn_error_t *
+compose_windows_test (const char **msg,
+                      svn_boolean_t msg_only,
+                      apr_pool_t *pool)
+{
+  /* A turns "0123456789" into "2345xy2345xy2345", using an
+     overlapping target copy for the repeats.  B turns that into
+     "xy2345--xy2xy".  */
+  static const svn_txdelta_op_t ops_A[] = {
+    { svn_txdelta_source, 2, 4 },
+    { svn_txdelta_new, 0, 2 },
+    { svn_txdelta_target, 0, 10 }
+  };
+  static const svn_txdelta_op_t ops_B[] = {
+    { svn_txdelta_source, 4, 6 },
+    { svn_txdelta_new, 0, 2 },
+    { svn_txdelta_target, 0, 3 },
+    { svn_txdelta_source, 10, 2 }
+  };
+  const char *expected = "xy2345--xy2xy";
+  svn_txdelta_window_t *window_A, *window_B, *composite;
+  apr_array_header_t *windows;
+  FILE *source, *target;
+  char buf[64];
+  size_t len;
+
+  *msg = "compose two hand-built windows";
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+  window_A = make_window (0, 10, 16, ops_A, 3, "xy", pool);
+  window_B = make_window (0, 16, 13, ops_B, 4, "--", pool);
+  composite = svn_txdelta_compose_windows (window_A, window_B, pool);
+
+  if (composite->sview_offset != 0 || composite->sview_len != 10
+      || composite->tview_len != strlen (expected))
+    return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                             "composite window has wrong views");
+
+  source = tmpfile ();
+  target = tmpfile ();
+  fputs ("0123456789", source);
+
+  windows = apr_array_make (pool, 1, sizeof (composite));
+  *((svn_txdelta_window_t **) apr_array_push (windows)) = composite;
+  SVN_ERR (apply_stream (window_array_stream (windows, pool),
+                         source, target, pool));
+
+  rewind (target);
+  len = fread (buf, 1, sizeof (buf) - 1, target);
+  buf[len] = '\0';
+  fclose (source);
+  fclose (target);
+
+  if (strcmp (buf, expected) != 0)
+    return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                              "composite produced `%s', expected `%s'",
+                              buf, expected);
 
   return SVN_NO_ERROR;
 }
 
-/* Compare the contents of FILE1 and FILE2, and report whether or not
-   they are identical.  Use POOL for all allocations (this code was
-   stolen from libsvn_wc/questions.c) */
+
 static svn_error_t *
-contents_identical_p (svn_boolean_t *identical_p,
-                      const char *file1,
-                      const char *file2,
-                      apr_pool_t *pool)
+compose_stream_test (const char **msg,
+                     svn_boolean_t msg_only,
+                     apr_pool_t *pool)
 {
-  apr_status_t status;
-  apr_size_t bytes_read1, bytes_read2;
-  char buf1[BUFSIZ], buf2[BUFSIZ];
-  apr_file_t *file1_h = NULL;
-  apr_file_t *file2_h = NULL;
-
-  status = apr_file_open (&file1_h, file1,
-                          APR_READ, APR_OS_DEFAULT, pool);
-  if (status)
-    return svn_error_createf
-      (status, 0, NULL, pool,
-       "contents_identical_p: apr_file_open failed on `%s'", file1);
-
-  status = apr_file_open (&file2_h, file2, APR_READ, 
-                          APR_OS_DEFAULT, pool);
-  if (status)
-    return svn_error_createf
-      (status, 0, NULL, pool,
-       "contents_identical_p: apr_file_open failed on `%s'", file2);
-
-  *identical_p = TRUE;  /* assume TRUE, until disproved below */
-  while (!APR_STATUS_IS_EOF(status))
+  static char msg_buff[256];
+
+  unsigned long seed;
+  int i, j, maxlen, iterations, versions;
+
+  init_params (&seed, &maxlen, &iterations, &versions, pool);
+  sprintf (msg_buff, "random delta composition, seed = %lu", seed);
+  *msg = msg_buff;
+
+  if (msg_only)
+    return SVN_NO_ERROR;
+  else
+    printf ("SEED: %s\n", msg_buff);
+
+  for (i = 0; i < iterations; i++)
     {
-      status = apr_file_read_full (file1_h, buf1, sizeof(buf1), &bytes_read1);
-      if (status && !APR_STATUS_IS_EOF(status))
-        return svn_error_createf
-          (status, 0, NULL, pool,
-           "contents_identical_p: apr_file_read_full() failed on %s.", 
-           file1);
-
-      status = apr_file_read_full (file2_h, buf2, sizeof(buf2), &bytes_read2);
-      if (status && !APR_STATUS_IS_EOF(status))
-        return svn_error_createf
-          (status, 0, NULL, pool,
-           "contents_identical_p: apr_file_read_full() failed on %s.", 
-           file2);
-      
-      if ((bytes_read1 != bytes_read2)
-          || (memcmp (buf1, buf2, bytes_read1)))
+      apr_pool_t *iterpool = svn_pool_create (pool);
+      unsigned long subseed_base = myrand (&seed);
+      FILE **files = apr_palloc (iterpool, versions * sizeof (*files));
+      FILE *target_regen = tmpfile ();
+      svn_txdelta_stream_t *composed = NULL;
+
+      for (j = 0; j < versions; j++)
+        files[j] = generate_random_file (maxlen, subseed_base, &seed);
+
+      /* Compose the chain of deltas V0->V1, V1->V2, ... into a single
+         V0->Vn delta.  The deltas are computed lazily as the composite
+         is pulled, so each one reads from its own copies of the
+         fulltexts. */
+      for (j = 0; j < versions - 1; j++)
         {
-          *identical_p = FALSE;
-          break;
+          svn_txdelta_stream_t *delta;
+
+          svn_txdelta (&delta,
+                       svn_stream_from_stdio (copy_file (files[j]),
+                                              iterpool),
+                       svn_stream_from_stdio (copy_file (files[j + 1]),
+                                              iterpool),
+                       iterpool);
+          if (composed)
+            svn_txdelta_compose (&composed, composed, delta, iterpool);
+          else
+            composed = delta;
         }
-    }
 
-  status = apr_file_close (file1_h);
-  if (status)
-    return svn_error_createf 
-      (status, 0, NULL, pool,
-       "contents_identical_p: apr_file_close failed on %s.", file1);
+      SVN_ERR (apply_stream (composed, files[0], target_regen, iterpool));
+      SVN_ERR (compare_files (files[versions - 1], target_regen, pool));
 
-  status = apr_file_close (file2_h);
-  if (status)
-    return svn_error_createf 
-      (status, 0, NULL, pool,
-       "contents_identical_p: apr_file_close failed on %s.", file2);
+      for (j = 0; j < versions; j++)
+        fclose (files[j]);
+      fclose (target_regen);
+      svn_pool_destroy (iterpool);
+    }
 
   return SVN_NO_ERROR;
 }
 
 
-int
-main (int argc, 
-      const char **argv)
+
+/* Throughput of composition alone.  The deltas are computed up
+   front and held in memory, so only the window arithmetic is timed. */
+
+/* Make a copy of TEXT (of length LEN) with a few scattered edits. */
+static char *
+edit_text (const char *text, apr_size_t len, unsigned long *seed,
+           apr_pool_t *pool)
 {
-  apr_pool_t *pool;
-  apr_array_header_t *tmp_files;
-  const char *combined_diff_filename, *target_regen_filename;
-  svn_boolean_t identical, different_sizes;
-
-  /* We have needs, too, you know...like 3 arguments to the program! */
-  if (argc < 4)
-    return do_usage (argv[0], 1);
-  
-  /* Initialize APR and create our top-level SVN pool. */
-  apr_initialize();
-  pool = svn_pool_create (NULL);
-  
-  /* Generate the successive svndiffs between out input files. */
-  INT_ERR (generate_file_diffs (&tmp_files, argc - 1, argv + 1, pool));
-
-
-  /* WHOO-PAH!!  Here is where we do the delta combination, baby!  The
-     result should be a single svndiff-containing file */
-  INT_ERR (do_delta_combination (&combined_diff_filename,
-                                 tmp_files,
-                                 pool));
-
-  
-  /* And here, we need to apply our combined delta to our first file,
-     and store the results in another tempfilee.  */
-  INT_ERR (apply_svndiff_data (&target_regen_filename,
-                               argv[1],
-                               combined_diff_filename,
-                               pool));
-
-  /* Then, we compare the delta-d copied with the last file, and if
-     they are exactly alike, we win!!  */
-  INT_ERR (filesizes_definitely_different_p (&different_sizes,
-                                             argv[1],
-                                             target_regen_filename,
-                                             pool));
-  if (different_sizes)
-    INT_ERR (svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
-                               "Application of combined delta corrupt"));
-
-  INT_ERR (contents_identical_p (&identical, 
-                                 argv[1],
-                                 target_regen_filename,
-                                 pool));
-  if (! identical)
-    INT_ERR (svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
-                               "Application of combined delta corrupt"));
-
-  apr_terminate();
-  return 0;
+  char *new_text = apr_palloc (pool, len);
+  int k;
+
+  memcpy (new_text, text, len);
+  for (k = 0; k < 64; k++)
+    {
+      apr_size_t pos = myrand (seed) % len;
+      apr_size_t n = myrand (seed) % 256;
+      while (n-- > 0 && pos < len)
+        new_text[pos++] = (char) myrand (seed);
+    }
+  return new_text;
+}
+
+
+static svn_error_t *
+compose_throughput_test (const char **msg,
+                         svn_boolean_t msg_only,
+                         apr_pool_t *pool)
+{
+  static char msg_buff[256];
+
+  unsigned long seed = 42;
+  apr_array_header_t *deltas[DEFAULT_VERSIONS];
+  const char *texts[DEFAULT_VERSIONS + 1];
+  svn_txdelta_stream_t *composed;
+  svn_txdelta_window_t *window;
+  apr_pool_t *wpool;
+  apr_time_t start, elapsed;
+  apr_size_t produced = 0;
+  char *base;
+  int i;
+
+  sprintf (msg_buff, "delta composition throughput (%d deltas of %d KB)",
+           DEFAULT_VERSIONS, BENCH_LEN / 1024);
+  *msg = msg_buff;
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+  base = apr_palloc (pool, BENCH_LEN);
+  for (i = 0; i < BENCH_LEN; i++)
+    base[i] = (char) (myrand (&seed) % 64 + ' ');
+  texts[0] = base;
+  for (i = 1; i <= DEFAULT_VERSIONS; i++)
+    texts[i] = edit_text (texts[i - 1], BENCH_LEN, &seed, pool);
+
+  for (i = 0; i < DEFAULT_VERSIONS; i++)
+    {
+      FILE *source = tmpfile ();
+      FILE *target = tmpfile ();
+      svn_txdelta_stream_t *delta;
+
+      fwrite (texts[i], 1, BENCH_LEN, source);
+      fwrite (texts[i + 1], 1, BENCH_LEN, target);
+      rewind (source);
+      rewind (target);
+      svn_txdelta (&delta, svn_stream_from_stdio (source, pool),
+                   svn_stream_from_stdio (target, pool), pool);
+      SVN_ERR (collect_windows (&deltas[i], delta, pool));
+      fclose (source);
+      fclose (target);
+    }
+
+  wpool = svn_pool_create (pool);
+  start = apr_time_now ();
+
+  composed = window_array_stream (deltas[0], pool);
+  for (i = 1; i < DEFAULT_VERSIONS; i++)
+    svn_txdelta_compose (&composed, composed,
+                         window_array_stream (deltas[i], pool), pool);
+  do
+    {
+      SVN_ERR (svn_txdelta_next_window (&window, composed, wpool));
+      if (window)
+        produced += window->tview_len;
+      svn_pool_clear (wpool);
+    }
+  while (window != NULL);
+
+  elapsed = apr_time_now () - start;
+  svn_pool_destroy (wpool);
+
+  if (produced != BENCH_LEN)
+    return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                              "composed delta covers %lu bytes, "
+                              "expected %lu",
+                              (unsigned long) produced,
+                              (unsigned long) BENCH_LEN);
+
+  printf ("THROUGHPUT: composed %d KB in %.3f s (%.1f MB/s)\n",
+          BENCH_LEN / 1024, (double) elapsed / APR_USEC_PER_SEC,
+          elapsed > 0
+          ? ((double) produced / (1024 * 1024))
+            / ((double) elapsed / APR_USEC_PER_SEC)
+          : 0.0);
+
+  return SVN_NO_ERROR;
 }
 
 
 
-/* 
+
+/* The test table.  */
+
+svn_error_t * (*test_funcs[]) (const char **msg,
+                               svn_boolean_t msg_only,
+                               apr_pool_t *pool) = {
+  0,
+  compose_windows_test,
+  compose_stream_test,
+  compose_throughput_test,
+  0
+};
+
+
+
+/*
  * local variables:
  * eval: (load-file "../../../tools/dev/svn-dev.el")
  * end:
@@ -22,6 +22,7 @@
 #include <assert.h>
 #include "apr_general.h"
 #include "apr_getopt.h"
+#include "apr_md5.h"
 #include "svn_delta.h"
 #include "svn_pools.h"
 #include "svn_error.h"
@@ -232,6 +233,143 @@ random_test (const char **msg,
 }
 
 
+/* Return an error unless windows W1 and W2 are identical. */
+static svn_error_t *
+compare_windows (const svn_txdelta_window_t *w1,
+                 const svn_txdelta_window_t *w2,
+                 int n, apr_pool_t *pool)
+{
+  int i;
+
+  if (w1 == NULL || w2 == NULL)
+    {
+      if (w1 == w2)
+        return SVN_NO_ERROR;
+      return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                                "window %d: only one stream ended", n);
+    }
+
+  if (w1->sview_offset != w2->sview_offset
+      || w1->sview_len != w2->sview_len
+      || w1->tview_len != w2->tview_len
+      || w1->num_ops != w2->num_ops
+      || w1->new_data->len != w2->new_data->len
+      || memcmp (w1->new_data->data, w2->new_data->data,
+                 w1->new_data->len) != 0)
+    return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                              "window %d differs", n);
+
+  for (i = 0; i < w1->num_ops; i++)
+    if (w1->ops[i].action_code != w2->ops[i].action_code
+        || w1->ops[i].offset != w2->ops[i].offset
+        || w1->ops[i].length != w2->ops[i].length)
+      return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                                "window %d differs at op %d", n, i);
+
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+parallel_test (const char **msg,
+               svn_boolean_t msg_only,
+               apr_pool_t *pool)
+{
+  static char msg_buff[256];
+
+  unsigned long seed;
+  int i, maxlen, iterations;
+
+  init_params(&seed, &maxlen, &iterations, pool);
+  sprintf(msg_buff, "parallel delta test, seed = %lu", seed);
+  *msg = msg_buff;
+
+  if (msg_only)
+    return SVN_NO_ERROR;
+  else
+    printf("SEED: %s\n", msg_buff);
+
+  /* Use files spanning several windows, so that the workers really
+     do run concurrently. */
+  maxlen *= 8;
+  iterations = (iterations + 4) / 5;
+
+  for (i = 0; i < iterations; i++)
+    {
+      unsigned long subseed_base = myrand (&seed);
+      FILE *source = generate_random_file (maxlen, subseed_base, &seed);
+      FILE *target = generate_random_file (maxlen, subseed_base, &seed);
+      FILE *source_copy = copy_tempfile (source);
+      FILE *target_copy = copy_tempfile (target);
+      int num_threads = 1 + i % 4;
+      int n = 0;
+
+      svn_txdelta_stream_t *serial, *parallel;
+      svn_txdelta_window_t *w1, *w2;
+      apr_pool_t *delta_pool = svn_pool_create (pool);
+      apr_pool_t *window_pool = svn_pool_create (delta_pool);
+
+      rewind (source);
+      rewind (target);
+
+      svn_txdelta (&serial,
+                   svn_stream_from_stdio (source, delta_pool),
+                   svn_stream_from_stdio (target, delta_pool),
+                   delta_pool);
+      svn_txdelta_parallel (&parallel,
+                            svn_stream_from_stdio (source_copy, delta_pool),
+                            svn_stream_from_stdio (target_copy, delta_pool),
+                            num_threads, delta_pool);
+
+      /* The parallel stream must produce exactly the same windows. */
+      do
+        {
+          SVN_ERR (svn_txdelta_next_window (&w1, serial, window_pool));
+          SVN_ERR (svn_txdelta_next_window (&w2, parallel, window_pool));
+          SVN_ERR (compare_windows (w1, w2, n++, pool));
+          svn_pool_clear (window_pool);
+        }
+      while (w1 != NULL);
+
+      {
+        const unsigned char *d1 = svn_txdelta_md5_digest (serial);
+        const unsigned char *d2 = svn_txdelta_md5_digest (parallel);
+
+        if (d1 == NULL || d2 == NULL)
+          return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                                   "no digest after the final window");
+        if (memcmp (d1, d2, MD5_DIGESTSIZE) != 0)
+          return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                                   "parallel digest differs from serial");
+      }
+
+      /* Every other time, abandon a second parallel stream half way,
+         which must not leave its workers behind. */
+      if (i % 2)
+        {
+          rewind (source_copy);
+          rewind (target_copy);
+          svn_txdelta_parallel (&parallel,
+                                svn_stream_from_stdio (source_copy,
+                                                       delta_pool),
+                                svn_stream_from_stdio (target_copy,
+                                                       delta_pool),
+                                num_threads, delta_pool);
+          SVN_ERR (svn_txdelta_next_window (&w2, parallel, window_pool));
+        }
+
+      svn_pool_destroy (delta_pool);
+
+      fclose(source);
+      fclose(target);
+      fclose(source_copy);
+      fclose(target_copy);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
 
 
 /* The test table.  */
@@ -241,6 +379,7 @@ svn_error_t * (*test_funcs[]) (const char **msg,
                                apr_pool_t *pool) = {
   0,
   random_test,
+  parallel_test,
   0
 };
 
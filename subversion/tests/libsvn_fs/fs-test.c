@@ -19,6 +19,7 @@
 #include <string.h>
 #include <apr_pools.h>
 #include <apr_time.h>
+#include <apr_file_info.h>
 #include <apr_md5.h>
 
 #include "svn_pools.h"
@@ -36,6 +37,7 @@
 #include "../../libsvn_fs/node-rev.h"
 #include "../../libsvn_fs/rev-table.h"
 #include "../../libsvn_fs/nodes-table.h"
+#include "../../libsvn_fs/txn-table.h"
 #include "../../libsvn_fs/trail.h"
 #include "../../libsvn_fs/id.h"
 
@@ -436,6 +438,61 @@ verify_txn_list (const char **msg,
 
 
 
+/* Record, replace and forget activities. */
+static svn_error_t *
+activities (const char **msg,
+            svn_boolean_t msg_only,
+            apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  const char *txn_name;
+
+  *msg = "record, look up and forget activities";
+
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+  SVN_ERR (svn_test__create_fs (&fs, "test-repo-activities", pool));
+
+  /* An activity nobody recorded has no transaction.  */
+  SVN_ERR (svn_fs_activity_txn (&txn_name, fs, "act-1", pool));
+  if (txn_name)
+    return svn_error_create (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+                             "found an activity that was never recorded");
+
+  SVN_ERR (svn_fs_set_activity_txn (fs, "act-1", "1", pool));
+  SVN_ERR (svn_fs_set_activity_txn (fs, "act-2", "2", pool));
+  SVN_ERR (svn_fs_activity_txn (&txn_name, fs, "act-1", pool));
+  if (! txn_name || strcmp (txn_name, "1"))
+    return svn_error_create (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+                             "got the wrong transaction for an activity");
+
+  /* Recording an activity again replaces its transaction.  */
+  SVN_ERR (svn_fs_set_activity_txn (fs, "act-1", "3", pool));
+  SVN_ERR (svn_fs_activity_txn (&txn_name, fs, "act-1", pool));
+  if (! txn_name || strcmp (txn_name, "3"))
+    return svn_error_create (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+                             "re-recording an activity didn't replace it");
+
+  /* Forgetting one activity leaves the other alone, and forgetting it
+     twice is fine.  */
+  SVN_ERR (svn_fs_set_activity_txn (fs, "act-1", NULL, pool));
+  SVN_ERR (svn_fs_set_activity_txn (fs, "act-1", NULL, pool));
+  SVN_ERR (svn_fs_activity_txn (&txn_name, fs, "act-1", pool));
+  if (txn_name)
+    return svn_error_create (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+                             "found a forgotten activity");
+  SVN_ERR (svn_fs_activity_txn (&txn_name, fs, "act-2", pool));
+  if (! txn_name || strcmp (txn_name, "2"))
+    return svn_error_create (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+                             "forgetting one activity lost another");
+
+  SVN_ERR (svn_fs_close_fs (fs));
+
+  return SVN_NO_ERROR;
+}
+
+
 /* Test writing & reading a file's contents. */
 static svn_error_t *
 write_and_read_file (const char **msg,
@@ -484,6 +541,93 @@ write_and_read_file (const char **msg,
 
 
 
+/* Check that reading PATH in ROOT from each of a few offsets yields
+   the rest of CONTENTS, the file's whole contents. */
+static svn_error_t *
+check_file_contents_at (svn_fs_root_t *root,
+                        const char *path,
+                        const char *contents,
+                        apr_pool_t *pool)
+{
+  apr_size_t len = strlen (contents);
+  apr_size_t offsets[4];
+  svn_stream_t *rstream;
+  svn_stringbuf_t *rstring;
+  int i;
+
+  offsets[0] = 0;
+  offsets[1] = len / 3;
+  offsets[2] = len - 1;
+  offsets[3] = len;
+
+  for (i = 0; i < 4; i++)
+    {
+      SVN_ERR (svn_fs_file_contents_at (&rstream, root, path,
+                                        offsets[i], pool));
+      SVN_ERR (svn_test__stream_to_string (&rstring, rstream, pool));
+
+      if (strcmp (rstring->data, contents + offsets[i]) != 0)
+        return svn_error_createf (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+                                  "read `%s' from offset %lu of `%s', "
+                                  "expected `%s'", rstring->data,
+                                  (unsigned long) offsets[i], path,
+                                  contents + offsets[i]);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Test reading a file's contents from part-way through, both when
+   it is stored as fulltext and as a delta. */
+static svn_error_t *
+read_file_at_offset (const char **msg,
+                     svn_boolean_t msg_only,
+                     apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev1_root;
+  svn_revnum_t youngest_rev;
+  const char *contents = "Wicki wild, wicki wicki wild.";
+
+  *msg = "read a file's contents from an offset";
+
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+  SVN_ERR (svn_test__create_fs (&fs, "test-repo-read-file-at-offset", pool));
+
+  SVN_ERR (svn_fs_begin_txn (&txn, fs, 0, pool));
+  SVN_ERR (svn_fs_txn_root (&txn_root, txn, pool));
+  SVN_ERR (svn_fs_make_file (txn_root, "beer.txt", pool));
+  SVN_ERR (svn_test__set_file_contents (txn_root, "beer.txt",
+                                        contents, pool));
+  SVN_ERR (svn_fs_commit_txn (NULL, &youngest_rev, txn));
+  SVN_ERR (svn_fs_close_txn (txn));
+
+  SVN_ERR (svn_fs_revision_root (&rev1_root, fs, youngest_rev, pool));
+  SVN_ERR (check_file_contents_at (rev1_root, "beer.txt", contents, pool));
+
+  /* Change the file, and make the old contents a delta against the
+     new. */
+  SVN_ERR (svn_fs_begin_txn (&txn, fs, youngest_rev, pool));
+  SVN_ERR (svn_fs_txn_root (&txn_root, txn, pool));
+  SVN_ERR (svn_test__set_file_contents (txn_root, "beer.txt",
+                                        "Wicki wild.", pool));
+  SVN_ERR (svn_fs_commit_txn (NULL, &youngest_rev, txn));
+  SVN_ERR (svn_fs_close_txn (txn));
+  SVN_ERR (svn_fs_deltify (rev1_root, "beer.txt", 0, pool));
+
+  SVN_ERR (check_file_contents_at (rev1_root, "beer.txt", contents, pool));
+
+  SVN_ERR (svn_fs_close_fs (fs));
+
+  return SVN_NO_ERROR;
+}
+
+
+
 /* Create a file, a directory, and a file in that directory! */
 static svn_error_t *
 create_mini_tree_transaction (const char **msg,
@@ -1452,6 +1596,43 @@ fetch_youngest_rev (const char **msg,
 }
 
 
+static svn_error_t *
+trail_stats (const char **msg,
+             svn_boolean_t msg_only,
+             apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_revnum_t youngest_rev;
+  unsigned long trails, later_trails, retries;
+
+  *msg = "count the trails run in a filesystem";
+
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+  SVN_ERR (svn_test__create_fs (&fs, "test-repo-trail-stats", pool));
+  svn_fs_trail_stats (&trails, NULL, fs);
+
+  /* Fetching the youngest revision takes exactly one trail. */
+  SVN_ERR (svn_fs_youngest_rev (&youngest_rev, fs, pool));
+  svn_fs_trail_stats (&later_trails, &retries, fs);
+
+  if (later_trails != trails + 1)
+    return svn_error_createf
+      (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+       "expected %lu trails, counted %lu", trails + 1, later_trails);
+
+  /* Nothing else is using the filesystem, so nothing can deadlock. */
+  if (retries != 0)
+    return svn_error_createf
+      (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+       "counted %lu deadlock retries in an unshared filesystem", retries);
+
+  SVN_ERR (svn_fs_close_fs (fs));
+  return SVN_NO_ERROR;
+}
+
+
 /* Test committing against an empty repository.
    todo: also test committing against youngest? */
 static svn_error_t *
@@ -5344,6 +5525,124 @@ test_node_created_rev (const char **msg,
 }
 
 
+/* Check that INFO, for PATH in ROOT, agrees with what the
+   one-at-a-time functions say about PATH, and that PATH was created
+   in revision REV.  */
+static svn_error_t *
+check_node_info (svn_fs_node_info_t *info,
+                 svn_fs_root_t *root,
+                 const char *path,
+                 svn_revnum_t rev,
+                 apr_pool_t *pool)
+{
+  svn_fs_id_t *id;
+  int is_dir;
+
+  if (! info)
+    return svn_error_createf
+      (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+       "check_node_info: no information for '%s'", path);
+
+  SVN_ERR (svn_fs_node_id (&id, root, path, pool));
+  SVN_ERR (svn_fs_is_dir (&is_dir, root, path, pool));
+
+  if (! svn_fs__id_eq (info->id, id))
+    return svn_error_createf
+      (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+       "check_node_info: '%s' has the wrong node revision ID", path);
+
+  if (info->kind != (is_dir ? svn_node_dir : svn_node_file))
+    return svn_error_createf
+      (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+       "check_node_info: '%s' has the wrong kind", path);
+
+  if (info->created_rev != rev)
+    return svn_error_createf
+      (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+       "check_node_info: '%s' has created rev '%ld' (expected '%ld')",
+       path, info->created_rev, rev);
+
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+node_info (const char **msg,
+           svn_boolean_t msg_only,
+           apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev_root;
+  svn_revnum_t youngest_rev = 0;
+  svn_fs_node_info_t *info;
+  apr_hash_t *entries;
+
+  *msg = "svn_fs_node_info on a directory and its entries";
+
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+  SVN_ERR (svn_test__create_fs (&fs, "test-repo-node-info", pool));
+
+  /* Revision 1: the greek tree.  Revision 2: a change to iota. */
+  SVN_ERR (svn_fs_begin_txn (&txn, fs, youngest_rev, pool));
+  SVN_ERR (svn_fs_txn_root (&txn_root, txn, pool));
+  SVN_ERR (svn_test__create_greek_tree (txn_root, pool));
+  SVN_ERR (test_commit_txn (&youngest_rev, txn, NULL, pool));
+  SVN_ERR (svn_fs_close_txn (txn));
+
+  SVN_ERR (svn_fs_begin_txn (&txn, fs, youngest_rev, pool));
+  SVN_ERR (svn_fs_txn_root (&txn_root, txn, pool));
+  SVN_ERR (svn_test__set_file_contents
+           (txn_root, "iota", "pointless mod here", pool));
+  SVN_ERR (test_commit_txn (&youngest_rev, txn, NULL, pool));
+  SVN_ERR (svn_fs_close_txn (txn));
+
+  SVN_ERR (svn_fs_revision_root (&rev_root, fs, youngest_rev, pool));
+
+  /* The root, and its entries. */
+  SVN_ERR (svn_fs_node_info (&info, &entries, rev_root, "", pool));
+  SVN_ERR (check_node_info (info, rev_root, "", 2, pool));
+  if (! entries || apr_hash_count (entries) != 2)
+    return svn_error_create
+      (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+       "svn_fs_node_info: the root should have two entries");
+  SVN_ERR (check_node_info (apr_hash_get (entries, "iota",
+                                          APR_HASH_KEY_STRING),
+                            rev_root, "iota", 2, pool));
+  SVN_ERR (check_node_info (apr_hash_get (entries, "A",
+                                          APR_HASH_KEY_STRING),
+                            rev_root, "A", 1, pool));
+
+  /* A directory further down. */
+  SVN_ERR (svn_fs_node_info (&info, &entries, rev_root, "A/D/G", pool));
+  SVN_ERR (check_node_info (info, rev_root, "A/D/G", 1, pool));
+  if (! entries || apr_hash_count (entries) != 3)
+    return svn_error_create
+      (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+       "svn_fs_node_info: A/D/G should have three entries");
+  SVN_ERR (check_node_info (apr_hash_get (entries, "rho",
+                                          APR_HASH_KEY_STRING),
+                            rev_root, "A/D/G/rho", 1, pool));
+
+  /* A file has no entries. */
+  SVN_ERR (svn_fs_node_info (&info, &entries, rev_root, "iota", pool));
+  SVN_ERR (check_node_info (info, rev_root, "iota", 2, pool));
+  if (entries)
+    return svn_error_create
+      (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+       "svn_fs_node_info: a file should have no entries");
+
+  /* Entries are optional. */
+  SVN_ERR (svn_fs_node_info (&info, NULL, rev_root, "A/B", pool));
+  SVN_ERR (check_node_info (info, rev_root, "A/B", 1, pool));
+
+  svn_fs_close_fs (fs);
+  return SVN_NO_ERROR;
+}
+
+
 static svn_error_t *
 check_related (const char **msg,
                svn_boolean_t msg_only,
@@ -5757,7 +6056,8 @@ revisions_changed (const char **msg,
         paths = apr_array_make (spool, 1, sizeof (const char *));
         (*(const char **)apr_array_push(paths)) = path;
         
-        SVN_ERR (svn_fs_revisions_changed (&revs, rev_root, paths, spool));
+        SVN_ERR (svn_fs_revisions_changed (&revs, rev_root, paths,
+                                           SVN_INVALID_REVNUM, 0, spool));
 
         /* Are we at least looking at the right number of returned
            revisions? */
@@ -5777,6 +6077,34 @@ revisions_changed (const char **msg,
                  "Changed revisions differ from expected for `%s'\n%s",
                  path, print_chrevs (revs, num_revs, &(chrevs[j][1]), spool));
           }
+
+        /* Asking for only the two youngest revisions, or for none
+           older than the second youngest, should give the start of
+           the same list.  */
+        SVN_ERR (svn_fs_revisions_changed (&revs, rev_root, paths,
+                                           SVN_INVALID_REVNUM, 2, spool));
+        for (i = 0; i < num_revs && i < 2; i++)
+          if (i >= revs->nelts
+              || ((svn_revnum_t *)revs->elts)[i] != chrevs[j][i + 1])
+            break;
+        if (i != revs->nelts || i != (num_revs < 2 ? num_revs : 2))
+          return svn_error_createf
+            (SVN_ERR_FS_GENERAL, 0, NULL, spool,
+             "Limited changed revisions differ from expected for `%s'",
+             path);
+
+        if (num_revs >= 2)
+          {
+            SVN_ERR (svn_fs_revisions_changed (&revs, rev_root, paths,
+                                               chrevs[j][2], 0, spool));
+            if (revs->nelts != 2
+                || ((svn_revnum_t *)revs->elts)[0] != chrevs[j][1]
+                || ((svn_revnum_t *)revs->elts)[1] != chrevs[j][2])
+              return svn_error_createf
+                (SVN_ERR_FS_GENERAL, 0, NULL, spool,
+                 "Bounded changed revisions differ from expected for `%s'",
+                 path);
+          }
         
         /* Clear the per-iteration subpool. */
         svn_pool_clear (spool);
@@ -5794,6 +6122,283 @@ revisions_changed (const char **msg,
 
 
 
+static svn_error_t *
+check_file_checksum (svn_fs_root_t *root,
+                     const char *path,
+                     const char *contents,
+                     apr_pool_t *pool)
+{
+  unsigned char expected[MD5_DIGESTSIZE], actual[MD5_DIGESTSIZE];
+
+  apr_md5 (expected, contents, strlen (contents));
+  SVN_ERR (svn_fs_file_md5_checksum (actual, root, path, pool));
+  if (memcmp (expected, actual, MD5_DIGESTSIZE) != 0)
+    return svn_error_createf (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+                              "wrong checksum for `%s'", path);
+
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+file_checksums (const char **msg,
+                svn_boolean_t msg_only,
+                apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev1_root, *rev2_root;
+  svn_revnum_t youngest_rev;
+  svn_fs_verify_stats_t stats;
+  int changed, num_threads;
+  const char *iota = "This is the file 'iota'.\n";
+  const char *new_iota = "This is a new version of 'iota'.\n";
+
+  *msg = "record, compare, and verify file checksums";
+
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+  SVN_ERR (svn_test__create_fs (&fs, "test-repo-file-checksums", pool));
+
+  /* Revision 1: the greek tree. */
+  SVN_ERR (svn_fs_begin_txn (&txn, fs, 0, pool));
+  SVN_ERR (svn_fs_txn_root (&txn_root, txn, pool));
+  SVN_ERR (svn_test__create_greek_tree (txn_root, pool));
+  SVN_ERR (check_file_checksum (txn_root, "iota", iota, pool));
+  SVN_ERR (svn_fs_commit_txn (NULL, &youngest_rev, txn));
+  SVN_ERR (svn_fs_close_txn (txn));
+
+  /* Revision 2: give `A/mu' the same contents as `iota', add an empty
+     file, and change `iota'. */
+  SVN_ERR (svn_fs_begin_txn (&txn, fs, youngest_rev, pool));
+  SVN_ERR (svn_fs_txn_root (&txn_root, txn, pool));
+  SVN_ERR (svn_test__set_file_contents (txn_root, "A/mu", iota, pool));
+  SVN_ERR (svn_fs_make_file (txn_root, "A/empty", pool));
+  SVN_ERR (svn_test__set_file_contents (txn_root, "iota", new_iota, pool));
+  SVN_ERR (svn_fs_commit_txn (NULL, &youngest_rev, txn));
+  SVN_ERR (svn_fs_close_txn (txn));
+
+  SVN_ERR (svn_fs_revision_root (&rev1_root, fs, 1, pool));
+  SVN_ERR (svn_fs_revision_root (&rev2_root, fs, 2, pool));
+  SVN_ERR (check_file_checksum (rev1_root, "iota", iota, pool));
+  SVN_ERR (check_file_checksum (rev2_root, "iota", new_iota, pool));
+  SVN_ERR (check_file_checksum (rev2_root, "A/mu", iota, pool));
+  SVN_ERR (check_file_checksum (rev2_root, "A/empty", "", pool));
+
+  /* Separately stored, but identical, contents are the same. */
+  SVN_ERR (svn_fs_contents_changed (&changed, rev1_root, "iota",
+                                    rev2_root, "A/mu", pool));
+  if (changed)
+    return svn_error_create (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+                             "identical contents reported as changed");
+  SVN_ERR (svn_fs_contents_changed (&changed, rev1_root, "iota",
+                                    rev2_root, "iota", pool));
+  if (! changed)
+    return svn_error_create (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+                             "changed contents reported as the same");
+
+  /* The checksum survives deltification and undeltification. */
+  SVN_ERR (svn_fs_deltify (rev1_root, "iota", 0, pool));
+  SVN_ERR (check_file_checksum (rev1_root, "iota", iota, pool));
+  SVN_ERR (svn_fs_undeltify (rev1_root, "iota", 0, pool));
+  SVN_ERR (check_file_checksum (rev1_root, "iota", iota, pool));
+  SVN_ERR (svn_fs_deltify (rev1_root, "", 1, pool));
+
+  /* Everything checks out, with and without worker threads. */
+  for (num_threads = 1; num_threads <= 3; num_threads++)
+    {
+      SVN_ERR (svn_fs_verify (&stats, fs, num_threads, pool));
+      if (stats.corrupt || stats.checked == 0)
+        return svn_error_createf (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+                                  "verification with %d thread(s) checked "
+                                  "%d representations, %d corrupt",
+                                  num_threads, stats.checked, stats.corrupt);
+    }
+
+  svn_fs_close_fs (fs);
+  return SVN_NO_ERROR;
+}
+
+
+struct forget_txn_args
+{
+  svn_fs_t *fs;
+  const char *name;
+};
+
+
+static svn_error_t *
+txn_body_forget_txn (void *baton, trail_t *trail)
+{
+  struct forget_txn_args *args = baton;
+  return svn_fs__delete_txn (args->fs, args->name, trail);
+}
+
+
+static svn_error_t *
+collect_garbage (const char **msg,
+                 svn_boolean_t msg_only,
+                 apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn, *dead_txn;
+  svn_fs_root_t *txn_root, *dead_root, *rev_root;
+  svn_revnum_t youngest_rev;
+  svn_fs_gc_stats_t stats;
+  svn_fs_verify_stats_t verify_stats;
+  struct forget_txn_args args;
+  svn_stringbuf_t *contents;
+
+  *msg = "collect the garbage a vanished transaction leaves behind";
+
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+  SVN_ERR (svn_test__create_fs (&fs, "test-repo-collect-garbage", pool));
+
+  /* Revision 1: the greek tree. */
+  SVN_ERR (svn_fs_begin_txn (&txn, fs, 0, pool));
+  SVN_ERR (svn_fs_txn_root (&txn_root, txn, pool));
+  SVN_ERR (svn_test__create_greek_tree (txn_root, pool));
+  SVN_ERR (svn_fs_commit_txn (NULL, &youngest_rev, txn));
+  SVN_ERR (svn_fs_close_txn (txn));
+
+  /* A fresh repository has no garbage. */
+  SVN_ERR (svn_fs_gc (&stats, fs, 0, pool));
+  if (stats.nodes || stats.reps || stats.strings)
+    return svn_error_createf (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+                              "gc deleted %d nodes, %d reps, %d strings "
+                              "from a clean repository",
+                              stats.nodes, stats.reps, stats.strings);
+
+  /* One transaction stays live... */
+  SVN_ERR (svn_fs_begin_txn (&txn, fs, youngest_rev, pool));
+  SVN_ERR (svn_fs_txn_root (&txn_root, txn, pool));
+  SVN_ERR (svn_test__set_file_contents (txn_root, "iota", "live iota\n",
+                                        pool));
+
+  /* ... and another vanishes from the `transactions' table without
+     its nodes being cleaned up, as if it were being aborted when the
+     process died. */
+  SVN_ERR (svn_fs_begin_txn (&dead_txn, fs, youngest_rev, pool));
+  SVN_ERR (svn_fs_txn_root (&dead_root, dead_txn, pool));
+  SVN_ERR (svn_test__set_file_contents (dead_root, "A/mu", "dead mu\n",
+                                        pool));
+  SVN_ERR (svn_fs_make_file (dead_root, "A/dead", pool));
+  SVN_ERR (svn_test__set_file_contents (dead_root, "A/dead", "dead\n",
+                                        pool));
+  args.fs = fs;
+  SVN_ERR (svn_fs_txn_name (&args.name, dead_txn, pool));
+  SVN_ERR (svn_fs__retry_txn (fs, txn_body_forget_txn, &args, pool));
+  SVN_ERR (svn_fs_close_txn (dead_txn));
+
+  /* Collect it, in small batches. */
+  SVN_ERR (svn_fs_gc (&stats, fs, 3, pool));
+  if (stats.nodes == 0 || stats.reps == 0 || stats.strings == 0)
+    return svn_error_createf (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+                              "gc deleted only %d nodes, %d reps, "
+                              "%d strings", stats.nodes, stats.reps,
+                              stats.strings);
+
+  /* There's nothing left to collect the second time round. */
+  SVN_ERR (svn_fs_gc (&stats, fs, 0, pool));
+  if (stats.nodes || stats.reps || stats.strings)
+    return svn_error_createf (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+                              "second gc deleted %d nodes, %d reps, "
+                              "%d strings", stats.nodes, stats.reps,
+                              stats.strings);
+
+  /* The live transaction is untouched, and still commits. */
+  SVN_ERR (svn_test__get_file_contents (txn_root, "iota", &contents, pool));
+  if (strcmp (contents->data, "live iota\n") != 0)
+    return svn_error_create (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+                             "gc damaged a live transaction");
+  SVN_ERR (svn_fs_commit_txn (NULL, &youngest_rev, txn));
+  SVN_ERR (svn_fs_close_txn (txn));
+
+  /* And revision 1 is still intact. */
+  SVN_ERR (svn_fs_revision_root (&rev_root, fs, 1, pool));
+  SVN_ERR (svn_test__check_greek_tree (rev_root, pool));
+  SVN_ERR (svn_fs_verify (&verify_stats, fs, 1, pool));
+
+  svn_fs_close_fs (fs);
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+hot_copy (const char **msg,
+          svn_boolean_t msg_only,
+          apr_pool_t *pool)
+{
+  svn_fs_t *fs, *copy_fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev_root;
+  svn_revnum_t youngest_rev;
+  svn_stringbuf_t *contents;
+  const char *copy_path = "test-repo-hot-copy-copy";
+  apr_finfo_t finfo;
+
+  *msg = "hot copy a filesystem, then bring the copy up to date";
+
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+  SVN_ERR (svn_test__create_fs (&fs, "test-repo-hot-copy", pool));
+  if (apr_stat (&finfo, copy_path, APR_FINFO_TYPE, pool) == APR_SUCCESS)
+    SVN_ERR (svn_fs_delete_berkeley (copy_path, pool));
+
+  /* Revision 1: the greek tree. */
+  SVN_ERR (svn_fs_begin_txn (&txn, fs, 0, pool));
+  SVN_ERR (svn_fs_txn_root (&txn_root, txn, pool));
+  SVN_ERR (svn_test__create_greek_tree (txn_root, pool));
+  SVN_ERR (svn_fs_commit_txn (NULL, &youngest_rev, txn));
+  SVN_ERR (svn_fs_close_txn (txn));
+
+  /* Copy it while it's open, and check the copy. */
+  SVN_ERR (svn_fs_hotcopy_berkeley (fs, copy_path, FALSE, pool));
+  SVN_ERR (svn_test__fs_new (&copy_fs, pool));
+  SVN_ERR (svn_fs_open_berkeley (copy_fs, copy_path));
+  SVN_ERR (svn_fs_youngest_rev (&youngest_rev, copy_fs, pool));
+  if (youngest_rev != 1)
+    return svn_error_createf (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+                              "hot copy has youngest revision %ld, not 1",
+                              (long) youngest_rev);
+  SVN_ERR (svn_fs_revision_root (&rev_root, copy_fs, 1, pool));
+  SVN_ERR (svn_test__check_greek_tree (rev_root, pool));
+  SVN_ERR (svn_fs_close_fs (copy_fs));
+
+  /* Revision 2: change `iota' ... */
+  SVN_ERR (svn_fs_begin_txn (&txn, fs, 1, pool));
+  SVN_ERR (svn_fs_txn_root (&txn_root, txn, pool));
+  SVN_ERR (svn_test__set_file_contents (txn_root, "iota", "new iota\n",
+                                        pool));
+  SVN_ERR (svn_fs_commit_txn (NULL, &youngest_rev, txn));
+  SVN_ERR (svn_fs_close_txn (txn));
+
+  /* ... and ship the new logs to the copy. */
+  SVN_ERR (svn_fs_hotcopy_berkeley (fs, copy_path, TRUE, pool));
+  SVN_ERR (svn_test__fs_new (&copy_fs, pool));
+  SVN_ERR (svn_fs_open_berkeley (copy_fs, copy_path));
+  SVN_ERR (svn_fs_youngest_rev (&youngest_rev, copy_fs, pool));
+  if (youngest_rev != 2)
+    return svn_error_createf (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+                              "updated hot copy has youngest revision %ld, "
+                              "not 2", (long) youngest_rev);
+  SVN_ERR (svn_fs_revision_root (&rev_root, copy_fs, 2, pool));
+  SVN_ERR (svn_test__get_file_contents (rev_root, "iota", &contents, pool));
+  if (strcmp (contents->data, "new iota\n") != 0)
+    return svn_error_create (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+                             "updated hot copy has the wrong `iota'");
+  SVN_ERR (svn_fs_close_fs (copy_fs));
+
+  svn_fs_close_fs (fs);
+  return SVN_NO_ERROR;
+}
+
+
+
 
 /* ------------------------------------------------------------------------ */
 
@@ -5809,8 +6414,10 @@ svn_error_t * (*test_funcs[]) (const char **msg,
   reopen_trivial_transaction,
   create_file_transaction,
   verify_txn_list,
+  activities,
   call_functions_with_unopened_fs,
   write_and_read_file,
+  read_file_at_offset,
   create_mini_tree_transaction,
   create_greek_tree_transaction,
   list_directory,
@@ -5823,6 +6430,7 @@ svn_error_t * (*test_funcs[]) (const char **msg,
   test_tree_node_validation,
   fetch_by_id,
   fetch_youngest_rev,
+  trail_stats,
   basic_commit,
   copy_test,
   link_test,
@@ -5836,8 +6444,12 @@ svn_error_t * (*test_funcs[]) (const char **msg,
   check_root_revision,
   undeltify_deltify,
   test_node_created_rev,
+  node_info,
   check_related,
   revisions_changed,
+  file_checksums,
+  collect_garbage,
+  hot_copy,
   0
 };
 
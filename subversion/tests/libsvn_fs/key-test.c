@@ -185,6 +185,48 @@ next_key (const char **msg,
   return SVN_NO_ERROR;
 }
 
+
+static svn_error_t *
+key_compare (const char **msg, 
+             svn_boolean_t msg_only,
+             apr_pool_t *pool)
+{
+  int i;
+  static const struct {
+    const char *a;
+    const char *b;
+    int expected;
+  } cases[] = {
+    { "0", "0", 0 },
+    { "0", "1", -1 },
+    { "9", "a", -1 },
+    { "z", "10", -1 },
+    { "zzzzz", "100000", -1 },
+    { "97hnq33jx2b", "97hnq33jx2a", 1 },
+    { "aa0", "a9z", 1 },
+    { "z000001000000", "z000001000000", 0 },
+    { NULL, NULL, 0 }
+  };
+
+  *msg = "testing alphanumeric key comparison";
+
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+  for (i = 0; cases[i].a; i++)
+    {
+      if (svn_fs__key_compare (cases[i].a, cases[i].b) != cases[i].expected
+          || (svn_fs__key_compare (cases[i].b, cases[i].a)
+              != -cases[i].expected))
+        return svn_error_createf (SVN_ERR_FS_GENERAL, 0, NULL, pool,
+                                  "failed to compare keys \"%s\" and "
+                                  "\"%s\" correctly",
+                                  cases[i].a, cases[i].b);
+    }
+
+  return SVN_NO_ERROR;
+}
+
 
 /* The test table.  */
 
@@ -194,5 +236,6 @@ svn_error_t *(*test_funcs[]) (const char **msg,
 {
   0,
   next_key,
+  key_compare,
   0
 };
@@ -24,6 +24,7 @@
 #include "svn_fs.h"
 #include "svn_repos.h"
 #include "svn_path.h"
+#include "svn_io.h"
 #include "svn_delta.h"
 #include "svn_test.h"
 #include "../fs-helpers.h"
@@ -359,6 +360,1026 @@ dir_deltas (const char **msg,
 }
 
 
+
+/* A stream that appends to, and reads from the front of, a
+   stringbuf. */
+struct stringbuf_stream_baton
+{
+  svn_stringbuf_t *buf;
+  apr_size_t read_pos;
+};
+
+static svn_error_t *
+stringbuf_stream_read (void *baton, char *buffer, apr_size_t *len)
+{
+  struct stringbuf_stream_baton *sb = baton;
+
+  if (*len > sb->buf->len - sb->read_pos)
+    *len = sb->buf->len - sb->read_pos;
+  memcpy (buffer, sb->buf->data + sb->read_pos, *len);
+  sb->read_pos += *len;
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+stringbuf_stream_write (void *baton, const char *data, apr_size_t *len)
+{
+  struct stringbuf_stream_baton *sb = baton;
+
+  svn_stringbuf_appendbytes (sb->buf, data, *len);
+  return SVN_NO_ERROR;
+}
+
+static svn_stream_t *
+stringbuf_stream (svn_stringbuf_t *buf, apr_pool_t *pool)
+{
+  struct stringbuf_stream_baton *sb = apr_pcalloc (pool, sizeof (*sb));
+  svn_stream_t *stream = svn_stream_create (sb, pool);
+
+  sb->buf = buf;
+  svn_stream_set_read (stream, stringbuf_stream_read);
+  svn_stream_set_write (stream, stringbuf_stream_write);
+  return stream;
+}
+
+
+/* Return an error unless the trees at ROOT1:PATH and ROOT2:PATH have
+   the same entries, kinds, properties and file contents. */
+static svn_error_t *
+compare_trees (svn_fs_root_t *root1,
+               svn_fs_root_t *root2,
+               const char *path,
+               apr_pool_t *pool)
+{
+  apr_hash_t *props1, *props2;
+  apr_hash_index_t *hi;
+  int is_dir;
+
+  SVN_ERR (svn_fs_node_proplist (&props1, root1, path, pool));
+  SVN_ERR (svn_fs_node_proplist (&props2, root2, path, pool));
+  if (apr_hash_count (props1) != apr_hash_count (props2))
+    return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                              "property count differs on `%s'", path);
+  for (hi = apr_hash_first (pool, props1); hi; hi = apr_hash_next (hi))
+    {
+      const void *key;
+      apr_ssize_t klen;
+      void *val;
+      svn_string_t *val2;
+
+      apr_hash_this (hi, &key, &klen, &val);
+      val2 = apr_hash_get (props2, key, klen);
+      if (! val2 || ! svn_string_compare (val, val2))
+        return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                                  "property `%s' differs on `%s'",
+                                  (const char *) key, path);
+    }
+
+  SVN_ERR (svn_fs_is_dir (&is_dir, root1, path, pool));
+  if (is_dir)
+    {
+      apr_hash_t *entries1, *entries2;
+
+      SVN_ERR (svn_fs_dir_entries (&entries1, root1, path, pool));
+      SVN_ERR (svn_fs_dir_entries (&entries2, root2, path, pool));
+      if (apr_hash_count (entries1) != apr_hash_count (entries2))
+        return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                                  "entry count differs in `%s'", path);
+      for (hi = apr_hash_first (pool, entries1); hi; hi = apr_hash_next (hi))
+        {
+          const void *key;
+
+          apr_hash_this (hi, &key, NULL, NULL);
+          if (! apr_hash_get (entries2, key, APR_HASH_KEY_STRING))
+            return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                                      "`%s' missing from `%s'",
+                                      (const char *) key, path);
+          SVN_ERR (compare_trees (root1, root2,
+                                  svn_path_join (path, key, pool), pool));
+        }
+    }
+  else
+    {
+      svn_stringbuf_t *contents1, *contents2;
+
+      SVN_ERR (svn_fs_is_dir (&is_dir, root2, path, pool));
+      if (is_dir)
+        return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                                  "`%s' has changed kind", path);
+      SVN_ERR (svn_test__get_file_contents (root1, path, &contents1, pool));
+      SVN_ERR (svn_test__get_file_contents (root2, path, &contents2, pool));
+      if (! svn_stringbuf_compare (contents1, contents2))
+        return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                                  "contents of `%s' differ", path);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+dump_load (const char **msg,
+           svn_boolean_t msg_only,
+           apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *revision_root;
+  svn_revnum_t youngest_rev;
+  int use_deltas;
+  apr_pool_t *subpool;
+
+  *msg = "dump a repository and load it back in";
+
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+  SVN_ERR (svn_test__create_repos (&repos, "test-repo-dump", pool));
+  fs = svn_repos_fs (repos);
+
+  /* Revision 1: the greek tree. */
+  SVN_ERR (svn_fs_begin_txn (&txn, fs, 0, pool));
+  SVN_ERR (svn_fs_txn_root (&txn_root, txn, pool));
+  SVN_ERR (svn_test__create_greek_tree (txn_root, pool));
+  SVN_ERR (svn_repos_fs_commit_txn (NULL, repos, &youngest_rev, txn));
+  SVN_ERR (svn_fs_close_txn (txn));
+
+  /* Revision 2: text, tree and property changes. */
+  SVN_ERR (svn_fs_begin_txn (&txn, fs, youngest_rev, pool));
+  SVN_ERR (svn_fs_txn_root (&txn_root, txn, pool));
+  {
+    svn_test__txn_script_command_t script_entries[] = {
+      { 'a', "A/B/Z",       0 },
+      { 'a', "A/B/Z/zeta",  "This is the file 'zeta'.\n" },
+      { 'd', "A/C",         "" },
+      { 'e', "iota",        "Changed file 'iota'.\n" },
+      { 'e', "A/D/G/rho",   "Changed file 'rho'.\n" }
+    };
+    SVN_ERR (svn_test__txn_script_exec (txn_root, script_entries, 5, pool));
+  }
+  SVN_ERR (svn_fs_change_node_prop (txn_root, "iota", "color",
+                                    svn_string_create ("red", pool), pool));
+  SVN_ERR (svn_fs_change_node_prop (txn_root, "A/D", "shape",
+                                    svn_string_create ("square", pool),
+                                    pool));
+  SVN_ERR (svn_repos_fs_commit_txn (NULL, repos, &youngest_rev, txn));
+  SVN_ERR (svn_fs_close_txn (txn));
+
+  /* Revision 3: copies, with changes made inside a copied tree. */
+  SVN_ERR (svn_fs_revision_root (&revision_root, fs, youngest_rev, pool));
+  SVN_ERR (svn_fs_begin_txn (&txn, fs, youngest_rev, pool));
+  SVN_ERR (svn_fs_txn_root (&txn_root, txn, pool));
+  SVN_ERR (svn_fs_copy (revision_root, "A/D", txn_root, "A/D2", pool));
+  SVN_ERR (svn_fs_copy (revision_root, "iota", txn_root, "A/iota2", pool));
+  {
+    svn_test__txn_script_command_t script_entries[] = {
+      { 'e', "A/D2/G/rho",  "Changed copied 'rho'.\n" },
+      { 'd', "A/D2/G/tau",  "" },
+      { 'a', "A/D2/G/nu",   "This is the file 'nu'.\n" },
+      { 'd', "A/D2/H",      "" },
+      { 'a', "A/D2/H",      "This is the file 'H'.\n" },
+      { 'e', "A/mu",        "Changed file 'mu'.\n" }
+    };
+    SVN_ERR (svn_test__txn_script_exec (txn_root, script_entries, 6, pool));
+  }
+  SVN_ERR (svn_fs_change_node_prop (txn_root, "A/D2", "shape", NULL, pool));
+  SVN_ERR (svn_repos_fs_commit_txn (NULL, repos, &youngest_rev, txn));
+  SVN_ERR (svn_fs_close_txn (txn));
+
+  /* Dump the whole thing and load it into a fresh repository, with
+     fulltexts and then with deltas.  Each loaded revision should
+     match its original exactly. */
+  subpool = svn_pool_create (pool);
+  for (use_deltas = 0; use_deltas <= 1; use_deltas++)
+    {
+      svn_stringbuf_t *dump = svn_stringbuf_create ("", subpool);
+      svn_repos_t *new_repos;
+      svn_fs_t *new_fs;
+      svn_revnum_t new_youngest, rev;
+      svn_fs_root_t *root1, *root2 = NULL;
+      svn_revnum_t copyfrom_rev;
+      const char *copyfrom_path;
+
+      SVN_ERR (svn_repos_dump_fs (repos, stringbuf_stream (dump, subpool),
+                                  NULL, SVN_INVALID_REVNUM,
+                                  SVN_INVALID_REVNUM, use_deltas, subpool));
+
+      SVN_ERR (svn_test__create_repos (&new_repos,
+                                       use_deltas
+                                       ? "test-repo-load-deltas"
+                                       : "test-repo-load",
+                                       subpool));
+      new_fs = svn_repos_fs (new_repos);
+      SVN_ERR (svn_repos_load_fs (new_repos, stringbuf_stream (dump, subpool),
+                                  NULL, subpool));
+
+      SVN_ERR (svn_fs_youngest_rev (&new_youngest, new_fs, subpool));
+      if (new_youngest != youngest_rev)
+        return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                                  "loaded %ld revisions, expected %ld",
+                                  (long) new_youngest, (long) youngest_rev);
+
+      for (rev = 1; rev <= youngest_rev; rev++)
+        {
+          SVN_ERR (svn_fs_revision_root (&root1, fs, rev, subpool));
+          SVN_ERR (svn_fs_revision_root (&root2, new_fs, rev, subpool));
+          SVN_ERR (compare_trees (root1, root2, "", subpool));
+        }
+
+      /* The copy should have kept its history. */
+      SVN_ERR (svn_fs_copied_from (&copyfrom_rev, &copyfrom_path,
+                                   root2, "A/D2", subpool));
+      if (copyfrom_rev != 2
+          || strcmp (copyfrom_path + (*copyfrom_path == '/'), "A/D") != 0)
+        return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                                 "copy history was not loaded");
+
+      SVN_ERR (svn_repos_close (new_repos));
+      svn_pool_clear (subpool);
+    }
+
+  svn_pool_destroy (subpool);
+  svn_repos_close (repos);
+  return SVN_NO_ERROR;
+}
+
+
+
+
+static svn_error_t *
+update_report (const char **msg,
+               svn_boolean_t msg_only,
+               apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev_root[4];
+  svn_revnum_t youngest_rev;
+  const svn_delta_edit_fns_t *editor;
+  void *edit_baton, *report_baton;
+  char **txn_names;
+  int num_txns = 0;
+
+  *msg = "update a mixed-revision report without a txn";
+
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+  SVN_ERR (svn_test__create_repos (&repos, "test-repo-update-report", pool));
+  fs = svn_repos_fs (repos);
+
+  /* Revision 1: the greek tree. */
+  SVN_ERR (svn_fs_begin_txn (&txn, fs, 0, pool));
+  SVN_ERR (svn_fs_txn_root (&txn_root, txn, pool));
+  SVN_ERR (svn_test__create_greek_tree (txn_root, pool));
+  SVN_ERR (svn_repos_fs_commit_txn (NULL, repos, &youngest_rev, txn));
+  SVN_ERR (svn_fs_close_txn (txn));
+
+  /* Revision 2. */
+  SVN_ERR (svn_fs_begin_txn (&txn, fs, youngest_rev, pool));
+  SVN_ERR (svn_fs_txn_root (&txn_root, txn, pool));
+  {
+    svn_test__txn_script_command_t script_entries[] = {
+      { 'a', "A/B/Z",       0 },
+      { 'a', "A/B/Z/zeta",  "This is the file 'zeta'.\n" },
+      { 'd', "A/C",         "" },
+      { 'e', "iota",        "Changed file 'iota'.\n" },
+      { 'e', "A/D/G/rho",   "Changed file 'rho'.\n" }
+    };
+    SVN_ERR (svn_test__txn_script_exec (txn_root, script_entries, 5, pool));
+  }
+  SVN_ERR (svn_repos_fs_commit_txn (NULL, repos, &youngest_rev, txn));
+  SVN_ERR (svn_fs_close_txn (txn));
+
+  /* Revision 3. */
+  SVN_ERR (svn_fs_begin_txn (&txn, fs, youngest_rev, pool));
+  SVN_ERR (svn_fs_txn_root (&txn_root, txn, pool));
+  {
+    svn_test__txn_script_command_t script_entries[] = {
+      { 'd', "A/B/E",       "" },
+      { 'e', "A/mu",        "Changed file 'mu'.\n" },
+      { 'e', "A/B/lambda",  "Changed file 'lambda'.\n" },
+      { 'e', "A/D/G/pi",    "Changed file 'pi'.\n" }
+    };
+    SVN_ERR (svn_test__txn_script_exec (txn_root, script_entries, 4, pool));
+  }
+  SVN_ERR (svn_repos_fs_commit_txn (NULL, repos, &youngest_rev, txn));
+  SVN_ERR (svn_fs_close_txn (txn));
+
+  SVN_ERR (svn_fs_revision_root (&rev_root[2], fs, 2, pool));
+  SVN_ERR (svn_fs_revision_root (&rev_root[3], fs, 3, pool));
+
+  /* Build a mirror of a mixed-revision working copy by hand: revision
+     1, with A/D/G and A/B/lambda from revision 3, A/B from revision 2,
+     and iota missing.  */
+  SVN_ERR (svn_fs_begin_txn (&txn, fs, 1, pool));
+  SVN_ERR (svn_fs_txn_root (&txn_root, txn, pool));
+  SVN_ERR (svn_fs_link (rev_root[3], "A/D/G", txn_root, "A/D/G", pool));
+  SVN_ERR (svn_fs_link (rev_root[2], "A/B", txn_root, "A/B", pool));
+  SVN_ERR (svn_fs_link (rev_root[3], "A/B/lambda",
+                        txn_root, "A/B/lambda", pool));
+  SVN_ERR (svn_fs_delete_tree (txn_root, "iota", pool));
+
+  /* Report the same working copy, and apply the resulting update to
+     the mirror.  */
+  SVN_ERR (dir_delta_get_editor (&editor, &edit_baton, fs, txn_root,
+                                 svn_stringbuf_create ("", pool), pool));
+  SVN_ERR (svn_repos_begin_report (&report_baton, 3, "user", repos,
+                                   "", NULL, "", TRUE, TRUE,
+                                   editor, edit_baton, pool));
+  SVN_ERR (svn_repos_set_path (report_baton, "", 1));
+  SVN_ERR (svn_repos_set_path (report_baton, "A/D/G", 3));
+  SVN_ERR (svn_repos_set_path (report_baton, "A/B", 2));
+  SVN_ERR (svn_repos_delete_path (report_baton, "iota"));
+  SVN_ERR (svn_repos_set_path (report_baton, "A/B/lambda", 3));
+  SVN_ERR (svn_repos_finish_report (report_baton));
+
+  /* The mirror should now be revision 3... */
+  SVN_ERR (compare_trees (rev_root[3], txn_root, "", pool));
+
+  /* ...and the report should not have made a transaction of its own. */
+  SVN_ERR (svn_fs_list_transactions (&txn_names, fs, pool));
+  while (txn_names[num_txns])
+    num_txns++;
+  if (num_txns != 1)
+    return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                              "found %d transactions, expected 1",
+                              num_txns);
+
+  SVN_ERR (svn_fs_abort_txn (txn));
+  svn_repos_close (repos);
+  return SVN_NO_ERROR;
+}
+
+
+
+
+static svn_error_t *
+pipelined_dir_delta (const char **msg,
+                     svn_boolean_t msg_only,
+                     apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev1_root, *rev2_root;
+  svn_revnum_t youngest_rev;
+  const svn_delta_edit_fns_t *editor;
+  void *edit_baton;
+  apr_hash_t *rev_diffs;
+  svn_revnum_t *revision;
+  int num_threads;
+  apr_pool_t *subpool;
+
+  *msg = "test svn_repos_dir_delta_pipelined";
+
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+  SVN_ERR (svn_test__create_repos (&repos, "test-repo-dir-delta-pipelined",
+                                   pool));
+  fs = svn_repos_fs (repos);
+
+  /* Revision 1: the greek tree. */
+  SVN_ERR (svn_fs_begin_txn (&txn, fs, 0, pool));
+  SVN_ERR (svn_fs_txn_root (&txn_root, txn, pool));
+  SVN_ERR (svn_test__create_greek_tree (txn_root, pool));
+  SVN_ERR (svn_repos_fs_commit_txn (NULL, repos, &youngest_rev, txn));
+  SVN_ERR (svn_fs_close_txn (txn));
+
+  /* Revision 2: changes to more files than the workers read ahead,
+     spread over several directories. */
+  SVN_ERR (svn_fs_begin_txn (&txn, fs, youngest_rev, pool));
+  SVN_ERR (svn_fs_txn_root (&txn_root, txn, pool));
+  {
+    svn_test__txn_script_command_t script_entries[] = {
+      { 'e', "iota",        "Changed file 'iota'.\n" },
+      { 'e', "A/mu",        "Changed file 'mu'.\n" },
+      { 'e', "A/B/lambda",  "Changed file 'lambda'.\n" },
+      { 'e', "A/B/E/alpha", "Changed file 'alpha'.\n" },
+      { 'd', "A/B/E/beta",  "" },
+      { 'a', "A/B/E/zeta",  "This is the file 'zeta'.\n" },
+      { 'd', "A/C",         "" },
+      { 'a', "A/C",         "This is the file 'C'.\n" },
+      { 'e', "A/D/gamma",   "Changed file 'gamma'.\n" },
+      { 'e', "A/D/G/pi",    "Changed file 'pi'.\n" },
+      { 'e', "A/D/G/rho",   "Changed file 'rho'.\n" },
+      { 'a', "A/D/G/nu",    "This is the file 'nu'.\n" },
+      { 'e', "A/D/H/chi",   "Changed file 'chi'.\n" },
+      { 'e', "A/D/H/omega", "Changed file 'omega'.\n" }
+    };
+    SVN_ERR (svn_test__txn_script_exec (txn_root, script_entries, 14,
+                                        pool));
+  }
+  SVN_ERR (svn_fs_change_node_prop (txn_root, "A/D/G/tau", "color",
+                                    svn_string_create ("blue", pool), pool));
+  SVN_ERR (svn_fs_change_node_prop (txn_root, "A/D/H/psi", "color",
+                                    svn_string_create ("green", pool),
+                                    pool));
+  SVN_ERR (svn_repos_fs_commit_txn (NULL, repos, &youngest_rev, txn));
+  SVN_ERR (svn_fs_close_txn (txn));
+
+  SVN_ERR (svn_fs_revision_root (&rev1_root, fs, 1, pool));
+  SVN_ERR (svn_fs_revision_root (&rev2_root, fs, 2, pool));
+
+  /* Update a copy of revision 1 to revision 2, with and without
+     worker threads, and in both directions.  Every way, the copy
+     should end up exactly like the target. */
+  subpool = svn_pool_create (pool);
+  for (num_threads = 0; num_threads <= 3; num_threads++)
+    {
+      int i;
+
+      for (i = 1; i <= 2; i++)
+        {
+          svn_fs_root_t *source_root = (i == 1) ? rev1_root : rev2_root;
+          svn_fs_root_t *target_root = (i == 1) ? rev2_root : rev1_root;
+
+          rev_diffs = apr_hash_make (subpool);
+          revision = apr_pcalloc (subpool, sizeof (*revision));
+          *revision = i;
+          apr_hash_set (rev_diffs, "", APR_HASH_KEY_STRING, revision);
+
+          SVN_ERR (svn_fs_begin_txn (&txn, fs, i, subpool));
+          SVN_ERR (svn_fs_txn_root (&txn_root, txn, subpool));
+          SVN_ERR (dir_delta_get_editor (&editor, &edit_baton, fs, txn_root,
+                                         svn_stringbuf_create ("", subpool),
+                                         subpool));
+          SVN_ERR (svn_repos_dir_delta_pipelined (source_root, "", NULL,
+                                                  rev_diffs,
+                                                  target_root, "",
+                                                  editor, edit_baton,
+                                                  TRUE, TRUE, FALSE,
+                                                  repos, num_threads,
+                                                  subpool));
+          SVN_ERR (compare_trees (target_root, txn_root, "", subpool));
+
+          SVN_ERR (svn_fs_abort_txn (txn));
+          svn_pool_clear (subpool);
+        }
+    }
+
+  svn_pool_destroy (subpool);
+  svn_repos_close (repos);
+  return SVN_NO_ERROR;
+}
+
+
+
+
+/* Commit a transaction based on the youngest revision of REPOS, which
+   makes the changes in SCRIPT (NUM_ENTRIES of them) after copying
+   each of the COPIES, if any, from revision COPY_REV.  Set
+   *YOUNGEST_REV to the new revision.  */
+static svn_error_t *
+commit_script (svn_revnum_t *youngest_rev,
+               svn_repos_t *repos,
+               svn_revnum_t copy_rev,
+               const char *copies[],
+               svn_test__txn_script_command_t *script,
+               int num_entries,
+               apr_pool_t *pool)
+{
+  svn_fs_t *fs = svn_repos_fs (repos);
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *copy_root;
+  int i;
+
+  SVN_ERR (svn_fs_youngest_rev (youngest_rev, fs, pool));
+  SVN_ERR (svn_repos_fs_begin_txn_for_commit (&txn, repos, *youngest_rev,
+                                              "jrandom", NULL, pool));
+  SVN_ERR (svn_fs_txn_root (&txn_root, txn, pool));
+  if (copies)
+    {
+      SVN_ERR (svn_fs_revision_root (&copy_root, fs, copy_rev, pool));
+      for (i = 0; copies[i]; i += 2)
+        SVN_ERR (svn_fs_copy (copy_root, copies[i], txn_root, copies[i + 1],
+                              pool));
+    }
+  SVN_ERR (svn_test__txn_script_exec (txn_root, script, num_entries, pool));
+  SVN_ERR (svn_repos_fs_commit_txn (NULL, repos, youngest_rev, txn));
+  SVN_ERR (svn_fs_close_txn (txn));
+  return SVN_NO_ERROR;
+}
+
+
+/* Check that every revision of REPOS up to YOUNGEST_REV matches the
+   same revision of REPLICA.  */
+static svn_error_t *
+compare_replica (svn_repos_t *repos,
+                 svn_repos_t *replica,
+                 svn_revnum_t youngest_rev,
+                 apr_pool_t *pool)
+{
+  svn_revnum_t rev;
+  apr_pool_t *subpool = svn_pool_create (pool);
+
+  SVN_ERR (svn_fs_youngest_rev (&rev, svn_repos_fs (replica), pool));
+  if (rev != youngest_rev)
+    return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                              "replica is at revision %ld, expected %ld",
+                              (long) rev, (long) youngest_rev);
+
+  for (rev = 1; rev <= youngest_rev; rev++)
+    {
+      svn_fs_root_t *root1, *root2;
+
+      SVN_ERR (svn_fs_revision_root (&root1, svn_repos_fs (repos), rev,
+                                     subpool));
+      SVN_ERR (svn_fs_revision_root (&root2, svn_repos_fs (replica), rev,
+                                     subpool));
+      SVN_ERR (compare_trees (root1, root2, "", subpool));
+      svn_pool_clear (subpool);
+    }
+
+  svn_pool_destroy (subpool);
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+replication (const char **msg,
+             svn_boolean_t msg_only,
+             apr_pool_t *pool)
+{
+  svn_repos_t *repos, *replica;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *root;
+  svn_revnum_t youngest_rev, replica_rev, copyfrom_rev;
+  const char *copyfrom_path;
+  const char *spool_path = "test-repo-replication/spool";
+  const char *replica_path = "test-repo-replica";
+  enum svn_node_kind kind;
+  apr_hash_t *dirents;
+  svn_error_t *err;
+
+  *msg = "feed a read-only replica from a repository's commits";
+
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+  SVN_ERR (svn_test__create_repos (&repos, "test-repo-replication", pool));
+  fs = svn_repos_fs (repos);
+
+  SVN_ERR (svn_io_check_path (replica_path, &kind, pool));
+  if (kind != svn_node_none)
+    SVN_ERR (svn_repos_delete (replica_path, pool));
+
+  /* Revision 1: the greek tree, committed before there is a spool. */
+  SVN_ERR (svn_fs_begin_txn (&txn, fs, 0, pool));
+  SVN_ERR (svn_fs_txn_root (&txn_root, txn, pool));
+  SVN_ERR (svn_test__create_greek_tree (txn_root, pool));
+  SVN_ERR (svn_repos_fs_commit_txn (NULL, repos, &youngest_rev, txn));
+  SVN_ERR (svn_fs_close_txn (txn));
+
+  /* Start spooling, backfilling revision 1. */
+  SVN_ERR (svn_repos_spool_revisions (repos, SVN_INVALID_REVNUM,
+                                      SVN_INVALID_REVNUM, pool));
+
+  /* Revisions 2 and 3 are spooled as they are committed. */
+  {
+    svn_test__txn_script_command_t script_entries[] = {
+      { 'a', "A/B/Z",       0 },
+      { 'a', "A/B/Z/zeta",  "This is the file 'zeta'.\n" },
+      { 'd', "A/C",         "" },
+      { 'e', "iota",        "Changed file 'iota'.\n" }
+    };
+    SVN_ERR (commit_script (&youngest_rev, repos, SVN_INVALID_REVNUM, NULL,
+                            script_entries, 4, pool));
+  }
+  {
+    const char *copies[] = { "A/D", "A/D2", NULL };
+    svn_test__txn_script_command_t script_entries[] = {
+      { 'e', "A/D2/G/rho",  "Changed copied 'rho'.\n" },
+      { 'd', "A/D2/H",      "" }
+    };
+    SVN_ERR (commit_script (&youngest_rev, repos, 2, copies,
+                            script_entries, 2, pool));
+  }
+
+  /* Make the replica. */
+  SVN_ERR (svn_repos_replicate (&replica_rev, spool_path, replica_path,
+                                NULL, pool));
+  if (replica_rev != youngest_rev)
+    return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                              "replicate reported revision %ld, expected %ld",
+                              (long) replica_rev, (long) youngest_rev);
+  SVN_ERR (svn_repos_open (&replica, replica_path, pool));
+  SVN_ERR (compare_replica (repos, replica, youngest_rev, pool));
+
+  /* The replica can't be committed or loaded into. */
+  err = svn_repos_fs_begin_txn_for_commit (&txn, replica, youngest_rev,
+                                           "jrandom", NULL, pool);
+  if (! err || err->apr_err != SVN_ERR_REPOS_READ_ONLY)
+    return svn_error_create (SVN_ERR_TEST_FAILED, 0, err, pool,
+                             "replica accepted a commit");
+  svn_error_clear_all (err);
+
+  err = svn_repos_load_fs (replica,
+                           stringbuf_stream (svn_stringbuf_create ("", pool),
+                                             pool),
+                           NULL, pool);
+  if (! err || err->apr_err != SVN_ERR_REPOS_READ_ONLY)
+    return svn_error_create (SVN_ERR_TEST_FAILED, 0, err, pool,
+                             "replica accepted a load");
+  svn_error_clear_all (err);
+
+  /* Revision 4 copies from a revision the replica already has.  */
+  {
+    const char *copies[] = { "iota", "A/iota2", "A/C", "A/C", NULL };
+    svn_test__txn_script_command_t script_entries[] = {
+      { 'e', "A/mu",        "Changed file 'mu'.\n" }
+    };
+    SVN_ERR (commit_script (&youngest_rev, repos, 1, copies,
+                            script_entries, 1, pool));
+  }
+  SVN_ERR (svn_repos_replicate (&replica_rev, spool_path, replica_path,
+                                NULL, pool));
+  SVN_ERR (compare_replica (repos, replica, youngest_rev, pool));
+
+  SVN_ERR (svn_fs_revision_root (&root, svn_repos_fs (replica), youngest_rev,
+                                 pool));
+  SVN_ERR (svn_fs_copied_from (&copyfrom_rev, &copyfrom_path,
+                               root, "A/C", pool));
+  if (copyfrom_rev != 1
+      || strcmp (copyfrom_path + (*copyfrom_path == '/'), "A/C") != 0)
+    return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                             "copy history was not replicated");
+
+  /* Prune what the replica has; nothing should be left.  */
+  SVN_ERR (svn_repos_prune_spool (spool_path, replica_rev, pool));
+  SVN_ERR (svn_io_get_dirents (&dirents,
+                               svn_stringbuf_create (spool_path, pool),
+                               pool));
+  if (apr_hash_count (dirents) != 0)
+    return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                             "spool was not pruned");
+
+  /* And a repository that isn't a replica can't be replicated to. */
+  err = svn_repos_replicate (&replica_rev, spool_path,
+                             "test-repo-replication", NULL, pool);
+  if (! err || err->apr_err != SVN_ERR_REPOS_NOT_REPLICA)
+    return svn_error_create (SVN_ERR_TEST_FAILED, 0, err, pool,
+                             "replicated to a repository that isn't a "
+                             "replica");
+  svn_error_clear_all (err);
+
+  svn_repos_close (replica);
+  svn_repos_close (repos);
+  return SVN_NO_ERROR;
+}
+
+
+/* A commit callback which records the new revision and its author. */
+struct commit_info
+{
+  svn_revnum_t new_rev;
+  const char *author;
+  apr_pool_t *pool;
+};
+
+static svn_error_t *
+record_commit (svn_revnum_t new_revision,
+               const char *date,
+               const char *author,
+               void *baton)
+{
+  struct commit_info *info = baton;
+
+  info->new_rev = new_revision;
+  info->author = apr_pstrdup (info->pool, author);
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+commit_editor (const char **msg,
+               svn_boolean_t msg_only,
+               apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *root;
+  svn_revnum_t youngest_rev;
+  const svn_delta_editor_t *editor, *binary_editor;
+  void *edit_baton, *binary_baton, *root_baton, *dir_baton, *file_baton;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_stringbuf_t *drive = svn_stringbuf_create ("", pool);
+  svn_stringbuf_t *contents;
+  svn_string_t *value;
+  svn_string_t log_msg;
+  struct commit_info info;
+  const char *repos_url = "file:///test/repos";
+  svn_error_t *err;
+
+  *msg = "commit a replayed editor drive into a repository";
+
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+  SVN_ERR (svn_test__create_repos (&repos, "test-repo-commit-editor", pool));
+  fs = svn_repos_fs (repos);
+
+  /* Revision 1: the greek tree. */
+  SVN_ERR (svn_fs_begin_txn (&txn, fs, 0, pool));
+  SVN_ERR (svn_fs_txn_root (&txn_root, txn, pool));
+  SVN_ERR (svn_test__create_greek_tree (txn_root, pool));
+  SVN_ERR (svn_repos_fs_commit_txn (NULL, repos, &youngest_rev, txn));
+  SVN_ERR (svn_fs_close_txn (txn));
+
+  /* Encode a drive under A, the way a client would send it... */
+  SVN_ERR (svn_delta_get_binary_editor (stringbuf_stream (drive, pool),
+                                        &binary_editor, &binary_baton, pool));
+  SVN_ERR (binary_editor->open_root (binary_baton, youngest_rev, pool,
+                                     &root_baton));
+  SVN_ERR (binary_editor->add_file ("newfile", root_baton, NULL,
+                                    SVN_INVALID_REVNUM, pool, &file_baton));
+  SVN_ERR (binary_editor->apply_textdelta (file_baton, &handler,
+                                           &handler_baton));
+  SVN_ERR (svn_txdelta_send_string
+           (svn_string_create ("This is the file 'newfile'.\n", pool),
+            handler, handler_baton, pool));
+  SVN_ERR (binary_editor->change_file_prop
+           (file_baton, "color", svn_string_create ("red", pool), pool));
+  SVN_ERR (binary_editor->close_file (file_baton));
+  SVN_ERR (binary_editor->delete_entry ("B", youngest_rev, root_baton,
+                                        pool));
+  SVN_ERR (binary_editor->add_directory
+           ("D2", root_baton,
+            apr_pstrcat (pool, repos_url, "/A/D", NULL), youngest_rev,
+            pool, &dir_baton));
+  SVN_ERR (binary_editor->close_directory (dir_baton));
+  SVN_ERR (binary_editor->close_directory (root_baton));
+  SVN_ERR (binary_editor->close_edit (binary_baton));
+
+  /* ...and replay it into the repository's commit editor. */
+  log_msg.data = "Replayed commit.";
+  log_msg.len = strlen (log_msg.data);
+  info.new_rev = SVN_INVALID_REVNUM;
+  info.author = NULL;
+  info.pool = pool;
+  SVN_ERR (svn_repos_get_commit_editor (&editor, &edit_baton, repos,
+                                        repos_url, "/A", "jrandom",
+                                        &log_msg, record_commit, &info,
+                                        pool));
+  SVN_ERR (svn_delta_binary_parse (stringbuf_stream (drive, pool),
+                                   editor, edit_baton, pool));
+
+  if (info.new_rev != youngest_rev + 1
+      || ! info.author || strcmp (info.author, "jrandom") != 0)
+    return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                             "commit callback got the wrong revision "
+                             "or author");
+
+  SVN_ERR (svn_fs_revision_root (&root, fs, info.new_rev, pool));
+  SVN_ERR (svn_test__get_file_contents (root, "A/newfile", &contents,
+                                        pool));
+  if (strcmp (contents->data, "This is the file 'newfile'.\n") != 0)
+    return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                             "added file has the wrong contents");
+  SVN_ERR (svn_fs_node_prop (&value, root, "A/newfile", "color", pool));
+  if (! value || strcmp (value->data, "red") != 0)
+    return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                             "added file has the wrong property");
+  if (svn_fs_check_path (root, "A/B", pool) != svn_node_none)
+    return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                             "deleted directory is still there");
+  SVN_ERR (svn_test__get_file_contents (root, "A/D2/G/rho", &contents,
+                                        pool));
+  if (strcmp (contents->data, "This is the file 'rho'.\n") != 0)
+    return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                             "copied directory has the wrong contents");
+
+  /* A copy from a URL outside the repository is refused, even one
+     whose path merely starts with the repository's. */
+  SVN_ERR (svn_repos_get_commit_editor (&editor, &edit_baton, repos,
+                                        repos_url, "/A", "jrandom",
+                                        &log_msg, record_commit, &info,
+                                        pool));
+  SVN_ERR (editor->open_root (edit_baton, info.new_rev, pool, &root_baton));
+  err = editor->add_directory ("D3", root_baton,
+                               "file:///test/repos2/A/D", info.new_rev,
+                               pool, &dir_baton);
+  if (! err)
+    return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                             "copied from outside the repository");
+  svn_error_clear_all (err);
+  SVN_ERR (editor->abort_edit (edit_baton));
+
+  svn_repos_close (repos);
+  return SVN_NO_ERROR;
+}
+
+
+/* Where the build leaves the test hook plugin, relative to the
+   directory the tests run in.  */
+#define TEST_HOOK_PLUGIN ".libs/libsvn_test_hook_plugin.so"
+
+/* Make the test hook plugin REPOS's hook plugin.  */
+static svn_error_t *
+install_test_plugin (svn_repos_t *repos, apr_pool_t *pool)
+{
+  enum svn_node_kind kind;
+
+  SVN_ERR (svn_io_check_path (TEST_HOOK_PLUGIN, &kind, pool));
+  if (kind != svn_node_file)
+    return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                             "the test hook plugin `" TEST_HOOK_PLUGIN
+                             "' has not been built");
+
+  return svn_io_copy_file (TEST_HOOK_PLUGIN,
+                           svn_repos_hook_plugin (repos, pool),
+                           FALSE, pool);
+}
+
+static svn_error_t *
+hook_plugin (const char **msg,
+             svn_boolean_t msg_only,
+             apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_revnum_t youngest_rev;
+  svn_string_t *value;
+  svn_error_t *err;
+
+  *msg = "run commit hooks from a hook plugin";
+
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+#if APR_HAS_DSO
+  SVN_ERR (svn_test__create_repos (&repos, "test-repo-hook-plugin", pool));
+  fs = svn_repos_fs (repos);
+  SVN_ERR (install_test_plugin (repos, pool));
+
+  /* The plugin's pre-commit hook turns this commit away... */
+  {
+    svn_test__txn_script_command_t script_entries[] = {
+      { 'a', "rejected",    "This file is not allowed in.\n" }
+    };
+    err = commit_script (&youngest_rev, repos, SVN_INVALID_REVNUM, NULL,
+                         script_entries, 1, pool);
+    if (! err || err->apr_err != SVN_ERR_REPOS_HOOK_FAILURE)
+      return svn_error_create (SVN_ERR_TEST_FAILED, 0, err, pool,
+                               "plugin's pre-commit hook let a commit in");
+    svn_error_clear_all (err);
+  }
+  SVN_ERR (svn_fs_youngest_rev (&youngest_rev, fs, pool));
+  if (youngest_rev != 0)
+    return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                              "rejected commit made revision %ld",
+                              (long) youngest_rev);
+
+  /* ...and lets this one in, marking the new revision afterwards. */
+  {
+    svn_test__txn_script_command_t script_entries[] = {
+      { 'a', "accepted",    "This file is welcome.\n" }
+    };
+    SVN_ERR (commit_script (&youngest_rev, repos, SVN_INVALID_REVNUM, NULL,
+                            script_entries, 1, pool));
+  }
+  SVN_ERR (svn_fs_revision_prop (&value, fs, youngest_rev,
+                                 "test:post-commit", pool));
+  if (! value || strcmp (value->data, "ran") != 0)
+    return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                             "plugin's post-commit hook did not run");
+
+  svn_repos_close (repos);
+#endif /* APR_HAS_DSO */
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Check that STATS, from a run of REPOS's post-commit queue, counts
+   RUN, RETRIED, FAILED and QUEUED hooks, and that the queue is now
+   QUEUED deep.  */
+static svn_error_t *
+check_queue_run (svn_repos_hook_queue_stats_t *stats,
+                 svn_repos_t *repos,
+                 int run,
+                 int retried,
+                 int failed,
+                 int queued,
+                 apr_pool_t *pool)
+{
+  int depth;
+  apr_time_t oldest;
+
+  if (stats->run != run || stats->retried != retried
+      || stats->failed != failed || stats->queued != queued)
+    return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                              "queue run did %d/%d/%d/%d "
+                              "(run/retried/failed/queued), "
+                              "expected %d/%d/%d/%d",
+                              stats->run, stats->retried, stats->failed,
+                              stats->queued, run, retried, failed, queued);
+
+  SVN_ERR (svn_repos_post_commit_queue_depth (&depth, &oldest, repos, pool));
+  if (depth != queued || (depth == 0) != (oldest == 0))
+    return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                              "queue is %d deep (oldest %s), expected %d",
+                              depth, oldest ? "set" : "unset", queued);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+post_commit_queue (const char **msg,
+                   svn_boolean_t msg_only,
+                   apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_revnum_t youngest_rev;
+  svn_repos_hook_queue_stats_t stats;
+  svn_string_t *value;
+  svn_stringbuf_t *entry;
+  const char *queue_path, *eol;
+  enum svn_node_kind kind;
+  int i;
+
+  *msg = "queue post-commit hooks, and retry and set aside failures";
+
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+#if APR_HAS_DSO
+  SVN_ERR (svn_test__create_repos (&repos, "test-repo-hook-queue", pool));
+  fs = svn_repos_fs (repos);
+  SVN_ERR (install_test_plugin (repos, pool));
+  svn_repos_set_post_commit_async (repos, TRUE);
+  queue_path = apr_pstrcat (pool, svn_repos_hook_dir (repos, pool),
+                            "/post-commit.queue", NULL);
+
+  /* Queue hooks for three revisions, and tell the plugin's hook to
+     fail for the last two. */
+  for (i = 1; i <= 3; i++)
+    {
+      svn_test__txn_script_command_t script_entries[] = {
+        { 'a', NULL,          "A queued file.\n" }
+      };
+      script_entries[0].path = apr_psprintf (pool, "file%d", i);
+      SVN_ERR (commit_script (&youngest_rev, repos, SVN_INVALID_REVNUM, NULL,
+                              script_entries, 1, pool));
+    }
+  SVN_ERR (svn_fs_revision_prop (&value, fs, 1, "test:post-commit", pool));
+  if (value)
+    return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                             "queued post-commit hook ran at commit time");
+  for (i = 2; i <= 3; i++)
+    SVN_ERR (svn_fs_change_rev_prop (fs, i, "test:fail-post-commit",
+                                     svn_string_create ("yes", pool), pool));
+
+  /* The first run runs revision 1's hook and keeps the others... */
+  SVN_ERR (svn_repos_run_post_commit_queue (&stats, repos, 1, 2, pool));
+  SVN_ERR (check_queue_run (&stats, repos, 1, 2, 0, 2, pool));
+  SVN_ERR (svn_fs_revision_prop (&value, fs, 1, "test:post-commit", pool));
+  if (! value)
+    return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                             "queued post-commit hook did not run");
+
+  /* ...counting one failure for each of them. */
+  SVN_ERR (svn_string_from_file (&entry, apr_pstrcat (pool, queue_path,
+                                                      "/2", NULL),
+                                 pool));
+  eol = strchr (entry->data, '\n');
+  if (! eol || atoi (eol + 1) != 1)
+    return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                              "bad attempt count in queue entry:\n%s",
+                              entry->data);
+
+  /* Once revision 2's hook works, the second run runs it, and sets
+     revision 3's aside after its second failure. */
+  SVN_ERR (svn_fs_change_rev_prop (fs, 2, "test:fail-post-commit", NULL,
+                                   pool));
+  SVN_ERR (svn_repos_run_post_commit_queue (&stats, repos, 1, 2, pool));
+  SVN_ERR (check_queue_run (&stats, repos, 1, 0, 1, 0, pool));
+  SVN_ERR (svn_fs_revision_prop (&value, fs, 2, "test:post-commit", pool));
+  if (! value)
+    return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                             "retried post-commit hook did not run");
+  SVN_ERR (svn_io_check_path (apr_pstrcat (pool, queue_path, "/3.failed",
+                                           NULL),
+                              &kind, pool));
+  if (kind != svn_node_file)
+    return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                             "failed post-commit hook was not set aside");
+
+  svn_repos_close (repos);
+#endif /* APR_HAS_DSO */
+
+  return SVN_NO_ERROR;
+}
+
+
+
 
 /* The test table.  */
 
@@ -367,6 +1388,13 @@ svn_error_t * (*test_funcs[]) (const char **msg,
                                apr_pool_t *pool) = {
   0,
   dir_deltas,
+  dump_load,
+  update_report,
+  pipelined_dir_delta,
+  replication,
+  commit_editor,
+  hook_plugin,
+  post_commit_queue,
   0
 };
 
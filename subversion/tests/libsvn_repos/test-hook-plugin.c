@@ -0,0 +1,105 @@
+/*
+ * test-hook-plugin.c: a hook plugin for repos-test to load
+ *
+ * ====================================================================
+ * Copyright (c) 2000-2002 CollabNet.  All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.  The terms
+ * are also available at http://subversion.tigris.org/license-1.html.
+ * If newer versions of this license are posted there, you may use a
+ * newer version instead, at your option.
+ *
+ * This software consists of voluntary contributions made by many
+ * individuals.  For exact contribution history, see the revision
+ * history and logs, available at http://subversion.tigris.org/.
+ * ====================================================================
+ */
+
+#include <apr_pools.h>
+#include <apr_hash.h>
+#include "svn_error.h"
+#include "svn_string.h"
+#include "svn_fs.h"
+#include "svn_repos.h"
+
+/* The pre-commit hook rejects any txn touching this path... */
+#define REJECTED_PATH "/rejected"
+
+/* ...and the post-commit hook marks each revision with this property,
+   unless the revision has the second one, in which case it fails. */
+#define POST_COMMIT_PROP "test:post-commit"
+#define FAIL_POST_COMMIT_PROP "test:fail-post-commit"
+
+
+static svn_error_t *
+pre_commit (void *baton,
+            svn_repos_t *repos,
+            svn_fs_txn_t *txn,
+            svn_fs_root_t *txn_root,
+            apr_hash_t *changed_paths,
+            apr_pool_t *pool)
+{
+  if (apr_hash_get (changed_paths, REJECTED_PATH, APR_HASH_KEY_STRING))
+    return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                             "test plugin rejects `" REJECTED_PATH "'");
+
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+post_commit (void *baton,
+             svn_repos_t *repos,
+             svn_revnum_t rev,
+             svn_fs_root_t *rev_root,
+             apr_hash_t *changed_paths,
+             apr_pool_t *pool)
+{
+  svn_fs_t *fs = svn_repos_fs (repos);
+  svn_string_t *fail;
+
+  SVN_ERR (svn_fs_revision_prop (&fail, fs, rev, FAIL_POST_COMMIT_PROP,
+                                 pool));
+  if (fail)
+    return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                              "test plugin told to fail revision %ld",
+                              (long) rev);
+
+  return svn_fs_change_rev_prop (fs, rev, POST_COMMIT_PROP,
+                                 svn_string_create ("ran", pool), pool);
+}
+
+
+static const svn_repos_hook_plugin_t plugin =
+  {
+    NULL,
+    pre_commit,
+    post_commit
+  };
+
+
+svn_error_t *
+svn_repos_hook_plugin_init (const svn_repos_hook_plugin_t **plugin_p,
+                            void **baton,
+                            int abi_version,
+                            svn_repos_t *repos,
+                            apr_pool_t *pool)
+{
+  if (abi_version != SVN_REPOS_HOOK_PLUGIN_ABI_VERSION)
+    return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                              "test plugin can't handle ABI version %d",
+                              abi_version);
+
+  *plugin_p = &plugin;
+  *baton = NULL;
+  return SVN_NO_ERROR;
+}
+
+
+
+/*
+ * local variables:
+ * eval: (load-file "../../../tools/dev/svn-dev.el")
+ * end:
+ */
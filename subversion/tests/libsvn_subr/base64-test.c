@@ -0,0 +1,359 @@
+/*
+ * base64-test.c -- test the base64 encoding and decoding functions
+ *
+ * ====================================================================
+ * Copyright (c) 2000-2002 CollabNet.  All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.  The terms
+ * are also available at http://subversion.tigris.org/license-1.html.
+ * If newer versions of this license are posted there, you may use a
+ * newer version instead, at your option.
+ *
+ * This software consists of voluntary contributions made by many
+ * individuals.  For exact contribution history, see the revision
+ * history and logs, available at http://subversion.tigris.org/.
+ * ====================================================================
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <apr_general.h>
+#include <apr_getopt.h>
+#include <apr_time.h>
+#include "svn_base64.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_test.h"
+
+#define DEFAULT_ITERATIONS 200
+#define DEFAULT_MAXLEN 5000
+
+/* The size of the buffer used by the throughput test. */
+#define BENCH_LEN (8 * 1024 * 1024)
+
+
+/* Initialize parameters for the random tests. */
+extern int test_argc;
+extern const char **test_argv;
+
+static void init_params (unsigned long *seed,
+                         int *maxlen, int *iterations,
+                         apr_pool_t *pool)
+{
+  apr_getopt_t *opt;
+  char optch;
+  const char *opt_arg;
+  apr_status_t status;
+
+  *seed = (unsigned long) apr_time_now();
+  *maxlen = DEFAULT_MAXLEN;
+  *iterations = DEFAULT_ITERATIONS;
+
+  apr_getopt_init (&opt, pool, test_argc, test_argv);
+  while (APR_SUCCESS
+         == (status = apr_getopt (opt, "s:l:n:", &optch, &opt_arg)))
+    {
+      switch (optch)
+        {
+        case 's':
+          *seed = atol (opt_arg);
+          break;
+        case 'l':
+          *maxlen = atoi (opt_arg);
+          break;
+        case 'n':
+          *iterations = atoi (opt_arg);
+          break;
+        }
+    }
+}
+
+
+static unsigned long
+myrand (unsigned long *seed)
+{
+  *seed = (*seed * 1103515245 + 12345) & 0xffffffff;
+  return *seed;
+}
+
+
+
+/*** Reference implementation. ***/
+
+/* A straightforward encoder, one group at a time, which defines the
+   output the library must produce: 76-character lines, each ended
+   by a newline, and a final newline after a partial last line. */
+static svn_stringbuf_t *
+reference_encode (const svn_stringbuf_t *str, apr_pool_t *pool)
+{
+  static const char tab[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                            "abcdefghijklmnopqrstuvwxyz0123456789+/";
+  svn_stringbuf_t *out = svn_stringbuf_create ("", pool);
+  const unsigned char *p = (const unsigned char *) str->data;
+  apr_size_t i, len = str->len;
+  int linelen = 0;
+
+  for (i = 0; i < len; i += 3)
+    {
+      unsigned char in[3] = { 0, 0, 0 };
+      apr_size_t n = (len - i < 3) ? len - i : 3;
+      char group[4];
+
+      memcpy (in, p + i, n);
+      group[0] = tab[in[0] >> 2];
+      group[1] = tab[((in[0] & 0x3) << 4) | (in[1] >> 4)];
+      group[2] = (n > 1) ? tab[((in[1] & 0xf) << 2) | (in[2] >> 6)] : '=';
+      group[3] = (n > 2) ? tab[in[2] & 0x3f] : '=';
+      svn_stringbuf_appendbytes (out, group, 4);
+      linelen += 4;
+      if (linelen == 76)
+        {
+          svn_stringbuf_appendcstr (out, "\n");
+          linelen = 0;
+        }
+    }
+  if (linelen > 0)
+    svn_stringbuf_appendcstr (out, "\n");
+
+  return out;
+}
+
+
+
+/*** Helpers. ***/
+
+static svn_stringbuf_t *
+random_data (unsigned long *seed, apr_size_t len, apr_pool_t *pool)
+{
+  svn_stringbuf_t *str = svn_stringbuf_create ("", pool);
+  apr_size_t i;
+
+  svn_stringbuf_ensure (str, len + 1);
+  for (i = 0; i < len; i++)
+    str->data[i] = (char) (myrand (seed) >> 8);
+  str->data[len] = '\0';
+  str->len = len;
+  return str;
+}
+
+
+static svn_error_t *
+append_to_stringbuf (void *baton, const char *data, apr_size_t *len)
+{
+  svn_stringbuf_appendbytes (baton, data, *len);
+  return SVN_NO_ERROR;
+}
+
+
+/* Push STR through the stream returned by MAKE_STREAM in pieces of
+   random size, and return everything it writes to its output in
+   *RESULT. */
+static svn_error_t *
+push_through_stream (svn_stringbuf_t **result,
+                     svn_stream_t *(*make_stream) (svn_stream_t *,
+                                                   apr_pool_t *),
+                     const svn_stringbuf_t *str,
+                     unsigned long *seed,
+                     apr_pool_t *pool)
+{
+  svn_stream_t *output, *stream;
+  apr_size_t pos = 0;
+
+  *result = svn_stringbuf_create ("", pool);
+  output = svn_stream_create (*result, pool);
+  svn_stream_set_write (output, append_to_stringbuf);
+  stream = make_stream (output, pool);
+
+  while (pos < str->len)
+    {
+      apr_size_t len = myrand (seed) % 200;
+
+      if (len > str->len - pos)
+        len = str->len - pos;
+      SVN_ERR (svn_stream_write (stream, str->data + pos, &len));
+      pos += len;
+    }
+  return svn_stream_close (stream);
+}
+
+
+static svn_error_t *
+check_equal (const svn_stringbuf_t *expected,
+             const svn_stringbuf_t *actual,
+             const char *what,
+             apr_size_t len,
+             apr_pool_t *pool)
+{
+  if (! svn_stringbuf_compare (expected, actual))
+    return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                              "%s of %lu bytes is wrong",
+                              what, (unsigned long) len);
+  return SVN_NO_ERROR;
+}
+
+
+
+/*** Tests. ***/
+
+static svn_error_t *
+known_values (const char **msg,
+              svn_boolean_t msg_only,
+              apr_pool_t *pool)
+{
+  static const char * const values[][2] = {
+    { "", "" },
+    { "f", "Zg==\n" },
+    { "fo", "Zm8=\n" },
+    { "foo", "Zm9v\n" },
+    { "foob", "Zm9vYg==\n" },
+    { "fooba", "Zm9vYmE=\n" },
+    { "foobar", "Zm9vYmFy\n" },
+    { "123456789012345678901234567890123456789012345678901234567",
+      "MTIzNDU2Nzg5MDEyMzQ1Njc4OTAxMjM0NTY3ODkwMTIzNDU2Nzg5MDEy"
+      "MzQ1Njc4OTAxMjM0NTY3\n" },
+    { "1234567890123456789012345678901234567890123456789012345678",
+      "MTIzNDU2Nzg5MDEyMzQ1Njc4OTAxMjM0NTY3ODkwMTIzNDU2Nzg5MDEy"
+      "MzQ1Njc4OTAxMjM0NTY3\nOA==\n" }
+  };
+  int i;
+
+  *msg = "base64 encode and decode known values";
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+  for (i = 0; i < sizeof (values) / sizeof (values[0]); i++)
+    {
+      svn_stringbuf_t *plain = svn_stringbuf_create (values[i][0], pool);
+      svn_stringbuf_t *encoded = svn_stringbuf_create (values[i][1], pool);
+
+      SVN_ERR (check_equal (encoded, svn_base64_encode_string (plain, pool),
+                            "encoding", plain->len, pool));
+      SVN_ERR (check_equal (plain, svn_base64_decode_string (encoded, pool),
+                            "decoding", plain->len, pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+random_round_trip (const char **msg,
+                   svn_boolean_t msg_only,
+                   apr_pool_t *pool)
+{
+  static char msg_buff[256];
+  unsigned long seed;
+  int i, maxlen, iterations;
+
+  init_params (&seed, &maxlen, &iterations, pool);
+  sprintf (msg_buff, "random base64 round trips, seed = %lu", seed);
+  *msg = msg_buff;
+
+  if (msg_only)
+    return SVN_NO_ERROR;
+  else
+    printf ("SEED: %s\n", msg_buff);
+
+  for (i = 0; i < iterations; i++)
+    {
+      apr_pool_t *subpool = svn_pool_create (pool);
+      apr_size_t len = myrand (&seed) % maxlen;
+      svn_stringbuf_t *plain = random_data (&seed, len, subpool);
+      svn_stringbuf_t *expected = reference_encode (plain, subpool);
+      svn_stringbuf_t *encoded, *decoded, *noisy;
+      apr_size_t j;
+
+      /* Whole-string and streamed encoding must both match the
+         reference exactly, line breaks and all. */
+      SVN_ERR (check_equal (expected,
+                            svn_base64_encode_string (plain, subpool),
+                            "string encoding", len, pool));
+      SVN_ERR (push_through_stream (&encoded, svn_base64_encode, plain,
+                                    &seed, subpool));
+      SVN_ERR (check_equal (expected, encoded, "stream encoding", len, pool));
+
+      /* Decoding must undo it, also when the line breaks are replaced
+         with CRLF and other stray non-base64 characters. */
+      SVN_ERR (check_equal (plain,
+                            svn_base64_decode_string (encoded, subpool),
+                            "string decoding", len, pool));
+      noisy = svn_stringbuf_create ("", subpool);
+      for (j = 0; j < encoded->len; j++)
+        {
+          if (encoded->data[j] == '\n')
+            svn_stringbuf_appendcstr (noisy, "\r\n");
+          else if (myrand (&seed) % 50 == 0)
+            svn_stringbuf_appendcstr (noisy, " \t");
+          svn_stringbuf_appendbytes (noisy, encoded->data + j, 1);
+        }
+      SVN_ERR (push_through_stream (&decoded, svn_base64_decode, noisy,
+                                    &seed, subpool));
+      SVN_ERR (check_equal (plain, decoded, "stream decoding", len, pool));
+
+      svn_pool_destroy (subpool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+throughput (const char **msg,
+            svn_boolean_t msg_only,
+            apr_pool_t *pool)
+{
+  unsigned long seed = 42;
+  svn_stringbuf_t *plain, *encoded, *decoded;
+  apr_time_t start, encode_time, decode_time;
+
+  *msg = "base64 throughput";
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+  plain = random_data (&seed, BENCH_LEN, pool);
+
+  start = apr_time_now ();
+  encoded = svn_base64_encode_string (plain, pool);
+  encode_time = apr_time_now () - start;
+
+  start = apr_time_now ();
+  decoded = svn_base64_decode_string (encoded, pool);
+  decode_time = apr_time_now () - start;
+
+  SVN_ERR (check_equal (plain, decoded, "benchmark round trip",
+                        plain->len, pool));
+
+  printf ("THROUGHPUT: encode %.1f MB/s, decode %.1f MB/s (%d KB)\n",
+          encode_time > 0
+          ? ((double) BENCH_LEN / (1024 * 1024))
+            / ((double) encode_time / APR_USEC_PER_SEC) : 0.0,
+          decode_time > 0
+          ? ((double) BENCH_LEN / (1024 * 1024))
+            / ((double) decode_time / APR_USEC_PER_SEC) : 0.0,
+          BENCH_LEN / 1024);
+
+  return SVN_NO_ERROR;
+}
+
+
+
+/* The test table.  */
+
+svn_error_t * (*test_funcs[]) (const char **msg,
+                               svn_boolean_t msg_only,
+                               apr_pool_t *pool) = {
+  0,
+  known_values,
+  random_round_trip,
+  throughput,
+  0
+};
+
+
+
+/*
+ * local variables:
+ * eval: (load-file "../../../tools/dev/svn-dev.el")
+ * end:
+ */
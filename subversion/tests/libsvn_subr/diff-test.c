@@ -0,0 +1,441 @@
+/*
+ * diff-test.c -- test the line diff engine
+ *
+ * ====================================================================
+ * Copyright (c) 2000-2002 CollabNet.  All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.  The terms
+ * are also available at http://subversion.tigris.org/license-1.html.
+ * If newer versions of this license are posted there, you may use a
+ * newer version instead, at your option.
+ *
+ * This software consists of voluntary contributions made by many
+ * individuals.  For exact contribution history, see the revision
+ * history and logs, available at http://subversion.tigris.org/.
+ * ====================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <apr_general.h>
+#include <apr_getopt.h>
+#include <apr_time.h>
+#include "svn_diff.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_test.h"
+
+#define DEFAULT_ITERATIONS 500
+#define DEFAULT_MAXLINES 60
+
+
+/* Initialize parameters for the random tests. */
+extern int test_argc;
+extern const char **test_argv;
+
+static void init_params (unsigned long *seed,
+                         int *maxlines, int *iterations,
+                         apr_pool_t *pool)
+{
+  apr_getopt_t *opt;
+  char optch;
+  const char *opt_arg;
+  apr_status_t status;
+
+  *seed = (unsigned long) apr_time_now();
+  *maxlines = DEFAULT_MAXLINES;
+  *iterations = DEFAULT_ITERATIONS;
+
+  apr_getopt_init (&opt, pool, test_argc, test_argv);
+  while (APR_SUCCESS
+         == (status = apr_getopt (opt, "s:l:n:", &optch, &opt_arg)))
+    {
+      switch (optch)
+        {
+        case 's':
+          *seed = atol (opt_arg);
+          break;
+        case 'l':
+          *maxlines = atoi (opt_arg);
+          break;
+        case 'n':
+          *iterations = atoi (opt_arg);
+          break;
+        }
+    }
+}
+
+
+static unsigned long
+myrand (unsigned long *seed)
+{
+  *seed = (*seed * 1103515245 + 12345) & 0xffffffff;
+  return *seed;
+}
+
+
+
+/*** Helpers. ***/
+
+static svn_error_t *
+append_to_stringbuf (void *baton, const char *data, apr_size_t *len)
+{
+  svn_stringbuf_appendbytes (baton, data, *len);
+  return SVN_NO_ERROR;
+}
+
+
+/* Diff ORIGINAL against MODIFIED with CONTEXT lines of context, and
+   return the output in *RESULT.  */
+static svn_error_t *
+diff_strings (svn_stringbuf_t **result,
+              const char *original,
+              apr_size_t original_len,
+              const char *modified,
+              apr_size_t modified_len,
+              int context,
+              apr_pool_t *pool)
+{
+  svn_stream_t *out;
+
+  *result = svn_stringbuf_create ("", pool);
+  out = svn_stream_create (*result, pool);
+  svn_stream_set_write (out, append_to_stringbuf);
+  return svn_diff_unified (out,
+                           svn_string_ncreate (original, original_len, pool),
+                           svn_string_ncreate (modified, modified_len, pool),
+                           "a", "b", context, pool);
+}
+
+
+/* Return the length of the line starting at P, before END, including
+   its newline.  */
+static apr_size_t
+line_len (const char *p, const char *end)
+{
+  const char *eol = memchr (p, '\n', end - p);
+  return eol ? eol + 1 - p : end - p;
+}
+
+
+/* Apply the unified diff DIFF to ORIGINAL, and return the result in
+   *RESULT, checking as we go that the diff is well formed and that
+   its context and deleted lines match ORIGINAL.  */
+static svn_error_t *
+apply_diff (svn_stringbuf_t **result,
+            const svn_stringbuf_t *original,
+            const svn_stringbuf_t *diff,
+            apr_pool_t *pool)
+{
+  const char *o = original->data, *o_end = original->data + original->len;
+  const char *d = diff->data, *d_end = diff->data + diff->len;
+  int o_line = 0;
+
+  *result = svn_stringbuf_create ("", pool);
+  if (diff->len == 0)
+    {
+      svn_stringbuf_appendbytes (*result, o, original->len);
+      return SVN_NO_ERROR;
+    }
+
+  if (strncmp (d, "--- a\n+++ b\n", 12) != 0)
+    return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                             "diff has the wrong headers");
+  d += 12;
+
+  while (d < d_end)
+    {
+      int start, len = 1, mod_start, mod_len = 1;
+      int olines = 0, mlines = 0;
+      svn_boolean_t last_was_mod = FALSE;
+      apr_size_t n;
+
+      if (sscanf (d, "@@ -%d,%d", &start, &len) < 1
+          || strncmp (d, "@@ -", 4) != 0)
+        return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                                 "diff has a bad hunk header");
+      if (sscanf (strchr (d, '+'), "+%d,%d", &mod_start, &mod_len) < 1)
+        return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                                 "diff has a bad hunk header");
+      d += line_len (d, d_end);
+
+      /* An empty range names the line before it. */
+      if (len > 0)
+        start--;
+
+      if (start < o_line)
+        return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                                 "diff has overlapping hunks");
+      for (; o_line < start; o_line++)
+        {
+          n = line_len (o, o_end);
+          svn_stringbuf_appendbytes (*result, o, n);
+          o += n;
+        }
+
+      while (d < d_end && *d != '@')
+        {
+          n = line_len (d, d_end);
+          if (*d == '\\')
+            {
+              /* The last line had no newline after all. */
+              if (last_was_mod)
+                svn_stringbuf_chop (*result, 1);
+              d += n;
+              continue;
+            }
+
+          if (*d == ' ' || *d == '-')
+            {
+              apr_size_t on = line_len (o, o_end);
+
+              /* Compare without the newline, which may be missing. */
+              if (o == o_end
+                  || (on != n - 1 && on != n - 2)
+                  || memcmp (o, d + 1, n - 2) != 0)
+                return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                                         "diff doesn't match the original");
+              olines++;
+              o += on;
+              o_line++;
+            }
+          if (*d == ' ' || *d == '+')
+            {
+              svn_stringbuf_appendbytes (*result, d + 1, n - 1);
+              mlines++;
+            }
+          last_was_mod = (*d == ' ' || *d == '+');
+          d += n;
+        }
+
+      if (olines != len || mlines != mod_len)
+        return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                                 "hunk header has the wrong line counts");
+    }
+
+  svn_stringbuf_appendbytes (*result, o, o_end - o);
+  return SVN_NO_ERROR;
+}
+
+
+/* Return a text of up to MAXLINES random lines, drawn from a small
+   set so that there is plenty of repetition, and sometimes without a
+   final newline.  */
+static svn_stringbuf_t *
+random_text (unsigned long *seed, int maxlines, apr_pool_t *pool)
+{
+  static const char * const words[] = { "a", "b", "c", "d", "e", "" };
+  svn_stringbuf_t *str = svn_stringbuf_create ("", pool);
+  int i, n = myrand (seed) % (maxlines + 1);
+
+  for (i = 0; i < n; i++)
+    {
+      svn_stringbuf_appendcstr (str, words[(myrand (seed) >> 8) % 6]);
+      svn_stringbuf_appendcstr (str, "\n");
+    }
+  if (str->len > 0 && (myrand (seed) >> 8) % 4 == 0)
+    svn_stringbuf_chop (str, 1);
+  return str;
+}
+
+
+/* Return a copy of STR with some of its lines deleted, added or
+   changed.  */
+static svn_stringbuf_t *
+mutate_text (const svn_stringbuf_t *str, unsigned long *seed,
+             apr_pool_t *pool)
+{
+  svn_stringbuf_t *out = svn_stringbuf_create ("", pool);
+  const char *p = str->data, *end = str->data + str->len;
+
+  while (p < end)
+    {
+      apr_size_t n = line_len (p, end);
+
+      switch ((myrand (seed) >> 8) % 8)
+        {
+        case 0:
+          break;
+        case 1:
+          svn_stringbuf_appendcstr (out, "new\n");
+          svn_stringbuf_appendbytes (out, p, n);
+          break;
+        case 2:
+          svn_stringbuf_appendcstr (out, "changed\n");
+          break;
+        default:
+          svn_stringbuf_appendbytes (out, p, n);
+        }
+      p += n;
+    }
+  if ((myrand (seed) >> 8) % 4 == 0)
+    svn_stringbuf_appendcstr (out, "tail");
+  return out;
+}
+
+
+
+/*** Tests. ***/
+
+static svn_error_t *
+known_values (const char **msg,
+              svn_boolean_t msg_only,
+              apr_pool_t *pool)
+{
+  /* Each is original, modified, and what GNU diff -u says. */
+  static const char * const values[][3] = {
+    { "", "", "" },
+    { "a\nb\nc\n", "a\nb\nc\n", "" },
+    { "", "a\n",
+      "--- a\n+++ b\n@@ -0,0 +1 @@\n+a\n" },
+    { "a\nb\n", "",
+      "--- a\n+++ b\n@@ -1,2 +0,0 @@\n-a\n-b\n" },
+    { "a\nb\nc\n", "a\nx\nc\n",
+      "--- a\n+++ b\n@@ -1,3 +1,3 @@\n a\n-b\n+x\n c\n" },
+    { "a\n", "a",
+      "--- a\n+++ b\n@@ -1 +1 @@\n-a\n+a\n\\ No newline at end of file\n" },
+    { "1\n2\n3\n4\n5\n6\n7\n8\n9\n10\n11\n12\n",
+      "1\n2\nx\n4\n5\n6\n7\n8\n9\n10\n11\ny\n",
+      "--- a\n+++ b\n"
+      "@@ -1,6 +1,6 @@\n 1\n 2\n-3\n+x\n 4\n 5\n 6\n"
+      "@@ -9,4 +9,4 @@\n 9\n 10\n 11\n-12\n+y\n" },
+    { "1\n2\n3\n4\n5\n6\n7\n8\n9\n",
+      "1\n2\n3\nx\n5\n6\n7\n8\ny\n",
+      "--- a\n+++ b\n"
+      "@@ -1,9 +1,9 @@\n 1\n 2\n 3\n-4\n+x\n 5\n 6\n 7\n 8\n-9\n+y\n" },
+    { "a\nb\nc\na\nb\nb\na\n", "c\nb\na\nb\na\nc\n",
+      "--- a\n+++ b\n"
+      "@@ -1,7 +1,6 @@\n-a\n-b\n c\n-a\n b\n+a\n b\n a\n+c\n" }
+  };
+  int i;
+
+  *msg = "diff known values";
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+  for (i = 0; i < sizeof (values) / sizeof (values[0]); i++)
+    {
+      svn_stringbuf_t *result;
+
+      SVN_ERR (diff_strings (&result,
+                             values[i][0], strlen (values[i][0]),
+                             values[i][1], strlen (values[i][1]),
+                             3, pool));
+      if (strcmp (result->data, values[i][2]) != 0)
+        return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                                  "diff of case %d is wrong:\n%s",
+                                  i, result->data);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+binary_detection (const char **msg,
+                  svn_boolean_t msg_only,
+                  apr_pool_t *pool)
+{
+  static const char text[] = "Some text,\n\twith a tab.\r\n";
+  static const char nul[] = "text\0more text";
+  unsigned char high[100];
+  int i;
+
+  *msg = "binary data detection";
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+  for (i = 0; i < sizeof (high); i++)
+    high[i] = (i < 90) ? 0x80 + i : 'a';
+
+  if (svn_io_is_binary_data (text, sizeof (text) - 1)
+      || svn_io_is_binary_data ("", 0))
+    return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                             "text was called binary");
+  if (! svn_io_is_binary_data (nul, sizeof (nul) - 1)
+      || ! svn_io_is_binary_data (high, sizeof (high)))
+    return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                             "binary data was called text");
+
+  /* Mostly high bytes, but not quite enough of them. */
+  for (i = 0; i < sizeof (high); i++)
+    high[i] = (i < 80) ? 0x80 + i : 'a';
+  if (svn_io_is_binary_data (high, sizeof (high)))
+    return svn_error_create (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                             "text with some high bytes was called binary");
+
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+random_round_trip (const char **msg,
+                   svn_boolean_t msg_only,
+                   apr_pool_t *pool)
+{
+  unsigned long seed;
+  int maxlines, iterations, i;
+  apr_pool_t *subpool;
+
+  *msg = "diff and patch random texts";
+  if (msg_only)
+    return SVN_NO_ERROR;
+
+  init_params (&seed, &maxlines, &iterations, pool);
+  printf ("random diff round trips: seed=%lu, iterations=%d, maxlines=%d\n",
+          seed, iterations, maxlines);
+
+  subpool = svn_pool_create (pool);
+  for (i = 0; i < iterations; i++)
+    {
+      svn_stringbuf_t *original = random_text (&seed, maxlines, subpool);
+      svn_stringbuf_t *modified = ((myrand (&seed) >> 8) % 2)
+        ? mutate_text (original, &seed, subpool)
+        : random_text (&seed, maxlines, subpool);
+      svn_stringbuf_t *diff, *patched;
+      int context = (myrand (&seed) >> 8) % 4;
+
+      SVN_ERR (diff_strings (&diff, original->data, original->len,
+                             modified->data, modified->len,
+                             context, subpool));
+      SVN_ERR (apply_diff (&patched, original, diff, subpool));
+      if (! svn_stringbuf_compare (patched, modified))
+        return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                                  "patching with the diff of iteration %d "
+                                  "doesn't give the modified text", i);
+      if ((diff->len == 0) != svn_stringbuf_compare (original, modified))
+        return svn_error_createf (SVN_ERR_TEST_FAILED, 0, NULL, pool,
+                                  "iteration %d: the diff is %s, but the "
+                                  "texts are %s", i,
+                                  diff->len ? "not empty" : "empty",
+                                  diff->len ? "the same" : "different");
+      svn_pool_clear (subpool);
+    }
+  svn_pool_destroy (subpool);
+
+  return SVN_NO_ERROR;
+}
+
+
+
+/* The test table.  */
+
+svn_error_t * (*test_funcs[]) (const char **msg,
+                               svn_boolean_t msg_only,
+                               apr_pool_t *pool) = {
+  0,
+  known_values,
+  binary_detection,
+  random_round_trip,
+  0
+};
+
+
+
+/*
+ * local variables:
+ * eval: (load-file "../../../tools/dev/svn-dev.el")
+ * end:
+ */